@@ -44,6 +44,36 @@ struct leakyrelu_args_fp16 {
     fp16 negative_slope;
 };
 
+
+/**
+ * @brief Structure for FP16 relu activation with 1-bit mask. The forward pass packs the sign of the input into mask,
+ * the backward pass only needs the mask (and not the input data).
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param mask 1-bit mask of ACT_MASK_WORDS(input->dim) words
+ */
+struct relu_mask_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * output;
+    uint32_t * mask;
+};
+
+
+/**
+ * @brief Structure for FP16 leaky relu activation with 1-bit mask. The forward pass packs the sign of the input into mask,
+ * the backward pass only needs the mask (and not the input data).
+ * @param input blob structure for the input data of the activation layer
+ * @param output blob structure for the output data of the activation layer
+ * @param negative_slope slope for negative inputs
+ * @param mask 1-bit mask of ACT_MASK_WORDS(input->dim) words
+ */
+struct leakyrelu_mask_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * output;
+    fp16 negative_slope;
+    uint32_t * mask;
+};
+
 /**
  * @brief Arguments for exponential and softmax in parallel
  * @param input   pointer to input vector
@@ -159,6 +189,59 @@ void leakyrelu_core_fw_fp16( void * leakyrelu_args_fp16 );
 void leakyrelu_core_bw_fp16( void * leakyrelu_args_fp16 );
 
 
+/**
+ * @brief Forward pass function of ReLU which also packs the 1-bit activation mask. Configure and pass a relu_mask_args_fp16 structure pointer as argument.
+ * @param input Input for relu.
+ * @param output Output of relu.
+*/
+void pulp_relu_mask_fp16_fw_cl( void * relu_mask_args );
+
+/**
+ * @brief Backward pass function of ReLU using only the 1-bit activation mask (input->data is not used).
+ * @param input Input for relu.
+ * @param output Output of relu.
+*/
+void pulp_relu_mask_fp16_bw_cl( void * relu_mask_args );
+
+/**
+ * @brief Core function of the masked ReLU forward (parallelize with pi_cl_team_fork(NUM_CORES, relu_mask_core_fw_fp16, &args)).
+ * @param relu_mask_args Input and output data, output mask
+*/
+void relu_mask_core_fw_fp16( void * relu_mask_args );
+
+/**
+ * @brief Core function of the masked ReLU backward (parallelize with pi_cl_team_fork(NUM_CORES, relu_mask_core_bw_fp16, &args)).
+ * @param relu_mask_args Gradients and input mask
+*/
+void relu_mask_core_bw_fp16( void * relu_mask_args );
+
+/**
+ * @brief Forward pass function of Leaky ReLU which also packs the 1-bit activation mask. Configure and pass a leakyrelu_mask_args_fp16 structure pointer as argument.
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_mask_fp16_fw_cl( void * leakyrelu_mask_args );
+
+/**
+ * @brief Backward pass function of Leaky ReLU using only the 1-bit activation mask (input->data is not used).
+ * @param input Input for leaky relu.
+ * @param output Output of leaky relu.
+*/
+void pulp_leakyrelu_mask_fp16_bw_cl( void * leakyrelu_mask_args );
+
+/**
+ * @brief Core function of the masked Leaky ReLU forward (parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_fw_fp16, &args)).
+ * @param leakyrelu_mask_args Input and output data, output mask
+*/
+void leakyrelu_mask_core_fw_fp16( void * leakyrelu_mask_args );
+
+/**
+ * @brief Core function of the masked Leaky ReLU backward (parallelize with pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_bw_fp16, &args)).
+ * @param leakyrelu_mask_args Gradients and input mask
+*/
+void leakyrelu_mask_core_bw_fp16( void * leakyrelu_mask_args );
+
+
 
 
 
@@ -185,6 +268,31 @@ void pulp_softmax_fp16_fw_cl_tiled( void * act_args , void * Tiled_matmul_mhsa_a
 void pulp_softmax_fp16_bw_cl( void * act_args_fp16 );
 
 
+/**
+ * @brief Vectorized online (single-pass) softmax forward. Running max and exponential sum of each row are computed in
+ * the same sweep, then the normalized output is written in a second sweep, all in a single fork. Configure and pass a
+ * softmax_args_fp16 structure pointer as argument (input_data, output_data, H, W). If maxes and sums are not NULL, the
+ * row maxes and exponential sums are stored in them.
+ * @param input Input for softmax.
+ * @param output Output of softmax.
+*/
+void pulp_softmax_online_fp16_fw_cl( void * act_args_fp16 );
+
+/**
+ * @brief Core function of the vectorized online softmax forward (allows parallelization on rows, parallelize with pi_cl_team_fork(NUM_CORES, softmax_online_core_fw_fp16, &args)).
+ * @param act_args_fp16 (struct softmax_args_fp16) input_data, output_data, H, W are used. maxes and sums are filled if not NULL.
+*/
+void softmax_online_core_fw_fp16( void * act_args_fp16 );
+
+/**
+ * @brief Core function of the vectorized fused softmax backward, computing input_diff = output_data * (output_diff - <output_diff, output_data>)
+ * on each row in a single fork (parallelize on rows with pi_cl_team_fork(NUM_CORES, softmax_core_bw_fp16, &args)).
+ * If sums is not NULL, the row dot products are stored in it.
+ * @param act_args_fp16 (struct softmax_args_fp16) output_data, output_diff, input_diff, H, W are used.
+*/
+void softmax_core_bw_fp16( void * act_args_fp16 );
+
+
 /**
  * @brief Forward pass function. Configure and pass a act_args structure pointer as argument.
  * @param input Input for gelu.
@@ -192,6 +300,13 @@ void pulp_softmax_fp16_bw_cl( void * act_args_fp16 );
 */
 void pulp_gelu_fp16_fw_cl( void* act_args_fp16);
 
+
+/**
+ * @brief Forward pass function that parallelizes the vectorized fp16 tanh. Use pi_cl_team_fork(NUM_CORES, tanh_prll_fp16, &args) to parallelize.
+ * @param (void *) (struct tanh_args_fp16 void_args)
+*/
+void tanh_prll_fp16( void * args );
+
 struct swiglu_args_fp16{
     fp16* in1;
     fp16* in2;
@@ -199,6 +314,158 @@ struct swiglu_args_fp16{
     int dim;
 };
 
+
+/**
+ * @brief Arguments for the trainable FP16 GELU (tanh approximation). The forward pass can store gelu'(x) into deriv,
+ * so that the backward pass reduces to a single elementwise product.
+ * @param input   blob structure for the input data (and input gradient) of the activation
+ * @param output  blob structure for the output data (and output gradient) of the activation
+ * @param deriv   buffer of input->dim elements holding gelu'(x), filled by the forward pass. If NULL, the backward pass recomputes it from input->data
+*/
+struct gelu_train_args_fp16 {
+    struct blob_fp16 *input;
+    struct blob_fp16 *output;
+    fp16 *deriv;
+};
+
+
+/**
+ * @brief Arguments for the trainable FP16 SwiGLU (output = input2 * input1 * sigmoid(input1)). The forward pass can
+ * store sigmoid(input1) into sig, which is reused by the backward pass.
+ * @param in1     blob structure for the gate input (data and gradient)
+ * @param in2     blob structure for the linear input (data and gradient)
+ * @param output  blob structure for the output data (and output gradient)
+ * @param sig     buffer of in1->dim elements holding sigmoid(in1), filled by the forward pass. If NULL, the backward pass recomputes it
+*/
+struct swiglu_train_args_fp16 {
+    struct blob_fp16 *in1;
+    struct blob_fp16 *in2;
+    struct blob_fp16 *output;
+    fp16 *sig;
+};
+
 void pulp_vector_softmax_fp16(fp16* out, fp16* in, fp16* buffer_n_cores, unsigned int size);
 
 void pulp_swiglu_fp16_cl(void *swiglu_args);
+
+
+/**
+ * @brief Vectorized GELU forward pass (tanh approximation) which also stores gelu'(x) into args->deriv for the backward pass.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_fw_cache_cl, &args) to parallelize.
+ * @param (void*) (struct gelu_train_args_fp16 void_args)
+ */
+void pulp_gelu_fp16_fw_cache_cl(void* void_args);
+
+
+/**
+ * @brief Vectorized GELU backward pass (tanh approximation): input->diff = output->diff * gelu'(input->data). Uses args->deriv
+ * if it is not NULL, otherwise recomputes the derivative. Use pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_bw_cl, &args) to parallelize.
+ * @param (void*) (struct gelu_train_args_fp16 void_args)
+ */
+void pulp_gelu_fp16_bw_cl(void* void_args);
+
+
+/**
+ * @brief Vectorized GELU (tanh approximation) returning gelu'(x) and writing gelu(x) into out, shared by the GELU layer and the fused GELU epilogues of other layers.
+ * @param x input pair
+ * @param out output pair gelu(x)
+ */
+v2f16 vgelu_deriv_fp16(v2f16 x, v2f16 *out);
+
+
+/**
+ * @brief Vectorized SwiGLU forward pass which also stores sigmoid(in1) into args->sig for the backward pass.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp16_fw_cache_cl, &args) to parallelize.
+ * @param (void*) (struct swiglu_train_args_fp16 void_args)
+ */
+void pulp_swiglu_fp16_fw_cache_cl(void* void_args);
+
+
+/**
+ * @brief Vectorized SwiGLU backward pass. Computes in1->diff = output->diff * in2 * sig * (1 + in1 * (1 - sig)) and
+ * in2->diff = output->diff * in1 * sig, with sig = sigmoid(in1) taken from args->sig if it is not NULL.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp16_bw_cl, &args) to parallelize.
+ * @param (void*) (struct swiglu_train_args_fp16 void_args)
+ */
+void pulp_swiglu_fp16_bw_cl(void* void_args);
+
+
+/**
+ * @brief Hard-Sigmoid forward pass function (vectorized), output = min(max(input / 6 + 0.5, 0), 1). Configure and pass a act_args_fp16 structure pointer as argument.
+ * @param input Input for hsigmoid.
+ * @param output Output of hsigmoid.
+*/
+void pulp_hsigmoid_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief Hard-Sigmoid backward pass function (vectorized). The derivative is computed from input->data.
+ * @param input Input for hsigmoid.
+ * @param output Output of hsigmoid.
+*/
+void pulp_hsigmoid_fp16_bw_cl( void * act_args );
+
+/**
+ * @brief Core function to implement the forward of Hard-Sigmoid (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hsigmoid_core_fw_fp16, &args)).
+ * @param act_args Input and output data (data only will be used)
+*/
+void hsigmoid_core_fw_fp16( void * act_args );
+
+/**
+ * @brief Core function to implement the backward of Hard-Sigmoid (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hsigmoid_core_bw_fp16, &args)).
+ * @param act_args Input data and gradients
+*/
+void hsigmoid_core_bw_fp16( void * act_args );
+
+
+/**
+ * @brief Hard-Swish forward pass function (vectorized), output = input * hsigmoid(input). Configure and pass a act_args_fp16 structure pointer as argument.
+ * @param input Input for hswish.
+ * @param output Output of hswish.
+*/
+void pulp_hswish_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief Hard-Swish backward pass function (vectorized). The derivative is computed from input->data.
+ * @param input Input for hswish.
+ * @param output Output of hswish.
+*/
+void pulp_hswish_fp16_bw_cl( void * act_args );
+
+/**
+ * @brief Core function to implement the forward of Hard-Swish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hswish_core_fw_fp16, &args)).
+ * @param act_args Input and output data (data only will be used)
+*/
+void hswish_core_fw_fp16( void * act_args );
+
+/**
+ * @brief Core function to implement the backward of Hard-Swish (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, hswish_core_bw_fp16, &args)).
+ * @param act_args Input data and gradients
+*/
+void hswish_core_bw_fp16( void * act_args );
+
+
+/**
+ * @brief SiLU forward pass function (vectorized), output = input * sigmoid(input). Configure and pass a act_args_fp16 structure pointer as argument.
+ * @param input Input for silu.
+ * @param output Output of silu.
+*/
+void pulp_silu_fp16_fw_cl( void * act_args );
+
+/**
+ * @brief SiLU backward pass function (vectorized). The derivative is computed from input->data.
+ * @param input Input for silu.
+ * @param output Output of silu.
+*/
+void pulp_silu_fp16_bw_cl( void * act_args );
+
+/**
+ * @brief Core function to implement the forward of SiLU (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_fw_fp16, &args)).
+ * @param act_args Input and output data (data only will be used)
+*/
+void silu_core_fw_fp16( void * act_args );
+
+/**
+ * @brief Core function to implement the backward of SiLU (allows parallelization, parallelize with pi_cl_team_fork(NUM_CORES, silu_core_bw_fp16, &args)).
+ * @param act_args Input data and gradients
+*/
+void silu_core_bw_fp16( void * act_args );
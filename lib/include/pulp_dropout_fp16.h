@@ -29,6 +29,7 @@
  * @param mask vector used for masking (requires use_mask==1, and same size of input vector)
  * @param size input/mask vector size
  * @param seed initial seed value
+ * @param bitmask 1-bit mask of ACT_MASK_WORDS(size) words, filled by pulp_dropout_mask_fp16_cl with the kept elements and consumed by pulp_dropout_mask_fp16_bw_cl (not used by pulp_dropout_fp16_cl)
  */
 struct dropout_args_fp16{
     fp16 probability;
@@ -37,6 +38,7 @@ struct dropout_args_fp16{
     fp16 * mask;
     int size;
     int seed;
+    uint32_t * bitmask;
 };
 
 
@@ -48,4 +50,18 @@ struct dropout_args_fp16{
 /**
  * @brief FP16 Dropout function
  */
- void pulp_dropout_fp16_cl(void * dropout_args);
\ No newline at end of file
+ void pulp_dropout_fp16_cl(void * dropout_args);
+
+
+/**
+ * @brief FP16 Dropout function which also packs the kept elements into a 1-bit mask (args->bitmask), so that the backward
+ * pass does not need a full-size mask. Use pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp16_cl, &args) to parallelize.
+ */
+void pulp_dropout_mask_fp16_cl(void * dropout_args);
+
+
+/**
+ * @brief FP16 Dropout backward function. Applies the 1-bit mask stored by pulp_dropout_mask_fp16_cl and the dropout scaling
+ * in place on args->input, which holds the output gradient. Use pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp16_bw_cl, &args) to parallelize.
+ */
+void pulp_dropout_mask_fp16_bw_cl(void * dropout_args);
@@ -19,6 +19,7 @@
 */ 
 
 #include <stdint.h>
+#include "pulp_train_defines.h"
 
 /**
  * @brief Structure for FP32 dropout
@@ -28,6 +29,7 @@
  * @param mask vector used for masking (requires use_mask==1, and same size of input vector)
  * @param size input/mask vector size
  * @param seed initial seed value
+ * @param bitmask 1-bit mask of ACT_MASK_WORDS(size) words, filled by pulp_dropout_mask_fp32_cl with the kept elements and consumed by pulp_dropout_mask_fp32_bw_cl (not used by pulp_dropout_fp32_cl)
  */
 struct dropout_args_fp32{
     float probability;
@@ -36,6 +38,7 @@ struct dropout_args_fp32{
     float * mask;
     int size;
     int seed;
+    uint32_t * bitmask;
 };
 
 
@@ -47,4 +50,18 @@ struct dropout_args_fp32{
 /**
  * @brief FP32 Dropout function
  */
- void pulp_dropout_fp32_cl(void * dropout_args);
\ No newline at end of file
+ void pulp_dropout_fp32_cl(void * dropout_args);
+
+
+/**
+ * @brief FP32 Dropout function which also packs the kept elements into a 1-bit mask (args->bitmask), so that the backward
+ * pass does not need a full-size mask. Use pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp32_cl, &args) to parallelize.
+ */
+void pulp_dropout_mask_fp32_cl(void * dropout_args);
+
+
+/**
+ * @brief FP32 Dropout backward function. Applies the 1-bit mask stored by pulp_dropout_mask_fp32_cl and the dropout scaling
+ * in place on args->input, which holds the output gradient. Use pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp32_bw_cl, &args) to parallelize.
+ */
+void pulp_dropout_mask_fp32_bw_cl(void * dropout_args);
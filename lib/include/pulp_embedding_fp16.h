@@ -19,6 +19,21 @@
  * Authors: Alberto Dequino
 */ 
 
+/**
+ * Embedding layer functions, grouped into FW and BW
+*/ 
+
+
+/**
+ * @brief Structure for the embedding forward in FP16. The table stays in L2 and only the rows indexed by ids are brought to L1.
+ * @param BUFF              L1 scratch buffer. embedding_fw_tiled_fp16 needs NUM_CORES * embed_dim elements, embedding_fw_tiled_fp16_dblbuffer needs NUM_CORES * 2 * rows_per_dma * embed_dim elements
+ * @param dim               Number of tokens
+ * @param embed_dim         Size of a row of the table
+ * @param ids               Token indices (dim)
+ * @param embeds            Embedding table in L2 (vocabulary x embed_dim)
+ * @param out               Output in L2 (dim x embed_dim)
+ * @param rows_per_dma      Number of token rows moved by each core per DMA batch (embedding_fw_tiled_fp16_dblbuffer only)
+ */
 struct Embedding_args_fp16{
     fp16* BUFF;
     int dim;
@@ -26,6 +41,114 @@ struct Embedding_args_fp16{
     int *ids;
     fp16 *embeds;
     fp16 *out;
+    int rows_per_dma;
+};
+
+
+/**
+ * @brief Structure for the sparse embedding backward in FP16. Only the rows of the table indexed by ids get a gradient: they are listed once in row_ids and their gradients are accumulated in row_diff.
+ * @param dim               Number of tokens
+ * @param embed_dim         Size of a row of the table
+ * @param ids               Token indices (dim)
+ * @param out_diff          Gradient of the output (dim x embed_dim)
+ * @param row_ids           Output: distinct rows touched by ids, in order of first appearance (up to dim)
+ * @param row_ptr           Scratch: start of the tokens of each distinct row in token_idx (dim + 1)
+ * @param token_idx         Scratch: tokens grouped by distinct row (dim)
+ * @param row_diff          Output: gradient of the distinct rows (n_rows x embed_dim, up to dim x embed_dim)
+ * @param n_rows            Output: number of distinct rows
+ */
+struct Embedding_bw_args_fp16{
+    int dim;
+    int embed_dim;
+    int *ids;
+    fp16 *out_diff;
+    int *row_ids;
+    int *row_ptr;
+    int *token_idx;
+    fp16 *row_diff;
+    int n_rows;
+};
+
+
+/**
+ * @brief Structure for the sparse update of the embedding table in FP16. Only the n_rows rows listed by the backward are read from L2, updated and written back.
+ * @param BUFF              L1 scratch buffer (NUM_CORES * 3 * embed_dim)
+ * @param grad              Sparse gradient computed by pulp_embedding_fp16_bw_cl
+ * @param embeds            Embedding table in L2 (vocabulary x embed_dim)
+ * @param m                 First moment of Adam in L2 (vocabulary x embed_dim), unused with EMBEDDING_SGD
+ * @param v                 Second moment of Adam in L2 (vocabulary x embed_dim), unused with EMBEDDING_SGD
+ * @param optimizer         EMBEDDING_SGD or EMBEDDING_ADAM
+ * @param learning_rate     Learning rate
+ * @param beta1             Decay of the first moment (Adam)
+ * @param beta2             Decay of the second moment (Adam)
+ * @param epsilon           Denominator offset (Adam)
+ * @param step              Index of the current step, starting from 1, used for the bias correction (Adam)
+ */
+struct Embedding_update_args_fp16{
+    fp16 *BUFF;
+    struct Embedding_bw_args_fp16 *grad;
+    fp16 *embeds;
+    fp16 *m;
+    fp16 *v;
+    int optimizer;
+    float learning_rate;
+    float beta1;
+    float beta2;
+    float epsilon;
+    int step;
+};
+
+
+/**
+ * @brief Arguments of the sparse update kernel in FP16 (internal)
+ * @param args              Sparse update configuration
+ * @param lr_t              Learning rate with the bias correction of Adam folded in
+ */
+struct embedding_update_core_args_fp16{
+    struct Embedding_update_args_fp16 *args;
+    float lr_t;
 };
 
-void embedding_fw_tiled_fp16(void *embedding_args);
\ No newline at end of file
+
+
+/**
+ * @brief Forward of the embedding, one row per core and per DMA. Use pi_cl_team_fork(NUM_CORES, embedding_fw_tiled_fp16, &args) to parallelize.
+ * @param embedding_args pointer to an Embedding_args_fp16 structure
+ */
+void embedding_fw_tiled_fp16(void *embedding_args);
+
+/**
+ * @brief Forward of the embedding with double buffering. Every core gathers rows_per_dma rows per batch (runs of consecutive ids are merged into one transfer) while the previous batch is stored to L2 with a single DMA. Use pi_cl_team_fork(NUM_CORES, embedding_fw_tiled_fp16_dblbuffer, &args) to parallelize.
+ * @param embedding_args pointer to an Embedding_args_fp16 structure
+ */
+void embedding_fw_tiled_fp16_dblbuffer(void *embedding_args);
+
+/**
+ * @brief Sparse backward of the embedding: groups the tokens by row of the table and scatter-adds out_diff into the gradient of the distinct rows. To be called from the cluster master, forks internally.
+ * @param embedding_bw_args pointer to an Embedding_bw_args_fp16 structure
+ */
+void pulp_embedding_fp16_bw_cl(void *embedding_bw_args);
+
+/**
+ * @brief Applies SGD or Adam to the rows of the table that received a gradient, leaving the rest of the table (and of the moments) untouched. To be called from the cluster master, forks internally.
+ * @param embedding_update_args pointer to an Embedding_update_args_fp16 structure
+ */
+void pulp_embedding_fp16_sparse_update_cl(void *embedding_update_args);
+
+
+
+/**
+ * Embedding kernels (internal)
+ */
+
+/**
+ * @brief Accumulates the gradients of the tokens of each distinct row. Use pi_cl_team_fork(NUM_CORES, embedding_bw_accumulate_fp16, &args) to parallelize.
+ * @param embedding_bw_args pointer to an Embedding_bw_args_fp16 structure
+ */
+void embedding_bw_accumulate_fp16(void *embedding_bw_args);
+
+/**
+ * @brief Updates the distinct rows, split among the cores. Use pi_cl_team_fork(NUM_CORES, embedding_sparse_update_fp16, &args) to parallelize.
+ * @param embedding_update_core_args pointer to an embedding_update_core_args_fp16 structure
+ */
+void embedding_sparse_update_fp16(void *embedding_update_core_args);
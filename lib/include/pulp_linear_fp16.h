@@ -35,6 +35,11 @@
  * @param opt_matmul_type_wg number of the optimizer matmul to be chosen by the mm_manager for the weight gradient primitive (see mm_manager_list.txt)
  * @param opt_matmul_type_ig number of the optimizer matmul to be chosen by the mm_manager for the input gradient primitive (see mm_manager_list.txt)
  * @param use_biases flag: use bias (1) or not use bias (0).
+ * @param lora_A  LoRA down-projection (lora_rank x input dim), trained in place of coeff when lora_rank > 0
+ * @param lora_B  LoRA up-projection (output dim x lora_rank), trained in place of coeff when lora_rank > 0
+ * @param lora_hidden  lora_scale * lora_A * input (lora_rank), stored by the forward; its diff holds the gradient of lora_A * input
+ * @param lora_rank  rank of the LoRA adapter, 0 disables it (coeff and bias are frozen otherwise)
+ * @param lora_scale  scaling of the adapter output (alpha / lora_rank)
  */
 struct Linear_args_fp16 {
 	struct blob_fp16 * input; 
@@ -47,6 +52,11 @@ struct Linear_args_fp16 {
 	int opt_matmul_type_wg;
 	int opt_matmul_type_ig;
 	int use_biases;
+	struct blob_fp16 * lora_A;
+	struct blob_fp16 * lora_B;
+	struct blob_fp16 * lora_hidden;
+	int lora_rank;
+	fp16 lora_scale;
 };
 
 
@@ -128,3 +138,21 @@ void pulp_linear_fp16_fw_cl_kernel( void * Linear_args );
  * @param opt_matmul_type_wg number of the optimizer matmul to be chosen by the mm_manager (see mm_manager_list.txt)
  */
 void pulp_linear_fp16_bw_param_grads_cl_kernel( void * Linear_args );
+
+/**
+ * @brief LoRA forward epilogue, forked on PULP cluster: lora_hidden = lora_scale * lora_A * input, then output += lora_B * lora_hidden. Called by pulp_linear_fp16_fw_cl when lora_rank > 0.
+ * @param Linear_args pointer to a Linear_args_fp16 structure
+ */
+void pulp_linear_fp16_lora_fw_cl_kernel( void * Linear_args );
+
+/**
+ * @brief LoRA parameter gradients, forked on PULP cluster: lora_B->diff = outDiff * lora_hidden^T and lora_A->diff = lora_hidden->diff * input^T. Called by pulp_linear_fp16_bw_param_grads_cl instead of the weight gradient when lora_rank > 0.
+ * @param Linear_args pointer to a Linear_args_fp16 structure
+ */
+void pulp_linear_fp16_lora_bw_param_grads_cl_kernel( void * Linear_args );
+
+/**
+ * @brief LoRA input gradient, forked on PULP cluster: inDiff += lora_A^T * lora_hidden->diff. Called by pulp_linear_fp16_bw_input_grads_cl when lora_rank > 0.
+ * @param Linear_args pointer to a Linear_args_fp16 structure
+ */
+void pulp_linear_fp16_lora_bw_input_grads_cl_kernel( void * Linear_args );
@@ -42,6 +42,16 @@ void mm_M_fp16(
         void *void_args
 );
 
+/**
+ * @brief Naive matrix multiply algorithm with elementwise epilogue, performing C=(A*B).*scale (C and scale are N*M, A is N*K, B is K*M).
+ * Parallelizes on the N*M output elements, so that it is balanced also for N=1 (e.g. linear layers).
+ * Used to fuse activation backward passes (e.g. GELU, with the scale stored by the forward pass) into the input gradient of the following layer.
+ * @param void_args pointer to a mm_epilogue_args_fp16 structure (please refer to this to setup the args)
+ */
+void mm_mul_epilogue_fp16(
+        void *void_args
+);
+
 
 /**
  * Optimized versions
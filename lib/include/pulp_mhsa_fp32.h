@@ -46,6 +46,21 @@
  * @param temp_buffer       Support buffer used to save transposed matrices
  * @param grad              Support buffer used when calculating gradients for each computational head during MHSA backprop
  * @param head_buffer       Attention scores for every head
+ * @param lse               Row-wise log-sum-exp of the attention scores (n_heads x L, FP32), only used by the flash attention forward/backward
+ * @param n_kv_heads        Number of key/value heads (divides n_heads, 1 for multi-query attention), only used by the grouped-query attention forward/backward
+ * @param rope_cos          If not NULL, RoPE cos table (H/2 x L) fused into the Q/K projections of the grouped-query attention forward/backward, see pulp_rope_fp32.h
+ * @param rope_sin          RoPE sin table (H/2 x L)
+ * @param coeff_in_qkv      If not NULL, fused input projection weights Wq | Wk | Wv (3F x E), used instead of coeff_in_q/k/v by pulp_mhsa_fp32_fw_cl / pulp_mhsa_fp32_bw_cl. q->data (and q->diff) then hold Q, K and V as one 3F x L matrix, k and v are not read
+ * @param bias_in_qkv       Fused input projection biases bq | bk | bv (3F), may be NULL
+ * @param lora_A_qkv        LoRA down-projection of the fused input projection (lora_rank x E), trained in place of coeff_in_qkv when lora_rank > 0
+ * @param lora_B_qkv        LoRA up-projection of the fused input projection (3F x lora_rank)
+ * @param lora_hidden_qkv   lora_scale * lora_A_qkv @ input (lora_rank x L), stored by the forward; its diff holds the gradient of lora_A_qkv @ input
+ * @param lora_rank         Rank of the LoRA adapter on the fused QKV projection, 0 disables it
+ * @param lora_scale        Scaling of the adapter output (alpha / lora_rank)
+ * @param mask_type         Attention mask (MHSA_MASK_NONE, MHSA_MASK_CAUSAL, MHSA_MASK_SLIDING_WINDOW or MHSA_MASK_BLOCK_SPARSE), applied by the flash attention, tiled flash attention and grouped-query attention forward/backward, which skip the fully masked tiles
+ * @param mask_window       Number of keys seen by each query (itself included) with MHSA_MASK_SLIDING_WINDOW
+ * @param mask_block        Block size of MHSA_MASK_BLOCK_SPARSE
+ * @param mask_layout       Block layout of MHSA_MASK_BLOCK_SPARSE (ceil(L / mask_block) x ceil(L / mask_block), query blocks on the rows), nonzero if the block is computed
  * 
  */
 
@@ -80,6 +95,21 @@ struct Mhsa_args {
     float *partial_exp_sum;
     float *maxes;
     float *sums;
+    float *lse;
+    int n_kv_heads;
+    float *rope_cos;
+    float *rope_sin;
+    struct blob *coeff_in_qkv;
+    struct blob *bias_in_qkv;
+    struct blob *lora_A_qkv;
+    struct blob *lora_B_qkv;
+    struct blob *lora_hidden_qkv;
+    int lora_rank;
+    float lora_scale;
+    int mask_type;
+    int mask_window;
+    int mask_block;
+    unsigned char *mask_layout;
 };
 
 
@@ -110,6 +140,212 @@ struct Tiled_Matmul_Mhsa_args{
 };
 
 
+/**
+ * @brief Structure for the fused (FlashAttention-style) attention tile kernel in FP32. Each core owns a subset of the query rows of the tile.
+ * @param q                 Query tile in L1 (H x Br, column r holds query r)
+ * @param k                 Key tile in L1 (H x Bc)
+ * @param v                 Value tile in L1 (H x Bc)
+ * @param out               Output accumulator in L1 (H x Br), normalized when last is set
+ * @param scores            Support buffer for the scores of the row being processed (NUM_CORES x Bc)
+ * @param m                 Running row-wise maxes (Br)
+ * @param l                 Running row-wise exponential sums (Br)
+ * @param H                 Head dimension
+ * @param Br                Number of queries in the tile
+ * @param Bc                Number of keys in the tile
+ * @param scaling           Attention scaling factor (1/sqrt(H))
+ * @param first             If 1, the tile is the first key tile of the row block (resets m, l and out)
+ * @param last              If 1, the tile is the last key tile of the row block (normalizes out by l)
+ * @param lse               If not NULL, the row-wise log-sum-exp (m + log(l)) is written here on the last key tile (Br, FP32)
+ * @param mask_type         Attention mask, see Mhsa_args. Only read when mask_tile is MHSA_TILE_PARTIAL
+ * @param mask_window       Sliding window of MHSA_MASK_SLIDING_WINDOW
+ * @param mask_block        Block size of MHSA_MASK_BLOCK_SPARSE
+ * @param mask_layout       Block layout of MHSA_MASK_BLOCK_SPARSE
+ * @param L                 Sequence length, used to index mask_layout
+ * @param row0              Index of the first query of the tile in the sequence
+ * @param col0              Index of the first key of the tile in the sequence
+ * @param mask_tile         MHSA_TILE_FULL if no score of the tile is masked (no checks), MHSA_TILE_PARTIAL to mask the scores one by one
+ */
+struct flash_attn_args {
+    float *q;
+    float *k;
+    float *v;
+    float *out;
+    float *scores;
+    float *m;
+    float *l;
+    int H;
+    int Br;
+    int Bc;
+    float scaling;
+    int first;
+    int last;
+    float *lse;
+    int mask_type;
+    int mask_window;
+    int mask_block;
+    unsigned char *mask_layout;
+    int L;
+    int row0;
+    int col0;
+    int mask_tile;
+};
+
+
+/**
+ * @brief Structure for the recomputing (flash attention) backward kernels of a single head in FP32. Matrices are stored H x L, as in the MHSA buffers.
+ * @param q                 Query of the head
+ * @param k                 Key of the head
+ * @param v                 Value of the head
+ * @param out               Attention output of the head (attention_map)
+ * @param out_diff          Gradient of the attention output of the head (attention_map diff)
+ * @param q_diff            Gradient of the query (output)
+ * @param k_diff            Gradient of the key (output)
+ * @param v_diff            Gradient of the value (output)
+ * @param lse               Row-wise log-sum-exp saved by the forward pass (L, FP32)
+ * @param delta             Support buffer of the row-wise dot products between out and out_diff (L, FP32)
+ * @param H                 Head dimension
+ * @param L                 Sequence length
+ * @param scaling           Attention scaling factor (1/sqrt(H))
+ * @param accumulate        If 1, k_diff and v_diff are accumulated instead of overwritten (query heads sharing a key/value head)
+ * @param mask_type         Attention mask, see Mhsa_args. The masked scores are neither recomputed nor accumulated
+ * @param mask_window       Sliding window of MHSA_MASK_SLIDING_WINDOW
+ * @param mask_block        Block size of MHSA_MASK_BLOCK_SPARSE
+ * @param mask_layout       Block layout of MHSA_MASK_BLOCK_SPARSE
+ */
+struct flash_attn_bw_args {
+    float *q;
+    float *k;
+    float *v;
+    float *out;
+    float *out_diff;
+    float *q_diff;
+    float *k_diff;
+    float *v_diff;
+    float *lse;
+    float *delta;
+    int H;
+    int L;
+    float scaling;
+    int accumulate;
+    int mask_type;
+    int mask_window;
+    int mask_block;
+    unsigned char *mask_layout;
+};
+
+
+/**
+ * @brief Structure for incremental (autoregressive) decoding with a KV cache in FP32. K and V of the new tokens are appended to the cache and only the new query rows are computed.
+ * @param input             New tokens (T x E, usually T = 1)
+ * @param n_heads           Number of heads the attention operation is divided.
+ * @param output            Output of the new tokens (T x E)
+ * @param coeff_in_q        Weight for input projection for query (F x E)
+ * @param coeff_in_k        Weight for input projection for key (F x E)
+ * @param coeff_in_v        Weight for input projection for value (F x E)
+ * @param bias_in_q         Bias for input projection for query
+ * @param bias_in_k         Bias for input projection for key
+ * @param bias_in_v         Bias for input projection for value
+ * @param coeff_out         Weight for output projection (E x F)
+ * @param bias_out          Bias for output projection
+ * @param k_cache           Key cache (max_len x F, one row per token), in L1 or L2
+ * @param v_cache           Value cache (max_len x F, one row per token), in L1 or L2
+ * @param cache_len         Number of tokens already in the cache, advanced by T on every call
+ * @param max_len           Capacity of the cache in tokens
+ * @param q                 Queries of the new tokens (T x F)
+ * @param kv_new            Staging buffer for K and V of the new tokens (2 x T x F), only used when BUFF is not NULL
+ * @param attention_map     Attention output of the new tokens, pre-projection (T x F)
+ * @param temp_buffer       Support buffer of at least 2 + (H + 3) * NUM_CORES elements
+ * @param BUFF              L1 buffer for the cache tiles (4 * H * tile_len elements, K/V tiles are double buffered). If NULL, the cache is read in place.
+ * @param tile_len          Number of cached tokens per tile, only used when BUFF is not NULL
+ * @param cmd_store         DMA command used to append K and V to the cache
+ */
+struct Mhsa_kv_cache_args {
+    struct blob *input;
+    int n_heads;
+    struct blob *output;
+
+    struct blob *coeff_in_q;
+    struct blob *coeff_in_k;
+    struct blob *coeff_in_v;
+
+    struct blob *bias_in_q;
+    struct blob *bias_in_k;
+    struct blob *bias_in_v;
+
+    struct blob *coeff_out;
+    struct blob *bias_out;
+
+    float *k_cache;
+    float *v_cache;
+    int cache_len;
+    int max_len;
+
+    float *q;
+    float *kv_new;
+    float *attention_map;
+    float *temp_buffer;
+    float *BUFF;
+    int tile_len;
+    pi_cl_dma_cmd_t * cmd_store;
+};
+
+
+/**
+ * @brief Structure for the projections of the new tokens during KV-cache decoding in FP32 (out = in Wt + bias, parallel over the output features).
+ * @param in                Input rows (T x in_dim)
+ * @param W                 Weights (out_dim x in_dim)
+ * @param bias              Bias (out_dim)
+ * @param out               Output rows (T x out_dim)
+ * @param T                 Number of rows
+ * @param in_dim            Input features
+ * @param out_dim           Output features
+ */
+struct kv_cache_proj_args {
+    float *in;
+    float *W;
+    float *bias;
+    float *out;
+    int T;
+    int in_dim;
+    int out_dim;
+};
+
+
+/**
+ * @brief Structure for the KV-cache attention kernels in FP32: the keys of a cache tile are split among the cores, each core keeps its own softmax statistics which are then merged.
+ * @param q                 Query of the head (H)
+ * @param k                 Keys of the tile (n_keys rows, leading dimension ld)
+ * @param v                 Values of the tile (n_keys rows, leading dimension ld)
+ * @param ld                Distance between two cached tokens (H for L1 tiles, F for the cache in place)
+ * @param n_keys            Number of keys in the tile
+ * @param H                 Head dimension
+ * @param scaling           Attention scaling factor (1/sqrt(H))
+ * @param m_part            Per-core maxes (NUM_CORES)
+ * @param l_part            Per-core exponential sums (NUM_CORES)
+ * @param o_part            Per-core unnormalized outputs (NUM_CORES x H)
+ * @param w                 Per-core merge weights (NUM_CORES)
+ * @param corr              Merge weight of the running output
+ * @param out               Output of the head (H)
+ * @param first             If 1, out is overwritten instead of being accumulated
+ */
+struct kv_cache_attn_args {
+    float *q;
+    float *k;
+    float *v;
+    int ld;
+    int n_keys;
+    int H;
+    float scaling;
+    float *m_part;
+    float *l_part;
+    float *o_part;
+    float *w;
+    float corr;
+    float *out;
+    int first;
+};
+
+
 /**
  * MHSA layer training functions, grouped into FW and BW
  */
@@ -130,6 +366,15 @@ void pulp_mhsa_fp32_fw_cl(void * Mhsa_args);
 void pulp_mhsa_fp32_fw_cl_2(void * Mhsa_args);
 
 
+/**
+ * @brief Attention forward (softmax(Qt K * scaling) V, all heads) that does not store the L x L attention matrices, to be paired with pulp_mhsa_fp32_flash_attn_bw_cl.
+ * Reads q, k, v and writes attention_map and the row-wise log-sum-exp into lse (n_heads x L). temp_buffer must hold (2 + NUM_CORES) * L elements.
+ * The Q/K/V and output projections are left to the caller.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_fp32_flash_attn_fw_cl(void * Mhsa_args);
+
+
 // BACKWARD FUNCTIONS
 
 /**
@@ -139,6 +384,90 @@ void pulp_mhsa_fp32_fw_cl_2(void * Mhsa_args);
 void pulp_mhsa_fp32_bw_cl(void * Mhsa_args);
 
 
+/**
+ * @brief Fused Q, K and V projection: a single matmul of coeff_in_qkv (3F x E) with the input (E x L) into q->data (3F x L), with the bias_in_qkv addition done in the same fork as an epilogue.
+ * If lora_rank > 0, lora_B_qkv @ (lora_scale * lora_A_qkv @ input) is accumulated on top (temp_buffer must hold 3F * L elements).
+ * Called by pulp_mhsa_fp32_fw_cl when coeff_in_qkv is not NULL.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_fp32_qkv_fw_cl(void * Mhsa_args);
+
+/**
+ * @brief Backward of pulp_mhsa_fp32_qkv_fw_cl: coeff_in_qkv->diff = q->diff @ input^T in a single matmul, and coeff_in_qkv^T @ q->diff is accumulated into input->diff.
+ * If lora_rank > 0, coeff_in_qkv is frozen: its gradient is skipped and lora_A_qkv->diff / lora_B_qkv->diff are computed instead, the input gradient also flows through the adapter.
+ * temp_buffer must hold 3F * E + E * L elements. Called by pulp_mhsa_fp32_bw_cl when coeff_in_qkv is not NULL.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_fp32_qkv_bw_cl(void * Mhsa_args);
+
+
+/**
+ * @brief Attention backward that recomputes the attention scores from q, k and the saved lse (FlashAttention-2 style) instead of reading a stored softmax_buffer.
+ * Reads q, k, v, attention_map (data and diff) and lse and writes q->diff, k->diff and v->diff. temp_buffer must hold L elements.
+ * The attention memory is O(L) per head instead of O(L^2).
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_fp32_flash_attn_bw_cl(void * Mhsa_args);
+
+/**
+ * @brief Computes delta = rowsum(out_diff .* out) for one head. Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp32, &args).
+ * @param flash_attn_bw_args pointer to a flash_attn_bw_args structure
+ */
+void mhsa_flash_attn_bw_delta_fp32(void * flash_attn_bw_args);
+
+/**
+ * @brief Computes k_diff and v_diff of one head, recomputing the attention probabilities column by column (parallel over keys). Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp32, &args).
+ * @param flash_attn_bw_args pointer to a flash_attn_bw_args structure
+ */
+void mhsa_flash_attn_bw_kv_fp32(void * flash_attn_bw_args);
+
+/**
+ * @brief Computes q_diff of one head, recomputing the attention probabilities row by row (parallel over queries). Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp32, &args).
+ * @param flash_attn_bw_args pointer to a flash_attn_bw_args structure
+ */
+void mhsa_flash_attn_bw_q_fp32(void * flash_attn_bw_args);
+
+/**
+ * @brief Incremental decoding step: projects the new tokens, appends their K and V to the cache and attends the new queries over the whole cache (causal among the new tokens).
+ * If BUFF is not NULL the cache is streamed from L2 in tiles of tile_len tokens, otherwise it is accessed in place. cache_len is advanced by the number of new tokens.
+ * @param Mhsa_kv_cache_args pointer to a Mhsa_kv_cache_args structure
+ */
+void pulp_mhsa_kv_cache_fp32_fw_cl(void * Mhsa_kv_cache_args);
+
+/**
+ * @brief Projection of the new tokens (parallel over the output features). Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp32, &args).
+ * @param kv_cache_proj_args pointer to a kv_cache_proj_args structure
+ */
+void mhsa_kv_cache_proj_fp32(void * kv_cache_proj_args);
+
+/**
+ * @brief Partial attention of one query over a cache tile, each core processes a slice of the keys. Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_attn_fp32, &args).
+ * @param kv_cache_attn_args pointer to a kv_cache_attn_args structure
+ */
+void mhsa_kv_cache_attn_fp32(void * kv_cache_attn_args);
+
+/**
+ * @brief Merges the per-core partial outputs into the output of the head (parallel over the head dimension). Parallelize with pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_merge_fp32, &args).
+ * @param kv_cache_attn_args pointer to a kv_cache_attn_args structure
+ */
+void mhsa_kv_cache_merge_fp32(void * kv_cache_attn_args);
+
+/**
+ * @brief Forward pass of grouped-query attention (n_kv_heads < n_heads, multi-query attention if n_kv_heads = 1). Query head i reads key/value head i / (n_heads / n_kv_heads) in place.
+ * coeff_in_k / coeff_in_v are (n_kv_heads * H) x E and k / v are (n_kv_heads * H) x L. input and output are L x E, attention uses the fused kernel and saves lse for the backward pass if lse is not NULL.
+ * temp_buffer must hold at least max((NUM_CORES + 2) * L, E * L) elements.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_gqa_fp32_fw_cl(void * Mhsa_args);
+
+/**
+ * @brief Backward pass of grouped-query attention: gradients of the query heads sharing a key/value head are accumulated into its k / v diff. Requires the lse saved by pulp_mhsa_gqa_fp32_fw_cl.
+ * Computes the weight gradients (no bias gradients, as in pulp_mhsa_fp32_bw_cl) and the input gradient. temp_buffer must hold at least L * (F + E) elements.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ */
+void pulp_mhsa_gqa_fp32_bw_cl(void * Mhsa_args);
+
+
 // INFERENCE FUNCTIONS
 /**
  * @brief Inference function for the mobilebert encoder layer, modified version of the forward function
@@ -153,4 +482,19 @@ void tiled_mhsa_fp32(void* Mhsa_args, void* tiled_matmul_mhsa_args);
 
 void tiled_matmul_mhsa(void* matmul_args, void* tiled_matmul_mhsa_args, int projection);
 
-void tiled_transpose_mhsa(void* transpose_args, void* Tiled_matmul_mhsa_args, int projection);
\ No newline at end of file
+void tiled_transpose_mhsa(void* transpose_args, void* Tiled_matmul_mhsa_args, int projection);
+
+/**
+ * @brief Tiled forward inference with fused attention: Q, K and V tiles are DMA-ed from L2 and softmax(Q Kt) V is accumulated with an online softmax, so the L x L attention matrix is never stored.
+ * tile_h_sm / tile_w_sm of the tiling descriptors select the query / key tile sizes (Br, Bc), L has to be a multiple of both.
+ * BUFF must hold at least 2*Br + 2*H*Br + NUM_CORES*Bc + 4*H*Bc elements (K/V tiles are double buffered). softmax_buffer, maxes and sums are not used.
+ * @param Mhsa_args structure configuring the MHSA layer.
+ * @param tiled_matmul_mhsa_args tiling descriptors
+ */
+void tiled_mhsa_flash_attn_fp32(void* Mhsa_args, void* tiled_matmul_mhsa_args);
+
+/**
+ * @brief Fused attention step on one (query tile, key tile) pair, parallelize with pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp32, &args).
+ * @param flash_attn_args pointer to a flash_attn_args structure
+ */
+void mhsa_flash_attn_tile_fp32(void* flash_attn_args);
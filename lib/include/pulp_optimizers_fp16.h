@@ -30,12 +30,142 @@
  * @param bias blob of the biases (with their gradient inside)
  * @param learning_rate the learning rate of the optimizer
  * @param use_biases flag: use bias (1) or not use bias (0).
+ * @param momentum momentum factor (pulp_sgd_momentum only)
+ * @param nesterov flag: use Nesterov momentum (1) or classical momentum (0) (pulp_sgd_momentum only)
+ * @param weight_decay weight decay factor (pulp_sgd_momentum only)
+ * @param decoupled_weight_decay flag: decay the weights directly, w -= lr * weight_decay * w (1), or add weight_decay * w to the gradient as an L2 penalty (0) (pulp_sgd_momentum only)
+ * @param velocity_weights velocity buffer of the weights, zero before the first step (pulp_sgd_momentum only)
+ * @param velocity_biases velocity buffer of the biases, zero before the first step (pulp_sgd_momentum only)
+ * @param rounding rounding of the updated parameters, FP16_ROUND_NEAREST or FP16_ROUND_STOCHASTIC (see pulp_train_defines.h). With stochastic rounding the
+ * update is computed in FP32 and updates smaller than half an ulp of the weights are applied on average instead of being lost
+ * @param seed seed of the stochastic rounding, to be changed at every step (e.g. the step counter)
  */
 struct optim_args_fp16 {
   struct blob_fp16 * weights;
   struct blob_fp16 * biases;
   fp16 learning_rate;
   int use_biases;
+  fp16 momentum;
+  int nesterov;
+  fp16 weight_decay;
+  int decoupled_weight_decay;
+  fp16 * velocity_weights;
+  fp16 * velocity_biases;
+  int rounding;
+  unsigned int seed;
+};
+
+
+
+/**
+ * @brief Structure for the Adam / AdamW optimizer. The moment buffers have the size of the corresponding parameters and are zero before the first step.
+ * Weight decay is decoupled (AdamW): w -= lr * weight_decay * w, Adam being weight_decay = 0. The moments are stored in FP16, the update is computed in FP32
+ * (beta2 and eps are not representable in every FP16 format).
+ * @param weights blob of the weights (with their gradient inside)
+ * @param biases blob of the biases (with their gradient inside)
+ * @param m_weights first moment of the weights
+ * @param v_weights second moment of the weights
+ * @param m_biases first moment of the biases
+ * @param v_biases second moment of the biases
+ * @param learning_rate the learning rate of the optimizer
+ * @param beta1 decay rate of the first moment
+ * @param beta2 decay rate of the second moment
+ * @param eps term added to the denominator
+ * @param weight_decay decoupled weight decay
+ * @param step index of the current step (starting from 1), for the bias correction. To be incremented by the caller.
+ * @param use_biases flag: use bias (1) or not use bias (0).
+ * @param rounding rounding of the updated parameters, FP16_ROUND_NEAREST or FP16_ROUND_STOCHASTIC (see pulp_train_defines.h)
+ * @param seed seed of the stochastic rounding, combined with step so that it can stay constant
+ */
+struct adam_args_fp16 {
+  struct blob_fp16 * weights;
+  struct blob_fp16 * biases;
+  fp16 * m_weights;
+  fp16 * v_weights;
+  fp16 * m_biases;
+  fp16 * v_biases;
+  float learning_rate;
+  float beta1;
+  float beta2;
+  float eps;
+  float weight_decay;
+  int step;
+  int use_biases;
+  int rounding;
+  unsigned int seed;
+};
+
+
+
+/**
+ * @brief Structure for the multi-tensor optimizer step, which updates the weights and biases of all the layers in a single fork.
+ * The tensors are flattened into one global index space that is split into balanced chunks among the cores.
+ * @param optimizer OPTIM_SGD, OPTIM_SGD_MOMENTUM or OPTIM_ADAM (see pulp_train_defines.h)
+ * @param n_layers number of layers
+ * @param layers array of n_layers optim_args_fp16 structures (OPTIM_SGD, OPTIM_SGD_MOMENTUM)
+ * @param adam_layers array of n_layers adam_args_fp16 structures (OPTIM_ADAM)
+ * @param max_grad_norm if > 0, the gradients are clipped to this global L2 norm (over all the tensors of the list) before the update, as torch.nn.utils.clip_grad_norm_
+ * @param partial_sums support buffer of the parallel reduction of the norm (NUM_CORES elements), used if max_grad_norm > 0
+ * @param grad_norm global L2 norm of the gradients before clipping, written if max_grad_norm > 0
+ */
+struct optim_multi_args_fp16 {
+  int optimizer;
+  int n_layers;
+  struct optim_args_fp16 * layers;
+  struct adam_args_fp16 * adam_layers;
+  float max_grad_norm;
+  float * partial_sums;
+  float grad_norm;
+};
+
+
+/**
+ * @brief Structure for the global norm gradient clipping.
+ * @param blobs array of n_blobs blobs, whose gradients (diff) are clipped
+ * @param n_blobs number of blobs
+ * @param max_norm maximum global L2 norm of the gradients
+ * @param partial_sums support buffer of the parallel reduction of the norm (NUM_CORES elements)
+ * @param norm global L2 norm of the gradients before clipping, written by the function
+ */
+struct clip_grad_norm_args_fp16 {
+  struct blob_fp16 ** blobs;
+  int n_blobs;
+  float max_norm;
+  float * partial_sums;
+  float norm;
+};
+
+
+/**
+ * @brief Structure for mixed precision training: forward and backward passes in FP16, FP32 master copies of the parameters updated by the
+ * optimizer, dynamic loss scaling. Before the backward pass, the gradient of the loss is multiplied by loss_scale (e.g. with pulp_scalar_mul_fp16_cl).
+ * The master blobs are initialized once from the FP16 parameters with cast_fp16_tensor_to_fp32.
+ * @param params array of n_tensors FP16 parameters (data: weights used by forward and backward, diff: gradients of the scaled loss)
+ * @param master array of n_tensors FP32 master copies of params, with the same dim (data: master weights, diff: unscaled gradients, written by the step)
+ * @param n_tensors number of tensors
+ * @param optimizer FP32 multi-tensor optimizer step whose layers point to the master blobs (gradient clipping, if enabled, sees the unscaled gradients)
+ * @param partial_sums support buffer of the parallel overflow check (NUM_CORES elements)
+ * @param loss_scale current scale of the loss, updated by the step
+ * @param growth_factor factor applied to loss_scale after growth_interval consecutive steps without overflow (e.g. 2)
+ * @param backoff_factor factor applied to loss_scale when the gradients overflow (e.g. 0.5)
+ * @param growth_interval number of consecutive steps without overflow after which loss_scale grows
+ * @param good_steps consecutive steps without overflow since the last change of loss_scale, updated by the step
+ * @param skipped_steps total number of steps skipped because of an overflow, updated by the step
+ * @param found_inf 1 if the gradients of the last step contained an inf or a nan (and the update was skipped), 0 otherwise
+ */
+struct mixed_precision_args_fp16 {
+  struct blob_fp16 ** params;
+  struct blob ** master;
+  int n_tensors;
+  struct optim_multi_args * optimizer;
+  float * partial_sums;
+  float loss_scale;
+  float growth_factor;
+  float backoff_factor;
+  int growth_interval;
+  int good_steps;
+  int skipped_steps;
+  int found_inf;
 };
 
 
@@ -51,3 +181,68 @@ struct optim_args_fp16 {
 void pulp_gradient_descent_fp16(
     void * optim_args
 );
+
+/**
+ * @brief SGD with momentum (classical or Nesterov) and weight decay (L2 or decoupled) for a single layer, same semantics of torch.optim.SGD with dampening = 0.
+ * Parameter, gradient and velocity of each tensor are updated in a single fused pass. Use pi_cl_team_fork(NUM_CORES, pulp_sgd_momentum_fp16, &args) to parallelize.
+ * @param optim_args_fp16 pointer to optim_args_fp16 structure
+ */
+void pulp_sgd_momentum_fp16(
+    void * optim_args_fp16
+);
+
+/**
+ * @brief Adam / AdamW optimizer for a single layer, with bias correction. Parameter, gradient and moments of each tensor are updated in a single fused pass.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_adam_fp16, &args) to parallelize.
+ * @param adam_args_fp16 pointer to adam_args_fp16 structure
+ */
+void pulp_adam_fp16(
+    void * adam_args_fp16
+);
+
+/**
+ * @brief Multi-tensor optimizer step: updates all the layers of the list with the selected optimizer in a single fork, with the same result of
+ * the single layer optimizers when rounding to nearest without clipping (the clipping scale is kept in FP32 instead of rounding the gradients). Use pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp16, &args) to parallelize.
+ * @param optim_multi_args_fp16 pointer to optim_multi_args_fp16 structure
+ */
+void pulp_optimizer_multi_fp16(
+    void * optim_multi_args_fp16
+);
+
+/**
+ * @brief Global L2 norm gradient clipping over a list of blobs: the squared gradients are summed on balanced per-core chunks and reduced with a
+ * tree over the cores, then the gradients are scaled in place if their norm exceeds max_norm. To clip right before the update, prefer the
+ * max_grad_norm option of pulp_optimizer_multi_fp16, which applies the scale inside the update instead of rewriting the gradients.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_clip_grad_norm_fp16, &args) to parallelize.
+ * @param clip_grad_norm_args_fp16 pointer to clip_grad_norm_args_fp16 structure
+ */
+void pulp_clip_grad_norm_fp16(
+    void * clip_grad_norm_args_fp16
+);
+
+/**
+ * @brief Mixed precision step: unscales the FP16 gradients into the FP32 master gradients while checking them for inf and nan, then either skips
+ * the update and backs off the loss scale (overflow), or runs the FP32 optimizer on the master weights, casts them back into the FP16 parameters
+ * and grows the loss scale every growth_interval good steps. To be called from the cluster master, forks internally.
+ * @param mixed_precision_args_fp16 pointer to mixed_precision_args_fp16 structure
+ */
+void pulp_mixed_precision_step_fp16(
+    void * mixed_precision_args_fp16
+);
+
+/**
+ * @brief Unscales the FP16 gradients of the parameters into the diff of the master blobs and sets found_inf if any of them is inf or nan.
+ * Use pi_cl_team_fork(NUM_CORES, mixed_precision_unscale_fp16, &args) to parallelize.
+ * @param mixed_precision_args_fp16 pointer to mixed_precision_args_fp16 structure
+ */
+void mixed_precision_unscale_fp16(
+    void * mixed_precision_args_fp16
+);
+
+/**
+ * @brief Casts the FP32 master weights into the FP16 parameters. Use pi_cl_team_fork(NUM_CORES, mixed_precision_update_params_fp16, &args) to parallelize.
+ * @param mixed_precision_args_fp16 pointer to mixed_precision_args_fp16 structure
+ */
+void mixed_precision_update_params_fp16(
+    void * mixed_precision_args_fp16
+);
@@ -29,12 +29,99 @@
  * @param bias blob of the biases (with their gradient inside)
  * @param learning_rate the learning rate of the optimizer
  * @param use_biases flag: use bias (1) or not use bias (0).
+ * @param momentum momentum factor (pulp_sgd_momentum only)
+ * @param nesterov flag: use Nesterov momentum (1) or classical momentum (0) (pulp_sgd_momentum only)
+ * @param weight_decay weight decay factor (pulp_sgd_momentum only)
+ * @param decoupled_weight_decay flag: decay the weights directly, w -= lr * weight_decay * w (1), or add weight_decay * w to the gradient as an L2 penalty (0) (pulp_sgd_momentum only)
+ * @param velocity_weights velocity buffer of the weights, zero before the first step (pulp_sgd_momentum only)
+ * @param velocity_biases velocity buffer of the biases, zero before the first step (pulp_sgd_momentum only)
  */
 struct optim_args {
   struct blob * weights;
   struct blob * biases;
   float learning_rate;
   int use_biases;
+  float momentum;
+  int nesterov;
+  float weight_decay;
+  int decoupled_weight_decay;
+  float * velocity_weights;
+  float * velocity_biases;
+};
+
+
+
+/**
+ * @brief Structure for the Adam / AdamW optimizer. The moment buffers have the size of the corresponding parameters and are zero before the first step.
+ * Weight decay is decoupled (AdamW): w -= lr * weight_decay * w, Adam being weight_decay = 0.
+ * @param weights blob of the weights (with their gradient inside)
+ * @param biases blob of the biases (with their gradient inside)
+ * @param m_weights first moment of the weights
+ * @param v_weights second moment of the weights
+ * @param m_biases first moment of the biases
+ * @param v_biases second moment of the biases
+ * @param learning_rate the learning rate of the optimizer
+ * @param beta1 decay rate of the first moment
+ * @param beta2 decay rate of the second moment
+ * @param eps term added to the denominator
+ * @param weight_decay decoupled weight decay
+ * @param step index of the current step (starting from 1), for the bias correction. To be incremented by the caller.
+ * @param use_biases flag: use bias (1) or not use bias (0).
+ */
+struct adam_args {
+  struct blob * weights;
+  struct blob * biases;
+  float * m_weights;
+  float * v_weights;
+  float * m_biases;
+  float * v_biases;
+  float learning_rate;
+  float beta1;
+  float beta2;
+  float eps;
+  float weight_decay;
+  int step;
+  int use_biases;
+};
+
+
+
+/**
+ * @brief Structure for the multi-tensor optimizer step, which updates the weights and biases of all the layers in a single fork.
+ * The tensors are flattened into one global index space that is split into balanced chunks among the cores.
+ * @param optimizer OPTIM_SGD, OPTIM_SGD_MOMENTUM or OPTIM_ADAM (see pulp_train_defines.h)
+ * @param n_layers number of layers
+ * @param layers array of n_layers optim_args structures (OPTIM_SGD, OPTIM_SGD_MOMENTUM)
+ * @param adam_layers array of n_layers adam_args structures (OPTIM_ADAM)
+ * @param max_grad_norm if > 0, the gradients are clipped to this global L2 norm (over all the tensors of the list) before the update, as torch.nn.utils.clip_grad_norm_
+ * @param partial_sums support buffer of the parallel reduction of the norm (NUM_CORES elements), used if max_grad_norm > 0
+ * @param grad_norm global L2 norm of the gradients before clipping, written if max_grad_norm > 0
+ */
+struct optim_multi_args {
+  int optimizer;
+  int n_layers;
+  struct optim_args * layers;
+  struct adam_args * adam_layers;
+  float max_grad_norm;
+  float * partial_sums;
+  float grad_norm;
+};
+
+
+/**
+ * @brief Structure for the global norm gradient clipping.
+ * @param blobs array of n_blobs blobs, whose gradients (diff) are clipped
+ * @param n_blobs number of blobs
+ * @param max_norm maximum global L2 norm of the gradients
+ * @param partial_sums support buffer of the parallel reduction of the norm (NUM_CORES elements)
+ * @param norm global L2 norm of the gradients before clipping, written by the function
+ */
+struct clip_grad_norm_args {
+  struct blob ** blobs;
+  int n_blobs;
+  float max_norm;
+  float * partial_sums;
+  float norm;
 };
 
 
@@ -50,3 +137,41 @@ struct optim_args {
 void pulp_gradient_descent_fp32(
     void * optim_args
 );
+
+/**
+ * @brief SGD with momentum (classical or Nesterov) and weight decay (L2 or decoupled) for a single layer, same semantics of torch.optim.SGD with dampening = 0.
+ * Parameter, gradient and velocity of each tensor are updated in a single fused pass. Use pi_cl_team_fork(NUM_CORES, pulp_sgd_momentum_fp32, &args) to parallelize.
+ * @param optim_args pointer to optim_args structure
+ */
+void pulp_sgd_momentum_fp32(
+    void * optim_args
+);
+
+/**
+ * @brief Adam / AdamW optimizer for a single layer, with bias correction. Parameter, gradient and moments of each tensor are updated in a single fused pass.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_adam_fp32, &args) to parallelize.
+ * @param adam_args pointer to adam_args structure
+ */
+void pulp_adam_fp32(
+    void * adam_args
+);
+
+/**
+ * @brief Multi-tensor optimizer step: updates all the layers of the list with the selected optimizer in a single fork, with the same result of
+ * the single layer optimizers. Use pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp32, &args) to parallelize.
+ * @param optim_multi_args pointer to optim_multi_args structure
+ */
+void pulp_optimizer_multi_fp32(
+    void * optim_multi_args
+);
+
+/**
+ * @brief Global L2 norm gradient clipping over a list of blobs: the squared gradients are summed on balanced per-core chunks and reduced with a
+ * tree over the cores, then the gradients are scaled in place if their norm exceeds max_norm. To clip right before the update, prefer the
+ * max_grad_norm option of pulp_optimizer_multi_fp32, which applies the scale inside the update instead of rewriting the gradients.
+ * Use pi_cl_team_fork(NUM_CORES, pulp_clip_grad_norm_fp32, &args) to parallelize.
+ * @param clip_grad_norm_args pointer to clip_grad_norm_args structure
+ */
+void pulp_clip_grad_norm_fp32(
+    void * clip_grad_norm_args
+);
@@ -69,5 +69,23 @@ float pulp_generate_float_seed(int seed);
  */
 void pulp_random_bernoulli(void * integer_random_args);
 
+/**
+ * @brief Counter-based pseudo-random generator: hashes (key, counter) into a 32-bit number with no state, so that each core can draw
+ * the numbers of its own elements (counter = element index) in any order and the result does not depend on the split among the cores.
+ * @param key key of the stream (e.g. a seed changed at every step)
+ * @param counter index of the number in the stream
+ * @return pseudo-random 32-bit number
+ */
+static inline uint32_t pulp_counter_rand(uint32_t key, uint32_t counter)
+{
+  uint32_t x = (counter * 0x9e3779b9u) ^ (key * 0x85ebca6bu);
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
 
 #endif /* #ifndef __MTWISTER_H */
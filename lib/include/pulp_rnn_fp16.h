@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Gated recurrent layer (LSTM, GRU) training functions in FP16, grouped into FW and BW
+*/
+
+
+/**
+ * @brief Structure for the gated recurrent layers (LSTM, GRU) in FP16. The input projection W_x * x_t + b of all the timesteps is computed
+ * up front in one parallel pass; the recurrence then only does the H x H matmul with h_t-1, whose epilogue applies the gate activations
+ * and updates the state. K and H have to be even (SIMD on pairs). The number of gates G = coeff->H / H.
+ * Truncated BPTT over windows of N timesteps works as in the FP32 layers (see Gated_rnn_args).
+ * @param input             Input sequence (N x K). The backward pass writes the input gradient into input->diff.
+ * @param output            Hidden states of all the timesteps (N x H). The backward pass reads their gradient from output->diff.
+ * @param state             Initial hidden state h_0 (H), zeros if NULL. The backward pass writes its gradient into state->diff, if not NULL.
+ * @param cell_state        LSTM only: initial cell state c_0 (H), zeros if NULL. The backward pass writes its gradient into cell_state->diff, if not NULL.
+ * @param coeff             Stacked gate weights (G*H x (K+H)): the first K columns multiply x_t, the last H multiply h_t-1. LSTM: G = 4, gates i | f | g | o. GRU: G = 3, gates r | z | n.
+ * @param bias              Gate biases (4H), can be NULL. LSTM: i | f | g | o. GRU: r | z | n, followed by the recurrent bias of the candidate gate b_hn.
+ * @param gates             Gate activations saved by the forward pass (N x 4H). LSTM: i | f | g | o. GRU: r | z | n | U_n * h_t-1 + b_hn. Overwritten by the backward pass.
+ * @param cells             LSTM only: cell states saved by the forward pass (N x H)
+ * @param grad_buffer       Support buffer of the backward pass (2H)
+ * @param carry_state       If 1, the forward pass leaves the final state of the window in state->data (and cell_state->data) for the next window. Requires state (and, for the LSTM, cell_state).
+ * @param prev_state        If carry_state, initial state of the window saved by the forward pass for the backward pass (2H: h_0 | c_0)
+ */
+struct Gated_rnn_args_fp16 {
+    struct blob_fp16 * input;
+    struct blob_fp16 * output;
+    struct blob_fp16 * state;
+    struct blob_fp16 * cell_state;
+    struct blob_fp16 * coeff;
+    struct blob_fp16 * bias;
+    fp16 * gates;
+    fp16 * cells;
+    fp16 * grad_buffer;
+    int carry_state;
+    fp16 * prev_state;
+};
+
+
+
+// GATED RECURRENT LAYERS
+
+/**
+ * @brief Forward pass of the LSTM layer over the whole sequence: i, f, o = sigmoid(.), g = tanh(.), c_t = f * c_t-1 + i * g, h_t = o * tanh(c_t).
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void pulp_lstm_fp16_fw_cl(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief Backward pass (through time) of the LSTM layer, from the gate activations and cell states saved by the forward pass.
+ * Computes the input, initial state, weight and bias gradients.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void pulp_lstm_fp16_bw_cl(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief Forward pass of the GRU layer over the whole sequence: r, z = sigmoid(.), n = tanh(W_n x_t + b_n + r * (U_n h_t-1 + b_hn)), h_t = (1 - z) * n + z * h_t-1.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void pulp_gru_fp16_fw_cl(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief Backward pass (through time) of the GRU layer, from the gate activations saved by the forward pass.
+ * Computes the input, initial state, weight and bias gradients.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void pulp_gru_fp16_bw_cl(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief LSTM forward kernel: the whole sequence in a single fork, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, lstm_fw_fp16, &args) to parallelize.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void lstm_fw_fp16(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief LSTM backward through time kernel: replaces the saved gates with the gradients of the gate pre-activations, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, lstm_bw_fp16, &args) to parallelize.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void lstm_bw_fp16(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief GRU forward kernel: the whole sequence in a single fork, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, gru_fw_fp16, &args) to parallelize.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void gru_fw_fp16(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief GRU backward through time kernel: replaces the saved gates with the gradients of the gate pre-activations, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, gru_bw_fp16, &args) to parallelize.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void gru_bw_fp16(void * Gated_rnn_args_fp16);
+
+/**
+ * @brief Weight, bias and input gradients of the gated recurrent layers, from the gradients of the gate pre-activations left in gates by the backward through time kernels.
+ * Parallelized on the rows of the weights and on the inputs. Use pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp16, &args) to parallelize.
+ * @param Gated_rnn_args_fp16 pointer to a Gated_rnn_args_fp16 structure
+ */
+void gated_rnn_grad_fp16(void * Gated_rnn_args_fp16);
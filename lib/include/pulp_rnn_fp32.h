@@ -29,14 +29,18 @@
  */
 
 /**
- * @brief Structure for RNN Training in FP32
- * @param input             Input vector for the RNN layer.
- * @param state             Vector of current hidden state.
- * @param output            Output vector & next current state.
- * @param coeff_x           Weight for input vector.
- * @param coeff_s           Weight for state vector.
- * @param temp_buffer       Temporary vector for BW transpose operations.
- * @param grad_buffer       Buffer used for saving the output gradient in the BW step.
+ * @brief Structure for RNN Training in FP32: h_t = tanh(x_t * Wx + h_t-1 * Ws). The input projection X * Wx of all the timesteps is
+ * computed up front with a single matmul; the recurrence then only does the M x M matmul with h_t-1.
+ * Long sequences are trained with truncated BPTT over windows of N timesteps, as for the gated layers (see Gated_rnn_args).
+ * @param input             Input sequence (N x K). The backward pass writes the input gradient into input->diff.
+ * @param state             Initial hidden state h_0 (M), zeros if NULL. The backward pass writes its gradient into state->diff, if not NULL.
+ * @param output            Hidden states of all the timesteps (N x M). The backward pass reads their gradient from output->diff.
+ * @param coeff_x           Weight for input vector (K x M).
+ * @param coeff_s           Weight for state vector (M x M).
+ * @param temp_buffer       Support buffer of the backward pass (M).
+ * @param grad_buffer       Gradients of the pre-activations computed by the backward pass (N x M), can be output->diff.
+ * @param carry_state       If 1, the forward pass leaves the final hidden state of the window in state->data for the next window. Requires state.
+ * @param prev_state        If carry_state, initial state of the window saved by the forward pass for the backward pass (M).
  */
 
 struct Rnn_args {
@@ -46,7 +50,43 @@ struct Rnn_args {
     struct blob * coeff_x;
     struct blob * coeff_s;
     float * temp_buffer;
-    float * grad_buffer; 
+    float * grad_buffer;
+    int carry_state;
+    float * prev_state;
+};
+
+
+/**
+ * @brief Structure for the gated recurrent layers (LSTM, GRU) in FP32. The input projection W_x * x_t + b of all the timesteps is computed
+ * up front in one parallel pass; the recurrence then only does the H x H matmul with h_t-1, whose epilogue applies the gate activations
+ * and updates the state. The number of gates G = coeff->H / H.
+ * Long sequences are trained with truncated BPTT: the stream is split into windows of N timesteps (the BPTT window, which bounds the
+ * saved activations), with one forward and one backward call per window. With carry_state the final state of a window becomes the
+ * initial state of the next one, while the gradient is not propagated across the window boundary.
+ * @param input             Input sequence (N x K). The backward pass writes the input gradient into input->diff.
+ * @param output            Hidden states of all the timesteps (N x H). The backward pass reads their gradient from output->diff.
+ * @param state             Initial hidden state h_0 (H), zeros if NULL. The backward pass writes its gradient into state->diff, if not NULL.
+ * @param cell_state        LSTM only: initial cell state c_0 (H), zeros if NULL. The backward pass writes its gradient into cell_state->diff, if not NULL.
+ * @param coeff             Stacked gate weights (G*H x (K+H)): the first K columns multiply x_t, the last H multiply h_t-1. LSTM: G = 4, gates i | f | g | o. GRU: G = 3, gates r | z | n.
+ * @param bias              Gate biases (4H), can be NULL. LSTM: i | f | g | o. GRU: r | z | n, followed by the recurrent bias of the candidate gate b_hn.
+ * @param gates             Gate activations saved by the forward pass (N x 4H). LSTM: i | f | g | o. GRU: r | z | n | U_n * h_t-1 + b_hn. Overwritten by the backward pass.
+ * @param cells             LSTM only: cell states saved by the forward pass (N x H)
+ * @param grad_buffer       Support buffer of the backward pass (2H)
+ * @param carry_state       If 1, the forward pass leaves the final state of the window in state->data (and cell_state->data) for the next window. Requires state (and, for the LSTM, cell_state).
+ * @param prev_state        If carry_state, initial state of the window saved by the forward pass for the backward pass (2H: h_0 | c_0)
+ */
+struct Gated_rnn_args {
+    struct blob * input;
+    struct blob * output;
+    struct blob * state;
+    struct blob * cell_state;
+    struct blob * coeff;
+    struct blob * bias;
+    float * gates;
+    float * cells;
+    float * grad_buffer;
+    int carry_state;
+    float * prev_state;
 };
 
 
@@ -59,12 +99,8 @@ struct Rnn_args {
 // FORWARD FUNCTIONS
 
 /**
- * @brief Forward pass function, forked on PULP cluster.
- * @param input     Input vector.
- * @param state     Vector of current hidden state.
- * @param output    Output vector & next current state.
- * @param coeff_x   Weight for input vector.
- * @param coeff_s   Weight for state vector.
+ * @brief Forward pass function over the whole sequence: hoisted input projection, then the recurrence in a single fork.
+ * @param Rnn_args pointer to a Rnn_args structure
  */
 void pulp_rnn_fp32_fw_cl(void * Rnn_args);
 
@@ -72,11 +108,93 @@ void pulp_rnn_fp32_fw_cl(void * Rnn_args);
 // BACKWARD FUNCTIONS
 
 /**
- * @brief Backward pass function, which internally calculate both weight gradient and input gradient.
- * @param input     Input vector.
- * @param state     Vector current hidden state.
- * @param output    Output vector & next current state.
- * @param coeff_x   weight input matrix 
- * @param coeff_s   weight state matrix
+ * @brief Backward pass (through time) function, which internally calculates the weight, input and initial state gradients.
+ * @param Rnn_args pointer to a Rnn_args structure
  */
 void pulp_rnn_fp32_bw_cl(void * Rnn_args);
+
+/**
+ * @brief RNN recurrence kernel: adds h_t-1 * Ws to the projected inputs in output->data and applies tanh, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, rnn_fw_fp32, &args) to parallelize.
+ * @param Rnn_args pointer to a Rnn_args structure
+ */
+void rnn_fw_fp32(void * Rnn_args);
+
+/**
+ * @brief RNN backward through time kernel: gradients of the pre-activations into grad_buffer, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, rnn_bw_fp32, &args) to parallelize.
+ * @param Rnn_args pointer to a Rnn_args structure
+ */
+void rnn_bw_fp32(void * Rnn_args);
+
+/**
+ * @brief Weight gradients of the RNN layer from the gradients of the pre-activations left in grad_buffer by rnn_bw_fp32, parallelized on the rows of the weights.
+ * Use pi_cl_team_fork(NUM_CORES, rnn_grad_fp32, &args) to parallelize.
+ * @param Rnn_args pointer to a Rnn_args structure
+ */
+void rnn_grad_fp32(void * Rnn_args);
+
+
+
+// GATED RECURRENT LAYERS
+
+/**
+ * @brief Forward pass of the LSTM layer over the whole sequence: i, f, o = sigmoid(.), g = tanh(.), c_t = f * c_t-1 + i * g, h_t = o * tanh(c_t).
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void pulp_lstm_fp32_fw_cl(void * Gated_rnn_args);
+
+/**
+ * @brief Backward pass (through time) of the LSTM layer, from the gate activations and cell states saved by the forward pass.
+ * Computes the input, initial state, weight and bias gradients.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void pulp_lstm_fp32_bw_cl(void * Gated_rnn_args);
+
+/**
+ * @brief Forward pass of the GRU layer over the whole sequence: r, z = sigmoid(.), n = tanh(W_n x_t + b_n + r * (U_n h_t-1 + b_hn)), h_t = (1 - z) * n + z * h_t-1.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void pulp_gru_fp32_fw_cl(void * Gated_rnn_args);
+
+/**
+ * @brief Backward pass (through time) of the GRU layer, from the gate activations saved by the forward pass.
+ * Computes the input, initial state, weight and bias gradients.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void pulp_gru_fp32_bw_cl(void * Gated_rnn_args);
+
+/**
+ * @brief LSTM forward kernel: the whole sequence in a single fork, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, lstm_fw_fp32, &args) to parallelize.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void lstm_fw_fp32(void * Gated_rnn_args);
+
+/**
+ * @brief LSTM backward through time kernel: replaces the saved gates with the gradients of the gate pre-activations, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, lstm_bw_fp32, &args) to parallelize.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void lstm_bw_fp32(void * Gated_rnn_args);
+
+/**
+ * @brief GRU forward kernel: the whole sequence in a single fork, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, gru_fw_fp32, &args) to parallelize.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void gru_fw_fp32(void * Gated_rnn_args);
+
+/**
+ * @brief GRU backward through time kernel: replaces the saved gates with the gradients of the gate pre-activations, parallelized on the hidden units with a barrier per timestep.
+ * Use pi_cl_team_fork(NUM_CORES, gru_bw_fp32, &args) to parallelize.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void gru_bw_fp32(void * Gated_rnn_args);
+
+/**
+ * @brief Weight, bias and input gradients of the gated recurrent layers, from the gradients of the gate pre-activations left in gates by the backward through time kernels.
+ * Parallelized on the rows of the weights and on the inputs. Use pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp32, &args) to parallelize.
+ * @param Gated_rnn_args pointer to a Gated_rnn_args structure
+ */
+void gated_rnn_grad_fp32(void * Gated_rnn_args);
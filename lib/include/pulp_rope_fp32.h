@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Rotary positional embedding (RoPE) functions, grouped into FW and BW
+*/ 
+
+
+/**
+ * @brief Structure for the rotary positional embedding in FP32. The features (2j, 2j+1) of every head are rotated by the angle t * base^(-2j/H), t being the position of the token.
+ * @param input             Q or K in the MHSA layout (F x L). The forward rotates data in place, the backward rotates diff back in place.
+ * @param cos               Table of the cosines (H/2 x L), filled once per sequence length by pulp_rope_fp32_tables_cl
+ * @param sin               Table of the sines (H/2 x L), filled once per sequence length by pulp_rope_fp32_tables_cl
+ * @param n_heads           Number of heads, the head dimension H = F / n_heads has to be even
+ * @param base              Base of the rotation frequencies (10000 in the original formulation)
+ */
+struct Rope_args {
+    struct blob *input;
+    float *cos;
+    float *sin;
+    int n_heads;
+    float base;
+};
+
+
+/**
+ * @brief Structure for the RoPE rotation kernel in FP32
+ * @param x                 Matrix to be rotated in place (F x L)
+ * @param cos               Table of the cosines (H/2 x L)
+ * @param sin               Table of the sines (H/2 x L)
+ * @param F                 Number of rows of x (n_heads * H)
+ * @param L                 Sequence length
+ * @param H                 Head dimension
+ * @param inverse           If 1, rotates by the opposite angle (backward pass)
+ */
+struct rope_rotate_args {
+    float *x;
+    float *cos;
+    float *sin;
+    int F;
+    int L;
+    int H;
+    int inverse;
+};
+
+
+/**
+ * @brief Arguments for the projection matmul with a RoPE epilogue (C = rope(A*B + bias)), used to fuse the rotation into the Q/K projections.
+ * @param mm_args The pointer to the matmul structure (C is F x L, trans_B is supported, bias is added per row if USE_BIASES is set)
+ * @param cos Table of the cosines (H/2 x L)
+ * @param sin Table of the sines (H/2 x L)
+ * @param H Head dimension
+ */
+struct mm_rope_args {
+    struct matMul_args *mm_args;
+    float *cos;
+    float *sin;
+    int H;
+};
+
+
+
+/**
+ * @brief Fills the cos/sin tables with CORDIC, to be called once per sequence length. L is taken from input->W.
+ * @param Rope_args pointer to a Rope_args structure
+ */
+void pulp_rope_fp32_tables_cl(void *Rope_args);
+
+/**
+ * @brief Forward pass of RoPE, rotates input->data in place.
+ * @param Rope_args pointer to a Rope_args structure
+ */
+void pulp_rope_fp32_fw_cl(void *Rope_args);
+
+/**
+ * @brief Backward pass of RoPE, rotates input->diff in place by the opposite angles.
+ * @param Rope_args pointer to a Rope_args structure
+ */
+void pulp_rope_fp32_bw_cl(void *Rope_args);
+
+/**
+ * @brief Table computation kernel, parallelized on the frequencies. Use pi_cl_team_fork(NUM_CORES, rope_tables_fp32, &args) to parallelize.
+ * @param Rope_args pointer to a Rope_args structure
+ */
+void rope_tables_fp32(void *Rope_args);
+
+/**
+ * @brief Rotation kernel, parallelized on the pairs of rows. Use pi_cl_team_fork(NUM_CORES, rope_rotate_fp32, &args) to parallelize.
+ * @param rope_rotate_args pointer to a rope_rotate_args structure
+ */
+void rope_rotate_fp32(void *rope_rotate_args);
+
+/**
+ * @brief Naive matrix multiply with bias and RoPE epilogue, performing C=rope(A*B + bias). Parallelizes on the pairs of rows of C.
+ * @param void_args pointer to a mm_rope_args structure
+ */
+void mm_rope_fp32(void *void_args);
@@ -52,6 +52,9 @@
 #include "pulp_nonorm_fp32.h"
 #include "pulp_transp_conv2d_fp32.h"
 #include "pulp_layernorm_fp32.h"
+#include "pulp_embedding_fp32.h"
+#include "pulp_rope_fp32.h"
+#include "pulp_transformer_fp32.h"
 
 
 // FP16 structures
@@ -74,8 +77,11 @@
 #include "pulp_optimizers_fp16.h"
 #include "pulp_pooling_fp16.h"
 #include "pulp_residual_fp16.h"
+#include "pulp_rnn_fp16.h"
 #include "pulp_nonorm_fp16.h"
 #include "pulp_transp_conv2d_fp16.h"
 #include "pulp_embedding_fp16.h"
+#include "pulp_rope_fp16.h"
+#include "pulp_transformer_fp16.h"
 
 
@@ -31,6 +31,8 @@
  */
 typedef float16alt fp16;                                    // FP16 format (float16 or float16alt)
 typedef fp16 v2f16 __attribute__((vector_size (4)));        // Vectorized fp16 for SIMD
+#define FP16_EXP_BIAS   127                                 // Exponent bias of the fp16 format (15 for float16, 127 for float16alt)
+#define FP16_MANT_BITS  7                                   // Mantissa bits of the fp16 format (10 for float16, 7 for float16alt)
 /**
  * @}
  */
@@ -44,6 +46,16 @@ typedef fp16 v2f16 __attribute__((vector_size (4)));        // Vectorized fp16 f
  * @}
  */
 
+/**
+ * @defgroup 1-bit activation masks (bit i%32 of word i/32 is set if element i is active)
+ * @{
+ */
+#define ACT_MASK_WORDS(dim) (((dim) + 31) >> 5)                                  // Number of uint32_t words of the mask of a dim-sized tensor
+#define ACT_MASK_BLOCK(dim) ((((dim) + NUM_CORES - 1) / NUM_CORES + 31) & ~31)   // Per-core block size, multiple of 32 so that no mask word is shared between cores
+/**
+ * @}
+ */
+
 /**
  * @defgroup Selects the kind of layer which is the target of "mm_manager" function.
  * @{
@@ -67,6 +79,82 @@ typedef fp16 v2f16 __attribute__((vector_size (4)));        // Vectorized fp16 f
  * @}
  */
 
+/**
+ * @defgroup Selects the optimizer of the sparse embedding update.
+ * @{
+ */
+#define EMBEDDING_SGD 0
+#define EMBEDDING_ADAM 1
+/**
+ * @}
+ */
+
+/**
+ * @defgroup Selects the optimizer of the multi-tensor optimizer step (see pulp_optimizer_multi_fp32)
+ * @{
+ */
+#define OPTIM_SGD 0
+#define OPTIM_SGD_MOMENTUM 1
+#define OPTIM_ADAM 2
+/**
+ * @}
+ */
+
+/**
+ * @defgroup Rounding of the fp16 parameters written by the fp16 optimizers
+ * @{
+ */
+#define FP16_ROUND_NEAREST 0                                // Round to nearest even
+#define FP16_ROUND_STOCHASTIC 1                             // Round up with a probability equal to the discarded fraction of the ulp (see stochastic_round_fp16)
+/**
+ * @}
+ */
+
+/**
+ * @defgroup Attention masks of the fused MHSA kernels (query row r attends to key column c if the mask is set)
+ * @{
+ */
+#define MHSA_MASK_NONE 0
+#define MHSA_MASK_CAUSAL 1              // c <= r
+#define MHSA_MASK_SLIDING_WINDOW 2      // r - mask_window < c <= r
+#define MHSA_MASK_BLOCK_SPARSE 3        // mask_layout[(r / mask_block) * n_blocks + c / mask_block] != 0
+/**
+ * @}
+ */
+
+/**
+ * @defgroup Classification of a tile of attention scores against the mask (see mhsa_mask_tile)
+ * @{
+ */
+#define MHSA_TILE_SKIP 0
+#define MHSA_TILE_PARTIAL 1
+#define MHSA_TILE_FULL 2
+/**
+ * @}
+ */
+
+/**
+ * @defgroup Scratch buffers of the fused transformer block, placed by its static memory plan (see pulp_transformer_block_fp32_plan)
+ * @{
+ */
+#define TRANSFORMER_FW_H1 0             // LN1 output (L x E)
+#define TRANSFORMER_FW_SCORES 1         // Flash attention support buffer: m | l | scores
+#define TRANSFORMER_FW_H2 2             // LN2 output (L x E)
+#define TRANSFORMER_FW_G 3              // GELU output (L x Hm)
+#define TRANSFORMER_BW_G 4              // Recomputed GELU output (L x Hm)
+#define TRANSFORMER_BW_H2 5             // Recomputed LN2 output (L x E)
+#define TRANSFORMER_BW_DU 6             // Gradient of the FC1 output (L x Hm)
+#define TRANSFORMER_BW_DH2 7            // Gradient of the LN2 output (L x E)
+#define TRANSFORMER_BW_DATT 8           // Gradient of the attention output (F x L)
+#define TRANSFORMER_BW_DELTA 9          // Row-wise dot products of the attention backward (L)
+#define TRANSFORMER_BW_DQKV 10          // Gradient of Q | K | V (3F x L)
+#define TRANSFORMER_BW_H1 11            // Recomputed LN1 output (L x E)
+#define TRANSFORMER_BW_DH1 12           // Gradient of the LN1 output (L x E)
+#define TRANSFORMER_N_BUFFERS 13
+/**
+ * @}
+ */
+
 /**
  * Constants for Taylor's propagation of 1/2^x 
  */
@@ -93,6 +181,22 @@ typedef fp16 v2f16 __attribute__((vector_size (4)));        // Vectorized fp16 f
 #define GIST_D_fp16  32640
 
 
+/**
+ * @defgroup Accuracy tiers of the vectorized fp16 transcendental functions (select with -DFP16_MATH_TIER=...)
+ * @{
+ */
+#define FP16_MATH_LUT   0       // Look-up tables with linear interpolation (fastest)
+#define FP16_MATH_POLY  1       // Minimax polynomial and rational approximations
+#define FP16_MATH_LIBM  2       // math.h on each lane (reference, slowest)
+
+#ifndef FP16_MATH_TIER
+#define FP16_MATH_TIER  FP16_MATH_POLY
+#endif
+/**
+ * @}
+ */
+
+
 
 /**
  * Constants for Normalization Layers
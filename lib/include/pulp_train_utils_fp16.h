@@ -212,6 +212,21 @@ struct cast_32t16_args {
 };
 
 
+/**
+ * @brief Arguments for the cast_fp32_tensor_to_fp16_sr function
+ * @param source pointer to a fp32 tensor to be cast in fp16
+ * @param destination pointer to the cast buffer
+ * @param size number of elements of the tensor to be cast
+ * @param seed seed of the stochastic rounding, to be changed at every cast of the same tensor
+ */
+struct cast_32t16_sr_args {
+    float *source;
+    fp16 *destination;
+    int size;
+    unsigned int seed;
+};
+
+
 /**
  * @brief Arguments for the pad_tensor
  * @param source Tensor to be padded
@@ -351,6 +366,18 @@ struct mm_manager_args_fp16 {
 };
 
 
+/**
+ * @brief Arguments for matmuls with an elementwise multiplicative epilogue (C = (A*B) .* scale). Used to fuse the
+ * derivative of an activation function into the input gradient computation of the following layer.
+ * @param mm_args The pointer to the matmul structure (trans_B is supported, bias is ignored)
+ * @param scale Buffer of N*M elements to be multiplied elementwise with the result before storing it into C
+ */
+struct mm_epilogue_args_fp16 {
+    struct matMul_args_fp16 *mm_args;
+    fp16 *scale;
+};
+
+
 /**
  * @brief Arguments for tanh in parallel output=tanh(input)
  * @param input   pointer to input vector
@@ -612,6 +639,30 @@ void array_broadcast_sum_fp16(void *arr_bc_args);
 void cast_fp32_tensor_to_fp16(void *cast_32t16_args);
 
 
+/**
+ * @brief Cast a FP32 tensor to FP16 with stochastic rounding, so that the cast is unbiased on average. Set up the arguments by using a "struct cast_32t16_sr_args" structure.
+ * Use pi_cl_team_fork(NUM_CORES, cast_fp32_tensor_to_fp16_sr, &args) to parallelize.
+ * @param (void *) (struct cast_32t16_sr_args cast_args)
+ */
+void cast_fp32_tensor_to_fp16_sr(void *cast_32t16_sr_args);
+
+
+/**
+ * @brief Stochastic rounding of a FP32 value to FP16: rounds away from zero with a probability equal to the fraction of the ulp that is discarded.
+ * A random number is added to the mantissa bits dropped by the fp16 format, which are then truncated, so that the final cast is exact.
+ * @param x value to be rounded
+ * @param rand 32-bit random number (e.g. from pulp_counter_rand)
+ * @return rounded value
+ */
+static inline fp16 stochastic_round_fp16(float x, uint32_t rand)
+{
+    const int drop_bits = 23 - FP16_MANT_BITS;
+    union { float f; uint32_t u; } v = { .f = x };
+    v.u = (v.u + (rand >> (32 - drop_bits))) & ~((1u << drop_bits) - 1);
+    return (fp16) v.f;
+}
+
+
 /**
  * @brief Transforms the data layout of data/grad of a given tensor to CHW from HWC
  * @param layout_args (void *) (struct layout_args_fp16 layout_args) 
@@ -801,3 +852,58 @@ void vector_exp_sum_fp16_cl(void * vector_exp_sum_args);
  * @param (void *) (struct reduce_mean_args_fp16 void_args)
  */
 void reduce_mean_fp16(void *void_args);
+
+
+/**
+ * =====> VECTORIZED TRANSCENDENTAL FUNCTIONS <=====
+ * Each function processes the two lanes of a v2f16 vector. The accuracy/speed trade-off is selected at
+ * compile time with FP16_MATH_TIER (see pulp_train_defines.h).
+ */
+
+/**
+ * @brief Vectorized exponential. Results below the smallest normal value of the fp16 format are flushed to zero,
+ * results above the largest power of two are saturated.
+ * @param x v2f16 input vector
+ * @return v2f16 exp(x)
+ */
+v2f16 vexp_fp16(v2f16 x);
+
+
+/**
+ * @brief Vectorized sigmoid, 1 / (1 + exp(-x)).
+ * @param x v2f16 input vector
+ * @return v2f16 sigmoid(x)
+ */
+v2f16 vsigmoid_fp16(v2f16 x);
+
+
+/**
+ * @brief Vectorized hyperbolic tangent, computed as 2 * sigmoid(2x) - 1.
+ * @param x v2f16 input vector
+ * @return v2f16 tanh(x)
+ */
+v2f16 vtanh_fp16(v2f16 x);
+
+
+/**
+ * @brief Vectorized error function.
+ * @param x v2f16 input vector
+ * @return v2f16 erf(x)
+ */
+v2f16 verf_fp16(v2f16 x);
+
+
+/**
+ * @brief Vectorized GELU, tanh approximation (same as torch.nn.GELU(approximate='tanh')).
+ * @param x v2f16 input vector
+ * @return v2f16 gelu(x)
+ */
+v2f16 vgelu_fp16(v2f16 x);
+
+
+/**
+ * @brief Vectorized GELU, exact erf formulation (same as torch.nn.GELU()).
+ * @param x v2f16 input vector
+ * @return v2f16 gelu(x)
+ */
+v2f16 vgelu_erf_fp16(v2f16 x);
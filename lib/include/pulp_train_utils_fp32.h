@@ -401,6 +401,18 @@ struct mm_manager_args {
 };
 
 
+/**
+ * @brief Arguments for matmuls with an elementwise multiplicative epilogue (C = (A*B) .* scale). Used to fuse the
+ * derivative of an activation function into the input gradient computation of the following layer.
+ * @param mm_args The pointer to the matmul structure (trans_B is supported, bias is ignored)
+ * @param scale Buffer of N*M elements to be multiplied elementwise with the result before storing it into C
+ */
+struct mm_epilogue_args {
+    struct matMul_args *mm_args;
+    float *scale;
+};
+
+
 /**
  * @brief Arguments for tanh in parallel output=tanh(input)
  * @param input   pointer to input vector
@@ -780,6 +792,47 @@ int clamp_int(int value, int min, int max);
 float clamp(float value, float min, float max);
 
 
+/**
+ * @brief Attention mask helpers, shared by the FP32 and FP16 fused attention kernels. Scores are indexed by query row r and key column c of an L x L map.
+ * mask_type is one of MHSA_MASK_NONE, MHSA_MASK_CAUSAL, MHSA_MASK_SLIDING_WINDOW or MHSA_MASK_BLOCK_SPARSE (see pulp_train_defines.h), window is the
+ * number of keys (the query itself included) seen by the sliding window, layout is the n_blocks x n_blocks block-sparse layout with n_blocks = ceil(L / block).
+ */
+/**
+ * @brief Returns 1 if query r attends to key c
+ */
+int mhsa_mask_visible(int mask_type, int window, int block, unsigned char *layout, int L, int r, int c);
+/**
+ * @brief Classifies the tile made of the query rows [r0, r1) and the key columns [c0, c1)
+ * @returns MHSA_TILE_SKIP if every score of the tile is masked, MHSA_TILE_FULL if none is, MHSA_TILE_PARTIAL otherwise
+ */
+int mhsa_mask_tile(int mask_type, int window, int block, unsigned char *layout, int L, int r0, int r1, int c0, int c1);
+/**
+ * @brief Returns the first key tile after t (tiles of Bc keys) which is not fully masked for the query rows [r0, r1), or n_tiles if there is none. Pass t = -1 for the first one.
+ */
+int mhsa_mask_next_tile(int mask_type, int window, int block, unsigned char *layout, int L, int r0, int r1, int Bc, int n_tiles, int t);
+/**
+ * @brief Narrows [c0, c1) to the key columns query r can attend to, written to [*lo, *hi). For MHSA_MASK_BLOCK_SPARSE the range is left unchanged and mhsa_mask_visible has to be checked on each column.
+ */
+void mhsa_mask_row_range(int mask_type, int window, int r, int c0, int c1, int *lo, int *hi);
+/**
+ * @brief Narrows [r0, r1) to the query rows attending to key c, written to [*lo, *hi). For MHSA_MASK_BLOCK_SPARSE the range is left unchanged and mhsa_mask_visible has to be checked on each row.
+ */
+void mhsa_mask_col_range(int mask_type, int window, int c, int r0, int r1, int *lo, int *hi);
+
+
+/**
+ * @brief Static memory plan: assigns an offset to each of the n buffers inside a single scratch buffer, so that buffers whose lifetimes
+ * [first[i], last[i]] (in steps of the caller) overlap never share memory. Greedy first fit, largest buffers first. Precision independent (sizes in elements).
+ * @param n         number of buffers
+ * @param size      size of each buffer
+ * @param first     first step in which each buffer is alive
+ * @param last      last step in which each buffer is alive
+ * @param offset    output: offset of each buffer in the scratch buffer
+ * @returns size of the scratch buffer
+ */
+int pulp_static_mem_plan(int n, int *size, int *first, int *last, int *offset);
+
+
 static inline float
 fasterexp(float p);
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/**
+ * Fused transformer encoder block (pre-norm, ViT style), grouped into FW and BW:
+ *      x1 = x + Attn(LN1(x)) * Wo^T + bo
+ *      y  = x1 + GELU(LN2(x1) * W1^T + b1) * W2^T + b2
+ * The whole block runs from two buffers: the activations saved for the backward pass and a scratch buffer
+ * shared by the intermediates, whose offsets are assigned once by a static memory plan.
+*/
+
+
+/**
+ * @brief Structure for the fused transformer encoder block in FP16. Weights are stored out x in, as in the linear layers.
+ * Dimensions are taken from the blobs: L = input->H, E = input->W, F = coeff_qkv->H / 3, Hm = coeff_fc1->H.
+ * Gradients of the weights are written (not accumulated) into the diff of the weight blobs. L, E, F and Hm have to be even (SIMD on pairs).
+ * @param input             Input of the block (L x E). The backward pass writes the input gradient into input->diff.
+ * @param output            Output of the block (L x E). The backward pass reads the output gradient from output->diff.
+ * @param ln1_weight        Scale of the first LayerNorm (E)
+ * @param ln1_bias          Shift of the first LayerNorm (E)
+ * @param coeff_qkv         Fused weight of the input projections Wq | Wk | Wv (3F x E)
+ * @param bias_qkv          Fused bias of the input projections (3F), can be NULL
+ * @param coeff_out         Weight of the output projection (E x F)
+ * @param bias_out          Bias of the output projection (E), can be NULL
+ * @param ln2_weight        Scale of the second LayerNorm (E)
+ * @param ln2_bias          Shift of the second LayerNorm (E)
+ * @param coeff_fc1         Weight of the first MLP layer (Hm x E)
+ * @param bias_fc1          Bias of the first MLP layer (Hm), can be NULL
+ * @param coeff_fc2         Weight of the second MLP layer (E x Hm)
+ * @param bias_fc2          Bias of the second MLP layer (E), can be NULL
+ * @param n_heads           Number of attention heads
+ * @param eps               Epsilon of the LayerNorms
+ * @param mask_type         Attention mask (MHSA_MASK_NONE, MHSA_MASK_CAUSAL, MHSA_MASK_SLIDING_WINDOW or MHSA_MASK_BLOCK_SPARSE)
+ * @param mask_window       Window of MHSA_MASK_SLIDING_WINDOW
+ * @param mask_block        Block size of MHSA_MASK_BLOCK_SPARSE
+ * @param mask_layout       Block layout of MHSA_MASK_BLOCK_SPARSE
+ * @param activations       Activations saved by the forward pass for the backward pass (act_size FP16 elements, the FP32 LayerNorm statistics and log-sum-exp included)
+ * @param scratch           Scratch buffer of the intermediates (scratch_size elements), can be reused outside of the block
+ * @param act_size          Size of activations, filled by pulp_transformer_block_fp16_plan
+ * @param scratch_size      Size of scratch, filled by pulp_transformer_block_fp16_plan
+ * @param plan              Offsets of the TRANSFORMER_* buffers inside scratch, filled by pulp_transformer_block_fp16_plan
+ */
+struct Transformer_block_args_fp16 {
+    struct blob_fp16 *input;
+    struct blob_fp16 *output;
+    struct blob_fp16 *ln1_weight;
+    struct blob_fp16 *ln1_bias;
+    struct blob_fp16 *coeff_qkv;
+    struct blob_fp16 *bias_qkv;
+    struct blob_fp16 *coeff_out;
+    struct blob_fp16 *bias_out;
+    struct blob_fp16 *ln2_weight;
+    struct blob_fp16 *ln2_bias;
+    struct blob_fp16 *coeff_fc1;
+    struct blob_fp16 *bias_fc1;
+    struct blob_fp16 *coeff_fc2;
+    struct blob_fp16 *bias_fc2;
+    int n_heads;
+    fp16 eps;
+    int mask_type;
+    int mask_window;
+    int mask_block;
+    unsigned char *mask_layout;
+    fp16 *activations;
+    fp16 *scratch;
+    int act_size;
+    int scratch_size;
+    int plan[TRANSFORMER_N_BUFFERS];
+};
+
+
+/**
+ * @brief Structure for the strided matmul of the transformer block in FP16, with fused epilogue. Computes
+ *      C[i*c_rs + j*c_cs] = act(sum_k A[i*a_rs + k*a_cs] * B[k*b_rs + j*b_cs] + bias + residual)
+ * so that transposed operands and outputs need no transposition. Pairs of outputs are computed with SIMD along the dimension contiguous in memory.
+ * @param A                 First operand (N x K, strided)
+ * @param B                 Second operand (K x M, strided)
+ * @param C                 Output (N x M, strided)
+ * @param N                 Rows of C
+ * @param M                 Columns of C
+ * @param K                 Reduction dimension
+ * @param a_rs              Row stride of A
+ * @param a_cs              Column stride of A
+ * @param b_rs              Row stride of B
+ * @param b_cs              Column stride of B
+ * @param c_rs              Row stride of C
+ * @param c_cs              Column stride of C
+ * @param bias              Bias added to the output (N if bias_rows, else M), can be NULL
+ * @param bias_rows         If 1, the bias is indexed by the row of C, otherwise by the column
+ * @param residual          Residual added to the output, with the same layout of C, can be NULL
+ * @param act_out           If not NULL, receives GELU(C) with the same layout of C (C keeps the pre-activation)
+ * @param act_deriv         If not NULL, C is multiplied by gelu'(act_deriv), act_deriv having the same layout of C
+ * @param row_sum           If not NULL, receives the sum of each row of A (N), used for the bias gradients
+ */
+struct transformer_mm_args_fp16 {
+    fp16 *A;
+    fp16 *B;
+    fp16 *C;
+    int N;
+    int M;
+    int K;
+    int a_rs;
+    int a_cs;
+    int b_rs;
+    int b_cs;
+    int c_rs;
+    int c_cs;
+    fp16 *bias;
+    int bias_rows;
+    fp16 *residual;
+    fp16 *act_out;
+    fp16 *act_deriv;
+    fp16 *row_sum;
+};
+
+
+/**
+ * @brief Structure for the LayerNorm kernels of the transformer block in FP16 (normalization over the E features of each of the L tokens).
+ * @param x                 Input (L x E)
+ * @param out               Normalized output (L x E, forward)
+ * @param weight            Scale (E)
+ * @param bias              Shift (E)
+ * @param stats             Mean and reciprocal standard deviation of each token (2 x L, interleaved, FP32), written by the forward
+ * @param out_diff          Gradient of the output (L x E, backward)
+ * @param weight_diff       Gradient of the scale (E, backward)
+ * @param bias_diff         Gradient of the shift (E, backward)
+ * @param in_diff           Gradient of the input (L x E, backward), can be the same buffer of in_diff_add
+ * @param in_diff_add       Gradient added to in_diff, i.e. of the residual branch (L x E, backward)
+ * @param L                 Number of tokens
+ * @param E                 Number of features
+ * @param eps               Epsilon
+ */
+struct transformer_ln_args_fp16 {
+    fp16 *x;
+    fp16 *out;
+    fp16 *weight;
+    fp16 *bias;
+    float *stats;
+    fp16 *out_diff;
+    fp16 *weight_diff;
+    fp16 *bias_diff;
+    fp16 *in_diff;
+    fp16 *in_diff_add;
+    int L;
+    int E;
+    fp16 eps;
+};
+
+
+
+/**
+ * @brief Computes the static memory plan of the block: fills act_size, scratch_size and plan. To be called once, before allocating
+ * activations and scratch. Needs input, coeff_qkv, coeff_fc1 (for the sizes) and n_heads.
+ * @param Transformer_block_args_fp16 pointer to a Transformer_block_args_fp16 structure
+ */
+void pulp_transformer_block_fp16_plan(void *Transformer_block_args_fp16);
+
+/**
+ * @brief Forward pass of the transformer block. Writes output->data and the saved activations.
+ * @param Transformer_block_args_fp16 pointer to a Transformer_block_args_fp16 structure
+ */
+void pulp_transformer_block_fp16_fw_cl(void *Transformer_block_args_fp16);
+
+/**
+ * @brief Backward pass of the transformer block. Computes input->diff and the weight gradients from output->diff and the saved activations.
+ * LN outputs and the GELU output are recomputed instead of being saved.
+ * @param Transformer_block_args_fp16 pointer to a Transformer_block_args_fp16 structure
+ */
+void pulp_transformer_block_fp16_bw_cl(void *Transformer_block_args_fp16);
+
+/**
+ * @brief Strided matmul with fused epilogue, parallelized on the rows of C (on blocks of columns if N < NUM_CORES). Use pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &args) to parallelize.
+ * @param transformer_mm_args_fp16 pointer to a transformer_mm_args_fp16 structure
+ */
+void transformer_mm_fp16(void *transformer_mm_args_fp16);
+
+/**
+ * @brief LayerNorm forward kernel, parallelized on the tokens. Use pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp16, &args) to parallelize.
+ * @param transformer_ln_args_fp16 pointer to a transformer_ln_args_fp16 structure
+ */
+void transformer_layernorm_fw_fp16(void *transformer_ln_args_fp16);
+
+/**
+ * @brief LayerNorm backward kernel, parallelized on the features for the weight gradients and on the tokens for the input gradient.
+ * Use pi_cl_team_fork(NUM_CORES, transformer_layernorm_bw_fp16, &args) to parallelize.
+ * @param transformer_ln_args_fp16 pointer to a transformer_ln_args_fp16 structure
+ */
+void transformer_layernorm_bw_fp16(void *transformer_ln_args_fp16);
@@ -43,15 +43,17 @@ void sigmoid_core_fw_fp16( void * act_args )
   fp16* inData = args->input->data;
   fp16* outData = args->output->data;
 
-  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  // Even-sized blocks, so that each core works on aligned v2f16 pairs
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
   const int start = pi_core_id()*blockSize;
   const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-  for (int i=start; i<stop; i++) {
-    fp16 sigma = 0.0f;
-    sigma = 1 + expf(-inData[i]);
-    sigma = 1 / sigma;
-    outData[i] = sigma;
+  int i = start;
+  for (; i<stop-1; i+=2) {
+    *((v2f16 *) &outData[i]) = vsigmoid_fp16(*((v2f16 *) &inData[i]));
+  }
+  if (i<stop) {
+    outData[i] = vsigmoid_fp16((v2f16) {inData[i], inData[i]})[0];
   }
 }
 
@@ -59,23 +61,24 @@ void sigmoid_core_bw_fp16( void * act_args )
 {
   struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
   int dim = args->input->dim;
-  fp16* inData = args->input->data;
   fp16* inDiff = args->input->diff;
   fp16* outData = args->output->data;
   fp16* outDiff = args->output->diff;
 
-  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
   const int start = pi_core_id()*blockSize;
   const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-  for (int i=start; i<stop; i++) {
-    fp16 sigma = 0.0f;
-    fp16 sigma_prime = 0.0f;
-    //sigma = 1 + expf(-inData[i]);
-    //sigma = 1 / sigma;
-    sigma = outData[i];
-    sigma_prime = sigma * (1.0f - sigma);
-    inDiff[i] = outDiff[i] * sigma_prime;
+  const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+  int i = start;
+  for (; i<stop-1; i+=2) {
+    v2f16 sigma = *((v2f16 *) &outData[i]);
+    *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]) * sigma * (one - sigma);
+  }
+  if (i<stop) {
+    fp16 sigma = outData[i];
+    inDiff[i] = outDiff[i] * sigma * ((fp16) 1.0f - sigma);
   }
 }
 
@@ -180,42 +183,163 @@ void leakyrelu_core_bw_fp16( void * leakyrelu_args_fp16 )
 
 
 
+void pulp_relu_mask_fp16_fw_cl( void * relu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, relu_mask_core_fw_fp16, relu_mask_args);
+}
 
+void pulp_relu_mask_fp16_bw_cl( void * relu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, relu_mask_core_bw_fp16, relu_mask_args);
+}
 
-void pulp_gelu_fp16_fw_cl( void* act_args_fp16)
+void relu_mask_core_fw_fp16( void * relu_mask_args )
 {
-  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args_fp16;
+  struct relu_mask_args_fp16 * args = (struct relu_mask_args_fp16 *) relu_mask_args;
   int dim = args->input->dim;
   fp16* inData = args->input->data;
   fp16* outData = args->output->data;
+  uint32_t* mask = args->mask;
 
-  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  // Blocks are multiple of 32 elements, so that each mask word is written by a single core
+  const int blockSize=ACT_MASK_BLOCK(dim);
   const int start = pi_core_id()*blockSize;
   const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-  for (int i = start; i < stop; i++){
-    fp16 x = inData[i];
-    fp16 halfx = (fp16) 0.5f * x;
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = 0;
+    for (int k = 0; k < n; k++) {
+      fp16 x = inData[i+k];
+      if (x > 0) { bits |= (1U << k); outData[i+k] = x; }
+      else outData[i+k] = 0;
+    }
+    mask[i >> 5] = bits;
+  }
+}
+
+void relu_mask_core_bw_fp16( void * relu_mask_args )
+{
+  struct relu_mask_args_fp16 * args = (struct relu_mask_args_fp16 *) relu_mask_args;
+  int dim = args->input->dim;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+  uint32_t* mask = args->mask;
 
-    fp16 val = (fp16) (((x * x * x * 0.044715f) + x) * 0.7978f);
-    
-    fp16 val2 = val * val;
-    
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-    fp16 a = (fp16) ((((val2 + 378.0f) * val2 + 17325.0f) * val2 + 135135.0f) * val);
-    fp16 b = (fp16) (((28.0f * val2 + 3150.0f) * val2 + 62370.0f) * val2 + 135135.0f);
-    val = (fp16) (a / b);
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = mask[i >> 5];
+    for (int k = 0; k < n; k++) {
+      inDiff[i+k] = (bits >> k) & 0x1 ? outDiff[i+k] : 0;
+    }
+  }
+}
 
-    if(val > 1)
-      val = 1;
-    else if(val < -1)
-      val = -1;
 
-    val = (fp16) (val * halfx + halfx);
+void pulp_leakyrelu_mask_fp16_fw_cl( void * leakyrelu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_fw_fp16, leakyrelu_mask_args);
+}
 
+void pulp_leakyrelu_mask_fp16_bw_cl( void * leakyrelu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_bw_fp16, leakyrelu_mask_args);
+}
 
+void leakyrelu_mask_core_fw_fp16( void * leakyrelu_mask_args )
+{
+  struct leakyrelu_mask_args_fp16 * args = (struct leakyrelu_mask_args_fp16 *) leakyrelu_mask_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+  fp16 neg_slope = args->negative_slope;
+  uint32_t* mask = args->mask;
 
-    outData[i] = val;
+  // Blocks are multiple of 32 elements, so that each mask word is written by a single core
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = 0;
+    for (int k = 0; k < n; k++) {
+      fp16 x = inData[i+k];
+      if (x > 0) { bits |= (1U << k); outData[i+k] = x; }
+      else outData[i+k] = x*neg_slope;
+    }
+    mask[i >> 5] = bits;
+  }
+}
+
+void leakyrelu_mask_core_bw_fp16( void * leakyrelu_mask_args )
+{
+  struct leakyrelu_mask_args_fp16 * args = (struct leakyrelu_mask_args_fp16 *) leakyrelu_mask_args;
+  int dim = args->input->dim;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+  fp16 neg_slope = args->negative_slope;
+  uint32_t* mask = args->mask;
+
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = mask[i >> 5];
+    for (int k = 0; k < n; k++) {
+      inDiff[i+k] = (bits >> k) & 0x1 ? outDiff[i+k] : outDiff[i+k]*neg_slope;
+    }
+  }
+}
+
+
+
+
+
+void pulp_gelu_fp16_fw_cl( void* act_args_fp16)
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args_fp16;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    *((v2f16 *) &outData[i]) = vgelu_fp16(*((v2f16 *) &inData[i]));
+  }
+  if (i < stop) {
+    outData[i] = vgelu_fp16((v2f16) {inData[i], inData[i]})[0];
+  }
+}
+
+
+void tanh_prll_fp16(void * args)
+{
+  struct tanh_args_fp16* args_tanh = (struct tanh_args_fp16 *) args;
+  int dim = args_tanh->dim;
+  fp16* inData = args_tanh->input;
+  fp16* outData = args_tanh->output;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    *((v2f16 *) &outData[i]) = vtanh_fp16(*((v2f16 *) &inData[i]));
+  }
+  if (i < stop) {
+    outData[i] = vtanh_fp16((v2f16) {inData[i], inData[i]})[0];
   }
 }
 
@@ -380,39 +504,138 @@ void pulp_softmax_fp16_bw_cl(void *act_args_fp16) {
      *      - d_i -> inDiff[row, i]
      *      - Si  -> outData[row, i]
      *      - (outDiff[0] * S0 + outDiff[1] * S1 + ... + outDiff[j] * Sj + ...) -> sum
+     *
+     * Both the row sum and the gradient are computed by each core on its rows within a single fork.
      */
-    // Extract variables from function arguments
+    pi_cl_team_fork(NUM_CORES, softmax_core_bw_fp16, act_args_fp16);
+}
+
+
+// Number of elements over which the running max is updated at once in the online softmax
+#define SOFTMAX_ONLINE_BLOCK_FP16 8
+
+static inline v2f16 vmax_fp16(v2f16 a, v2f16 b) {
+    v2s mask = (v2s) (a > b);
+    return (v2f16) ((mask & (v2s) a) | (~mask & (v2s) b));
+}
+
+
+// Online softmax: single fork, running max and sum in the first sweep of each row
+void pulp_softmax_online_fp16_fw_cl(void *act_args_fp16) {
+    pi_cl_team_fork(NUM_CORES, softmax_online_core_fw_fp16, act_args_fp16);
+}
+
+
+void softmax_online_core_fw_fp16(void *act_args_fp16) {
     struct softmax_args_fp16 *args = (struct softmax_args_fp16 *) act_args_fp16;
 
     int HEIGHT = args->H;
     int WIDTH = args->W;
 
-    fp16 *inDiff = args->input_diff;
+    fp16 *inData = args->input_data;
     fp16 *outData = args->output_data;
-    fp16 *outDiff = args->output_diff;
-
+    fp16 *maxes = args->maxes;
     fp16 *sums = args->sums;
 
-    // SM BW OP 1
-    struct sm_bw_op_1_args_fp16 op_1_args;
-    op_1_args.A = outDiff;
-    op_1_args.B = outData;
-    op_1_args.S = sums;
-    op_1_args.H = HEIGHT;
-    op_1_args.W = WIDTH;
+    // Split work row-wise (each worker will receive a number of rows)
+    const int blockSize = (HEIGHT + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > HEIGHT ? HEIGHT : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        fp16 *in = inData + i * WIDTH;
+        fp16 *out = outData + i * WIDTH;
+
+        // Sweep 1: the max is updated once per block, then the block exponentials are accumulated.
+        // The running sum is kept in fp32, since it is rescaled at every increase of the max.
+        fp16 max = in[0];
+        float sum = 0.0f;
+        int j = 0;
+        for (; j < WIDTH - 1; j += SOFTMAX_ONLINE_BLOCK_FP16) {
+            int blk_stop = j + SOFTMAX_ONLINE_BLOCK_FP16 > WIDTH ? WIDTH : j + SOFTMAX_ONLINE_BLOCK_FP16;
+
+            v2f16 vmax = (v2f16) {max, max};
+            int k = j;
+            for (; k < blk_stop - 1; k += 2)
+                vmax = vmax_fp16(vmax, *((v2f16 *) &in[k]));
+            fp16 blk_max = vmax[0] > vmax[1] ? vmax[0] : vmax[1];
+            if (k < blk_stop && in[k] > blk_max) blk_max = in[k];
+
+            if (blk_max > max) {
+                sum *= (float) vexp_fp16((v2f16) {max - blk_max, max - blk_max})[0];
+                max = blk_max;
+            }
+
+            v2f16 vm = (v2f16) {max, max};
+            v2f16 vsum = (v2f16) {0, 0};
+            for (k = j; k < blk_stop - 1; k += 2)
+                vsum += vexp_fp16(*((v2f16 *) &in[k]) - vm);
+            if (k < blk_stop)
+                vsum[0] += vexp_fp16((v2f16) {in[k] - max, in[k] - max})[0];
+            sum += (float) vsum[0] + (float) vsum[1];
+        }
+        if (j < WIDTH) {
+            // Single leftover element
+            fp16 x = in[j];
+            if (x > max) {
+                sum *= (float) vexp_fp16((v2f16) {max - x, max - x})[0];
+                max = x;
+            }
+            sum += (float) vexp_fp16((v2f16) {x - max, x - max})[0];
+        }
+
+        // Sweep 2: normalized output
+        fp16 inv_sum = (fp16) (1.0f / sum);
+        v2f16 vinv = (v2f16) {inv_sum, inv_sum};
+        v2f16 vm = (v2f16) {max, max};
+        j = 0;
+        for (; j < WIDTH - 1; j += 2)
+            *((v2f16 *) &out[j]) = vexp_fp16(*((v2f16 *) &in[j]) - vm) * vinv;
+        if (j < WIDTH)
+            out[j] = vexp_fp16((v2f16) {in[j] - max, in[j] - max})[0] * inv_sum;
+
+        if (maxes != NULL) maxes[i] = max;
+        if (sums != NULL) sums[i] = (fp16) sum;
+    }
+}
+
+
+void softmax_core_bw_fp16(void *act_args_fp16) {
+    struct softmax_args_fp16 *args = (struct softmax_args_fp16 *) act_args_fp16;
 
-    pi_cl_team_fork(NUM_CORES, pulp_sm_bw_op_1_fp16, &op_1_args);
+    int HEIGHT = args->H;
+    int WIDTH = args->W;
 
-    // SM BW OP 2
-    struct sm_bw_op_2_args_fp16 op_2_args;
-    op_2_args.A = outDiff;
-    op_2_args.B = outData;
-    op_2_args.S = sums;
-    op_2_args.output = inDiff;
-    op_2_args.H = HEIGHT;
-    op_2_args.W = WIDTH;
+    fp16 *inDiff = args->input_diff;
+    fp16 *outData = args->output_data;
+    fp16 *outDiff = args->output_diff;
+    fp16 *sums = args->sums;
 
-    pi_cl_team_fork(NUM_CORES, pulp_sm_bw_op_2_fp16, &op_2_args);
+    // Split work row-wise (each worker will receive a number of rows)
+    const int blockSize = (HEIGHT + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > HEIGHT ? HEIGHT : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        fp16 *y = outData + i * WIDTH;
+        fp16 *dy = outDiff + i * WIDTH;
+        fp16 *dx = inDiff + i * WIDTH;
+
+        v2f16 vdot = (v2f16) {0, 0};
+        int j = 0;
+        for (; j < WIDTH - 1; j += 2)
+            vdot += *((v2f16 *) &dy[j]) * *((v2f16 *) &y[j]);
+        fp16 dot = vdot[0] + vdot[1];
+        if (j < WIDTH) dot += dy[j] * y[j];
+
+        v2f16 vd = (v2f16) {dot, dot};
+        j = 0;
+        for (; j < WIDTH - 1; j += 2)
+            *((v2f16 *) &dx[j]) = (*((v2f16 *) &dy[j]) - vd) * *((v2f16 *) &y[j]);
+        if (j < WIDTH) dx[j] = (dy[j] - dot) * y[j];
+
+        if (sums != NULL) sums[i] = dot;
+    }
 }
 
 
@@ -476,4 +699,343 @@ void pulp_swiglu_fp16_cl(void *swiglu_args){
     val *= in2[i];
     out[i] = (fp16)val;
   }
-}
\ No newline at end of file
+}
+
+// With s = sigmoid(2 * sqrt(2/pi) * (x + 0.044715 * x^3)): gelu(x) = x * s, gelu'(x) = s + x * s * (1 - s) * 2 * sqrt(2/pi) * (1 + 3 * 0.044715 * x^2)
+v2f16 vgelu_deriv_fp16(v2f16 x, v2f16 *out) {
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+    v2f16 x_2 = x * x;
+    v2f16 s = vsigmoid_fp16((v2f16) {1.5957691216f, 1.5957691216f} * x * (one + (v2f16) {0.044715f, 0.044715f} * x_2));
+    v2f16 xs = x * s;
+    *out = xs;
+    return s + xs * (one - s) * (v2f16) {1.5957691216f, 1.5957691216f} * (one + (v2f16) {0.134145f, 0.134145f} * x_2);
+}
+
+
+void pulp_gelu_fp16_fw_cache_cl(void *void_args)
+{
+  struct gelu_train_args_fp16 * args = (struct gelu_train_args_fp16 *) void_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+  fp16* deriv = args->deriv;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  if (deriv == NULL) {
+    int i = start;
+    for (; i < stop-1; i+=2) {
+      *((v2f16 *) &outData[i]) = vgelu_fp16(*((v2f16 *) &inData[i]));
+    }
+    if (i < stop) {
+      outData[i] = vgelu_fp16((v2f16) {inData[i], inData[i]})[0];
+    }
+    return;
+  }
+
+  v2f16 y;
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    *((v2f16 *) &deriv[i]) = vgelu_deriv_fp16(*((v2f16 *) &inData[i]), &y);
+    *((v2f16 *) &outData[i]) = y;
+  }
+  if (i < stop) {
+    deriv[i] = vgelu_deriv_fp16((v2f16) {inData[i], inData[i]}, &y)[0];
+    outData[i] = y[0];
+  }
+}
+
+
+void pulp_gelu_fp16_bw_cl(void *void_args)
+{
+  struct gelu_train_args_fp16 * args = (struct gelu_train_args_fp16 *) void_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+  fp16* deriv = args->deriv;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  if (deriv != NULL) {
+    for (; i < stop-1; i+=2) {
+      *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]) * *((v2f16 *) &deriv[i]);
+    }
+    if (i < stop) {
+      inDiff[i] = outDiff[i] * deriv[i];
+    }
+  }
+  else {
+    v2f16 y;
+    for (; i < stop-1; i+=2) {
+      *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]) * vgelu_deriv_fp16(*((v2f16 *) &inData[i]), &y);
+    }
+    if (i < stop) {
+      inDiff[i] = outDiff[i] * vgelu_deriv_fp16((v2f16) {inData[i], inData[i]}, &y)[0];
+    }
+  }
+}
+
+
+void pulp_swiglu_fp16_fw_cache_cl(void *void_args)
+{
+  struct swiglu_train_args_fp16 * args = (struct swiglu_train_args_fp16 *) void_args;
+  int dim = args->in1->dim;
+  fp16* in1 = args->in1->data;
+  fp16* in2 = args->in2->data;
+  fp16* out = args->output->data;
+  fp16* sig = args->sig;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    v2f16 a = *((v2f16 *) &in1[i]);
+    v2f16 s = vsigmoid_fp16(a);
+    if (sig != NULL) *((v2f16 *) &sig[i]) = s;
+    *((v2f16 *) &out[i]) = a * s * *((v2f16 *) &in2[i]);
+  }
+  if (i < stop) {
+    fp16 s = vsigmoid_fp16((v2f16) {in1[i], in1[i]})[0];
+    if (sig != NULL) sig[i] = s;
+    out[i] = in1[i] * s * in2[i];
+  }
+}
+
+
+void pulp_swiglu_fp16_bw_cl(void *void_args)
+{
+  struct swiglu_train_args_fp16 * args = (struct swiglu_train_args_fp16 *) void_args;
+  int dim = args->in1->dim;
+  fp16* in1 = args->in1->data;
+  fp16* in2 = args->in2->data;
+  fp16* in1Diff = args->in1->diff;
+  fp16* in2Diff = args->in2->diff;
+  fp16* outDiff = args->output->diff;
+  fp16* sig = args->sig;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    v2f16 a = *((v2f16 *) &in1[i]);
+    v2f16 s = (sig != NULL) ? *((v2f16 *) &sig[i]) : vsigmoid_fp16(a);
+    v2f16 dy = *((v2f16 *) &outDiff[i]);
+    v2f16 silu = a * s;
+    *((v2f16 *) &in1Diff[i]) = dy * *((v2f16 *) &in2[i]) * (s + silu * (one - s));
+    *((v2f16 *) &in2Diff[i]) = dy * silu;
+  }
+  if (i < stop) {
+    fp16 a = in1[i];
+    fp16 s = (sig != NULL) ? sig[i] : vsigmoid_fp16((v2f16) {a, a})[0];
+    fp16 silu = a * s;
+    in1Diff[i] = outDiff[i] * in2[i] * (s + silu * ((fp16) 1.0f - s));
+    in2Diff[i] = outDiff[i] * silu;
+  }
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~ HARD-SIGMOID, HARD-SWISH, SILU ~~~~~~~~~~~~~~~~~~~~
+static inline v2f16 vsel_fp16(v2s mask, v2f16 a, v2f16 b) {
+    return (v2f16) ((mask & (v2s) a) | (~mask & (v2s) b));
+}
+
+// hsigmoid(x) = min(max(x / 6 + 0.5, 0), 1)
+static inline v2f16 vhsigmoid_fp16(v2f16 x) {
+    const v2f16 zero = (v2f16) {0.0f, 0.0f};
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+    v2f16 y = x * (v2f16) {1.0f/6.0f, 1.0f/6.0f} + (v2f16) {0.5f, 0.5f};
+    y = vsel_fp16((v2s) (y > one), one, y);
+    return vsel_fp16((v2s) (y < zero), zero, y);
+}
+
+
+void pulp_hsigmoid_fp16_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hsigmoid_core_fw_fp16, act_args);
+}
+
+void pulp_hsigmoid_fp16_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hsigmoid_core_bw_fp16, act_args);
+}
+
+void hsigmoid_core_fw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    *((v2f16 *) &outData[i]) = vhsigmoid_fp16(*((v2f16 *) &inData[i]));
+  }
+  if (i < stop) {
+    outData[i] = vhsigmoid_fp16((v2f16) {inData[i], inData[i]})[0];
+  }
+}
+
+void hsigmoid_core_bw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  const v2f16 three = (v2f16) {3.0f, 3.0f};
+  const v2f16 sixth = (v2f16) {1.0f/6.0f, 1.0f/6.0f};
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    v2f16 x = *((v2f16 *) &inData[i]);
+    v2s inside = (v2s) (x > -three) & (v2s) (x < three);
+    *((v2f16 *) &inDiff[i]) = vsel_fp16(inside, *((v2f16 *) &outDiff[i]) * sixth, (v2f16) {0.0f, 0.0f});
+  }
+  if (i < stop) {
+    fp16 x = inData[i];
+    inDiff[i] = (x > (fp16) -3.0f && x < (fp16) 3.0f) ? outDiff[i] * sixth[0] : (fp16) 0.0f;
+  }
+}
+
+
+void pulp_hswish_fp16_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hswish_core_fw_fp16, act_args);
+}
+
+void pulp_hswish_fp16_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hswish_core_bw_fp16, act_args);
+}
+
+void hswish_core_fw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    v2f16 x = *((v2f16 *) &inData[i]);
+    *((v2f16 *) &outData[i]) = x * vhsigmoid_fp16(x);
+  }
+  if (i < stop) {
+    outData[i] = inData[i] * vhsigmoid_fp16((v2f16) {inData[i], inData[i]})[0];
+  }
+}
+
+void hswish_core_bw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  const v2f16 three = (v2f16) {3.0f, 3.0f};
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    // hswish'(x) = 0 for x < -3, 1 for x > 3, x / 3 + 0.5 otherwise
+    v2f16 x = *((v2f16 *) &inData[i]);
+    v2f16 d = x * (v2f16) {1.0f/3.0f, 1.0f/3.0f} + (v2f16) {0.5f, 0.5f};
+    d = vsel_fp16((v2s) (x > three), (v2f16) {1.0f, 1.0f}, d);
+    d = vsel_fp16((v2s) (x < -three), (v2f16) {0.0f, 0.0f}, d);
+    *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]) * d;
+  }
+  if (i < stop) {
+    fp16 x = inData[i];
+    fp16 d = x < (fp16) -3.0f ? (fp16) 0.0f : (x > (fp16) 3.0f ? (fp16) 1.0f : x * (fp16) (1.0f/3.0f) + (fp16) 0.5f);
+    inDiff[i] = outDiff[i] * d;
+  }
+}
+
+
+void pulp_silu_fp16_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, silu_core_fw_fp16, act_args);
+}
+
+void pulp_silu_fp16_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, silu_core_bw_fp16, act_args);
+}
+
+void silu_core_fw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* outData = args->output->data;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    v2f16 x = *((v2f16 *) &inData[i]);
+    *((v2f16 *) &outData[i]) = x * vsigmoid_fp16(x);
+  }
+  if (i < stop) {
+    outData[i] = inData[i] * vsigmoid_fp16((v2f16) {inData[i], inData[i]})[0];
+  }
+}
+
+void silu_core_bw_fp16( void * act_args )
+{
+  struct act_args_fp16 * args = (struct act_args_fp16 *) act_args;
+  int dim = args->input->dim;
+  fp16* inData = args->input->data;
+  fp16* inDiff = args->input->diff;
+  fp16* outDiff = args->output->diff;
+
+  const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+  int i = start;
+  for (; i < stop-1; i+=2) {
+    // silu'(x) = s * (1 + x * (1 - s)), with s = sigmoid(x)
+    v2f16 x = *((v2f16 *) &inData[i]);
+    v2f16 s = vsigmoid_fp16(x);
+    *((v2f16 *) &inDiff[i]) = *((v2f16 *) &outDiff[i]) * s * (one + x * (one - s));
+  }
+  if (i < stop) {
+    fp16 x = inData[i];
+    fp16 s = vsigmoid_fp16((v2f16) {x, x})[0];
+    inDiff[i] = outDiff[i] * s * ((fp16) 1.0f + x * ((fp16) 1.0f - s));
+  }
+}
@@ -181,6 +181,123 @@ void leakyrelu_core_bw_fp32( void * leakyrelu_args )
 
 
 
+void pulp_relu_mask_fp32_fw_cl( void * relu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, relu_mask_core_fw_fp32, relu_mask_args);
+}
+
+void pulp_relu_mask_fp32_bw_cl( void * relu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, relu_mask_core_bw_fp32, relu_mask_args);
+}
+
+void relu_mask_core_fw_fp32( void * relu_mask_args )
+{
+  struct relu_mask_args * args = (struct relu_mask_args *) relu_mask_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+  uint32_t* mask = args->mask;
+
+  // Blocks are multiple of 32 elements, so that each mask word is written by a single core
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = 0;
+    for (int k = 0; k < n; k++) {
+      float x = inData[i+k];
+      if (x > 0) { bits |= (1U << k); outData[i+k] = x; }
+      else outData[i+k] = 0;
+    }
+    mask[i >> 5] = bits;
+  }
+}
+
+void relu_mask_core_bw_fp32( void * relu_mask_args )
+{
+  struct relu_mask_args * args = (struct relu_mask_args *) relu_mask_args;
+  int dim = args->input->dim;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+  uint32_t* mask = args->mask;
+
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = mask[i >> 5];
+    for (int k = 0; k < n; k++) {
+      inDiff[i+k] = (bits >> k) & 0x1 ? outDiff[i+k] : 0;
+    }
+  }
+}
+
+
+void pulp_leakyrelu_mask_fp32_fw_cl( void * leakyrelu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_fw_fp32, leakyrelu_mask_args);
+}
+
+void pulp_leakyrelu_mask_fp32_bw_cl( void * leakyrelu_mask_args )
+{
+  pi_cl_team_fork(NUM_CORES, leakyrelu_mask_core_bw_fp32, leakyrelu_mask_args);
+}
+
+void leakyrelu_mask_core_fw_fp32( void * leakyrelu_mask_args )
+{
+  struct leakyrelu_mask_args * args = (struct leakyrelu_mask_args *) leakyrelu_mask_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+  float neg_slope = args->negative_slope;
+  uint32_t* mask = args->mask;
+
+  // Blocks are multiple of 32 elements, so that each mask word is written by a single core
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = 0;
+    for (int k = 0; k < n; k++) {
+      float x = inData[i+k];
+      if (x > 0) { bits |= (1U << k); outData[i+k] = x; }
+      else outData[i+k] = x*neg_slope;
+    }
+    mask[i >> 5] = bits;
+  }
+}
+
+void leakyrelu_mask_core_bw_fp32( void * leakyrelu_mask_args )
+{
+  struct leakyrelu_mask_args * args = (struct leakyrelu_mask_args *) leakyrelu_mask_args;
+  int dim = args->input->dim;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+  float neg_slope = args->negative_slope;
+  uint32_t* mask = args->mask;
+
+  const int blockSize=ACT_MASK_BLOCK(dim);
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i += 32) {
+    int n = stop - i > 32 ? 32 : stop - i;
+    uint32_t bits = mask[i >> 5];
+    for (int k = 0; k < n; k++) {
+      inDiff[i+k] = (bits >> k) & 0x1 ? outDiff[i+k] : outDiff[i+k]*neg_slope;
+    }
+  }
+}
+
+
+
 // ~~~~~~~~~~~~~~~~~~~~ SOFTMAX ~~~~~~~~~~~~~~~~~~~~
 // Forward pass of the FP32 softmax
 // Performs a softmax activation on each row
@@ -356,8 +473,80 @@ void pulp_softmax_fp32_bw_cl(void *act_args) {
      *      - d_i -> inDiff[row, i]
      *      - Si  -> outData[row, i]
      *      - (outDiff[0] * S0 + outDiff[1] * S1 + ... + outDiff[j] * Sj + ...) -> sum
+     *
+     * Both the row sum and the gradient are computed by each core on its rows within a single fork.
      */
-    // Extract variables from function arguments
+    pi_cl_team_fork(NUM_CORES, softmax_core_bw_fp32, act_args);
+}
+
+
+// Online softmax: single fork, running max and sum in the first sweep of each row
+#ifdef FASTEXPF
+#define SOFTMAX_EXP_FP32(x) fastexp_gist(x)
+#else
+#define SOFTMAX_EXP_FP32(x) expf(x)
+#endif
+
+void pulp_softmax_online_fp32_fw_cl(void *act_args) {
+    pi_cl_team_fork(NUM_CORES, softmax_online_core_fw_fp32, act_args);
+
+    #ifdef DEBUG
+    struct softmax_args *args = (struct softmax_args *) act_args;
+    printf("\nCurrent softmax output: %d %d\n", args->H, args->W);
+    for (int j=0; j<args->H*args->W; j++){
+        if(!(j%((int)args->W))) printf("\n");
+        printf("%.8f ", args->output_data[j]);
+    }
+    printf("\n");
+    #endif
+}
+
+
+void softmax_online_core_fw_fp32(void *act_args) {
+    struct softmax_args *args = (struct softmax_args *) act_args;
+
+    int HEIGHT = args->H;
+    int WIDTH = args->W;
+
+    float *inData = args->input_data;
+    float *outData = args->output_data;
+    float *maxes = args->maxes;
+    float *sums = args->sums;
+
+    // Split work row-wise (each worker will receive a number of rows)
+    const int blockSize = (HEIGHT + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > HEIGHT ? HEIGHT : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        float *in = inData + i * WIDTH;
+        float *out = outData + i * WIDTH;
+
+        // Sweep 1: running max and sum, rescaling the sum whenever the max increases
+        float max = in[0];
+        float sum = 1.0f;
+        for (int j = 1; j < WIDTH; j++) {
+            float x = in[j];
+            if (x > max) {
+                sum = sum * SOFTMAX_EXP_FP32(max - x) + 1.0f;
+                max = x;
+            }
+            else
+                sum += SOFTMAX_EXP_FP32(x - max);
+        }
+
+        // Sweep 2: normalized output
+        float inv_sum = 1.0f / sum;
+        for (int j = 0; j < WIDTH; j++)
+            out[j] = SOFTMAX_EXP_FP32(in[j] - max) * inv_sum;
+
+        if (maxes != NULL) maxes[i] = max;
+        if (sums != NULL) sums[i] = sum;
+    }
+}
+
+
+void softmax_core_bw_fp32(void *act_args) {
     struct softmax_args *args = (struct softmax_args *) act_args;
 
     int HEIGHT = args->H;
@@ -366,29 +555,25 @@ void pulp_softmax_fp32_bw_cl(void *act_args) {
     float *inDiff = args->input_diff;
     float *outData = args->output_data;
     float *outDiff = args->output_diff;
-
     float *sums = args->sums;
 
-    // SM BW OP 1
-    struct sm_bw_op_1_args op_1_args;
-    op_1_args.A = outDiff;
-    op_1_args.B = outData;
-    op_1_args.S = sums;
-    op_1_args.H = HEIGHT;
-    op_1_args.W = WIDTH;
+    // Split work row-wise (each worker will receive a number of rows)
+    const int blockSize = (HEIGHT + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > HEIGHT ? HEIGHT : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        int row = i * WIDTH;
 
-    pi_cl_team_fork(NUM_CORES, pulp_sm_bw_op_1, &op_1_args);
+        float dot = 0.0f;
+        for (int j = 0; j < WIDTH; j++)
+            dot += outDiff[row + j] * outData[row + j];
 
-    // SM BW OP 2
-    struct sm_bw_op_2_args op_2_args;
-    op_2_args.A = outDiff;
-    op_2_args.B = outData;
-    op_2_args.S = sums;
-    op_2_args.output = inDiff;
-    op_2_args.H = HEIGHT;
-    op_2_args.W = WIDTH;
+        for (int j = 0; j < WIDTH; j++)
+            inDiff[row + j] = (outDiff[row + j] - dot) * outData[row + j];
 
-    pi_cl_team_fork(NUM_CORES, pulp_sm_bw_op_2, &op_2_args);
+        if (sums != NULL) sums[i] = dot;
+    }
 }
 
 
@@ -744,3 +929,269 @@ void pulp_gelu_tanh_approx_fp32_fw_cl(void *void_args) {
         outData[i] = val;
     }
 }
+
+
+void pulp_gelu_tanh_approx_fp32_fw_cache_cl(void *void_args) {
+    struct gelu_train_args *args = (struct gelu_train_args *) void_args;
+
+    int dim = args->input->dim;
+    float *inData = args->input->data;
+    float *outData = args->output->data;
+    float *deriv = args->deriv;
+
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        float x = inData[i];
+        float t = gelu_tanh_pade(((x * x * x * 0.044715f) + x) * 0.7978f);
+
+        outData[i] = 0.5f * x * (1.0f + t);
+        if (deriv != NULL) deriv[i] = gelu_tanh_deriv(x, t);
+    }
+}
+
+
+void pulp_gelu_tanh_approx_fp32_bw_cl(void *void_args) {
+    struct gelu_train_args *args = (struct gelu_train_args *) void_args;
+
+    int dim = args->input->dim;
+    float *inData = args->input->data;
+    float *inDiff = args->input->diff;
+    float *outDiff = args->output->diff;
+    float *deriv = args->deriv;
+
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    if (deriv != NULL) {
+        for (int i = start; i < stop; i++)
+            inDiff[i] = outDiff[i] * deriv[i];
+    }
+    else {
+        for (int i = start; i < stop; i++) {
+            float x = inData[i];
+            float t = gelu_tanh_pade(((x * x * x * 0.044715f) + x) * 0.7978f);
+            inDiff[i] = outDiff[i] * gelu_tanh_deriv(x, t);
+        }
+    }
+}
+
+
+void pulp_swiglu_fp32_fw_cache_cl(void *void_args) {
+    struct swiglu_train_args *args = (struct swiglu_train_args *) void_args;
+
+    int dim = args->in1->dim;
+    float *in1 = args->in1->data;
+    float *in2 = args->in2->data;
+    float *out = args->output->data;
+    float *sig = args->sig;
+
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        float a = in1[i];
+
+        #ifdef FASTEXPF
+        float s = 1.0f / (1.0f + fastexp_gist(-a));
+        #else
+        float s = 1.0f / (1.0f + expf(-a));
+        #endif
+
+        if (sig != NULL) sig[i] = s;
+        out[i] = a * s * in2[i];
+    }
+}
+
+
+void pulp_swiglu_fp32_bw_cl(void *void_args) {
+    struct swiglu_train_args *args = (struct swiglu_train_args *) void_args;
+
+    int dim = args->in1->dim;
+    float *in1 = args->in1->data;
+    float *in2 = args->in2->data;
+    float *in1Diff = args->in1->diff;
+    float *in2Diff = args->in2->diff;
+    float *outDiff = args->output->diff;
+    float *sig = args->sig;
+
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        float a = in1[i];
+        float s;
+
+        if (sig != NULL) s = sig[i];
+        else {
+            #ifdef FASTEXPF
+            s = 1.0f / (1.0f + fastexp_gist(-a));
+            #else
+            s = 1.0f / (1.0f + expf(-a));
+            #endif
+        }
+
+        float dy = outDiff[i];
+        float silu = a * s;
+
+        in1Diff[i] = dy * in2[i] * (s + silu * (1.0f - s));
+        in2Diff[i] = dy * silu;
+    }
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~ HARD-SIGMOID, HARD-SWISH, SILU ~~~~~~~~~~~~~~~~~~~~
+void pulp_hsigmoid_fp32_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hsigmoid_core_fw_fp32, act_args);
+}
+
+void pulp_hsigmoid_fp32_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hsigmoid_core_bw_fp32, act_args);
+}
+
+void hsigmoid_core_fw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float y = inData[i] * (1.0f/6.0f) + 0.5f;
+    outData[i] = y > 1.0f ? 1.0f : (y < 0.0f ? 0.0f : y);
+  }
+}
+
+void hsigmoid_core_bw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float x = inData[i];
+    inDiff[i] = (x > -3.0f && x < 3.0f) ? outDiff[i] * (1.0f/6.0f) : 0.0f;
+  }
+}
+
+
+void pulp_hswish_fp32_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hswish_core_fw_fp32, act_args);
+}
+
+void pulp_hswish_fp32_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, hswish_core_bw_fp32, act_args);
+}
+
+void hswish_core_fw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float x = inData[i];
+    float y = x * (1.0f/6.0f) + 0.5f;
+    y = y > 1.0f ? 1.0f : (y < 0.0f ? 0.0f : y);
+    outData[i] = x * y;
+  }
+}
+
+void hswish_core_bw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float x = inData[i];
+    float d = x < -3.0f ? 0.0f : (x > 3.0f ? 1.0f : x * (1.0f/3.0f) + 0.5f);
+    inDiff[i] = outDiff[i] * d;
+  }
+}
+
+
+void pulp_silu_fp32_fw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, silu_core_fw_fp32, act_args);
+}
+
+void pulp_silu_fp32_bw_cl( void * act_args )
+{
+  pi_cl_team_fork(NUM_CORES, silu_core_bw_fp32, act_args);
+}
+
+void silu_core_fw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* outData = args->output->data;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float x = inData[i];
+    #ifdef FASTEXPF
+    outData[i] = x / (1.0f + fastexp_gist(-x));
+    #else
+    outData[i] = x / (1.0f + expf(-x));
+    #endif
+  }
+}
+
+void silu_core_bw_fp32( void * act_args )
+{
+  struct act_args * args = (struct act_args *) act_args;
+  int dim = args->input->dim;
+  float* inData = args->input->data;
+  float* inDiff = args->input->diff;
+  float* outDiff = args->output->diff;
+
+  const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+  const int start = pi_core_id()*blockSize;
+  const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+  for (int i = start; i < stop; i++) {
+    float x = inData[i];
+    #ifdef FASTEXPF
+    float s = 1.0f / (1.0f + fastexp_gist(-x));
+    #else
+    float s = 1.0f / (1.0f + expf(-x));
+    #endif
+    // silu'(x) = s * (1 + x * (1 - s))
+    inDiff[i] = outDiff[i] * s * (1.0f + x * (1.0f - s));
+  }
+}
@@ -37,15 +37,15 @@ void pulp_dropout_fp16_cl(void * dropout_args){
     int size = args->size;
     int seed = args->seed;
 
-    const uint32_t blockSize = (size+NUM_CORES-1) / NUM_CORES;
-    const uint32_t start = pi_core_id()*blockSize;
-    const uint32_t stop = start+blockSize > size ? size : start+blockSize;
+    const int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > size ? size : start+blockSize;
 
     seed = seed + start;
 
     float rand;
 
-    for (uint32_t i=start; i < stop; i++){
+    for (int i=start; i < stop; i++){
         rand = pulp_generate_float_seed(seed);
         seed++;
         if(use_mask){
@@ -62,3 +62,69 @@ void pulp_dropout_fp16_cl(void * dropout_args){
     }
 }
 
+
+void pulp_dropout_mask_fp16_cl(void * dropout_args){
+    struct dropout_args_fp16* args = (struct dropout_args_fp16*)dropout_args;
+    fp16 prob = args->probability;
+    fp16 scale = (fp16)(1.0f / (1.0f - prob));
+    fp16* input = args->input;
+    int use_mask = args->use_mask;
+    fp16* mask = args->mask;
+    uint32_t* bitmask = args->bitmask;
+    int size = args->size;
+    int seed = args->seed;
+
+    // Blocks are multiple of 32 elements, so that each mask word is written by a single core
+    const int blockSize = ACT_MASK_BLOCK(size);
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > size ? size : start+blockSize;
+
+    seed = seed + start;
+
+    float rand;
+
+    for (int i=start; i < stop; i+=32){
+        int n = stop - i > 32 ? 32 : stop - i;
+        uint32_t bits = 0;
+        for (int k=0; k < n; k++){
+            rand = pulp_generate_float_seed(seed);
+            seed++;
+            if(use_mask){
+                if(mask[i+k] != 0) bits |= (1U << k);
+                input[i+k] = mask[i+k] * input[i+k];
+            }
+            else{
+                if(rand > prob){
+                    bits |= (1U << k);
+                    input[i+k] = input[i+k] * scale;
+                }
+                else{
+                    input[i+k] = (fp16)0.0f;
+                }
+            }
+        }
+        bitmask[i >> 5] = bits;
+    }
+}
+
+
+void pulp_dropout_mask_fp16_bw_cl(void * dropout_args){
+    struct dropout_args_fp16* args = (struct dropout_args_fp16*)dropout_args;
+    fp16 prob = args->probability;
+    fp16 scale = (fp16)(1.0f / (1.0f - prob));
+    fp16* grad = args->input;
+    uint32_t* bitmask = args->bitmask;
+    int size = args->size;
+
+    const int blockSize = ACT_MASK_BLOCK(size);
+    const int start = pi_core_id()*blockSize;
+    const int stop = start+blockSize > size ? size : start+blockSize;
+
+    for (int i=start; i < stop; i+=32){
+        int n = stop - i > 32 ? 32 : stop - i;
+        uint32_t bits = bitmask[i >> 5];
+        for (int k=0; k < n; k++){
+            grad[i+k] = (bits >> k) & 0x1 ? grad[i+k] * scale : (fp16)0.0f;
+        }
+    }
+}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2024 University of Bologna
+ * All rights reserved.
+ *
+ * This software may be modified and distributed under the terms
+ * of the BSD license.  See the LICENSE file for details.
+ *
+ * Authors: Alberto Dequino (alberto.dequino@unibo.it)
+ */
+
+ #include "pulp_train_utils_fp32.h"
+ #include "pulp_embedding_fp32.h"
+ #include "pulp_train_defines.h"
+ #include "pmsis.h"
+ #include "math.h"
+
+ // FORWARD, TILED
+ 
+ void embedding_fw_tiled_fp32(void *embedding_args){
+    struct Embedding_args *args = (struct Embedding_args*) embedding_args;
+
+    float *BUFF = args->BUFF;
+
+    int dim = args->dim;
+    int embed_dim = args->embed_dim;
+
+    pi_cl_dma_cmd_t cmd_store;
+    pi_cl_dma_cmd_t cmd_load;
+
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+
+    for(int i = start; i < stop; i++){
+        int id = (args->ids)[i];
+        pi_cl_dma_cmd((uint32_t) (args->embeds + id * embed_dim), (uint32_t) (BUFF + (int) (pi_core_id()) * embed_dim), 4 * embed_dim, PI_CL_DMA_DIR_EXT2LOC, &cmd_load);
+        pi_cl_dma_cmd_wait(&cmd_load);
+        pi_cl_dma_cmd((uint32_t) (args->out + i * embed_dim), (uint32_t) (BUFF + (int) (pi_core_id()) * embed_dim), 4 * embed_dim, PI_CL_DMA_DIR_LOC2EXT, &cmd_store);
+        pi_cl_dma_cmd_wait(&cmd_store);
+    }
+ }
+
+
+
+ // FORWARD, TILED, DOUBLE BUFFERED
+
+ // Gathers the rows of tokens [first, first+n) into buf, merging runs of consecutive ids into one transfer
+ static inline void embedding_gather_fp32(struct Embedding_args *args, int first, int n, float *buf, pi_cl_dma_copy_t *copy){
+    int embed_dim = args->embed_dim;
+    int *ids = args->ids;
+
+    int r = 0;
+    while (r < n) {
+        int run = 1;
+        while (r + run < n && ids[first + r + run] == ids[first + r] + run) run++;
+        copy->ext = (uint32_t) (args->embeds + ids[first + r] * embed_dim);
+        copy->loc = (uint32_t) (buf + r * embed_dim);
+        copy->size = 4 * run * embed_dim;
+        copy->merge = (r > 0);
+        pi_cl_dma_memcpy(copy);
+        r += run;
+    }
+ }
+
+ void embedding_fw_tiled_fp32_dblbuffer(void *embedding_args){
+    struct Embedding_args *args = (struct Embedding_args*) embedding_args;
+
+    int dim = args->dim;
+    int embed_dim = args->embed_dim;
+    int rows = args->rows_per_dma;
+
+    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > dim ? dim : start+blockSize;
+    if (start >= stop) return;
+
+    // Two batches of rows per core
+    float *buff[2];
+    buff[0] = args->BUFF + pi_core_id() * 2 * rows * embed_dim;
+    buff[1] = buff[0] + rows * embed_dim;
+
+    pi_cl_dma_copy_t copy_in[2], copy_out[2];
+    for (int b = 0; b < 2; b++) {
+        copy_in[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy_in[b].id = 0;
+        copy_in[b].merge = 0;
+        copy_out[b].dir = PI_CL_DMA_DIR_LOC2EXT;
+        copy_out[b].id = 0;
+        copy_out[b].merge = 0;
+    }
+
+    const int n_batches = (stop - start + rows - 1) / rows;
+    int n = (stop - start) < rows ? (stop - start) : rows;
+    embedding_gather_fp32(args, start, n, buff[0], &copy_in[0]);
+
+    for (int batch = 0; batch < n_batches; batch++) {
+        int cur = batch & 1;
+        int first = start + batch * rows;
+        n = (stop - first) < rows ? (stop - first) : rows;
+
+        pi_cl_dma_wait(&copy_in[cur]);
+
+        // Output rows are contiguous, a single transfer stores the whole batch
+        copy_out[cur].ext = (uint32_t) (args->out + first * embed_dim);
+        copy_out[cur].loc = (uint32_t) buff[cur];
+        copy_out[cur].size = 4 * n * embed_dim;
+        pi_cl_dma_memcpy(&copy_out[cur]);
+
+        // Gather the next batch once the other buffer has been stored
+        if (batch + 1 < n_batches) {
+            int next_first = first + rows;
+            int next_n = (stop - next_first) < rows ? (stop - next_first) : rows;
+            if (batch >= 1) pi_cl_dma_wait(&copy_out[cur ^ 1]);
+            embedding_gather_fp32(args, next_first, next_n, buff[cur ^ 1], &copy_in[cur ^ 1]);
+        }
+    }
+
+    pi_cl_dma_wait(&copy_out[(n_batches - 1) & 1]);
+    if (n_batches >= 2) pi_cl_dma_wait(&copy_out[n_batches & 1]);
+ }
+
+
+
+ // BACKWARD, SPARSE
+
+ void pulp_embedding_fp32_bw_cl(void *embedding_bw_args){
+    struct Embedding_bw_args *args = (struct Embedding_bw_args*) embedding_bw_args;
+
+    int dim = args->dim;
+    int *ids = args->ids;
+    int *row_ids = args->row_ids;
+    int *row_ptr = args->row_ptr;
+    int *token_idx = args->token_idx;
+
+    // Distinct rows in order of first appearance, with the number of tokens of each
+    int n_rows = 0;
+    for (int i = 0; i < dim; i++) {
+        int r = 0;
+        while (r < n_rows && row_ids[r] != ids[i]) r++;
+        if (r == n_rows) {
+            row_ids[n_rows] = ids[i];
+            row_ptr[n_rows + 1] = 0;
+            n_rows++;
+        }
+        row_ptr[r + 1]++;
+    }
+    args->n_rows = n_rows;
+
+    // Group the tokens by distinct row, row_ptr[r] is used as insertion cursor and shifted back afterwards
+    row_ptr[0] = 0;
+    for (int r = 0; r < n_rows; r++) row_ptr[r + 1] += row_ptr[r];
+    for (int i = 0; i < dim; i++) {
+        int r = 0;
+        while (row_ids[r] != ids[i]) r++;
+        token_idx[row_ptr[r]++] = i;
+    }
+    for (int r = n_rows; r > 0; r--) row_ptr[r] = row_ptr[r - 1];
+    row_ptr[0] = 0;
+
+    pi_cl_team_fork(NUM_CORES, embedding_bw_accumulate_fp32, args);
+ }
+
+ void pulp_embedding_fp32_sparse_update_cl(void *embedding_update_args){
+    struct Embedding_update_args *args = (struct Embedding_update_args*) embedding_update_args;
+
+    struct embedding_update_core_args core_args;
+    core_args.args = args;
+    core_args.lr_t = args->learning_rate;
+    if (args->optimizer == EMBEDDING_ADAM) {
+        core_args.lr_t *= sqrtf(1.0f - powf(args->beta2, (float) args->step)) / (1.0f - powf(args->beta1, (float) args->step));
+    }
+
+    pi_cl_team_fork(NUM_CORES, embedding_sparse_update_fp32, &core_args);
+ }
+
+
+
+ // KERNELS
+
+ void embedding_bw_accumulate_fp32(void *embedding_bw_args){
+    struct Embedding_bw_args *args = (struct Embedding_bw_args*) embedding_bw_args;
+
+    int embed_dim = args->embed_dim;
+    int n_rows = args->n_rows;
+    int *row_ptr = args->row_ptr;
+    int *token_idx = args->token_idx;
+    float *out_diff = args->out_diff;
+    float *row_diff = args->row_diff;
+
+    // Every distinct row belongs to one core, no two cores write the same gradient
+    const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+    for (int r = start; r < stop; r++) {
+        for (int j = 0; j < embed_dim; j++) {
+            float acc = 0.0f;
+            for (int t = row_ptr[r]; t < row_ptr[r + 1]; t++)
+                acc += out_diff[token_idx[t] * embed_dim + j];
+            row_diff[r * embed_dim + j] = acc;
+        }
+    }
+ }
+
+ void embedding_sparse_update_fp32(void *embedding_update_core_args){
+    struct embedding_update_core_args *core_args = (struct embedding_update_core_args*) embedding_update_core_args;
+    struct Embedding_update_args *args = core_args->args;
+
+    int embed_dim = args->grad->embed_dim;
+    int n_rows = args->grad->n_rows;
+    int *row_ids = args->grad->row_ids;
+    float *row_diff = args->grad->row_diff;
+    float lr_t = core_args->lr_t;
+    int adam = (args->optimizer == EMBEDDING_ADAM);
+    float beta1 = args->beta1;
+    float beta2 = args->beta2;
+    float eps = args->epsilon;
+
+    const int blockSize=(n_rows+NUM_CORES-1)/NUM_CORES;
+    const int start = pi_core_id()*blockSize;
+    const int stop = start + blockSize > n_rows ? n_rows : start+blockSize;
+
+    float *w = args->BUFF + pi_core_id() * 3 * embed_dim;
+    float *m = w + embed_dim;
+    float *v = m + embed_dim;
+
+    pi_cl_dma_cmd_t cmd_w, cmd_m, cmd_v;
+
+    for (int r = start; r < stop; r++) {
+        int row = row_ids[r] * embed_dim;
+        float *g = row_diff + r * embed_dim;
+
+        pi_cl_dma_cmd((uint32_t) (args->embeds + row), (uint32_t) w, 4 * embed_dim, PI_CL_DMA_DIR_EXT2LOC, &cmd_w);
+        if (adam) {
+            pi_cl_dma_cmd((uint32_t) (args->m + row), (uint32_t) m, 4 * embed_dim, PI_CL_DMA_DIR_EXT2LOC, &cmd_m);
+            pi_cl_dma_cmd((uint32_t) (args->v + row), (uint32_t) v, 4 * embed_dim, PI_CL_DMA_DIR_EXT2LOC, &cmd_v);
+            pi_cl_dma_cmd_wait(&cmd_m);
+            pi_cl_dma_cmd_wait(&cmd_v);
+        }
+        pi_cl_dma_cmd_wait(&cmd_w);
+
+        if (adam) {
+            for (int j = 0; j < embed_dim; j++) {
+                float gj = g[j];
+                float mj = beta1 * m[j] + (1.0f - beta1) * gj;
+                float vj = beta2 * v[j] + (1.0f - beta2) * gj * gj;
+                m[j] = mj;
+                v[j] = vj;
+                w[j] -= lr_t * mj / (sqrtf(vj) + eps);
+            }
+        }
+        else {
+            for (int j = 0; j < embed_dim; j++) 
+                w[j] -= lr_t * g[j];
+        }
+
+        pi_cl_dma_cmd((uint32_t) (args->embeds + row), (uint32_t) w, 4 * embed_dim, PI_CL_DMA_DIR_LOC2EXT, &cmd_w);
+        if (adam) {
+            pi_cl_dma_cmd((uint32_t) (args->m + row), (uint32_t) m, 4 * embed_dim, PI_CL_DMA_DIR_LOC2EXT, &cmd_m);
+            pi_cl_dma_cmd((uint32_t) (args->v + row), (uint32_t) v, 4 * embed_dim, PI_CL_DMA_DIR_LOC2EXT, &cmd_v);
+            pi_cl_dma_cmd_wait(&cmd_m);
+            pi_cl_dma_cmd_wait(&cmd_v);
+        }
+        pi_cl_dma_cmd_wait(&cmd_w);
+    }
+ }
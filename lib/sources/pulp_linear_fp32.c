@@ -54,6 +54,11 @@ void pulp_linear_fp32_fw_cl( void * Linear_args )
   man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE;
   pi_cl_team_fork(NUM_CORES, pulp_linear_fp32_fw_cl_kernel, &man_args);
 
+  if (FC_args->lora_rank > 0) 
+  {
+    pi_cl_team_fork(NUM_CORES, pulp_linear_fp32_lora_fw_cl_kernel, FC_args);
+  }
+
   #ifdef DEBUG 
     printf("\nLinear OutData: %d\n", matMul_args.N);
     for (int i=0; i<FC_args->output->dim; i++){
@@ -85,6 +90,14 @@ void pulp_linear_fp32_bw_cl( void * Linear_args )
 void pulp_linear_fp32_bw_param_grads_cl( void * Linear_args )
 {
   struct Linear_args * FC_args = (struct Linear_args *) Linear_args;
+
+  // LoRA: coeff and bias are frozen, only the adapter gets a gradient
+  if (FC_args->lora_rank > 0)
+  {
+    pi_cl_team_fork(NUM_CORES, pulp_linear_fp32_lora_bw_param_grads_cl_kernel, FC_args);
+    return;
+  }
+
   float *coeffData = FC_args->coeff->data;
   float *inData = FC_args->input->data;
   float *outData = FC_args->output->data;
@@ -179,6 +192,11 @@ void pulp_linear_fp32_bw_input_grads_cl( void * Linear_args )
   pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
   #endif
 
+  if (FC_args->lora_rank > 0)
+  {
+    pi_cl_team_fork(NUM_CORES, pulp_linear_fp32_lora_bw_input_grads_cl_kernel, FC_args);
+  }
+
   #ifdef DEBUG 
   printf("\nLinear outDiff (coeffData.T * inDiff)");
 
@@ -265,3 +283,132 @@ void pulp_linear_fp32_bw_param_grads_cl_kernel( void * man_args )
   }
   
 }
+
+
+
+// LoRA: output = coeff * input + bias + lora_B * (lora_scale * lora_A * input)
+
+// lora_hidden->diff = lora_scale * lora_B^T * outDiff, split over the rank
+static inline void pulp_linear_fp32_lora_hidden_grad( struct Linear_args * FC_args )
+{
+  float *__restrict__ outDiff = FC_args->output->diff;
+  float *__restrict__ loraB = FC_args->lora_B->data;
+  float *__restrict__ hiddenDiff = FC_args->lora_hidden->diff;
+
+  const uint32_t N = FC_args->output->dim;
+  const uint32_t R = FC_args->lora_rank;
+  const float scale = FC_args->lora_scale;
+
+  const uint32_t blockSize = (R+NUM_CORES-1) / NUM_CORES;
+  const uint32_t start = pi_core_id()*blockSize;
+  const uint32_t stop = start+blockSize > R ? R : start+blockSize;
+
+  for (uint32_t r=start; r < stop; r++) {
+    float acc = 0.0f;
+    for (uint32_t i=0; i < N; i++)
+      acc += loraB[i*R+r] * outDiff[i];
+    hiddenDiff[r] = scale * acc;
+  }
+}
+
+void pulp_linear_fp32_lora_fw_cl_kernel( void * Linear_args )
+{
+  struct Linear_args * FC_args = (struct Linear_args *) Linear_args;
+  float *__restrict__ inData = FC_args->input->data;
+  float *__restrict__ outData = FC_args->output->data;
+  float *__restrict__ loraA = FC_args->lora_A->data;
+  float *__restrict__ loraB = FC_args->lora_B->data;
+  float *__restrict__ hidden = FC_args->lora_hidden->data;
+
+  const uint32_t K = FC_args->input->dim;
+  const uint32_t N = FC_args->output->dim;
+  const uint32_t R = FC_args->lora_rank;
+  const float scale = FC_args->lora_scale;
+
+  // hidden = scale * A * x, split over the rank
+  uint32_t blockSize = (R+NUM_CORES-1) / NUM_CORES;
+  uint32_t start = pi_core_id()*blockSize;
+  uint32_t stop = start+blockSize > R ? R : start+blockSize;
+
+  for (uint32_t r=start; r < stop; r++) {
+    float acc = 0.0f;
+    for (uint32_t k=0; k < K; k++)
+      acc += loraA[r*K+k] * inData[k];
+    hidden[r] = scale * acc;
+  }
+  pi_cl_team_barrier();
+
+  // out += B * hidden, accumulated on top of the frozen projection
+  blockSize = (N+NUM_CORES-1) / NUM_CORES;
+  start = pi_core_id()*blockSize;
+  stop = start+blockSize > N ? N : start+blockSize;
+
+  for (uint32_t i=start; i < stop; i++) {
+    float acc = 0.0f;
+    for (uint32_t r=0; r < R; r++)
+      acc += loraB[i*R+r] * hidden[r];
+    outData[i] += acc;
+  }
+}
+
+void pulp_linear_fp32_lora_bw_param_grads_cl_kernel( void * Linear_args )
+{
+  struct Linear_args * FC_args = (struct Linear_args *) Linear_args;
+  float *__restrict__ inData = FC_args->input->data;
+  float *__restrict__ outDiff = FC_args->output->diff;
+  float *__restrict__ loraADiff = FC_args->lora_A->diff;
+  float *__restrict__ loraBDiff = FC_args->lora_B->diff;
+  float *__restrict__ hidden = FC_args->lora_hidden->data;
+  float *__restrict__ hiddenDiff = FC_args->lora_hidden->diff;
+
+  const uint32_t K = FC_args->input->dim;
+  const uint32_t N = FC_args->output->dim;
+  const uint32_t R = FC_args->lora_rank;
+
+  pulp_linear_fp32_lora_hidden_grad(FC_args);
+  pi_cl_team_barrier();
+
+  // dB = outDiff * hidden^T (N x R)
+  uint32_t blockSize = (N+NUM_CORES-1) / NUM_CORES;
+  uint32_t start = pi_core_id()*blockSize;
+  uint32_t stop = start+blockSize > N ? N : start+blockSize;
+
+  for (uint32_t i=start; i < stop; i++)
+    for (uint32_t r=0; r < R; r++)
+      loraBDiff[i*R+r] = outDiff[i] * hidden[r];
+
+  // dA = hiddenDiff * input^T (R x K), split over the elements since R is small
+  blockSize = (R*K+NUM_CORES-1) / NUM_CORES;
+  start = pi_core_id()*blockSize;
+  stop = start+blockSize > R*K ? R*K : start+blockSize;
+
+  for (uint32_t idx=start; idx < stop; idx++)
+    loraADiff[idx] = hiddenDiff[idx / K] * inData[idx % K];
+}
+
+void pulp_linear_fp32_lora_bw_input_grads_cl_kernel( void * Linear_args )
+{
+  struct Linear_args * FC_args = (struct Linear_args *) Linear_args;
+  float *__restrict__ inDiff = FC_args->input->diff;
+  float *__restrict__ loraA = FC_args->lora_A->data;
+  float *__restrict__ hiddenDiff = FC_args->lora_hidden->diff;
+
+  const uint32_t K = FC_args->input->dim;
+  const uint32_t R = FC_args->lora_rank;
+
+  // Recomputed here (R x N MACs) so that the input gradient does not depend on the weight gradient step
+  pulp_linear_fp32_lora_hidden_grad(FC_args);
+  pi_cl_team_barrier();
+
+  // inDiff += A^T * hiddenDiff
+  const uint32_t blockSize = (K+NUM_CORES-1) / NUM_CORES;
+  const uint32_t start = pi_core_id()*blockSize;
+  const uint32_t stop = start+blockSize > K ? K : start+blockSize;
+
+  for (uint32_t k=start; k < stop; k++) {
+    float acc = 0.0f;
+    for (uint32_t r=0; r < R; r++)
+      acc += loraA[r*K+k] * hiddenDiff[r];
+    inDiff[k] += acc;
+  }
+}
@@ -321,6 +321,62 @@ void mm_M_fp16(void * void_args) {
 }
 
 
+void mm_mul_epilogue_fp16(void * void_args) {
+    struct mm_epilogue_args_fp16 *ep_args = (struct mm_epilogue_args_fp16 *) void_args;
+    struct matMul_args_fp16 *args = ep_args->mm_args;
+
+    fp16 *__restrict__ A = args->A;
+    fp16 *__restrict__ B = args->B;
+    fp16 *__restrict__ C = args->C;
+    fp16 *__restrict__ scale = ep_args->scale;
+
+    const uint32_t N = args->N;
+    const uint32_t M = args->M;
+    const uint32_t K = args->K;
+
+    uint32_t transp = args->trans_B;
+
+    // Parallelize on the flattened output, to be balanced for both N=1 and M=1
+    const uint32_t dim = N * M;
+    const uint32_t blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const uint32_t start = pi_core_id() * blockSize;
+    const uint32_t stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (uint32_t idx = start; idx < stop; idx++) {
+        uint32_t i = idx / M;
+        uint32_t j = idx - i * M;
+
+        fp16 *a = &A[i * K];
+        fp16 temp = 0;
+
+        // =====> B NOT TRANSPOSED <=====
+        if (transp == 0) {
+            for (uint32_t k = 0; k < K; k++) {
+                temp += a[k] * B[j + k * M];
+            }
+        }
+        // =====> B IS TRANSPOSED <=====
+        else {
+            fp16 *b = &B[j * K];
+            uint32_t k = 0;
+            // Rows of A and B are contiguous, use SIMD when they are aligned
+            if ((K & 0x1) == 0) {
+                v2f16 vtemp = (v2f16) {0, 0};
+                for (; k < K; k += 2) {
+                    vtemp += *((v2f16 *) &a[k]) * *((v2f16 *) &b[k]);
+                }
+                temp = vtemp[0] + vtemp[1];
+            }
+            for (; k < K; k++) {
+                temp += a[k] * b[k];
+            }
+        }
+
+        C[idx] = temp * scale[idx];
+    }
+}
+
+
 /**
  * Optimized versions
  */
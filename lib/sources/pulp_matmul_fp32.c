@@ -397,6 +397,45 @@ void mm_M(void *matMul_args) {
 }
 
 
+void mm_mul_epilogue(void *void_args) {
+    struct mm_epilogue_args *ep_args = (struct mm_epilogue_args *) void_args;
+    struct matMul_args *args = ep_args->mm_args;
+
+    float *__restrict__ A = args->A;
+    float *__restrict__ B = args->B;
+    float *__restrict__ C = args->C;
+    float *__restrict__ scale = ep_args->scale;
+
+    const uint32_t N = args->N;
+    const uint32_t M = args->M;
+    const uint32_t K = args->K;
+
+    uint32_t transp = args->trans_B;
+
+    // Parallelize on the flattened output, to be balanced for both N=1 and M=1
+    const uint32_t dim = N * M;
+    const uint32_t blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const uint32_t start = pi_core_id() * blockSize;
+    const uint32_t stop = start + blockSize > dim ? dim : start + blockSize;
+
+    const uint32_t stride_B = (transp == 0) ? M : 1;
+
+    for (uint32_t idx = start; idx < stop; idx++) {
+        uint32_t i = idx / M;
+        uint32_t j = idx - i * M;
+
+        float *a = &A[i * K];
+        float *b = (transp == 0) ? &B[j] : &B[j * K];
+
+        float temp = 0;
+        for (uint32_t k = 0; k < K; k++) {
+            temp += a[k] * b[k * stride_B];
+        }
+        C[idx] = temp * scale[idx];
+    }
+}
+
+
 /**
  * OPTIMIZED VERSIONS
  */
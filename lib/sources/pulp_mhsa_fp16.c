@@ -12,7 +12,9 @@
 #include "pulp_mhsa_fp16.h"
 #include "pulp_matmul_fp16.h"
 #include "pulp_train_utils_fp16.h"
+#include "pulp_train_utils_fp32.h"
 #include "pulp_act_fp16.h"
+#include "pulp_rope_fp16.h"
 #include <math.h>
 
 
@@ -73,255 +75,268 @@ void pulp_mhsa_fp16_fw_cl(void *Mhsa_args) {
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~         F x E        @  E x L    -> F x L ~~~~~~~~~~~~~~~~~~~~~~~
     // TODO 0001: Maybe different key size (from q and v)
 
-    // T0_q
-    struct transp_args_fp16 transp_args0_q;
-
     int dim[] = {E, F};
     int tr_axes[] = {1, 0};
 
-    transp_args0_q.in_matrix = coeffDataWinQ;
-    transp_args0_q.out_matrix = temp;
-    transp_args0_q.dim = dim;
-    transp_args0_q.transposed_axes = tr_axes;
-    transp_args0_q.n_dim = 2;
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused projection: Q, K and V are the three F x L blocks of q->data
+        pulp_mhsa_fp16_qkv_fw_cl(mhsa_args);
+        k = q + F * L;
+        v = k + F * L;
+    }
+    else {
+        // T0_q
+        struct transp_args_fp16 transp_args0_q;
+
+        transp_args0_q.in_matrix = coeffDataWinQ;
+        transp_args0_q.out_matrix = temp;
+        transp_args0_q.dim = dim;
+        transp_args0_q.transposed_axes = tr_axes;
+        transp_args0_q.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_q);
+        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_q);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_q.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_q.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_q.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_q.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_q
-    // Projecting input sequence into Q
-    struct matMul_args_fp16 matMul_args1_q;
-    matMul_args1_q.A = temp;                                       //  F x E
-    matMul_args1_q.B = inputData;                                  //  E x L
-    matMul_args1_q.C = q;
-    matMul_args1_q.N = F;
-    matMul_args1_q.K = E;
-    matMul_args1_q.M = L;
-    matMul_args1_q.trans_B = 0;
+        // M1_q
+        // Projecting input sequence into Q
+        struct matMul_args_fp16 matMul_args1_q;
+        matMul_args1_q.A = temp;                                       //  F x E
+        matMul_args1_q.B = inputData;                                  //  E x L
+        matMul_args1_q.C = q;
+        matMul_args1_q.N = F;
+        matMul_args1_q.K = E;
+        matMul_args1_q.M = L;
+        matMul_args1_q.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_q);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_q);
 #else
-    struct mm_manager_args_fp16 man_args1_q;
-    man_args1_q.mm_args = &matMul_args1_q;
-    man_args1_q.layer_type = LAYER_LINEAR;
-    man_args1_q.step_type = STEP_FW;
-    man_args1_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_q);
+        struct mm_manager_args_fp16 man_args1_q;
+        man_args1_q.mm_args = &matMul_args1_q;
+        man_args1_q.layer_type = LAYER_LINEAR;
+        man_args1_q.step_type = STEP_FW;
+        man_args1_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_q result\n\ncoeffDataWinQ: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_q.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_q result\n\ncoeffDataWinQ: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_q.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_q.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_q.B[j]);
+        }
+        printf("\n");
 
-    printf("\nq: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_q.C[j]);
-    }
-    printf("\n\n");
+        printf("\nq: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_q.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_q
-    struct mm_bias_add_args_fp16 mm_bias_add_args_q;
-    mm_bias_add_args_q.mat = q;
-    mm_bias_add_args_q.bias = coeffBiasWinQ;
-    mm_bias_add_args_q.H = F;
-    mm_bias_add_args_q.W = L;
+        // Bias_addition_q
+        struct mm_bias_add_args_fp16 mm_bias_add_args_q;
+        mm_bias_add_args_q.mat = q;
+        mm_bias_add_args_q.bias = coeffBiasWinQ;
+        mm_bias_add_args_q.H = F;
+        mm_bias_add_args_q.W = L;
+        mm_bias_add_args_q.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_q);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_q);
 
-    // T0_k
-    struct transp_args_fp16 transp_args0_k;
+        // T0_k
+        struct transp_args_fp16 transp_args0_k;
 
-    dim[] = {E, F};
+        dim[0] = E;
+        dim[1] = F;
 
-    transp_args0_k.in_matrix = coeffDataWinK;
-    transp_args0_k.out_matrix = temp;
-    transp_args0_k.dim = dim;
-    transp_args0_k.transposed_axes = tr_axes;
-    transp_args0_k.n_dim = 2;
+        transp_args0_k.in_matrix = coeffDataWinK;
+        transp_args0_k.out_matrix = temp;
+        transp_args0_k.dim = dim;
+        transp_args0_k.transposed_axes = tr_axes;
+        transp_args0_k.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_k);
+        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_k);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_k.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_k.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_k.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_k.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_k
-    // Projecting input sequence into K
-    struct matMul_args_fp16 matMul_args1_k;
-    matMul_args1_k.A = temp;                                       //  F x E
-    matMul_args1_k.B = inputData;                                  //  E x L
-    matMul_args1_k.C = k;
-    matMul_args1_k.N = F;
-    matMul_args1_k.K = E;
-    matMul_args1_k.M = L;
-    matMul_args1_k.trans_B = 0;
+        // M1_k
+        // Projecting input sequence into K
+        struct matMul_args_fp16 matMul_args1_k;
+        matMul_args1_k.A = temp;                                       //  F x E
+        matMul_args1_k.B = inputData;                                  //  E x L
+        matMul_args1_k.C = k;
+        matMul_args1_k.N = F;
+        matMul_args1_k.K = E;
+        matMul_args1_k.M = L;
+        matMul_args1_k.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_k);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_k);
 #else
-    struct mm_manager_args_fp16 man_args1_k;
-    man_args1_k.mm_args = &matMul_args1_k;
-    man_args1_k.layer_type = LAYER_LINEAR;
-    man_args1_k.step_type = STEP_FW;
-    man_args1_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_k);
+        struct mm_manager_args_fp16 man_args1_k;
+        man_args1_k.mm_args = &matMul_args1_k;
+        man_args1_k.layer_type = LAYER_LINEAR;
+        man_args1_k.step_type = STEP_FW;
+        man_args1_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_k);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_k result\n\ncoeffDataWinK: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_k result\n\ncoeffDataWinK: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_k.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_k.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_k.B[j]);
+        }
+        printf("\n");
 
-    printf("\nk: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_k.C[j]);
-    }
-    printf("\n\n");
+        printf("\nk: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_k.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_k
-    struct mm_bias_add_args_fp16 mm_bias_add_args_k;
-    mm_bias_add_args_k.mat = k;
-    mm_bias_add_args_k.bias = coeffBiasWinK;
-    mm_bias_add_args_k.H = F;
-    mm_bias_add_args_k.W = L;
+        // Bias_addition_k
+        struct mm_bias_add_args_fp16 mm_bias_add_args_k;
+        mm_bias_add_args_k.mat = k;
+        mm_bias_add_args_k.bias = coeffBiasWinK;
+        mm_bias_add_args_k.H = F;
+        mm_bias_add_args_k.W = L;
+        mm_bias_add_args_k.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_k);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_k);
 
-    // T0_v
-    struct transp_args_fp16 transp_args0_v;
+        // T0_v
+        struct transp_args_fp16 transp_args0_v;
 
-    dim = {E, F};
+        dim[0] = E;
+        dim[1] = F;
 
-    transp_args0_v.in_matrix = coeffDataWinV;
-    transp_args0_v.out_matrix = temp;
-    transp_args0_v.dim = dim;
-    transp_args0_v.transposed_axes = tr_axes;
-    transp_args0_v.n_dim = 2;
+        transp_args0_v.in_matrix = coeffDataWinV;
+        transp_args0_v.out_matrix = temp;
+        transp_args0_v.dim = dim;
+        transp_args0_v.transposed_axes = tr_axes;
+        transp_args0_v.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_v);
+        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args0_v);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_v.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_v.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_v.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_v.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_v
-    // Projecting input sequence into V
-    struct matMul_args_fp16 matMul_args1_v;
-    matMul_args1_v.A = temp;                                       //  F x E
-    matMul_args1_v.B = inputData;                                  //  E x L
-    matMul_args1_v.C = v;
-    matMul_args1_v.N = F;
-    matMul_args1_v.K = E;
-    matMul_args1_v.M = L;
-    matMul_args1_v.trans_B = 0;
+        // M1_v
+        // Projecting input sequence into V
+        struct matMul_args_fp16 matMul_args1_v;
+        matMul_args1_v.A = temp;                                       //  F x E
+        matMul_args1_v.B = inputData;                                  //  E x L
+        matMul_args1_v.C = v;
+        matMul_args1_v.N = F;
+        matMul_args1_v.K = E;
+        matMul_args1_v.M = L;
+        matMul_args1_v.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_v);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1_v);
 #else
-    struct mm_manager_args_fp16 man_args1_v;
-    man_args1_v.mm_args = &matMul_args1_v;
-    man_args1_v.layer_type = LAYER_LINEAR;
-    man_args1_v.step_type = STEP_FW;
-    man_args1_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_v);
+        struct mm_manager_args_fp16 man_args1_v;
+        man_args1_v.mm_args = &matMul_args1_v;
+        man_args1_v.layer_type = LAYER_LINEAR;
+        man_args1_v.step_type = STEP_FW;
+        man_args1_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_v result\n\ncoeffDataWinV: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_v.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_v result\n\ncoeffDataWinV: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_v.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_v.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_v.B[j]);
+        }
+        printf("\n");
 
-    printf("\nv: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_v.C[j]);
-    }
-    printf("\n\n");
+        printf("\nv: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_v.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_v
-    struct mm_bias_add_args_fp16 mm_bias_add_args_v;
-    mm_bias_add_args_v.mat = v;
-    mm_bias_add_args_v.bias = coeffBiasWinV;
-    mm_bias_add_args_v.H = F;
-    mm_bias_add_args_v.W = L;
+        // Bias_addition_v
+        struct mm_bias_add_args_fp16 mm_bias_add_args_v;
+        mm_bias_add_args_v.mat = v;
+        mm_bias_add_args_v.bias = coeffBiasWinV;
+        mm_bias_add_args_v.H = F;
+        mm_bias_add_args_v.W = L;
+        mm_bias_add_args_v.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_v);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &mm_bias_add_args_v);
+    }
 
     //  Cycle on the different heads
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ F -> H ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -336,7 +351,8 @@ void pulp_mhsa_fp16_fw_cl(void *Mhsa_args) {
         //  T1
         struct transp_args_fp16 transp_args1;
 
-        dim = {H, L};
+        dim[0] = H;
+        dim[1] = L;
 
         transp_args1.in_matrix = k + L * i * H;
         transp_args1.out_matrix = temp;
@@ -451,7 +467,8 @@ void pulp_mhsa_fp16_fw_cl(void *Mhsa_args) {
         // T2
         struct transp_args_fp16 transp_args2;
 
-        dim = {L, L};
+        dim[0] = L;
+        dim[1] = L;
 
         transp_args2.in_matrix = softmax_buffer + i * L * L;
         transp_args2.out_matrix = temp;
@@ -517,7 +534,8 @@ void pulp_mhsa_fp16_fw_cl(void *Mhsa_args) {
         //  softmax buffer data following the H x L convention, therefore we need to transpose_fp16 the memory buffer again.
         struct transp_args_fp16 transp_args3;
 
-        dim = {L, L};
+        dim[0] = L;
+        dim[1] = L;
 
         transp_args3.in_matrix = softmax_buffer + i * L * L;
         transp_args3.out_matrix = temp;
@@ -672,6 +690,14 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
     fp16 *k_diff = mhsa_args->k->diff;                    // F x L
     fp16 *v_diff = mhsa_args->v->diff;                    // F x L
 
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused QKV projection: Q, K, V and their gradients are the three F x L blocks of q->data / q->diff
+        k = q + F * L;
+        v = k + F * L;
+        k_diff = q_diff + F * L;
+        v_diff = k_diff + F * L;
+    }
+
     fp16 *outDiff = mhsa_args->output->diff; // L x E
     fp16 *inputDiff = mhsa_args->input->diff; // L x E
     fp16 *attention_map_diff = mhsa_args->attention_map->diff; // F x L
@@ -704,9 +730,10 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
     // ~~~~~~~~~~~~~~~~~~~~~~         F x E            @  E x L  ->       F x L        ~~~~~~~~~~~~~~~~~~~~~~
 
     // T1
-    struct transp_args_fp16 transp_args1;
+    int dim[] = {F, L};
+    int tr_axes[] = {1, 0};
 
-    dim = {F, L};
+    struct transp_args_fp16 transp_args1;
 
     transp_args1.in_matrix = attention_map;
     transp_args1.out_matrix = temp;
@@ -780,7 +807,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
     // T2
     struct transp_args_fp16 transp_args2;
 
-    dim = {E, F};
+    dim[0] = E;
+    dim[1] = F;
 
     transp_args2.in_matrix = coeffDataWout;
     transp_args2.out_matrix = temp;
@@ -920,7 +948,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
         // T3
         struct transp_args_fp16 transp_args3;
 
-        dim = {H, L};
+        dim[0] = H;
+        dim[1] = L;
 
         transp_args3.in_matrix = v + i * L * H;
         transp_args3.out_matrix = temp;
@@ -1006,7 +1035,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
         // ~~~~~~~~~~~~~~~~~~ "IN-PLACE"_TRANSFORM (grad) [L x L] ~~~~~~~~~~~~~~~~~~                                              (T5 & C2)
 
         // T4
-        dim = {L, L};
+        dim[0] = L;
+        dim[1] = L;
 
         struct transp_args_fp16 transp_args4;
 
@@ -1095,7 +1125,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
         // T5
         struct transp_args_fp16 transp_args5;
 
-        dim = {L, L};
+        dim[0] = L;
+        dim[1] = L;
 
         transp_args5.in_matrix = grad;
         transp_args5.out_matrix = temp;
@@ -1205,7 +1236,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
         // T6
         struct transp_args_fp16 transp_args6;
 
-        dim = {H, L};
+        dim[0] = H;
+        dim[1] = L;
 
         transp_args6.in_matrix = q + i * L * H;
         transp_args6.out_matrix = temp;
@@ -1278,7 +1310,8 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
         // T7
         struct transp_args_fp16 transp_args7;
 
-        dim = {L, H};
+        dim[0] = L;
+        dim[1] = H;
 
         transp_args7.in_matrix = k_diff + i * L * H;
         transp_args7.out_matrix = temp;
@@ -1410,323 +1443,580 @@ void pulp_mhsa_fp16_bw_cl(void *Mhsa_args) {
     // ~~~~~~~~~~~~~~~~~~~~~~ inputDiff + temp  -> inputDiff  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~    (SUM_v)
     // ~~~~~~~~~~~~~~~~~~~~~~   E x L   + E x L ->   E x L    ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-    // T8
-    struct transp_args_fp16 transp_args8;
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused projection, q->diff holds the Q, K and V gradients
+        pulp_mhsa_fp16_qkv_bw_cl(mhsa_args);
+    }
+    else {
+        // T8
+        struct transp_args_fp16 transp_args8;
 
-    dim = {E, L};
+        dim[0] = E;
+        dim[1] = L;
 
-    transp_args8.in_matrix = inputData;
-    transp_args8.out_matrix = temp;
-    transp_args8.dim = dim;
-    transp_args8.transposed_axes = tr_axes;
-    transp_args8.n_dim = 2;
+        transp_args8.in_matrix = inputData;
+        transp_args8.out_matrix = temp;
+        transp_args8.dim = dim;
+        transp_args8.transposed_axes = tr_axes;
+        transp_args8.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args8);
+        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args8);
 
 #ifdef DEBUG
-    printf("\n\n\nT8 result\n\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  transp_args8.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT8 result\n\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  transp_args8.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args8.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args8.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_q
-    struct matMul_args_fp16 matMul_args7_q;
-    matMul_args7_q.A = q_diff;
-    matMul_args7_q.B = temp;
-    matMul_args7_q.C = coeffDiffWinQ;
-    matMul_args7_q.N = F;
-    matMul_args7_q.K = L;
-    matMul_args7_q.M = E;
-    matMul_args7_q.trans_B = 0;
+        // M7_q
+        struct matMul_args_fp16 matMul_args7_q;
+        matMul_args7_q.A = q_diff;
+        matMul_args7_q.B = temp;
+        matMul_args7_q.C = coeffDiffWinQ;
+        matMul_args7_q.N = F;
+        matMul_args7_q.K = L;
+        matMul_args7_q.M = E;
+        matMul_args7_q.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_q);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_q);
 #else
-    struct mm_manager_args_fp16 man_args7_q;
-    man_args7_q.mm_args = &matMul_args7_q;
-    man_args7_q.layer_type = LAYER_LINEAR;
-    man_args7_q.step_type = STEP_FW;
-    man_args7_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_q);
+        struct mm_manager_args_fp16 man_args7_q;
+        man_args7_q.mm_args = &matMul_args7_q;
+        man_args7_q.layer_type = LAYER_LINEAR;
+        man_args7_q.step_type = STEP_FW;
+        man_args7_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_q result\n\nq_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_q.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_q result\n\nq_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_q.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_q.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_q.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinQ: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_q.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinQ: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_q.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_k
-    struct matMul_args_fp16 matMul_args7_k;
-    matMul_args7_k.A = k_diff;
-    matMul_args7_k.B = temp;
-    matMul_args7_k.C = coeffDiffWinK;
-    matMul_args7_k.N = F;
-    matMul_args7_k.K = L;
-    matMul_args7_k.M = E;
-    matMul_args7_k.trans_B = 0;
+        // M7_k
+        struct matMul_args_fp16 matMul_args7_k;
+        matMul_args7_k.A = k_diff;
+        matMul_args7_k.B = temp;
+        matMul_args7_k.C = coeffDiffWinK;
+        matMul_args7_k.N = F;
+        matMul_args7_k.K = L;
+        matMul_args7_k.M = E;
+        matMul_args7_k.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_k);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_k);
 #else
-    struct mm_manager_args_fp16 man_args7_k;
-    man_args7_k.mm_args = &matMul_args7_k;
-    man_args7_k.layer_type = LAYER_LINEAR;
-    man_args7_k.step_type = STEP_FW;
-    man_args7_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_k);
+        struct mm_manager_args_fp16 man_args7_k;
+        man_args7_k.mm_args = &matMul_args7_k;
+        man_args7_k.layer_type = LAYER_LINEAR;
+        man_args7_k.step_type = STEP_FW;
+        man_args7_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_k);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_k result\n\nk_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_k result\n\nk_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_k.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_k.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_k.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinK: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_k.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinK: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_k.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_v
-    struct matMul_args_fp16 matMul_args7_v;
-    matMul_args7_v.A = v_diff;
-    matMul_args7_v.B = temp;
-    matMul_args7_v.C = coeffDiffWinV;
-    matMul_args7_v.N = F;
-    matMul_args7_v.K = L;
-    matMul_args7_v.M = E;
-    matMul_args7_v.trans_B = 0;
+        // M7_v
+        struct matMul_args_fp16 matMul_args7_v;
+        matMul_args7_v.A = v_diff;
+        matMul_args7_v.B = temp;
+        matMul_args7_v.C = coeffDiffWinV;
+        matMul_args7_v.N = F;
+        matMul_args7_v.K = L;
+        matMul_args7_v.M = E;
+        matMul_args7_v.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_v);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7_v);
 #else
-    struct mm_manager_args_fp16 man_args7_v;
-    man_args7_v.mm_args = &matMul_args7_v;
-    man_args7_v.layer_type = LAYER_LINEAR;
-    man_args7_v.step_type = STEP_FW;
-    man_args7_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_v);
+        struct mm_manager_args_fp16 man_args7_v;
+        man_args7_v.mm_args = &matMul_args7_v;
+        man_args7_v.layer_type = LAYER_LINEAR;
+        man_args7_v.step_type = STEP_FW;
+        man_args7_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args7_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_v result\n\nv_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_v.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_v result\n\nv_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_v.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_v.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_v.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinV: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_v.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinV: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_v.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M8_q
-    struct matMul_args_fp16 matMul_args8_q;
-    matMul_args8_q.A = coeffDataWinQ;
-    matMul_args8_q.B = q_diff;
-    matMul_args8_q.C = temp;
-    matMul_args8_q.N = E;
-    matMul_args8_q.K = F;
-    matMul_args8_q.M = L;
-    matMul_args8_q.trans_B = 0;
+        // M8_q
+        struct matMul_args_fp16 matMul_args8_q;
+        matMul_args8_q.A = coeffDataWinQ;
+        matMul_args8_q.B = q_diff;
+        matMul_args8_q.C = temp;
+        matMul_args8_q.N = E;
+        matMul_args8_q.K = F;
+        matMul_args8_q.M = L;
+        matMul_args8_q.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_q);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_q);
 #else
-    struct mm_manager_args_fp16 man_args8_q;
-    man_args8_q.mm_args = &matMul_args8_q;
-    man_args8_q.layer_type = LAYER_LINEAR;
-    man_args8_q.step_type = STEP_FW;
-    man_args8_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_q);
+        struct mm_manager_args_fp16 man_args8_q;
+        man_args8_q.mm_args = &matMul_args8_q;
+        man_args8_q.layer_type = LAYER_LINEAR;
+        man_args8_q.step_type = STEP_FW;
+        man_args8_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM8_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_q.A[j]);
-    }
-    printf("\n");
-
-    printf("\nq_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_q.B[j]);
-    }
-    printf("\n");
-
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_q.C[j]);
-    }
-    printf("\n\n");
-#endif
+        printf("\n\n\nM8_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_q.A[j]);
+        }
+        printf("\n");
 
-    // SUM_q
-    int dims[1] = {E * L};
+        printf("\nq_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_q.B[j]);
+        }
+        printf("\n");
 
-    struct array_broadcast_sum_fp16_args vect_sum_args;
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_q.C[j]);
+        }
+        printf("\n\n");
+#endif
 
-    vect_sum_args.op_1 = inputDiff;
-    vect_sum_args.op_2 = temp;
-    vect_sum_args.dest = inputDiff;
+        // SUM_q
+        int dims[1] = {E * L};
+
+        struct array_broadcast_sum_fp16_args vect_sum_args;
 
-    vect_sum_args.op_1_dims = dims;
-    vect_sum_args.op_2_dims = dims;
+        vect_sum_args.op_1 = inputDiff;
+        vect_sum_args.op_2 = temp;
+        vect_sum_args.dest = inputDiff;
 
-    vect_sum_args.op_1_dims_len = 1;
-    vect_sum_args.op_2_dims_len = 1;
+        vect_sum_args.op_1_dims = dims;
+        vect_sum_args.op_2_dims = dims;
 
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
+        vect_sum_args.op_1_dims_len = 1;
+        vect_sum_args.op_2_dims_len = 1;
 
-    // M8_k
-    struct matMul_args_fp16 matMul_args8_k;
-    matMul_args8_k.A = coeffDataWinK;
-    matMul_args8_k.B = k_diff;
-    matMul_args8_k.C = temp;
-    matMul_args8_k.N = E;
-    matMul_args8_k.K = F;
-    matMul_args8_k.M = L;
-    matMul_args8_k.trans_B = 0;
+        pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
+
+        // M8_k
+        struct matMul_args_fp16 matMul_args8_k;
+        matMul_args8_k.A = coeffDataWinK;
+        matMul_args8_k.B = k_diff;
+        matMul_args8_k.C = temp;
+        matMul_args8_k.N = E;
+        matMul_args8_k.K = F;
+        matMul_args8_k.M = L;
+        matMul_args8_k.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_k);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_k);
 #else
-    struct mm_manager_args_fp16 man_args8_k;
-    man_args8_k.mm_args = &matMul_args8_k;
-    man_args8_k.layer_type = LAYER_LINEAR;
-    man_args8_k.step_type = STEP_FW;
-    man_args8_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_k);
+        struct mm_manager_args_fp16 man_args8_k;
+        man_args8_k.mm_args = &matMul_args8_k;
+        man_args8_k.layer_type = LAYER_LINEAR;
+        man_args8_k.step_type = STEP_FW;
+        man_args8_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_k);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM8_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM8_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_k.A[j]);
+        }
+        printf("\n");
 
-    printf("\nk_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_k.B[j]);
-    }
-    printf("\n");
+        printf("\nk_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_k.B[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_k.C[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_k.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // SUM_k
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
+        // SUM_k
+        pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
 
-    // M8_v
-    struct matMul_args_fp16 matMul_args8_v;
-    matMul_args8_v.A = coeffDataWinV;
-    matMul_args8_v.B = v_diff;
-    matMul_args8_v.C = temp;
-    matMul_args8_v.N = E;
-    matMul_args8_v.K = F;
-    matMul_args8_v.M = L;
-    matMul_args8_v.trans_B = 0;
+        // M8_v
+        struct matMul_args_fp16 matMul_args8_v;
+        matMul_args8_v.A = coeffDataWinV;
+        matMul_args8_v.B = v_diff;
+        matMul_args8_v.C = temp;
+        matMul_args8_v.N = E;
+        matMul_args8_v.K = F;
+        matMul_args8_v.M = L;
+        matMul_args8_v.trans_B = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_v);
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8_v);
 #else
-    struct mm_manager_args_fp16 man_args8_v;
-    man_args8_v.mm_args = &matMul_args8_v;
-    man_args8_v.layer_type = LAYER_LINEAR;
-    man_args8_v.step_type = STEP_FW;
-    man_args8_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_v);
+        struct mm_manager_args_fp16 man_args8_v;
+        man_args8_v.mm_args = &matMul_args8_v;
+        man_args8_v.layer_type = LAYER_LINEAR;
+        man_args8_v.step_type = STEP_FW;
+        man_args8_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM8_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_v.A[j]);
+        printf("\n\n\nM8_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_v.A[j]);
+        }
+        printf("\n");
+
+        printf("\nv_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_v.B[j]);
+        }
+        printf("\n");
+
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_v.C[j]);
+        }
+        printf("\n\n");
+#endif
+
+        // SUM_v
+        pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
     }
-    printf("\n");
+}
 
-    printf("\nv_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_v.B[j]);
+
+//FUSED QKV PROJECTION
+void pulp_mhsa_fp16_qkv_fw_cl(void *Mhsa_args) {
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+
+    fp16 *coeffDataWinQKV = mhsa_args->coeff_in_qkv->data;     //  Input Projection Weights Wq | Wk | Wv (3F x E)
+    fp16 *inputData = mhsa_args->input->data;                  //  Input vector (Transposed, E x L)
+    fp16 *qkv = mhsa_args->q->data;                            //  Q | K | V (3F x L)
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    // M1_qkv
+    // One pass over the input for the three projections, the biases are added row-wise by the matmul manager
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.A = coeffDataWinQKV;                              //  3F x E
+    matMul_args1.B = inputData;                                    //  E x L
+    matMul_args1.C = qkv;                                          //  3F x L
+    matMul_args1.N = 3 * F;
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 0;
+    matMul_args1.bias = mhsa_args->bias_in_qkv != NULL ? mhsa_args->bias_in_qkv->data : NULL;
+    matMul_args1.bias_dim = 3 * F;
+    matMul_args1.USE_BIASES = mhsa_args->bias_in_qkv != NULL;
+    matMul_args1.bias_transposed = 1;
+
+    struct mm_manager_args_fp16 man_args1;
+    man_args1.mm_args = &matMul_args1;
+    man_args1.layer_type = LAYER_LINEAR;
+    man_args1.step_type = STEP_FW;
+    man_args1.matmul_type = mhsa_args->opt_matmul_type_fw; //MATMUL_TYPE
+    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
+
+    // LoRA on the fused projection: qkv += lora_B_qkv @ (lora_scale * lora_A_qkv @ input)
+    if (mhsa_args->lora_rank > 0) {
+        int R = mhsa_args->lora_rank;
+        fp16 *hidden = mhsa_args->lora_hidden_qkv->data;           //  R x L
+        fp16 *temp = mhsa_args->temp_buffer;
+
+        // M1_lora_a
+        struct matMul_args_fp16 matMul_args_la;
+        matMul_args_la.A = mhsa_args->lora_A_qkv->data;            //  R x E
+        matMul_args_la.B = inputData;                              //  E x L
+        matMul_args_la.C = hidden;                                 //  R x L
+        matMul_args_la.N = R;
+        matMul_args_la.K = E;
+        matMul_args_la.M = L;
+        matMul_args_la.trans_B = 0;
+        matMul_args_la.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_la);
+
+        struct scalar_mul_args_fp16 scalar_args_l;
+        scalar_args_l.input = hidden;
+        scalar_args_l.scalar = mhsa_args->lora_scale;
+        scalar_args_l.dim = R * L;
+
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &scalar_args_l);
+
+        // M1_lora_b
+        struct matMul_args_fp16 matMul_args_lb;
+        matMul_args_lb.A = mhsa_args->lora_B_qkv->data;            //  3F x R
+        matMul_args_lb.B = hidden;                                 //  R x L
+        matMul_args_lb.C = temp;                                   //  3F x L
+        matMul_args_lb.N = 3 * F;
+        matMul_args_lb.K = R;
+        matMul_args_lb.M = L;
+        matMul_args_lb.trans_B = 0;
+        matMul_args_lb.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_lb);
+
+        struct vect_sum_args_fp16 vect_sum_args_l;
+        vect_sum_args_l.op_1 = qkv;
+        vect_sum_args_l.op_2 = temp;
+        vect_sum_args_l.dest = qkv;
+        vect_sum_args_l.size = 3 * F * L;
+
+        pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &vect_sum_args_l);
     }
-    printf("\n");
+}
 
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_v.C[j]);
+
+void pulp_mhsa_fp16_qkv_bw_cl(void *Mhsa_args) {
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+
+    fp16 *coeffDataWinQKV = mhsa_args->coeff_in_qkv->data;     //  Input Projection Weights Wq | Wk | Wv (3F x E)
+    fp16 *coeffDiffWinQKV = mhsa_args->coeff_in_qkv->diff;     //  3F x E
+    fp16 *inputData = mhsa_args->input->data;                  //  E x L
+    fp16 *inputDiff = mhsa_args->input->diff;                  //  E x L
+    fp16 *qkv_diff = mhsa_args->q->diff;                       //  Q | K | V gradients (3F x L)
+    fp16 *temp = mhsa_args->temp_buffer;
+
+    int L = mhsa_args->input->H;
+    int E = mhsa_args->input->W;
+    int F = mhsa_args->attention_map->W;
+
+    // With LoRA, coeff_in_qkv is frozen and gets no gradient
+    if (mhsa_args->lora_rank == 0) {
+        // M7_qkv
+        // qkv_diff @ inputData^T -> coeffDiffWinQKV
+        struct matMul_args_fp16 matMul_args7;
+        matMul_args7.A = qkv_diff;                                     //  3F x L
+        matMul_args7.B = inputData;                                    //  E x L
+        matMul_args7.C = coeffDiffWinQKV;                              //  3F x E
+        matMul_args7.N = 3 * F;
+        matMul_args7.K = L;
+        matMul_args7.M = E;
+        matMul_args7.trans_B = 1;
+        matMul_args7.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args7);
     }
-    printf("\n\n");
+
+    // T8_qkv
+    struct transp_args_fp16 transp_args8;
+    transp_args8.in_matrix = coeffDataWinQKV;
+    transp_args8.out_matrix = temp;                                //  E x 3F
+    transp_args8.N = 3 * F;
+    transp_args8.M = E;
+
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args8);
+
+    // M8_qkv
+    struct matMul_args_fp16 matMul_args8;
+    matMul_args8.A = temp;                                         //  E x 3F
+    matMul_args8.B = qkv_diff;                                     //  3F x L
+    matMul_args8.C = temp + 3 * F * E;                             //  E x L
+    matMul_args8.N = E;
+    matMul_args8.K = 3 * F;
+    matMul_args8.M = L;
+    matMul_args8.trans_B = 0;
+    matMul_args8.USE_BIASES = 0;
+
+#ifndef OPTIMIZE
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args8);
+#else
+    int opt_matmul_type = mhsa_args->opt_matmul_type_ig;
+    struct mm_manager_args_fp16 man_args8;
+    man_args8.mm_args = &matMul_args8;
+    man_args8.layer_type = LAYER_LINEAR;
+    man_args8.step_type = STEP_FW;
+    man_args8.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args8);
 #endif
 
-    // SUM_v
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp16, &vect_sum_args);
+    // SUM_qkv
+    struct vect_sum_args_fp16 vect_sum_args;
+    vect_sum_args.op_1 = inputDiff;
+    vect_sum_args.op_2 = temp + 3 * F * E;
+    vect_sum_args.dest = inputDiff;
+    vect_sum_args.size = E * L;
+
+    pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &vect_sum_args);
+
+    // LoRA gradients, the input gradient also flows through the adapter
+    if (mhsa_args->lora_rank > 0) {
+        int R = mhsa_args->lora_rank;
+        fp16 *hidden = mhsa_args->lora_hidden_qkv->data;           //  R x L
+        fp16 *hiddenDiff = mhsa_args->lora_hidden_qkv->diff;       //  R x L
+
+        // M7_lora_b
+        // qkv_diff @ hidden^T -> lora_B_qkv->diff
+        struct matMul_args_fp16 matMul_args_lb;
+        matMul_args_lb.A = qkv_diff;                               //  3F x L
+        matMul_args_lb.B = hidden;                                 //  R x L
+        matMul_args_lb.C = mhsa_args->lora_B_qkv->diff;            //  3F x R
+        matMul_args_lb.N = 3 * F;
+        matMul_args_lb.K = L;
+        matMul_args_lb.M = R;
+        matMul_args_lb.trans_B = 1;
+        matMul_args_lb.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_lb);
+
+        // T8_lora_b
+        struct transp_args_fp16 transp_args_lb;
+        transp_args_lb.in_matrix = mhsa_args->lora_B_qkv->data;
+        transp_args_lb.out_matrix = temp;                          //  R x 3F
+        transp_args_lb.N = 3 * F;
+        transp_args_lb.M = R;
+
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args_lb);
+
+        // M8_lora_b
+        // lora_scale * lora_B_qkv^T @ qkv_diff -> hiddenDiff
+        struct matMul_args_fp16 matMul_args_lh;
+        matMul_args_lh.A = temp;                                   //  R x 3F
+        matMul_args_lh.B = qkv_diff;                               //  3F x L
+        matMul_args_lh.C = hiddenDiff;                             //  R x L
+        matMul_args_lh.N = R;
+        matMul_args_lh.K = 3 * F;
+        matMul_args_lh.M = L;
+        matMul_args_lh.trans_B = 0;
+        matMul_args_lh.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_lh);
+
+        struct scalar_mul_args_fp16 scalar_args_l;
+        scalar_args_l.input = hiddenDiff;
+        scalar_args_l.scalar = mhsa_args->lora_scale;
+        scalar_args_l.dim = R * L;
+
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &scalar_args_l);
+
+        // M7_lora_a
+        // hiddenDiff @ inputData^T -> lora_A_qkv->diff
+        struct matMul_args_fp16 matMul_args_la;
+        matMul_args_la.A = hiddenDiff;                             //  R x L
+        matMul_args_la.B = inputData;                              //  E x L
+        matMul_args_la.C = mhsa_args->lora_A_qkv->diff;            //  R x E
+        matMul_args_la.N = R;
+        matMul_args_la.K = L;
+        matMul_args_la.M = E;
+        matMul_args_la.trans_B = 1;
+        matMul_args_la.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_la);
+
+        // T8_lora_a
+        struct transp_args_fp16 transp_args_la;
+        transp_args_la.in_matrix = mhsa_args->lora_A_qkv->data;
+        transp_args_la.out_matrix = temp;                          //  E x R
+        transp_args_la.N = R;
+        transp_args_la.M = E;
+
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args_la);
+
+        // M8_lora_a
+        struct matMul_args_fp16 matMul_args_li;
+        matMul_args_li.A = temp;                                   //  E x R
+        matMul_args_li.B = hiddenDiff;                             //  R x L
+        matMul_args_li.C = temp + E * R;                           //  E x L
+        matMul_args_li.N = E;
+        matMul_args_li.K = R;
+        matMul_args_li.M = L;
+        matMul_args_li.trans_B = 0;
+        matMul_args_li.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args_li);
+
+        vect_sum_args.op_2 = temp + E * R;
+
+        pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &vect_sum_args);
+    }
 }
 
+
 //FORWARD INFERENCE
 void pulp_mhsa_mobilebert_inference_fp16_fw_cl(void *Mhsa_args) {
     // ======================================== DECLARATIONS ========================================
@@ -1826,12 +2116,12 @@ void pulp_mhsa_mobilebert_inference_fp16_fw_cl(void *Mhsa_args) {
     for (int i = 0; i < n_heads; i++) {
         //  T1
         struct transp_args_fp16 transp_args1;
-        transp_args1.matrix = kt + L * i * H;
-        transp_args1.transp_matrix = temp;
+        transp_args1.in_matrix = kt + L * i * H;
+        transp_args1.out_matrix = temp;
         transp_args1.N = H;
         transp_args1.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args1);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args1);
 
         // M2
         // Multiply it with the i-th head's transposed Q chunk
@@ -1880,12 +2170,12 @@ void pulp_mhsa_mobilebert_inference_fp16_fw_cl(void *Mhsa_args) {
         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
         // T2
         struct transp_args_fp16 transp_args2;
-        transp_args2.matrix = softmax_buffer + i * L * L;
-        transp_args2.transp_matrix = temp;
+        transp_args2.in_matrix = softmax_buffer + i * L * L;
+        transp_args2.out_matrix = temp;
         transp_args2.N = L;
         transp_args2.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args2);
 
         //  Softmax algorithm
         struct softmax_args_fp16 softmax_arg;
@@ -1940,12 +2230,12 @@ void pulp_mhsa_mobilebert_inference_fp16_fw_cl(void *Mhsa_args) {
         //  Each head result has to be appended to the full attention map, to do so we require to store the current
         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
         struct transp_args_fp16 transp_args3;
-        transp_args3.matrix = softmax_buffer + i * L * L;
-        transp_args3.transp_matrix = temp;
+        transp_args3.in_matrix = softmax_buffer + i * L * L;
+        transp_args3.out_matrix = temp;
         transp_args3.N = L;
         transp_args3.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args3);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args3);
 
         // M3
         struct matMul_args_fp16 matMul_args3;
@@ -2004,12 +2294,12 @@ void pulp_mhsa_mobilebert_inference_fp16_fw_cl(void *Mhsa_args) {
     // T4
     // The last transpose to original shape
     struct transp_args_fp16 transp_args4;
-    transp_args4.matrix = temp;
-    transp_args4.transp_matrix = outData;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
     transp_args4.N = F;
     transp_args4.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args4);
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args4);
 }
 
 
@@ -2122,17 +2412,17 @@ void tiled_transpose_mhsa_fp16(void *transpose_args, void* Tiled_matmul_mhsa_arg
     fp16* IN_DATA = BUFF;
     fp16* OUT_DATA = BUFF + tile_dim;
 
-    args_l1.matrix = IN_DATA;
-    args_l1.transp_matrix = OUT_DATA;
+    args_l1.in_matrix = IN_DATA;
+    args_l1.out_matrix = OUT_DATA;
     args_l1.N = tile_w;
     args_l1.M = tile_h;
     
     for(int i = 0; i < n_tiles_i; i++){
         for(int j = 0; j < n_tiles_j; j++){
-            pi_cl_dma_cmd_2d((uint32_t) (args->matrix + i * tile_h + j * tile_w * M), (uint32_t) (IN_DATA), 2 * tile_dim, 2 * M, 2 * tile_h, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
+            pi_cl_dma_cmd_2d((uint32_t) (args->in_matrix + i * tile_h + j * tile_w * M), (uint32_t) (IN_DATA), 2 * tile_dim, 2 * M, 2 * tile_h, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
             pi_cl_dma_cmd_wait(cmd_load);
-            pi_cl_team_fork(NUM_CORES, transpose_fp16, &args_l1);
-            pi_cl_dma_cmd_2d((uint32_t) (args->transp_matrix + j * tile_w + i * tile_h * N), (uint32_t) (OUT_DATA), 2 * tile_dim, 2 * N, 2 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+            pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &args_l1);
+            pi_cl_dma_cmd_2d((uint32_t) (args->out_matrix + j * tile_w + i * tile_h * N), (uint32_t) (OUT_DATA), 2 * tile_dim, 2 * N, 2 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
             pi_cl_dma_cmd_wait(cmd_store);
         }
     }
@@ -2225,8 +2515,8 @@ void tiled_mhsa_fp16(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
     for (int i = 0; i < n_heads; i++) {
         //  T1
         struct transp_args_fp16 transp_args1;
-        transp_args1.matrix = kt + L * i * H;
-        transp_args1.transp_matrix = temp;
+        transp_args1.in_matrix = kt + L * i * H;
+        transp_args1.out_matrix = temp;
         transp_args1.N = H;
         transp_args1.M = L;
         
@@ -2279,8 +2569,8 @@ void tiled_mhsa_fp16(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
         // T2
         struct transp_args_fp16 transp_args2;
-        transp_args2.matrix = softmax_buffer + i * L * L;
-        transp_args2.transp_matrix = temp;
+        transp_args2.in_matrix = softmax_buffer + i * L * L;
+        transp_args2.out_matrix = temp;
         transp_args2.N = L;
         transp_args2.M = L;
 
@@ -2329,8 +2619,8 @@ void tiled_mhsa_fp16(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
         //  Each head result has to be appended to the full attention map, to do so we require to store the current
         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
         struct transp_args_fp16 transp_args3;
-        transp_args3.matrix = softmax_buffer + i * L * L;
-        transp_args3.transp_matrix = temp;
+        transp_args3.in_matrix = softmax_buffer + i * L * L;
+        transp_args3.out_matrix = temp;
         transp_args3.N = L;
         transp_args3.M = L;
 
@@ -2376,736 +2666,1684 @@ void tiled_mhsa_fp16(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
     // T4
     // The last transpose to original shape
     struct transp_args_fp16 transp_args4;
-    transp_args4.matrix = temp;
-    transp_args4.transp_matrix = outData;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
     transp_args4.N = mhsa_args->input_bn->W;
     transp_args4.M = L;
 
     tiled_transpose_mhsa_fp16(&transp_args4, Tiled_mhsa_matmul_args, 1);
 }
 
-// void tiled_mhsa_fp16_flash(void *Mhsa_args, void* Tiled_mhsa_matmul_args, fp16* BUFF_L2, pi_fs_file_t *file_p, int size){
-//     // ======================================== DECLARATIONS ========================================
-//     // BUFF_L2 = (fp16*) pi_l2_malloc(size * 2);
-//     struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
-//     struct Tiled_Matmul_Mhsa_args_fp16 *tiled_args = (struct Tiled_Matmul_Mhsa_args_fp16 *) Tiled_mhsa_matmul_args;
-
-//     int tile_h = tiled_args->tile_h;
-//     int tile_w = tiled_args->tile_w;
-//     int tile_dim = tiled_args->tile_dim;
-//     fp16* BUFF = tiled_args->BUFF;
-//     pi_cl_dma_cmd_t * cmd_store = tiled_args->cmd_store;
-//     pi_cl_dma_cmd_t * cmd_load = tiled_args->cmd_load;
-
-//     int L = mhsa_args->input->H;                                //  Input/Output Sequence length    
-//     int E = mhsa_args->input->W;                                //  Input Sequence element size
-//     int F = mhsa_args->input_bn->W;                             //  Hidden dimension of attention (N. Heads * Head dimension)
-
-//     pi_cl_fs_req_t req1;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->coeff_in_q->data, (void*) (BUFF_L2), (F * F * 2), 1, &req1);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req1);
-//     fp16 *coeffDataWinQ = BUFF_L2; 
-
-//     pi_cl_fs_req_t req2;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->coeff_in_k->data, (void*) (BUFF_L2 + F * F), (F * F * 2), 1, &req2);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req2);
-//     fp16 *coeffDataWinK = BUFF_L2 + F * F; 
-
-//     pi_cl_fs_req_t req3;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->coeff_in_v->data, (void*) (BUFF_L2 + F * F * 2), (F * E * 2), 1, &req3);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req3);
-//     fp16 *coeffDataWinV = BUFF_L2 + F * F * 2; 
-
-//     pi_cl_fs_req_t req4;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->bias_in_q->data, (void*) (BUFF_L2 + (F * F * 2) + (F * E)), (F * 2), 1, &req4);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req4);
-//     fp16 *coeffBiasWinQ = BUFF_L2 + F * F * 2 + (F * E); 
-
-//     pi_cl_fs_req_t req5;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->bias_in_k->data, (void*) (BUFF_L2 + (F * F * 2) + (F * E) + F), (F * 2), 1, &req5);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req5);
-//     fp16 *coeffBiasWinK = BUFF_L2 + (F * F * 2) + (F * E) + F; 
-
-//     pi_cl_fs_req_t req6;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->bias_in_v->data, (void*) (BUFF_L2 + (F * F * 2) + (F * E) + (F * 2)), (F * 2), 1, &req6);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req6);
-//     fp16 *coeffBiasWinV = BUFF_L2 + (F * F * 2) + (F * E) + (F * 2); 
-
-//     pi_cl_fs_req_t req7;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->coeff_out->data, (void*) (BUFF_L2 + (F * F * 2) + (F * E) + (F * 3)), (F * F * 2), 1, &req7);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req7);
-//     fp16 *coeffDataWout = BUFF_L2 + (F * F * 2) + (F * E) + (F * 3);
-
-//     pi_cl_fs_req_t req8;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->bias_out->data, (void*) (BUFF_L2 + (F * F * 3) + (F * E) + (F * 3)), (F * 2), 1, &req8);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req8);
-//     fp16 *coeffBiasWout = BUFF_L2 + (F * F * 3) + (F * E) + (F * 3);
-
-//     pi_cl_fs_req_t req9;
-//     pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->input->data, (void*) (BUFF_L2 + (F * F * 3) + (F * E) + (F * 4)), (L * E * 2), 1, &req9);
-//     // pi_cl_fs_read(file_p, (void*) (W_DATA_L2), (args->M * args->K * 2), &req2);
-//     pi_cl_fs_wait(&req9);
-//     fp16 *inputData = BUFF_L2 + (F * F * 3) + (F * E) + (F * 4);
-
-    
-//     fp16 *attention_map = mhsa_args->attention_map->data;      //  Buffer saving the MHSA map before output projection
-//     fp16 *outData = mhsa_args->output->data;                   //  Output sequence (Transposed, E x L)
-//     fp16 *inputDataBn = mhsa_args->input_bn->data;             //  Input vector bottlenecked (L x F)
-//     fp16 *temp = mhsa_args->temp_buffer;                       //  Support buffer used in the attention head loop
-//     fp16 *softmax_buffer = mhsa_args->softmax_buffer->data;    //  Buffer containing the softmax results (necessary to save for backward pass)
-//     fp16 *maxes = mhsa_args->maxes;                            //  Buffer containing the row-wise maxes in the softmax process
-//     fp16 *sums = mhsa_args->sums;                              //  Buffer containing the row-wise exponential sums in the softmax process
-//     fp16 *qt = mhsa_args->q->data;                             //  Pointer to the first element of Q transposed
-//     fp16 *kt = mhsa_args->k->data;                             //  Pointer to the first element of K transposed
-//     fp16 *vt = mhsa_args->v->data;                             //  Pointer to the first element of V transposed
-//     int n_heads = mhsa_args->n_heads;                          //  Number of heads used for MHSA
-
-//     int opt_matmul_type = mhsa_args->opt_matmul_type_fw;        //  Matmul type used
-
-//     //printf("\n~~~~~~~~~~~~~~~FORWARD PASS~~~~~~~~~~~~~~~\n\nPrinting the parameters: L-%d, E-%d, F-%d\n", L, E, F);
-
-//     int H = F / n_heads;                                        //  Head dimension
-//     float scaling = q_rsqrt_fp16((float) H);                    //  Scaling factor to avoid vanishing gradients
-//     //float scaling = 1/sqrt(H);
-
-//     // M1_q
-//     // (Wq)t * input_bn
-//     struct matMul_args_fp16 matMul_args1_q;
-//     matMul_args1_q.A = coeffDataWinQ;                              //  F x F
-//     matMul_args1_q.B = inputDataBn;                                //  L x F
-//     matMul_args1_q.C = qt;                                         //  F x L
-//     matMul_args1_q.N = F;
-//     matMul_args1_q.K = F;
-//     matMul_args1_q.M = L;
-//     matMul_args1_q.trans_B = 1;
-//     matMul_args1_q.bias = coeffBiasWinQ;
-//     matMul_args1_q.USE_BIASES = 1;
-//     matMul_args1_q.bias_transposed = 1;
-//     matMul_args1_q.bias_dim = F;
-
-//     tiled_matmul_mhsa_fp16(&matMul_args1_q, Tiled_mhsa_matmul_args);
-
-//     // M1_k
-//     // (Wk)t * input_bn
-//     struct matMul_args_fp16 matMul_args1_k;
-//     matMul_args1_k.A = coeffDataWinK;                              //  F x F
-//     matMul_args1_k.B = inputDataBn;                                //  L x F
-//     matMul_args1_k.C = kt;                                         //  F x L
-//     matMul_args1_k.N = F;
-//     matMul_args1_k.K = F;
-//     matMul_args1_k.M = L;
-//     matMul_args1_k.trans_B = 1;
-//     matMul_args1_k.bias = coeffBiasWinK;
-//     matMul_args1_k.USE_BIASES = 1;
-//     matMul_args1_k.bias_transposed = 1;
-//     matMul_args1_k.bias_dim = F;
-
-//     tiled_matmul_mhsa_fp16(&matMul_args1_k, Tiled_mhsa_matmul_args);
-
-
-//     //  Cycle on the different heads
-//     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ F -> H ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-//     for (int i = 0; i < n_heads; i++) {
-//         //  T1
-//         struct transp_args_fp16 transp_args1;
-//         transp_args1.matrix = kt + L * i * H;
-//         transp_args1.transp_matrix = temp;
-//         transp_args1.N = H;
-//         transp_args1.M = L;
-
-//         tiled_transpose_mhsa_fp16(&transp_args1, Tiled_mhsa_matmul_args);
-
-//         // M2
-//         // Multiply it with the i-th head's transposed Q chunk
-//         struct matMul_args_fp16 matMul_args2;
-//         matMul_args2.A = temp;
-//         matMul_args2.B = qt + L * i * H;
-//         matMul_args2.C = softmax_buffer + i * L * L;
-//         matMul_args2.N = L;
-//         matMul_args2.K = H;
-//         matMul_args2.M = L;
-//         matMul_args2.trans_B = 0;
-//         matMul_args2.USE_BIASES = 0;
-
-//         tiled_matmul_mhsa_fp16(&matMul_args2, Tiled_mhsa_matmul_args);
-
-
-//         // ================================================== OP 4 ==================================================
-//         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ softmax_buffer *= scalar ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-//         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~           L x L          ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-//         struct scalar_mul_args_fp16 s_m_args;
-//         s_m_args.input = BUFF;
-//         s_m_args.scalar = scaling;
-//         s_m_args.dim = tile_dim;
-
-//         for(int k = 0; k < L / tile_h; k++){
-//             for(int j = 0; j < L / tile_w; j++){
-//                 pi_cl_dma_cmd_2d((uint32_t) ((softmax_buffer + i * L * L) + k * L * tile_h + j * tile_w), (uint32_t) (BUFF), 2 * tile_dim, 2 * L, 2 * tile_w, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
-//                 pi_cl_dma_cmd_wait(cmd_load);
-//                 pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &s_m_args);
-//                 pi_cl_dma_cmd_2d((uint32_t) ((softmax_buffer + i * L * L) + k * L * tile_h + j * tile_w), (uint32_t) (BUFF), 2 * tile_dim, 2 * L, 2 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
-//                 pi_cl_dma_cmd_wait(cmd_store);
-//             }
-//         }
-
-//         // ================================================== OP 5 ==================================================
-//         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ softmax_buffer -T-> temp [softmax_buffer ^ T]  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~   (T2)
-//         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~      L x L     -T->         L x L              ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-//         //
-//         // ~~~~~~~~~~~~~~~~~~ temp [softmax_buffer ^ T] -SM-> softmax_buffer [softmax_buffer ^ T]  ~~~~~~~~~~~~~~~~~~
-//         // ~~~~~~~~~~~~~~~~~~          L x L            -SM->               L x L                  ~~~~~~~~~~~~~~~~~~
-
-//         //  Due to the fact that we multiplied K * Qt instead of Q * Kt like in the original MHSA model, the current
-//         //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
-//         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
-//         // T2
-//         struct transp_args_fp16 transp_args2;
-//         transp_args2.matrix = softmax_buffer + i * L * L;
-//         transp_args2.transp_matrix = temp;
-//         transp_args2.N = L;
-//         transp_args2.M = L;
-
-//         tiled_transpose_mhsa_fp16(&transp_args2, Tiled_mhsa_matmul_args);
-
-//         //  Softmax algorithm
-//         struct softmax_args_fp16 softmax_arg;
-//         softmax_arg.input_data = temp;
-//         softmax_arg.output_data = softmax_buffer + i * L * L;
-//         softmax_arg.maxes = maxes;
-//         softmax_arg.sums = sums;
-//         softmax_arg.H = L;
-//         softmax_arg.W = L;
-
-//         pulp_softmax_fp16_fw_cl_tiled(&softmax_arg, Tiled_mhsa_matmul_args);
-//     }
-
-
-//     // M1_v
-//     // (Wv)t * input
-//     struct matMul_args_fp16 matMul_args1_v;
-//     matMul_args1_v.A = coeffDataWinV;                              //  F x E
-//     matMul_args1_v.B = inputData;                                  //  L x E
-//     matMul_args1_v.C = vt;                                         //  F x L
-//     matMul_args1_v.N = F;
-//     matMul_args1_v.K = E;
-//     matMul_args1_v.M = L;
-//     matMul_args1_v.trans_B = 1;
-//     matMul_args1_v.bias = coeffBiasWinV;
-//     matMul_args1_v.USE_BIASES = 1;
-//     matMul_args1_v.bias_transposed = 1;
-//     matMul_args1_v.bias_dim = F;
-
-//     tiled_matmul_mhsa_fp16(&matMul_args1_v, Tiled_mhsa_matmul_args);
-
-
-//     for (int i = 0; i < n_heads; i++) {
-//         // ================================================== OP 6 ==================================================
-//         // ~~~~~~~~~~~~~~~~~~~~~~ softmax_buffer [softmax_buffer ^ T] -T-> temp [softmax_buffer] ~~~~~~~~~~~~~~~~~~~~~~     (T3)
-//         // ~~~~~~~~~~~~~~~~~~~~~~               L x L                 -T->        L x L          ~~~~~~~~~~~~~~~~~~~~~~
-
-//         // ~~~~~~~~~~~~~~~~~~~~~~   v   @ temp [softmax_buffer] -> attention_map ~~~~~~~~~~~~~~~~~~~~~~                     (M3)
-//         // ~~~~~~~~~~~~~~~~~~~~~~ H x L @        L x L          ->     H x L     ~~~~~~~~~~~~~~~~~~~~~~
-
-//         // T3
-//         //  Each head result has to be appended to the full attention map, to do so we require to store the current
-//         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
-//         struct transp_args_fp16 transp_args3;
-//         transp_args3.matrix = softmax_buffer + i * L * L;
-//         transp_args3.transp_matrix = temp;
-//         transp_args3.N = L;
-//         transp_args3.M = L;
-
-//         tiled_transpose_mhsa_fp16(&transp_args3, Tiled_mhsa_matmul_args);
-
-//         // M3
-//         struct matMul_args_fp16 matMul_args3;
-//         matMul_args3.A = vt + L * i * H;
-//         matMul_args3.B = temp;
-//         matMul_args3.C = attention_map + L * i * H;
-//         matMul_args3.N = H;
-//         matMul_args3.K = L;
-//         matMul_args3.M = L;
-//         matMul_args3.trans_B = 0;
-
-//         tiled_matmul_mhsa_fp16(&matMul_args3, Tiled_mhsa_matmul_args);
-//     }
-
-//     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ H -> F ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-
-//     // ================================================== OP 7 ==================================================
-//     // ~~~~~~~~~~~~~~~~~~~~~~ coeffDataWout @ attention_map -> temp ~~~~~~~~~~~~~~~~~~~~~~       (M4)
-//     // ~~~~~~~~~~~~~~~~~~~~~~     F x F     @     F x L     ->  F x L  ~~~~~~~~~~~~~~~~~~~~~~
-
-//     // M4
-//     //  Final attention map projection
-//     struct matMul_args_fp16 matMul_args4;
-//     matMul_args4.A = coeffDataWout;
-//     matMul_args4.B = attention_map;
-//     matMul_args4.C = temp;
-//     matMul_args4.N = F;
-//     matMul_args4.K = F;
-//     matMul_args4.M = L;
-//     matMul_args4.trans_B = 0;
-//     matMul_args4.bias = coeffBiasWout;
-//     matMul_args4.USE_BIASES = 1;
-//     matMul_args4.bias_transposed = 1;
-//     matMul_args4.bias_dim = F;
-
-//     tiled_matmul_mhsa_fp16(&matMul_args4, Tiled_mhsa_matmul_args);
-
-//     // T4
-//     // The last transpose to original shape
-//     struct transp_args_fp16 transp_args4;
-//     transp_args4.matrix = temp;
-//     transp_args4.transp_matrix = outData;
-//     transp_args4.N = F;
-//     transp_args4.M = L;
-
-//     tiled_transpose_mhsa_fp16(&transp_args4, Tiled_mhsa_matmul_args);
-//     // pi_l2_free(BUFF_L2, size * 2);
-// }
 
+void mhsa_flash_attn_tile_fp16(void *flash_attn_args){
+    struct flash_attn_args_fp16 *args = (struct flash_attn_args_fp16 *) flash_attn_args;
+    fp16 *q = args->q;
+    fp16 *k = args->k;
+    fp16 *v = args->v;
+    fp16 *out = args->out;
+    float *m = args->m;
+    float *l = args->l;
+    int H = args->H;
+    int Br = args->Br;
+    int Bc = args->Bc;
+    fp16 scaling_h = args->scaling;
+    v2f16 scaling = (v2f16) {scaling_h, scaling_h};
+    //  Score of the masked lanes, compared in fp16 so that it matches in every fp16 format
+    const fp16 masked_score = (fp16) -65504.0f;
+
+    fp16 *s = args->scores + pi_core_id() * Bc;
+    int masked = args->mask_tile == MHSA_TILE_PARTIAL;
+    int sparse = masked && args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = (Br + NUM_CORES - 1) / NUM_CORES;
+    const int step = masked ? NUM_CORES : 1;
+    const int start = masked ? pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? Br : (start + blockSize > Br ? Br : start + blockSize);
+
+    for(int r = start; r < stop; r += step){
+        // Key columns [lo, hi) of the tile seen by query r. The pairs start from lo widened to an even column,
+        // an odd hi leaves a single key out of the pairs (also when Bc is odd)
+        int lo = 0, hi = Bc;
+        if(masked){
+            mhsa_mask_row_range(args->mask_type, args->mask_window, args->row0 + r, args->col0, args->col0 + Bc, &lo, &hi);
+            lo -= args->col0;
+            hi -= args->col0;
+            if(lo < 0) lo = 0;
+            if(hi > Bc) hi = Bc;
+            // No key of the tile is seen (e.g. Br > Bc with a causal mask): only the running statistics are carried
+            if(lo >= hi) lo = hi = 0;
+        }
+        int lo_pair = lo & 0xfffffffe;
+        int hi_pair = hi & 0xfffffffe;
+        int tail = hi & 1;
+        // No key seen by the previous tiles: start the running statistics from scratch
+        int fresh = args->first || l[r] == 0.0f;
+
+        // Scores of query r against the key tile (two keys per SIMD lane pair), and their max
+        float max = fresh ? (float) masked_score : m[r];
+        for(int c = lo_pair; c < hi_pair; c += 2){
+            v2f16 acc = (v2f16) {0, 0};
+            for(int h = 0; h < H; h++){
+                fp16 qv = q[h * Br + r];
+                acc += (v2f16) {qv, qv} * *((v2f16 *) &k[h * Bc + c]);
+            }
+            acc *= scaling;
+            if(masked){
+                //  Masked lanes are marked with masked_score and zeroed after the exponential
+                for(int j = 0; j < 2; j++)
+                    if(c + j < lo || (sparse && !mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, args->L, args->row0 + r, args->col0 + c + j)))
+                        acc[j] = masked_score;
+            }
+            *((v2f16 *) &s[c]) = acc;
+            if(acc[0] != masked_score && (float) acc[0] > max) max = (float) acc[0];
+            if(acc[1] != masked_score && (float) acc[1] > max) max = (float) acc[1];
+        }
+        if(tail){
+            fp16 acc = 0;
+            for(int h = 0; h < H; h++)
+                acc += q[h * Br + r] * k[h * Bc + hi_pair];
+            acc *= scaling_h;
+            if(sparse && !mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, args->L, args->row0 + r, args->col0 + hi_pair))
+                acc = masked_score;
+            s[hi_pair] = acc;
+            if(acc != masked_score && (float) acc > max) max = (float) acc;
+        }
 
+        // Rescale the running statistics to the new max
+        fp16 max_h = (fp16) max;
+        v2f16 vmax = (v2f16) {max_h, max_h};
+        float corr = 0.0f;
+        if(!fresh){
+            fp16 d = (fp16) (m[r] - max);
+            corr = (float) vexp_fp16((v2f16) {d, d})[0];
+        }
+        float sum = 0;
+        for(int c = lo_pair; c < hi_pair; c += 2){
+            v2f16 sc = *((v2f16 *) &s[c]);
+            v2f16 p = vexp_fp16(sc - vmax);
+            if(sc[0] == masked_score) p[0] = 0;
+            if(sc[1] == masked_score) p[1] = 0;
+            *((v2f16 *) &s[c]) = p;
+            sum += (float) p[0] + (float) p[1];
+        }
+        if(tail){
+            fp16 sc = s[hi_pair];
+            fp16 p = sc == masked_score ? 0 : vexp_fp16((v2f16) {sc - max_h, sc - max_h})[0];
+            s[hi_pair] = p;
+            sum += (float) p;
+        }
+        float l_new = (fresh ? 0.0f : l[r] * corr) + sum;
+        m[r] = max;
+        l[r] = l_new;
+        if(args->last && args->lse != NULL)
+            args->lse[r] = l_new > 0.0f ? max + logf(l_new) : max;
+
+        // out[:, r] = corr * out[:, r] + V * p, a fully masked query row is left to zero
+        float inv_l = args->last ? (l_new > 0.0f ? 1.0f / l_new : 0.0f) : 1.0f;
+        for(int h = 0; h < H; h++){
+            v2f16 acc = (v2f16) {0, 0};
+            for(int c = lo_pair; c < hi_pair; c += 2)
+                acc += *((v2f16 *) &v[h * Bc + c]) * *((v2f16 *) &s[c]);
+            float o = (float) acc[0] + (float) acc[1];
+            if(tail) o += (float) v[h * Bc + hi_pair] * (float) s[hi_pair];
+            if(!fresh) o += (float) out[h * Br + r] * corr;
+            out[h * Br + r] = (fp16) (o * inv_l);
+        }
+    }
+}
 
+void tiled_mhsa_flash_attn_fp16(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
+    // ======================================== DECLARATIONS ========================================
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+    struct Tiled_Matmul_Mhsa_args_fp16 *tiled_args = (struct Tiled_Matmul_Mhsa_args_fp16 *) Tiled_mhsa_matmul_args;
 
-/*
-// Instantiate zero_tensor support function
-static inline void zero_tensor(void *args);
+    fp16* BUFF = tiled_args->BUFF;
+    pi_cl_dma_cmd_t * cmd_store = tiled_args->cmd_store;
+    pi_cl_dma_cmd_t * cmd_load = tiled_args->cmd_load;
 
+    fp16 *coeffDataWinQ = mhsa_args->coeff_in_q->data;         //  Input Projection Weights for Query (transposed)
+    fp16 *coeffDataWinK = mhsa_args->coeff_in_k->data;         //  Input Projection Weights for Key (transposed)
+    fp16 *coeffDataWinV = mhsa_args->coeff_in_v->data;         //  Input Projection Weights for Value (transposed)
 
-//FORWARD W/ DOUBLE BUFFERING L1 DMA
-void pulp_mhsa_fp16_fw_cl_dblbuffer(void* Mhsa_args){
-    struct Mhsa_args_fp16_db *mhsa_args_db = (struct Mhsa_args_fp16_db *) Mhsa_args;
-    fp16 *coeffDataWin_l2 = mhsa_args_db->coeff_in->data;          //  Input Projection Weights in L2 (3F X E)
-    fp16 *coeffDataWout = mhsa_args_db->coeff_out->data;           //  Output Projection Weights (Already transposed from GM)
-    fp16 *attention_map = mhsa_args_db->attention_map->data;       //  Buffer saving the MHSA map before output projection
-    fp16 *attention_map_l2 = mhsa_args_db->attention_map_l2->data;       //  Buffer saving the MHSA map before output projection
-    fp16 *outData = mhsa_args_db->output->data;                    //  Output sequence (Transposed, E x L)
-    fp16 *temp = mhsa_args_db->temp_buffer;                        //  Support buffer used in the attention head loop
-    //float *head_buffer = mhsa_args->head_buffer->data;        //  Buffer containing the Q*Kt result (necessary to save for backward pass)
-    fp16 *softmax_buffer = mhsa_args_db->softmax_buffer->data;     //  Buffer containing the softmax results (necessary to save for backward pass)
-    fp16 *maxes = mhsa_args_db->maxes;                             //  Buffer containing the row-wise maxes in the softmax process
-    fp16 *sums = mhsa_args_db->sums;                               //  Buffer containing the row-wise exponential sums in the softmax process
-    fp16 *qkv_l2 = mhsa_args_db->qkv->data;                        //  Matrix in L2 containing the transposed Q, K and V (3*F x L)
-    fp16 *q = mhsa_args_db->buff2_a->data;                        //  Pointer to the first element of Q
-    fp16 *k = mhsa_args_db->buff2_a->data;                        //  Pointer to the first element of K
-    fp16 *v = mhsa_args_db->buff2_a->data;                        //  Pointer to the first element of V
-    fp16 *out = mhsa_args_db->attention_map_l2->data;
-    int n_heads = mhsa_args_db->n_heads;                           //  Number of heads used for MHSA
-    int n_tiles = mhsa_args_db->n_tiles;                           //  Number of tiles used for QKV projection
+    fp16 *coeffBiasWinQ = mhsa_args->bias_in_q->data;          //  Input Projection Biases for Query
+    fp16 *coeffBiasWinK = mhsa_args->bias_in_k->data;          //  Input Projection Biases for Key
+    fp16 *coeffBiasWinV = mhsa_args->bias_in_v->data;          //  Input Projection Biases for Value
 
-    fp16 *buff0 = mhsa_args_db->input->data;
-    fp16 *buff1_a = mhsa_args_db->buff1_a->data;
-    fp16 *buff2_a = mhsa_args_db->buff2_a->data;
-    fp16 *buff1_b = mhsa_args_db->buff1_b->data;
-    fp16 *buff2_b = mhsa_args_db->buff2_b->data;
+    fp16 *coeffDataWout = mhsa_args->coeff_out->data;          //  Output Projection Weights (Already transposed from GM)
+    fp16 *coeffBiasWout = mhsa_args->bias_out->data;           //  Output Projection Biases
 
+    fp16 *attention_map = mhsa_args->attention_map->data;      //  Buffer saving the MHSA map before output projection
+    fp16 *outData = mhsa_args->output->data;                   //  Output sequence (Transposed, E x L)
+    fp16 *inputData = mhsa_args->input->data;                  //  Input vector (L x E)
+    fp16 *inputDataBn = mhsa_args->input_bn->data;             //  Input vector bottlenecked (L x F)
+    fp16 *temp = mhsa_args->temp_buffer;                       //  Support buffer used for the output projection
+    fp16 *qt = mhsa_args->q->data;                             //  Pointer to the first element of Q transposed
+    fp16 *kt = mhsa_args->k->data;                             //  Pointer to the first element of K transposed
+    fp16 *vt = mhsa_args->v->data;                             //  Pointer to the first element of V transposed
+    int n_heads = mhsa_args->n_heads;                           //  Number of heads used for MHSA
 
-    int opt_matmul_type = mhsa_args_db->opt_matmul_type_fw;        //  Matmul type used
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                           //  Hidden dimension of attention (N. Heads * Head dimension)
 
-    int L = mhsa_args_db->input->H;                                //  Input/Output Sequence length
-    int E = mhsa_args_db->input->W;                                //  Input Sequence element size
-    int F = mhsa_args_db->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
-    int TILE = mhsa_args_db->buff1_a->W;
+    int H = F / n_heads;                                        //  Head dimension
+    float scaling = q_rsqrt_fp16((float) H);                         //  Scaling factor to avoid vanishing gradients
+
+    int Br = tiled_args->tile_h_sm;                             //  Queries per tile
+    int Bc = tiled_args->tile_w_sm;                             //  Keys per tile
+    int n_tiles_q = L / Br;
+    int n_tiles_kv = L / Bc;
+
+    //  L1 layout: m | l | Q tile | O tile | scores | K/V tiles (x2)
+    float *m_l1 = (float *) BUFF;
+    float *l_l1 = m_l1 + Br;
+    fp16 *q_l1 = (fp16 *) (l_l1 + Br);
+    fp16 *o_l1 = q_l1 + H * Br;
+    fp16 *s_l1 = o_l1 + H * Br;
+    fp16 *k_l1[2], *v_l1[2];
+    k_l1[0] = s_l1 + NUM_CORES * Bc;
+    v_l1[0] = k_l1[0] + H * Bc;
+    k_l1[1] = v_l1[0] + H * Bc;
+    v_l1[1] = k_l1[1] + H * Bc;
+    pi_cl_dma_cmd_t cmd_k[2], cmd_v[2];
+
+    // M1_q, M1_k, M1_v
+    // (Wq)t * input_bn, (Wk)t * input_bn, (Wv)t * input
+    struct matMul_args_fp16 matMul_args1_q;
+    matMul_args1_q.A = coeffDataWinQ;                              //  F x Ebn
+    matMul_args1_q.B = inputDataBn;                                //  L x Ebn
+    matMul_args1_q.C = qt;                                         //  F x L
+    matMul_args1_q.N = mhsa_args->coeff_in_q->H;
+    matMul_args1_q.K = mhsa_args->coeff_in_q->W;
+    matMul_args1_q.M = L;
+    matMul_args1_q.trans_B = 1;
+    matMul_args1_q.bias = coeffBiasWinQ;
+    matMul_args1_q.USE_BIASES = 1;
+    matMul_args1_q.bias_transposed = 1;
+    matMul_args1_q.bias_dim = F;
 
+    tiled_matmul_mhsa_fp16(&matMul_args1_q, Tiled_mhsa_matmul_args, 1);
 
-    #ifdef DEBUG
-    printf("\nPrinting the parameters: L-%d, E-%d, F-%d, TILE-%d, n_tiles-%d\n", L, E, F, TILE, n_tiles);
-    #endif
+    struct matMul_args_fp16 matMul_args1_k;
+    matMul_args1_k.A = coeffDataWinK;                              //  F x Ebn
+    matMul_args1_k.B = inputDataBn;                                //  L x Ebn
+    matMul_args1_k.C = kt;                                         //  F x L
+    matMul_args1_k.N = mhsa_args->coeff_in_k->H;
+    matMul_args1_k.K = mhsa_args->coeff_in_k->W;
+    matMul_args1_k.M = L;
+    matMul_args1_k.trans_B = 1;
+    matMul_args1_k.bias = coeffBiasWinK;
+    matMul_args1_k.USE_BIASES = 1;
+    matMul_args1_k.bias_transposed = 1;
+    matMul_args1_k.bias_dim = F;
 
-    int H = F / n_heads;                                        //  Head dimension
-    fp16 scaling = (fp16) (1/sqrt(H));                          //  Scaling factor to avoid vanishing gradients
-    //float scaling = q_rsqrt_fp16((float)H);
+    tiled_matmul_mhsa_fp16(&matMul_args1_k, Tiled_mhsa_matmul_args, 1);
 
+    struct matMul_args_fp16 matMul_args1_v;
+    matMul_args1_v.A = coeffDataWinV;                              //  F x E
+    matMul_args1_v.B = inputData;                                  //  L x E
+    matMul_args1_v.C = vt;                                         //  F x L
+    matMul_args1_v.N = F;
+    matMul_args1_v.K = E;
+    matMul_args1_v.M = L;
+    matMul_args1_v.trans_B = 1;
+    matMul_args1_v.bias = coeffBiasWinV;
+    matMul_args1_v.USE_BIASES = 1;
+    matMul_args1_v.bias_transposed = 1;
+    matMul_args1_v.bias_dim = F;
 
-    // PART 1: DOUBLE BUFFERING FOR QKV PROJECTION //
+    tiled_matmul_mhsa_fp16(&matMul_args1_v, Tiled_mhsa_matmul_args, 1);
 
-    // Set the current L1 buffer (0: L1A, 1: L1B)
-    int curr_L1_buffer = 0;
-
-    // Index for input transfers into L1
-    int in_idx = 0;
-
-    // Define the copy structures
-    pi_cl_dma_copy_t copy_inA, copy_inB;
-    pi_cl_dma_copy_t copy_outA, copy_outB;
-
-    struct zero_tensor_args zero_args;
-    zero_args.size = TILE*L;
-    zero_args.zero_init = 0.0f;
-
-    // Load first data into BUFFER 1.A in L1
-    copy_inA.ext = (uint32_t) &coeffDataWin_l2[0];
-    copy_inA.loc = (uint32_t) buff1_a;
-    copy_inA.size = 2*TILE*E;
-    copy_inA.dir = PI_CL_DMA_DIR_EXT2LOC;
-    copy_inA.id = 0;
-    copy_inA.merge = 0;
-    pi_cl_dma_memcpy(&copy_inA);
-
-    // Copy struct for BUFFER 1.B in L1
-    copy_inB.loc = (uint32_t) buff1_b;
-    copy_inB.size = 2*TILE*E;
-    copy_inB.dir = PI_CL_DMA_DIR_EXT2LOC;
-    copy_inB.id = 0;
-    copy_inB.merge = 0;
-
-    // Output buffer from BUFFER 2.A
-    copy_outA.dir = PI_CL_DMA_DIR_LOC2EXT;
-    copy_outA.merge = 0;
-    copy_outA.size = 2*TILE*L;
-    copy_outA.id = 0;
-    copy_outA.loc = (uint32_t) buff2_a;
-
-    // Output buffer from BUFFER 2.B
-    copy_outB.dir = PI_CL_DMA_DIR_LOC2EXT;
-    copy_outB.merge = 0;
-    copy_outB.size = 2*TILE*L;
-    copy_outB.id = 0;
-    copy_outB.loc = (uint32_t) buff2_b;
+    //  Fused attention, one head and one query tile at a time
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(Qt K * scaling) V -> attention_map ~~~~~~~~~~~~~~~~~~~~~~
+    struct flash_attn_args_fp16 fa_args;
+    fa_args.q = q_l1;
+    fa_args.out = o_l1;
+    fa_args.scores = s_l1;
+    fa_args.m = m_l1;
+    fa_args.l = l_l1;
+    fa_args.H = H;
+    fa_args.Br = Br;
+    fa_args.Bc = Bc;
+    fa_args.scaling = scaling;
+    fa_args.lse = NULL;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
 
-    // Projecting input sequence into Q, K, V, one tile at a time
-    struct matMul_args_fp16 matMul_args1;
-    matMul_args1.B = buff0;                                 //  E x L
-    matMul_args1.N = TILE;
-    matMul_args1.K = E;
-    matMul_args1.M = L;
-    matMul_args1.trans_B = 0;
+    for (int i = 0; i < n_heads; i++) {
+        fp16 *q_head = qt + L * i * H;
+        fp16 *k_head = kt + L * i * H;
+        fp16 *v_head = vt + L * i * H;
+
+        for (int t_q = 0; t_q < n_tiles_q; t_q++) {
+            int r0 = t_q * Br;
+            //  Fully masked K/V tiles are neither loaded nor computed
+            int t_kv = mhsa_mask_next_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, Bc, n_tiles_kv, -1);
+            int cur = 0;
+
+            pi_cl_dma_cmd_2d((uint32_t) (q_head + r0), (uint32_t) (q_l1), 2 * H * Br, 2 * L, 2 * Br, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
+            if (t_kv < n_tiles_kv) {
+                pi_cl_dma_cmd_2d((uint32_t) (k_head + t_kv * Bc), (uint32_t) (k_l1[0]), 2 * H * Bc, 2 * L, 2 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[0]);
+                pi_cl_dma_cmd_2d((uint32_t) (v_head + t_kv * Bc), (uint32_t) (v_l1[0]), 2 * H * Bc, 2 * L, 2 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[0]);
+            }
+            else {
+                //  No key is seen by the query tile
+                for (int j = 0; j < H * Br; j++)
+                    o_l1[j] = 0;
+            }
+            pi_cl_dma_cmd_wait(cmd_load);
 
-    //  Cycle on the tiles
-    for(int tile = 0; tile < n_tiles; tile++){
-        //printf("\nTILE %d\n", tile);
-        //printf("\nWaiting for computation...");
-        // Wait for input data & connect L1 data to computation
-        if (curr_L1_buffer == 0) {
-            pi_cl_dma_wait(&copy_inA);
-            pi_cl_dma_wait(&copy_outA);
-            matMul_args1.A = buff1_a;                       //  TILE x E Tile of weight matrix
-            matMul_args1.C = buff2_a;                       //  TILE x L Q, K, V are saved contiguously, in the same matrix.
-        }
-        else {
-            pi_cl_dma_wait(&copy_inB);
-            pi_cl_dma_wait(&copy_outB);
-            matMul_args1.A = buff1_b;                       //  TILE x E Tile of weight matrix
-            matMul_args1.C = buff2_b;                       //  TILE x L Q, K, V are saved contiguously, in the same matrix.
-        }
-
-        //  printf("\nLoading next data...");
-        //  Begin to load next data
-        if (tile < n_tiles-1) {
-          in_idx+=TILE*E;
-          if (curr_L1_buffer == 0) {
-            copy_inB.ext = (uint32_t) &coeffDataWin_l2[in_idx];
-            pi_cl_dma_memcpy(&copy_inB);
-          }
-          else {
-            copy_inA.ext = (uint32_t) &coeffDataWin_l2[in_idx];
-            pi_cl_dma_memcpy(&copy_inA);
-          }
-        }
-
-        //printf("\nNull output tensor...");
-        // Null output tensor before computation
-        if (curr_L1_buffer == 0) {
-          //for (int i=0; i<L1_OUT_SIZ; i++)  L1A_out[i] = 0;
-          zero_args.tensor = buff2_a;
-          pi_cl_team_fork(NUM_CORES, zero_tensor, &zero_args);
-        }
-        else {
-          //for (int i=0; i<L1_OUT_SIZ; i++)  L1B_out[i] = 0;
-          zero_args.tensor = buff2_b;
-          pi_cl_team_fork(NUM_CORES, zero_tensor, &zero_args);
-        }
-
-        // Compute MatMul for QKV projection
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args1);
-        #else
-        struct mm_manager_args_fp16 man_args1;
-        man_args1.mm_args = &matMul_args1;
-        man_args1.layer_type = LAYER_LINEAR;
-        man_args1.step_type = STEP_FW;
-        man_args1.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args1);
-        #endif
+            fa_args.row0 = r0;
+            fa_args.first = 1;
+            while (t_kv < n_tiles_kv) {
+                int t_next = mhsa_mask_next_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, Bc, n_tiles_kv, t_kv);
+                pi_cl_dma_cmd_wait(&cmd_k[cur]);
+                pi_cl_dma_cmd_wait(&cmd_v[cur]);
+
+                //  Prefetch the next K/V tile while the current one is processed
+                if (t_next < n_tiles_kv) {
+                    pi_cl_dma_cmd_2d((uint32_t) (k_head + t_next * Bc), (uint32_t) (k_l1[cur ^ 1]), 2 * H * Bc, 2 * L, 2 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[cur ^ 1]);
+                    pi_cl_dma_cmd_2d((uint32_t) (v_head + t_next * Bc), (uint32_t) (v_l1[cur ^ 1]), 2 * H * Bc, 2 * L, 2 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[cur ^ 1]);
+                }
+
+                fa_args.k = k_l1[cur];
+                fa_args.v = v_l1[cur];
+                fa_args.col0 = t_kv * Bc;
+                fa_args.mask_tile = mhsa_mask_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, t_kv * Bc, (t_kv + 1) * Bc);
+                fa_args.last = (t_next == n_tiles_kv);
+                pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp16, &fa_args);
+
+                fa_args.first = 0;
+                cur ^= 1;
+                t_kv = t_next;
+            }
 
-        //printf("\nStore result...");
-        // Store results into L2
-        if (curr_L1_buffer == 0) {
-          copy_outA.ext = (uint32_t) &qkv_l2[tile * (TILE * L)];
-          pi_cl_dma_memcpy(&copy_outA);
-        }
-        else {
-          copy_outB.ext = (uint32_t) &qkv_l2[tile * (TILE * L)];
-          pi_cl_dma_memcpy(&copy_outB);
+            pi_cl_dma_cmd_2d((uint32_t) (attention_map + L * i * H + t_q * Br), (uint32_t) (o_l1), 2 * H * Br, 2 * L, 2 * Br, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+            pi_cl_dma_cmd_wait(cmd_store);
         }
-
-        //printf("\nSwitch buffers...\n");
-        // Switch buffer roles
-        curr_L1_buffer = 1 - curr_L1_buffer;
     }
 
-    // Select correct buffer to be waited
-    curr_L1_buffer = 1 - curr_L1_buffer;
-    //printf("\nWaiting last buffer...\n");
-    //curr_L1_buffer != curr_L1_buffer;
-    // Wait for the last transfer
-    if (curr_L1_buffer == 0) {
-        pi_cl_dma_wait(&copy_inA);
-        pi_cl_dma_wait(&copy_outA);
-    }
-    else {
-        pi_cl_dma_wait(&copy_inB);
-        pi_cl_dma_wait(&copy_outB);
-    }
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ H -> F ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-    // PART 2: MULTI-HEAD SELF ATTENTION //
+    // M4
+    //  Final attention map projection
+    struct matMul_args_fp16 matMul_args4;
+    matMul_args4.A = coeffDataWout;
+    matMul_args4.B = attention_map;
+    matMul_args4.C = temp;
+    matMul_args4.N = mhsa_args->coeff_out->H;
+    matMul_args4.K = mhsa_args->coeff_out->W;
+    matMul_args4.M = L;
+    matMul_args4.trans_B = 0;
+    matMul_args4.bias = coeffBiasWout;
+    matMul_args4.USE_BIASES = 1;
+    matMul_args4.bias_transposed = 1;
+    matMul_args4.bias_dim = E;
 
-    // Reset the current L1 buffer (0: L1A, 1: L1B)
-    curr_L1_buffer = 0;
-
-    // Reset index for input transfers into L1
-    in_idx = 0;
-
-    zero_args.size = H * L;
-
-    // Define the NEW 2D copy structures
-    pi_cl_dma_copy_2d_t copy2d_inA, copy2d_inB;
-
-    // Load first data into L1 buffer 1.A (QKV is 3F x L)
-    copy2d_inA.ext = (uint32_t) qkv_l2;
-    copy2d_inA.loc = (uint32_t) buff1_a;
-    copy2d_inA.size = 2 * 3 * H * L;
-    copy2d_inA.stride = 2 * ((F) * L);
-    copy2d_inA.length = 2 * H * L;
-    copy2d_inA.dir = PI_CL_DMA_DIR_EXT2LOC;
-    copy2d_inA.id = 0;
-    copy2d_inA.merge = 0;
-    pi_cl_dma_memcpy_2d(&copy2d_inA);
-
-    // Copy struct for BUFFER 1.B in L1
-    copy2d_inB.loc = (uint32_t) buff1_b;
-    copy2d_inB.size = 2 * 3 * H * L;
-    copy2d_inB.stride = 2 * ((F) * L);
-    copy2d_inB.length = 2 * H * L;
-    copy2d_inB.dir = PI_CL_DMA_DIR_EXT2LOC;
-    copy2d_inB.id = 0;
-    copy2d_inB.merge = 0;
-
-    // Output buffer from BUFFER 2.A
-    copy_outA.dir = PI_CL_DMA_DIR_LOC2EXT;
-    copy_outA.merge = 0;
-    copy_outA.size = 2 * H * L;
-    copy_outA.id = 0;
-    copy_outA.loc = (uint32_t) buff2_a;
-
-    // Output buffer from BUFFER 2.B
-    copy_outB.dir = PI_CL_DMA_DIR_LOC2EXT;
-    copy_outB.merge = 0;
-    copy_outB.size = 2 * H * L;
-    copy_outB.id = 0;
-    copy_outB.loc = (uint32_t) buff2_b;
+    tiled_matmul_mhsa_fp16(&matMul_args4, Tiled_mhsa_matmul_args, 1);
 
-    //  Cycle on the different heads
-    for(int i = 0; i < n_heads; i++){
-        //printf("\nHEAD %d\n", i);
-        //printf("\nWaiting for computation...");
-        // Wait for input data & connect L1 data to computation
-        if (curr_L1_buffer == 0) {
-            pi_cl_dma_wait(&copy2d_inA);
-            pi_cl_dma_wait(&copy_outA);
-            q = buff1_a;
-            k = buff1_a + (L * H);
-            v = buff1_a + (L * 2 * H);
-        }
-        else {
-            pi_cl_dma_wait(&copy2d_inB);
-            pi_cl_dma_wait(&copy_outB);
-            q = buff1_b;
-            k = buff1_b + (L * H);
-            v = buff1_b + (L * 2 * H);
-        }
-
-        //printf("\nLoading next data...");
-        // Begin to load next data
-        if (i < n_heads-1) {
-          if (curr_L1_buffer == 0) {
-            in_idx+=(H * L);
-            copy2d_inB.ext = (uint32_t) &qkv_l2[in_idx];
-            pi_cl_dma_memcpy_2d(&copy2d_inB);
-          }
-          else {
-            in_idx+=(H * L);
-            copy2d_inA.ext = (uint32_t) &qkv_l2[in_idx];
-            pi_cl_dma_memcpy_2d(&copy2d_inA);
-          }
-        }
-
-        //printf("\nNull output tensor...");
-        // Null output tensor before computation
-        if (curr_L1_buffer == 0) {
-          //for (int i=0; i<L1_OUT_SIZ; i++)  L1A_out[i] = 0;
-          zero_args.tensor = buff2_a;
-          pi_cl_team_fork(NUM_CORES, zero_tensor, &zero_args);
-        }
-        else {
-          //for (int i=0; i<L1_OUT_SIZ; i++)  L1B_out[i] = 0;
-          zero_args.tensor = buff2_b;
-          pi_cl_team_fork(NUM_CORES, zero_tensor, &zero_args);
-        }
-
-        //printf("\nExecute computation...");
-        //  Transpose i-th head's K chunk
-        struct transp_args_fp16 transp_args2;
-        transp_args2.matrix = k;
-        transp_args2.transp_matrix = temp;
-        transp_args2.N = H;
-        transp_args2.M = L;
+    // T4
+    // The last transpose to original shape
+    struct transp_args_fp16 transp_args4;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
+    transp_args4.N = mhsa_args->input_bn->W;
+    transp_args4.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args2);
+    tiled_transpose_mhsa_fp16(&transp_args4, Tiled_mhsa_matmul_args, 1);
+}
 
-        //  Multiply it with the i-th head's Q chunk
-        struct matMul_args_fp16 matMul_args2;
-        matMul_args2.A = temp;
-        matMul_args2.B = q;
-        matMul_args2.C = buff0;
-        matMul_args2.N = L;
-        matMul_args2.K = H;
-        matMul_args2.M = L;
-        matMul_args2.trans_B = 0;
 
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args2);
-        #else
-        struct mm_manager_args_fp16 man_args2;
-        man_args2.mm_args = &matMul_args2;
-        man_args2.layer_type = LAYER_LINEAR;
-        man_args2.step_type = STEP_FW;
-        man_args2.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args2);
-        #endif
+void pulp_mhsa_fp16_flash_attn_fw_cl(void *Mhsa_args){
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
 
-        //  Due to the fact that we multiplied K * Qt instead of Q * Kt like in the original MHSA model, the current
-        //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
-        //  row-wise max and sums, therefore it is necessary to transpose_fp16 the current head buffer.
-        struct transp_args_fp16 transp_args4;
-        transp_args4.matrix = buff0;
-        transp_args4.transp_matrix = temp;
-        transp_args4.N = L;
-        transp_args4.M = L;
+    fp16 *attention_map = mhsa_args->attention_map->data;      //  Attention output, before output projection (F x L)
+    fp16 *temp = mhsa_args->temp_buffer;                       //  Support buffer: m | l (FP32) | scores
+    fp16 *q = mhsa_args->q->data;                              //  Pointer to the first element of Q (F x L)
+    fp16 *k = mhsa_args->k->data;                              //  Pointer to the first element of K (F x L)
+    fp16 *v = mhsa_args->v->data;                              //  Pointer to the first element of V (F x L)
+    float *lse = mhsa_args->lse;                               //  Row-wise log-sum-exp, saved for the backward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                          //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                               //  Input/Output Sequence length
+    int F = mhsa_args->attention_map->W;                       //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                       //  Head dimension
+
+    //  A single tile spanning the whole sequence: the head buffers are already H x L
+    struct flash_attn_args_fp16 fa_args;
+    fa_args.m = (float *) temp;
+    fa_args.l = fa_args.m + L;
+    fa_args.scores = (fp16 *) (fa_args.l + L);
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = (fp16) q_rsqrt_fp16((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = mhsa_args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args4);
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = q + L * i * H;
+        fa_args.k = k + L * i * H;
+        fa_args.v = v + L * i * H;
+        fa_args.out = attention_map + L * i * H;
+        fa_args.lse = lse + i * L;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp16, &fa_args);
+    }
+}
+
+void pulp_mhsa_fp16_flash_attn_bw_cl(void *Mhsa_args){
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
 
+    fp16 *attention_map = mhsa_args->attention_map->data;          //  Attention output, before output projection (F x L)
+    fp16 *attention_map_diff = mhsa_args->attention_map->diff;     //  Gradient of the attention output (F x L)
+    fp16 *q = mhsa_args->q->data;                                  //  F x L
+    fp16 *k = mhsa_args->k->data;                                  //  F x L
+    fp16 *v = mhsa_args->v->data;                                  //  F x L
+    fp16 *q_diff = mhsa_args->q->diff;                             //  F x L
+    fp16 *k_diff = mhsa_args->k->diff;                             //  F x L
+    fp16 *v_diff = mhsa_args->v->diff;                             //  F x L
+    float *lse = mhsa_args->lse;                                   //  Row-wise log-sum-exp from the forward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                              //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                                   //  Input/Output Sequence length
+    int F = mhsa_args->attention_map->W;                           //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                           //  Head dimension
+
+    struct flash_attn_bw_args_fp16 bw_args;
+    bw_args.delta = (float *) mhsa_args->temp_buffer;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt_fp16((float) H);
+    bw_args.mask_type = mhsa_args->mask_type;
+    bw_args.mask_window = mhsa_args->mask_window;
+    bw_args.mask_block = mhsa_args->mask_block;
+    bw_args.mask_layout = mhsa_args->mask_layout;
+    bw_args.accumulate = 0;
 
-        //  Scale the current head values by a factor proportional to the head dimension
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = q + L * i * H;
+        bw_args.k = k + L * i * H;
+        bw_args.v = v + L * i * H;
+        bw_args.out = attention_map + L * i * H;
+        bw_args.out_diff = attention_map_diff + L * i * H;
+        bw_args.q_diff = q_diff + L * i * H;
+        bw_args.k_diff = k_diff + L * i * H;
+        bw_args.v_diff = v_diff + L * i * H;
+        bw_args.lse = lse + i * L;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp16, &bw_args);
+    }
+}
+
+void mhsa_flash_attn_bw_delta_fp16(void *flash_attn_bw_args){
+    struct flash_attn_bw_args_fp16 *args = (struct flash_attn_bw_args_fp16 *) flash_attn_bw_args;
+    int H = args->H;
+    int L = args->L;
+
+    const int blockSize = ((L + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > L ? L : start + blockSize;
+
+    for(int r = start; r < stop; r += 2){
+        v2f16 acc = (v2f16) {0, 0};
+        for(int h = 0; h < H; h++)
+            acc += *((v2f16 *) &args->out_diff[h * L + r]) * *((v2f16 *) &args->out[h * L + r]);
+        args->delta[r] = (float) acc[0];
+        args->delta[r + 1] = (float) acc[1];
+    }
+}
+
+void mhsa_flash_attn_bw_kv_fp16(void *flash_attn_bw_args){
+    struct flash_attn_bw_args_fp16 *args = (struct flash_attn_bw_args_fp16 *) flash_attn_bw_args;
+    fp16 *q = args->q;
+    fp16 *k = args->k;
+    fp16 *v = args->v;
+    fp16 *dO = args->out_diff;
+    fp16 *dK = args->k_diff;
+    fp16 *dV = args->v_diff;
+    float *lse = args->lse;
+    float *delta = args->delta;
+    int H = args->H;
+    int L = args->L;
+    fp16 scaling = (fp16) args->scaling;
+    v2f16 vscaling = (v2f16) {scaling, scaling};
+    int sparse = args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+    int masked = args->mask_type != MHSA_MASK_NONE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = ((L + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int step = masked ? 2 * NUM_CORES : 2;
+    const int start = masked ? 2 * pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? L : (start + blockSize > L ? L : start + blockSize);
+
+    //  Two keys (c, c+1) per iteration
+    for(int c = start; c < stop; c += step){
+        if(!args->accumulate){
+            for(int h = 0; h < H; h++){
+                *((v2f16 *) &dK[h * L + c]) = (v2f16) {0, 0};
+                *((v2f16 *) &dV[h * L + c]) = (v2f16) {0, 0};
+            }
+        }
+        // Only the queries attending to key c or c+1 contribute
+        int lo0, hi0, lo1, hi1;
+        mhsa_mask_col_range(args->mask_type, args->mask_window, c, 0, L, &lo0, &hi0);
+        mhsa_mask_col_range(args->mask_type, args->mask_window, c + 1, 0, L, &lo1, &hi1);
+        for(int r = (lo0 < lo1 ? lo0 : lo1); r < (hi0 > hi1 ? hi0 : hi1); r++){
+            int vis0 = r >= lo0 && r < hi0;
+            int vis1 = r >= lo1 && r < hi1;
+            if(sparse){
+                vis0 = mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r, c);
+                vis1 = mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r, c + 1);
+            }
+            if(!vis0 && !vis1){
+                //  With an even block size, c and c+1 share a block: jump to the next query block
+                if(sparse && (args->mask_block & 1) == 0)
+                    r += args->mask_block - 1 - r % args->mask_block;
+                continue;
+            }
+            // Recompute p = softmax(s)[r][c:c+2] and dp = dO[:, r] . v[:, c:c+2]
+            v2f16 s = (v2f16) {0, 0};
+            v2f16 dp = (v2f16) {0, 0};
+            for(int h = 0; h < H; h++){
+                fp16 qv = q[h * L + r];
+                fp16 dov = dO[h * L + r];
+                s += (v2f16) {qv, qv} * *((v2f16 *) &k[h * L + c]);
+                dp += (v2f16) {dov, dov} * *((v2f16 *) &v[h * L + c]);
+            }
+            s *= vscaling;
+            v2f16 x = (v2f16) {(fp16) ((float) s[0] - lse[r]), (fp16) ((float) s[1] - lse[r])};
+            v2f16 p = vexp_fp16(x);
+            if(!vis0) p[0] = 0;
+            if(!vis1) p[1] = 0;
+            fp16 d = (fp16) delta[r];
+            v2f16 ds = p * (dp - (v2f16) {d, d}) * vscaling;
+            for(int h = 0; h < H; h++){
+                fp16 qv = q[h * L + r];
+                fp16 dov = dO[h * L + r];
+                *((v2f16 *) &dV[h * L + c]) += p * (v2f16) {dov, dov};
+                *((v2f16 *) &dK[h * L + c]) += ds * (v2f16) {qv, qv};
+            }
+        }
+    }
+}
+
+void mhsa_flash_attn_bw_q_fp16(void *flash_attn_bw_args){
+    struct flash_attn_bw_args_fp16 *args = (struct flash_attn_bw_args_fp16 *) flash_attn_bw_args;
+    fp16 *q = args->q;
+    fp16 *k = args->k;
+    fp16 *v = args->v;
+    fp16 *dO = args->out_diff;
+    fp16 *dQ = args->q_diff;
+    float *lse = args->lse;
+    float *delta = args->delta;
+    int H = args->H;
+    int L = args->L;
+    fp16 scaling = (fp16) args->scaling;
+    v2f16 vscaling = (v2f16) {scaling, scaling};
+    int sparse = args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+    int masked = args->mask_type != MHSA_MASK_NONE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = ((L + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int step = masked ? 2 * NUM_CORES : 2;
+    const int start = masked ? 2 * pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? L : (start + blockSize > L ? L : start + blockSize);
+
+    //  Two queries (r, r+1) per iteration
+    for(int r = start; r < stop; r += step){
+        v2f16 d = (v2f16) {(fp16) delta[r], (fp16) delta[r + 1]};
+        for(int h = 0; h < H; h++)
+            *((v2f16 *) &dQ[h * L + r]) = (v2f16) {0, 0};
+        // Only the keys seen by query r or r+1 contribute
+        int lo0, hi0, lo1, hi1;
+        mhsa_mask_row_range(args->mask_type, args->mask_window, r, 0, L, &lo0, &hi0);
+        mhsa_mask_row_range(args->mask_type, args->mask_window, r + 1, 0, L, &lo1, &hi1);
+        for(int c = (lo0 < lo1 ? lo0 : lo1); c < (hi0 > hi1 ? hi0 : hi1); c++){
+            int vis0 = c >= lo0 && c < hi0;
+            int vis1 = c >= lo1 && c < hi1;
+            if(sparse){
+                vis0 = mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r, c);
+                vis1 = mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r + 1, c);
+            }
+            if(!vis0 && !vis1){
+                //  With an even block size, r and r+1 share a block: jump to the next key block
+                if(sparse && (args->mask_block & 1) == 0)
+                    c += args->mask_block - 1 - c % args->mask_block;
+                continue;
+            }
+            v2f16 s = (v2f16) {0, 0};
+            v2f16 dp = (v2f16) {0, 0};
+            for(int h = 0; h < H; h++){
+                fp16 kv = k[h * L + c];
+                fp16 vv = v[h * L + c];
+                s += *((v2f16 *) &q[h * L + r]) * (v2f16) {kv, kv};
+                dp += *((v2f16 *) &dO[h * L + r]) * (v2f16) {vv, vv};
+            }
+            s *= vscaling;
+            v2f16 x = (v2f16) {(fp16) ((float) s[0] - lse[r]), (fp16) ((float) s[1] - lse[r + 1])};
+            v2f16 p = vexp_fp16(x);
+            if(!vis0) p[0] = 0;
+            if(!vis1) p[1] = 0;
+            v2f16 ds = p * (dp - d) * vscaling;
+            for(int h = 0; h < H; h++){
+                fp16 kv = k[h * L + c];
+                *((v2f16 *) &dQ[h * L + r]) += ds * (v2f16) {kv, kv};
+            }
+        }
+    }
+}
+
+
+// KV-CACHE INCREMENTAL DECODING
+void pulp_mhsa_kv_cache_fp16_fw_cl(void *Mhsa_kv_cache_args){
+    struct Mhsa_kv_cache_args_fp16 *kv_args = (struct Mhsa_kv_cache_args_fp16 *) Mhsa_kv_cache_args;
+
+    fp16 *inputData = kv_args->input->data;                     //  New tokens (T x E)
+    fp16 *outData = kv_args->output->data;                      //  Output of the new tokens (T x E)
+    fp16 *k_cache = kv_args->k_cache;                           //  Key cache (max_len x F, token-major)
+    fp16 *v_cache = kv_args->v_cache;                           //  Value cache (max_len x F, token-major)
+    fp16 *q = kv_args->q;                                       //  Queries of the new tokens (T x F)
+    fp16 *attention_map = kv_args->attention_map;               //  Attention output of the new tokens (T x F)
+    fp16 *temp = kv_args->temp_buffer;                          //  Support buffer: o_part | m | l | w | m_part | l_part
+    fp16 *BUFF = kv_args->BUFF;                                 //  L1 buffer for the cache tiles (NULL: cache accessed in place)
+    pi_cl_dma_cmd_t * cmd_store = kv_args->cmd_store;
+    int n_heads = kv_args->n_heads;                             //  Number of heads used for MHSA
+
+    int T = kv_args->input->H;                                  //  Number of new tokens
+    int E = kv_args->input->W;                                  //  Input Sequence element size
+    int F = kv_args->coeff_in_q->H;                             //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                        //  Head dimension
+    int P = kv_args->cache_len;                                 //  Tokens already in the cache
+    int Bc = BUFF != NULL ? kv_args->tile_len : P + T;          //  Cache tokens per tile
+
+    if (P + T > kv_args->max_len) {
+        printf("[pulp_mhsa_kv_cache_fp16_fw_cl:] KV cache overflow (%d + %d > %d)!\n", P, T, kv_args->max_len);
+        return;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Q, K, V of the new tokens ~~~~~~~~~~~~~~~~~~~~~~
+    //  K and V are written straight at the end of the cache, or staged in L1 and DMA-ed when the cache lives in L2
+    fp16 *k_new = BUFF != NULL ? kv_args->kv_new : k_cache + P * F;
+    fp16 *v_new = BUFF != NULL ? kv_args->kv_new + T * F : v_cache + P * F;
+
+    struct kv_cache_proj_args_fp16 proj_args;
+    proj_args.in = inputData;
+    proj_args.T = T;
+    proj_args.in_dim = E;
+    proj_args.out_dim = F;
+
+    proj_args.W = kv_args->coeff_in_q->data;
+    proj_args.bias = kv_args->bias_in_q->data;
+    proj_args.out = q;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp16, &proj_args);
+
+    proj_args.W = kv_args->coeff_in_k->data;
+    proj_args.bias = kv_args->bias_in_k->data;
+    proj_args.out = k_new;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp16, &proj_args);
+
+    proj_args.W = kv_args->coeff_in_v->data;
+    proj_args.bias = kv_args->bias_in_v->data;
+    proj_args.out = v_new;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp16, &proj_args);
+
+    if (BUFF != NULL) {
+        pi_cl_dma_cmd((uint32_t) (k_cache + P * F), (uint32_t) (k_new), 2 * T * F, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+        pi_cl_dma_cmd_wait(cmd_store);
+        pi_cl_dma_cmd((uint32_t) (v_cache + P * F), (uint32_t) (v_new), 2 * T * F, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+        pi_cl_dma_cmd_wait(cmd_store);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(q Kt * scaling) V over the cache ~~~~~~~~~~~~~~~~~~~~~~
+    fp16 *k_l1[2], *v_l1[2];
+    k_l1[0] = BUFF;
+    v_l1[0] = k_l1[0] + H * Bc;
+    k_l1[1] = v_l1[0] + H * Bc;
+    v_l1[1] = k_l1[1] + H * Bc;
+    pi_cl_dma_cmd_t cmd_k[2], cmd_v[2];
+
+    struct kv_cache_attn_args_fp16 attn_args;
+    attn_args.H = H;
+    attn_args.ld = BUFF != NULL ? H : F;
+    attn_args.scaling = q_rsqrt_fp16((float) H);
+    attn_args.o_part = temp;
+    float *m = (float *) (temp + NUM_CORES * H);
+    float *l = m + 1;
+    attn_args.w = l + 1;
+    attn_args.m_part = attn_args.w + NUM_CORES;
+    attn_args.l_part = attn_args.m_part + NUM_CORES;
+
+    for (int t = 0; t < T; t++) {
+        int n_keys = P + t + 1;                                 //  Causal: token t sees the cache and the new tokens up to itself
+        int n_tiles = (n_keys + Bc - 1) / Bc;
+
+        for (int i = 0; i < n_heads; i++) {
+            fp16 *k_head = k_cache + i * H;
+            fp16 *v_head = v_cache + i * H;
+            attn_args.q = q + t * F + i * H;
+            attn_args.out = attention_map + t * F + i * H;
+
+            if (BUFF != NULL) {
+                int len = Bc < n_keys ? Bc : n_keys;
+                pi_cl_dma_cmd_2d((uint32_t) (k_head), (uint32_t) (k_l1[0]), 2 * H * len, 2 * F, 2 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[0]);
+                pi_cl_dma_cmd_2d((uint32_t) (v_head), (uint32_t) (v_l1[0]), 2 * H * len, 2 * F, 2 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[0]);
+            }
+
+            for (int t_kv = 0; t_kv < n_tiles; t_kv++) {
+                int cur = t_kv & 1;
+                int p0 = t_kv * Bc;
+                attn_args.n_keys = n_keys - p0 < Bc ? n_keys - p0 : Bc;
+
+                if (BUFF != NULL) {
+                    pi_cl_dma_cmd_wait(&cmd_k[cur]);
+                    pi_cl_dma_cmd_wait(&cmd_v[cur]);
+
+                    //  Prefetch the next cache tile while the current one is processed
+                    if (t_kv + 1 < n_tiles) {
+                        int p1 = p0 + Bc;
+                        int len = n_keys - p1 < Bc ? n_keys - p1 : Bc;
+                        pi_cl_dma_cmd_2d((uint32_t) (k_head + p1 * F), (uint32_t) (k_l1[cur ^ 1]), 2 * H * len, 2 * F, 2 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[cur ^ 1]);
+                        pi_cl_dma_cmd_2d((uint32_t) (v_head + p1 * F), (uint32_t) (v_l1[cur ^ 1]), 2 * H * len, 2 * F, 2 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[cur ^ 1]);
+                    }
+                    attn_args.k = k_l1[cur];
+                    attn_args.v = v_l1[cur];
+                }
+                else {
+                    attn_args.k = k_head + p0 * F;
+                    attn_args.v = v_head + p0 * F;
+                }
+
+                pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_attn_fp16, &attn_args);
+
+                //  Merge the per-core partial statistics into the running ones
+                float max = t_kv == 0 ? -65504.0f : m[0];
+                for (int c = 0; c < NUM_CORES; c++)
+                    if (attn_args.l_part[c] > 0.0f && attn_args.m_part[c] > max)
+                        max = attn_args.m_part[c];
+                attn_args.corr = 0.0f;
+                if (t_kv != 0) {
+                    fp16 d = (fp16) (m[0] - max);
+                    attn_args.corr = (float) vexp_fp16((v2f16) {d, d})[0];
+                }
+                float sum = t_kv == 0 ? 0.0f : l[0] * attn_args.corr;
+                for (int c = 0; c < NUM_CORES; c++) {
+                    fp16 d = (fp16) (attn_args.m_part[c] - max);
+                    attn_args.w[c] = attn_args.l_part[c] > 0.0f ? (float) vexp_fp16((v2f16) {d, d})[0] : 0.0f;
+                    sum += attn_args.w[c] * attn_args.l_part[c];
+                }
+                m[0] = max;
+                l[0] = sum;
+
+                //  Normalization is folded into the merge weights on the last tile
+                if (t_kv == n_tiles - 1) {
+                    float inv_l = 1.0f / sum;
+                    attn_args.corr *= inv_l;
+                    for (int c = 0; c < NUM_CORES; c++)
+                        attn_args.w[c] *= inv_l;
+                }
+                attn_args.first = (t_kv == 0);
+                pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_merge_fp16, &attn_args);
+            }
+        }
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Output projection ~~~~~~~~~~~~~~~~~~~~~~
+    proj_args.in = attention_map;
+    proj_args.W = kv_args->coeff_out->data;
+    proj_args.bias = kv_args->bias_out->data;
+    proj_args.out = outData;
+    proj_args.in_dim = F;
+    proj_args.out_dim = E;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp16, &proj_args);
+
+    kv_args->cache_len = P + T;
+}
+
+void mhsa_kv_cache_proj_fp16(void *kv_cache_proj_args){
+    struct kv_cache_proj_args_fp16 *args = (struct kv_cache_proj_args_fp16 *) kv_cache_proj_args;
+    fp16 *in = args->in;
+    fp16 *W = args->W;
+    fp16 *bias = args->bias;
+    fp16 *out = args->out;
+    int T = args->T;
+    int K = args->in_dim;
+    int N = args->out_dim;
+
+    const int blockSize = (N + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > N ? N : start + blockSize;
+
+    //  Two input features per SIMD lane pair
+    for(int t = 0; t < T; t++){
+        for(int j = start; j < stop; j++){
+            v2f16 acc = (v2f16) {0, 0};
+            for(int e = 0; e < K; e += 2)
+                acc += *((v2f16 *) &W[j * K + e]) * *((v2f16 *) &in[t * K + e]);
+            out[t * N + j] = bias[j] + acc[0] + acc[1];
+        }
+    }
+}
+
+void mhsa_kv_cache_attn_fp16(void *kv_cache_attn_args){
+    struct kv_cache_attn_args_fp16 *args = (struct kv_cache_attn_args_fp16 *) kv_cache_attn_args;
+    fp16 *q = args->q;
+    fp16 *k = args->k;
+    fp16 *v = args->v;
+    int ld = args->ld;
+    int H = args->H;
+    int n_keys = args->n_keys;
+    fp16 scaling = (fp16) args->scaling;
+
+    int core = pi_core_id();
+    fp16 *o = args->o_part + core * H;
+
+    const int blockSize = ((n_keys + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int start = core * blockSize;
+    const int stop = start + blockSize > n_keys ? n_keys : start + blockSize;
+
+    //  Online softmax over the keys of this core, two keys (c, c+1) per iteration
+    float max = -65504.0f;
+    float sum = 0;
+    for(int h = 0; h < H; h += 2)
+        *((v2f16 *) &o[h]) = (v2f16) {0, 0};
+
+    for(int c = start; c < stop; c += 2){
+        int two = c + 1 < stop;
+        v2f16 s0 = (v2f16) {0, 0};
+        v2f16 s1 = (v2f16) {0, 0};
+        for(int h = 0; h < H; h += 2){
+            v2f16 qv = *((v2f16 *) &q[h]);
+            s0 += qv * *((v2f16 *) &k[c * ld + h]);
+            if(two) s1 += qv * *((v2f16 *) &k[(c + 1) * ld + h]);
+        }
+        float x0 = (float) ((fp16) (s0[0] + s0[1]) * scaling);
+        float x1 = two ? (float) ((fp16) (s1[0] + s1[1]) * scaling) : -65504.0f;
+
+        float max_new = x0 > max ? x0 : max;
+        if(x1 > max_new) max_new = x1;
+        fp16 mh = (fp16) max_new;
+        v2f16 p = vexp_fp16((v2f16) {(fp16) x0 - mh, (fp16) x1 - mh});
+        if(!two) p[1] = 0;
+        float corr = 1.0f;
+        if(c == start)
+            corr = 0.0f;
+        else if(max_new > max){
+            fp16 d = (fp16) (max - max_new);
+            corr = (float) vexp_fp16((v2f16) {d, d})[0];
+        }
+        max = max_new;
+        sum = sum * corr + (float) p[0] + (float) p[1];
+
+        v2f16 vcorr = (v2f16) {(fp16) corr, (fp16) corr};
+        v2f16 p0 = (v2f16) {p[0], p[0]};
+        v2f16 p1 = (v2f16) {p[1], p[1]};
+        for(int h = 0; h < H; h += 2){
+            v2f16 acc = *((v2f16 *) &o[h]) * vcorr + p0 * *((v2f16 *) &v[c * ld + h]);
+            if(two) acc += p1 * *((v2f16 *) &v[(c + 1) * ld + h]);
+            *((v2f16 *) &o[h]) = acc;
+        }
+    }
+
+    args->m_part[core] = max;
+    args->l_part[core] = sum;
+}
+
+void mhsa_kv_cache_merge_fp16(void *kv_cache_attn_args){
+    struct kv_cache_attn_args_fp16 *args = (struct kv_cache_attn_args_fp16 *) kv_cache_attn_args;
+    fp16 *out = args->out;
+    fp16 *o_part = args->o_part;
+    float *w = args->w;
+    fp16 corr = (fp16) args->corr;
+    int H = args->H;
+
+    const int blockSize = ((H + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for(int h = start; h < stop; h += 2){
+        v2f16 acc = args->first ? (v2f16) {0, 0} : *((v2f16 *) &out[h]) * (v2f16) {corr, corr};
+        for(int c = 0; c < NUM_CORES; c++){
+            fp16 wc = (fp16) w[c];
+            acc += (v2f16) {wc, wc} * *((v2f16 *) &o_part[c * H + h]);
+        }
+        *((v2f16 *) &out[h]) = acc;
+    }
+}
+
+
+// GROUPED-QUERY ATTENTION
+void pulp_mhsa_gqa_fp16_fw_cl(void *Mhsa_args){
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+
+    fp16 *coeffDataWinQ = mhsa_args->coeff_in_q->data;         //  Input Projection Weights for Query (F x E)
+    fp16 *coeffDataWinK = mhsa_args->coeff_in_k->data;         //  Input Projection Weights for Key (Fkv x E)
+    fp16 *coeffDataWinV = mhsa_args->coeff_in_v->data;         //  Input Projection Weights for Value (Fkv x E)
+
+    fp16 *coeffBiasWinQ = mhsa_args->bias_in_q->data;          //  Input Projection Biases for Query
+    fp16 *coeffBiasWinK = mhsa_args->bias_in_k->data;          //  Input Projection Biases for Key
+    fp16 *coeffBiasWinV = mhsa_args->bias_in_v->data;          //  Input Projection Biases for Value
+
+    fp16 *coeffDataWout = mhsa_args->coeff_out->data;          //  Output Projection Weights (E x F)
+    fp16 *coeffBiasWout = mhsa_args->bias_out->data;           //  Output Projection Biases
+
+    fp16 *attention_map = mhsa_args->attention_map->data;      //  Attention output, before output projection (F x L)
+    fp16 *outData = mhsa_args->output->data;                   //  Output sequence (L x E)
+    fp16 *inputData = mhsa_args->input->data;                  //  Input sequence (L x E)
+    fp16 *temp = mhsa_args->temp_buffer;                       //  Support buffer: m | l (FP32) | scores, then the projected output
+    fp16 *q = mhsa_args->q->data;                              //  F x L
+    fp16 *k = mhsa_args->k->data;                              //  Fkv x L, shared by the heads of a group
+    fp16 *v = mhsa_args->v->data;                              //  Fkv x L, shared by the heads of a group
+    float *lse = mhsa_args->lse;                                //  Row-wise log-sum-exp, saved for the backward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                           //  Number of query heads
+    int n_kv_heads = mhsa_args->n_kv_heads;                     //  Number of key/value heads
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                           //  Hidden dimension of the queries (n_heads * H)
+    int Fkv = mhsa_args->coeff_in_k->H;                         //  Hidden dimension of keys and values (n_kv_heads * H)
+    int H = F / n_heads;                                        //  Head dimension
+    int group = n_heads / n_kv_heads;                           //  Query heads sharing one key/value head
+
+    // M1_q, M1_k, M1_v
+    // Wq * input^T, Wk * input^T, Wv * input^T (K and V only have Fkv rows)
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.B = inputData;                                 //  L x E
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 1;
+    matMul_args1.USE_BIASES = 0;
+
+    struct mm_bias_add_args_fp16 bias_add_args;
+    bias_add_args.W = L;
+    bias_add_args.t = 1;
+
+    if (mhsa_args->rope_cos != NULL) {
+        //  RoPE fused into the epilogue of the Q and K projections
+        struct mm_rope_args_fp16 rope_args;
+        rope_args.mm_args = &matMul_args1;
+        rope_args.cos = mhsa_args->rope_cos;
+        rope_args.sin = mhsa_args->rope_sin;
+        rope_args.H = H;
+        matMul_args1.USE_BIASES = 1;
+
+        matMul_args1.A = coeffDataWinQ;
+        matMul_args1.bias = coeffBiasWinQ;
+        matMul_args1.C = q;
+        matMul_args1.N = F;
+        pi_cl_team_fork(NUM_CORES, mm_rope_fp16, &rope_args);
+
+        matMul_args1.A = coeffDataWinK;
+        matMul_args1.bias = coeffBiasWinK;
+        matMul_args1.C = k;
+        matMul_args1.N = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm_rope_fp16, &rope_args);
+
+        matMul_args1.USE_BIASES = 0;
+    }
+    else {
+        matMul_args1.A = coeffDataWinQ;
+        matMul_args1.C = q;
+        matMul_args1.N = F;
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1);
+        bias_add_args.mat = q;
+        bias_add_args.bias = coeffBiasWinQ;
+        bias_add_args.H = F;
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &bias_add_args);
+
+        matMul_args1.A = coeffDataWinK;
+        matMul_args1.C = k;
+        matMul_args1.N = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1);
+        bias_add_args.mat = k;
+        bias_add_args.bias = coeffBiasWinK;
+        bias_add_args.H = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &bias_add_args);
+    }
+
+    matMul_args1.A = coeffDataWinV;
+    matMul_args1.C = v;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args1);
+    bias_add_args.mat = v;
+    bias_add_args.bias = coeffBiasWinV;
+    bias_add_args.H = Fkv;
+    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &bias_add_args);
+
+    //  Fused attention, head i reads the K/V of head i / group in place
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(Qt K * scaling) V -> attention_map ~~~~~~~~~~~~~~~~~~~~~~
+    struct flash_attn_args_fp16 fa_args;
+    fa_args.m = (float *) temp;
+    fa_args.l = fa_args.m + L;
+    fa_args.scores = (fp16 *) (fa_args.l + L);
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = (fp16) q_rsqrt_fp16((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = mhsa_args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
+
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = q + L * i * H;
+        fa_args.k = k + L * (i / group) * H;
+        fa_args.v = v + L * (i / group) * H;
+        fa_args.out = attention_map + L * i * H;
+        fa_args.lse = lse != NULL ? lse + i * L : NULL;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp16, &fa_args);
+    }
+
+    // M4
+    //  Final attention map projection
+    struct matMul_args_fp16 matMul_args4;
+    matMul_args4.A = coeffDataWout;                             //  E x F
+    matMul_args4.B = attention_map;                             //  F x L
+    matMul_args4.C = temp;                                      //  E x L
+    matMul_args4.N = E;
+    matMul_args4.K = F;
+    matMul_args4.M = L;
+    matMul_args4.trans_B = 0;
+    matMul_args4.USE_BIASES = 0;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args4);
+
+    bias_add_args.mat = temp;
+    bias_add_args.bias = coeffBiasWout;
+    bias_add_args.H = E;
+    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed_fp16, &bias_add_args);
+
+    // T4
+    // The last transpose to original shape
+    struct transp_args_fp16 transp_args4;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
+    transp_args4.N = E;
+    transp_args4.M = L;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args4);
+}
+
+void pulp_mhsa_gqa_fp16_bw_cl(void *Mhsa_args){
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+
+    fp16 *coeffDataWinQ = mhsa_args->coeff_in_q->data;             //  F x E
+    fp16 *coeffDataWinK = mhsa_args->coeff_in_k->data;             //  Fkv x E
+    fp16 *coeffDataWinV = mhsa_args->coeff_in_v->data;             //  Fkv x E
+    fp16 *coeffDataWout = mhsa_args->coeff_out->data;              //  E x F
+
+    fp16 *coeffDiffWinQ = mhsa_args->coeff_in_q->diff;             //  F x E
+    fp16 *coeffDiffWinK = mhsa_args->coeff_in_k->diff;             //  Fkv x E
+    fp16 *coeffDiffWinV = mhsa_args->coeff_in_v->diff;             //  Fkv x E
+    fp16 *coeffDiffWout = mhsa_args->coeff_out->diff;              //  E x F
+
+    fp16 *attention_map = mhsa_args->attention_map->data;          //  F x L
+    fp16 *attention_map_diff = mhsa_args->attention_map->diff;     //  F x L
+    fp16 *inputData = mhsa_args->input->data;                      //  L x E
+    fp16 *inputDiff = mhsa_args->input->diff;                      //  L x E
+    fp16 *outDiff = mhsa_args->output->diff;                       //  L x E
+    fp16 *temp = mhsa_args->temp_buffer;                           //  Support buffer for the transposed operands (L x (F + E))
+    fp16 *q = mhsa_args->q->data;                                  //  F x L
+    fp16 *k = mhsa_args->k->data;                                  //  Fkv x L
+    fp16 *v = mhsa_args->v->data;                                  //  Fkv x L
+    fp16 *q_diff = mhsa_args->q->diff;                             //  F x L
+    fp16 *k_diff = mhsa_args->k->diff;                             //  Fkv x L
+    fp16 *v_diff = mhsa_args->v->diff;                             //  Fkv x L
+    float *lse = mhsa_args->lse;                                    //  Row-wise log-sum-exp from the forward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                               //  Number of query heads
+    int n_kv_heads = mhsa_args->n_kv_heads;                         //  Number of key/value heads
+
+    int L = mhsa_args->input->H;                                    //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                    //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                               //  Hidden dimension of the queries (n_heads * H)
+    int Fkv = mhsa_args->coeff_in_k->H;                             //  Hidden dimension of keys and values (n_kv_heads * H)
+    int H = F / n_heads;                                            //  Head dimension
+    int group = n_heads / n_kv_heads;                               //  Query heads sharing one key/value head
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Output projection ~~~~~~~~~~~~~~~~~~~~~~
+    //  dWout = outDiff^T * attention_map^T
+    struct transp_args_fp16 transp_args;
+    transp_args.in_matrix = outDiff;
+    transp_args.out_matrix = temp;                                  //  E x L
+    transp_args.N = L;
+    transp_args.M = E;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+    struct matMul_args_fp16 matMul_args;
+    matMul_args.A = temp;
+    matMul_args.B = attention_map;
+    matMul_args.C = coeffDiffWout;
+    matMul_args.N = E;
+    matMul_args.K = L;
+    matMul_args.M = F;
+    matMul_args.trans_B = 1;
+    matMul_args.USE_BIASES = 0;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+    //  attention_map_diff = (outDiff * Wout)^T
+    matMul_args.A = outDiff;
+    matMul_args.B = coeffDataWout;
+    matMul_args.C = temp;                                           //  L x F
+    matMul_args.N = L;
+    matMul_args.K = E;
+    matMul_args.M = F;
+    matMul_args.trans_B = 0;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+    transp_args.in_matrix = temp;
+    transp_args.out_matrix = attention_map_diff;
+    transp_args.N = L;
+    transp_args.M = F;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Attention ~~~~~~~~~~~~~~~~~~~~~~
+    //  The gradients of the heads sharing a K/V head are accumulated into it
+    struct flash_attn_bw_args_fp16 bw_args;
+    bw_args.delta = (float *) temp;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt_fp16((float) H);
+    bw_args.mask_type = mhsa_args->mask_type;
+    bw_args.mask_window = mhsa_args->mask_window;
+    bw_args.mask_block = mhsa_args->mask_block;
+    bw_args.mask_layout = mhsa_args->mask_layout;
+
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = q + L * i * H;
+        bw_args.k = k + L * (i / group) * H;
+        bw_args.v = v + L * (i / group) * H;
+        bw_args.out = attention_map + L * i * H;
+        bw_args.out_diff = attention_map_diff + L * i * H;
+        bw_args.q_diff = q_diff + L * i * H;
+        bw_args.k_diff = k_diff + L * (i / group) * H;
+        bw_args.v_diff = v_diff + L * (i / group) * H;
+        bw_args.lse = lse + i * L;
+        bw_args.accumulate = (i % group) != 0;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp16, &bw_args);
+    }
+
+    //  Gradients with respect to Q and K before the rotation
+    if (mhsa_args->rope_cos != NULL) {
+        struct rope_rotate_args_fp16 rot_args;
+        rot_args.cos = mhsa_args->rope_cos;
+        rot_args.sin = mhsa_args->rope_sin;
+        rot_args.L = L;
+        rot_args.H = H;
+        rot_args.inverse = 1;
+
+        rot_args.x = q_diff;
+        rot_args.F = F;
+        pi_cl_team_fork(NUM_CORES, rope_rotate_fp16, &rot_args);
+
+        rot_args.x = k_diff;
+        rot_args.F = Fkv;
+        pi_cl_team_fork(NUM_CORES, rope_rotate_fp16, &rot_args);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Input projections ~~~~~~~~~~~~~~~~~~~~~~
+    //  dW = diff * input
+    matMul_args.B = inputData;
+    matMul_args.K = L;
+    matMul_args.M = E;
+    matMul_args.trans_B = 0;
+
+    matMul_args.A = q_diff;
+    matMul_args.C = coeffDiffWinQ;
+    matMul_args.N = F;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+    matMul_args.A = k_diff;
+    matMul_args.C = coeffDiffWinK;
+    matMul_args.N = Fkv;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+    matMul_args.A = v_diff;
+    matMul_args.C = coeffDiffWinV;
+    pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+    //  inputDiff = q_diff^T * Wq + k_diff^T * Wk + v_diff^T * Wv
+    fp16 *partial = temp + L * F;                                  //  L x E
+    struct vect_sum_args_fp16 vect_sum_args;
+    vect_sum_args.op_1 = inputDiff;
+    vect_sum_args.op_2 = partial;
+    vect_sum_args.dest = inputDiff;
+    vect_sum_args.size = L * E;
+
+    fp16 *diffs[3] = {q_diff, k_diff, v_diff};
+    fp16 *weights[3] = {coeffDataWinQ, coeffDataWinK, coeffDataWinV};
+    int rows[3] = {F, Fkv, Fkv};
+
+    for (int j = 0; j < 3; j++) {
+        transp_args.in_matrix = diffs[j];
+        transp_args.out_matrix = temp;                              //  L x rows
+        transp_args.N = rows[j];
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        matMul_args.A = temp;
+        matMul_args.B = weights[j];
+        matMul_args.C = j == 0 ? inputDiff : partial;
+        matMul_args.N = L;
+        matMul_args.K = rows[j];
+        matMul_args.M = E;
+        pi_cl_team_fork(NUM_CORES, mm_fp16, &matMul_args);
+
+        if (j > 0)
+            pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &vect_sum_args);
+    }
+}
+
+
+//  Issues the non-blocking flash reads of one projection (weights followed by biases) into an L2 slot
+static inline void mhsa_fp16_flash_prefetch(pi_fs_file_t *file_p, struct blob_fp16 *coeff, struct blob_fp16 *bias, fp16 *slot, pi_cl_fs_req_t *req_w, pi_cl_fs_req_t *req_b){
+    pi_cl_fs_copy(file_p, (uint32_t) coeff->data, (void*) (slot), (coeff->dim * 2), 1, req_w);
+    pi_cl_fs_copy(file_p, (uint32_t) bias->data, (void*) (slot + coeff->dim), (bias->dim * 2), 1, req_b);
+}
+
+void tiled_mhsa_fp16_flash(void *Mhsa_args, void* Tiled_mhsa_matmul_args, fp16* BUFF_L2, pi_fs_file_t *file_p, int size){
+    // ======================================== DECLARATIONS ========================================
+    struct Mhsa_args_fp16 *mhsa_args = (struct Mhsa_args_fp16 *) Mhsa_args;
+    struct Tiled_Matmul_Mhsa_args_fp16 *tiled_args = (struct Tiled_Matmul_Mhsa_args_fp16 *) Tiled_mhsa_matmul_args;
+
+    int tile_h = tiled_args->tile_h_sm;
+    int tile_w = tiled_args->tile_w_sm;
+    int tile_dim = tiled_args->tile_dim_sm;
+    fp16* BUFF = tiled_args->BUFF;
+    pi_cl_dma_cmd_t * cmd_store = tiled_args->cmd_store;
+    pi_cl_dma_cmd_t * cmd_load = tiled_args->cmd_load;
+
+    fp16 *attention_map = mhsa_args->attention_map->data;      //  Buffer saving the MHSA map before output projection
+    fp16 *outData = mhsa_args->output->data;                   //  Output sequence (Transposed, E x L)
+    fp16 *inputDataBn = mhsa_args->input_bn->data;             //  Input vector bottlenecked (L x F)
+    fp16 *temp = mhsa_args->temp_buffer;                       //  Support buffer used in the attention head loop
+    fp16 *softmax_buffer = mhsa_args->softmax_buffer->data;    //  Buffer containing the softmax results (necessary to save for backward pass)
+    fp16 *maxes = mhsa_args->maxes;                            //  Buffer containing the row-wise maxes in the softmax process
+    fp16 *sums = mhsa_args->sums;                              //  Buffer containing the row-wise exponential sums in the softmax process
+    fp16 *qt = mhsa_args->q->data;                             //  Pointer to the first element of Q transposed
+    fp16 *kt = mhsa_args->k->data;                             //  Pointer to the first element of K transposed
+    fp16 *vt = mhsa_args->v->data;                             //  Pointer to the first element of V transposed
+    int n_heads = mhsa_args->n_heads;                           //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                           //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    int H = F / n_heads;                                        //  Head dimension
+    float scaling = q_rsqrt_fp16((float) H);                    //  Scaling factor to avoid vanishing gradients
+
+    //  The weights and biases of the four projections live in flash (data holds the flash offset) and are streamed
+    //  into two L2 slots: while a projection computes from one slot, the next one is read into the other.
+    //  L2 layout: input (L x E) | slot 0 | slot 1
+    struct blob_fp16 *coeffs[4] = {mhsa_args->coeff_in_q, mhsa_args->coeff_in_k, mhsa_args->coeff_in_v, mhsa_args->coeff_out};
+    struct blob_fp16 *biases[4] = {mhsa_args->bias_in_q, mhsa_args->bias_in_k, mhsa_args->bias_in_v, mhsa_args->bias_out};
+
+    int slot_size = 0;
+    for (int p = 0; p < 4; p++) {
+        int dim = coeffs[p]->dim + biases[p]->dim;
+        if (dim > slot_size) slot_size = dim;
+    }
+    slot_size = (slot_size + 1) & 0xfffffffe;
+
+    if (L * E + 2 * slot_size > size) {
+        printf("\n[tiled_mhsa_fp16_flash] L2 buffer too small: %d elements needed, %d available\n", L * E + 2 * slot_size, size);
+        return;
+    }
+
+    fp16 *inputData = BUFF_L2;                                  //  Input vector (L x E)
+    fp16 *slot[2];
+    slot[0] = inputData + L * E;
+    slot[1] = slot[0] + slot_size;
+    pi_cl_fs_req_t req_w[2], req_b[2], req_in;
+
+    //  Q weights are needed right away, the input only from M1_v on
+    mhsa_fp16_flash_prefetch(file_p, coeffs[0], biases[0], slot[0], &req_w[0], &req_b[0]);
+    pi_cl_fs_copy(file_p, (uint32_t) mhsa_args->input->data, (void*) (inputData), (L * E * 2), 1, &req_in);
+    pi_cl_fs_wait(&req_w[0]);
+    pi_cl_fs_wait(&req_b[0]);
+    mhsa_fp16_flash_prefetch(file_p, coeffs[1], biases[1], slot[1], &req_w[1], &req_b[1]);
+
+    // M1_q
+    // (Wq)t * input_bn
+    struct matMul_args_fp16 matMul_args1_q;
+    matMul_args1_q.A = slot[0];                                    //  F x F
+    matMul_args1_q.B = inputDataBn;                                //  L x F
+    matMul_args1_q.C = qt;                                         //  F x L
+    matMul_args1_q.N = coeffs[0]->H;
+    matMul_args1_q.K = coeffs[0]->W;
+    matMul_args1_q.M = L;
+    matMul_args1_q.trans_B = 1;
+    matMul_args1_q.bias = slot[0] + coeffs[0]->dim;
+    matMul_args1_q.USE_BIASES = 1;
+    matMul_args1_q.bias_transposed = 1;
+    matMul_args1_q.bias_dim = F;
+
+    tiled_matmul_mhsa_fp16(&matMul_args1_q, Tiled_mhsa_matmul_args, 1);
+
+    pi_cl_fs_wait(&req_w[1]);
+    pi_cl_fs_wait(&req_b[1]);
+    mhsa_fp16_flash_prefetch(file_p, coeffs[2], biases[2], slot[0], &req_w[0], &req_b[0]);
+
+    // M1_k
+    // (Wk)t * input_bn
+    struct matMul_args_fp16 matMul_args1_k;
+    matMul_args1_k.A = slot[1];                                    //  F x F
+    matMul_args1_k.B = inputDataBn;                                //  L x F
+    matMul_args1_k.C = kt;                                         //  F x L
+    matMul_args1_k.N = coeffs[1]->H;
+    matMul_args1_k.K = coeffs[1]->W;
+    matMul_args1_k.M = L;
+    matMul_args1_k.trans_B = 1;
+    matMul_args1_k.bias = slot[1] + coeffs[1]->dim;
+    matMul_args1_k.USE_BIASES = 1;
+    matMul_args1_k.bias_transposed = 1;
+    matMul_args1_k.bias_dim = F;
+
+    tiled_matmul_mhsa_fp16(&matMul_args1_k, Tiled_mhsa_matmul_args, 1);
+
+    //  Cycle on the different heads, the V weights are read from flash in the meantime
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ F -> H ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    for (int i = 0; i < n_heads; i++) {
+        //  T1
+        struct transp_args_fp16 transp_args1;
+        transp_args1.in_matrix = kt + L * i * H;
+        transp_args1.out_matrix = temp;
+        transp_args1.N = H;
+        transp_args1.M = L;
+
+        tiled_transpose_mhsa_fp16(&transp_args1, Tiled_mhsa_matmul_args, 2);
+
+        // M2
+        // Multiply it with the i-th head's transposed Q chunk
+        struct matMul_args_fp16 matMul_args2;
+        matMul_args2.A = temp;
+        matMul_args2.B = qt + L * i * H;
+        matMul_args2.C = softmax_buffer + i * L * L;
+        matMul_args2.N = L;
+        matMul_args2.K = H;
+        matMul_args2.M = L;
+        matMul_args2.trans_B = 0;
+        matMul_args2.USE_BIASES = 0;
+
+        tiled_matmul_mhsa_fp16(&matMul_args2, Tiled_mhsa_matmul_args, 0);
+
+        //  softmax_buffer *= scaling, tile by tile
         struct scalar_mul_args_fp16 s_m_args;
-        s_m_args.input = temp;
-        s_m_args.scalar = (fp16) scaling;
-        s_m_args.dim = L*L;
+        s_m_args.input = BUFF;
+        s_m_args.scalar = scaling;
+        s_m_args.dim = tile_dim;
 
-        pi_cl_team_fork(NUM_CORES,  pulp_scalar_mul_fp16_cl, &s_m_args);
+        for(int k = 0; k < (L / tile_h); k++){
+            for(int j = 0; j < (L / tile_w); j++){
+                pi_cl_dma_cmd_2d((uint32_t) ((softmax_buffer + i * L * L) + k * L * tile_h + j * tile_w), (uint32_t) (BUFF), 2 * tile_dim, 2 * L, 2 * tile_w, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
+                pi_cl_dma_cmd_wait(cmd_load);
+                pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &s_m_args);
+                pi_cl_dma_cmd_2d((uint32_t) ((softmax_buffer + i * L * L) + k * L * tile_h + j * tile_w), (uint32_t) (BUFF), 2 * tile_dim, 2 * L, 2 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+                pi_cl_dma_cmd_wait(cmd_store);
+            }
+        }
 
-        //  Softmax operation
+        // T2
+        //  K * Qt gives the transposed head buffer, the row-wise softmax needs it the other way round
+        struct transp_args_fp16 transp_args2;
+        transp_args2.in_matrix = softmax_buffer + i * L * L;
+        transp_args2.out_matrix = temp;
+        transp_args2.N = L;
+        transp_args2.M = L;
+
+        tiled_transpose_mhsa_fp16(&transp_args2, Tiled_mhsa_matmul_args, 0);
+
+        //  Softmax algorithm
         struct softmax_args_fp16 softmax_arg;
-        struct blob_fp16 input;
-        struct blob_fp16 output;
-        input.data = temp;
-        input.dim = L;
-        output.data = buff0;
-        softmax_arg.input = &input;
-        softmax_arg.output = &output;
+        softmax_arg.input_data = temp;
+        softmax_arg.output_data = softmax_buffer + i * L * L;
         softmax_arg.maxes = maxes;
         softmax_arg.sums = sums;
+        softmax_arg.H = L;
+        softmax_arg.W = L;
 
-        pulp_softmax_fp16_fw_cl(&softmax_arg);
+        pulp_softmax_fp16_fw_cl_tiled(&softmax_arg, Tiled_mhsa_matmul_args);
+    }
 
-        //  Each head result has to be appended to the full attention map, to do so we require to store the current
-        //  softmax buffer data following the H x L convention, therefore we need to transpose_fp16 the memory buffer again.
-        struct transp_args_fp16 transp_args5;
-        transp_args5.matrix = buff0;
-        transp_args5.transp_matrix = temp;
-        transp_args5.N = L;
-        transp_args5.M = L;
+    pi_cl_fs_wait(&req_in);
+    pi_cl_fs_wait(&req_w[0]);
+    pi_cl_fs_wait(&req_b[0]);
+    mhsa_fp16_flash_prefetch(file_p, coeffs[3], biases[3], slot[1], &req_w[1], &req_b[1]);
 
-        pi_cl_team_fork(NUM_CORES, transpose_fp16, &transp_args5);
+    // M1_v
+    // (Wv)t * input
+    struct matMul_args_fp16 matMul_args1_v;
+    matMul_args1_v.A = slot[0];                                    //  F x E
+    matMul_args1_v.B = inputData;                                  //  L x E
+    matMul_args1_v.C = vt;                                         //  F x L
+    matMul_args1_v.N = F;
+    matMul_args1_v.K = E;
+    matMul_args1_v.M = L;
+    matMul_args1_v.trans_B = 1;
+    matMul_args1_v.bias = slot[0] + coeffs[2]->dim;
+    matMul_args1_v.USE_BIASES = 1;
+    matMul_args1_v.bias_transposed = 1;
+    matMul_args1_v.bias_dim = F;
+
+    tiled_matmul_mhsa_fp16(&matMul_args1_v, Tiled_mhsa_matmul_args, 1);
+
+    for (int i = 0; i < n_heads; i++) {
+        // T3
+        //  Back to the H x L convention of the attention map
+        struct transp_args_fp16 transp_args3;
+        transp_args3.in_matrix = softmax_buffer + i * L * L;
+        transp_args3.out_matrix = temp;
+        transp_args3.N = L;
+        transp_args3.M = L;
+
+        tiled_transpose_mhsa_fp16(&transp_args3, Tiled_mhsa_matmul_args, 0);
 
+        // M3
         struct matMul_args_fp16 matMul_args3;
-        if (curr_L1_buffer == 0) {
-            //  Multiply softmax result with the i-th head's Vt chunk
-            matMul_args3.A = v;
-            matMul_args3.B = temp;
-            matMul_args3.C = buff2_a;
-            matMul_args3.N = H;
-            matMul_args3.K = L;
-            matMul_args3.M = L;
-            matMul_args3.trans_B = 0;
-        }
-        else{
-            //  Multiply softmax result with the i-th head's Vt chunk
-            matMul_args3.A = v;
-            matMul_args3.B = temp;
-            matMul_args3.C = buff2_b;
-            matMul_args3.N = H;
-            matMul_args3.K = L;
-            matMul_args3.M = L;
-            matMul_args3.trans_B = 0;
+        matMul_args3.A = vt + L * i * H;
+        matMul_args3.B = temp;
+        matMul_args3.C = attention_map + L * i * H;
+        matMul_args3.N = H;
+        matMul_args3.K = L;
+        matMul_args3.M = L;
+        matMul_args3.trans_B = 0;
+        matMul_args3.USE_BIASES = 0;
+
+        tiled_matmul_mhsa_fp16(&matMul_args3, Tiled_mhsa_matmul_args, 2);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ H -> F ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    pi_cl_fs_wait(&req_w[1]);
+    pi_cl_fs_wait(&req_b[1]);
+
+    // M4
+    //  Final attention map projection
+    struct matMul_args_fp16 matMul_args4;
+    matMul_args4.A = slot[1];
+    matMul_args4.B = attention_map;
+    matMul_args4.C = temp;
+    matMul_args4.N = coeffs[3]->H;
+    matMul_args4.K = coeffs[3]->W;
+    matMul_args4.M = L;
+    matMul_args4.trans_B = 0;
+    matMul_args4.bias = slot[1] + coeffs[3]->dim;
+    matMul_args4.USE_BIASES = 1;
+    matMul_args4.bias_transposed = 1;
+    matMul_args4.bias_dim = E;
+
+    tiled_matmul_mhsa_fp16(&matMul_args4, Tiled_mhsa_matmul_args, 1);
+
+    // T4
+    // The last transpose to original shape
+    struct transp_args_fp16 transp_args4;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
+    transp_args4.N = mhsa_args->input_bn->W;
+    transp_args4.M = L;
+
+    tiled_transpose_mhsa_fp16(&transp_args4, Tiled_mhsa_matmul_args, 1);
+}
+
+
+// DOUBLE BUFFERED MHSA (L2 -> L1 DMA OVERLAPPED WITH COMPUTE)
+
+static inline void mhsa_db_mm_fp16(struct matMul_args_fp16 *matMul_args, int opt_matmul_type){
+    #ifndef OPTIMIZE
+    pi_cl_team_fork(NUM_CORES, mm_fp16, matMul_args);
+    #else
+    struct mm_manager_args_fp16 man_args;
+    man_args.mm_args = matMul_args;
+    man_args.layer_type = LAYER_LINEAR;
+    man_args.step_type = STEP_FW;
+    man_args.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args);
+    #endif
+}
+
+
+//FORWARD W/ DOUBLE BUFFERING L1 DMA
+void pulp_mhsa_fp16_fw_cl_dblbuffer(void* Mhsa_args){
+    struct Mhsa_args_fp16_db *mhsa_args_db = (struct Mhsa_args_fp16_db *) Mhsa_args;
+    fp16 *coeffDataWin_l2 = mhsa_args_db->coeff_in->data;          //  Input Projection Weights in L2 (3F X E)
+    fp16 *coeffDataWout = mhsa_args_db->coeff_out->data;           //  Output Projection Weights (Already transposed from GM)
+    fp16 *attention_map = mhsa_args_db->attention_map->data;       //  Buffer saving the MHSA map before output projection
+    fp16 *attention_map_l2 = mhsa_args_db->attention_map_l2->data; //  Attention map in L2, filled head by head
+    fp16 *outData = mhsa_args_db->output->data;                    //  Output sequence (Transposed, E x L)
+    fp16 *temp = mhsa_args_db->temp_buffer;                        //  Support buffer used in the attention head loop (L x L)
+    fp16 *head_buffer = mhsa_args_db->head_buffer->data;           //  Buffer containing the Kt * Q result of the current head (L x L)
+    fp16 *softmax_buffer = mhsa_args_db->softmax_buffer->data;     //  Softmax results of all heads in L2 (necessary to save for backward pass)
+    fp16 *maxes = mhsa_args_db->maxes;                             //  Buffer containing the row-wise maxes in the softmax process
+    fp16 *sums = mhsa_args_db->sums;                               //  Buffer containing the row-wise exponential sums in the softmax process
+    fp16 *qkv_l2 = mhsa_args_db->qkv->data;                        //  Matrix in L2 containing the transposed Q, K and V (3*F x L)
+    int n_heads = mhsa_args_db->n_heads;                           //  Number of heads used for MHSA
+    int n_tiles = mhsa_args_db->n_tiles;                           //  Number of tiles used for QKV projection
+
+    fp16 *inputData = mhsa_args_db->input->data;                   //  Input vector (Transposed, E x L)
+    fp16 *buff1[2] = {mhsa_args_db->buff1_a->data, mhsa_args_db->buff1_b->data};
+    fp16 *buff2[2] = {mhsa_args_db->buff2_a->data, mhsa_args_db->buff2_b->data};
+
+    int opt_matmul_type = mhsa_args_db->opt_matmul_type_fw;        //  Matmul type used
+
+    int L = mhsa_args_db->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args_db->input->W;                                //  Input Sequence element size
+    int F = mhsa_args_db->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+    int TILE = 3 * F / n_tiles;                                    //  Rows of the fused QKV weights per tile
+
+    #ifdef DEBUG
+    printf("\nPrinting the parameters: L-%d, E-%d, F-%d, TILE-%d, n_tiles-%d\n", L, E, F, TILE, n_tiles);
+    #endif
+
+    int H = F / n_heads;                                           //  Head dimension
+    float scaling = q_rsqrt_fp16((float) H);                       //  Scaling factor to avoid vanishing gradients
+
+    // PART 1: DOUBLE BUFFERING FOR QKV PROJECTION //
+
+    // While a tile of the fused weights is multiplied in one L1 buffer, the next tile is loaded into the other
+    // and the previous result is stored back to L2
+    pi_cl_dma_copy_t copy_in[2], copy_out[2];
+
+    for (int b = 0; b < 2; b++) {
+        copy_in[b].loc = (uint32_t) buff1[b];
+        copy_in[b].size = 2 * TILE * E;
+        copy_in[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy_in[b].id = 0;
+        copy_in[b].merge = 0;
+
+        copy_out[b].loc = (uint32_t) buff2[b];
+        copy_out[b].size = 2 * TILE * L;
+        copy_out[b].dir = PI_CL_DMA_DIR_LOC2EXT;
+        copy_out[b].id = 0;
+        copy_out[b].merge = 0;
+    }
+
+    copy_in[0].ext = (uint32_t) coeffDataWin_l2;
+    pi_cl_dma_memcpy(&copy_in[0]);
+
+    // Projecting input sequence into Q, K, V, one tile at a time
+    struct matMul_args_fp16 matMul_args1;
+    matMul_args1.B = inputData;                                    //  E x L
+    matMul_args1.N = TILE;
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 0;
+
+    for (int tile = 0; tile < n_tiles; tile++) {
+        int cur = tile & 1;
+
+        // Wait for the weights of this tile and for the store that last used the output buffer
+        pi_cl_dma_wait(&copy_in[cur]);
+        if (tile >= 2) pi_cl_dma_wait(&copy_out[cur]);
+
+        // Begin to load next data
+        if (tile < n_tiles - 1) {
+            copy_in[cur ^ 1].ext = (uint32_t) (coeffDataWin_l2 + (tile + 1) * TILE * E);
+            pi_cl_dma_memcpy(&copy_in[cur ^ 1]);
         }
 
-        #ifndef OPTIMIZE
-        pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args3);
-        #else
-        struct mm_manager_args_fp16 man_args3;
-        man_args3.mm_args = &matMul_args3;
-        man_args3.layer_type = LAYER_LINEAR;
-        man_args3.step_type = STEP_FW;
-        man_args3.matmul_type = opt_matmul_type; //MATMUL_TYPE
-        pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args3);
-        #endif
+        matMul_args1.A = buff1[cur];                               //  TILE x E Tile of weight matrix
+        matMul_args1.C = buff2[cur];                               //  TILE x L Q, K, V are saved contiguously, in the same matrix.
+        mhsa_db_mm_fp16(&matMul_args1, opt_matmul_type);
 
-        //printf("\nStore result...");
         // Store results into L2
-        if (curr_L1_buffer == 0) {
-          copy_outA.ext = (uint32_t) &attention_map_l2[i * (H * L)];
-          pi_cl_dma_memcpy(&copy_outA);
+        copy_out[cur].ext = (uint32_t) (qkv_l2 + tile * TILE * L);
+        pi_cl_dma_memcpy(&copy_out[cur]);
+    }
+
+    for (int b = 0; b < 2 && b < n_tiles; b++)
+        pi_cl_dma_wait(&copy_out[b]);
+
+    // PART 2: MULTI-HEAD SELF ATTENTION //
+
+    // The i-th head's Q, K and V are three H x L chunks, F * L apart in QKV
+    pi_cl_dma_copy_2d_t copy2d_in[2];
+    pi_cl_dma_copy_t copy_sm[2];
+
+    for (int b = 0; b < 2; b++) {
+        copy2d_in[b].loc = (uint32_t) buff1[b];
+        copy2d_in[b].size = 2 * 3 * H * L;
+        copy2d_in[b].stride = 2 * F * L;
+        copy2d_in[b].length = 2 * H * L;
+        copy2d_in[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy2d_in[b].id = 0;
+        copy2d_in[b].merge = 0;
+
+        copy_out[b].size = 2 * H * L;
+
+        copy_sm[b].loc = (uint32_t) (buff2[b] + H * L);
+        copy_sm[b].size = 2 * L * L;
+        copy_sm[b].dir = PI_CL_DMA_DIR_LOC2EXT;
+        copy_sm[b].id = 0;
+        copy_sm[b].merge = 0;
+    }
+
+    copy2d_in[0].ext = (uint32_t) qkv_l2;
+    pi_cl_dma_memcpy_2d(&copy2d_in[0]);
+
+    struct transp_args_fp16 transp_args;
+    struct matMul_args_fp16 matMul_args;
+    matMul_args.trans_B = 0;
+
+    struct scalar_mul_args_fp16 s_m_args;
+    s_m_args.input = temp;
+    s_m_args.scalar = (fp16) scaling;
+    s_m_args.dim = L * L;
+
+    struct softmax_args_fp16 softmax_arg;
+    softmax_arg.input_data = temp;
+    softmax_arg.maxes = maxes;
+    softmax_arg.sums = sums;
+    softmax_arg.H = L;
+    softmax_arg.W = L;
+
+    //  Cycle on the different heads
+    for (int i = 0; i < n_heads; i++) {
+        int cur = i & 1;
+
+        // Wait for input data & for the stores that last used the output buffer
+        pi_cl_dma_wait(&copy2d_in[cur]);
+        if (i >= 2) {
+            pi_cl_dma_wait(&copy_out[cur]);
+            pi_cl_dma_wait(&copy_sm[cur]);
         }
-        else {
-          copy_outB.ext = (uint32_t) &attention_map_l2[i * (H * L)];
-          pi_cl_dma_memcpy(&copy_outB);
+
+        // Begin to load next data
+        if (i < n_heads - 1) {
+            copy2d_in[cur ^ 1].ext = (uint32_t) (qkv_l2 + (i + 1) * H * L);
+            pi_cl_dma_memcpy_2d(&copy2d_in[cur ^ 1]);
         }
 
-        //printf("\nSwitch buffers...\n");
-        // Switch buffer roles
-        curr_L1_buffer = 1 - curr_L1_buffer;
-    }
+        fp16 *q = buff1[cur];
+        fp16 *k = q + L * H;
+        fp16 *v = k + L * H;
+        fp16 *head_out = buff2[cur];                               //  H x L
+        fp16 *softmax_out = buff2[cur] + H * L;                    //  L x L
 
-    // Select correct buffer to be waited
-    curr_L1_buffer = 1 - curr_L1_buffer;
-    //curr_L1_buffer != curr_L1_buffer;
-    // Wait for the last transfer
-    if (curr_L1_buffer == 0) {
-        pi_cl_dma_wait(&copy2d_inA);
-        pi_cl_dma_wait(&copy_outA);
+        //  Transpose i-th head's K chunk
+        transp_args.in_matrix = k;
+        transp_args.out_matrix = temp;
+        transp_args.N = H;
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        //  Multiply it with the i-th head's Q chunk
+        matMul_args.A = temp;
+        matMul_args.B = q;
+        matMul_args.C = head_buffer;
+        matMul_args.N = L;
+        matMul_args.K = H;
+        matMul_args.M = L;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type);
+
+        //  Due to the fact that we multiplied K * Qt instead of Q * Kt like in the original MHSA model, the current
+        //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
+        //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
+        transp_args.in_matrix = head_buffer;
+        transp_args.out_matrix = temp;
+        transp_args.N = L;
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        //  Scale the current head values by a factor proportional to the head dimension
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &s_m_args);
+
+        //  Softmax operation, the result is kept for the backward pass
+        softmax_arg.output_data = softmax_out;
+        pulp_softmax_fp16_fw_cl(&softmax_arg);
+
+        //  Each head result has to be appended to the full attention map, to do so we require to store the current
+        //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
+        transp_args.in_matrix = softmax_out;
+        transp_args.out_matrix = temp;
+        transp_args.N = L;
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        //  Multiply softmax result with the i-th head's Vt chunk
+        matMul_args.A = v;
+        matMul_args.B = temp;
+        matMul_args.C = head_out;
+        matMul_args.N = H;
+        matMul_args.K = L;
+        matMul_args.M = L;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type);
+
+        // Store results into L2
+        copy_out[cur].ext = (uint32_t) (attention_map_l2 + i * H * L);
+        pi_cl_dma_memcpy(&copy_out[cur]);
+        copy_sm[cur].ext = (uint32_t) (softmax_buffer + i * L * L);
+        pi_cl_dma_memcpy(&copy_sm[cur]);
     }
-    else {
-        pi_cl_dma_wait(&copy2d_inB);
-        pi_cl_dma_wait(&copy_outB);
+
+    for (int b = 0; b < 2 && b < n_heads; b++) {
+        pi_cl_dma_wait(&copy_out[b]);
+        pi_cl_dma_wait(&copy_sm[b]);
     }
 
-    // DA RIMUOVERE: metto tutto attention map in l1
-    pi_cl_dma_copy_t copy_attmap;
+    // PART 3: OUTPUT PROJECTION //
 
+    pi_cl_dma_copy_t copy_attmap;
     copy_attmap.ext = (uint32_t) attention_map_l2;
     copy_attmap.loc = (uint32_t) attention_map;
-    copy_attmap.size = 2*F*L;
+    copy_attmap.size = 2 * F * L;
     copy_attmap.dir = PI_CL_DMA_DIR_EXT2LOC;
     copy_attmap.id = 0;
     copy_attmap.merge = 0;
@@ -3113,50 +4351,303 @@ void pulp_mhsa_fp16_fw_cl_dblbuffer(void* Mhsa_args){
     pi_cl_dma_wait(&copy_attmap);
 
     //  Final attention map projection
-    struct matMul_args_fp16 matMul_args4;
-    matMul_args4.A = coeffDataWout;
-    matMul_args4.B = attention_map;
-    matMul_args4.C = outData;
-    matMul_args4.N = E;
-    matMul_args4.K = F;
-    matMul_args4.M = L;
-    matMul_args4.trans_B = 0;
-
-    #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES,  mm_fp16, &matMul_args4);
-    #else
-    struct mm_manager_args_fp16 man_args4;
-    man_args4.mm_args = &matMul_args4;
-    man_args4.layer_type = LAYER_LINEAR;
-    man_args4.step_type = STEP_FW;
-    man_args4.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager_fp16, &man_args4);
-    #endif
+    matMul_args.A = coeffDataWout;
+    matMul_args.B = attention_map;
+    matMul_args.C = outData;
+    matMul_args.N = E;
+    matMul_args.K = F;
+    matMul_args.M = L;
+    mhsa_db_mm_fp16(&matMul_args, opt_matmul_type);
 
     #ifdef DEBUG
     printf("\nTransposed Output sequence Data: %d %d\n", E, L);
     for (int j=0; j<L*E; j++){
         if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args4.C[j]);
+        printf("%.8f ", matMul_args.C[j]);
     }
     printf("\n");
     #endif
 }
 
 
- static inline void zero_tensor(void * args) {
+//BACKWARD W/ DOUBLE BUFFERING L1 DMA
+void pulp_mhsa_fp16_bw_cl_dblbuffer(void* Mhsa_args){
+    struct Mhsa_args_fp16_db *mhsa_args_db = (struct Mhsa_args_fp16_db *) Mhsa_args;
+    fp16 *coeffDataWin_l2 = mhsa_args_db->coeff_in->data;          //  Input Projection Weights in L2 (3F X E)
+    fp16 *coeffDiffWin_l2 = mhsa_args_db->coeff_in->diff;          //  Input Projection Weight gradients in L2 (3F X E)
+    fp16 *coeffDataWout = mhsa_args_db->coeff_out->data;           //  Output Projection Weights (E x F)
+    fp16 *coeffDiffWout = mhsa_args_db->coeff_out->diff;           //  Output Projection Weight gradients (E x F)
+    fp16 *attention_map = mhsa_args_db->attention_map->data;       //  Attention map saved by the forward pass (F x L)
+    fp16 *attention_map_diff = mhsa_args_db->attention_map->diff;  //  Attention map gradient (F x L)
+    fp16 *outDiff = mhsa_args_db->output->diff;                    //  Output gradient (Transposed, E x L)
+    fp16 *inputData = mhsa_args_db->input->data;                   //  Input vector (Transposed, E x L)
+    fp16 *inputDiff = mhsa_args_db->input->diff;                   //  Input gradient (Transposed, E x L)
+    fp16 *temp = mhsa_args_db->temp_buffer;                        //  Support buffer
+    fp16 *head_buffer = mhsa_args_db->head_buffer->data;           //  Support buffer
+    fp16 *softmax_buffer = mhsa_args_db->softmax_buffer->data;     //  Softmax results of all heads in L2, saved by the forward pass
+    fp16 *qkv_l2 = mhsa_args_db->qkv->data;                        //  Transposed Q, K and V in L2 (3*F x L)
+    fp16 *qkv_diff_l2 = mhsa_args_db->qkv->diff;                   //  Transposed Q, K and V gradients in L2 (3*F x L)
+    int n_heads = mhsa_args_db->n_heads;                           //  Number of heads used for MHSA
+    int n_tiles = mhsa_args_db->n_tiles;                           //  Number of tiles used for QKV projection
+
+    fp16 *buff1[2] = {mhsa_args_db->buff1_a->data, mhsa_args_db->buff1_b->data};
+    fp16 *buff2[2] = {mhsa_args_db->buff2_a->data, mhsa_args_db->buff2_b->data};
+
+    int opt_matmul_type_wg = mhsa_args_db->opt_matmul_type_wg;     //  Matmul type used for the weight gradients
+    int opt_matmul_type_ig = mhsa_args_db->opt_matmul_type_ig;     //  Matmul type used for the input gradients
+
+    int L = mhsa_args_db->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args_db->input->W;                                //  Input Sequence element size
+    int F = mhsa_args_db->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+    int TILE = 3 * F / n_tiles;                                    //  Rows of the fused QKV weights per tile
+
+    int H = F / n_heads;                                           //  Head dimension
+    float scaling = q_rsqrt_fp16((float) H);                       //  Scaling factor to avoid vanishing gradients
+
+    struct transp_args_fp16 transp_args;
+    struct matMul_args_fp16 matMul_args;
+    matMul_args.trans_B = 0;
+
+    // PART 1: OUTPUT PROJECTION //
+
+    //  Output projection weight gradient: outDiff @ attention_map^T
+    matMul_args.A = outDiff;
+    matMul_args.B = attention_map;
+    matMul_args.C = coeffDiffWout;
+    matMul_args.N = E;
+    matMul_args.K = L;
+    matMul_args.M = F;
+    matMul_args.trans_B = 1;
+    mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_wg);
+
+    //  Attention map gradient: Wout^T @ outDiff
+    transp_args.in_matrix = coeffDataWout;
+    transp_args.out_matrix = temp;
+    transp_args.N = E;
+    transp_args.M = F;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+    matMul_args.A = temp;
+    matMul_args.B = outDiff;
+    matMul_args.C = attention_map_diff;
+    matMul_args.N = F;
+    matMul_args.K = E;
+    matMul_args.M = L;
+    matMul_args.trans_B = 0;
+    mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_ig);
+
+    // PART 2: MULTI-HEAD SELF ATTENTION //
+
+    // Q, K, V and the softmax of the next head are loaded while the current one is processed,
+    // the Q, K and V gradients of the previous head are stored in the meantime
+    pi_cl_dma_copy_2d_t copy2d_in[2], copy2d_out[2];
+    pi_cl_dma_copy_t copy_sm[2];
+
+    for (int b = 0; b < 2; b++) {
+        copy2d_in[b].loc = (uint32_t) buff1[b];
+        copy2d_in[b].size = 2 * 3 * H * L;
+        copy2d_in[b].stride = 2 * F * L;
+        copy2d_in[b].length = 2 * H * L;
+        copy2d_in[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy2d_in[b].id = 0;
+        copy2d_in[b].merge = 0;
+
+        copy_sm[b].loc = (uint32_t) (buff1[b] + 3 * H * L);
+        copy_sm[b].size = 2 * L * L;
+        copy_sm[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy_sm[b].id = 0;
+        copy_sm[b].merge = 0;
+
+        copy2d_out[b].loc = (uint32_t) buff2[b];
+        copy2d_out[b].size = 2 * 3 * H * L;
+        copy2d_out[b].stride = 2 * F * L;
+        copy2d_out[b].length = 2 * H * L;
+        copy2d_out[b].dir = PI_CL_DMA_DIR_LOC2EXT;
+        copy2d_out[b].id = 0;
+        copy2d_out[b].merge = 0;
+    }
+
+    copy2d_in[0].ext = (uint32_t) qkv_l2;
+    pi_cl_dma_memcpy_2d(&copy2d_in[0]);
+    copy_sm[0].ext = (uint32_t) softmax_buffer;
+    pi_cl_dma_memcpy(&copy_sm[0]);
 
-  struct zero_tensor_args * zero_args = (struct zero_tensor_args *) args;
+    struct scalar_mul_args_fp16 s_m_args;
+    s_m_args.input = temp;
+    s_m_args.scalar = (fp16) scaling;
+    s_m_args.dim = L * L;
 
-  fp16 * __restrict__ tensor = zero_args->tensor;
-  int size = zero_args->size;
+    struct softmax_args_fp16 softmax_arg;
+    softmax_arg.H = L;
+    softmax_arg.W = L;
+    softmax_arg.sums = NULL;
+
+    for (int i = 0; i < n_heads; i++) {
+        int cur = i & 1;
+
+        pi_cl_dma_wait(&copy2d_in[cur]);
+        pi_cl_dma_wait(&copy_sm[cur]);
+        if (i >= 2) pi_cl_dma_wait(&copy2d_out[cur]);
+
+        if (i < n_heads - 1) {
+            copy2d_in[cur ^ 1].ext = (uint32_t) (qkv_l2 + (i + 1) * H * L);
+            pi_cl_dma_memcpy_2d(&copy2d_in[cur ^ 1]);
+            copy_sm[cur ^ 1].ext = (uint32_t) (softmax_buffer + (i + 1) * L * L);
+            pi_cl_dma_memcpy(&copy_sm[cur ^ 1]);
+        }
+
+        fp16 *q = buff1[cur];
+        fp16 *k = q + H * L;
+        fp16 *v = k + H * L;
+        fp16 *softmax_out = v + H * L;                             //  L x L, row-wise over the keys
+        fp16 *q_diff = buff2[cur];
+        fp16 *k_diff = q_diff + H * L;
+        fp16 *v_diff = k_diff + H * L;
+        fp16 *head_diff = attention_map_diff + i * H * L;          //  H x L
+
+        //  V gradient: head_diff @ softmax
+        matMul_args.A = head_diff;
+        matMul_args.B = softmax_out;
+        matMul_args.C = v_diff;
+        matMul_args.N = H;
+        matMul_args.K = L;
+        matMul_args.M = L;
+        matMul_args.trans_B = 0;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_wg);
+
+        //  Softmax output gradient: head_diff^T @ V
+        transp_args.in_matrix = head_diff;
+        transp_args.out_matrix = temp;
+        transp_args.N = H;
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        matMul_args.A = temp;
+        matMul_args.B = v;
+        matMul_args.C = head_buffer;
+        matMul_args.N = L;
+        matMul_args.K = H;
+        matMul_args.M = L;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_ig);
+
+        //  Softmax backward, then scaling
+        softmax_arg.output_data = softmax_out;
+        softmax_arg.output_diff = head_buffer;
+        softmax_arg.input_diff = temp;
+        pulp_softmax_fp16_bw_cl(&softmax_arg);
 
-  int blockSize = (size+NUM_CORES-1) / NUM_CORES;
-  int start = pi_core_id()*blockSize;
-  int stop = start+blockSize > size ? size : start+blockSize;
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp16_cl, &s_m_args);
+
+        //  Q gradient: K @ temp^T
+        matMul_args.A = k;
+        matMul_args.B = temp;
+        matMul_args.C = q_diff;
+        matMul_args.N = H;
+        matMul_args.K = L;
+        matMul_args.M = L;
+        matMul_args.trans_B = 1;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_ig);
+
+        //  K gradient: Q @ temp
+        matMul_args.A = q;
+        matMul_args.C = k_diff;
+        matMul_args.trans_B = 0;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_ig);
+
+        copy2d_out[cur].ext = (uint32_t) (qkv_diff_l2 + i * H * L);
+        pi_cl_dma_memcpy_2d(&copy2d_out[cur]);
+    }
+
+    for (int b = 0; b < 2 && b < n_heads; b++)
+        pi_cl_dma_wait(&copy2d_out[b]);
+
+    // PART 3: QKV PROJECTION //
+
+    // Each tile loads TILE rows of the fused weights and of the QKV gradient, computes the matching rows of
+    // the weight gradient and accumulates its contribution to the input gradient
+    pi_cl_dma_copy_t copy_w[2], copy_d[2], copy_out[2];
+
+    for (int b = 0; b < 2; b++) {
+        copy_w[b].loc = (uint32_t) buff1[b];
+        copy_w[b].size = 2 * TILE * E;
+        copy_w[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy_w[b].id = 0;
+        copy_w[b].merge = 0;
+
+        copy_d[b].loc = (uint32_t) (buff1[b] + TILE * E);
+        copy_d[b].size = 2 * TILE * L;
+        copy_d[b].dir = PI_CL_DMA_DIR_EXT2LOC;
+        copy_d[b].id = 0;
+        copy_d[b].merge = 0;
+
+        copy_out[b].loc = (uint32_t) buff2[b];
+        copy_out[b].size = 2 * TILE * E;
+        copy_out[b].dir = PI_CL_DMA_DIR_LOC2EXT;
+        copy_out[b].id = 0;
+        copy_out[b].merge = 0;
+    }
+
+    copy_w[0].ext = (uint32_t) coeffDataWin_l2;
+    pi_cl_dma_memcpy(&copy_w[0]);
+    copy_d[0].ext = (uint32_t) qkv_diff_l2;
+    pi_cl_dma_memcpy(&copy_d[0]);
+
+    struct vect_sum_args_fp16 vect_sum_args;
+    vect_sum_args.op_1 = head_buffer;
+    vect_sum_args.op_2 = inputDiff;
+    vect_sum_args.dest = inputDiff;
+    vect_sum_args.size = E * L;
+
+    for (int tile = 0; tile < n_tiles; tile++) {
+        int cur = tile & 1;
+
+        pi_cl_dma_wait(&copy_w[cur]);
+        pi_cl_dma_wait(&copy_d[cur]);
+        if (tile >= 2) pi_cl_dma_wait(&copy_out[cur]);
+
+        if (tile < n_tiles - 1) {
+            copy_w[cur ^ 1].ext = (uint32_t) (coeffDataWin_l2 + (tile + 1) * TILE * E);
+            pi_cl_dma_memcpy(&copy_w[cur ^ 1]);
+            copy_d[cur ^ 1].ext = (uint32_t) (qkv_diff_l2 + (tile + 1) * TILE * L);
+            pi_cl_dma_memcpy(&copy_d[cur ^ 1]);
+        }
+
+        fp16 *w_tile = buff1[cur];                                 //  TILE x E
+        fp16 *d_tile = buff1[cur] + TILE * E;                      //  TILE x L
+
+        //  Weight gradient rows: d_tile @ input^T
+        matMul_args.A = d_tile;
+        matMul_args.B = inputData;
+        matMul_args.C = buff2[cur];
+        matMul_args.N = TILE;
+        matMul_args.K = L;
+        matMul_args.M = E;
+        matMul_args.trans_B = 1;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_wg);
+
+        copy_out[cur].ext = (uint32_t) (coeffDiffWin_l2 + tile * TILE * E);
+        pi_cl_dma_memcpy(&copy_out[cur]);
+
+        //  Input gradient contribution: w_tile^T @ d_tile
+        transp_args.in_matrix = w_tile;
+        transp_args.out_matrix = temp;
+        transp_args.N = TILE;
+        transp_args.M = E;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix_fp16, &transp_args);
+
+        matMul_args.A = temp;
+        matMul_args.B = d_tile;
+        matMul_args.C = tile == 0 ? inputDiff : head_buffer;
+        matMul_args.N = E;
+        matMul_args.K = TILE;
+        matMul_args.M = L;
+        matMul_args.trans_B = 0;
+        mhsa_db_mm_fp16(&matMul_args, opt_matmul_type_ig);
+
+        if (tile > 0)
+            pi_cl_team_fork(NUM_CORES, vect_sum_fp16, &vect_sum_args);
+    }
 
-  for (int i=start; i<stop; i++) {
-    tensor[i] = zero_args->zero_init;
-  }
+    for (int b = 0; b < 2 && b < n_tiles; b++)
+        pi_cl_dma_wait(&copy_out[b]);
 }
-*/
@@ -13,7 +13,9 @@
 #include "pulp_matmul_fp32.h"
 #include "pulp_train_utils_fp32.h"
 #include "pulp_act_fp32.h"
+#include "pulp_rope_fp32.h"
 #include <math.h>
+#include <float.h>
 
 
 //FORWARD
@@ -73,256 +75,266 @@ void pulp_mhsa_fp32_fw_cl(void *Mhsa_args) {
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~         F x E        @  E x L    -> F x L ~~~~~~~~~~~~~~~~~~~~~~~
     // TODO 0000: Maybe different key size (from q and v)
 
-    // T0_q
     int dims[] = {E, F};
-    int t_axes = {1, 0};
+    int t_axes[] = {1, 0};
+
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused projection: Q, K and V are the three F x L blocks of q->data
+        pulp_mhsa_fp32_qkv_fw_cl(mhsa_args);
+        k = q + F * L;
+        v = k + F * L;
+    }
+    else {
+        // T0_q
 
-    struct transp_args transp_args0_q;
-    transp_args0_q.in_matrix = coeffDataWinQ;
-    transp_args0_q.out_matrix = temp;
-    transp_args0_q.dim = dims;
-    transp_args0_q.transposed_axes = t_axes;
-    transp_args0_q.n_dim = 2;
+        struct transp_args transp_args0_q;
+        transp_args0_q.in_matrix = coeffDataWinQ;
+        transp_args0_q.out_matrix = temp;
+        transp_args0_q.dim = dims;
+        transp_args0_q.transposed_axes = t_axes;
+        transp_args0_q.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_q);
+        pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_q);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_q.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_q.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_q.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_q.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_q
-    // Projecting input sequence into Q
-    struct matMul_args matMul_args1_q;
-    matMul_args1_q.A = temp;                                       //  F x E
-    matMul_args1_q.B = inputData;                                  //  E x L
-    matMul_args1_q.C = q;
-    matMul_args1_q.N = F;
-    matMul_args1_q.K = E;
-    matMul_args1_q.M = L;
-    matMul_args1_q.trans_B = 0;
-    matMul_args1_q.USE_BIASES = 0;
+        // M1_q
+        // Projecting input sequence into Q
+        struct matMul_args matMul_args1_q;
+        matMul_args1_q.A = temp;                                       //  F x E
+        matMul_args1_q.B = inputData;                                  //  E x L
+        matMul_args1_q.C = q;
+        matMul_args1_q.N = F;
+        matMul_args1_q.K = E;
+        matMul_args1_q.M = L;
+        matMul_args1_q.trans_B = 0;
+        matMul_args1_q.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_q);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_q);
 #else
-    struct mm_manager_args man_args1_q;
-    man_args1_q.mm_args = &matMul_args1_q;
-    man_args1_q.layer_type = LAYER_LINEAR;
-    man_args1_q.step_type = STEP_FW;
-    man_args1_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_q);
+        struct mm_manager_args man_args1_q;
+        man_args1_q.mm_args = &matMul_args1_q;
+        man_args1_q.layer_type = LAYER_LINEAR;
+        man_args1_q.step_type = STEP_FW;
+        man_args1_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_q result\n\ncoeffDataWinQ: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_q.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_q result\n\ncoeffDataWinQ: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_q.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_q.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_q.B[j]);
+        }
+        printf("\n");
 
-    printf("\nq: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_q.C[j]);
-    }
-    printf("\n\n");
+        printf("\nq: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_q.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_q
-    struct mm_bias_add_args mm_bias_add_args_q;
-    mm_bias_add_args_q.mat = q;
-    mm_bias_add_args_q.bias = coeffBiasWinQ;
-    mm_bias_add_args_q.H = F;
-    mm_bias_add_args_q.W = L;
+        // Bias_addition_q
+        struct mm_bias_add_args mm_bias_add_args_q;
+        mm_bias_add_args_q.mat = q;
+        mm_bias_add_args_q.bias = coeffBiasWinQ;
+        mm_bias_add_args_q.H = F;
+        mm_bias_add_args_q.W = L;
+        mm_bias_add_args_q.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_q);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_q);
 
-    // T0_k
-    dims = {E, F};
+        // T0_k
 
-    struct transp_args transp_args0_k;
-    transp_args0_k.in_matrix = coeffDataWinK;
-    transp_args0_k.out_matrix = temp;
-    transp_args0_k.dim = dims;
-    transp_args0_k.transposed_axes = t_axes;
-    transp_args0_k.n_dim = 2;
+        struct transp_args transp_args0_k;
+        transp_args0_k.in_matrix = coeffDataWinK;
+        transp_args0_k.out_matrix = temp;
+        transp_args0_k.dim = dims;
+        transp_args0_k.transposed_axes = t_axes;
+        transp_args0_k.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_k);
+        pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_k);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_k.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_k.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_k.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_k.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_k
-    // Projecting input sequence into K
-    struct matMul_args matMul_args1_k;
-    matMul_args1_k.A = temp;                                       //  F x E
-    matMul_args1_k.B = inputData;                                  //  E x L
-    matMul_args1_k.C = k;
-    matMul_args1_k.N = F;
-    matMul_args1_k.K = E;
-    matMul_args1_k.M = L;
-    matMul_args1_k.trans_B = 0;
-    matMul_args1_k.USE_BIASES = 0;
+        // M1_k
+        // Projecting input sequence into K
+        struct matMul_args matMul_args1_k;
+        matMul_args1_k.A = temp;                                       //  F x E
+        matMul_args1_k.B = inputData;                                  //  E x L
+        matMul_args1_k.C = k;
+        matMul_args1_k.N = F;
+        matMul_args1_k.K = E;
+        matMul_args1_k.M = L;
+        matMul_args1_k.trans_B = 0;
+        matMul_args1_k.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_k);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_k);
 #else
-    struct mm_manager_args man_args1_k;
-    man_args1_k.mm_args = &matMul_args1_k;
-    man_args1_k.layer_type = LAYER_LINEAR;
-    man_args1_k.step_type = STEP_FW;
-    man_args1_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_k);
+        struct mm_manager_args man_args1_k;
+        man_args1_k.mm_args = &matMul_args1_k;
+        man_args1_k.layer_type = LAYER_LINEAR;
+        man_args1_k.step_type = STEP_FW;
+        man_args1_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_k);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_k result\n\ncoeffDataWinK: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_k result\n\ncoeffDataWinK: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_k.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_k.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_k.B[j]);
+        }
+        printf("\n");
 
-    printf("\nk: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_k.C[j]);
-    }
-    printf("\n\n");
+        printf("\nk: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_k.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_k
-    struct mm_bias_add_args mm_bias_add_args_k;
-    mm_bias_add_args_k.mat = k;
-    mm_bias_add_args_k.bias = coeffBiasWinK;
-    mm_bias_add_args_k.H = F;
-    mm_bias_add_args_k.W = L;
+        // Bias_addition_k
+        struct mm_bias_add_args mm_bias_add_args_k;
+        mm_bias_add_args_k.mat = k;
+        mm_bias_add_args_k.bias = coeffBiasWinK;
+        mm_bias_add_args_k.H = F;
+        mm_bias_add_args_k.W = L;
+        mm_bias_add_args_k.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_k);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_k);
 
-    // T0_v
-    dims = {E, F};
+        // T0_v
 
-    struct transp_args transp_args0_v;
+        struct transp_args transp_args0_v;
 
-    transp_args0_v.in_matrix = coeffDataWinV;
-    transp_args0_v.out_matrix = temp;
-    transp_args0_v.dim = dims;
-    transp_args0_v.transposed_axes = t_axes;
-    transp_args0_v.n_dim = 2;
+        transp_args0_v.in_matrix = coeffDataWinV;
+        transp_args0_v.out_matrix = temp;
+        transp_args0_v.dim = dims;
+        transp_args0_v.transposed_axes = t_axes;
+        transp_args0_v.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_v);
+        pi_cl_team_fork(NUM_CORES, transpose, &transp_args0_v);
 
 #ifdef DEBUG
-    printf("\n\n\nT0_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  transp_args0_v.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT0_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  transp_args0_v.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args0_v.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args0_v.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M1_v
-    // Projecting input sequence into V
-    struct matMul_args matMul_args1_v;
-    matMul_args1_v.A = temp;                                       //  F x E
-    matMul_args1_v.B = inputData;                                  //  E x L
-    matMul_args1_v.C = v;
-    matMul_args1_v.N = F;
-    matMul_args1_v.K = E;
-    matMul_args1_v.M = L;
-    matMul_args1_v.trans_B = 0;
-    matMul_args1_v.USE_BIASES = 0;
+        // M1_v
+        // Projecting input sequence into V
+        struct matMul_args matMul_args1_v;
+        matMul_args1_v.A = temp;                                       //  F x E
+        matMul_args1_v.B = inputData;                                  //  E x L
+        matMul_args1_v.C = v;
+        matMul_args1_v.N = F;
+        matMul_args1_v.K = E;
+        matMul_args1_v.M = L;
+        matMul_args1_v.trans_B = 0;
+        matMul_args1_v.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_v);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args1_v);
 #else
-    struct mm_manager_args man_args1_v;
-    man_args1_v.mm_args = &matMul_args1_v;
-    man_args1_v.layer_type = LAYER_LINEAR;
-    man_args1_v.step_type = STEP_FW;
-    man_args1_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_v);
+        struct mm_manager_args man_args1_v;
+        man_args1_v.mm_args = &matMul_args1_v;
+        man_args1_v.layer_type = LAYER_LINEAR;
+        man_args1_v.step_type = STEP_FW;
+        man_args1_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM1_v result\n\ncoeffDataWinV: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ",  matMul_args1_v.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM1_v result\n\ncoeffDataWinV: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ",  matMul_args1_v.A[j]);
+        }
+        printf("\n");
 
-    printf("\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_v.B[j]);
-    }
-    printf("\n");
+        printf("\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_v.B[j]);
+        }
+        printf("\n");
 
-    printf("\nv: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args1_v.C[j]);
-    }
-    printf("\n\n");
+        printf("\nv: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args1_v.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // Bias_addition_v
-    struct mm_bias_add_args mm_bias_add_args_v;
-    mm_bias_add_args_v.mat = v;
-    mm_bias_add_args_v.bias = coeffBiasWinV;
-    mm_bias_add_args_v.H = F;
-    mm_bias_add_args_v.W = L;
+        // Bias_addition_v
+        struct mm_bias_add_args mm_bias_add_args_v;
+        mm_bias_add_args_v.mat = v;
+        mm_bias_add_args_v.bias = coeffBiasWinV;
+        mm_bias_add_args_v.H = F;
+        mm_bias_add_args_v.W = L;
+        mm_bias_add_args_v.t = 1;
 
-    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_v);
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &mm_bias_add_args_v);
+    }
 
     //  Cycle on the different heads
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ F -> H ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -335,7 +347,8 @@ void pulp_mhsa_fp32_fw_cl(void *Mhsa_args) {
         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~    L x H     @ H x L ->      L x L     ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
         //  T1
-        dims = {H, L};
+        dims[0] = H;
+        dims[1] = L;
 
         struct transp_args transp_args1;
 
@@ -451,7 +464,8 @@ void pulp_mhsa_fp32_fw_cl(void *Mhsa_args) {
         //  head buffer is transposed. To achieve the best experimental accuracy, the Softmax algorithm requires to compute
         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
         // T2
-        dims[] = {L, L};
+        dims[0] = L;
+        dims[1] = L;
 
         struct transp_args transp_args2;
 
@@ -517,7 +531,8 @@ void pulp_mhsa_fp32_fw_cl(void *Mhsa_args) {
         // T3
         //  Each head result has to be appended to the full attention map, to do so we require to store the current
         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
-        dims[] = {L, L};
+        dims[0] = L;
+        dims[1] = L;
 
         struct transp_args transp_args3;
 
@@ -676,6 +691,14 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
     float *k_diff = mhsa_args->k->diff;       // F x L
     float *v_diff = mhsa_args->v->diff;       // F x L
 
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused QKV projection: Q, K, V and their gradients are the three F x L blocks of q->data / q->diff
+        k = q + F * L;
+        v = k + F * L;
+        k_diff = q_diff + F * L;
+        v_diff = k_diff + F * L;
+    }
+
     float *outDiff = mhsa_args->output->diff; // L x E
     float *inputDiff = mhsa_args->input->diff; // L x E
     float *attention_map_diff = mhsa_args->attention_map->diff; // F x L
@@ -785,12 +808,13 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
 #endif
 
     // T2
-    dims = {E, F};
+    dims[0] = E;
+    dims[1] = F;
 
     struct transp_args transp_args2;
 
-    transp_args2.matrix = coeffDataWout;
-    transp_args2.transp_matrix = temp;
+    transp_args2.in_matrix = coeffDataWout;
+    transp_args2.out_matrix = temp;
     transp_args2.dim = dims;
     transp_args2.transposed_axes = t_axes;
     transp_args2.n_dim = 2;
@@ -927,7 +951,8 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
 #endif
 
         // T3
-        dims[] = {L, H};
+        dims[0] = H;
+        dims[1] = L;
 
         struct transp_args transp_args3;
 
@@ -1016,7 +1041,8 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
         // ~~~~~~~~~~~~~~~~~~ "IN-PLACE"_TRANSFORM (grad) [L x L] ~~~~~~~~~~~~~~~~~~                                              (T5 & C2)
 
         // T4
-        dims[] = {L, L};
+        dims[0] = L;
+        dims[1] = L;
 
         struct transp_args transp_args4;
 
@@ -1103,7 +1129,8 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
 #endif
 
         // T5
-        dims[] = {L, L};
+        dims[0] = L;
+        dims[1] = L;
 
         struct transp_args transp_args5;
 
@@ -1213,7 +1240,8 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
         // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ H x L @ L x L -> H x L  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
         // T6
-        dims[] = {H, L};
+        dims[0] = H;
+        dims[1] = L;
 
         struct transp_args transp_args6;
 
@@ -1287,7 +1315,8 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
 #endif
 
         // T7
-        dims[] = {L, H};
+        dims[0] = L;
+        dims[1] = H;
 
         struct transp_args transp_args7;
 
@@ -1422,329 +1451,578 @@ void pulp_mhsa_fp32_bw_cl(void *Mhsa_args) {
     // ~~~~~~~~~~~~~~~~~~~~~~ inputDiff + temp  -> inputDiff  ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~    (SUM_v)
     // ~~~~~~~~~~~~~~~~~~~~~~   E x L   + E x L ->   E x L    ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 
-    // T8
-    dims[] = {E, L};
+    if (mhsa_args->coeff_in_qkv != NULL) {
+        //  Fused projection, q->diff holds the Q, K and V gradients
+        pulp_mhsa_fp32_qkv_bw_cl(mhsa_args);
+    }
+    else {
+        // T8
+        dims[0] = E;
+        dims[1] = L;
 
-    struct transp_args transp_args8;
+        struct transp_args transp_args8;
 
-    transp_args8.in_matrix = inputData;
-    transp_args8.out_matrix = temp;
-    transp_args8.dim = dims;
-    transp_args8.transposed_axes = t_axes;
-    transp_args8.n_dim = 2;
+        transp_args8.in_matrix = inputData;
+        transp_args8.out_matrix = temp;
+        transp_args8.dim = dims;
+        transp_args8.transposed_axes = t_axes;
+        transp_args8.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args8);
+        pi_cl_team_fork(NUM_CORES, transpose, &transp_args8);
 
 #ifdef DEBUG
-    printf("\n\n\nT8 result\n\ninputData: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  transp_args8.matrix[j]);
-    }
-    printf("\n");
+        printf("\n\n\nT8 result\n\ninputData: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  transp_args8.matrix[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", transp_args8.transp_matrix[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", transp_args8.transp_matrix[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_q
-    struct matMul_args matMul_args7_q;
-    matMul_args7_q.A = q_diff;
-    matMul_args7_q.B = temp;
-    matMul_args7_q.C = coeffDiffWinQ;
-    matMul_args7_q.N = F;
-    matMul_args7_q.K = L;
-    matMul_args7_q.M = E;
-    matMul_args7_q.trans_B = 0;
-    matMul_args7_q.USE_BIASES = 0;
+        // M7_q
+        struct matMul_args matMul_args7_q;
+        matMul_args7_q.A = q_diff;
+        matMul_args7_q.B = temp;
+        matMul_args7_q.C = coeffDiffWinQ;
+        matMul_args7_q.N = F;
+        matMul_args7_q.K = L;
+        matMul_args7_q.M = E;
+        matMul_args7_q.trans_B = 0;
+        matMul_args7_q.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_q);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_q);
 #else
-    struct mm_manager_args man_args7_q;
-    man_args7_q.mm_args = &matMul_args7_q;
-    man_args7_q.layer_type = LAYER_LINEAR;
-    man_args7_q.step_type = STEP_FW;
-    man_args7_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_q);
+        struct mm_manager_args man_args7_q;
+        man_args7_q.mm_args = &matMul_args7_q;
+        man_args7_q.layer_type = LAYER_LINEAR;
+        man_args7_q.step_type = STEP_FW;
+        man_args7_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_q result\n\nq_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_q.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_q result\n\nq_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_q.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_q.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_q.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinQ: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_q.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinQ: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_q.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_k
-    struct matMul_args matMul_args7_k;
-    matMul_args7_k.A = k_diff;
-    matMul_args7_k.B = temp;
-    matMul_args7_k.C = coeffDiffWinK;
-    matMul_args7_k.N = F;
-    matMul_args7_k.K = L;
-    matMul_args7_k.M = E;
-    matMul_args7_k.trans_B = 0;
-    matMul_args7_k.USE_BIASES = 0;
+        // M7_k
+        struct matMul_args matMul_args7_k;
+        matMul_args7_k.A = k_diff;
+        matMul_args7_k.B = temp;
+        matMul_args7_k.C = coeffDiffWinK;
+        matMul_args7_k.N = F;
+        matMul_args7_k.K = L;
+        matMul_args7_k.M = E;
+        matMul_args7_k.trans_B = 0;
+        matMul_args7_k.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_k);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_k);
 #else
-    struct mm_manager_args man_args7_k;
-    man_args7_k.mm_args = &matMul_args7_k;
-    man_args7_k.layer_type = LAYER_LINEAR;
-    man_args7_k.step_type = STEP_FW;
-    man_args7_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_k);
+        struct mm_manager_args man_args7_k;
+        man_args7_k.mm_args = &matMul_args7_k;
+        man_args7_k.layer_type = LAYER_LINEAR;
+        man_args7_k.step_type = STEP_FW;
+        man_args7_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_k);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_k result\n\nk_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_k result\n\nk_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_k.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_k.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_k.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinK: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_k.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinK: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_k.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M7_v
-    struct matMul_args matMul_args7_v;
-    matMul_args7_v.A = v_diff;
-    matMul_args7_v.B = temp;
-    matMul_args7_v.C = coeffDiffWinV;
-    matMul_args7_v.N = F;
-    matMul_args7_v.K = L;
-    matMul_args7_v.M = E;
-    matMul_args7_v.trans_B = 0;
-    matMul_args7_v.USE_BIASES = 0;
+        // M7_v
+        struct matMul_args matMul_args7_v;
+        matMul_args7_v.A = v_diff;
+        matMul_args7_v.B = temp;
+        matMul_args7_v.C = coeffDiffWinV;
+        matMul_args7_v.N = F;
+        matMul_args7_v.K = L;
+        matMul_args7_v.M = E;
+        matMul_args7_v.trans_B = 0;
+        matMul_args7_v.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_v);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args7_v);
 #else
-    struct mm_manager_args man_args7_v;
-    man_args7_v.mm_args = &matMul_args7_v;
-    man_args7_v.layer_type = LAYER_LINEAR;
-    man_args7_v.step_type = STEP_FW;
-    man_args7_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_v);
+        struct mm_manager_args man_args7_v;
+        man_args7_v.mm_args = &matMul_args7_v;
+        man_args7_v.layer_type = LAYER_LINEAR;
+        man_args7_v.step_type = STEP_FW;
+        man_args7_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args7_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM7_v result\n\nv_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ",  matMul_args7_v.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM7_v result\n\nv_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ",  matMul_args7_v.A[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", L, E);
-    for (int j=0; j<L*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_v.B[j]);
-    }
-    printf("\n");
+        printf("\ntemp: %d %d\n", L, E);
+        for (int j=0; j<L*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_v.B[j]);
+        }
+        printf("\n");
 
-    printf("\ncoeffDiffWinV: %d %d\n", F, E);
-    for (int j=0; j<F*E; j++){
-        if(!(j%(E))) printf("\n");
-        printf("%.8f ", matMul_args7_v.C[j]);
-    }
-    printf("\n\n");
+        printf("\ncoeffDiffWinV: %d %d\n", F, E);
+        for (int j=0; j<F*E; j++){
+            if(!(j%(E))) printf("\n");
+            printf("%.8f ", matMul_args7_v.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // M8_q
-    struct matMul_args matMul_args8_q;
-    matMul_args8_q.A = coeffDataWinQ;
-    matMul_args8_q.B = q_diff;
-    matMul_args8_q.C = temp;
-    matMul_args8_q.N = E;
-    matMul_args8_q.K = F;
-    matMul_args8_q.M = L;
-    matMul_args8_q.trans_B = 0;
-    matMul_args8_q.USE_BIASES = 0;
+        // M8_q
+        struct matMul_args matMul_args8_q;
+        matMul_args8_q.A = coeffDataWinQ;
+        matMul_args8_q.B = q_diff;
+        matMul_args8_q.C = temp;
+        matMul_args8_q.N = E;
+        matMul_args8_q.K = F;
+        matMul_args8_q.M = L;
+        matMul_args8_q.trans_B = 0;
+        matMul_args8_q.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_q);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_q);
 #else
-    struct mm_manager_args man_args8_q;
-    man_args8_q.mm_args = &matMul_args8_q;
-    man_args8_q.layer_type = LAYER_LINEAR;
-    man_args8_q.step_type = STEP_FW;
-    man_args8_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_q);
+        struct mm_manager_args man_args8_q;
+        man_args8_q.mm_args = &matMul_args8_q;
+        man_args8_q.layer_type = LAYER_LINEAR;
+        man_args8_q.step_type = STEP_FW;
+        man_args8_q.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_q);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM8_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_q.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM8_q result\n\ncoeffDataWinQ [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_q.A[j]);
+        }
+        printf("\n");
 
-    printf("\nq_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_q.B[j]);
-    }
-    printf("\n");
+        printf("\nq_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_q.B[j]);
+        }
+        printf("\n");
 
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_q.C[j]);
-    }
-    printf("\n\n");
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_q.C[j]);
+        }
+        printf("\n\n");
 #endif
 
-    // SUM_q
-    int dims[] = {E * L};
+        // SUM_q
+        struct vect_sum_args vect_sum_args;
+        vect_sum_args.op_1 = inputDiff;
+        vect_sum_args.op_2 = temp;
+        vect_sum_args.dest = inputDiff;
+        vect_sum_args.size = E * L;
+
+        pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
+
+        // M8_k
+        struct matMul_args matMul_args8_k;
+        matMul_args8_k.A = coeffDataWinK;
+        matMul_args8_k.B = k_diff;
+        matMul_args8_k.C = temp;
+        matMul_args8_k.N = E;
+        matMul_args8_k.K = F;
+        matMul_args8_k.M = L;
+        matMul_args8_k.trans_B = 0;
+        matMul_args8_k.USE_BIASES = 0;
 
-    struct vect_sum_args vect_sum_args;
+#ifndef OPTIMIZE
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_k);
+#else
+        struct mm_manager_args man_args8_k;
+        man_args8_k.mm_args = &matMul_args8_k;
+        man_args8_k.layer_type = LAYER_LINEAR;
+        man_args8_k.step_type = STEP_FW;
+        man_args8_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_k);
+#endif
 
-    vect_sum_args.op_1 = inputDiff;
-    vect_sum_args.op_2 = temp;
-    vect_sum_args.dest = inputDiff;
+#ifdef DEBUG
+        printf("\n\n\nM8_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_k.A[j]);
+        }
+        printf("\n");
 
-    vect_sum_args.op_1_dims = dims;
-    vect_sum_args.op_2_dims = dims;
+        printf("\nk_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_k.B[j]);
+        }
+        printf("\n");
 
-    vect_sum_args.op_1_dims_len = 1;
-    vect_sum_args.op_2_dims_len = 1;
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_k.C[j]);
+        }
+        printf("\n\n");
+#endif
 
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp32, &vect_sum_args);
+        // SUM_k
+        pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
 
-    // M8_k
-    struct matMul_args matMul_args8_k;
-    matMul_args8_k.A = coeffDataWinK;
-    matMul_args8_k.B = k_diff;
-    matMul_args8_k.C = temp;
-    matMul_args8_k.N = E;
-    matMul_args8_k.K = F;
-    matMul_args8_k.M = L;
-    matMul_args8_k.trans_B = 0;
-    matMul_args8_k.USE_BIASES = 0;
+        // M8_v
+        struct matMul_args matMul_args8_v;
+        matMul_args8_v.A = coeffDataWinV;
+        matMul_args8_v.B = v_diff;
+        matMul_args8_v.C = temp;
+        matMul_args8_v.N = E;
+        matMul_args8_v.K = F;
+        matMul_args8_v.M = L;
+        matMul_args8_v.trans_B = 0;
+        matMul_args8_v.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_k);
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_v);
 #else
-    struct mm_manager_args man_args8_k;
-    man_args8_k.mm_args = &matMul_args8_k;
-    man_args8_k.layer_type = LAYER_LINEAR;
-    man_args8_k.step_type = STEP_FW;
-    man_args8_k.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_k);
+        struct mm_manager_args man_args8_v;
+        man_args8_v.mm_args = &matMul_args8_v;
+        man_args8_v.layer_type = LAYER_LINEAR;
+        man_args8_v.step_type = STEP_FW;
+        man_args8_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
+        pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_v);
 #endif
 
 #ifdef DEBUG
-    printf("\n\n\nM8_k result\n\ncoeffDataWinK [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_k.A[j]);
-    }
-    printf("\n");
+        printf("\n\n\nM8_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
+        for (int j=0; j<E*F; j++){
+            if(!(j%(F))) printf("\n");
+            printf("%.8f ",  matMul_args8_v.A[j]);
+        }
+        printf("\n");
 
-    printf("\nk_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_k.B[j]);
+        printf("\nv_diff: %d %d\n", F, L);
+        for (int j=0; j<F*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_v.B[j]);
+        }
+        printf("\n");
+
+        printf("\ntemp: %d %d\n", E, L);
+        for (int j=0; j<E*L; j++){
+            if(!(j%(L))) printf("\n");
+            printf("%.8f ", matMul_args8_v.C[j]);
+        }
+        printf("\n\n");
+#endif
+
+        // SUM_v
+        pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
     }
-    printf("\n");
+}
 
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_k.C[j]);
+
+//FUSED QKV PROJECTION
+void pulp_mhsa_fp32_qkv_fw_cl(void *Mhsa_args) {
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *coeffDataWinQKV = mhsa_args->coeff_in_qkv->data;     //  Input Projection Weights Wq | Wk | Wv (3F x E)
+    float *inputData = mhsa_args->input->data;                  //  Input vector (Transposed, E x L)
+    float *qkv = mhsa_args->q->data;                            //  Q | K | V (3F x L)
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    // M1_qkv
+    // One pass over the input for the three projections, the biases are added row-wise by the matmul manager
+    struct matMul_args matMul_args1;
+    matMul_args1.A = coeffDataWinQKV;                              //  3F x E
+    matMul_args1.B = inputData;                                    //  E x L
+    matMul_args1.C = qkv;                                          //  3F x L
+    matMul_args1.N = 3 * F;
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 0;
+    matMul_args1.bias = mhsa_args->bias_in_qkv != NULL ? mhsa_args->bias_in_qkv->data : NULL;
+    matMul_args1.bias_dim = 3 * F;
+    matMul_args1.USE_BIASES = mhsa_args->bias_in_qkv != NULL;
+    matMul_args1.bias_transposed = 1;
+
+    struct mm_manager_args man_args1;
+    man_args1.mm_args = &matMul_args1;
+    man_args1.layer_type = LAYER_LINEAR;
+    man_args1.step_type = STEP_FW;
+    man_args1.matmul_type = mhsa_args->opt_matmul_type_fw; //MATMUL_TYPE
+    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args1);
+
+    // LoRA on the fused projection: qkv += lora_B_qkv @ (lora_scale * lora_A_qkv @ input)
+    if (mhsa_args->lora_rank > 0) {
+        int R = mhsa_args->lora_rank;
+        float *hidden = mhsa_args->lora_hidden_qkv->data;           //  R x L
+        float *temp = mhsa_args->temp_buffer;
+
+        // M1_lora_a
+        struct matMul_args matMul_args_la;
+        matMul_args_la.A = mhsa_args->lora_A_qkv->data;            //  R x E
+        matMul_args_la.B = inputData;                              //  E x L
+        matMul_args_la.C = hidden;                                 //  R x L
+        matMul_args_la.N = R;
+        matMul_args_la.K = E;
+        matMul_args_la.M = L;
+        matMul_args_la.trans_B = 0;
+        matMul_args_la.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_la);
+
+        struct scalar_mul_args scalar_args_l;
+        scalar_args_l.input = hidden;
+        scalar_args_l.scalar = mhsa_args->lora_scale;
+        scalar_args_l.dim = R * L;
+
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp32_cl, &scalar_args_l);
+
+        // M1_lora_b
+        struct matMul_args matMul_args_lb;
+        matMul_args_lb.A = mhsa_args->lora_B_qkv->data;            //  3F x R
+        matMul_args_lb.B = hidden;                                 //  R x L
+        matMul_args_lb.C = temp;                                   //  3F x L
+        matMul_args_lb.N = 3 * F;
+        matMul_args_lb.K = R;
+        matMul_args_lb.M = L;
+        matMul_args_lb.trans_B = 0;
+        matMul_args_lb.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_lb);
+
+        struct vect_sum_args vect_sum_args_l;
+        vect_sum_args_l.op_1 = qkv;
+        vect_sum_args_l.op_2 = temp;
+        vect_sum_args_l.dest = qkv;
+        vect_sum_args_l.size = 3 * F * L;
+
+        pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args_l);
     }
-    printf("\n\n");
-#endif
+}
 
-    // SUM_k
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp32, &vect_sum_args);
 
-    // M8_v
-    struct matMul_args matMul_args8_v;
-    matMul_args8_v.A = coeffDataWinV;
-    matMul_args8_v.B = v_diff;
-    matMul_args8_v.C = temp;
-    matMul_args8_v.N = E;
-    matMul_args8_v.K = F;
-    matMul_args8_v.M = L;
-    matMul_args8_v.trans_B = 0;
-    matMul_args8_v.USE_BIASES = 0;
+void pulp_mhsa_fp32_qkv_bw_cl(void *Mhsa_args) {
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *coeffDataWinQKV = mhsa_args->coeff_in_qkv->data;     //  Input Projection Weights Wq | Wk | Wv (3F x E)
+    float *coeffDiffWinQKV = mhsa_args->coeff_in_qkv->diff;     //  3F x E
+    float *inputData = mhsa_args->input->data;                  //  E x L
+    float *inputDiff = mhsa_args->input->diff;                  //  E x L
+    float *qkv_diff = mhsa_args->q->diff;                       //  Q | K | V gradients (3F x L)
+    float *temp = mhsa_args->temp_buffer;
+
+    int L = mhsa_args->input->H;
+    int E = mhsa_args->input->W;
+    int F = mhsa_args->attention_map->W;
+
+    // With LoRA, coeff_in_qkv is frozen and gets no gradient
+    if (mhsa_args->lora_rank == 0) {
+        // M7_qkv
+        // qkv_diff @ inputData^T -> coeffDiffWinQKV
+        struct matMul_args matMul_args7;
+        matMul_args7.A = qkv_diff;                                     //  3F x L
+        matMul_args7.B = inputData;                                    //  E x L
+        matMul_args7.C = coeffDiffWinQKV;                              //  3F x E
+        matMul_args7.N = 3 * F;
+        matMul_args7.K = L;
+        matMul_args7.M = E;
+        matMul_args7.trans_B = 1;
+        matMul_args7.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args7);
+    }
+
+    // T8_qkv
+    struct transp_args transp_args8;
+    transp_args8.in_matrix = coeffDataWinQKV;
+    transp_args8.out_matrix = temp;                                //  E x 3F
+    transp_args8.N = 3 * F;
+    transp_args8.M = E;
+
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args8);
+
+    // M8_qkv
+    struct matMul_args matMul_args8;
+    matMul_args8.A = temp;                                         //  E x 3F
+    matMul_args8.B = qkv_diff;                                     //  3F x L
+    matMul_args8.C = temp + 3 * F * E;                             //  E x L
+    matMul_args8.N = E;
+    matMul_args8.K = 3 * F;
+    matMul_args8.M = L;
+    matMul_args8.trans_B = 0;
+    matMul_args8.USE_BIASES = 0;
 
 #ifndef OPTIMIZE
-    pi_cl_team_fork(NUM_CORES, mm, &matMul_args8_v);
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args8);
 #else
-    struct mm_manager_args man_args8_v;
-    man_args8_v.mm_args = &matMul_args8_v;
-    man_args8_v.layer_type = LAYER_LINEAR;
-    man_args8_v.step_type = STEP_FW;
-    man_args8_v.matmul_type = opt_matmul_type; //MATMUL_TYPE
-    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8_v);
+    int opt_matmul_type = mhsa_args->opt_matmul_type_ig;
+    struct mm_manager_args man_args8;
+    man_args8.mm_args = &matMul_args8;
+    man_args8.layer_type = LAYER_LINEAR;
+    man_args8.step_type = STEP_FW;
+    man_args8.matmul_type = opt_matmul_type; //MATMUL_TYPE
+    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args8);
 #endif
 
-#ifdef DEBUG
-    printf("\n\n\nM8_v result\n\ncoeffDataWinV [^T]: %d %d\n", E, F);
-    for (int j=0; j<E*F; j++){
-        if(!(j%(F))) printf("\n");
-        printf("%.8f ",  matMul_args8_v.A[j]);
-    }
-    printf("\n");
+    // SUM_qkv
+    struct vect_sum_args vect_sum_args;
+    vect_sum_args.op_1 = inputDiff;
+    vect_sum_args.op_2 = temp + 3 * F * E;
+    vect_sum_args.dest = inputDiff;
+    vect_sum_args.size = E * L;
 
-    printf("\nv_diff: %d %d\n", F, L);
-    for (int j=0; j<F*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_v.B[j]);
-    }
-    printf("\n");
+    pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
 
-    printf("\ntemp: %d %d\n", E, L);
-    for (int j=0; j<E*L; j++){
-        if(!(j%(L))) printf("\n");
-        printf("%.8f ", matMul_args8_v.C[j]);
+    // LoRA gradients, the input gradient also flows through the adapter
+    if (mhsa_args->lora_rank > 0) {
+        int R = mhsa_args->lora_rank;
+        float *hidden = mhsa_args->lora_hidden_qkv->data;           //  R x L
+        float *hiddenDiff = mhsa_args->lora_hidden_qkv->diff;       //  R x L
+
+        // M7_lora_b
+        // qkv_diff @ hidden^T -> lora_B_qkv->diff
+        struct matMul_args matMul_args_lb;
+        matMul_args_lb.A = qkv_diff;                               //  3F x L
+        matMul_args_lb.B = hidden;                                 //  R x L
+        matMul_args_lb.C = mhsa_args->lora_B_qkv->diff;            //  3F x R
+        matMul_args_lb.N = 3 * F;
+        matMul_args_lb.K = L;
+        matMul_args_lb.M = R;
+        matMul_args_lb.trans_B = 1;
+        matMul_args_lb.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_lb);
+
+        // T8_lora_b
+        struct transp_args transp_args_lb;
+        transp_args_lb.in_matrix = mhsa_args->lora_B_qkv->data;
+        transp_args_lb.out_matrix = temp;                          //  R x 3F
+        transp_args_lb.N = 3 * F;
+        transp_args_lb.M = R;
+
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args_lb);
+
+        // M8_lora_b
+        // lora_scale * lora_B_qkv^T @ qkv_diff -> hiddenDiff
+        struct matMul_args matMul_args_lh;
+        matMul_args_lh.A = temp;                                   //  R x 3F
+        matMul_args_lh.B = qkv_diff;                               //  3F x L
+        matMul_args_lh.C = hiddenDiff;                             //  R x L
+        matMul_args_lh.N = R;
+        matMul_args_lh.K = 3 * F;
+        matMul_args_lh.M = L;
+        matMul_args_lh.trans_B = 0;
+        matMul_args_lh.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_lh);
+
+        struct scalar_mul_args scalar_args_l;
+        scalar_args_l.input = hiddenDiff;
+        scalar_args_l.scalar = mhsa_args->lora_scale;
+        scalar_args_l.dim = R * L;
+
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp32_cl, &scalar_args_l);
+
+        // M7_lora_a
+        // hiddenDiff @ inputData^T -> lora_A_qkv->diff
+        struct matMul_args matMul_args_la;
+        matMul_args_la.A = hiddenDiff;                             //  R x L
+        matMul_args_la.B = inputData;                              //  E x L
+        matMul_args_la.C = mhsa_args->lora_A_qkv->diff;            //  R x E
+        matMul_args_la.N = R;
+        matMul_args_la.K = L;
+        matMul_args_la.M = E;
+        matMul_args_la.trans_B = 1;
+        matMul_args_la.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_la);
+
+        // T8_lora_a
+        struct transp_args transp_args_la;
+        transp_args_la.in_matrix = mhsa_args->lora_A_qkv->data;
+        transp_args_la.out_matrix = temp;                          //  E x R
+        transp_args_la.N = R;
+        transp_args_la.M = E;
+
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args_la);
+
+        // M8_lora_a
+        struct matMul_args matMul_args_li;
+        matMul_args_li.A = temp;                                   //  E x R
+        matMul_args_li.B = hiddenDiff;                             //  R x L
+        matMul_args_li.C = temp + E * R;                           //  E x L
+        matMul_args_li.N = E;
+        matMul_args_li.K = R;
+        matMul_args_li.M = L;
+        matMul_args_li.trans_B = 0;
+        matMul_args_li.USE_BIASES = 0;
+
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args_li);
+
+        vect_sum_args.op_2 = temp + E * R;
+
+        pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
     }
-    printf("\n\n");
-#endif
-
-    // SUM_v
-    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp32, &vect_sum_args);
 }
 
+
 //FORWARD INFERENCE
 void pulp_mhsa_mobilebert_inference_fp32_fw_cl(void *Mhsa_args) {
     // ======================================== DECLARATIONS ========================================
@@ -1844,12 +2122,12 @@ void pulp_mhsa_mobilebert_inference_fp32_fw_cl(void *Mhsa_args) {
     for (int i = 0; i < n_heads; i++) {
         //  T1
         struct transp_args transp_args1;
-        transp_args1.matrix = kt + L * i * H;
-        transp_args1.transp_matrix = temp;
+        transp_args1.in_matrix = kt + L * i * H;
+        transp_args1.out_matrix = temp;
         transp_args1.N = H;
         transp_args1.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args1);
 
         // M2
         // Multiply it with the i-th head's transposed Q chunk
@@ -1898,12 +2176,12 @@ void pulp_mhsa_mobilebert_inference_fp32_fw_cl(void *Mhsa_args) {
         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
         // T2
         struct transp_args transp_args2;
-        transp_args2.matrix = softmax_buffer + i * L * L;
-        transp_args2.transp_matrix = temp;
+        transp_args2.in_matrix = softmax_buffer + i * L * L;
+        transp_args2.out_matrix = temp;
         transp_args2.N = L;
         transp_args2.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args2);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args2);
 
         //  Softmax algorithm
         struct softmax_args softmax_arg;
@@ -1958,12 +2236,12 @@ void pulp_mhsa_mobilebert_inference_fp32_fw_cl(void *Mhsa_args) {
         //  Each head result has to be appended to the full attention map, to do so we require to store the current
         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
         struct transp_args transp_args3;
-        transp_args3.matrix = softmax_buffer + i * L * L;
-        transp_args3.transp_matrix = temp;
+        transp_args3.in_matrix = softmax_buffer + i * L * L;
+        transp_args3.out_matrix = temp;
         transp_args3.N = L;
         transp_args3.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args3);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args3);
 
         // M3
         struct matMul_args matMul_args3;
@@ -2022,12 +2300,12 @@ void pulp_mhsa_mobilebert_inference_fp32_fw_cl(void *Mhsa_args) {
     // T4
     // The last transpose to original shape
     struct transp_args transp_args4;
-    transp_args4.matrix = temp;
-    transp_args4.transp_matrix = outData;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
     transp_args4.N = F;
     transp_args4.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args4);
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args4);
 }
 
 
@@ -2143,17 +2421,17 @@ void tiled_transpose_mhsa(void *transpose_args, void* Tiled_matmul_mhsa_args, in
     float* IN_DATA = BUFF;
     float* OUT_DATA = BUFF + tile_dim;
 
-    args_l1.matrix = IN_DATA;
-    args_l1.transp_matrix = OUT_DATA;
+    args_l1.in_matrix = IN_DATA;
+    args_l1.out_matrix = OUT_DATA;
     args_l1.N = tile_w;
     args_l1.M = tile_h;
     
     for(int i = 0; i < n_tiles_i; i++){
         for(int j = 0; j < n_tiles_j; j++){
-            pi_cl_dma_cmd_2d((uint32_t) (args->matrix + i * tile_h + j * tile_w * M), (uint32_t) (IN_DATA), 4 * tile_dim, 4 * M, 4 * tile_h, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
+            pi_cl_dma_cmd_2d((uint32_t) (args->in_matrix + i * tile_h + j * tile_w * M), (uint32_t) (IN_DATA), 4 * tile_dim, 4 * M, 4 * tile_h, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
             pi_cl_dma_cmd_wait(cmd_load);
-            pi_cl_team_fork(NUM_CORES, transpose, &args_l1);
-            pi_cl_dma_cmd_2d((uint32_t) (args->transp_matrix + j * tile_w + i * tile_h * N), (uint32_t) (OUT_DATA), 4 * tile_dim, 4 * N, 4 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+            pi_cl_team_fork(NUM_CORES, transpose_matrix, &args_l1);
+            pi_cl_dma_cmd_2d((uint32_t) (args->out_matrix + j * tile_w + i * tile_h * N), (uint32_t) (OUT_DATA), 4 * tile_dim, 4 * N, 4 * tile_w, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
             pi_cl_dma_cmd_wait(cmd_store);
         }
     }
@@ -2248,8 +2526,8 @@ void tiled_mhsa_fp32(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
     for (int i = 0; i < n_heads; i++) {
         //  T1
         struct transp_args transp_args1;
-        transp_args1.matrix = kt + L * i * H;
-        transp_args1.transp_matrix = temp;
+        transp_args1.in_matrix = kt + L * i * H;
+        transp_args1.out_matrix = temp;
         transp_args1.N = H;
         transp_args1.M = L;
 
@@ -2303,8 +2581,8 @@ void tiled_mhsa_fp32(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
         //  row-wise max and sums, therefore it is necessary to transpose the current head buffer.
         // T2
         struct transp_args transp_args2;
-        transp_args2.matrix = softmax_buffer + i * L * L;
-        transp_args2.transp_matrix = temp;
+        transp_args2.in_matrix = softmax_buffer + i * L * L;
+        transp_args2.out_matrix = temp;
         transp_args2.N = L;
         transp_args2.M = L;
 
@@ -2354,8 +2632,8 @@ void tiled_mhsa_fp32(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
         //  Each head result has to be appended to the full attention map, to do so we require to store the current
         //  softmax buffer data following the H x L convention, therefore we need to transpose the memory buffer again.
         struct transp_args transp_args3;
-        transp_args3.matrix = softmax_buffer + i * L * L;
-        transp_args3.transp_matrix = temp;
+        transp_args3.in_matrix = softmax_buffer + i * L * L;
+        transp_args3.out_matrix = temp;
         transp_args3.N = L;
         transp_args3.M = L;
 
@@ -2401,14 +2679,1087 @@ void tiled_mhsa_fp32(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
     // T4
     // The last transpose to original shape
     struct transp_args transp_args4;
-    transp_args4.matrix = temp;
-    transp_args4.transp_matrix = outData;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
+    transp_args4.N = mhsa_args->input_bn->W;
+    transp_args4.M = L;
+
+    tiled_transpose_mhsa(&transp_args4, Tiled_mhsa_matmul_args, 1);
+}
+
+#ifdef FASTEXPF
+#define FLASH_ATTN_EXP_FP32(x) fastexp_gist(x)
+#else
+#define FLASH_ATTN_EXP_FP32(x) expf(x)
+#endif
+
+void mhsa_flash_attn_tile_fp32(void *flash_attn_args){
+    struct flash_attn_args *args = (struct flash_attn_args *) flash_attn_args;
+    float *q = args->q;
+    float *k = args->k;
+    float *v = args->v;
+    float *out = args->out;
+    float *m = args->m;
+    float *l = args->l;
+    int H = args->H;
+    int Br = args->Br;
+    int Bc = args->Bc;
+    float scaling = args->scaling;
+
+    float *s = args->scores + pi_core_id() * Bc;
+    int masked = args->mask_tile == MHSA_TILE_PARTIAL;
+    int sparse = masked && args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = (Br + NUM_CORES - 1) / NUM_CORES;
+    const int step = masked ? NUM_CORES : 1;
+    const int start = masked ? pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? Br : (start + blockSize > Br ? Br : start + blockSize);
+
+    for(int r = start; r < stop; r += step){
+        // Key columns [lo, hi) of the tile seen by query r
+        int lo = 0, hi = Bc;
+        if(masked){
+            mhsa_mask_row_range(args->mask_type, args->mask_window, args->row0 + r, args->col0, args->col0 + Bc, &lo, &hi);
+            lo -= args->col0;
+            hi -= args->col0;
+        }
+        // No key seen by the previous tiles: start the running statistics from scratch
+        int fresh = args->first || l[r] == 0.0f;
+
+        // Scores of query r against the key tile, and their max
+        float max = fresh ? -FLT_MAX : m[r];
+        for(int c = lo; c < hi; c++){
+            if(sparse && !mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, args->L, args->row0 + r, args->col0 + c)){
+                s[c] = -FLT_MAX;
+                continue;
+            }
+            float acc = 0;
+            for(int h = 0; h < H; h++)
+                acc += q[h * Br + r] * k[h * Bc + c];
+            acc *= scaling;
+            s[c] = acc;
+            if(acc > max)
+                max = acc;
+        }
+
+        // Rescale the running statistics to the new max
+        float corr = fresh ? 0.0f : FLASH_ATTN_EXP_FP32(m[r] - max);
+        float sum = 0;
+        for(int c = lo; c < hi; c++){
+            float p = (sparse && s[c] == -FLT_MAX) ? 0.0f : FLASH_ATTN_EXP_FP32(s[c] - max);
+            s[c] = p;
+            sum += p;
+        }
+        float l_new = (fresh ? 0.0f : l[r] * corr) + sum;
+        m[r] = max;
+        l[r] = l_new;
+        if(args->last && args->lse != NULL)
+            args->lse[r] = l_new > 0.0f ? max + logf(l_new) : max;
+
+        // out[:, r] = corr * out[:, r] + V * p, a fully masked query row is left to zero
+        float inv_l = args->last ? (l_new > 0.0f ? 1.0f / l_new : 0.0f) : 1.0f;
+        for(int h = 0; h < H; h++){
+            float acc = fresh ? 0.0f : out[h * Br + r] * corr;
+            for(int c = lo; c < hi; c++)
+                acc += v[h * Bc + c] * s[c];
+            out[h * Br + r] = acc * inv_l;
+        }
+    }
+}
+
+void tiled_mhsa_flash_attn_fp32(void *Mhsa_args, void* Tiled_mhsa_matmul_args){
+    // ======================================== DECLARATIONS ========================================
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+    struct Tiled_Matmul_Mhsa_args *tiled_args = (struct Tiled_Matmul_Mhsa_args *) Tiled_mhsa_matmul_args;
+
+    float* BUFF = tiled_args->BUFF;
+    pi_cl_dma_cmd_t * cmd_store = tiled_args->cmd_store;
+    pi_cl_dma_cmd_t * cmd_load = tiled_args->cmd_load;
+
+    float *coeffDataWinQ = mhsa_args->coeff_in_q->data;         //  Input Projection Weights for Query (transposed)
+    float *coeffDataWinK = mhsa_args->coeff_in_k->data;         //  Input Projection Weights for Key (transposed)
+    float *coeffDataWinV = mhsa_args->coeff_in_v->data;         //  Input Projection Weights for Value (transposed)
+
+    float *coeffBiasWinQ = mhsa_args->bias_in_q->data;          //  Input Projection Biases for Query
+    float *coeffBiasWinK = mhsa_args->bias_in_k->data;          //  Input Projection Biases for Key
+    float *coeffBiasWinV = mhsa_args->bias_in_v->data;          //  Input Projection Biases for Value
+
+    float *coeffDataWout = mhsa_args->coeff_out->data;          //  Output Projection Weights (Already transposed from GM)
+    float *coeffBiasWout = mhsa_args->bias_out->data;           //  Output Projection Biases
+
+    float *attention_map = mhsa_args->attention_map->data;      //  Buffer saving the MHSA map before output projection
+    float *outData = mhsa_args->output->data;                   //  Output sequence (Transposed, E x L)
+    float *inputData = mhsa_args->input->data;                  //  Input vector (L x E)
+    float *inputDataBn = mhsa_args->input_bn->data;             //  Input vector bottlenecked (L x F)
+    float *temp = mhsa_args->temp_buffer;                       //  Support buffer used for the output projection
+    float *qt = mhsa_args->q->data;                             //  Pointer to the first element of Q transposed
+    float *kt = mhsa_args->k->data;                             //  Pointer to the first element of K transposed
+    float *vt = mhsa_args->v->data;                             //  Pointer to the first element of V transposed
+    int n_heads = mhsa_args->n_heads;                           //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                           //  Hidden dimension of attention (N. Heads * Head dimension)
+
+    int H = F / n_heads;                                        //  Head dimension
+    float scaling = q_rsqrt((float) H);                         //  Scaling factor to avoid vanishing gradients
+
+    int Br = tiled_args->tile_h_sm;                             //  Queries per tile
+    int Bc = tiled_args->tile_w_sm;                             //  Keys per tile
+    int n_tiles_q = L / Br;
+    int n_tiles_kv = L / Bc;
+
+    //  L1 layout: m | l | Q tile | O tile | scores | K/V tiles (x2)
+    float *m_l1 = BUFF;
+    float *l_l1 = m_l1 + Br;
+    float *q_l1 = l_l1 + Br;
+    float *o_l1 = q_l1 + H * Br;
+    float *s_l1 = o_l1 + H * Br;
+    float *k_l1[2], *v_l1[2];
+    k_l1[0] = s_l1 + NUM_CORES * Bc;
+    v_l1[0] = k_l1[0] + H * Bc;
+    k_l1[1] = v_l1[0] + H * Bc;
+    v_l1[1] = k_l1[1] + H * Bc;
+    pi_cl_dma_cmd_t cmd_k[2], cmd_v[2];
+
+    // M1_q, M1_k, M1_v
+    // (Wq)t * input_bn, (Wk)t * input_bn, (Wv)t * input
+    struct matMul_args matMul_args1_q;
+    matMul_args1_q.A = coeffDataWinQ;                              //  F x Ebn
+    matMul_args1_q.B = inputDataBn;                                //  L x Ebn
+    matMul_args1_q.C = qt;                                         //  F x L
+    matMul_args1_q.N = mhsa_args->coeff_in_q->H;
+    matMul_args1_q.K = mhsa_args->coeff_in_q->W;
+    matMul_args1_q.M = L;
+    matMul_args1_q.trans_B = 1;
+    matMul_args1_q.bias = coeffBiasWinQ;
+    matMul_args1_q.USE_BIASES = 1;
+    matMul_args1_q.bias_transposed = 1;
+    matMul_args1_q.bias_dim = F;
+
+    tiled_matmul_mhsa(&matMul_args1_q, Tiled_mhsa_matmul_args, 1);
+
+    struct matMul_args matMul_args1_k;
+    matMul_args1_k.A = coeffDataWinK;                              //  F x Ebn
+    matMul_args1_k.B = inputDataBn;                                //  L x Ebn
+    matMul_args1_k.C = kt;                                         //  F x L
+    matMul_args1_k.N = mhsa_args->coeff_in_k->H;
+    matMul_args1_k.K = mhsa_args->coeff_in_k->W;
+    matMul_args1_k.M = L;
+    matMul_args1_k.trans_B = 1;
+    matMul_args1_k.bias = coeffBiasWinK;
+    matMul_args1_k.USE_BIASES = 1;
+    matMul_args1_k.bias_transposed = 1;
+    matMul_args1_k.bias_dim = F;
+
+    tiled_matmul_mhsa(&matMul_args1_k, Tiled_mhsa_matmul_args, 1);
+
+    struct matMul_args matMul_args1_v;
+    matMul_args1_v.A = coeffDataWinV;                              //  F x E
+    matMul_args1_v.B = inputData;                                  //  L x E
+    matMul_args1_v.C = vt;                                         //  F x L
+    matMul_args1_v.N = F;
+    matMul_args1_v.K = E;
+    matMul_args1_v.M = L;
+    matMul_args1_v.trans_B = 1;
+    matMul_args1_v.bias = coeffBiasWinV;
+    matMul_args1_v.USE_BIASES = 1;
+    matMul_args1_v.bias_transposed = 1;
+    matMul_args1_v.bias_dim = F;
+
+    tiled_matmul_mhsa(&matMul_args1_v, Tiled_mhsa_matmul_args, 1);
+
+    //  Fused attention, one head and one query tile at a time
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(Qt K * scaling) V -> attention_map ~~~~~~~~~~~~~~~~~~~~~~
+    struct flash_attn_args fa_args;
+    fa_args.q = q_l1;
+    fa_args.out = o_l1;
+    fa_args.scores = s_l1;
+    fa_args.m = m_l1;
+    fa_args.l = l_l1;
+    fa_args.H = H;
+    fa_args.Br = Br;
+    fa_args.Bc = Bc;
+    fa_args.scaling = scaling;
+    fa_args.lse = NULL;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
+
+    for (int i = 0; i < n_heads; i++) {
+        float *q_head = qt + L * i * H;
+        float *k_head = kt + L * i * H;
+        float *v_head = vt + L * i * H;
+
+        for (int t_q = 0; t_q < n_tiles_q; t_q++) {
+            int r0 = t_q * Br;
+            //  Fully masked K/V tiles are neither loaded nor computed
+            int t_kv = mhsa_mask_next_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, Bc, n_tiles_kv, -1);
+            int cur = 0;
+
+            pi_cl_dma_cmd_2d((uint32_t) (q_head + r0), (uint32_t) (q_l1), 4 * H * Br, 4 * L, 4 * Br, PI_CL_DMA_DIR_EXT2LOC, cmd_load);
+            if (t_kv < n_tiles_kv) {
+                pi_cl_dma_cmd_2d((uint32_t) (k_head + t_kv * Bc), (uint32_t) (k_l1[0]), 4 * H * Bc, 4 * L, 4 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[0]);
+                pi_cl_dma_cmd_2d((uint32_t) (v_head + t_kv * Bc), (uint32_t) (v_l1[0]), 4 * H * Bc, 4 * L, 4 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[0]);
+            }
+            else {
+                //  No key is seen by the query tile
+                for (int j = 0; j < H * Br; j++)
+                    o_l1[j] = 0.0f;
+            }
+            pi_cl_dma_cmd_wait(cmd_load);
+
+            fa_args.row0 = r0;
+            fa_args.first = 1;
+            while (t_kv < n_tiles_kv) {
+                int t_next = mhsa_mask_next_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, Bc, n_tiles_kv, t_kv);
+                pi_cl_dma_cmd_wait(&cmd_k[cur]);
+                pi_cl_dma_cmd_wait(&cmd_v[cur]);
+
+                //  Prefetch the next K/V tile while the current one is processed
+                if (t_next < n_tiles_kv) {
+                    pi_cl_dma_cmd_2d((uint32_t) (k_head + t_next * Bc), (uint32_t) (k_l1[cur ^ 1]), 4 * H * Bc, 4 * L, 4 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[cur ^ 1]);
+                    pi_cl_dma_cmd_2d((uint32_t) (v_head + t_next * Bc), (uint32_t) (v_l1[cur ^ 1]), 4 * H * Bc, 4 * L, 4 * Bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[cur ^ 1]);
+                }
+
+                fa_args.k = k_l1[cur];
+                fa_args.v = v_l1[cur];
+                fa_args.col0 = t_kv * Bc;
+                fa_args.mask_tile = mhsa_mask_tile(mhsa_args->mask_type, mhsa_args->mask_window, mhsa_args->mask_block, mhsa_args->mask_layout, L, r0, r0 + Br, t_kv * Bc, (t_kv + 1) * Bc);
+                fa_args.last = (t_next == n_tiles_kv);
+                pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp32, &fa_args);
+
+                fa_args.first = 0;
+                cur ^= 1;
+                t_kv = t_next;
+            }
+
+            pi_cl_dma_cmd_2d((uint32_t) (attention_map + L * i * H + t_q * Br), (uint32_t) (o_l1), 4 * H * Br, 4 * L, 4 * Br, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+            pi_cl_dma_cmd_wait(cmd_store);
+        }
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ H -> F ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+    // M4
+    //  Final attention map projection
+    struct matMul_args matMul_args4;
+    matMul_args4.A = coeffDataWout;
+    matMul_args4.B = attention_map;
+    matMul_args4.C = temp;
+    matMul_args4.N = mhsa_args->coeff_out->H;
+    matMul_args4.K = mhsa_args->coeff_out->W;
+    matMul_args4.M = L;
+    matMul_args4.trans_B = 0;
+    matMul_args4.bias = coeffBiasWout;
+    matMul_args4.USE_BIASES = 1;
+    matMul_args4.bias_transposed = 1;
+    matMul_args4.bias_dim = E;
+
+    tiled_matmul_mhsa(&matMul_args4, Tiled_mhsa_matmul_args, 1);
+
+    // T4
+    // The last transpose to original shape
+    struct transp_args transp_args4;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
     transp_args4.N = mhsa_args->input_bn->W;
     transp_args4.M = L;
 
     tiled_transpose_mhsa(&transp_args4, Tiled_mhsa_matmul_args, 1);
 }
 
+
+void pulp_mhsa_fp32_flash_attn_fw_cl(void *Mhsa_args){
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *attention_map = mhsa_args->attention_map->data;      //  Attention output, before output projection (F x L)
+    float *temp = mhsa_args->temp_buffer;                       //  Support buffer: m | l | scores
+    float *q = mhsa_args->q->data;                              //  Pointer to the first element of Q (F x L)
+    float *k = mhsa_args->k->data;                              //  Pointer to the first element of K (F x L)
+    float *v = mhsa_args->v->data;                              //  Pointer to the first element of V (F x L)
+    float *lse = mhsa_args->lse;                                //  Row-wise log-sum-exp, saved for the backward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                           //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int F = mhsa_args->attention_map->W;                        //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                        //  Head dimension
+
+    //  A single tile spanning the whole sequence: the head buffers are already H x L
+    struct flash_attn_args fa_args;
+    fa_args.m = temp;
+    fa_args.l = temp + L;
+    fa_args.scores = temp + 2 * L;
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = q_rsqrt((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = mhsa_args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
+
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = q + L * i * H;
+        fa_args.k = k + L * i * H;
+        fa_args.v = v + L * i * H;
+        fa_args.out = attention_map + L * i * H;
+        fa_args.lse = lse + i * L;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp32, &fa_args);
+    }
+}
+
+void pulp_mhsa_fp32_flash_attn_bw_cl(void *Mhsa_args){
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *attention_map = mhsa_args->attention_map->data;          //  Attention output, before output projection (F x L)
+    float *attention_map_diff = mhsa_args->attention_map->diff;     //  Gradient of the attention output (F x L)
+    float *q = mhsa_args->q->data;                                  //  F x L
+    float *k = mhsa_args->k->data;                                  //  F x L
+    float *v = mhsa_args->v->data;                                  //  F x L
+    float *q_diff = mhsa_args->q->diff;                             //  F x L
+    float *k_diff = mhsa_args->k->diff;                             //  F x L
+    float *v_diff = mhsa_args->v->diff;                             //  F x L
+    float *lse = mhsa_args->lse;                                    //  Row-wise log-sum-exp from the forward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                               //  Number of heads used for MHSA
+
+    int L = mhsa_args->input->H;                                    //  Input/Output Sequence length
+    int F = mhsa_args->attention_map->W;                            //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                            //  Head dimension
+
+    struct flash_attn_bw_args bw_args;
+    bw_args.delta = mhsa_args->temp_buffer;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt((float) H);
+    bw_args.mask_type = mhsa_args->mask_type;
+    bw_args.mask_window = mhsa_args->mask_window;
+    bw_args.mask_block = mhsa_args->mask_block;
+    bw_args.mask_layout = mhsa_args->mask_layout;
+    bw_args.accumulate = 0;
+
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = q + L * i * H;
+        bw_args.k = k + L * i * H;
+        bw_args.v = v + L * i * H;
+        bw_args.out = attention_map + L * i * H;
+        bw_args.out_diff = attention_map_diff + L * i * H;
+        bw_args.q_diff = q_diff + L * i * H;
+        bw_args.k_diff = k_diff + L * i * H;
+        bw_args.v_diff = v_diff + L * i * H;
+        bw_args.lse = lse + i * L;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp32, &bw_args);
+    }
+}
+
+void mhsa_flash_attn_bw_delta_fp32(void *flash_attn_bw_args){
+    struct flash_attn_bw_args *args = (struct flash_attn_bw_args *) flash_attn_bw_args;
+    int H = args->H;
+    int L = args->L;
+
+    const int blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > L ? L : start + blockSize;
+
+    for(int r = start; r < stop; r++){
+        float acc = 0;
+        for(int h = 0; h < H; h++)
+            acc += args->out_diff[h * L + r] * args->out[h * L + r];
+        args->delta[r] = acc;
+    }
+}
+
+void mhsa_flash_attn_bw_kv_fp32(void *flash_attn_bw_args){
+    struct flash_attn_bw_args *args = (struct flash_attn_bw_args *) flash_attn_bw_args;
+    float *q = args->q;
+    float *k = args->k;
+    float *v = args->v;
+    float *dO = args->out_diff;
+    float *dK = args->k_diff;
+    float *dV = args->v_diff;
+    float *lse = args->lse;
+    float *delta = args->delta;
+    int H = args->H;
+    int L = args->L;
+    float scaling = args->scaling;
+    int sparse = args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+    int masked = args->mask_type != MHSA_MASK_NONE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    const int step = masked ? NUM_CORES : 1;
+    const int start = masked ? pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? L : (start + blockSize > L ? L : start + blockSize);
+
+    for(int c = start; c < stop; c += step){
+        if(!args->accumulate){
+            for(int h = 0; h < H; h++){
+                dK[h * L + c] = 0;
+                dV[h * L + c] = 0;
+            }
+        }
+        // Only the queries attending to key c contribute
+        int lo, hi;
+        mhsa_mask_col_range(args->mask_type, args->mask_window, c, 0, L, &lo, &hi);
+        for(int r = lo; r < hi; r++){
+            if(sparse && !mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r, c)){
+                r += args->mask_block - 1 - r % args->mask_block;
+                continue;
+            }
+            // Recompute p = softmax(s)[r][c] and dp = dO[:, r] . v[:, c]
+            float s = 0, dp = 0;
+            for(int h = 0; h < H; h++){
+                s += q[h * L + r] * k[h * L + c];
+                dp += dO[h * L + r] * v[h * L + c];
+            }
+            float p = FLASH_ATTN_EXP_FP32(s * scaling - lse[r]);
+            float ds = p * (dp - delta[r]) * scaling;
+            for(int h = 0; h < H; h++){
+                dV[h * L + c] += p * dO[h * L + r];
+                dK[h * L + c] += ds * q[h * L + r];
+            }
+        }
+    }
+}
+
+void mhsa_flash_attn_bw_q_fp32(void *flash_attn_bw_args){
+    struct flash_attn_bw_args *args = (struct flash_attn_bw_args *) flash_attn_bw_args;
+    float *q = args->q;
+    float *k = args->k;
+    float *v = args->v;
+    float *dO = args->out_diff;
+    float *dQ = args->q_diff;
+    float *lse = args->lse;
+    float *delta = args->delta;
+    int H = args->H;
+    int L = args->L;
+    float scaling = args->scaling;
+    int sparse = args->mask_type == MHSA_MASK_BLOCK_SPARSE;
+    int masked = args->mask_type != MHSA_MASK_NONE;
+
+    //  Masked rows have different lengths: interleave them between the cores to balance the work
+    const int blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    const int step = masked ? NUM_CORES : 1;
+    const int start = masked ? pi_core_id() : pi_core_id() * blockSize;
+    const int stop = masked ? L : (start + blockSize > L ? L : start + blockSize);
+
+    for(int r = start; r < stop; r += step){
+        for(int h = 0; h < H; h++)
+            dQ[h * L + r] = 0;
+        // Only the keys seen by query r contribute
+        int lo, hi;
+        mhsa_mask_row_range(args->mask_type, args->mask_window, r, 0, L, &lo, &hi);
+        for(int c = lo; c < hi; c++){
+            if(sparse && !mhsa_mask_visible(args->mask_type, args->mask_window, args->mask_block, args->mask_layout, L, r, c)){
+                c += args->mask_block - 1 - c % args->mask_block;
+                continue;
+            }
+            float s = 0, dp = 0;
+            for(int h = 0; h < H; h++){
+                s += q[h * L + r] * k[h * L + c];
+                dp += dO[h * L + r] * v[h * L + c];
+            }
+            float p = FLASH_ATTN_EXP_FP32(s * scaling - lse[r]);
+            float ds = p * (dp - delta[r]) * scaling;
+            for(int h = 0; h < H; h++)
+                dQ[h * L + r] += ds * k[h * L + c];
+        }
+    }
+}
+
+
+// KV-CACHE INCREMENTAL DECODING
+void pulp_mhsa_kv_cache_fp32_fw_cl(void *Mhsa_kv_cache_args){
+    struct Mhsa_kv_cache_args *kv_args = (struct Mhsa_kv_cache_args *) Mhsa_kv_cache_args;
+
+    float *inputData = kv_args->input->data;                    //  New tokens (T x E)
+    float *outData = kv_args->output->data;                     //  Output of the new tokens (T x E)
+    float *k_cache = kv_args->k_cache;                          //  Key cache (max_len x F, token-major)
+    float *v_cache = kv_args->v_cache;                          //  Value cache (max_len x F, token-major)
+    float *q = kv_args->q;                                      //  Queries of the new tokens (T x F)
+    float *attention_map = kv_args->attention_map;              //  Attention output of the new tokens (T x F)
+    float *temp = kv_args->temp_buffer;                         //  Support buffer: m | l | w | m_part | l_part | o_part
+    float *BUFF = kv_args->BUFF;                                //  L1 buffer for the cache tiles (NULL: cache accessed in place)
+    pi_cl_dma_cmd_t * cmd_store = kv_args->cmd_store;
+    int n_heads = kv_args->n_heads;                             //  Number of heads used for MHSA
+
+    int T = kv_args->input->H;                                  //  Number of new tokens
+    int E = kv_args->input->W;                                  //  Input Sequence element size
+    int F = kv_args->coeff_in_q->H;                             //  Hidden dimension of attention (N. Heads * Head dimension)
+    int H = F / n_heads;                                        //  Head dimension
+    int P = kv_args->cache_len;                                 //  Tokens already in the cache
+    int Bc = BUFF != NULL ? kv_args->tile_len : P + T;          //  Cache tokens per tile
+
+    if (P + T > kv_args->max_len) {
+        printf("[pulp_mhsa_kv_cache_fp32_fw_cl:] KV cache overflow (%d + %d > %d)!\n", P, T, kv_args->max_len);
+        return;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Q, K, V of the new tokens ~~~~~~~~~~~~~~~~~~~~~~
+    //  K and V are written straight at the end of the cache, or staged in L1 and DMA-ed when the cache lives in L2
+    float *k_new = BUFF != NULL ? kv_args->kv_new : k_cache + P * F;
+    float *v_new = BUFF != NULL ? kv_args->kv_new + T * F : v_cache + P * F;
+
+    struct kv_cache_proj_args proj_args;
+    proj_args.in = inputData;
+    proj_args.T = T;
+    proj_args.in_dim = E;
+    proj_args.out_dim = F;
+
+    proj_args.W = kv_args->coeff_in_q->data;
+    proj_args.bias = kv_args->bias_in_q->data;
+    proj_args.out = q;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp32, &proj_args);
+
+    proj_args.W = kv_args->coeff_in_k->data;
+    proj_args.bias = kv_args->bias_in_k->data;
+    proj_args.out = k_new;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp32, &proj_args);
+
+    proj_args.W = kv_args->coeff_in_v->data;
+    proj_args.bias = kv_args->bias_in_v->data;
+    proj_args.out = v_new;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp32, &proj_args);
+
+    if (BUFF != NULL) {
+        pi_cl_dma_cmd((uint32_t) (k_cache + P * F), (uint32_t) (k_new), 4 * T * F, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+        pi_cl_dma_cmd_wait(cmd_store);
+        pi_cl_dma_cmd((uint32_t) (v_cache + P * F), (uint32_t) (v_new), 4 * T * F, PI_CL_DMA_DIR_LOC2EXT, cmd_store);
+        pi_cl_dma_cmd_wait(cmd_store);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(q Kt * scaling) V over the cache ~~~~~~~~~~~~~~~~~~~~~~
+    float *m = temp;
+    float *l = temp + 1;
+    float *k_l1[2], *v_l1[2];
+    k_l1[0] = BUFF;
+    v_l1[0] = k_l1[0] + H * Bc;
+    k_l1[1] = v_l1[0] + H * Bc;
+    v_l1[1] = k_l1[1] + H * Bc;
+    pi_cl_dma_cmd_t cmd_k[2], cmd_v[2];
+
+    struct kv_cache_attn_args attn_args;
+    attn_args.H = H;
+    attn_args.ld = BUFF != NULL ? H : F;
+    attn_args.scaling = q_rsqrt((float) H);
+    attn_args.w = temp + 2;
+    attn_args.m_part = attn_args.w + NUM_CORES;
+    attn_args.l_part = attn_args.m_part + NUM_CORES;
+    attn_args.o_part = attn_args.l_part + NUM_CORES;
+
+    for (int t = 0; t < T; t++) {
+        int n_keys = P + t + 1;                                 //  Causal: token t sees the cache and the new tokens up to itself
+        int n_tiles = (n_keys + Bc - 1) / Bc;
+
+        for (int i = 0; i < n_heads; i++) {
+            float *k_head = k_cache + i * H;
+            float *v_head = v_cache + i * H;
+            attn_args.q = q + t * F + i * H;
+            attn_args.out = attention_map + t * F + i * H;
+
+            if (BUFF != NULL) {
+                int len = Bc < n_keys ? Bc : n_keys;
+                pi_cl_dma_cmd_2d((uint32_t) (k_head), (uint32_t) (k_l1[0]), 4 * H * len, 4 * F, 4 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[0]);
+                pi_cl_dma_cmd_2d((uint32_t) (v_head), (uint32_t) (v_l1[0]), 4 * H * len, 4 * F, 4 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[0]);
+            }
+
+            for (int t_kv = 0; t_kv < n_tiles; t_kv++) {
+                int cur = t_kv & 1;
+                int p0 = t_kv * Bc;
+                attn_args.n_keys = n_keys - p0 < Bc ? n_keys - p0 : Bc;
+
+                if (BUFF != NULL) {
+                    pi_cl_dma_cmd_wait(&cmd_k[cur]);
+                    pi_cl_dma_cmd_wait(&cmd_v[cur]);
+
+                    //  Prefetch the next cache tile while the current one is processed
+                    if (t_kv + 1 < n_tiles) {
+                        int p1 = p0 + Bc;
+                        int len = n_keys - p1 < Bc ? n_keys - p1 : Bc;
+                        pi_cl_dma_cmd_2d((uint32_t) (k_head + p1 * F), (uint32_t) (k_l1[cur ^ 1]), 4 * H * len, 4 * F, 4 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_k[cur ^ 1]);
+                        pi_cl_dma_cmd_2d((uint32_t) (v_head + p1 * F), (uint32_t) (v_l1[cur ^ 1]), 4 * H * len, 4 * F, 4 * H, PI_CL_DMA_DIR_EXT2LOC, &cmd_v[cur ^ 1]);
+                    }
+                    attn_args.k = k_l1[cur];
+                    attn_args.v = v_l1[cur];
+                }
+                else {
+                    attn_args.k = k_head + p0 * F;
+                    attn_args.v = v_head + p0 * F;
+                }
+
+                pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_attn_fp32, &attn_args);
+
+                //  Merge the per-core partial statistics into the running ones
+                float max = t_kv == 0 ? -FLT_MAX : m[0];
+                for (int c = 0; c < NUM_CORES; c++)
+                    if (attn_args.l_part[c] > 0.0f && attn_args.m_part[c] > max)
+                        max = attn_args.m_part[c];
+                attn_args.corr = t_kv == 0 ? 0.0f : FLASH_ATTN_EXP_FP32(m[0] - max);
+                float sum = t_kv == 0 ? 0.0f : l[0] * attn_args.corr;
+                for (int c = 0; c < NUM_CORES; c++) {
+                    attn_args.w[c] = attn_args.l_part[c] > 0.0f ? FLASH_ATTN_EXP_FP32(attn_args.m_part[c] - max) : 0.0f;
+                    sum += attn_args.w[c] * attn_args.l_part[c];
+                }
+                m[0] = max;
+                l[0] = sum;
+
+                //  Normalization is folded into the merge weights on the last tile
+                if (t_kv == n_tiles - 1) {
+                    float inv_l = 1.0f / sum;
+                    attn_args.corr *= inv_l;
+                    for (int c = 0; c < NUM_CORES; c++)
+                        attn_args.w[c] *= inv_l;
+                }
+                attn_args.first = (t_kv == 0);
+                pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_merge_fp32, &attn_args);
+            }
+        }
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Output projection ~~~~~~~~~~~~~~~~~~~~~~
+    proj_args.in = attention_map;
+    proj_args.W = kv_args->coeff_out->data;
+    proj_args.bias = kv_args->bias_out->data;
+    proj_args.out = outData;
+    proj_args.in_dim = F;
+    proj_args.out_dim = E;
+    pi_cl_team_fork(NUM_CORES, mhsa_kv_cache_proj_fp32, &proj_args);
+
+    kv_args->cache_len = P + T;
+}
+
+void mhsa_kv_cache_proj_fp32(void *kv_cache_proj_args){
+    struct kv_cache_proj_args *args = (struct kv_cache_proj_args *) kv_cache_proj_args;
+    float *in = args->in;
+    float *W = args->W;
+    float *bias = args->bias;
+    float *out = args->out;
+    int T = args->T;
+    int K = args->in_dim;
+    int N = args->out_dim;
+
+    const int blockSize = (N + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > N ? N : start + blockSize;
+
+    for(int t = 0; t < T; t++){
+        for(int j = start; j < stop; j++){
+            float acc = bias[j];
+            for(int e = 0; e < K; e++)
+                acc += W[j * K + e] * in[t * K + e];
+            out[t * N + j] = acc;
+        }
+    }
+}
+
+void mhsa_kv_cache_attn_fp32(void *kv_cache_attn_args){
+    struct kv_cache_attn_args *args = (struct kv_cache_attn_args *) kv_cache_attn_args;
+    float *q = args->q;
+    float *k = args->k;
+    float *v = args->v;
+    int ld = args->ld;
+    int H = args->H;
+    int n_keys = args->n_keys;
+    float scaling = args->scaling;
+
+    int core = pi_core_id();
+    float *o = args->o_part + core * H;
+
+    const int blockSize = (n_keys + NUM_CORES - 1) / NUM_CORES;
+    const int start = core * blockSize;
+    const int stop = start + blockSize > n_keys ? n_keys : start + blockSize;
+
+    //  Online softmax over the keys of this core
+    float max = -FLT_MAX;
+    float sum = 0;
+    for(int h = 0; h < H; h++)
+        o[h] = 0;
+
+    for(int c = start; c < stop; c++){
+        float s = 0;
+        for(int h = 0; h < H; h++)
+            s += q[h] * k[c * ld + h];
+        s *= scaling;
+
+        if(c == start || s > max){
+            float corr = c == start ? 0.0f : FLASH_ATTN_EXP_FP32(max - s);
+            sum = sum * corr + 1.0f;
+            for(int h = 0; h < H; h++)
+                o[h] = o[h] * corr + v[c * ld + h];
+            max = s;
+        }
+        else{
+            float p = FLASH_ATTN_EXP_FP32(s - max);
+            sum += p;
+            for(int h = 0; h < H; h++)
+                o[h] += p * v[c * ld + h];
+        }
+    }
+
+    args->m_part[core] = max;
+    args->l_part[core] = sum;
+}
+
+void mhsa_kv_cache_merge_fp32(void *kv_cache_attn_args){
+    struct kv_cache_attn_args *args = (struct kv_cache_attn_args *) kv_cache_attn_args;
+    float *out = args->out;
+    float *o_part = args->o_part;
+    float *w = args->w;
+    float corr = args->corr;
+    int H = args->H;
+
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for(int h = start; h < stop; h++){
+        float acc = args->first ? 0.0f : out[h] * corr;
+        for(int c = 0; c < NUM_CORES; c++)
+            acc += w[c] * o_part[c * H + h];
+        out[h] = acc;
+    }
+}
+
+// GROUPED-QUERY ATTENTION
+void pulp_mhsa_gqa_fp32_fw_cl(void *Mhsa_args){
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *coeffDataWinQ = mhsa_args->coeff_in_q->data;         //  Input Projection Weights for Query (F x E)
+    float *coeffDataWinK = mhsa_args->coeff_in_k->data;         //  Input Projection Weights for Key (Fkv x E)
+    float *coeffDataWinV = mhsa_args->coeff_in_v->data;         //  Input Projection Weights for Value (Fkv x E)
+
+    float *coeffBiasWinQ = mhsa_args->bias_in_q->data;          //  Input Projection Biases for Query
+    float *coeffBiasWinK = mhsa_args->bias_in_k->data;          //  Input Projection Biases for Key
+    float *coeffBiasWinV = mhsa_args->bias_in_v->data;          //  Input Projection Biases for Value
+
+    float *coeffDataWout = mhsa_args->coeff_out->data;          //  Output Projection Weights (E x F)
+    float *coeffBiasWout = mhsa_args->bias_out->data;           //  Output Projection Biases
+
+    float *attention_map = mhsa_args->attention_map->data;      //  Attention output, before output projection (F x L)
+    float *outData = mhsa_args->output->data;                   //  Output sequence (L x E)
+    float *inputData = mhsa_args->input->data;                  //  Input sequence (L x E)
+    float *temp = mhsa_args->temp_buffer;                       //  Support buffer: m | l | scores, then the projected output
+    float *q = mhsa_args->q->data;                              //  F x L
+    float *k = mhsa_args->k->data;                              //  Fkv x L, shared by the heads of a group
+    float *v = mhsa_args->v->data;                              //  Fkv x L, shared by the heads of a group
+    float *lse = mhsa_args->lse;                                //  Row-wise log-sum-exp, saved for the backward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                           //  Number of query heads
+    int n_kv_heads = mhsa_args->n_kv_heads;                     //  Number of key/value heads
+
+    int L = mhsa_args->input->H;                                //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                           //  Hidden dimension of the queries (n_heads * H)
+    int Fkv = mhsa_args->coeff_in_k->H;                         //  Hidden dimension of keys and values (n_kv_heads * H)
+    int H = F / n_heads;                                        //  Head dimension
+    int group = n_heads / n_kv_heads;                           //  Query heads sharing one key/value head
+
+    // M1_q, M1_k, M1_v
+    // Wq * input^T, Wk * input^T, Wv * input^T (K and V only have Fkv rows)
+    struct matMul_args matMul_args1;
+    matMul_args1.B = inputData;                                 //  L x E
+    matMul_args1.K = E;
+    matMul_args1.M = L;
+    matMul_args1.trans_B = 1;
+    matMul_args1.USE_BIASES = 0;
+
+    struct mm_bias_add_args bias_add_args;
+    bias_add_args.W = L;
+    bias_add_args.t = 1;
+
+    if (mhsa_args->rope_cos != NULL) {
+        //  RoPE fused into the epilogue of the Q and K projections
+        struct mm_rope_args rope_args;
+        rope_args.mm_args = &matMul_args1;
+        rope_args.cos = mhsa_args->rope_cos;
+        rope_args.sin = mhsa_args->rope_sin;
+        rope_args.H = H;
+        matMul_args1.USE_BIASES = 1;
+
+        matMul_args1.A = coeffDataWinQ;
+        matMul_args1.bias = coeffBiasWinQ;
+        matMul_args1.C = q;
+        matMul_args1.N = F;
+        pi_cl_team_fork(NUM_CORES, mm_rope_fp32, &rope_args);
+
+        matMul_args1.A = coeffDataWinK;
+        matMul_args1.bias = coeffBiasWinK;
+        matMul_args1.C = k;
+        matMul_args1.N = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm_rope_fp32, &rope_args);
+
+        matMul_args1.USE_BIASES = 0;
+    }
+    else {
+        matMul_args1.A = coeffDataWinQ;
+        matMul_args1.C = q;
+        matMul_args1.N = F;
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args1);
+        bias_add_args.mat = q;
+        bias_add_args.bias = coeffBiasWinQ;
+        bias_add_args.H = F;
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &bias_add_args);
+
+        matMul_args1.A = coeffDataWinK;
+        matMul_args1.C = k;
+        matMul_args1.N = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args1);
+        bias_add_args.mat = k;
+        bias_add_args.bias = coeffBiasWinK;
+        bias_add_args.H = Fkv;
+        pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &bias_add_args);
+    }
+
+    matMul_args1.A = coeffDataWinV;
+    matMul_args1.C = v;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args1);
+    bias_add_args.mat = v;
+    bias_add_args.bias = coeffBiasWinV;
+    bias_add_args.H = Fkv;
+    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &bias_add_args);
+
+    //  Fused attention, head i reads the K/V of head i / group in place
+    // ~~~~~~~~~~~~~~~~~~~~~~ softmax(Qt K * scaling) V -> attention_map ~~~~~~~~~~~~~~~~~~~~~~
+    struct flash_attn_args fa_args;
+    fa_args.m = temp;
+    fa_args.l = temp + L;
+    fa_args.scores = temp + 2 * L;
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = q_rsqrt((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = mhsa_args->mask_type;
+    fa_args.mask_window = mhsa_args->mask_window;
+    fa_args.mask_block = mhsa_args->mask_block;
+    fa_args.mask_layout = mhsa_args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = mhsa_args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
+
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = q + L * i * H;
+        fa_args.k = k + L * (i / group) * H;
+        fa_args.v = v + L * (i / group) * H;
+        fa_args.out = attention_map + L * i * H;
+        fa_args.lse = lse != NULL ? lse + i * L : NULL;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp32, &fa_args);
+    }
+
+    // M4
+    //  Final attention map projection
+    struct matMul_args matMul_args4;
+    matMul_args4.A = coeffDataWout;                             //  E x F
+    matMul_args4.B = attention_map;                             //  F x L
+    matMul_args4.C = temp;                                      //  E x L
+    matMul_args4.N = E;
+    matMul_args4.K = F;
+    matMul_args4.M = L;
+    matMul_args4.trans_B = 0;
+    matMul_args4.USE_BIASES = 0;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args4);
+
+    bias_add_args.mat = temp;
+    bias_add_args.bias = coeffBiasWout;
+    bias_add_args.H = E;
+    pi_cl_team_fork(NUM_CORES, mm_bias_add_transposed, &bias_add_args);
+
+    // T4
+    // The last transpose to original shape
+    struct transp_args transp_args4;
+    transp_args4.in_matrix = temp;
+    transp_args4.out_matrix = outData;
+    transp_args4.N = E;
+    transp_args4.M = L;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args4);
+}
+
+void pulp_mhsa_gqa_fp32_bw_cl(void *Mhsa_args){
+    struct Mhsa_args *mhsa_args = (struct Mhsa_args *) Mhsa_args;
+
+    float *coeffDataWinQ = mhsa_args->coeff_in_q->data;             //  F x E
+    float *coeffDataWinK = mhsa_args->coeff_in_k->data;             //  Fkv x E
+    float *coeffDataWinV = mhsa_args->coeff_in_v->data;             //  Fkv x E
+    float *coeffDataWout = mhsa_args->coeff_out->data;              //  E x F
+
+    float *coeffDiffWinQ = mhsa_args->coeff_in_q->diff;             //  F x E
+    float *coeffDiffWinK = mhsa_args->coeff_in_k->diff;             //  Fkv x E
+    float *coeffDiffWinV = mhsa_args->coeff_in_v->diff;             //  Fkv x E
+    float *coeffDiffWout = mhsa_args->coeff_out->diff;              //  E x F
+
+    float *attention_map = mhsa_args->attention_map->data;          //  F x L
+    float *attention_map_diff = mhsa_args->attention_map->diff;     //  F x L
+    float *inputData = mhsa_args->input->data;                      //  L x E
+    float *inputDiff = mhsa_args->input->diff;                      //  L x E
+    float *outDiff = mhsa_args->output->diff;                       //  L x E
+    float *temp = mhsa_args->temp_buffer;                           //  Support buffer for the transposed operands (L x (F + E))
+    float *q = mhsa_args->q->data;                                  //  F x L
+    float *k = mhsa_args->k->data;                                  //  Fkv x L
+    float *v = mhsa_args->v->data;                                  //  Fkv x L
+    float *q_diff = mhsa_args->q->diff;                             //  F x L
+    float *k_diff = mhsa_args->k->diff;                             //  Fkv x L
+    float *v_diff = mhsa_args->v->diff;                             //  Fkv x L
+    float *lse = mhsa_args->lse;                                    //  Row-wise log-sum-exp from the forward pass (n_heads x L)
+    int n_heads = mhsa_args->n_heads;                               //  Number of query heads
+    int n_kv_heads = mhsa_args->n_kv_heads;                         //  Number of key/value heads
+
+    int L = mhsa_args->input->H;                                    //  Input/Output Sequence length
+    int E = mhsa_args->input->W;                                    //  Input Sequence element size
+    int F = mhsa_args->coeff_in_q->H;                               //  Hidden dimension of the queries (n_heads * H)
+    int Fkv = mhsa_args->coeff_in_k->H;                             //  Hidden dimension of keys and values (n_kv_heads * H)
+    int H = F / n_heads;                                            //  Head dimension
+    int group = n_heads / n_kv_heads;                               //  Query heads sharing one key/value head
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Output projection ~~~~~~~~~~~~~~~~~~~~~~
+    //  dWout = outDiff^T * attention_map^T
+    struct transp_args transp_args;
+    transp_args.in_matrix = outDiff;
+    transp_args.out_matrix = temp;                                  //  E x L
+    transp_args.N = L;
+    transp_args.M = E;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args);
+
+    struct matMul_args matMul_args;
+    matMul_args.A = temp;
+    matMul_args.B = attention_map;
+    matMul_args.C = coeffDiffWout;
+    matMul_args.N = E;
+    matMul_args.K = L;
+    matMul_args.M = F;
+    matMul_args.trans_B = 1;
+    matMul_args.USE_BIASES = 0;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+    //  attention_map_diff = (outDiff * Wout)^T
+    matMul_args.A = outDiff;
+    matMul_args.B = coeffDataWout;
+    matMul_args.C = temp;                                           //  L x F
+    matMul_args.N = L;
+    matMul_args.K = E;
+    matMul_args.M = F;
+    matMul_args.trans_B = 0;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+    transp_args.in_matrix = temp;
+    transp_args.out_matrix = attention_map_diff;
+    transp_args.N = L;
+    transp_args.M = F;
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args);
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Attention ~~~~~~~~~~~~~~~~~~~~~~
+    //  The gradients of the heads sharing a K/V head are accumulated into it
+    struct flash_attn_bw_args bw_args;
+    bw_args.delta = temp;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt((float) H);
+    bw_args.mask_type = mhsa_args->mask_type;
+    bw_args.mask_window = mhsa_args->mask_window;
+    bw_args.mask_block = mhsa_args->mask_block;
+    bw_args.mask_layout = mhsa_args->mask_layout;
+
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = q + L * i * H;
+        bw_args.k = k + L * (i / group) * H;
+        bw_args.v = v + L * (i / group) * H;
+        bw_args.out = attention_map + L * i * H;
+        bw_args.out_diff = attention_map_diff + L * i * H;
+        bw_args.q_diff = q_diff + L * i * H;
+        bw_args.k_diff = k_diff + L * (i / group) * H;
+        bw_args.v_diff = v_diff + L * (i / group) * H;
+        bw_args.lse = lse + i * L;
+        bw_args.accumulate = (i % group) != 0;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp32, &bw_args);
+    }
+
+    //  Gradients with respect to Q and K before the rotation
+    if (mhsa_args->rope_cos != NULL) {
+        struct rope_rotate_args rot_args;
+        rot_args.cos = mhsa_args->rope_cos;
+        rot_args.sin = mhsa_args->rope_sin;
+        rot_args.L = L;
+        rot_args.H = H;
+        rot_args.inverse = 1;
+
+        rot_args.x = q_diff;
+        rot_args.F = F;
+        pi_cl_team_fork(NUM_CORES, rope_rotate_fp32, &rot_args);
+
+        rot_args.x = k_diff;
+        rot_args.F = Fkv;
+        pi_cl_team_fork(NUM_CORES, rope_rotate_fp32, &rot_args);
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~ Input projections ~~~~~~~~~~~~~~~~~~~~~~
+    //  dW = diff * input
+    matMul_args.B = inputData;
+    matMul_args.K = L;
+    matMul_args.M = E;
+    matMul_args.trans_B = 0;
+
+    matMul_args.A = q_diff;
+    matMul_args.C = coeffDiffWinQ;
+    matMul_args.N = F;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+    matMul_args.A = k_diff;
+    matMul_args.C = coeffDiffWinK;
+    matMul_args.N = Fkv;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+    matMul_args.A = v_diff;
+    matMul_args.C = coeffDiffWinV;
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+    //  inputDiff = q_diff^T * Wq + k_diff^T * Wk + v_diff^T * Wv
+    float *partial = temp + L * F;                                  //  L x E
+    struct vect_sum_args vect_sum_args;
+    vect_sum_args.op_1 = inputDiff;
+    vect_sum_args.op_2 = partial;
+    vect_sum_args.dest = inputDiff;
+    vect_sum_args.size = L * E;
+
+    float *diffs[3] = {q_diff, k_diff, v_diff};
+    float *weights[3] = {coeffDataWinQ, coeffDataWinK, coeffDataWinV};
+    int rows[3] = {F, Fkv, Fkv};
+
+    for (int j = 0; j < 3; j++) {
+        transp_args.in_matrix = diffs[j];
+        transp_args.out_matrix = temp;                              //  L x rows
+        transp_args.N = rows[j];
+        transp_args.M = L;
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args);
+
+        matMul_args.A = temp;
+        matMul_args.B = weights[j];
+        matMul_args.C = j == 0 ? inputDiff : partial;
+        matMul_args.N = L;
+        matMul_args.K = rows[j];
+        matMul_args.M = E;
+        pi_cl_team_fork(NUM_CORES, mm, &matMul_args);
+
+        if (j > 0)
+            pi_cl_team_fork(NUM_CORES, vect_sum, &vect_sum_args);
+    }
+}
+
+
 // BACKWARD INFERENCE
 void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
     // ======================================== DECLARATIONS ========================================
@@ -2460,12 +3811,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
     // T1
     struct transp_args transp_args1;
-    transp_args1.matrix = attention_map;
-    transp_args1.transp_matrix = temp;
+    transp_args1.in_matrix = attention_map;
+    transp_args1.out_matrix = temp;
     transp_args1.N = F;
     transp_args1.M = L;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args1);
 
     // M1
     struct matMul_args matMul_args1;
@@ -2491,12 +3842,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
     // T2
     struct transp_args transp_args2;
-    transp_args2.matrix = coeffDataWout;
-    transp_args2.transp_matrix = temp;
+    transp_args2.in_matrix = coeffDataWout;
+    transp_args2.out_matrix = temp;
     transp_args2.N = E;
     transp_args2.M = F;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args2);
+    pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args2);
 
     // M2
     struct matMul_args matMul_args2;
@@ -2546,12 +3897,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
         // T3
         struct transp_args transp_args3;
-        transp_args3.matrix = v + i * L * H;
-        transp_args3.transp_matrix = temp;
+        transp_args3.in_matrix = v + i * L * H;
+        transp_args3.out_matrix = temp;
         transp_args3.N = H;
         transp_args3.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args3);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args3);
 
         // M4
         struct matMul_args matMul_args4;
@@ -2601,12 +3952,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
     for (int i = 0; i < n_heads; i++) {
         // T4
         struct transp_args transp_args4;
-        transp_args4.matrix = softmax_buffer_diff + i * L * L;
-        transp_args4.transp_matrix = temp;
+        transp_args4.in_matrix = softmax_buffer_diff + i * L * L;
+        transp_args4.out_matrix = temp;
         transp_args4.N = L;
         transp_args4.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args4);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args4);
 
         // SM
         struct softmax_args softmax_arg;
@@ -2621,12 +3972,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
         // T5
         struct transp_args transp_args5;
-        transp_args5.matrix = grad;
-        transp_args5.transp_matrix = temp;
+        transp_args5.in_matrix = grad;
+        transp_args5.out_matrix = temp;
         transp_args5.N = L;
         transp_args5.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args5);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args5);
 
         // C2
         struct copy_args copy_args2;
@@ -2645,12 +3996,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
         // T6
         struct transp_args transp_args6;
-        transp_args6.matrix = q + i * L * H;
-        transp_args6.transp_matrix = temp;
+        transp_args6.in_matrix = q + i * L * H;
+        transp_args6.out_matrix = temp;
         transp_args6.N = H;
         transp_args6.M = L;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args6);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args6);
 
         // M5
         struct matMul_args matMul_args5;
@@ -2676,12 +4027,12 @@ void pulp_mhsa_mobilebert_inference_fp32_bw_cl(void *Mhsa_args){
 
         // T7
         struct transp_args transp_args7;
-        transp_args7.matrix = k_diff + i * L * H;
-        transp_args7.transp_matrix = temp;
+        transp_args7.in_matrix = k_diff + i * L * H;
+        transp_args7.out_matrix = temp;
         transp_args7.N = L;
         transp_args7.M = H;
 
-        pi_cl_team_fork(NUM_CORES, transpose, &transp_args7);
+        pi_cl_team_fork(NUM_CORES, transpose_matrix, &transp_args7);
 
          // C3
         struct copy_args copy_args3;
@@ -20,7 +20,36 @@
 
 #include "pmsis.h"
 #include "pulp_train_utils_fp16.h"
+#include "pulp_train_utils_fp32.h"
 #include "pulp_optimizers_fp16.h"
+#include "pulp_optimizers_fp32.h"
+#include "pulp_random.h"
+#include <math.h>
+
+
+//  Key of the stochastic rounding of a tensor: the address of the tensor is hashed with the seed, so that the tensors of a network
+//  draw different streams with the same seed, with the element index as the counter
+static inline uint32_t stochastic_round_key(unsigned int seed, fp16 * data)
+{
+    return pulp_counter_rand(seed, (uint32_t) (uintptr_t) data);
+}
+
+
+//  Plain SGD update of the elements [start, stop) of a tensor, rounded to nearest in FP16 or stochastically from FP32
+static inline void sgd_update_fp16(fp16 * __restrict__ p, fp16 * __restrict__ g, int start, int stop, fp16 lr, int rounding, uint32_t key)
+{
+    if (rounding == FP16_ROUND_STOCHASTIC)
+    {
+        float lr_f = (float) lr;
+        for (int i=start; i<stop; i++)
+            p[i] = stochastic_round_fp16((float) p[i] - lr_f * (float) g[i], pulp_counter_rand(key, i));
+    }
+    else
+    {
+        for (int i=start; i<stop; i++)
+            p[i] -= lr * g[i];
+    }
+}
 
 
 void pulp_gradient_descent_fp16 (void * optim_args_fp16) 
@@ -44,10 +73,7 @@ void pulp_gradient_descent_fp16 (void * optim_args_fp16)
     int start = pi_core_id()*blockSize;
     int stop = start+blockSize > wgt_size ? wgt_size : start+blockSize;
 
-    for (int i=start; i<stop; i++) 
-    {   
-        weights[i] -= lr * weight_grad[i];
-    }    
+    sgd_update_fp16(weights, weight_grad, start, stop, lr, args->rounding, stochastic_round_key(args->seed, weights));
 
     #ifdef DEBUG
     printf("\n*** WEIGHTS ***\n");
@@ -72,10 +98,7 @@ void pulp_gradient_descent_fp16 (void * optim_args_fp16)
         int start_bias = pi_core_id()*blockSize_bias;
         int stop_bias = start_bias+blockSize_bias > bias_size ? bias_size : start_bias+blockSize_bias;
 
-        for (int i=start_bias; i<stop_bias; i++) 
-        {   
-            biases[i] -= lr * bias_grad[i];
-        }    
+        sgd_update_fp16(biases, bias_grad, start_bias, stop_bias, lr, args->rounding, stochastic_round_key(args->seed, biases));
 
         #ifdef DEBUG
         printf("\n*** BIASES ***\n");
@@ -84,3 +107,386 @@ void pulp_gradient_descent_fp16 (void * optim_args_fp16)
         #endif
     }
 }
+
+
+
+//  Fused momentum SGD update of the elements [start, stop) of a tensor: each of p, g, vel is read once.
+//  With stochastic rounding, the new parameter is computed in FP32 from the FP16 step
+static inline void sgd_momentum_update_fp16(
+    fp16 * __restrict__ p, fp16 * __restrict__ g, fp16 * __restrict__ vel, int start, int stop,
+    fp16 lr, fp16 grad_scale, fp16 momentum, int nesterov, fp16 l2, fp16 decay, int rounding, uint32_t key)
+{
+    for (int i=start; i<stop; i++)
+    {
+        fp16 pi = p[i];
+        fp16 gi = grad_scale * g[i] + l2 * pi;
+        fp16 vi = momentum * vel[i] + gi;
+        fp16 step = nesterov ? gi + momentum * vi : vi;
+        vel[i] = vi;
+        if (rounding == FP16_ROUND_STOCHASTIC)
+            p[i] = stochastic_round_fp16((float) pi * (float) decay - (float) lr * (float) step, pulp_counter_rand(key, i));
+        else
+            p[i] = pi * decay - lr * step;
+    }
+}
+
+
+//  Fused Adam update of the elements [start, stop) of a tensor: each of p, g, m, v is read once. The update is computed in FP32
+static inline void adam_update_fp16(
+    fp16 * __restrict__ p, fp16 * __restrict__ g, fp16 * __restrict__ m, fp16 * __restrict__ v, int start, int stop,
+    float grad_scale, float beta1, float beta2, float eps, float step_size, float inv_sqrt_bc2, float decay, int rounding, uint32_t key)
+{
+    for (int i=start; i<stop; i++)
+    {
+        float gi = grad_scale * (float) g[i];
+        float mi = beta1 * (float) m[i] + (1.0f - beta1) * gi;
+        float vi = beta2 * (float) v[i] + (1.0f - beta2) * gi * gi;
+        float pi = (float) p[i] * decay - step_size * mi / (sqrtf(vi) * inv_sqrt_bc2 + eps);
+        m[i] = (fp16) mi;
+        v[i] = (fp16) vi;
+        p[i] = rounding == FP16_ROUND_STOCHASTIC ? stochastic_round_fp16(pi, pulp_counter_rand(key, i)) : (fp16) pi;
+    }
+}
+
+
+//  Updates the elements [start, stop) of the weights (tensor = 0) or of the biases (tensor = 1) of a layer with the given optimizer,
+//  the gradient being multiplied by grad_scale (1 without clipping)
+static inline void optimizer_update_range_fp16(int optimizer, void * layer_args, int tensor, int start, int stop, float grad_scale)
+{
+    if (optimizer == OPTIM_ADAM)
+    {
+        struct adam_args_fp16 * args = (struct adam_args_fp16 *) layer_args;
+        float lr = args->learning_rate;
+        // Bias corrections folded into the step size and the denominator: lr / (1 - beta1^t) * m / (sqrt(v) / sqrt(1 - beta2^t) + eps)
+        float step_size = lr / (1.0f - powf(args->beta1, (float) args->step));
+        float inv_sqrt_bc2 = 1.0f / sqrtf(1.0f - powf(args->beta2, (float) args->step));
+        float decay = 1.0f - lr * args->weight_decay;
+        struct blob_fp16 * t = tensor ? args->biases : args->weights;
+
+        // The step is folded into the key, so that a constant seed still draws new numbers at every step
+        uint32_t key = stochastic_round_key(args->seed + (unsigned int) args->step * 0x9e3779b9u, t->data);
+
+        adam_update_fp16(t->data, t->diff, tensor ? args->m_biases : args->m_weights, tensor ? args->v_biases : args->v_weights,
+                          start, stop, grad_scale, args->beta1, args->beta2, args->eps, step_size, inv_sqrt_bc2, decay, args->rounding, key);
+    }
+    else
+    {
+        struct optim_args_fp16 * args = (struct optim_args_fp16 *) layer_args;
+        fp16 lr = args->learning_rate;
+        struct blob_fp16 * t = tensor ? args->biases : args->weights;
+        uint32_t key = stochastic_round_key(args->seed, t->data);
+
+        if (optimizer == OPTIM_SGD)
+        {
+            sgd_update_fp16(t->data, t->diff, start, stop, lr * (fp16) grad_scale, args->rounding, key);
+        }
+        else
+        {
+            // The weight decay is either an L2 term of the gradient or a direct decay of the weights
+            fp16 l2 = args->decoupled_weight_decay ? 0 : args->weight_decay;
+            fp16 decay = args->decoupled_weight_decay ? (fp16) 1.0f - lr * args->weight_decay : (fp16) 1.0f;
+
+            sgd_momentum_update_fp16(t->data, t->diff, tensor ? args->velocity_biases : args->velocity_weights,
+                                      start, stop, lr, (fp16) grad_scale, args->momentum, args->nesterov, l2, decay, args->rounding, key);
+        }
+    }
+}
+
+
+//  Single layer step: each tensor is split among the cores
+static inline void optimizer_step_fp16(int optimizer, void * layer_args, struct blob_fp16 * weights, struct blob_fp16 * biases, int use_biases)
+{
+    for (int tensor=0; tensor<1+(use_biases == 1); tensor++)
+    {
+        int size = tensor ? biases->dim : weights->dim;
+        int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+        int start = pi_core_id()*blockSize;
+        int stop = start+blockSize > size ? size : start+blockSize;
+
+        optimizer_update_range_fp16(optimizer, layer_args, tensor, start, stop, 1.0f);
+    }
+}
+
+
+void pulp_sgd_momentum_fp16 (void * optim_args_fp16)
+{
+    struct optim_args_fp16 * args = (struct optim_args_fp16 *) optim_args_fp16;
+    optimizer_step_fp16(OPTIM_SGD_MOMENTUM, args, args->weights, args->biases, args->use_biases);
+}
+
+
+void pulp_adam_fp16 (void * adam_args_fp16)
+{
+    struct adam_args_fp16 * args = (struct adam_args_fp16 *) adam_args_fp16;
+    optimizer_step_fp16(OPTIM_ADAM, args, args->weights, args->biases, args->use_biases);
+}
+
+
+//  Structure of the layer l of a multi-tensor list (optim_args or adam_args)
+static inline void * optimizer_multi_layer_fp16(struct optim_multi_args_fp16 * args, int l)
+{
+    if (args->optimizer == OPTIM_ADAM)
+        return &args->adam_layers[l];
+    return &args->layers[l];
+}
+
+
+//  Weights (tensor = 0) or biases (tensor = 1) of the layer l of a multi-tensor list, NULL if the layer has no biases
+static inline struct blob_fp16 * optimizer_multi_tensor_fp16(struct optim_multi_args_fp16 * args, int l, int tensor)
+{
+    struct blob_fp16 * weights;
+    struct blob_fp16 * biases;
+    int use_biases;
+    if (args->optimizer == OPTIM_ADAM)
+    {
+        weights = args->adam_layers[l].weights;
+        biases = args->adam_layers[l].biases;
+        use_biases = args->adam_layers[l].use_biases;
+    }
+    else
+    {
+        weights = args->layers[l].weights;
+        biases = args->layers[l].biases;
+        use_biases = args->layers[l].use_biases;
+    }
+    return tensor == 0 ? weights : (use_biases == 1 ? biases : NULL);
+}
+
+
+//  Sum of the squares of the gradient elements [start, stop), accumulated in FP32
+static inline float grad_sum_of_squares_fp16(fp16 * __restrict__ g, int start, int stop)
+{
+    float res = 0;
+    for (int i=start; i<stop; i++)
+    {
+        float gi = (float) g[i];
+        res += gi * gi;
+    }
+    return res;
+}
+
+
+//  Tree reduction of the per-core partial sums (NUM_CORES elements): returns the total to all the cores
+static inline float optimizer_tree_reduce_fp16(float * partial_sums, float value)
+{
+    int id = pi_core_id();
+    partial_sums[id] = value;
+    pi_cl_team_barrier();
+
+    for (int stride=1; stride<NUM_CORES; stride<<=1)
+    {
+        if ((id & (2*stride-1)) == 0 && id+stride < NUM_CORES)
+            partial_sums[id] += partial_sums[id+stride];
+        pi_cl_team_barrier();
+    }
+    return partial_sums[0];
+}
+
+
+//  Scale of the gradients that brings their global L2 norm down to max_norm, as torch.nn.utils.clip_grad_norm_
+static inline float clip_grad_scale(float norm, float max_norm)
+{
+    float clip_coef = max_norm / (norm + 1e-6f);
+    return clip_coef < 1.0f ? clip_coef : 1.0f;
+}
+
+
+void pulp_optimizer_multi_fp16 (void * optim_multi_args_fp16)
+{
+    struct optim_multi_args_fp16 * args = (struct optim_multi_args_fp16 *) optim_multi_args_fp16;
+    int n_layers = args->n_layers;
+    int optimizer = args->optimizer;
+
+    // Global index space: the weights and biases of all the layers, one after the other
+    int total_size = 0;
+    for (int l=0; l<n_layers; l++)
+        for (int tensor=0; tensor<2; tensor++)
+        {
+            struct blob_fp16 * t = optimizer_multi_tensor_fp16(args, l, tensor);
+            if (t != NULL) total_size += t->dim;
+        }
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    // Global norm clipping: the gradients are read once more only when clipping is enabled, and the clipped gradients are never written back
+    float grad_scale = 1.0f;
+    if (args->max_grad_norm > 0)
+    {
+        float res = 0;
+        int offset = 0;
+        for (int l=0; l<n_layers && offset<stop; l++)
+            for (int tensor=0; tensor<2; tensor++)
+            {
+                struct blob_fp16 * t = optimizer_multi_tensor_fp16(args, l, tensor);
+                if (t == NULL) continue;
+                int lo = start > offset ? start - offset : 0;
+                int hi = stop < offset + t->dim ? stop - offset : t->dim;
+                if (lo < hi)
+                    res += grad_sum_of_squares_fp16(t->diff, lo, hi);
+                offset += t->dim;
+            }
+
+        float norm = sqrtf(optimizer_tree_reduce_fp16(args->partial_sums, res));
+        grad_scale = clip_grad_scale(norm, args->max_grad_norm);
+        if (pi_core_id() == 0) args->grad_norm = norm;
+    }
+
+    // Each core updates the part of every tensor that falls into its chunk
+    int offset = 0;
+    for (int l=0; l<n_layers && offset<stop; l++)
+        for (int tensor=0; tensor<2; tensor++)
+        {
+            struct blob_fp16 * t = optimizer_multi_tensor_fp16(args, l, tensor);
+            if (t == NULL) continue;
+            int lo = start > offset ? start - offset : 0;
+            int hi = stop < offset + t->dim ? stop - offset : t->dim;
+            if (lo < hi)
+                optimizer_update_range_fp16(optimizer, optimizer_multi_layer_fp16(args, l), tensor, lo, hi, grad_scale);
+            offset += t->dim;
+        }
+}
+
+
+void pulp_clip_grad_norm_fp16 (void * clip_grad_norm_args_fp16)
+{
+    struct clip_grad_norm_args_fp16 * args = (struct clip_grad_norm_args_fp16 *) clip_grad_norm_args_fp16;
+    int n_blobs = args->n_blobs;
+
+    // Same global index space of the multi-tensor optimizer step, on the gradients of the blobs
+    int total_size = 0;
+    for (int b=0; b<n_blobs; b++)
+        total_size += args->blobs[b]->dim;
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    float res = 0;
+    int offset = 0;
+    for (int b=0; b<n_blobs && offset<stop; b++)
+    {
+        int size = args->blobs[b]->dim;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        if (lo < hi)
+            res += grad_sum_of_squares_fp16(args->blobs[b]->diff, lo, hi);
+        offset += size;
+    }
+
+    float norm = sqrtf(optimizer_tree_reduce_fp16(args->partial_sums, res));
+    float grad_scale = clip_grad_scale(norm, args->max_norm);
+    if (pi_core_id() == 0) args->norm = norm;
+    if (grad_scale == 1.0f) return;
+
+    fp16 scale = (fp16) grad_scale;
+    offset = 0;
+    for (int b=0; b<n_blobs && offset<stop; b++)
+    {
+        int size = args->blobs[b]->dim;
+        fp16 * __restrict__ g = args->blobs[b]->diff;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        for (int i=lo; i<hi; i++)
+            g[i] *= scale;
+        offset += size;
+    }
+}
+
+
+
+//  Exponent field of the fp16 format, all ones for inf and nan
+#define FP16_EXP_MASK   (((2*FP16_EXP_BIAS+1) << FP16_MANT_BITS) & 0x7fff)
+
+void mixed_precision_unscale_fp16 (void * mixed_precision_args_fp16)
+{
+    struct mixed_precision_args_fp16 * args = (struct mixed_precision_args_fp16 *) mixed_precision_args_fp16;
+    int n_tensors = args->n_tensors;
+    float inv_scale = 1.0f / args->loss_scale;
+
+    int total_size = 0;
+    for (int t=0; t<n_tensors; t++)
+        total_size += args->params[t]->dim;
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    // The overflow check is fused with the unscaling: an exponent field of all ones flags an inf or a nan
+    unsigned short found_inf = 0;
+    int offset = 0;
+    for (int t=0; t<n_tensors && offset<stop; t++)
+    {
+        int size = args->params[t]->dim;
+        fp16 * __restrict__ g = args->params[t]->diff;
+        float * __restrict__ master_g = args->master[t]->diff;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        for (int i=lo; i<hi; i++)
+        {
+            unsigned short bits = *((unsigned short *) &g[i]);
+            found_inf |= (bits & FP16_EXP_MASK) == FP16_EXP_MASK;
+            master_g[i] = (float) g[i] * inv_scale;
+        }
+        offset += size;
+    }
+
+    float n_inf = optimizer_tree_reduce_fp16(args->partial_sums, (float) found_inf);
+    if (pi_core_id() == 0) args->found_inf = n_inf > 0 ? 1 : 0;
+}
+
+
+void mixed_precision_update_params_fp16 (void * mixed_precision_args_fp16)
+{
+    struct mixed_precision_args_fp16 * args = (struct mixed_precision_args_fp16 *) mixed_precision_args_fp16;
+    int n_tensors = args->n_tensors;
+
+    int total_size = 0;
+    for (int t=0; t<n_tensors; t++)
+        total_size += args->params[t]->dim;
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    int offset = 0;
+    for (int t=0; t<n_tensors && offset<stop; t++)
+    {
+        int size = args->params[t]->dim;
+        fp16 * __restrict__ w = args->params[t]->data;
+        float * __restrict__ master_w = args->master[t]->data;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        for (int i=lo; i<hi; i++)
+            w[i] = (fp16) master_w[i];
+        offset += size;
+    }
+}
+
+
+void pulp_mixed_precision_step_fp16 (void * mixed_precision_args_fp16)
+{
+    struct mixed_precision_args_fp16 * args = (struct mixed_precision_args_fp16 *) mixed_precision_args_fp16;
+
+    pi_cl_team_fork(NUM_CORES, mixed_precision_unscale_fp16, args);
+
+    // Overflow: the gradients are unusable, skip the update and retry with a smaller scale
+    if (args->found_inf)
+    {
+        args->loss_scale *= args->backoff_factor;
+        args->good_steps = 0;
+        args->skipped_steps++;
+        return;
+    }
+
+    pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp32, args->optimizer);
+    pi_cl_team_fork(NUM_CORES, mixed_precision_update_params_fp16, args);
+
+    args->good_steps++;
+    if (args->good_steps >= args->growth_interval)
+    {
+        args->loss_scale *= args->growth_factor;
+        args->good_steps = 0;
+    }
+}
@@ -21,6 +21,7 @@
 #include "pmsis.h"
 #include "pulp_train_utils_fp32.h"
 #include "pulp_optimizers_fp32.h"
+#include <math.h>
 
 
 void pulp_gradient_descent_fp32 (void * optim_args) 
@@ -83,4 +84,280 @@ void pulp_gradient_descent_fp32 (void * optim_args)
         printf("\n\n");
         #endif
     }
-}
\ No newline at end of file
+}
+
+
+
+//  Fused momentum SGD update of the elements [start, stop) of a tensor: each of p, g, vel is read once
+static inline void sgd_momentum_update_fp32(
+    float * __restrict__ p, float * __restrict__ g, float * __restrict__ vel, int start, int stop,
+    float lr, float grad_scale, float momentum, int nesterov, float l2, float decay)
+{
+    for (int i=start; i<stop; i++)
+    {
+        float pi = p[i];
+        float gi = grad_scale * g[i] + l2 * pi;
+        float vi = momentum * vel[i] + gi;
+        vel[i] = vi;
+        p[i] = pi * decay - lr * (nesterov ? gi + momentum * vi : vi);
+    }
+}
+
+
+//  Fused Adam update of the elements [start, stop) of a tensor: each of p, g, m, v is read once
+static inline void adam_update_fp32(
+    float * __restrict__ p, float * __restrict__ g, float * __restrict__ m, float * __restrict__ v, int start, int stop,
+    float grad_scale, float beta1, float beta2, float eps, float step_size, float inv_sqrt_bc2, float decay)
+{
+    for (int i=start; i<stop; i++)
+    {
+        float gi = grad_scale * g[i];
+        float mi = beta1 * m[i] + (1.0f - beta1) * gi;
+        float vi = beta2 * v[i] + (1.0f - beta2) * gi * gi;
+        m[i] = mi;
+        v[i] = vi;
+        p[i] = p[i] * decay - step_size * mi / (sqrtf(vi) * inv_sqrt_bc2 + eps);
+    }
+}
+
+
+//  Updates the elements [start, stop) of the weights (tensor = 0) or of the biases (tensor = 1) of a layer with the given optimizer,
+//  the gradient being multiplied by grad_scale (1 without clipping)
+static inline void optimizer_update_range_fp32(int optimizer, void * layer_args, int tensor, int start, int stop, float grad_scale)
+{
+    if (optimizer == OPTIM_ADAM)
+    {
+        struct adam_args * args = (struct adam_args *) layer_args;
+        float lr = args->learning_rate;
+        // Bias corrections folded into the step size and the denominator: lr / (1 - beta1^t) * m / (sqrt(v) / sqrt(1 - beta2^t) + eps)
+        float step_size = lr / (1.0f - powf(args->beta1, (float) args->step));
+        float inv_sqrt_bc2 = 1.0f / sqrtf(1.0f - powf(args->beta2, (float) args->step));
+        float decay = 1.0f - lr * args->weight_decay;
+        struct blob * t = tensor ? args->biases : args->weights;
+
+        adam_update_fp32(t->data, t->diff, tensor ? args->m_biases : args->m_weights, tensor ? args->v_biases : args->v_weights,
+                          start, stop, grad_scale, args->beta1, args->beta2, args->eps, step_size, inv_sqrt_bc2, decay);
+    }
+    else
+    {
+        struct optim_args * args = (struct optim_args *) layer_args;
+        float lr = args->learning_rate;
+        struct blob * t = tensor ? args->biases : args->weights;
+
+        if (optimizer == OPTIM_SGD)
+        {
+            float * __restrict__ p = t->data;
+            float * __restrict__ g = t->diff;
+            // The gradient is scaled before the learning rate, as if it had been clipped in place by pulp_clip_grad_norm_fp32
+            for (int i=start; i<stop; i++)
+                p[i] -= lr * (grad_scale * g[i]);
+        }
+        else
+        {
+            // The weight decay is either an L2 term of the gradient or a direct decay of the weights
+            float l2 = args->decoupled_weight_decay ? 0 : args->weight_decay;
+            float decay = args->decoupled_weight_decay ? 1.0f - lr * args->weight_decay : 1.0f;
+
+            sgd_momentum_update_fp32(t->data, t->diff, tensor ? args->velocity_biases : args->velocity_weights,
+                                      start, stop, lr, grad_scale, args->momentum, args->nesterov, l2, decay);
+        }
+    }
+}
+
+
+//  Single layer step: each tensor is split among the cores
+static inline void optimizer_step_fp32(int optimizer, void * layer_args, struct blob * weights, struct blob * biases, int use_biases)
+{
+    for (int tensor=0; tensor<1+(use_biases == 1); tensor++)
+    {
+        int size = tensor ? biases->dim : weights->dim;
+        int blockSize = (size+NUM_CORES-1) / NUM_CORES;
+        int start = pi_core_id()*blockSize;
+        int stop = start+blockSize > size ? size : start+blockSize;
+
+        optimizer_update_range_fp32(optimizer, layer_args, tensor, start, stop, 1.0f);
+    }
+}
+
+
+void pulp_sgd_momentum_fp32 (void * optim_args)
+{
+    struct optim_args * args = (struct optim_args *) optim_args;
+    optimizer_step_fp32(OPTIM_SGD_MOMENTUM, args, args->weights, args->biases, args->use_biases);
+}
+
+
+void pulp_adam_fp32 (void * adam_args)
+{
+    struct adam_args * args = (struct adam_args *) adam_args;
+    optimizer_step_fp32(OPTIM_ADAM, args, args->weights, args->biases, args->use_biases);
+}
+
+
+//  Structure of the layer l of a multi-tensor list (optim_args or adam_args)
+static inline void * optimizer_multi_layer_fp32(struct optim_multi_args * args, int l)
+{
+    if (args->optimizer == OPTIM_ADAM)
+        return &args->adam_layers[l];
+    return &args->layers[l];
+}
+
+
+//  Weights (tensor = 0) or biases (tensor = 1) of the layer l of a multi-tensor list, NULL if the layer has no biases
+static inline struct blob * optimizer_multi_tensor_fp32(struct optim_multi_args * args, int l, int tensor)
+{
+    struct blob * weights;
+    struct blob * biases;
+    int use_biases;
+    if (args->optimizer == OPTIM_ADAM)
+    {
+        weights = args->adam_layers[l].weights;
+        biases = args->adam_layers[l].biases;
+        use_biases = args->adam_layers[l].use_biases;
+    }
+    else
+    {
+        weights = args->layers[l].weights;
+        biases = args->layers[l].biases;
+        use_biases = args->layers[l].use_biases;
+    }
+    return tensor == 0 ? weights : (use_biases == 1 ? biases : NULL);
+}
+
+
+//  Sum of the squares of the gradient elements [start, stop), accumulated in FP32
+static inline float grad_sum_of_squares_fp32(float * __restrict__ g, int start, int stop)
+{
+    float res = 0;
+    for (int i=start; i<stop; i++)
+        res += g[i] * g[i];
+    return res;
+}
+
+
+//  Tree reduction of the per-core partial sums (NUM_CORES elements): returns the total to all the cores
+static inline float optimizer_tree_reduce_fp32(float * partial_sums, float value)
+{
+    int id = pi_core_id();
+    partial_sums[id] = value;
+    pi_cl_team_barrier();
+
+    for (int stride=1; stride<NUM_CORES; stride<<=1)
+    {
+        if ((id & (2*stride-1)) == 0 && id+stride < NUM_CORES)
+            partial_sums[id] += partial_sums[id+stride];
+        pi_cl_team_barrier();
+    }
+    return partial_sums[0];
+}
+
+
+//  Scale of the gradients that brings their global L2 norm down to max_norm, as torch.nn.utils.clip_grad_norm_
+static inline float clip_grad_scale(float norm, float max_norm)
+{
+    float clip_coef = max_norm / (norm + 1e-6f);
+    return clip_coef < 1.0f ? clip_coef : 1.0f;
+}
+
+
+void pulp_optimizer_multi_fp32 (void * optim_multi_args)
+{
+    struct optim_multi_args * args = (struct optim_multi_args *) optim_multi_args;
+    int n_layers = args->n_layers;
+    int optimizer = args->optimizer;
+
+    // Global index space: the weights and biases of all the layers, one after the other
+    int total_size = 0;
+    for (int l=0; l<n_layers; l++)
+        for (int tensor=0; tensor<2; tensor++)
+        {
+            struct blob * t = optimizer_multi_tensor_fp32(args, l, tensor);
+            if (t != NULL) total_size += t->dim;
+        }
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    // Global norm clipping: the gradients are read once more only when clipping is enabled, and the clipped gradients are never written back
+    float grad_scale = 1.0f;
+    if (args->max_grad_norm > 0)
+    {
+        float res = 0;
+        int offset = 0;
+        for (int l=0; l<n_layers && offset<stop; l++)
+            for (int tensor=0; tensor<2; tensor++)
+            {
+                struct blob * t = optimizer_multi_tensor_fp32(args, l, tensor);
+                if (t == NULL) continue;
+                int lo = start > offset ? start - offset : 0;
+                int hi = stop < offset + t->dim ? stop - offset : t->dim;
+                if (lo < hi)
+                    res += grad_sum_of_squares_fp32(t->diff, lo, hi);
+                offset += t->dim;
+            }
+
+        float norm = sqrtf(optimizer_tree_reduce_fp32(args->partial_sums, res));
+        grad_scale = clip_grad_scale(norm, args->max_grad_norm);
+        if (pi_core_id() == 0) args->grad_norm = norm;
+    }
+
+    // Each core updates the part of every tensor that falls into its chunk
+    int offset = 0;
+    for (int l=0; l<n_layers && offset<stop; l++)
+        for (int tensor=0; tensor<2; tensor++)
+        {
+            struct blob * t = optimizer_multi_tensor_fp32(args, l, tensor);
+            if (t == NULL) continue;
+            int lo = start > offset ? start - offset : 0;
+            int hi = stop < offset + t->dim ? stop - offset : t->dim;
+            if (lo < hi)
+                optimizer_update_range_fp32(optimizer, optimizer_multi_layer_fp32(args, l), tensor, lo, hi, grad_scale);
+            offset += t->dim;
+        }
+}
+
+
+void pulp_clip_grad_norm_fp32 (void * clip_grad_norm_args)
+{
+    struct clip_grad_norm_args * args = (struct clip_grad_norm_args *) clip_grad_norm_args;
+    int n_blobs = args->n_blobs;
+
+    // Same global index space of the multi-tensor optimizer step, on the gradients of the blobs
+    int total_size = 0;
+    for (int b=0; b<n_blobs; b++)
+        total_size += args->blobs[b]->dim;
+
+    int blockSize = (total_size+NUM_CORES-1) / NUM_CORES;
+    int start = pi_core_id()*blockSize;
+    int stop = start+blockSize > total_size ? total_size : start+blockSize;
+
+    float res = 0;
+    int offset = 0;
+    for (int b=0; b<n_blobs && offset<stop; b++)
+    {
+        int size = args->blobs[b]->dim;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        if (lo < hi)
+            res += grad_sum_of_squares_fp32(args->blobs[b]->diff, lo, hi);
+        offset += size;
+    }
+
+    float norm = sqrtf(optimizer_tree_reduce_fp32(args->partial_sums, res));
+    float grad_scale = clip_grad_scale(norm, args->max_norm);
+    if (pi_core_id() == 0) args->norm = norm;
+    if (grad_scale == 1.0f) return;
+
+    offset = 0;
+    for (int b=0; b<n_blobs && offset<stop; b++)
+    {
+        int size = args->blobs[b]->dim;
+        float * __restrict__ g = args->blobs[b]->diff;
+        int lo = start > offset ? start - offset : 0;
+        int hi = stop < offset + size ? stop - offset : size;
+        for (int i=lo; i<hi; i++)
+            g[i] *= grad_scale;
+        offset += size;
+    }
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train_utils_fp16.h"
+#include "pulp_rnn_fp16.h"
+
+
+// GATED RECURRENT LAYERS (LSTM, GRU)
+void pulp_lstm_fp16_fw_cl(void *Gated_rnn_args_fp16) {
+    pi_cl_team_fork(NUM_CORES, lstm_fw_fp16, Gated_rnn_args_fp16);
+}
+
+
+void pulp_lstm_fp16_bw_cl(void *Gated_rnn_args_fp16) {
+    pi_cl_team_fork(NUM_CORES, lstm_bw_fp16, Gated_rnn_args_fp16);
+    pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp16, Gated_rnn_args_fp16);
+}
+
+
+void pulp_gru_fp16_fw_cl(void *Gated_rnn_args_fp16) {
+    pi_cl_team_fork(NUM_CORES, gru_fw_fp16, Gated_rnn_args_fp16);
+}
+
+
+void pulp_gru_fp16_bw_cl(void *Gated_rnn_args_fp16) {
+    pi_cl_team_fork(NUM_CORES, gru_bw_fp16, Gated_rnn_args_fp16);
+    pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp16, Gated_rnn_args_fp16);
+}
+
+
+//  SIMD dot product of n (even) elements
+static inline fp16 rnn_dot_fp16(fp16 *w, fp16 *x, int n) {
+    v2f16 acc = (v2f16) {0, 0};
+    for (int k = 0; k < n; k += 2)
+        acc += *((v2f16 *) &w[k]) * *((v2f16 *) &x[k]);
+    return acc[0] + acc[1];
+}
+
+
+//  Hidden state before the first timestep of the window: saved by the forward when the state is carried between windows
+static inline fp16 *rnn_initial_state_fp16(struct Gated_rnn_args_fp16 *args, int cell) {
+    if (args->carry_state)
+        return args->prev_state + cell * args->output->W;
+    struct blob_fp16 *state = cell ? args->cell_state : args->state;
+    return state != NULL ? state->data : NULL;
+}
+
+
+//  Input projection of all the timesteps, hoisted out of the recurrence: gates[t] = W_x * x_t + b, parallel on the N x G*H elements
+static inline void rnn_input_projection_fp16(struct Gated_rnn_args_fp16 *args) {
+    fp16 *W = args->coeff->data;
+    fp16 *bias = args->bias != NULL ? args->bias->data : NULL;
+    fp16 *X = args->input->data;
+    fp16 *gates = args->gates;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+    int GH = args->coeff->H;
+
+    const int dim = N * GH;
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int idx = start; idx < stop; idx++) {
+        int t = idx / GH;
+        int r = idx - t * GH;
+        gates[t * 4 * H + r] = rnn_dot_fp16(W + r * KH, X + t * K, K) + (bias != NULL ? bias[r] : (fp16) 0);
+    }
+}
+
+
+//  Recurrent part of the gate row r: W_h * h (h = NULL for a zero state)
+static inline fp16 rnn_recurrent_fp16(fp16 *W, int r, fp16 *h, int K, int H) {
+    return h != NULL ? rnn_dot_fp16(W + r * (K + H) + K, h, H) : (fp16) 0;
+}
+
+
+//  Saves the initial state of the window for the backward and leaves the last one for the next window
+static inline void rnn_carry_state_fp16(struct Gated_rnn_args_fp16 *args, fp16 *last_h, fp16 *last_c, int start, int stop) {
+    int H = args->output->W;
+    for (int j = start; j < stop; j++) {
+        args->prev_state[j] = args->state->data[j];
+        args->state->data[j] = last_h[j];
+        if (last_c != NULL) {
+            args->prev_state[H + j] = args->cell_state->data[j];
+            args->cell_state->data[j] = last_c[j];
+        }
+    }
+}
+
+
+void lstm_fw_fp16(void *Gated_rnn_args_fp16) {
+    struct Gated_rnn_args_fp16 *args = (struct Gated_rnn_args_fp16 *) Gated_rnn_args_fp16;
+    fp16 *W = args->coeff->data;
+    fp16 *Y = args->output->data;
+    fp16 *h0 = args->state != NULL ? args->state->data : NULL;
+    fp16 *c0 = args->cell_state != NULL ? args->cell_state->data : NULL;
+    fp16 *gates = args->gates;
+    fp16 *cells = args->cells;
+
+    int N = args->input->H;         // Sequence length
+    int K = args->input->W;         // Input size
+    int H = args->output->W;        // Hidden size
+
+    rnn_input_projection_fp16(args);
+    pi_cl_team_barrier();
+
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+    for (int t = 0; t < N; t++) {
+        fp16 *hp = t > 0 ? Y + (t - 1) * H : h0;
+        fp16 *cp = t > 0 ? cells + (t - 1) * H : c0;
+        fp16 *gt = gates + t * 4 * H;
+
+        for (int j = start; j < stop; j++) {
+            // Recurrent matmul with the activations in pairs in its epilogue, tanh(x) = 2 * sigmoid(2x) - 1
+            fp16 ai = gt[j] + rnn_recurrent_fp16(W, j, hp, K, H);
+            fp16 af = gt[H + j] + rnn_recurrent_fp16(W, H + j, hp, K, H);
+            fp16 ag = gt[2 * H + j] + rnn_recurrent_fp16(W, 2 * H + j, hp, K, H);
+            fp16 ao = gt[3 * H + j] + rnn_recurrent_fp16(W, 3 * H + j, hp, K, H);
+            v2f16 s_if = vsigmoid_fp16((v2f16) {ai, af});
+            v2f16 s_og = vsigmoid_fp16((v2f16) {ao, ag + ag});
+            fp16 g = s_og[1] + s_og[1] - one[0];
+
+            fp16 c = s_if[0] * g + (cp != NULL ? s_if[1] * cp[j] : (fp16) 0);
+            gt[j] = s_if[0];
+            gt[H + j] = s_if[1];
+            gt[2 * H + j] = g;
+            gt[3 * H + j] = s_og[0];
+            cells[t * H + j] = c;
+            Y[t * H + j] = s_og[0] * vtanh_fp16((v2f16) {c, c})[0];
+        }
+        // h_t is read by all the cores at the next timestep
+        pi_cl_team_barrier();
+    }
+
+    if (args->carry_state)
+        rnn_carry_state_fp16(args, Y + (N - 1) * H, cells + (N - 1) * H, start, stop);
+}
+
+
+void lstm_bw_fp16(void *Gated_rnn_args_fp16) {
+    struct Gated_rnn_args_fp16 *args = (struct Gated_rnn_args_fp16 *) Gated_rnn_args_fp16;
+    fp16 *W = args->coeff->data;
+    fp16 *dY = args->output->diff;
+    fp16 *c0 = rnn_initial_state_fp16(args, 1);
+    fp16 *dA = args->gates;             // Gate activations, replaced by the gradients of the pre-activations
+    fp16 *cells = args->cells;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+
+    fp16 *dh = args->grad_buffer;       // Gradient flowing into h_t from the next timestep
+    fp16 *dc = args->grad_buffer + H;   // Gradient flowing into c_t from the next timestep
+
+    //  Pairs of hidden units, owned by the same core in both phases so that dh and dc need no synchronization
+    const int blockSize = ((H + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+    for (int j = start; j < stop; j += 2) {
+        *((v2f16 *) &dh[j]) = (v2f16) {0, 0};
+        *((v2f16 *) &dc[j]) = (v2f16) {0, 0};
+    }
+
+    for (int t = N - 1; t >= 0; t--) {
+        fp16 *gt = dA + t * 4 * H;
+        fp16 *cp = t > 0 ? cells + (t - 1) * H : c0;
+
+        for (int j = start; j < stop; j += 2) {
+            v2f16 i = *((v2f16 *) &gt[j]);
+            v2f16 f = *((v2f16 *) &gt[H + j]);
+            v2f16 g = *((v2f16 *) &gt[2 * H + j]);
+            v2f16 o = *((v2f16 *) &gt[3 * H + j]);
+            v2f16 tc = vtanh_fp16(*((v2f16 *) &cells[t * H + j]));
+            v2f16 dhj = *((v2f16 *) &dh[j]) + *((v2f16 *) &dY[t * H + j]);
+            v2f16 dcj = *((v2f16 *) &dc[j]) + dhj * o * (one - tc * tc);
+
+            *((v2f16 *) &gt[j]) = dcj * g * i * (one - i);
+            *((v2f16 *) &gt[H + j]) = cp != NULL ? dcj * *((v2f16 *) &cp[j]) * f * (one - f) : (v2f16) {0, 0};
+            *((v2f16 *) &gt[2 * H + j]) = dcj * i * (one - g * g);
+            *((v2f16 *) &gt[3 * H + j]) = dhj * tc * o * (one - o);
+            *((v2f16 *) &dc[j]) = dcj * f;
+        }
+        pi_cl_team_barrier();
+
+        //  dh_t-1 = W_h^T * dA_t, on pairs of hidden units
+        for (int k = start; k < stop; k += 2) {
+            v2f16 acc = (v2f16) {0, 0};
+            for (int r = 0; r < 4 * H; r++)
+                acc += *((v2f16 *) &W[r * KH + K + k]) * (v2f16) {gt[r], gt[r]};
+            *((v2f16 *) &dh[k]) = acc;
+        }
+    }
+
+    if (args->state != NULL && args->state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->state->diff[j] = dh[j];
+    if (args->cell_state != NULL && args->cell_state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->cell_state->diff[j] = dc[j];
+}
+
+
+void gru_fw_fp16(void *Gated_rnn_args_fp16) {
+    struct Gated_rnn_args_fp16 *args = (struct Gated_rnn_args_fp16 *) Gated_rnn_args_fp16;
+    fp16 *W = args->coeff->data;
+    fp16 *bias = args->bias != NULL ? args->bias->data : NULL;
+    fp16 *Y = args->output->data;
+    fp16 *h0 = args->state != NULL ? args->state->data : NULL;
+    fp16 *gates = args->gates;
+
+    int N = args->input->H;         // Sequence length
+    int K = args->input->W;         // Input size
+    int H = args->output->W;        // Hidden size
+
+    rnn_input_projection_fp16(args);
+    pi_cl_team_barrier();
+
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for (int t = 0; t < N; t++) {
+        fp16 *hp = t > 0 ? Y + (t - 1) * H : h0;
+        fp16 *gt = gates + t * 4 * H;
+
+        for (int j = start; j < stop; j++) {
+            v2f16 rz = vsigmoid_fp16((v2f16) {gt[j] + rnn_recurrent_fp16(W, j, hp, K, H),
+                                              gt[H + j] + rnn_recurrent_fp16(W, H + j, hp, K, H)});
+            // The reset gate scales the recurrent part of the candidate gate only
+            fp16 an = gt[2 * H + j];
+            fp16 hn = rnn_recurrent_fp16(W, 2 * H + j, hp, K, H) + (bias != NULL ? bias[3 * H + j] : (fp16) 0);
+            fp16 n = vtanh_fp16((v2f16) {an + rz[0] * hn, an + rz[0] * hn})[0];
+
+            gt[j] = rz[0];
+            gt[H + j] = rz[1];
+            gt[2 * H + j] = n;
+            gt[3 * H + j] = hn;
+            Y[t * H + j] = n + (hp != NULL ? rz[1] * (hp[j] - n) : -rz[1] * n);
+        }
+        // h_t is read by all the cores at the next timestep
+        pi_cl_team_barrier();
+    }
+
+    if (args->carry_state)
+        rnn_carry_state_fp16(args, Y + (N - 1) * H, NULL, start, stop);
+}
+
+
+void gru_bw_fp16(void *Gated_rnn_args_fp16) {
+    struct Gated_rnn_args_fp16 *args = (struct Gated_rnn_args_fp16 *) Gated_rnn_args_fp16;
+    fp16 *W = args->coeff->data;
+    fp16 *Y = args->output->data;
+    fp16 *dY = args->output->diff;
+    fp16 *h0 = rnn_initial_state_fp16(args, 0);
+    fp16 *dA = args->gates;             // Gate activations, replaced by the gradients of the pre-activations
+    fp16 *dh = args->grad_buffer;       // Gradient flowing into h_t from the next timestep
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+
+    //  Pairs of hidden units, owned by the same core in both phases so that dh needs no synchronization
+    const int blockSize = ((H + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+    const v2f16 one = (v2f16) {1.0f, 1.0f};
+
+    for (int j = start; j < stop; j += 2)
+        *((v2f16 *) &dh[j]) = (v2f16) {0, 0};
+
+    for (int t = N - 1; t >= 0; t--) {
+        fp16 *gt = dA + t * 4 * H;
+        fp16 *hp = t > 0 ? Y + (t - 1) * H : h0;
+
+        for (int j = start; j < stop; j += 2) {
+            v2f16 r = *((v2f16 *) &gt[j]);
+            v2f16 z = *((v2f16 *) &gt[H + j]);
+            v2f16 n = *((v2f16 *) &gt[2 * H + j]);
+            v2f16 hn = *((v2f16 *) &gt[3 * H + j]);
+            v2f16 hpj = hp != NULL ? *((v2f16 *) &hp[j]) : (v2f16) {0, 0};
+            v2f16 dhj = *((v2f16 *) &dh[j]) + *((v2f16 *) &dY[t * H + j]);
+            v2f16 dan = dhj * (one - z) * (one - n * n);
+
+            *((v2f16 *) &gt[j]) = dan * hn * r * (one - r);
+            *((v2f16 *) &gt[H + j]) = dhj * (hpj - n) * z * (one - z);
+            *((v2f16 *) &gt[2 * H + j]) = dan;
+            *((v2f16 *) &gt[3 * H + j]) = dan * r;     // Gradient of U_n * h_t-1 + b_hn
+            *((v2f16 *) &dh[j]) = dhj * z;              // Direct path h_t-1 -> h_t
+        }
+        pi_cl_team_barrier();
+
+        //  dh_t-1 += W_h^T * dA_t, the candidate rows taking the gradient of their recurrent part
+        for (int k = start; k < stop; k += 2) {
+            v2f16 acc = *((v2f16 *) &dh[k]);
+            for (int q = 0; q < 2 * H; q++)
+                acc += *((v2f16 *) &W[q * KH + K + k]) * (v2f16) {gt[q], gt[q]};
+            for (int q = 0; q < H; q++)
+                acc += *((v2f16 *) &W[(2 * H + q) * KH + K + k]) * (v2f16) {gt[3 * H + q], gt[3 * H + q]};
+            *((v2f16 *) &dh[k]) = acc;
+        }
+    }
+
+    if (args->state != NULL && args->state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->state->diff[j] = dh[j];
+}
+
+
+void gated_rnn_grad_fp16(void *Gated_rnn_args_fp16) {
+    struct Gated_rnn_args_fp16 *args = (struct Gated_rnn_args_fp16 *) Gated_rnn_args_fp16;
+    fp16 *W = args->coeff->data;
+    fp16 *dW = args->coeff->diff;
+    fp16 *db = args->bias != NULL ? args->bias->diff : NULL;
+    fp16 *X = args->input->data;
+    fp16 *dX = args->input->diff;
+    fp16 *Y = args->output->data;
+    fp16 *h0 = rnn_initial_state_fp16(args, 0);
+    fp16 *dA = args->gates;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+    int G = args->coeff->H / H;     // 4 for the LSTM, 3 for the GRU
+    int gru = G == 3;
+
+    //  dW = dA^T * [X | H_prev], db = sum over the timesteps of dA, parallel on the rows of W
+    int blockSize = (G * H + NUM_CORES - 1) / NUM_CORES;
+    int start = pi_core_id() * blockSize;
+    int stop = start + blockSize > G * H ? G * H : start + blockSize;
+
+    for (int r = start; r < stop; r++) {
+        //  The recurrent part of the GRU candidate rows has its own gradient
+        int rh = gru && r >= 2 * H ? r + H : r;
+        fp16 *dw = dW + r * KH;
+
+        for (int k = 0; k < KH; k += 2)
+            *((v2f16 *) &dw[k]) = (v2f16) {0, 0};
+        fp16 sum = 0, sum_h = 0;
+        for (int t = 0; t < N; t++) {
+            fp16 da = dA[t * 4 * H + r];
+            fp16 da_h = dA[t * 4 * H + rh];
+            v2f16 vda = (v2f16) {da, da};
+            v2f16 vda_h = (v2f16) {da_h, da_h};
+            fp16 *x = X + t * K;
+            fp16 *hp = t > 0 ? Y + (t - 1) * H : h0;
+            for (int k = 0; k < K; k += 2)
+                *((v2f16 *) &dw[k]) += vda * *((v2f16 *) &x[k]);
+            if (hp != NULL)
+                for (int k = 0; k < H; k += 2)
+                    *((v2f16 *) &dw[K + k]) += vda_h * *((v2f16 *) &hp[k]);
+            sum += da;
+            sum_h += da_h;
+        }
+        if (db != NULL) {
+            db[r] = sum;
+            if (rh != r) db[rh] = sum_h;
+        }
+    }
+
+    //  dX = dA * W_x, parallel on the pairs of inputs
+    int dim = N * K;
+    blockSize = ((dim + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    start = pi_core_id() * blockSize;
+    stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int idx = start; idx < stop; idx += 2) {
+        int t = idx / K;
+        int k = idx - t * K;
+        v2f16 acc = (v2f16) {0, 0};
+        for (int r = 0; r < G * H; r++)
+            acc += (v2f16) {dA[t * 4 * H + r], dA[t * 4 * H + r]} * *((v2f16 *) &W[r * KH + k]);
+        *((v2f16 *) &dX[idx]) = acc;
+    }
+}
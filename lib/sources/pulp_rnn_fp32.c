@@ -13,345 +13,548 @@
 #include "pulp_matmul_fp32.h"
 #include "pulp_train_utils_fp32.h"
 #include "pulp_act_fp32.h"
+#include <math.h>
 
 
 //FORWARD
 void pulp_rnn_fp32_fw_cl(void *Rnn_args) {
     struct Rnn_args *rnn_args = (struct Rnn_args *) Rnn_args;
-    float *coeffDataWx = rnn_args->coeff_x->data; // Input Weights
-    float *coeffDataWs = rnn_args->coeff_s->data; // State Weights
-    float *outData = rnn_args->output->data;
-    float *inputData = rnn_args->input->data;
-    float *stateData = rnn_args->state->data;
 
-    int N = rnn_args->input->H; // Input/Output Sequence length
-    int K = rnn_args->input->W; // Input Sequence element length
-    int M = rnn_args->output->W; // Output Sequence element length
-
-    //matmul setup 1
+    // Input projection of all the timesteps, hoisted out of the recurrence: Y = X * Wx
     struct matMul_args matMul_args1;
-    matMul_args1.A = inputData;
-    matMul_args1.B = coeffDataWx;
-    matMul_args1.C = outData;
-    matMul_args1.N = N;
-    matMul_args1.K = K;
-    matMul_args1.M = M;
+    matMul_args1.A = rnn_args->input->data;
+    matMul_args1.B = rnn_args->coeff_x->data;
+    matMul_args1.C = rnn_args->output->data;
+    matMul_args1.N = rnn_args->input->H;
+    matMul_args1.K = rnn_args->input->W;
+    matMul_args1.M = rnn_args->output->W;
     matMul_args1.trans_B = 0;
 
-#ifdef DEBUG
-    printf("\ninputData: %d %d\n", N, K);
-    for (int j=0; j<K; j++){
-        printf("%4.2e ", matMul_args1.A[j]);
-    }
-    printf("\n");
-
-    printf("\nWx: %d %d\n", K, M);
-    for (int j=0; j<K*M; j++){
-        if(!(j%(M))) printf("\n");
-        printf("%4.2e ",  matMul_args1.B[j]);
-    }
-    printf("\n");
-#endif
-
     pi_cl_team_fork(NUM_CORES, mm, &matMul_args1);
 
-
-#ifdef DEBUG
-    printf("\noutData: %d %d\n", N, M);
-    for (int j=0; j<N*M; j++){
-        printf("%4.2e ", matMul_args1.C[j]);
-    }
-    printf("\n");
-#endif
+    // Recurrence: h_t = tanh(Y_t + h_t-1 * Ws)
+    pi_cl_team_fork(NUM_CORES, rnn_fw_fp32, Rnn_args);
+}
 
 
-    //matmul setup 2
-    struct matMul_args matMul_args2;
-    matMul_args2.A = stateData;
-    matMul_args2.B = coeffDataWs;
-    matMul_args2.C = outData;
-    matMul_args2.N = N;
-    matMul_args2.K = M;
-    matMul_args2.M = M;
-    matMul_args2.trans_B = 0;
+//BACKWARD
+void pulp_rnn_fp32_bw_cl(void *Rnn_args) {
+    struct Rnn_args *rnn_args = (struct Rnn_args *) Rnn_args;
 
+    // Gradients of the pre-activations through time, then the weight gradients
+    pi_cl_team_fork(NUM_CORES, rnn_bw_fp32, Rnn_args);
+    pi_cl_team_fork(NUM_CORES, rnn_grad_fp32, Rnn_args);
 
-#ifdef DEBUG
-    printf("\nprev_state: %d %d\n", N, M);
-    for (int j=0; j<M; j++){
-        printf("%4.2e ", matMul_args2.A[j]);
-    }
-    printf("\n");
+    // Input gradient: dX = dA * Wx^T
+    struct matMul_args matMul_args1;
+    matMul_args1.A = rnn_args->grad_buffer;
+    matMul_args1.B = rnn_args->coeff_x->data;
+    matMul_args1.C = rnn_args->input->diff;
+    matMul_args1.N = rnn_args->input->H;
+    matMul_args1.K = rnn_args->output->W;
+    matMul_args1.M = rnn_args->input->W;
+    matMul_args1.trans_B = 1;
 
-    printf("\nWs: %d %d\n", M, M);
-    for (int j=0; j<M*M; j++){
-        if(!(j%(M))) printf("\n");
-        printf("%4.2e ",  matMul_args2.B[j]);
-    }
-    printf("\n");
-#endif
+    pi_cl_team_fork(NUM_CORES, mm, &matMul_args1);
+}
 
 
-    pi_cl_team_fork(NUM_CORES, mm_add, &matMul_args2);
+//  Hidden state before the first timestep of the window (NULL for a zero state)
+static inline float *rnn_h0_fp32(struct Rnn_args *args) {
+    if (args->carry_state)
+        return args->prev_state;
+    return args->state != NULL ? args->state->data : NULL;
+}
 
 
-#ifdef DEBUG
-    printf("\noutData: %d %d\n", N, M);
-    for (int j=0; j<N*M; j++){
-        printf("%4.2e ", matMul_args2.C[j]);
+void rnn_fw_fp32(void *Rnn_args) {
+    struct Rnn_args *args = (struct Rnn_args *) Rnn_args;
+    float *Ws = args->coeff_s->data;
+    float *Y = args->output->data;
+    float *h0 = args->state != NULL ? args->state->data : NULL;
+
+    int N = args->input->H;         // Sequence length
+    int M = args->output->W;        // Hidden size
+
+    const int blockSize = (M + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > M ? M : start + blockSize;
+
+    for (int t = 0; t < N; t++) {
+        float *hp = t > 0 ? Y + (t - 1) * M : h0;
+        for (int j = start; j < stop; j++) {
+            float acc = Y[t * M + j];
+            if (hp != NULL)
+                for (int k = 0; k < M; k++)
+                    acc += hp[k] * Ws[k * M + j];
+            Y[t * M + j] = tanhf(acc);
+        }
+        // h_t is read by all the cores at the next timestep
+        pi_cl_team_barrier();
     }
-    printf("\n");
-#endif
 
-    struct tanh_args tanh_arg;
-    tanh_arg.input = matMul_args2.C;
-    tanh_arg.dim = N * M;
-    tanh_arg.output = matMul_args2.C;
-
-    pi_cl_team_fork(NUM_CORES, tanh_prll, &tanh_arg);
+    // Saves the initial state of the window for the backward and leaves the last one for the next window
+    if (args->carry_state)
+        for (int j = start; j < stop; j++) {
+            args->prev_state[j] = h0[j];
+            h0[j] = Y[(N - 1) * M + j];
+        }
+}
 
 
-#ifdef DEBUG
-    printf("\nLinear OutData: %d %d\n", N, M);
-    for (int j=0; j<N*M; j++){
-        printf("%4.2e ", matMul_args2.C[j]);
+void rnn_bw_fp32(void *Rnn_args) {
+    struct Rnn_args *args = (struct Rnn_args *) Rnn_args;
+    float *Ws = args->coeff_s->data;
+    float *Y = args->output->data;
+    float *dY = args->output->diff;
+    float *dA = args->grad_buffer;      // Gradients of the pre-activations, can alias output->diff
+    float *dh = args->temp_buffer;      // Gradient flowing into h_t from the next timestep
+
+    int N = args->input->H;
+    int M = args->output->W;
+
+    //  The same hidden units are owned by the same core in both phases, so dh needs no synchronization
+    const int blockSize = (M + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > M ? M : start + blockSize;
+
+    for (int j = start; j < stop; j++)
+        dh[j] = 0;
+
+    for (int t = N - 1; t >= 0; t--) {
+        float *da = dA + t * M;
+        for (int j = start; j < stop; j++) {
+            float y = Y[t * M + j];
+            da[j] = (dY[t * M + j] + dh[j]) * (1.0f - y * y);
+        }
+        pi_cl_team_barrier();
+
+        //  dh_t-1 = dA_t * Ws^T
+        for (int k = start; k < stop; k++) {
+            float acc = 0;
+            for (int j = 0; j < M; j++)
+                acc += Ws[k * M + j] * da[j];
+            dh[k] = acc;
+        }
     }
-#endif
 
-    /*
-    if(i != ((rnn_args->input->H)-1)){
-        for(int j=0; j<M; j++)
-            stateData[(i+1)*M+j]=matMul_args2.C[j];
-    }
-    else{
-        for(int j=0; j<M; j++)
-            stateData[j]=matMul_args2.C[j];
-    }
-    */
+    if (args->state != NULL && args->state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->state->diff[j] = dh[j];
 }
 
 
-//BACKWARD
-void pulp_rnn_fp32_bw_cl(void *Rnn_args) {
-    struct Rnn_args *rnn_args = (struct Rnn_args *) Rnn_args;
-
-    float *coeffDataWx = rnn_args->coeff_x->data;
-    float *coeffDataWs = rnn_args->coeff_s->data;
-    float *inData = rnn_args->input->data;
-    float *temp = rnn_args->temp_buffer; // Temporary buffer to save transposed matrices
-    float *outData = rnn_args->output->data;
-    float *coeffDiffWx = rnn_args->coeff_x->diff;
-    float *coeffDiffWs = rnn_args->coeff_s->diff;
-
-    float *outDiff = rnn_args->output->diff;
-
-    float *inDiff = rnn_args->input->diff;
-    float *hiddState = rnn_args->state->data;
-    float *hiddStateDiff = rnn_args->state->diff;
-    float *grad = rnn_args->grad_buffer; // Buffer that saves output gradients for tanh
-
-    int total_dim = rnn_args->output->dim;
-    int N = rnn_args->input->H; // Input sequence length
-    int K = rnn_args->input->W; // Input sequence element size
-    int M = rnn_args->output->W; // Output sequence element size
-
-
-
-#ifdef DEBUG
-    printf("\nHIDDEN STATES\n");
-    for(int i=0; i<(total_dim); i++){
-    if(!(i%M)) printf("\n");
-      printf("%4.2e  ",hiddState[i]);
+void rnn_grad_fp32(void *Rnn_args) {
+    struct Rnn_args *args = (struct Rnn_args *) Rnn_args;
+    float *dWx = args->coeff_x->diff;
+    float *dWs = args->coeff_s->diff;
+    float *X = args->input->data;
+    float *Y = args->output->data;
+    float *h0 = rnn_h0_fp32(args);
+    float *dA = args->grad_buffer;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int M = args->output->W;
+
+    //  dWx = X^T * dA, dWs = H_prev^T * dA, parallel on the K + M rows of the two weights
+    const int rows = K + M;
+    const int blockSize = (rows + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > rows ? rows : start + blockSize;
+
+    for (int r = start; r < stop; r++) {
+        float *dw = r < K ? dWx + r * M : dWs + (r - K) * M;
+        for (int j = 0; j < M; j++)
+            dw[j] = 0;
+        for (int t = 0; t < N; t++) {
+            float v;
+            if (r < K)
+                v = X[t * K + r];
+            else if (t > 0)
+                v = Y[(t - 1) * M + r - K];
+            else if (h0 != NULL)
+                v = h0[r - K];
+            else
+                continue;
+            float *da = dA + t * M;
+            for (int j = 0; j < M; j++)
+                dw[j] += v * da[j];
+        }
     }
-    printf("\n");
+}
 
-    printf("\noutData\n");
-    for(int i=0; i<total_dim; i++){
-    if(!(i%M)) printf("\n");
-      printf("%4.2e  ",outData[i]);
-    }
-    printf("\n");
 
-    printf("\nLinear outDiff\n");
-    for(int i=0; i<total_dim; i++){
-    if(!(i%M)) printf("\n");
-      printf("%4.2e  ",outDiff[i]);
-    }
-    printf("\n");
-#endif
 
-    for (int i = 0; i < total_dim; i++)
-        grad[i] = (1 - (outData[i] * outData[i])) * outDiff[i]; // Taylor series expansion for derivative(tanh)
+// GATED RECURRENT LAYERS (LSTM, GRU)
+void pulp_lstm_fp32_fw_cl(void *Gated_rnn_args) {
+    pi_cl_team_fork(NUM_CORES, lstm_fw_fp32, Gated_rnn_args);
+}
 
 
-    // Calculate gradient for Input Weights
+void pulp_lstm_fp32_bw_cl(void *Gated_rnn_args) {
+    pi_cl_team_fork(NUM_CORES, lstm_bw_fp32, Gated_rnn_args);
+    pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp32, Gated_rnn_args);
+}
 
-    // Transpose Input
-    int dims[] = {N, K};
-    int t_axes[] = {1, 0};
 
-    struct transp_args transp_args1;
+void pulp_gru_fp32_fw_cl(void *Gated_rnn_args) {
+    pi_cl_team_fork(NUM_CORES, gru_fw_fp32, Gated_rnn_args);
+}
 
-    transp_args1.in_matrix = inData;
-    transp_args1.out_matrix = temp;
-    transp_args1.dim = dims;
-    transp_args1.transposed_axes = t_axes;
-    transp_args1.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args1);
+void pulp_gru_fp32_bw_cl(void *Gated_rnn_args) {
+    pi_cl_team_fork(NUM_CORES, gru_bw_fp32, Gated_rnn_args);
+    pi_cl_team_fork(NUM_CORES, gated_rnn_grad_fp32, Gated_rnn_args);
+}
 
 
-    // matmul setup 1
-    struct matMul_args matMul_args1;
-    matMul_args1.A = temp;
-    matMul_args1.B = grad;
-    matMul_args1.C = coeffDiffWx;
-    matMul_args1.N = K;
-    matMul_args1.K = N;
-    matMul_args1.M = M;
-    matMul_args1.trans_B = 0;
-
+static inline float rnn_sigmoid_fp32(float x) {
+    return 1.0f / (1.0f + expf(-x));
+}
 
-#ifdef DEBUG
-    printf("\ngrad \n");
-    for (int i=0; i<total_dim; i++){
-        if(!(i%M)) printf("\n");
-        printf("%4.2e  ", grad[i]);
-    }
-    printf("\n");
 
-    printf("\nTransposed input sequence\n");
-    for (int i=0; i<N*K; i++){
-        if(!(i%N)) printf("\n");
-        printf("%4.2e  ", matMul_args1.A[i]);
-    }
-    printf("\n");
-#endif
+//  Hidden state before the first timestep of the window: saved by the forward when the state is carried between windows
+static inline float *rnn_initial_state_fp32(struct Gated_rnn_args *args, int cell) {
+    if (args->carry_state)
+        return args->prev_state + cell * args->output->W;
+    struct blob *state = cell ? args->cell_state : args->state;
+    return state != NULL ? state->data : NULL;
+}
 
 
-    pi_cl_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args1);
+//  Input projection of all the timesteps, hoisted out of the recurrence: gates[t] = W_x * x_t + b, parallel on the N x G*H elements
+static inline void rnn_input_projection_fp32(struct Gated_rnn_args *args) {
+    float *W = args->coeff->data;
+    float *bias = args->bias != NULL ? args->bias->data : NULL;
+    float *X = args->input->data;
+    float *gates = args->gates;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+    int GH = args->coeff->H;
+
+    const int dim = N * GH;
+    const int blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int idx = start; idx < stop; idx++) {
+        int t = idx / GH;
+        int r = idx - t * GH;
+        float *w = W + r * KH;
+        float *x = X + t * K;
+        float acc = bias != NULL ? bias[r] : 0.0f;
+        for (int k = 0; k < K; k++)
+            acc += w[k] * x[k];
+        gates[t * 4 * H + r] = acc;
+    }
+}
 
 
-#ifdef DEBUG
-    printf("\nLinear coeffDiffWx");
-    for (int i=0; i<K*M; i++){
-      if(!(i%M)) printf("\n");
-      printf("%4.2e (i=%d)", matMul_args1.C[i], i);
+//  Recurrent part of the gate row r: W_h * h (h = NULL for a zero state)
+static inline float rnn_recurrent_fp32(float *W, int r, float *h, int K, int H) {
+    float acc = 0;
+    if (h != NULL) {
+        float *w = W + r * (K + H) + K;
+        for (int k = 0; k < H; k++)
+            acc += w[k] * h[k];
     }
-    printf("\n");
-#endif
-
+    return acc;
+}
 
-    // Calculate gradient for State Weights
-    // Transpose State
-    int dims[] = {N, M};
-    int t_axes[] = {1, 0};
 
-    struct transp_args transp_args2;
+//  Saves the initial state of the window for the backward and leaves the last one for the next window
+static inline void rnn_carry_state_fp32(struct Gated_rnn_args *args, float *last_h, float *last_c, int start, int stop) {
+    int H = args->output->W;
+    for (int j = start; j < stop; j++) {
+        args->prev_state[j] = args->state->data[j];
+        args->state->data[j] = last_h[j];
+        if (last_c != NULL) {
+            args->prev_state[H + j] = args->cell_state->data[j];
+            args->cell_state->data[j] = last_c[j];
+        }
+    }
+}
 
-    transp_args2.matrix = hiddState;
-    transp_args2.transp_matrix = temp;
-    transp_args2.dim = dims;
-    transp_args2.transposed_axes = t_axes;
-    transp_args2.n_dim = 2;
 
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args2);
+void lstm_fw_fp32(void *Gated_rnn_args) {
+    struct Gated_rnn_args *args = (struct Gated_rnn_args *) Gated_rnn_args;
+    float *W = args->coeff->data;
+    float *Y = args->output->data;
+    float *h0 = args->state != NULL ? args->state->data : NULL;
+    float *c0 = args->cell_state != NULL ? args->cell_state->data : NULL;
+    float *gates = args->gates;
+    float *cells = args->cells;
+
+    int N = args->input->H;         // Sequence length
+    int K = args->input->W;         // Input size
+    int H = args->output->W;        // Hidden size
+
+    rnn_input_projection_fp32(args);
+    pi_cl_team_barrier();
+
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for (int t = 0; t < N; t++) {
+        float *hp = t > 0 ? Y + (t - 1) * H : h0;
+        float *cp = t > 0 ? cells + (t - 1) * H : c0;
+        float *gt = gates + t * 4 * H;
+
+        for (int j = start; j < stop; j++) {
+            // Only the recurrent matmul is left in the loop, the activations and the state update in its epilogue
+            float i = rnn_sigmoid_fp32(gt[j] + rnn_recurrent_fp32(W, j, hp, K, H));
+            float f = rnn_sigmoid_fp32(gt[H + j] + rnn_recurrent_fp32(W, H + j, hp, K, H));
+            float g = tanhf(gt[2 * H + j] + rnn_recurrent_fp32(W, 2 * H + j, hp, K, H));
+            float o = rnn_sigmoid_fp32(gt[3 * H + j] + rnn_recurrent_fp32(W, 3 * H + j, hp, K, H));
+
+            float c = i * g + (cp != NULL ? f * cp[j] : 0.0f);
+            gt[j] = i;
+            gt[H + j] = f;
+            gt[2 * H + j] = g;
+            gt[3 * H + j] = o;
+            cells[t * H + j] = c;
+            Y[t * H + j] = o * tanhf(c);
+        }
+        // h_t is read by all the cores at the next timestep
+        pi_cl_team_barrier();
+    }
 
+    if (args->carry_state)
+        rnn_carry_state_fp32(args, Y + (N - 1) * H, cells + (N - 1) * H, start, stop);
+}
 
-    // matmul setup 2
-    struct matMul_args matMul_args2;
-    matMul_args2.A = temp;
-    matMul_args2.B = grad;
-    matMul_args2.C = coeffDiffWs;
-    matMul_args2.N = M;
-    matMul_args2.K = N;
-    matMul_args2.M = M;
-    matMul_args2.trans_B = 0;
 
-    pi_cl_team_fork(NUM_CORES, mm_unroll_4x1, &matMul_args2);
+void lstm_bw_fp32(void *Gated_rnn_args) {
+    struct Gated_rnn_args *args = (struct Gated_rnn_args *) Gated_rnn_args;
+    float *W = args->coeff->data;
+    float *dY = args->output->diff;
+    float *c0 = rnn_initial_state_fp32(args, 1);
+    float *dA = args->gates;            // Gate activations, replaced by the gradients of the pre-activations
+    float *cells = args->cells;
 
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
 
-#ifdef DEBUG
-    printf("\nLinear coeffDiffWs");
-    for (int i=0; i<M*M; i++){
-      if(!(i%M)) printf("\n");
-      printf("%4.2e (i=%d)", matMul_args2.C[i], i);
-    }
-    printf("\n");
-#endif
+    float *dh = args->grad_buffer;      // Gradient flowing into h_t from the next timestep
+    float *dc = args->grad_buffer + H;  // Gradient flowing into c_t from the next timestep
 
+    //  The same hidden units are owned by the same core in both phases, so dh and dc need no synchronization
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
 
-#ifdef DEBUG
-    printf("\ngrad \n");
-    for (int i=0; i<total_dim; i++){
-        if(!(i%M)) printf("\n");
-        printf("%4.2e  ", matMul_args2.B[i]);
+    for (int j = start; j < stop; j++) {
+        dh[j] = 0;
+        dc[j] = 0;
     }
-    printf("\n");
 
-    printf("\nTransposed hidden state\n");
-    for (int i=0; i<total_dim; i++){
-        if(!(i%N)) printf("\n");
-        printf("%4.2e  ",matMul_args2.A[i]);
+    for (int t = N - 1; t >= 0; t--) {
+        float *gt = dA + t * 4 * H;
+        float *cp = t > 0 ? cells + (t - 1) * H : c0;
+
+        for (int j = start; j < stop; j++) {
+            float i = gt[j], f = gt[H + j], g = gt[2 * H + j], o = gt[3 * H + j];
+            float tc = tanhf(cells[t * H + j]);
+            float dhj = dh[j] + dY[t * H + j];
+            float dcj = dc[j] + dhj * o * (1.0f - tc * tc);
+
+            gt[j] = dcj * g * i * (1.0f - i);
+            gt[H + j] = cp != NULL ? dcj * cp[j] * f * (1.0f - f) : 0.0f;
+            gt[2 * H + j] = dcj * i * (1.0f - g * g);
+            gt[3 * H + j] = dhj * tc * o * (1.0f - o);
+            dc[j] = dcj * f;
+        }
+        pi_cl_team_barrier();
+
+        //  dh_t-1 = W_h^T * dA_t
+        for (int k = start; k < stop; k++) {
+            float acc = 0;
+            for (int r = 0; r < 4 * H; r++)
+                acc += W[r * KH + K + k] * gt[r];
+            dh[k] = acc;
+        }
     }
-    printf("\n");
-
-#endif
 
+    if (args->state != NULL && args->state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->state->diff[j] = dh[j];
+    if (args->cell_state != NULL && args->cell_state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->cell_state->diff[j] = dc[j];
+}
 
-    // Calculate the Gradient of the Input
-    // Transpose Input Weights
-    dims = {K, M};
-
-    struct transp_args transp_args3;
-
-    transp_args3.in_matrix = coeffDataWx;
-    transp_args3.out_matrix = temp;
-    transp_args3.dim = dims;
-    transp_args3.transposed_axes = t_axes;
-    transp_args3.n_dim = 2;
-
-    pi_cl_team_fork(NUM_CORES, transpose, &transp_args3);
 
+void gru_fw_fp32(void *Gated_rnn_args) {
+    struct Gated_rnn_args *args = (struct Gated_rnn_args *) Gated_rnn_args;
+    float *W = args->coeff->data;
+    float *bias = args->bias != NULL ? args->bias->data : NULL;
+    float *Y = args->output->data;
+    float *h0 = args->state != NULL ? args->state->data : NULL;
+    float *gates = args->gates;
+
+    int N = args->input->H;         // Sequence length
+    int K = args->input->W;         // Input size
+    int H = args->output->W;        // Hidden size
+
+    rnn_input_projection_fp32(args);
+    pi_cl_team_barrier();
+
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for (int t = 0; t < N; t++) {
+        float *hp = t > 0 ? Y + (t - 1) * H : h0;
+        float *gt = gates + t * 4 * H;
+
+        for (int j = start; j < stop; j++) {
+            float r = rnn_sigmoid_fp32(gt[j] + rnn_recurrent_fp32(W, j, hp, K, H));
+            float z = rnn_sigmoid_fp32(gt[H + j] + rnn_recurrent_fp32(W, H + j, hp, K, H));
+            // The reset gate scales the recurrent part of the candidate gate only
+            float hn = rnn_recurrent_fp32(W, 2 * H + j, hp, K, H) + (bias != NULL ? bias[3 * H + j] : 0.0f);
+            float n = tanhf(gt[2 * H + j] + r * hn);
+
+            gt[j] = r;
+            gt[H + j] = z;
+            gt[2 * H + j] = n;
+            gt[3 * H + j] = hn;
+            Y[t * H + j] = (1.0f - z) * n + (hp != NULL ? z * hp[j] : 0.0f);
+        }
+        // h_t is read by all the cores at the next timestep
+        pi_cl_team_barrier();
+    }
 
-    // matmul setup 3
-    struct matMul_args matMul_args3;
-    matMul_args3.A = grad;
-    matMul_args3.B = temp;
-    matMul_args3.C = inDiff;
-    matMul_args3.N = N;
-    matMul_args3.K = M;
-    matMul_args3.M = K;
-    matMul_args3.trans_B = 0;
+    if (args->carry_state)
+        rnn_carry_state_fp32(args, Y + (N - 1) * H, NULL, start, stop);
+}
 
 
-    pi_cl_team_fork(NUM_CORES, mm_M_unroll_4x1, &matMul_args3);
+void gru_bw_fp32(void *Gated_rnn_args) {
+    struct Gated_rnn_args *args = (struct Gated_rnn_args *) Gated_rnn_args;
+    float *W = args->coeff->data;
+    float *Y = args->output->data;
+    float *dY = args->output->diff;
+    float *h0 = rnn_initial_state_fp32(args, 0);
+    float *dA = args->gates;            // Gate activations, replaced by the gradients of the pre-activations
+    float *dh = args->grad_buffer;      // Gradient flowing into h_t from the next timestep
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+
+    //  The same hidden units are owned by the same core in both phases, so dh needs no synchronization
+    const int blockSize = (H + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > H ? H : start + blockSize;
+
+    for (int j = start; j < stop; j++)
+        dh[j] = 0;
+
+    for (int t = N - 1; t >= 0; t--) {
+        float *gt = dA + t * 4 * H;
+        float *hp = t > 0 ? Y + (t - 1) * H : h0;
+
+        for (int j = start; j < stop; j++) {
+            float r = gt[j], z = gt[H + j], n = gt[2 * H + j], hn = gt[3 * H + j];
+            float hpj = hp != NULL ? hp[j] : 0.0f;
+            float dhj = dh[j] + dY[t * H + j];
+            float dan = dhj * (1.0f - z) * (1.0f - n * n);
+
+            gt[j] = dan * hn * r * (1.0f - r);
+            gt[H + j] = dhj * (hpj - n) * z * (1.0f - z);
+            gt[2 * H + j] = dan;
+            gt[3 * H + j] = dan * r;            // Gradient of U_n * h_t-1 + b_hn
+            dh[j] = dhj * z;                    // Direct path h_t-1 -> h_t
+        }
+        pi_cl_team_barrier();
+
+        //  dh_t-1 += W_h^T * dA_t, the candidate rows taking the gradient of their recurrent part
+        for (int k = start; k < stop; k++) {
+            float acc = dh[k];
+            for (int q = 0; q < 2 * H; q++)
+                acc += W[q * KH + K + k] * gt[q];
+            for (int q = 0; q < H; q++)
+                acc += W[(2 * H + q) * KH + K + k] * gt[3 * H + q];
+            dh[k] = acc;
+        }
+    }
 
+    if (args->state != NULL && args->state->diff != NULL)
+        for (int j = start; j < stop; j++)
+            args->state->diff[j] = dh[j];
+}
 
-#ifdef DEBUG
-    printf("\noutputDiff\n");
-    for (int i=0; i<total_dim; i++){
-        if(!(i%M)) printf("\n");
-        printf("%4.2e  ", matMul_args1.A[i]);
-    }
-    printf("\n");
 
-    printf("\nTransposed Wx\n");
-    for (int i=0; i<K*M; i++){
-        if(!(i%K)) printf("\n");
-        printf("%4.2e  ", matMul_args1.B[i]);
+void gated_rnn_grad_fp32(void *Gated_rnn_args) {
+    struct Gated_rnn_args *args = (struct Gated_rnn_args *) Gated_rnn_args;
+    float *W = args->coeff->data;
+    float *dW = args->coeff->diff;
+    float *db = args->bias != NULL ? args->bias->diff : NULL;
+    float *X = args->input->data;
+    float *dX = args->input->diff;
+    float *Y = args->output->data;
+    float *h0 = rnn_initial_state_fp32(args, 0);
+    float *dA = args->gates;
+
+    int N = args->input->H;
+    int K = args->input->W;
+    int H = args->output->W;
+    int KH = K + H;
+    int G = args->coeff->H / H;     // 4 for the LSTM, 3 for the GRU
+    int gru = G == 3;
+
+    //  dW = dA^T * [X | H_prev], db = sum over the timesteps of dA, parallel on the rows of W
+    int blockSize = (G * H + NUM_CORES - 1) / NUM_CORES;
+    int start = pi_core_id() * blockSize;
+    int stop = start + blockSize > G * H ? G * H : start + blockSize;
+
+    for (int r = start; r < stop; r++) {
+        //  The recurrent part of the GRU candidate rows has its own gradient
+        int rh = gru && r >= 2 * H ? r + H : r;
+        float *dw = dW + r * KH;
+
+        for (int k = 0; k < KH; k++)
+            dw[k] = 0;
+        float sum = 0, sum_h = 0;
+        for (int t = 0; t < N; t++) {
+            float da = dA[t * 4 * H + r];
+            float da_h = dA[t * 4 * H + rh];
+            float *x = X + t * K;
+            float *hp = t > 0 ? Y + (t - 1) * H : h0;
+            for (int k = 0; k < K; k++)
+                dw[k] += da * x[k];
+            if (hp != NULL)
+                for (int k = 0; k < H; k++)
+                    dw[K + k] += da_h * hp[k];
+            sum += da;
+            sum_h += da_h;
+        }
+        if (db != NULL) {
+            db[r] = sum;
+            if (rh != r) db[rh] = sum_h;
+        }
     }
-    printf("\n");
 
-    printf("\nInput Gradients\n");
-    for (int i=0; i<N*K; i++){
-        if(!(i%K)) printf("\n");
-        printf("%4.2e  ", matMul_args1.C[i]);
+    //  dX = dA * W_x, parallel on the inputs
+    int dim = N * K;
+    blockSize = (dim + NUM_CORES - 1) / NUM_CORES;
+    start = pi_core_id() * blockSize;
+    stop = start + blockSize > dim ? dim : start + blockSize;
+
+    for (int idx = start; idx < stop; idx++) {
+        int t = idx / K;
+        int k = idx - t * K;
+        float acc = 0;
+        for (int r = 0; r < G * H; r++)
+            acc += dA[t * 4 * H + r] * W[r * KH + k];
+        dX[idx] = acc;
     }
-    printf("\n");
-#endif
 }
-  
-
-
-
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train_utils_fp16.h"
+#include "pulp_rope_fp16.h"
+#include <math.h>
+
+
+void pulp_rope_fp16_tables_cl(void *Rope_args){
+    pi_cl_team_fork(NUM_CORES, rope_tables_fp16, Rope_args);
+}
+
+void pulp_rope_fp16_fw_cl(void *Rope_args){
+    struct Rope_args_fp16 *args = (struct Rope_args_fp16 *) Rope_args;
+
+    struct rope_rotate_args_fp16 rot_args;
+    rot_args.x = args->input->data;
+    rot_args.cos = args->cos;
+    rot_args.sin = args->sin;
+    rot_args.F = args->input->H;
+    rot_args.L = args->input->W;
+    rot_args.H = args->input->H / args->n_heads;
+    rot_args.inverse = 0;
+
+    pi_cl_team_fork(NUM_CORES, rope_rotate_fp16, &rot_args);
+}
+
+void pulp_rope_fp16_bw_cl(void *Rope_args){
+    struct Rope_args_fp16 *args = (struct Rope_args_fp16 *) Rope_args;
+
+    //  The rotation is orthogonal: its transpose is the rotation by the opposite angle
+    struct rope_rotate_args_fp16 rot_args;
+    rot_args.x = args->input->diff;
+    rot_args.cos = args->cos;
+    rot_args.sin = args->sin;
+    rot_args.F = args->input->H;
+    rot_args.L = args->input->W;
+    rot_args.H = args->input->H / args->n_heads;
+    rot_args.inverse = 1;
+
+    pi_cl_team_fork(NUM_CORES, rope_rotate_fp16, &rot_args);
+}
+
+void rope_tables_fp16(void *Rope_args){
+    struct Rope_args_fp16 *args = (struct Rope_args_fp16 *) Rope_args;
+    fp16 *cos = args->cos;
+    fp16 *sin = args->sin;
+    int L = args->input->W;
+    int H = args->input->H / args->n_heads;
+    int n_freq = H / 2;
+
+    const int blockSize = (n_freq + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_freq ? n_freq : start + blockSize;
+
+    for(int j = start; j < stop; j++){
+        float theta = powf(args->base, -2.0f * j / H);
+        for(int t = 0; t < L; t++){
+            //  t * theta does not fit the FP16 mantissa, reduce it before the CORDIC
+            float angle = t * theta;
+            angle -= ((int) (angle / (2 * M_PI))) * (2 * M_PI);
+            cordic_cos_sin_fp16((fp16) angle, &cos[j * L + t], &sin[j * L + t]);
+        }
+    }
+}
+
+void rope_rotate_fp16(void *rope_rotate_args){
+    struct rope_rotate_args_fp16 *args = (struct rope_rotate_args_fp16 *) rope_rotate_args;
+    fp16 *x = args->x;
+    fp16 *cos = args->cos;
+    fp16 *sin = args->sin;
+    int L = args->L;
+    int n_freq = args->H / 2;
+    int n_pairs = args->F / 2;
+    fp16 sign = args->inverse ? -1.0f : 1.0f;
+    v2f16 vsign = (v2f16) {sign, sign};
+
+    const int blockSize = (n_pairs + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start + blockSize;
+
+    //  Two tokens (t, t+1) per iteration
+    for(int p = start; p < stop; p++){
+        fp16 *x0 = x + 2 * p * L;
+        fp16 *x1 = x0 + L;
+        fp16 *c = cos + (p % n_freq) * L;
+        fp16 *s = sin + (p % n_freq) * L;
+        for(int t = 0; t < L; t += 2){
+            v2f16 a = *((v2f16 *) &x0[t]);
+            v2f16 b = *((v2f16 *) &x1[t]);
+            v2f16 ct = *((v2f16 *) &c[t]);
+            v2f16 st = *((v2f16 *) &s[t]) * vsign;
+            *((v2f16 *) &x0[t]) = a * ct - b * st;
+            *((v2f16 *) &x1[t]) = a * st + b * ct;
+        }
+    }
+}
+
+void mm_rope_fp16(void *void_args){
+    struct mm_rope_args_fp16 *rope_args = (struct mm_rope_args_fp16 *) void_args;
+    struct matMul_args_fp16 *args = rope_args->mm_args;
+
+    fp16 *__restrict__ A = args->A;
+    fp16 *__restrict__ B = args->B;
+    fp16 *__restrict__ C = args->C;
+    fp16 *__restrict__ bias = args->bias;
+    fp16 *cos = rope_args->cos;
+    fp16 *sin = rope_args->sin;
+
+    const int N = args->N;
+    const int M = args->M;
+    const int K = args->K;
+    const int n_freq = rope_args->H / 2;
+    const int n_pairs = N / 2;
+
+    const int blockSize = (n_pairs + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start + blockSize;
+
+    //  Rows 2p and 2p+1 are computed together, so that they can be rotated before being stored
+    for(int p = start; p < stop; p++){
+        fp16 *a0 = &A[2 * p * K];
+        fp16 *a1 = a0 + K;
+        fp16 *c = cos + (p % n_freq) * M;
+        fp16 *s = sin + (p % n_freq) * M;
+        fp16 bias0 = args->USE_BIASES ? bias[2 * p] : 0;
+        fp16 bias1 = args->USE_BIASES ? bias[2 * p + 1] : 0;
+
+        for(int j = 0; j < M; j++){
+            fp16 acc0 = bias0;
+            fp16 acc1 = bias1;
+
+            // =====> B NOT TRANSPOSED <=====
+            if(args->trans_B == 0){
+                for(int k = 0; k < K; k++){
+                    acc0 += a0[k] * B[j + k * M];
+                    acc1 += a1[k] * B[j + k * M];
+                }
+            }
+            // =====> B IS TRANSPOSED <=====
+            else{
+                fp16 *b = &B[j * K];
+                int k = 0;
+                // Rows of A and B are contiguous, use SIMD when they are aligned
+                if((K & 0x1) == 0){
+                    v2f16 vacc0 = (v2f16) {0, 0};
+                    v2f16 vacc1 = (v2f16) {0, 0};
+                    for(; k < K; k += 2){
+                        v2f16 vb = *((v2f16 *) &b[k]);
+                        vacc0 += *((v2f16 *) &a0[k]) * vb;
+                        vacc1 += *((v2f16 *) &a1[k]) * vb;
+                    }
+                    acc0 += vacc0[0] + vacc0[1];
+                    acc1 += vacc1[0] + vacc1[1];
+                }
+                for(; k < K; k++){
+                    acc0 += a0[k] * b[k];
+                    acc1 += a1[k] * b[k];
+                }
+            }
+
+            C[2 * p * M + j] = acc0 * c[j] - acc1 * s[j];
+            C[(2 * p + 1) * M + j] = acc0 * s[j] + acc1 * c[j];
+        }
+    }
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train_utils_fp32.h"
+#include "pulp_rope_fp32.h"
+#include <math.h>
+
+
+void pulp_rope_fp32_tables_cl(void *Rope_args){
+    pi_cl_team_fork(NUM_CORES, rope_tables_fp32, Rope_args);
+}
+
+void pulp_rope_fp32_fw_cl(void *Rope_args){
+    struct Rope_args *args = (struct Rope_args *) Rope_args;
+
+    struct rope_rotate_args rot_args;
+    rot_args.x = args->input->data;
+    rot_args.cos = args->cos;
+    rot_args.sin = args->sin;
+    rot_args.F = args->input->H;
+    rot_args.L = args->input->W;
+    rot_args.H = args->input->H / args->n_heads;
+    rot_args.inverse = 0;
+
+    pi_cl_team_fork(NUM_CORES, rope_rotate_fp32, &rot_args);
+}
+
+void pulp_rope_fp32_bw_cl(void *Rope_args){
+    struct Rope_args *args = (struct Rope_args *) Rope_args;
+
+    //  The rotation is orthogonal: its transpose is the rotation by the opposite angle
+    struct rope_rotate_args rot_args;
+    rot_args.x = args->input->diff;
+    rot_args.cos = args->cos;
+    rot_args.sin = args->sin;
+    rot_args.F = args->input->H;
+    rot_args.L = args->input->W;
+    rot_args.H = args->input->H / args->n_heads;
+    rot_args.inverse = 1;
+
+    pi_cl_team_fork(NUM_CORES, rope_rotate_fp32, &rot_args);
+}
+
+void rope_tables_fp32(void *Rope_args){
+    struct Rope_args *args = (struct Rope_args *) Rope_args;
+    float *cos = args->cos;
+    float *sin = args->sin;
+    int L = args->input->W;
+    int H = args->input->H / args->n_heads;
+    int n_freq = H / 2;
+
+    const int blockSize = (n_freq + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_freq ? n_freq : start + blockSize;
+
+    for(int j = start; j < stop; j++){
+        float theta = powf(args->base, -2.0f * j / H);
+        for(int t = 0; t < L; t++)
+            cordic_cos_sin_fp32(t * theta, &cos[j * L + t], &sin[j * L + t]);
+    }
+}
+
+void rope_rotate_fp32(void *rope_rotate_args){
+    struct rope_rotate_args *args = (struct rope_rotate_args *) rope_rotate_args;
+    float *x = args->x;
+    float *cos = args->cos;
+    float *sin = args->sin;
+    int L = args->L;
+    int n_freq = args->H / 2;
+    int n_pairs = args->F / 2;
+    float sign = args->inverse ? -1.0f : 1.0f;
+
+    const int blockSize = (n_pairs + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start + blockSize;
+
+    for(int p = start; p < stop; p++){
+        float *x0 = x + 2 * p * L;
+        float *x1 = x0 + L;
+        float *c = cos + (p % n_freq) * L;
+        float *s = sin + (p % n_freq) * L;
+        for(int t = 0; t < L; t++){
+            float a = x0[t];
+            float b = x1[t];
+            float st = sign * s[t];
+            x0[t] = a * c[t] - b * st;
+            x1[t] = a * st + b * c[t];
+        }
+    }
+}
+
+void mm_rope_fp32(void *void_args){
+    struct mm_rope_args *rope_args = (struct mm_rope_args *) void_args;
+    struct matMul_args *args = rope_args->mm_args;
+
+    float *__restrict__ A = args->A;
+    float *__restrict__ B = args->B;
+    float *__restrict__ C = args->C;
+    float *__restrict__ bias = args->bias;
+    float *cos = rope_args->cos;
+    float *sin = rope_args->sin;
+
+    const int N = args->N;
+    const int M = args->M;
+    const int K = args->K;
+    const int n_freq = rope_args->H / 2;
+    const int n_pairs = N / 2;
+
+    const int stride_B = (args->trans_B == 0) ? M : 1;
+
+    const int blockSize = (n_pairs + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > n_pairs ? n_pairs : start + blockSize;
+
+    //  Rows 2p and 2p+1 are computed together, so that they can be rotated before being stored
+    for(int p = start; p < stop; p++){
+        float *a0 = &A[2 * p * K];
+        float *a1 = a0 + K;
+        float *c = cos + (p % n_freq) * M;
+        float *s = sin + (p % n_freq) * M;
+        float bias0 = args->USE_BIASES ? bias[2 * p] : 0.0f;
+        float bias1 = args->USE_BIASES ? bias[2 * p + 1] : 0.0f;
+
+        for(int j = 0; j < M; j++){
+            float *b = (args->trans_B == 0) ? &B[j] : &B[j * K];
+            float acc0 = bias0;
+            float acc1 = bias1;
+            for(int k = 0; k < K; k++){
+                acc0 += a0[k] * b[k * stride_B];
+                acc1 += a1[k] * b[k * stride_B];
+            }
+            C[2 * p * M + j] = acc0 * c[j] - acc1 * s[j];
+            C[(2 * p + 1) * M + j] = acc0 * s[j] + acc1 * c[j];
+        }
+    }
+}
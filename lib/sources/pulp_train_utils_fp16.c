@@ -19,6 +19,7 @@
 #include "pmsis.h"
 #include "pulp_train_utils_fp16.h"
 #include "pulp_matmul_fp16.h"
+#include "pulp_random.h"
 #include <math.h>
 
 
@@ -223,7 +224,7 @@ void vect_sum_fp16(void *vect_sum_args) {
 
     int blockSize = (size + NUM_CORES - 1) / NUM_CORES;
     int start = pi_core_id() * blockSize;
-    int stop = start + blockSize > size ? size - 1 : start + blockSize;
+    int stop = start + blockSize >= size ? size - 1 : start + blockSize;
 
     if (start & 0x0001) start++;
     if (0x1 != (stop & 0x1)) stop--;
@@ -837,6 +838,18 @@ void cast_fp32_tensor_to_fp16(void *cast_32t16_args) {
 }
 
 
+void cast_fp32_tensor_to_fp16_sr(void *cast_32t16_sr_args) {
+    struct cast_32t16_sr_args args = *((struct cast_32t16_sr_args *) cast_32t16_sr_args);
+    int blockSize = (args.size + NUM_CORES - 1) / NUM_CORES;
+    int start = pi_core_id() * blockSize;
+    int stop = start + blockSize > args.size ? args.size : start + blockSize;
+
+    for (int i = start; i < stop; i++) {
+        args.destination[i] = stochastic_round_fp16(args.source[i], pulp_counter_rand(args.seed, i));
+    }
+}
+
+
 void HWC_to_CHW_fp16(void *layout_args) {
     struct layout_args_fp16 *args = (struct layout_args_fp16 *) layout_args;
     fp16 *data = args->tensor->data;
@@ -1085,15 +1098,27 @@ void pulp_exp_sum_fp16_cl(void *void_args) {
 
     // Iterate through allocated rows
     for (int i = start; i < stop; i++) {
-        // Iterate through each element and update the sum accordingly
-        for (int j = 0; j < WIDTH; j++) {
-            // fp16 o = (fastexp_gist_fp16((input[i * WIDTH + j] - maxes[i])));
-            fp16 o = (fp16)(fastexp_gist_fp16((float) (input[i * WIDTH + j] - maxes[i])));
-            //float o = (fp16) (expf((float) (input[i * WIDTH + j] - maxes[i])));
+        fp16 *in_row = input + i * WIDTH;
+        fp16 *out_row = output + i * WIDTH;
+        v2f16 max = (v2f16) {maxes[i], maxes[i]};
+        v2f16 acc = (v2f16) {0, 0};
+
+        // Exponentiate two elements at a time and keep a vectorized partial sum
+        int j = 0;
+        for (; j < WIDTH - 1; j += 2) {
+            v2f16 o = vexp_fp16(*((v2f16 *) &in_row[j]) - max);
+            *((v2f16 *) &out_row[j]) = o;
+            acc += o;
+        }
 
-            output[i * WIDTH + j] = o;
-            sums[i] += o;
+        fp16 sum = acc[0] + acc[1];
+        if (j < WIDTH) {
+            fp16 o = vexp_fp16((v2f16) {in_row[j], in_row[j]} - max)[0];
+            out_row[j] = o;
+            sum += o;
         }
+
+        sums[i] += sum;
     }
 }
 
@@ -1114,11 +1139,18 @@ void pulp_row_div_fp16_cl(void *void_args) {
     const int start = pi_core_id() * blockSize;
     const int stop = start + blockSize > HEIGHT ? HEIGHT : start + blockSize;
 
-    // For each element in a row, divide with the corresponding precomputed sum
+    // For each element in a row, multiply by the reciprocal of the corresponding precomputed sum
     for (int i = start; i < stop; i++) {
-        int row = i * WIDTH;
-        for (int j = 0; j < WIDTH; j++) {
-            input[row + j] = input[row + j] / sums[i];
+        fp16 *row = input + i * WIDTH;
+        fp16 inv_sum = (fp16) 1.0f / sums[i];
+        v2f16 inv = (v2f16) {inv_sum, inv_sum};
+
+        int j = 0;
+        for (; j < WIDTH - 1; j += 2) {
+            *((v2f16 *) &row[j]) = *((v2f16 *) &row[j]) * inv;
+        }
+        if (j < WIDTH) {
+            row[j] = row[j] * inv_sum;
         }
     }
 }
@@ -1668,22 +1700,31 @@ void vector_exp_sum_fp16_cl(void * vector_exp_sum_args){
 
     int id = pi_core_id();
 
-    const int blockSize=(dim+NUM_CORES-1)/NUM_CORES;
+    const int blockSize=((dim+NUM_CORES-1)/NUM_CORES + 1) & 0xfffffffe;
     const int start = id*blockSize;
     const int stop = start + blockSize > dim ? dim : start+blockSize;
 
-    sums[id] = 0;
+    v2f16 vmax = (v2f16) {max, max};
+    v2f16 acc = (v2f16) {0, 0};
+
+    int i = start;
+    for(; i<stop-1; i+=2){
+        v2f16 o = vexp_fp16(*((v2f16 *) &input[i]) - vmax);
+        *((v2f16 *) &output[i]) = o;
+        acc += o;
+    }
 
-    for(int i=start; i<stop; i++){        
-        #ifdef FASTEXPF
-        float o = fastexp_gist_fp16((float)(input[i] - max));
-        #else
-        float o = expf((float)(input[i] - max));
-        #endif
-        output[i] = (fp16) o;
-        sums[id] += (fp16) o;   
+    fp16 sum = acc[0] + acc[1];
+    if(i<stop){
+        fp16 o = vexp_fp16((v2f16) {input[i], input[i]} - vmax)[0];
+        output[i] = o;
+        sum += o;
     }
+
+    sums[id] = sum;
 }
+
+
 void reduce_mean_fp16(void *void_args) {
     // Extract args
     struct reduce_mean_args_fp16 *args = (struct reduce_mean_args_fp16 *) void_args;
@@ -1757,3 +1798,172 @@ void reduce_mean_fp16(void *void_args) {
         }
     }
 }
+
+
+// ~~~~~~~~~~~~~~~~~~ VECTORIZED TRANSCENDENTAL FUNCTIONS ~~~~~~~~~~~~~~~~~~
+#define VSPLAT_FP16(a) ((v2f16) {(fp16) (a), (fp16) (a)})
+
+// Minimax coefficients of 2^f, f in [0, 1) (max rel. error 7.5e-5)
+#define EXP2_P0 0.999925224f
+#define EXP2_P1 0.695833419f
+#define EXP2_P2 0.22606751f
+#define EXP2_P3 0.0780242736f
+
+// Abramowitz-Stegun 7.1.27 coefficients of erf(x), x >= 0 (max abs. error 5e-4)
+#define ERF_A1 0.278393f
+#define ERF_A2 0.230389f
+#define ERF_A3 0.000972f
+#define ERF_A4 0.078108f
+
+// Largest inputs of the sigmoid and erf tables (last interpolation segment)
+#define SIGMOID_LUT_MAX 7.96875f
+#define ERF_LUT_MAX 3.96875f
+
+#if FP16_MATH_TIER == FP16_MATH_LUT
+// 2^(k/16), k = 0..17 (last entry guards f rounding up to 1)
+static const fp16 exp2_lut_fp16[18] = {
+    1.00000000f, 1.04427378f, 1.09050773f, 1.13878863f, 1.18920712f, 1.24185781f, 1.29683955f, 1.35425555f,
+    1.41421356f, 1.47682615f, 1.54221083f, 1.61049033f, 1.68179283f, 1.75625216f, 1.83400809f, 1.91520656f,
+    2.00000000f, 2.08854756f
+};
+
+// sigmoid(k/8), k = 0..64
+static const fp16 sigmoid_lut_fp16[65] = {
+    0.50000000f, 0.53120937f, 0.56217650f, 0.59266660f, 0.62245933f, 0.65135486f, 0.67917870f, 0.70578503f,
+    0.73105858f, 0.75491499f, 0.77729986f, 0.79818678f, 0.81757448f, 0.83548354f, 0.85195280f, 0.86703576f,
+    0.88079708f, 0.89330941f, 0.90465054f, 0.91490095f, 0.92414182f, 0.93245331f, 0.93991335f, 0.94659667f,
+    0.95257413f, 0.95791227f, 0.96267311f, 0.96691402f, 0.97068777f, 0.97404264f, 0.97702263f, 0.97966765f,
+    0.98201379f, 0.98409361f, 0.98593637f, 0.98756835f, 0.98901306f, 0.99029152f, 0.99142251f, 0.99242276f,
+    0.99330715f, 0.99408893f, 0.99477987f, 0.99539043f, 0.99592986f, 0.99640640f, 0.99682732f, 0.99719907f,
+    0.99752738f, 0.99781728f, 0.99807327f, 0.99829928f, 0.99849882f, 0.99867498f, 0.99883049f, 0.99896777f,
+    0.99908895f, 0.99919591f, 0.99929033f, 0.99937367f, 0.99944722f, 0.99951214f, 0.99956944f, 0.99962002f,
+    0.99966465f
+};
+
+// erf(k/16), k = 0..64
+static const fp16 erf_lut_fp16[65] = {
+    0.00000000f, 0.07043198f, 0.14031620f, 0.20911768f, 0.27632639f, 0.34146863f, 0.40411691f, 0.46389814f,
+    0.52049988f, 0.57367446f, 0.62324088f, 0.66908466f, 0.71115563f, 0.74946403f, 0.78407506f, 0.81510240f,
+    0.84270079f, 0.86705827f, 0.88838823f, 0.90692172f, 0.92290013f, 0.93656857f, 0.94817007f, 0.95794061f,
+    0.96610515f, 0.97287461f, 0.97844373f, 0.98298972f, 0.98667167f, 0.98963063f, 0.99199006f, 0.99385681f,
+    0.99532227f, 0.99646375f, 0.99734597f, 0.99802251f, 0.99853728f, 0.99892593f, 0.99921706f, 0.99943346f,
+    0.99959305f, 0.99970983f, 0.99979462f, 0.99985571f, 0.99989938f, 0.99993035f, 0.99995215f, 0.99996736f,
+    0.99997791f, 0.99998516f, 0.99999010f, 0.99999345f, 0.99999570f, 0.99999719f, 0.99999818f, 0.99999883f,
+    0.99999926f, 0.99999953f, 0.99999970f, 0.99999982f, 0.99999989f, 0.99999993f, 0.99999996f, 0.99999997f,
+    0.99999998f
+};
+#endif
+
+
+// Lane-wise select: a where mask is set, b elsewhere
+static inline v2f16 vselect_fp16(v2s mask, v2f16 a, v2f16 b) {
+    return (v2f16) ((mask & (v2s) a) | (~mask & (v2s) b));
+}
+
+
+static inline v2f16 vabs_fp16(v2f16 x) {
+    return (v2f16) ((v2s) x & (v2s) {0x7fff, 0x7fff});
+}
+
+
+// Linear interpolation on a uniformly sampled table, u is the (non-negative) table coordinate
+static inline v2f16 vlut_interp_fp16(const fp16 *lut, v2f16 u) {
+    v2s idx = __builtin_convertvector(u, v2s);
+    v2f16 frac = u - __builtin_convertvector(idx, v2f16);
+    v2f16 y0 = (v2f16) {lut[idx[0]], lut[idx[1]]};
+    v2f16 y1 = (v2f16) {lut[idx[0] + 1], lut[idx[1] + 1]};
+    return y0 + (y1 - y0) * frac;
+}
+
+
+v2f16 vexp_fp16(v2f16 x) {
+#if FP16_MATH_TIER == FP16_MATH_LIBM
+    return (v2f16) {(fp16) expf((float) x[0]), (fp16) expf((float) x[1])};
+#else
+    const v2f16 lo = VSPLAT_FP16((2 - FP16_EXP_BIAS) * LOG2);
+    const v2f16 hi = VSPLAT_FP16(FP16_EXP_BIAS * LOG2);
+
+    v2s underflow = x < lo;
+    x = vselect_fp16(x > hi, hi, x);
+    x = vselect_fp16(underflow, lo, x);
+
+    // Range reduction: exp(x) = 2^n * 2^f, with n = floor(x / ln2) and f in [0, 1)
+    v2f16 t = x * VSPLAT_FP16(1.442695041f);
+    v2s n = __builtin_convertvector(t, v2s);
+    v2f16 f = t - __builtin_convertvector(n, v2f16);
+    v2s neg = f < VSPLAT_FP16(0.0f);
+    n = n + neg;
+    f = f + (v2f16) (neg & (v2s) VSPLAT_FP16(1.0f));
+
+  #if FP16_MATH_TIER == FP16_MATH_LUT
+    v2f16 p = vlut_interp_fp16(exp2_lut_fp16, f * VSPLAT_FP16(16.0f));
+  #else
+    v2f16 p = ((VSPLAT_FP16(EXP2_P3) * f + VSPLAT_FP16(EXP2_P2)) * f + VSPLAT_FP16(EXP2_P1)) * f + VSPLAT_FP16(EXP2_P0);
+  #endif
+
+    // Build 2^n directly in the exponent field
+    v2f16 scale = (v2f16) ((n + (v2s) {FP16_EXP_BIAS, FP16_EXP_BIAS}) << FP16_MANT_BITS);
+    return (v2f16) ((v2s) (p * scale) & ~underflow);
+#endif
+}
+
+
+v2f16 vsigmoid_fp16(v2f16 x) {
+#if FP16_MATH_TIER == FP16_MATH_LIBM
+    return (v2f16) {(fp16) (1.0f / (1.0f + expf(-(float) x[0]))), (fp16) (1.0f / (1.0f + expf(-(float) x[1])))};
+#elif FP16_MATH_TIER == FP16_MATH_LUT
+    const v2f16 lut_max = VSPLAT_FP16(SIGMOID_LUT_MAX);
+    v2s neg = x < VSPLAT_FP16(0.0f);
+    v2f16 ax = vabs_fp16(x);
+    ax = vselect_fp16(ax > lut_max, lut_max, ax);
+    v2f16 s = vlut_interp_fp16(sigmoid_lut_fp16, ax * VSPLAT_FP16(8.0f));
+    // sigmoid(-x) = 1 - sigmoid(x)
+    return vselect_fp16(neg, VSPLAT_FP16(1.0f) - s, s);
+#else
+    return VSPLAT_FP16(1.0f) / (VSPLAT_FP16(1.0f) + vexp_fp16(-x));
+#endif
+}
+
+
+v2f16 vtanh_fp16(v2f16 x) {
+#if FP16_MATH_TIER == FP16_MATH_LIBM
+    return (v2f16) {(fp16) tanhf((float) x[0]), (fp16) tanhf((float) x[1])};
+#else
+    return VSPLAT_FP16(2.0f) * vsigmoid_fp16(VSPLAT_FP16(2.0f) * x) - VSPLAT_FP16(1.0f);
+#endif
+}
+
+
+v2f16 verf_fp16(v2f16 x) {
+#if FP16_MATH_TIER == FP16_MATH_LIBM
+    return (v2f16) {(fp16) erff((float) x[0]), (fp16) erff((float) x[1])};
+#else
+    v2f16 ax = vabs_fp16(x);
+    v2f16 r;
+  #if FP16_MATH_TIER == FP16_MATH_LUT
+    const v2f16 lut_max = VSPLAT_FP16(ERF_LUT_MAX);
+    ax = vselect_fp16(ax > lut_max, lut_max, ax);
+    r = vlut_interp_fp16(erf_lut_fp16, ax * VSPLAT_FP16(16.0f));
+  #else
+    // erf(x) = 1 - 1 / (1 + a1*x + a2*x^2 + a3*x^3 + a4*x^4)^4
+    v2f16 d = VSPLAT_FP16(1.0f) + ax * (VSPLAT_FP16(ERF_A1) + ax * (VSPLAT_FP16(ERF_A2) + ax * (VSPLAT_FP16(ERF_A3) + ax * VSPLAT_FP16(ERF_A4))));
+    d = d * d;
+    r = VSPLAT_FP16(1.0f) - VSPLAT_FP16(1.0f) / (d * d);
+  #endif
+    // erf is odd: restore the sign of the input
+    return (v2f16) ((v2s) r | ((v2s) x & (v2s) {(short) 0x8000, (short) 0x8000}));
+#endif
+}
+
+
+v2f16 vgelu_fp16(v2f16 x) {
+    // 0.5 * x * (1 + tanh(sqrt(2/pi) * (x + 0.044715 * x^3))) = x * sigmoid(2 * sqrt(2/pi) * (x + 0.044715 * x^3))
+    v2f16 inner = VSPLAT_FP16(1.5957691216f) * x * (VSPLAT_FP16(1.0f) + VSPLAT_FP16(0.044715f) * x * x);
+    return x * vsigmoid_fp16(inner);
+}
+
+
+v2f16 vgelu_erf_fp16(v2f16 x) {
+    v2f16 half_x = VSPLAT_FP16(0.5f) * x;
+    return half_x + half_x * verf_fp16(x * VSPLAT_FP16(0.7071067812f));
+}
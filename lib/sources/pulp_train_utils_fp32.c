@@ -1040,6 +1040,114 @@ float clamp(float value, float min, float max) {
 }
 
 
+int mhsa_mask_visible(int mask_type, int window, int block, unsigned char *layout, int L, int r, int c) {
+    switch (mask_type) {
+        case MHSA_MASK_CAUSAL:
+            return c <= r;
+        case MHSA_MASK_SLIDING_WINDOW:
+            return c <= r && c > r - window;
+        case MHSA_MASK_BLOCK_SPARSE: {
+            int n_blocks = (L + block - 1) / block;
+            return layout[(r / block) * n_blocks + c / block] != 0;
+        }
+        default:
+            return 1;
+    }
+}
+
+int mhsa_mask_tile(int mask_type, int window, int block, unsigned char *layout, int L, int r0, int r1, int c0, int c1) {
+    switch (mask_type) {
+        case MHSA_MASK_CAUSAL:
+            if (c0 > r1 - 1) return MHSA_TILE_SKIP;
+            if (c1 - 1 <= r0) return MHSA_TILE_FULL;
+            return MHSA_TILE_PARTIAL;
+        case MHSA_MASK_SLIDING_WINDOW:
+            if (c0 > r1 - 1 || c1 - 1 <= r0 - window) return MHSA_TILE_SKIP;
+            if (c1 - 1 <= r0 && c0 > r1 - 1 - window) return MHSA_TILE_FULL;
+            return MHSA_TILE_PARTIAL;
+        case MHSA_MASK_BLOCK_SPARSE: {
+            int n_blocks = (L + block - 1) / block;
+            int set = 0, total = 0;
+            for (int br = r0 / block; br <= (r1 - 1) / block; br++)
+                for (int bc = c0 / block; bc <= (c1 - 1) / block; bc++) {
+                    set += layout[br * n_blocks + bc] != 0;
+                    total++;
+                }
+            if (set == 0) return MHSA_TILE_SKIP;
+            if (set == total) return MHSA_TILE_FULL;
+            return MHSA_TILE_PARTIAL;
+        }
+        default:
+            return MHSA_TILE_FULL;
+    }
+}
+
+int mhsa_mask_next_tile(int mask_type, int window, int block, unsigned char *layout, int L, int r0, int r1, int Bc, int n_tiles, int t) {
+    for (t = t + 1; t < n_tiles; t++)
+        if (mhsa_mask_tile(mask_type, window, block, layout, L, r0, r1, t * Bc, (t + 1) * Bc) != MHSA_TILE_SKIP)
+            break;
+    return t;
+}
+
+void mhsa_mask_row_range(int mask_type, int window, int r, int c0, int c1, int *lo, int *hi) {
+    *lo = c0;
+    *hi = c1;
+    if (mask_type == MHSA_MASK_CAUSAL || mask_type == MHSA_MASK_SLIDING_WINDOW) {
+        if (*hi > r + 1) *hi = r + 1;
+        if (mask_type == MHSA_MASK_SLIDING_WINDOW && *lo < r - window + 1) *lo = r - window + 1;
+        if (*lo > *hi) *lo = *hi;
+    }
+}
+
+void mhsa_mask_col_range(int mask_type, int window, int c, int r0, int r1, int *lo, int *hi) {
+    *lo = r0;
+    *hi = r1;
+    if (mask_type == MHSA_MASK_CAUSAL || mask_type == MHSA_MASK_SLIDING_WINDOW) {
+        if (*lo < c) *lo = c;
+        if (mask_type == MHSA_MASK_SLIDING_WINDOW && *hi > c + window) *hi = c + window;
+        if (*lo > *hi) *lo = *hi;
+    }
+}
+
+int pulp_static_mem_plan(int n, int *size, int *first, int *last, int *offset) {
+    int total = 0;
+    for (int i = 0; i < n; i++)
+        offset[i] = -1;
+
+    for (int p = 0; p < n; p++) {
+        // Largest buffer not placed yet
+        int b = -1;
+        for (int i = 0; i < n; i++)
+            if (offset[i] < 0 && (b < 0 || size[i] > size[b]))
+                b = i;
+
+        // Lowest candidate offset (0 or the end of a placed buffer alive at the same time) free during the lifetime of b
+        int best = -1;
+        for (int c = -1; c < n; c++) {
+            int cand;
+            if (c < 0)
+                cand = 0;
+            else if (offset[c] >= 0 && first[c] <= last[b] && first[b] <= last[c])
+                cand = offset[c] + size[c];
+            else
+                continue;
+
+            int free = 1;
+            for (int i = 0; i < n && free; i++)
+                if (offset[i] >= 0 && first[i] <= last[b] && first[b] <= last[i] && cand < offset[i] + size[i] && offset[i] < cand + size[b])
+                    free = 0;
+            if (free && (best < 0 || cand < best))
+                best = cand;
+        }
+
+        offset[b] = best;
+        if (best + size[b] > total)
+            total = best + size[b];
+    }
+    return total;
+}
+
+
 // ~~~~~~~~~~~~~~~~~~ SOFTMAX FUNCTIONS ~~~~~~~~~~~~~~~~~~
 // ~~~~~~~~~~~~~~~~~~      FORWARD      ~~~~~~~~~~~~~~~~~~
 // Find the maximum value from each row of the passed matrix
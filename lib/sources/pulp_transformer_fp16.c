@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train_utils_fp16.h"
+#include "pulp_train_utils_fp32.h"
+#include "pulp_act_fp16.h"
+#include "pulp_mhsa_fp16.h"
+#include "pulp_transformer_fp16.h"
+#include <math.h>
+
+
+/*
+ * Saved activations (act_size FP16 elements), with the FP32 regions first to keep them aligned:
+ *      stats1 (2L, FP32) | stats2 (2L, FP32) | lse (n_heads x L, FP32) | qkv (3F x L) | att (F x L) | x1 (L x E) | u (L x Hm)
+ * Steps of the static memory plan:
+ *      FW: 0 LN1, 1 QKV, 2 attention, 3 output projection, 4 LN2, 5 FC1 + GELU, 6 FC2
+ *      BW: 10 recompute LN2 and GELU, 11 dW2, 12 du, 13 dW1, 14 dh2, 15 LN2 bw, 16 dWo, 17 datt, 18 attention bw,
+ *          19 recompute LN1, 20 dWqkv, 21 dh1, 22 LN1 bw
+ */
+
+void pulp_transformer_block_fp16_plan(void *Transformer_block_args_fp16) {
+    struct Transformer_block_args_fp16 *args = (struct Transformer_block_args_fp16 *) Transformer_block_args_fp16;
+
+    int L = args->input->H;
+    int E = args->input->W;
+    int F = args->coeff_qkv->H / 3;
+    int Hm = args->coeff_fc1->H;
+
+    int size[TRANSFORMER_N_BUFFERS], first[TRANSFORMER_N_BUFFERS], last[TRANSFORMER_N_BUFFERS];
+    //  Sizes in FP16 elements, rounded to pairs to keep every buffer aligned for SIMD and FP32 accesses
+    #define TRANSFORMER_BUFFER(id, s, f, l) size[id] = ((s) + 1) & ~1; first[id] = (f); last[id] = (l);
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_H1,       L * E,                  0,  1)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_SCORES,   (4 + NUM_CORES) * L,    2,  2)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_H2,       L * E,                  4,  5)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_G,        L * Hm,                 5,  6)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_G,        L * Hm,                 10, 11)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_H2,       L * E,                  10, 13)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DU,       L * Hm,                 12, 14)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DH2,      L * E,                  14, 15)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DATT,     F * L,                  17, 18)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DELTA,    2 * L,                  18, 18)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DQKV,     3 * F * L,              18, 21)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_H1,       L * E,                  19, 20)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DH1,      L * E,                  21, 22)
+    #undef TRANSFORMER_BUFFER
+
+    args->scratch_size = pulp_static_mem_plan(TRANSFORMER_N_BUFFERS, size, first, last, args->plan);
+    args->act_size = 2 * (4 * L + args->n_heads * L) + 3 * F * L + F * L + L * E + L * Hm;
+}
+
+
+void pulp_transformer_block_fp16_fw_cl(void *Transformer_block_args_fp16) {
+    struct Transformer_block_args_fp16 *args = (struct Transformer_block_args_fp16 *) Transformer_block_args_fp16;
+
+    int L = args->input->H;                                 //  Sequence length
+    int E = args->input->W;                                 //  Embedding size
+    int F = args->coeff_qkv->H / 3;                         //  Hidden dimension of attention (N. Heads * Head dimension)
+    int Hm = args->coeff_fc1->H;                            //  Hidden dimension of the MLP
+    int n_heads = args->n_heads;
+    int H = F / n_heads;                                    //  Head dimension
+
+    fp16 *x = args->input->data;
+    fp16 *y = args->output->data;
+
+    //  Saved activations
+    float *stats1 = (float *) args->activations;
+    float *stats2 = stats1 + 2 * L;
+    float *lse = stats2 + 2 * L;
+    fp16 *qkv = (fp16 *) (lse + n_heads * L);
+    fp16 *att = qkv + 3 * F * L;
+    fp16 *x1 = att + F * L;
+    fp16 *u = x1 + L * E;
+
+    //  Intermediates
+    fp16 *h1 = args->scratch + args->plan[TRANSFORMER_FW_H1];
+    fp16 *temp = args->scratch + args->plan[TRANSFORMER_FW_SCORES];      //  m | l (FP32) | scores
+    fp16 *h2 = args->scratch + args->plan[TRANSFORMER_FW_H2];
+    fp16 *g = args->scratch + args->plan[TRANSFORMER_FW_G];
+
+    struct transformer_mm_args_fp16 mm_args;
+    struct transformer_ln_args_fp16 ln_args;
+
+    //  h1 = LN1(x)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x, .out = h1, .weight = args->ln1_weight->data, .bias = args->ln1_bias->data,
+                                            .stats = stats1, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp16, &ln_args);
+
+    //  QKV = Wqkv * h1^T + bqkv (3F x L)
+    mm_args = (struct transformer_mm_args_fp16) {.A = args->coeff_qkv->data, .B = h1, .C = qkv, .N = 3 * F, .M = L, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = 1, .b_cs = E, .c_rs = L, .c_cs = 1,
+                                            .bias = args->bias_qkv != NULL ? args->bias_qkv->data : NULL, .bias_rows = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  Attention, one single tile per head (the head buffers are already H x L)
+    struct flash_attn_args_fp16 fa_args;
+    fa_args.m = (float *) temp;
+    fa_args.l = fa_args.m + L;
+    fa_args.scores = (fp16 *) (fa_args.l + L);
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = (fp16) q_rsqrt_fp16((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = args->mask_type;
+    fa_args.mask_window = args->mask_window;
+    fa_args.mask_block = args->mask_block;
+    fa_args.mask_layout = args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
+
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = qkv + L * i * H;
+        fa_args.k = qkv + L * (F + i * H);
+        fa_args.v = qkv + L * (2 * F + i * H);
+        fa_args.out = att + L * i * H;
+        fa_args.lse = lse + i * L;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp16, &fa_args);
+    }
+
+    //  x1 = x + att^T * Wo^T + bo
+    mm_args = (struct transformer_mm_args_fp16) {.A = att, .B = args->coeff_out->data, .C = x1, .N = L, .M = E, .K = F,
+                                            .a_rs = 1, .a_cs = L, .b_rs = 1, .b_cs = F, .c_rs = E, .c_cs = 1,
+                                            .bias = args->bias_out != NULL ? args->bias_out->data : NULL, .residual = x};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  h2 = LN2(x1)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x1, .out = h2, .weight = args->ln2_weight->data, .bias = args->ln2_bias->data,
+                                            .stats = stats2, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp16, &ln_args);
+
+    //  u = h2 * W1^T + b1, g = GELU(u)
+    mm_args = (struct transformer_mm_args_fp16) {.A = h2, .B = args->coeff_fc1->data, .C = u, .N = L, .M = Hm, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = 1, .b_cs = E, .c_rs = Hm, .c_cs = 1,
+                                            .bias = args->bias_fc1 != NULL ? args->bias_fc1->data : NULL, .act_out = g};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  y = x1 + g * W2^T + b2
+    mm_args = (struct transformer_mm_args_fp16) {.A = g, .B = args->coeff_fc2->data, .C = y, .N = L, .M = E, .K = Hm,
+                                            .a_rs = Hm, .a_cs = 1, .b_rs = 1, .b_cs = Hm, .c_rs = E, .c_cs = 1,
+                                            .bias = args->bias_fc2 != NULL ? args->bias_fc2->data : NULL, .residual = x1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+}
+
+
+void pulp_transformer_block_fp16_bw_cl(void *Transformer_block_args_fp16) {
+    struct Transformer_block_args_fp16 *args = (struct Transformer_block_args_fp16 *) Transformer_block_args_fp16;
+
+    int L = args->input->H;                                 //  Sequence length
+    int E = args->input->W;                                 //  Embedding size
+    int F = args->coeff_qkv->H / 3;                         //  Hidden dimension of attention (N. Heads * Head dimension)
+    int Hm = args->coeff_fc1->H;                            //  Hidden dimension of the MLP
+    int n_heads = args->n_heads;
+    int H = F / n_heads;                                    //  Head dimension
+
+    fp16 *x = args->input->data;
+    fp16 *dx = args->input->diff;                          //  Also holds the gradient of x1 until the LN1 backward
+    fp16 *dy = args->output->diff;
+
+    //  Saved activations
+    float *stats1 = (float *) args->activations;
+    float *stats2 = stats1 + 2 * L;
+    float *lse = stats2 + 2 * L;
+    fp16 *qkv = (fp16 *) (lse + n_heads * L);
+    fp16 *att = qkv + 3 * F * L;
+    fp16 *x1 = att + F * L;
+    fp16 *u = x1 + L * E;
+
+    //  Intermediates
+    fp16 *g = args->scratch + args->plan[TRANSFORMER_BW_G];
+    fp16 *h2 = args->scratch + args->plan[TRANSFORMER_BW_H2];
+    fp16 *du = args->scratch + args->plan[TRANSFORMER_BW_DU];
+    fp16 *dh2 = args->scratch + args->plan[TRANSFORMER_BW_DH2];
+    fp16 *datt = args->scratch + args->plan[TRANSFORMER_BW_DATT];
+    float *delta = (float *) (args->scratch + args->plan[TRANSFORMER_BW_DELTA]);
+    fp16 *dqkv = args->scratch + args->plan[TRANSFORMER_BW_DQKV];
+    fp16 *h1 = args->scratch + args->plan[TRANSFORMER_BW_H1];
+    fp16 *dh1 = args->scratch + args->plan[TRANSFORMER_BW_DH1];
+
+    struct transformer_mm_args_fp16 mm_args;
+    struct transformer_ln_args_fp16 ln_args;
+
+    //  Recompute h2 = LN2(x1) and g = GELU(u)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x1, .out = h2, .weight = args->ln2_weight->data, .bias = args->ln2_bias->data,
+                                            .stats = stats2, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp16, &ln_args);
+
+    struct blob_fp16 u_blob, g_blob;
+    u_blob.data = u;
+    u_blob.dim = L * Hm;
+    g_blob.data = g;
+    g_blob.dim = L * Hm;
+    struct gelu_train_args_fp16 gelu_args;
+    gelu_args.input = &u_blob;
+    gelu_args.output = &g_blob;
+    gelu_args.deriv = NULL;
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_fw_cache_cl, &gelu_args);
+
+    //  dW2 = dy^T * g, db2 = sum over the tokens of dy
+    mm_args = (struct transformer_mm_args_fp16) {.A = dy, .B = g, .C = args->coeff_fc2->diff, .N = E, .M = Hm, .K = L,
+                                            .a_rs = 1, .a_cs = E, .b_rs = Hm, .b_cs = 1, .c_rs = Hm, .c_cs = 1,
+                                            .row_sum = args->bias_fc2 != NULL ? args->bias_fc2->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  du = (dy * W2) . gelu'(u)
+    mm_args = (struct transformer_mm_args_fp16) {.A = dy, .B = args->coeff_fc2->data, .C = du, .N = L, .M = Hm, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = Hm, .b_cs = 1, .c_rs = Hm, .c_cs = 1,
+                                            .act_deriv = u};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  dW1 = du^T * h2, db1 = sum over the tokens of du
+    mm_args = (struct transformer_mm_args_fp16) {.A = du, .B = h2, .C = args->coeff_fc1->diff, .N = Hm, .M = E, .K = L,
+                                            .a_rs = 1, .a_cs = Hm, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1,
+                                            .row_sum = args->bias_fc1 != NULL ? args->bias_fc1->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  dh2 = du * W1
+    mm_args = (struct transformer_mm_args_fp16) {.A = du, .B = args->coeff_fc1->data, .C = dh2, .N = L, .M = E, .K = Hm,
+                                            .a_rs = Hm, .a_cs = 1, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  dx1 = dy + LN2_bw(dh2)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x1, .weight = args->ln2_weight->data, .stats = stats2, .out_diff = dh2,
+                                            .weight_diff = args->ln2_weight->diff, .bias_diff = args->ln2_bias->diff,
+                                            .in_diff = dx, .in_diff_add = dy, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_bw_fp16, &ln_args);
+
+    //  dWo = dx1^T * att^T, dbo = sum over the tokens of dx1
+    mm_args = (struct transformer_mm_args_fp16) {.A = dx, .B = att, .C = args->coeff_out->diff, .N = E, .M = F, .K = L,
+                                            .a_rs = 1, .a_cs = E, .b_rs = 1, .b_cs = L, .c_rs = F, .c_cs = 1,
+                                            .row_sum = args->bias_out != NULL ? args->bias_out->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  datt = Wo^T * dx1^T (F x L)
+    mm_args = (struct transformer_mm_args_fp16) {.A = args->coeff_out->data, .B = dx, .C = datt, .N = F, .M = L, .K = E,
+                                            .a_rs = 1, .a_cs = F, .b_rs = 1, .b_cs = E, .c_rs = L, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  Attention backward, recomputing the probabilities from the saved lse
+    struct flash_attn_bw_args_fp16 bw_args;
+    bw_args.delta = delta;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt_fp16((float) H);
+    bw_args.mask_type = args->mask_type;
+    bw_args.mask_window = args->mask_window;
+    bw_args.mask_block = args->mask_block;
+    bw_args.mask_layout = args->mask_layout;
+    bw_args.accumulate = 0;
+
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = qkv + L * i * H;
+        bw_args.k = qkv + L * (F + i * H);
+        bw_args.v = qkv + L * (2 * F + i * H);
+        bw_args.out = att + L * i * H;
+        bw_args.out_diff = datt + L * i * H;
+        bw_args.q_diff = dqkv + L * i * H;
+        bw_args.k_diff = dqkv + L * (F + i * H);
+        bw_args.v_diff = dqkv + L * (2 * F + i * H);
+        bw_args.lse = lse + i * L;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp16, &bw_args);
+    }
+
+    //  Recompute h1 = LN1(x)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x, .out = h1, .weight = args->ln1_weight->data, .bias = args->ln1_bias->data,
+                                            .stats = stats1, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp16, &ln_args);
+
+    //  dWqkv = dqkv * h1, dbqkv = sum over the tokens of dqkv
+    mm_args = (struct transformer_mm_args_fp16) {.A = dqkv, .B = h1, .C = args->coeff_qkv->diff, .N = 3 * F, .M = E, .K = L,
+                                            .a_rs = L, .a_cs = 1, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1,
+                                            .row_sum = args->bias_qkv != NULL ? args->bias_qkv->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  dh1 = dqkv^T * Wqkv
+    mm_args = (struct transformer_mm_args_fp16) {.A = dqkv, .B = args->coeff_qkv->data, .C = dh1, .N = L, .M = E, .K = 3 * F,
+                                            .a_rs = 1, .a_cs = L, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp16, &mm_args);
+
+    //  dx = dx1 + LN1_bw(dh1)
+    ln_args = (struct transformer_ln_args_fp16) {.x = x, .weight = args->ln1_weight->data, .stats = stats1, .out_diff = dh1,
+                                            .weight_diff = args->ln1_weight->diff, .bias_diff = args->ln1_bias->diff,
+                                            .in_diff = dx, .in_diff_add = dx, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_bw_fp16, &ln_args);
+}
+
+
+
+
+
+
+//  Epilogue of the n (1 or 2) outputs (i0, j0), (i1, j1) held in acc
+static inline void transformer_mm_fp16_epilogue(struct transformer_mm_args_fp16 *args, int i0, int j0, int i1, int j1, v2f16 acc, int n) {
+    int c0 = i0 * args->c_rs + j0 * args->c_cs;
+    int c1 = n > 1 ? i1 * args->c_rs + j1 * args->c_cs : c0;
+    v2f16 g;
+
+    if (args->bias != NULL)
+        acc += args->bias_rows ? (v2f16) {args->bias[i0], args->bias[i1]} : (v2f16) {args->bias[j0], args->bias[j1]};
+    if (args->residual != NULL)
+        acc += (v2f16) {args->residual[c0], args->residual[c1]};
+    if (args->act_deriv != NULL)
+        acc *= vgelu_deriv_fp16((v2f16) {args->act_deriv[c0], args->act_deriv[c1]}, &g);
+
+    args->C[c0] = acc[0];
+    if (n > 1) args->C[c1] = acc[1];
+    if (args->act_out != NULL) {
+        g = vgelu_fp16(acc);
+        args->act_out[c0] = g[0];
+        if (n > 1) args->act_out[c1] = g[1];
+    }
+}
+
+
+void transformer_mm_fp16(void *transformer_mm_args_fp16) {
+    struct transformer_mm_args_fp16 *args = (struct transformer_mm_args_fp16 *) transformer_mm_args_fp16;
+
+    const int N = args->N;
+    const int M = args->M;
+    const int K = args->K;
+    const int a_cs = args->a_cs;
+    const int b_rs = args->b_rs;
+
+    //  SIMD along K if both operands are contiguous in it, otherwise on pairs of columns (B contiguous along j) or of rows (A contiguous along i)
+    const int vec_k = a_cs == 1 && b_rs == 1 && (K & 1) == 0 && (args->a_rs & 1) == 0 && (args->b_cs & 1) == 0;
+    const int pair_j = !vec_k && args->b_cs == 1 && (M & 1) == 0 && (b_rs & 1) == 0;
+    const int pair_i = !vec_k && !pair_j && args->a_rs == 1 && (N & 1) == 0 && (a_cs & 1) == 0;
+    const int step_i = pair_i ? 2 : 1;
+    const int step_j = pair_j ? 2 : 1;
+    const int Np = N / step_i;
+    const int Mp = M / step_j;
+
+    //  Parallel on the rows (pairs of rows) of C, or on its columns if there are fewer rows than cores
+    int i_start = 0, i_stop = Np, j_start = 0, j_stop = Mp;
+    if (Np >= NUM_CORES) {
+        const int blockSize = (Np + NUM_CORES - 1) / NUM_CORES;
+        i_start = pi_core_id() * blockSize;
+        i_stop = i_start + blockSize > Np ? Np : i_start + blockSize;
+    }
+    else {
+        const int blockSize = (Mp + NUM_CORES - 1) / NUM_CORES;
+        j_start = pi_core_id() * blockSize;
+        j_stop = j_start + blockSize > Mp ? Mp : j_start + blockSize;
+    }
+
+    for (int i = i_start * step_i; i < i_stop * step_i; i += step_i) {
+        for (int j = j_start * step_j; j < j_stop * step_j; j += step_j) {
+            fp16 *a = args->A + i * args->a_rs;
+            fp16 *b = args->B + j * args->b_cs;
+
+            if (vec_k) {
+                v2f16 acc = (v2f16) {0, 0};
+                for (int k = 0; k < K; k += 2)
+                    acc += *((v2f16 *) &a[k]) * *((v2f16 *) &b[k]);
+                fp16 res = acc[0] + acc[1];
+                transformer_mm_fp16_epilogue(args, i, j, i, j, (v2f16) {res, res}, 1);
+            }
+            else if (pair_j) {
+                v2f16 acc = (v2f16) {0, 0};
+                for (int k = 0; k < K; k++) {
+                    acc += (v2f16) {*a, *a} * *((v2f16 *) b);
+                    a += a_cs;
+                    b += b_rs;
+                }
+                transformer_mm_fp16_epilogue(args, i, j, i, j + 1, acc, 2);
+            }
+            else if (pair_i) {
+                v2f16 acc = (v2f16) {0, 0};
+                for (int k = 0; k < K; k++) {
+                    acc += *((v2f16 *) a) * (v2f16) {*b, *b};
+                    a += a_cs;
+                    b += b_rs;
+                }
+                transformer_mm_fp16_epilogue(args, i, j, i + 1, j, acc, 2);
+            }
+            else {
+                fp16 acc = 0;
+                for (int k = 0; k < K; k++) {
+                    acc += (*a) * (*b);
+                    a += a_cs;
+                    b += b_rs;
+                }
+                transformer_mm_fp16_epilogue(args, i, j, i, j, (v2f16) {acc, acc}, 1);
+            }
+        }
+
+        //  The core owning the first column of a row also reduces the row of A
+        if (args->row_sum != NULL && j_start == 0) {
+            for (int ii = i; ii < i + step_i; ii++) {
+                fp16 sum = 0;
+                fp16 *a = args->A + ii * args->a_rs;
+                for (int k = 0; k < K; k++) {
+                    sum += *a;
+                    a += a_cs;
+                }
+                args->row_sum[ii] = sum;
+            }
+        }
+    }
+}
+
+
+void transformer_layernorm_fw_fp16(void *transformer_ln_args_fp16) {
+    struct transformer_ln_args_fp16 *args = (struct transformer_ln_args_fp16 *) transformer_ln_args_fp16;
+
+    const int L = args->L;
+    const int E = args->E;
+
+    const int blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > L ? L : start + blockSize;
+
+    //  Statistics in FP32, normalization with SIMD on pairs of features
+    for (int l = start; l < stop; l++) {
+        fp16 *x = args->x + l * E;
+        fp16 *out = args->out + l * E;
+
+        float mean = 0;
+        for (int e = 0; e < E; e++)
+            mean += (float) x[e];
+        mean /= E;
+
+        float var = 0;
+        for (int e = 0; e < E; e++)
+            var += ((float) x[e] - mean) * ((float) x[e] - mean);
+        var /= E;
+
+        float rstd = 1.0f / sqrtf(var + (float) args->eps);
+        args->stats[2 * l] = mean;
+        args->stats[2 * l + 1] = rstd;
+
+        v2f16 m = (v2f16) {(fp16) mean, (fp16) mean};
+        v2f16 r = (v2f16) {(fp16) rstd, (fp16) rstd};
+        for (int e = 0; e < E; e += 2)
+            *((v2f16 *) &out[e]) = (*((v2f16 *) &x[e]) - m) * r * *((v2f16 *) &args->weight[e]) + *((v2f16 *) &args->bias[e]);
+    }
+}
+
+
+void transformer_layernorm_bw_fp16(void *transformer_ln_args_fp16) {
+    struct transformer_ln_args_fp16 *args = (struct transformer_ln_args_fp16 *) transformer_ln_args_fp16;
+
+    const int L = args->L;
+    const int E = args->E;
+    float *stats = args->stats;
+    fp16 *dout = args->out_diff;
+
+    //  Weight gradients, parallel on the pairs of features
+    int blockSize = ((E + NUM_CORES - 1) / NUM_CORES + 1) & 0xfffffffe;
+    int start = pi_core_id() * blockSize;
+    int stop = start + blockSize > E ? E : start + blockSize;
+
+    for (int e = start; e < stop; e += 2) {
+        v2f16 dw = (v2f16) {0, 0};
+        v2f16 db = (v2f16) {0, 0};
+        for (int l = 0; l < L; l++) {
+            v2f16 m = (v2f16) {(fp16) stats[2 * l], (fp16) stats[2 * l]};
+            v2f16 r = (v2f16) {(fp16) stats[2 * l + 1], (fp16) stats[2 * l + 1]};
+            v2f16 dy = *((v2f16 *) &dout[l * E + e]);
+            dw += dy * (*((v2f16 *) &args->x[l * E + e]) - m) * r;
+            db += dy;
+        }
+        *((v2f16 *) &args->weight_diff[e]) = dw;
+        *((v2f16 *) &args->bias_diff[e]) = db;
+    }
+
+    //  Input gradient, parallel on the tokens: dx = rstd * (w*dout - mean(w*dout) - xhat * mean(w*dout*xhat))
+    blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    start = pi_core_id() * blockSize;
+    stop = start + blockSize > L ? L : start + blockSize;
+
+    for (int l = start; l < stop; l++) {
+        fp16 *x = args->x + l * E;
+        fp16 *dy = dout + l * E;
+        v2f16 m = (v2f16) {(fp16) stats[2 * l], (fp16) stats[2 * l]};
+        v2f16 r = (v2f16) {(fp16) stats[2 * l + 1], (fp16) stats[2 * l + 1]};
+
+        float sum = 0, sum_xhat = 0;
+        for (int e = 0; e < E; e += 2) {
+            v2f16 wdy = *((v2f16 *) &args->weight[e]) * *((v2f16 *) &dy[e]);
+            v2f16 wdy_xhat = wdy * (*((v2f16 *) &x[e]) - m) * r;
+            sum += (float) wdy[0] + (float) wdy[1];
+            sum_xhat += (float) wdy_xhat[0] + (float) wdy_xhat[1];
+        }
+        fp16 s = (fp16) (sum / E);
+        fp16 s_xhat = (fp16) (sum_xhat / E);
+        v2f16 vs = (v2f16) {s, s};
+        v2f16 vs_xhat = (v2f16) {s_xhat, s_xhat};
+
+        for (int e = 0; e < E; e += 2) {
+            v2f16 xhat = (*((v2f16 *) &x[e]) - m) * r;
+            v2f16 wdy = *((v2f16 *) &args->weight[e]) * *((v2f16 *) &dy[e]);
+            *((v2f16 *) &args->in_diff[l * E + e]) = *((v2f16 *) &args->in_diff_add[l * E + e]) + r * (wdy - vs - xhat * vs_xhat);
+        }
+    }
+}
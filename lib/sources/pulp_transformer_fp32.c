@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2021-2024 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pmsis.h"
+#include "pulp_train_utils_fp32.h"
+#include "pulp_act_fp32.h"
+#include "pulp_mhsa_fp32.h"
+#include "pulp_transformer_fp32.h"
+#include <math.h>
+
+
+/*
+ * Saved activations (act_size elements):
+ *      stats1 (2L) | qkv (3F x L) | att (F x L) | lse (n_heads x L) | x1 (L x E) | stats2 (2L) | u (L x Hm)
+ * Steps of the static memory plan:
+ *      FW: 0 LN1, 1 QKV, 2 attention, 3 output projection, 4 LN2, 5 FC1 + GELU, 6 FC2
+ *      BW: 10 recompute LN2 and GELU, 11 dW2, 12 du, 13 dW1, 14 dh2, 15 LN2 bw, 16 dWo, 17 datt, 18 attention bw,
+ *          19 recompute LN1, 20 dWqkv, 21 dh1, 22 LN1 bw
+ */
+
+void pulp_transformer_block_fp32_plan(void *Transformer_block_args) {
+    struct Transformer_block_args *args = (struct Transformer_block_args *) Transformer_block_args;
+
+    int L = args->input->H;
+    int E = args->input->W;
+    int F = args->coeff_qkv->H / 3;
+    int Hm = args->coeff_fc1->H;
+
+    int size[TRANSFORMER_N_BUFFERS], first[TRANSFORMER_N_BUFFERS], last[TRANSFORMER_N_BUFFERS];
+    #define TRANSFORMER_BUFFER(id, s, f, l) size[id] = (s); first[id] = (f); last[id] = (l);
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_H1,       L * E,                  0,  1)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_SCORES,   (2 + NUM_CORES) * L,    2,  2)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_H2,       L * E,                  4,  5)
+    TRANSFORMER_BUFFER(TRANSFORMER_FW_G,        L * Hm,                 5,  6)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_G,        L * Hm,                 10, 11)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_H2,       L * E,                  10, 13)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DU,       L * Hm,                 12, 14)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DH2,      L * E,                  14, 15)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DATT,     F * L,                  17, 18)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DELTA,    L,                      18, 18)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DQKV,     3 * F * L,              18, 21)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_H1,       L * E,                  19, 20)
+    TRANSFORMER_BUFFER(TRANSFORMER_BW_DH1,      L * E,                  21, 22)
+    #undef TRANSFORMER_BUFFER
+
+    args->scratch_size = pulp_static_mem_plan(TRANSFORMER_N_BUFFERS, size, first, last, args->plan);
+    args->act_size = 2 * L + 3 * F * L + F * L + args->n_heads * L + L * E + 2 * L + L * Hm;
+}
+
+
+void pulp_transformer_block_fp32_fw_cl(void *Transformer_block_args) {
+    struct Transformer_block_args *args = (struct Transformer_block_args *) Transformer_block_args;
+
+    int L = args->input->H;                                 //  Sequence length
+    int E = args->input->W;                                 //  Embedding size
+    int F = args->coeff_qkv->H / 3;                         //  Hidden dimension of attention (N. Heads * Head dimension)
+    int Hm = args->coeff_fc1->H;                            //  Hidden dimension of the MLP
+    int n_heads = args->n_heads;
+    int H = F / n_heads;                                    //  Head dimension
+
+    float *x = args->input->data;
+    float *y = args->output->data;
+
+    //  Saved activations
+    float *stats1 = args->activations;
+    float *qkv = stats1 + 2 * L;
+    float *att = qkv + 3 * F * L;
+    float *lse = att + F * L;
+    float *x1 = lse + n_heads * L;
+    float *stats2 = x1 + L * E;
+    float *u = stats2 + 2 * L;
+
+    //  Intermediates
+    float *h1 = args->scratch + args->plan[TRANSFORMER_FW_H1];
+    float *temp = args->scratch + args->plan[TRANSFORMER_FW_SCORES];
+    float *h2 = args->scratch + args->plan[TRANSFORMER_FW_H2];
+    float *g = args->scratch + args->plan[TRANSFORMER_FW_G];
+
+    struct transformer_mm_args mm_args;
+    struct transformer_ln_args ln_args;
+
+    //  h1 = LN1(x)
+    ln_args = (struct transformer_ln_args) {.x = x, .out = h1, .weight = args->ln1_weight->data, .bias = args->ln1_bias->data,
+                                            .stats = stats1, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp32, &ln_args);
+
+    //  QKV = Wqkv * h1^T + bqkv (3F x L)
+    mm_args = (struct transformer_mm_args) {.A = args->coeff_qkv->data, .B = h1, .C = qkv, .N = 3 * F, .M = L, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = 1, .b_cs = E, .c_rs = L, .c_cs = 1,
+                                            .bias = args->bias_qkv != NULL ? args->bias_qkv->data : NULL, .bias_rows = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  Attention, one single tile per head (the head buffers are already H x L)
+    struct flash_attn_args fa_args;
+    fa_args.m = temp;
+    fa_args.l = temp + L;
+    fa_args.scores = temp + 2 * L;
+    fa_args.H = H;
+    fa_args.Br = L;
+    fa_args.Bc = L;
+    fa_args.scaling = q_rsqrt((float) H);
+    fa_args.first = 1;
+    fa_args.last = 1;
+    fa_args.mask_type = args->mask_type;
+    fa_args.mask_window = args->mask_window;
+    fa_args.mask_block = args->mask_block;
+    fa_args.mask_layout = args->mask_layout;
+    fa_args.L = L;
+    fa_args.row0 = 0;
+    fa_args.col0 = 0;
+    fa_args.mask_tile = args->mask_type == MHSA_MASK_NONE ? MHSA_TILE_FULL : MHSA_TILE_PARTIAL;
+
+    for (int i = 0; i < n_heads; i++) {
+        fa_args.q = qkv + L * i * H;
+        fa_args.k = qkv + L * (F + i * H);
+        fa_args.v = qkv + L * (2 * F + i * H);
+        fa_args.out = att + L * i * H;
+        fa_args.lse = lse + i * L;
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp32, &fa_args);
+    }
+
+    //  x1 = x + att^T * Wo^T + bo
+    mm_args = (struct transformer_mm_args) {.A = att, .B = args->coeff_out->data, .C = x1, .N = L, .M = E, .K = F,
+                                            .a_rs = 1, .a_cs = L, .b_rs = 1, .b_cs = F, .c_rs = E, .c_cs = 1,
+                                            .bias = args->bias_out != NULL ? args->bias_out->data : NULL, .residual = x};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  h2 = LN2(x1)
+    ln_args = (struct transformer_ln_args) {.x = x1, .out = h2, .weight = args->ln2_weight->data, .bias = args->ln2_bias->data,
+                                            .stats = stats2, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp32, &ln_args);
+
+    //  u = h2 * W1^T + b1, g = GELU(u)
+    mm_args = (struct transformer_mm_args) {.A = h2, .B = args->coeff_fc1->data, .C = u, .N = L, .M = Hm, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = 1, .b_cs = E, .c_rs = Hm, .c_cs = 1,
+                                            .bias = args->bias_fc1 != NULL ? args->bias_fc1->data : NULL, .act_out = g};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  y = x1 + g * W2^T + b2
+    mm_args = (struct transformer_mm_args) {.A = g, .B = args->coeff_fc2->data, .C = y, .N = L, .M = E, .K = Hm,
+                                            .a_rs = Hm, .a_cs = 1, .b_rs = 1, .b_cs = Hm, .c_rs = E, .c_cs = 1,
+                                            .bias = args->bias_fc2 != NULL ? args->bias_fc2->data : NULL, .residual = x1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+}
+
+
+void pulp_transformer_block_fp32_bw_cl(void *Transformer_block_args) {
+    struct Transformer_block_args *args = (struct Transformer_block_args *) Transformer_block_args;
+
+    int L = args->input->H;                                 //  Sequence length
+    int E = args->input->W;                                 //  Embedding size
+    int F = args->coeff_qkv->H / 3;                         //  Hidden dimension of attention (N. Heads * Head dimension)
+    int Hm = args->coeff_fc1->H;                            //  Hidden dimension of the MLP
+    int n_heads = args->n_heads;
+    int H = F / n_heads;                                    //  Head dimension
+
+    float *x = args->input->data;
+    float *dx = args->input->diff;                          //  Also holds the gradient of x1 until the LN1 backward
+    float *dy = args->output->diff;
+
+    //  Saved activations
+    float *stats1 = args->activations;
+    float *qkv = stats1 + 2 * L;
+    float *att = qkv + 3 * F * L;
+    float *lse = att + F * L;
+    float *x1 = lse + n_heads * L;
+    float *stats2 = x1 + L * E;
+    float *u = stats2 + 2 * L;
+
+    //  Intermediates
+    float *g = args->scratch + args->plan[TRANSFORMER_BW_G];
+    float *h2 = args->scratch + args->plan[TRANSFORMER_BW_H2];
+    float *du = args->scratch + args->plan[TRANSFORMER_BW_DU];
+    float *dh2 = args->scratch + args->plan[TRANSFORMER_BW_DH2];
+    float *datt = args->scratch + args->plan[TRANSFORMER_BW_DATT];
+    float *delta = args->scratch + args->plan[TRANSFORMER_BW_DELTA];
+    float *dqkv = args->scratch + args->plan[TRANSFORMER_BW_DQKV];
+    float *h1 = args->scratch + args->plan[TRANSFORMER_BW_H1];
+    float *dh1 = args->scratch + args->plan[TRANSFORMER_BW_DH1];
+
+    struct transformer_mm_args mm_args;
+    struct transformer_ln_args ln_args;
+
+    //  Recompute h2 = LN2(x1) and g = GELU(u)
+    ln_args = (struct transformer_ln_args) {.x = x1, .out = h2, .weight = args->ln2_weight->data, .bias = args->ln2_bias->data,
+                                            .stats = stats2, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp32, &ln_args);
+
+    struct blob u_blob, g_blob;
+    u_blob.data = u;
+    u_blob.dim = L * Hm;
+    g_blob.data = g;
+    g_blob.dim = L * Hm;
+    struct gelu_train_args gelu_args;
+    gelu_args.input = &u_blob;
+    gelu_args.output = &g_blob;
+    gelu_args.deriv = NULL;
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_tanh_approx_fp32_fw_cache_cl, &gelu_args);
+
+    //  dW2 = dy^T * g, db2 = sum over the tokens of dy
+    mm_args = (struct transformer_mm_args) {.A = dy, .B = g, .C = args->coeff_fc2->diff, .N = E, .M = Hm, .K = L,
+                                            .a_rs = 1, .a_cs = E, .b_rs = Hm, .b_cs = 1, .c_rs = Hm, .c_cs = 1,
+                                            .row_sum = args->bias_fc2 != NULL ? args->bias_fc2->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  du = (dy * W2) . gelu'(u)
+    mm_args = (struct transformer_mm_args) {.A = dy, .B = args->coeff_fc2->data, .C = du, .N = L, .M = Hm, .K = E,
+                                            .a_rs = E, .a_cs = 1, .b_rs = Hm, .b_cs = 1, .c_rs = Hm, .c_cs = 1,
+                                            .act_deriv = u};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  dW1 = du^T * h2, db1 = sum over the tokens of du
+    mm_args = (struct transformer_mm_args) {.A = du, .B = h2, .C = args->coeff_fc1->diff, .N = Hm, .M = E, .K = L,
+                                            .a_rs = 1, .a_cs = Hm, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1,
+                                            .row_sum = args->bias_fc1 != NULL ? args->bias_fc1->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  dh2 = du * W1
+    mm_args = (struct transformer_mm_args) {.A = du, .B = args->coeff_fc1->data, .C = dh2, .N = L, .M = E, .K = Hm,
+                                            .a_rs = Hm, .a_cs = 1, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  dx1 = dy + LN2_bw(dh2)
+    ln_args = (struct transformer_ln_args) {.x = x1, .weight = args->ln2_weight->data, .stats = stats2, .out_diff = dh2,
+                                            .weight_diff = args->ln2_weight->diff, .bias_diff = args->ln2_bias->diff,
+                                            .in_diff = dx, .in_diff_add = dy, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_bw_fp32, &ln_args);
+
+    //  dWo = dx1^T * att^T, dbo = sum over the tokens of dx1
+    mm_args = (struct transformer_mm_args) {.A = dx, .B = att, .C = args->coeff_out->diff, .N = E, .M = F, .K = L,
+                                            .a_rs = 1, .a_cs = E, .b_rs = 1, .b_cs = L, .c_rs = F, .c_cs = 1,
+                                            .row_sum = args->bias_out != NULL ? args->bias_out->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  datt = Wo^T * dx1^T (F x L)
+    mm_args = (struct transformer_mm_args) {.A = args->coeff_out->data, .B = dx, .C = datt, .N = F, .M = L, .K = E,
+                                            .a_rs = 1, .a_cs = F, .b_rs = 1, .b_cs = E, .c_rs = L, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  Attention backward, recomputing the probabilities from the saved lse
+    struct flash_attn_bw_args bw_args;
+    bw_args.delta = delta;
+    bw_args.H = H;
+    bw_args.L = L;
+    bw_args.scaling = q_rsqrt((float) H);
+    bw_args.mask_type = args->mask_type;
+    bw_args.mask_window = args->mask_window;
+    bw_args.mask_block = args->mask_block;
+    bw_args.mask_layout = args->mask_layout;
+    bw_args.accumulate = 0;
+
+    for (int i = 0; i < n_heads; i++) {
+        bw_args.q = qkv + L * i * H;
+        bw_args.k = qkv + L * (F + i * H);
+        bw_args.v = qkv + L * (2 * F + i * H);
+        bw_args.out = att + L * i * H;
+        bw_args.out_diff = datt + L * i * H;
+        bw_args.q_diff = dqkv + L * i * H;
+        bw_args.k_diff = dqkv + L * (F + i * H);
+        bw_args.v_diff = dqkv + L * (2 * F + i * H);
+        bw_args.lse = lse + i * L;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp32, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp32, &bw_args);
+    }
+
+    //  Recompute h1 = LN1(x)
+    ln_args = (struct transformer_ln_args) {.x = x, .out = h1, .weight = args->ln1_weight->data, .bias = args->ln1_bias->data,
+                                            .stats = stats1, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_fw_fp32, &ln_args);
+
+    //  dWqkv = dqkv * h1, dbqkv = sum over the tokens of dqkv
+    mm_args = (struct transformer_mm_args) {.A = dqkv, .B = h1, .C = args->coeff_qkv->diff, .N = 3 * F, .M = E, .K = L,
+                                            .a_rs = L, .a_cs = 1, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1,
+                                            .row_sum = args->bias_qkv != NULL ? args->bias_qkv->diff : NULL};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  dh1 = dqkv^T * Wqkv
+    mm_args = (struct transformer_mm_args) {.A = dqkv, .B = args->coeff_qkv->data, .C = dh1, .N = L, .M = E, .K = 3 * F,
+                                            .a_rs = 1, .a_cs = L, .b_rs = E, .b_cs = 1, .c_rs = E, .c_cs = 1};
+    pi_cl_team_fork(NUM_CORES, transformer_mm_fp32, &mm_args);
+
+    //  dx = dx1 + LN1_bw(dh1)
+    ln_args = (struct transformer_ln_args) {.x = x, .weight = args->ln1_weight->data, .stats = stats1, .out_diff = dh1,
+                                            .weight_diff = args->ln1_weight->diff, .bias_diff = args->ln1_bias->diff,
+                                            .in_diff = dx, .in_diff_add = dx, .L = L, .E = E, .eps = args->eps};
+    pi_cl_team_fork(NUM_CORES, transformer_layernorm_bw_fp32, &ln_args);
+}
+
+
+
+//  Epilogue of the output (i, j) held in acc
+static inline void transformer_mm_fp32_epilogue(struct transformer_mm_args *args, int i, int j, float acc) {
+    int c = i * args->c_rs + j * args->c_cs;
+
+    if (args->bias != NULL)
+        acc += args->bias_rows ? args->bias[i] : args->bias[j];
+    if (args->residual != NULL)
+        acc += args->residual[c];
+    if (args->act_deriv != NULL) {
+        float z = args->act_deriv[c];
+        acc *= gelu_tanh_deriv(z, gelu_tanh_pade(((z * z * z * 0.044715f) + z) * 0.7978f));
+    }
+    args->C[c] = acc;
+    if (args->act_out != NULL)
+        args->act_out[c] = 0.5f * acc * (1.0f + gelu_tanh_pade(((acc * acc * acc * 0.044715f) + acc) * 0.7978f));
+}
+
+
+void transformer_mm_fp32(void *transformer_mm_args) {
+    struct transformer_mm_args *args = (struct transformer_mm_args *) transformer_mm_args;
+
+    const int N = args->N;
+    const int M = args->M;
+    const int K = args->K;
+    const int a_cs = args->a_cs;
+    const int b_rs = args->b_rs;
+    const int b_cs = args->b_cs;
+
+    //  Parallel on the rows of C, or on blocks of 4 columns if there are fewer rows than cores
+    int i_start = 0, i_stop = N, j_start = 0, j_stop = M;
+    if (N >= NUM_CORES) {
+        const int blockSize = (N + NUM_CORES - 1) / NUM_CORES;
+        i_start = pi_core_id() * blockSize;
+        i_stop = i_start + blockSize > N ? N : i_start + blockSize;
+    }
+    else {
+        const int blockSize = (((M + NUM_CORES - 1) / NUM_CORES) + 3) & ~3;
+        j_start = pi_core_id() * blockSize;
+        j_stop = j_start + blockSize > M ? M : j_start + blockSize;
+    }
+
+    for (int i = i_start; i < i_stop; i++) {
+        float *a_row = args->A + i * args->a_rs;
+        int j = j_start;
+
+        //  4 columns at a time, each element of A is loaded once for the 4 accumulators
+        for (; j + 3 < j_stop; j += 4) {
+            float *a = a_row;
+            float *b = args->B + j * b_cs;
+            float acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+            for (int k = 0; k < K; k++) {
+                float a_k = *a;
+                acc0 += a_k * b[0];
+                acc1 += a_k * b[b_cs];
+                acc2 += a_k * b[2 * b_cs];
+                acc3 += a_k * b[3 * b_cs];
+                a += a_cs;
+                b += b_rs;
+            }
+            transformer_mm_fp32_epilogue(args, i, j, acc0);
+            transformer_mm_fp32_epilogue(args, i, j + 1, acc1);
+            transformer_mm_fp32_epilogue(args, i, j + 2, acc2);
+            transformer_mm_fp32_epilogue(args, i, j + 3, acc3);
+        }
+
+        //  Leftover columns
+        for (; j < j_stop; j++) {
+            float *a = a_row;
+            float *b = args->B + j * b_cs;
+            float acc = 0;
+            for (int k = 0; k < K; k++) {
+                acc += (*a) * (*b);
+                a += a_cs;
+                b += b_rs;
+            }
+            transformer_mm_fp32_epilogue(args, i, j, acc);
+        }
+
+        //  The core owning the first column of a row also reduces the row of A
+        if (args->row_sum != NULL && j_start == 0) {
+            float sum = 0;
+            float *a = a_row;
+            for (int k = 0; k < K; k++) {
+                sum += *a;
+                a += a_cs;
+            }
+            args->row_sum[i] = sum;
+        }
+    }
+}
+
+
+void transformer_layernorm_fw_fp32(void *transformer_ln_args) {
+    struct transformer_ln_args *args = (struct transformer_ln_args *) transformer_ln_args;
+
+    const int L = args->L;
+    const int E = args->E;
+
+    const int blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    const int start = pi_core_id() * blockSize;
+    const int stop = start + blockSize > L ? L : start + blockSize;
+
+    for (int l = start; l < stop; l++) {
+        float *x = args->x + l * E;
+        float *out = args->out + l * E;
+
+        float mean = 0;
+        for (int e = 0; e < E; e++)
+            mean += x[e];
+        mean /= E;
+
+        float var = 0;
+        for (int e = 0; e < E; e++)
+            var += (x[e] - mean) * (x[e] - mean);
+        var /= E;
+
+        float rstd = 1.0f / sqrtf(var + args->eps);
+        args->stats[2 * l] = mean;
+        args->stats[2 * l + 1] = rstd;
+
+        for (int e = 0; e < E; e++)
+            out[e] = (x[e] - mean) * rstd * args->weight[e] + args->bias[e];
+    }
+}
+
+
+void transformer_layernorm_bw_fp32(void *transformer_ln_args) {
+    struct transformer_ln_args *args = (struct transformer_ln_args *) transformer_ln_args;
+
+    const int L = args->L;
+    const int E = args->E;
+    float *stats = args->stats;
+    float *dout = args->out_diff;
+
+    //  Weight gradients, parallel on the features
+    int blockSize = (E + NUM_CORES - 1) / NUM_CORES;
+    int start = pi_core_id() * blockSize;
+    int stop = start + blockSize > E ? E : start + blockSize;
+
+    for (int e = start; e < stop; e++) {
+        float dw = 0, db = 0;
+        for (int l = 0; l < L; l++) {
+            float xhat = (args->x[l * E + e] - stats[2 * l]) * stats[2 * l + 1];
+            dw += dout[l * E + e] * xhat;
+            db += dout[l * E + e];
+        }
+        args->weight_diff[e] = dw;
+        args->bias_diff[e] = db;
+    }
+
+    //  Input gradient, parallel on the tokens: dx = rstd * (w*dout - mean(w*dout) - xhat * mean(w*dout*xhat))
+    blockSize = (L + NUM_CORES - 1) / NUM_CORES;
+    start = pi_core_id() * blockSize;
+    stop = start + blockSize > L ? L : start + blockSize;
+
+    for (int l = start; l < stop; l++) {
+        float *x = args->x + l * E;
+        float *dy = dout + l * E;
+        float mean = stats[2 * l];
+        float rstd = stats[2 * l + 1];
+
+        float sum = 0, sum_xhat = 0;
+        for (int e = 0; e < E; e++) {
+            float wdy = args->weight[e] * dy[e];
+            sum += wdy;
+            sum_xhat += wdy * (x[e] - mean) * rstd;
+        }
+        sum /= E;
+        sum_xhat /= E;
+
+        for (int e = 0; e < E; e++) {
+            float xhat = (x[e] - mean) * rstd;
+            args->in_diff[l * E + e] = args->in_diff_add[l * E + e] + rstd * (args->weight[e] * dy[e] - sum - xhat * sum_xhat);
+        }
+    }
+}
@@ -27,6 +27,8 @@
 // Tanh data
 PI_L1 struct act_args act_args;
 PI_L1 struct leakyrelu_args leakyrelu_args;
+PI_L1 struct relu_mask_args relu_mask_args;
+PI_L1 struct leakyrelu_mask_args leakyrelu_mask_args;
 PI_L1 struct tanh_args tanh_args;
 
 // ReLU
@@ -61,6 +63,9 @@ PI_L1 float sigmoid_in_grad[IN_SIZE];
 PI_L1 struct blob gelu_in_blob;
 PI_L1 struct blob gelu_out_blob;
 PI_L1 float gelu_out[OUT_SIZE];
+PI_L1 float gelu_in_grad[IN_SIZE];
+PI_L1 float gelu_deriv[IN_SIZE];
+PI_L1 struct gelu_train_args gelu_args;
 
 PI_L1 float tanh_out[OUT_SIZE];
 
@@ -70,10 +75,38 @@ PI_L1 float leakyrelu_out[OUT_SIZE];
 PI_L1 float leakyrelu_out_grad[OUT_SIZE];
 PI_L1 float leakyrelu_in_grad[IN_SIZE];
 
+// Hard-Sigmoid, Hard-Swish and SiLU
+PI_L1 struct blob hsigmoid_in_blob;
+PI_L1 struct blob hsigmoid_out_blob;
+PI_L1 float hsigmoid_out[OUT_SIZE];
+PI_L1 float hsigmoid_in_grad[IN_SIZE];
+
+PI_L1 struct blob hswish_in_blob;
+PI_L1 struct blob hswish_out_blob;
+PI_L1 float hswish_out[OUT_SIZE];
+PI_L1 float hswish_in_grad[IN_SIZE];
+
+PI_L1 struct blob silu_in_blob;
+PI_L1 struct blob silu_out_blob;
+PI_L1 float silu_out[OUT_SIZE];
+PI_L1 float silu_in_grad[IN_SIZE];
+
+// SwiGLU
+PI_L1 struct blob swiglu_in1_blob;
+PI_L1 struct blob swiglu_in2_blob;
+PI_L1 struct blob swiglu_out_blob;
+PI_L1 float swiglu_out[OUT_SIZE];
+PI_L1 float swiglu_in1_grad[IN_SIZE];
+PI_L1 float swiglu_in2_grad[IN_SIZE];
+PI_L1 float swiglu_sig[IN_SIZE];
+PI_L1 struct swiglu_train_args swiglu_args;
+
 #elif DATA_TYPE == FP16
 // Inout data
 PI_L1 struct act_args_fp16 act_args;
 PI_L1 struct leakyrelu_args_fp16 leakyrelu_args;
+PI_L1 struct relu_mask_args_fp16 relu_mask_args;
+PI_L1 struct leakyrelu_mask_args_fp16 leakyrelu_mask_args;
 PI_L1 struct softmax_args_fp16 softmax_args;
 PI_L1 struct tanh_args_fp16 tanh_args;
 
@@ -100,6 +133,9 @@ PI_L1 fp16 sigmoid_in_grad[IN_SIZE];
 PI_L1 struct blob_fp16 gelu_in_blob;
 PI_L1 struct blob_fp16 gelu_out_blob;
 PI_L1 fp16 gelu_out[OUT_SIZE];
+PI_L1 fp16 gelu_in_grad[IN_SIZE];
+PI_L1 fp16 gelu_deriv[IN_SIZE];
+PI_L1 struct gelu_train_args_fp16 gelu_args;
 
 PI_L1 fp16 tanh_out[OUT_SIZE];
 
@@ -109,9 +145,38 @@ PI_L1 fp16 leakyrelu_out[OUT_SIZE];
 PI_L1 fp16 leakyrelu_out_grad[OUT_SIZE];
 PI_L1 fp16 leakyrelu_in_grad[IN_SIZE];
 
+// Hard-Sigmoid, Hard-Swish and SiLU
+PI_L1 struct blob_fp16 hsigmoid_in_blob;
+PI_L1 struct blob_fp16 hsigmoid_out_blob;
+PI_L1 fp16 hsigmoid_out[OUT_SIZE];
+PI_L1 fp16 hsigmoid_in_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 hswish_in_blob;
+PI_L1 struct blob_fp16 hswish_out_blob;
+PI_L1 fp16 hswish_out[OUT_SIZE];
+PI_L1 fp16 hswish_in_grad[IN_SIZE];
+
+PI_L1 struct blob_fp16 silu_in_blob;
+PI_L1 struct blob_fp16 silu_out_blob;
+PI_L1 fp16 silu_out[OUT_SIZE];
+PI_L1 fp16 silu_in_grad[IN_SIZE];
+
+// SwiGLU
+PI_L1 struct blob_fp16 swiglu_in1_blob;
+PI_L1 struct blob_fp16 swiglu_in2_blob;
+PI_L1 struct blob_fp16 swiglu_out_blob;
+PI_L1 fp16 swiglu_out[OUT_SIZE];
+PI_L1 fp16 swiglu_in1_grad[IN_SIZE];
+PI_L1 fp16 swiglu_in2_grad[IN_SIZE];
+PI_L1 fp16 swiglu_sig[IN_SIZE];
+PI_L1 struct swiglu_train_args_fp16 swiglu_args;
+
 #else
 #endif
 
+// 1-bit activation mask (ReLU, LeakyReLU)
+PI_L1 uint32_t act_mask[ACT_MASK_WORDS(IN_SIZE)];
+
 
 void prepare_data() {
     // Initialize to 0
@@ -181,12 +246,14 @@ void prepare_data() {
 
     // GELU args
     gelu_in_blob.data = GELU_IN;
+    gelu_in_blob.diff = gelu_in_grad;
     gelu_in_blob.dim = Tin_C * Tin_H * Tin_W;
     gelu_in_blob.H = Tin_H;
     gelu_in_blob.W = Tin_W;
     gelu_in_blob.C = Tin_C;
 
     gelu_out_blob.data = gelu_out;
+    gelu_out_blob.diff = GELU_OUTPUT_GRAD;
     gelu_out_blob.dim = Tout_C * Tout_H * Tout_W;
     gelu_out_blob.H = Tout_H;
     gelu_out_blob.W = Tout_W;
@@ -206,6 +273,78 @@ void prepare_data() {
     leakyrelu_out_blob.H = Tout_H;
     leakyrelu_out_blob.W = Tout_W;
     leakyrelu_out_blob.C = Tout_C;
+
+    // Hard-Sigmoid args
+    hsigmoid_in_blob.data = HSIGMOID_IN;
+    hsigmoid_in_blob.diff = hsigmoid_in_grad;
+    hsigmoid_in_blob.dim = Tin_C * Tin_H * Tin_W;
+    hsigmoid_in_blob.H = Tin_H;
+    hsigmoid_in_blob.W = Tin_W;
+    hsigmoid_in_blob.C = Tin_C;
+
+    hsigmoid_out_blob.data = hsigmoid_out;
+    hsigmoid_out_blob.diff = HSIGMOID_OUTPUT_GRAD;
+    hsigmoid_out_blob.dim = Tout_C * Tout_H * Tout_W;
+    hsigmoid_out_blob.H = Tout_H;
+    hsigmoid_out_blob.W = Tout_W;
+    hsigmoid_out_blob.C = Tout_C;
+
+    // Hard-Swish args
+    hswish_in_blob.data = HSWISH_IN;
+    hswish_in_blob.diff = hswish_in_grad;
+    hswish_in_blob.dim = Tin_C * Tin_H * Tin_W;
+    hswish_in_blob.H = Tin_H;
+    hswish_in_blob.W = Tin_W;
+    hswish_in_blob.C = Tin_C;
+
+    hswish_out_blob.data = hswish_out;
+    hswish_out_blob.diff = HSWISH_OUTPUT_GRAD;
+    hswish_out_blob.dim = Tout_C * Tout_H * Tout_W;
+    hswish_out_blob.H = Tout_H;
+    hswish_out_blob.W = Tout_W;
+    hswish_out_blob.C = Tout_C;
+
+    // SiLU args
+    silu_in_blob.data = SILU_IN;
+    silu_in_blob.diff = silu_in_grad;
+    silu_in_blob.dim = Tin_C * Tin_H * Tin_W;
+    silu_in_blob.H = Tin_H;
+    silu_in_blob.W = Tin_W;
+    silu_in_blob.C = Tin_C;
+
+    silu_out_blob.data = silu_out;
+    silu_out_blob.diff = SILU_OUTPUT_GRAD;
+    silu_out_blob.dim = Tout_C * Tout_H * Tout_W;
+    silu_out_blob.H = Tout_H;
+    silu_out_blob.W = Tout_W;
+    silu_out_blob.C = Tout_C;
+
+    // SwiGLU args (the forward pass caches the sigmoid of the first input for the backward pass)
+    swiglu_in1_blob.data = SWIGLU_IN1;
+    swiglu_in1_blob.diff = swiglu_in1_grad;
+    swiglu_in1_blob.dim = Tin_C * Tin_H * Tin_W;
+    swiglu_in1_blob.H = Tin_H;
+    swiglu_in1_blob.W = Tin_W;
+    swiglu_in1_blob.C = Tin_C;
+
+    swiglu_in2_blob.data = SWIGLU_IN2;
+    swiglu_in2_blob.diff = swiglu_in2_grad;
+    swiglu_in2_blob.dim = Tin_C * Tin_H * Tin_W;
+    swiglu_in2_blob.H = Tin_H;
+    swiglu_in2_blob.W = Tin_W;
+    swiglu_in2_blob.C = Tin_C;
+
+    swiglu_out_blob.data = swiglu_out;
+    swiglu_out_blob.diff = SWIGLU_OUTPUT_GRAD;
+    swiglu_out_blob.dim = Tout_C * Tout_H * Tout_W;
+    swiglu_out_blob.H = Tout_H;
+    swiglu_out_blob.W = Tout_W;
+    swiglu_out_blob.C = Tout_C;
+
+    swiglu_args.in1 = &swiglu_in1_blob;
+    swiglu_args.in2 = &swiglu_in2_blob;
+    swiglu_args.output = &swiglu_out_blob;
+    swiglu_args.sig = swiglu_sig;
 }
 
 
@@ -282,6 +421,65 @@ void net_step() {
 #else
 #endif
 
+
+    // ~~~~~~~~~~ Verify ReLU activation with 1-bit mask ~~~~~~~~~~
+    printf("\n----- RELU WITH 1-BIT MASK RESULTS -----\n");
+
+    // Prepare struct (the backward pass only uses the mask, not the input data)
+    relu_mask_args.input = &relu_in_blob;
+    relu_mask_args.output = &relu_out_blob;
+    relu_mask_args.mask = act_mask;
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_relu_mask_fp32_fw_cl(&relu_mask_args);
+#elif DATA_TYPE == FP16
+    pulp_relu_mask_fp16_fw_cl(&relu_mask_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(relu_out, RELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(relu_out, RELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_relu_mask_fp32_bw_cl(&relu_mask_args);
+#elif DATA_TYPE == FP16
+    pulp_relu_mask_fp16_bw_cl(&relu_mask_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(relu_in_grad, RELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(relu_in_grad, RELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+#endif
+
     // ~~~~~~~~~~ Verify softmax activation ~~~~~~~~~~
     printf("\n----- SOFTMAX RESULTS -----\n");
 
@@ -352,6 +550,36 @@ void net_step() {
 #endif
 
 
+    // ~~~~~~~~~~ Verify online softmax activation ~~~~~~~~~~
+    printf("\n----- ONLINE SOFTMAX RESULTS -----\n");
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+    // Apply online softmax activation (reuses the softmax struct)
+#if DATA_TYPE == FP32
+    pulp_softmax_online_fp32_fw_cl(&softmax_args);
+#elif DATA_TYPE == FP16
+    pulp_softmax_online_fp16_fw_cl(&softmax_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(softmax_out, SOFTMOUTPUT, SOFTMAX_OUT_SIZE, SOFTMAX_ONLINE_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(softmax_out, SOFTMOUTPUT, SOFTMAX_OUT_SIZE, SOFTMAX_ONLINE_ERROR_TOLERANCE);
+#endif
+
+
     // ~~~~~~~~~~ Verify sigmoid activation ~~~~~~~~~~
     printf("\n----- SIGMOID RESULTS -----\n");
 
@@ -431,7 +659,9 @@ void net_step() {
 
     // Apply GELU activation
 #if DATA_TYPE == FP32
-    pulp_gelu_tanh_approx_fp32_fw_cl(&act_args);
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_tanh_approx_fp32_fw_cl, &act_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_fw_cl, &act_args);
 #endif
 
     // Stop the statistics for the forward pass
@@ -443,6 +673,45 @@ void net_step() {
     printf("\nChecking output..\n");
 #if DATA_TYPE == FP32
     verify_tensor(gelu_out, GELU_OUTPUT, OUT_SIZE, GELU_TANH_APPROX_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(gelu_out, GELU_OUTPUT, OUT_SIZE, GELU_TANH_APPROX_ERROR_TOLERANCE);
+#endif
+
+    // Prepare GELU struct for training (the forward pass stores gelu'(x) for the backward pass)
+    gelu_args.input = &gelu_in_blob;
+    gelu_args.output = &gelu_out_blob;
+    gelu_args.deriv = gelu_deriv;
+
+#if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_tanh_approx_fp32_fw_cache_cl, &gelu_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_fw_cache_cl, &gelu_args);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+    // Compute gradient for GELU
+#if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_tanh_approx_fp32_bw_cl, &gelu_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_fp16_bw_cl, &gelu_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(gelu_in_grad, GELU_IN_GRAD, IN_SIZE, GELU_TANH_APPROX_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(gelu_in_grad, GELU_IN_GRAD, IN_SIZE, GELU_TANH_APPROX_ERROR_TOLERANCE);
 #endif
 
     // ~~~~~~~~~~ Verify tanh activation ~~~~~~~~~~
@@ -462,6 +731,8 @@ void net_step() {
     // Apply TANH activation
 #if DATA_TYPE == FP32
     pi_cl_team_fork(NUM_CORES, tanh_prll, &tanh_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, tanh_prll_fp16, &tanh_args);
 #endif
 
     // Stop the statistics for the forward pass
@@ -473,6 +744,8 @@ void net_step() {
     printf("\nChecking output..\n");
 #if DATA_TYPE == FP32
     verify_tensor(tanh_out, TANH_OUTPUT, OUT_SIZE, TANH_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(tanh_out, TANH_OUTPUT, OUT_SIZE, TANH_ERROR_TOLERANCE);
 #endif
 
     // ~~~~~~~~~~ Verify LeakyReLU activation ~~~~~~~~~~
@@ -539,5 +812,296 @@ void net_step() {
     #else
     #endif
 
+
+    // ~~~~~~~~~~ Verify LeakyReLU activation with 1-bit mask ~~~~~~~~~~
+    printf("\n----- LEAKYRELU WITH 1-BIT MASK RESULTS -----\n");
+
+    // Prepare struct (the backward pass only uses the mask, not the input data)
+    leakyrelu_mask_args.input = &leakyrelu_in_blob;
+    leakyrelu_mask_args.output = &leakyrelu_out_blob;
+    leakyrelu_mask_args.negative_slope = 0.01;
+    leakyrelu_mask_args.mask = act_mask;
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_leakyrelu_mask_fp32_fw_cl(&leakyrelu_mask_args);
+#elif DATA_TYPE == FP16
+    pulp_leakyrelu_mask_fp16_fw_cl(&leakyrelu_mask_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(leakyrelu_out, LEAKYRELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(leakyrelu_out, LEAKYRELUOUTPUT, OUT_SIZE, ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_leakyrelu_mask_fp32_bw_cl(&leakyrelu_mask_args);
+#elif DATA_TYPE == FP16
+    pulp_leakyrelu_mask_fp16_bw_cl(&leakyrelu_mask_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(leakyrelu_in_grad, LEAKYRELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(leakyrelu_in_grad, LEAKYRELUIN_GRAD, IN_SIZE, ERROR_TOLERANCE);
+#endif
+
+    // ~~~~~~~~~~ Verify hsigmoid activation ~~~~~~~~~~
+    printf("\n----- HSIGMOID RESULTS -----\n");
+
+    // Prepare struct (the backward pass computes the derivative from the input data)
+    act_args.input = &hsigmoid_in_blob;
+    act_args.output = &hsigmoid_out_blob;
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_hsigmoid_fp32_fw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_hsigmoid_fp16_fw_cl(&act_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(hsigmoid_out, HSIGMOID_OUTPUT, OUT_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(hsigmoid_out, HSIGMOID_OUTPUT, OUT_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_hsigmoid_fp32_bw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_hsigmoid_fp16_bw_cl(&act_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(hsigmoid_in_grad, HSIGMOID_IN_GRAD, IN_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(hsigmoid_in_grad, HSIGMOID_IN_GRAD, IN_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#endif
+
+    // ~~~~~~~~~~ Verify hswish activation ~~~~~~~~~~
+    printf("\n----- HSWISH RESULTS -----\n");
+
+    // Prepare struct (the backward pass computes the derivative from the input data)
+    act_args.input = &hswish_in_blob;
+    act_args.output = &hswish_out_blob;
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_hswish_fp32_fw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_hswish_fp16_fw_cl(&act_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(hswish_out, HSWISH_OUTPUT, OUT_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(hswish_out, HSWISH_OUTPUT, OUT_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_hswish_fp32_bw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_hswish_fp16_bw_cl(&act_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(hswish_in_grad, HSWISH_IN_GRAD, IN_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(hswish_in_grad, HSWISH_IN_GRAD, IN_SIZE, HARD_ACT_ERROR_TOLERANCE);
+#endif
+
+    // ~~~~~~~~~~ Verify silu activation ~~~~~~~~~~
+    printf("\n----- SILU RESULTS -----\n");
+
+    // Prepare struct (the backward pass computes the derivative from the input data)
+    act_args.input = &silu_in_blob;
+    act_args.output = &silu_out_blob;
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_silu_fp32_fw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_silu_fp16_fw_cl(&act_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(silu_out, SILU_OUTPUT, OUT_SIZE, SILU_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(silu_out, SILU_OUTPUT, OUT_SIZE, SILU_ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pulp_silu_fp32_bw_cl(&act_args);
+#elif DATA_TYPE == FP16
+    pulp_silu_fp16_bw_cl(&act_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(silu_in_grad, SILU_IN_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(silu_in_grad, SILU_IN_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#endif
+
+    // ~~~~~~~~~~ Verify swiglu activation ~~~~~~~~~~
+    printf("\n----- SWIGLU RESULTS -----\n");
+
+    // Print statistics for forward pass
+#ifdef PROF_NET
+    printf("Forward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp32_fw_cache_cl, &swiglu_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp16_fw_cache_cl, &swiglu_args);
+#endif
+
+    // Stop the statistics for the forward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check output match
+    printf("\nChecking output..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(swiglu_out, SWIGLU_OUTPUT, OUT_SIZE, SILU_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(swiglu_out, SWIGLU_OUTPUT, OUT_SIZE, SILU_ERROR_TOLERANCE);
+#endif
+
+    // Initialize profiler for backward pass
+#ifdef PROF_NET
+    printf("\nBackward stats: \n");
+    START_STATS();
+#endif
+
+#if DATA_TYPE == FP32
+    pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp32_bw_cl, &swiglu_args);
+#elif DATA_TYPE == FP16
+    pi_cl_team_fork(NUM_CORES, pulp_swiglu_fp16_bw_cl, &swiglu_args);
+#endif
+
+    // Stop statistics for backward pass
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    // Check gradient match
+    printf("\nChecking in1 grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(swiglu_in1_grad, SWIGLU_IN1_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(swiglu_in1_grad, SWIGLU_IN1_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#endif
+
+    printf("\nChecking in2 grad..\n");
+#if DATA_TYPE == FP32
+    verify_tensor(swiglu_in2_grad, SWIGLU_IN2_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#elif DATA_TYPE == FP16
+    verify_tensor_fp16(swiglu_in2_grad, SWIGLU_IN2_GRAD, IN_SIZE, SILU_ERROR_TOLERANCE);
+#endif
+
     return;
 }
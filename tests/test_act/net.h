@@ -27,9 +27,30 @@
 
     #define TANH_CHECK_TOLERANCE 1e-4
     #define TANH_ERROR_TOLERANCE 1e-4
+
+    // The golden model uses the fast exponential, the online softmax uses expf unless FASTEXPF is defined
+    #define SOFTMAX_ONLINE_ERROR_TOLERANCE 1e-2
+
+    // The hard activations multiply by 1/6 instead of dividing by 6
+    #define HARD_ACT_ERROR_TOLERANCE 1e-5
+
+    // SiLU and SwiGLU use expf (or the fast exponential with FASTEXPF), not the exact sigmoid of the golden model
+    #define SILU_ERROR_TOLERANCE 1e-4
 #elif DATA_TYPE == FP16
     #define CHECK_TOLERANCE 1e-2
     #define ERROR_TOLERANCE 1e-2
+
+    #define GELU_TANH_APPROX_CHECK_TOLERANCE 2e-2
+    #define GELU_TANH_APPROX_ERROR_TOLERANCE 2e-2
+
+    #define TANH_CHECK_TOLERANCE 1e-2
+    #define TANH_ERROR_TOLERANCE 1e-2
+
+    #define SOFTMAX_ONLINE_ERROR_TOLERANCE 1e-2
+
+    // Outputs and gradients of the hard activations, SiLU and SwiGLU reach ~5, where an ulp of bf16 is 3e-2
+    #define HARD_ACT_ERROR_TOLERANCE 5e-2
+    #define SILU_ERROR_TOLERANCE 5e-2
 #endif
 
 
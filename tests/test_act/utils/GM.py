@@ -84,6 +84,42 @@ class tanh_model(nn.Module):
         return self.tanh(x)
 
 
+class HSigmoid(nn.Module):
+    def __init__(self):
+        super(HSigmoid, self).__init__()
+        self.hsigmoid = nn.Hardsigmoid()
+
+    def forward(self, x):
+        return self.hsigmoid(x)
+
+
+class HSwish(nn.Module):
+    def __init__(self):
+        super(HSwish, self).__init__()
+        self.hswish = nn.Hardswish()
+
+    def forward(self, x):
+        return self.hswish(x)
+
+
+class SiLU(nn.Module):
+    def __init__(self):
+        super(SiLU, self).__init__()
+        self.silu = nn.SiLU()
+
+    def forward(self, x):
+        return self.silu(x)
+
+
+class SwiGLU(nn.Module):
+    def __init__(self):
+        super(SwiGLU, self).__init__()
+        self.silu = nn.SiLU()
+
+    def forward(self, x1, x2):
+        return self.silu(x1) * x2
+
+
 def main():
     # Parse and store the arguments
     parser = argparse.ArgumentParser("Activations tests")
@@ -109,6 +145,13 @@ def main():
     gelu_input = torch.ones(in_c, in_h, in_w)
     tanh_input = torch.ones(in_c, in_h, in_w)
     leakyrelu_input = torch.ones(in_c, in_h, in_w)
+    # The hard activations are piecewise, their input spans [-3.75, 3.75] to cover every piece
+    hsigmoid_input = torch.zeros(in_c, in_h, in_w)
+    hswish_input = torch.zeros(in_c, in_h, in_w)
+    silu_input = torch.zeros(in_c, in_h, in_w)
+    # SwiGLU gates a second input with the SiLU of the first one
+    swiglu_input1 = torch.zeros(in_c, in_h, in_w)
+    swiglu_input2 = torch.zeros(in_c, in_h, in_w)
 
     with torch.no_grad():
         for i in range(in_h):
@@ -121,6 +164,11 @@ def main():
                     sigmoid_input[k, i, j] += (i + j + k) * value
                     gelu_input[k, i, j] += (i + j + k) * value
                     tanh_input[k, i, j] += (i + j + k) * value
+                    hsigmoid_input[k, i, j] = ((k * in_h * in_w + i * in_w + j) % 16) * 0.5 - 3.75
+                    hswish_input[k, i, j] = ((k * in_h * in_w + i * in_w + j) % 16) * 0.5 - 3.75
+                    silu_input[k, i, j] = ((k * in_h * in_w + i * in_w + j) % 16) * 0.5 - 3.75
+                    swiglu_input1[k, i, j] = ((k * in_h * in_w + i * in_w + j) % 16) * 0.5 - 3.75
+                    swiglu_input2[k, i, j] = ((k * in_h * in_w + i * in_w + j) % 7) * 0.25 - 0.75
 
     print("relu_input:")
     print(relu_input)
@@ -134,6 +182,12 @@ def main():
     print(tanh_input)
     print("leakyrelu_input:")
     print(leakyrelu_input)
+    print("hsigmoid_input:")
+    print(hsigmoid_input)
+    print("hswish_input:")
+    print(hswish_input)
+    print("silu_input:")
+    print(silu_input)
 
     # Generate fake labels
     relu_label = torch.ones(in_c, int(in_h), int(in_w))
@@ -142,6 +196,10 @@ def main():
     gelu_label = torch.ones(in_c, int(in_h), int(in_w))
     tanh_label = torch.ones(in_c, int(in_h), int(in_w))
     leakyrelu_label = torch.ones(in_c, int(in_h), int(in_w))
+    hsigmoid_label = torch.ones(in_c, int(in_h), int(in_w))
+    hswish_label = torch.ones(in_c, int(in_h), int(in_w))
+    silu_label = torch.ones(in_c, int(in_h), int(in_w))
+    swiglu_label = torch.ones(in_c, int(in_h), int(in_w))
 
     print("relu_label:")
     print(relu_label.size())
@@ -162,9 +220,16 @@ def main():
     gelu_input.requires_grad = True
     tanh_input.requires_grad = True
     leakyrelu_input.requires_grad = True
+    hsigmoid_input.requires_grad = True
+    hswish_input.requires_grad = True
+    silu_input.requires_grad = True
+    swiglu_input1.requires_grad = True
+    swiglu_input2.requires_grad = True
 
     # Define loss function
     loss_fn = nn.MSELoss()
+    # The new activations sum the loss, so that their gradients are not much smaller than the FP16 tolerance
+    sum_loss_fn = nn.MSELoss(reduction='sum')
 
     # Instantiate pooling functions
     relu = ReLU()
@@ -173,6 +238,10 @@ def main():
     gelu = GELU_model()
     tanh = tanh_model()
     leakyrelu = LeakyReLU()
+    hsigmoid = HSigmoid()
+    hswish = HSwish()
+    silu = SiLU()
+    swiglu = SwiGLU()
 
     # Compute the output and the backward of both
     relu_out = relu(relu_input)
@@ -181,6 +250,10 @@ def main():
     gelu_out = gelu(gelu_input)
     tanh_out = tanh(tanh_input)
     leakyrelu_out = relu(leakyrelu_input)
+    hsigmoid_out = hsigmoid(hsigmoid_input)
+    hswish_out = hswish(hswish_input)
+    silu_out = silu(silu_input)
+    swiglu_out = swiglu(swiglu_input1, swiglu_input2)
 
     relu_out.retain_grad()
     softmax_out.retain_grad()
@@ -188,6 +261,10 @@ def main():
     gelu_out.retain_grad()
     tanh_out.retain_grad()
     leakyrelu_out.retain_grad()
+    hsigmoid_out.retain_grad()
+    hswish_out.retain_grad()
+    silu_out.retain_grad()
+    swiglu_out.retain_grad()
 
     print("relu_out: ")
     print(relu_out.size())
@@ -208,6 +285,10 @@ def main():
     gelu_loss = loss_fn(gelu_out, gelu_label)
     tanh_loss = loss_fn(tanh_out, tanh_label)
     leakyrelu_loss = loss_fn(leakyrelu_out, leakyrelu_label)
+    hsigmoid_loss = sum_loss_fn(hsigmoid_out, hsigmoid_label)
+    hswish_loss = sum_loss_fn(hswish_out, hswish_label)
+    silu_loss = sum_loss_fn(silu_out, silu_label)
+    swiglu_loss = sum_loss_fn(swiglu_out, swiglu_label)
 
     relu_loss.backward()
     softmax_loss.backward()
@@ -215,6 +296,10 @@ def main():
     gelu_loss.backward()
     tanh_loss.backward()
     leakyrelu_loss.backward()
+    hsigmoid_loss.backward()
+    hswish_loss.backward()
+    silu_loss.backward()
+    swiglu_loss.backward()
 
     print("\n*** RELU DATA ***")
     print("ReLU out is:")
@@ -264,6 +349,32 @@ def main():
     print("tanh in grad is:")
     print(tanh_input.grad)
 
+    print("\n*** HSIGMOID DATA ***")
+    print("HSigmoid out is:")
+    print(hsigmoid_out)
+    print("HSigmoid in grad is:")
+    print(hsigmoid_input.grad)
+
+    print("\n*** HSWISH DATA ***")
+    print("HSwish out is:")
+    print(hswish_out)
+    print("HSwish in grad is:")
+    print(hswish_input.grad)
+
+    print("\n*** SILU DATA ***")
+    print("SiLU out is:")
+    print(silu_out)
+    print("SiLU in grad is:")
+    print(silu_input.grad)
+
+    print("\n*** SWIGLU DATA ***")
+    print("SwiGLU out is:")
+    print(swiglu_out)
+    print("SwiGLU in1 grad is:")
+    print(swiglu_input1.grad)
+    print("SwiGLU in2 grad is:")
+    print(swiglu_input2.grad)
+
     # Write setup to file
     f = open("init_defines.h", "w")
 
@@ -330,6 +441,28 @@ def main():
         f.write("PI_L2 float LEAKYRELUIN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(leakyrelu_input.grad) + "};\n")
         f.write("PI_L1 float LEAKYRELULABEL[OUT_SIZE] = {" + dump.tensor_to_string(leakyrelu_label) + "};\n")
 
+        f.write("PI_L2 float HSIGMOID_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(hsigmoid_out) + "};\n")
+        f.write("PI_L2 float HSIGMOID_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(hsigmoid_out.grad) + "};\n")
+        f.write("PI_L1 float HSIGMOID_IN[IN_SIZE] = {" + dump.tensor_to_string(hsigmoid_input) + "};\n")
+        f.write("PI_L2 float HSIGMOID_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(hsigmoid_input.grad) + "};\n")
+
+        f.write("PI_L2 float HSWISH_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(hswish_out) + "};\n")
+        f.write("PI_L2 float HSWISH_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(hswish_out.grad) + "};\n")
+        f.write("PI_L1 float HSWISH_IN[IN_SIZE] = {" + dump.tensor_to_string(hswish_input) + "};\n")
+        f.write("PI_L2 float HSWISH_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(hswish_input.grad) + "};\n")
+
+        f.write("PI_L2 float SILU_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(silu_out) + "};\n")
+        f.write("PI_L2 float SILU_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(silu_out.grad) + "};\n")
+        f.write("PI_L1 float SILU_IN[IN_SIZE] = {" + dump.tensor_to_string(silu_input) + "};\n")
+        f.write("PI_L2 float SILU_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(silu_input.grad) + "};\n")
+
+        f.write("PI_L2 float SWIGLU_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(swiglu_out) + "};\n")
+        f.write("PI_L2 float SWIGLU_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(swiglu_out.grad) + "};\n")
+        f.write("PI_L1 float SWIGLU_IN1[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input1) + "};\n")
+        f.write("PI_L1 float SWIGLU_IN2[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input2) + "};\n")
+        f.write("PI_L2 float SWIGLU_IN1_GRAD[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input1.grad) + "};\n")
+        f.write("PI_L2 float SWIGLU_IN2_GRAD[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input2.grad) + "};\n")
+
         f.close()
     elif data_type == 'FP16':
         # Write data to file
@@ -385,6 +518,28 @@ def main():
         f.write("PI_L2 fp16 LEAKYRELUIN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(leakyrelu_input.grad) + "};\n")
         f.write("PI_L1 fp16 LEAKYRELULABEL[OUT_SIZE] = {" + dump.tensor_to_string(leakyrelu_label) + "};\n")
 
+        f.write("PI_L2 fp16 HSIGMOID_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(hsigmoid_out.half()) + "};\n")
+        f.write("PI_L2 fp16 HSIGMOID_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(hsigmoid_out.grad.half()) + "};\n")
+        f.write("PI_L1 fp16 HSIGMOID_IN[IN_SIZE] = {" + dump.tensor_to_string(hsigmoid_input.half()) + "};\n")
+        f.write("PI_L2 fp16 HSIGMOID_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(hsigmoid_input.grad.half()) + "};\n")
+
+        f.write("PI_L2 fp16 HSWISH_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(hswish_out.half()) + "};\n")
+        f.write("PI_L2 fp16 HSWISH_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(hswish_out.grad.half()) + "};\n")
+        f.write("PI_L1 fp16 HSWISH_IN[IN_SIZE] = {" + dump.tensor_to_string(hswish_input.half()) + "};\n")
+        f.write("PI_L2 fp16 HSWISH_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(hswish_input.grad.half()) + "};\n")
+
+        f.write("PI_L2 fp16 SILU_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(silu_out.half()) + "};\n")
+        f.write("PI_L2 fp16 SILU_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(silu_out.grad.half()) + "};\n")
+        f.write("PI_L1 fp16 SILU_IN[IN_SIZE] = {" + dump.tensor_to_string(silu_input.half()) + "};\n")
+        f.write("PI_L2 fp16 SILU_IN_GRAD[IN_SIZE] = {" + dump.tensor_to_string(silu_input.grad.half()) + "};\n")
+
+        f.write("PI_L2 fp16 SWIGLU_OUTPUT[OUT_SIZE] = {" + dump.tensor_to_string(swiglu_out.half()) + "};\n")
+        f.write("PI_L2 fp16 SWIGLU_OUTPUT_GRAD[OUT_SIZE] = {" + dump.tensor_to_string(swiglu_out.grad.half()) + "};\n")
+        f.write("PI_L1 fp16 SWIGLU_IN1[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input1.half()) + "};\n")
+        f.write("PI_L1 fp16 SWIGLU_IN2[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input2.half()) + "};\n")
+        f.write("PI_L2 fp16 SWIGLU_IN1_GRAD[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input1.grad.half()) + "};\n")
+        f.write("PI_L2 fp16 SWIGLU_IN2_GRAD[IN_SIZE] = {" + dump.tensor_to_string(swiglu_input2.grad.half()) + "};\n")
+
         f.close()
 
 
@@ -0,0 +1,614 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "attention-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+#if defined(FLASH_FORWARD) || defined(FLASH_BACKWARD)
+// L1 tiles: Q tile | O tile | scores | K tile | V tile, the softmax statistics m and l are kept in FP32
+PI_L1 fp16 l1_buff[2 * Thead_dim * Ttile_q + NUM_CORES * Ttile_kv + 2 * Thead_dim * Ttile_kv];
+PI_L1 float l1_m[Ttile_q], l1_l[Ttile_q];
+PI_L1 float lse[Tn_heads * Tseq_len];
+PI_L2 fp16 attn_out[Tatt_dim * Tseq_len];
+PI_L1 pi_cl_dma_cmd_t cmd_load, cmd_store;
+#endif
+
+#ifdef FLASH_BACKWARD
+PI_L1 fp16 l1_q[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_k[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_v[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_out[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_out_diff[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_q_diff[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_k_diff[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_v_diff[Tatt_dim * Tseq_len];
+PI_L1 float l1_delta[Tseq_len];
+#endif
+
+#if defined(GQA_FORWARD) || defined(GQA_BACKWARD) || defined(KV_CACHE)
+PI_L1 fp16 l1_in[Tseq_len * Ttoken_size];
+PI_L1 fp16 l1_wq[Tatt_dim * Ttoken_size];
+PI_L1 fp16 l1_wk[Tkv_dim * Ttoken_size];
+PI_L1 fp16 l1_wv[Tkv_dim * Ttoken_size];
+PI_L1 fp16 l1_wout[Ttoken_size * Tatt_dim];
+PI_L1 fp16 l1_bq[Tatt_dim];
+PI_L1 fp16 l1_bk[Tkv_dim];
+PI_L1 fp16 l1_bv[Tkv_dim];
+PI_L1 fp16 l1_bout[Ttoken_size];
+PI_L1 fp16 l1_out[Tseq_len * Ttoken_size];
+
+PI_L1 struct blob_fp16 layer_in, layer_out, layer_wq, layer_wk, layer_wv, layer_wout, layer_bq, layer_bk, layer_bv, layer_bout;
+#endif
+
+#if defined(GQA_FORWARD) || defined(GQA_BACKWARD)
+// temp_buffer: m | l (FP32) | scores or the projected output in the forward, L x (F + E) in the backward
+#define GQA_TEMP_FW (Tseq_len * (NUM_CORES + 4) > Ttoken_size * Tseq_len ? Tseq_len * (NUM_CORES + 4) : Ttoken_size * Tseq_len)
+#define GQA_TEMP_BW (Tseq_len * (Tatt_dim + Ttoken_size))
+
+PI_L1 struct Mhsa_args_fp16 mhsa_args;
+PI_L1 struct blob_fp16 layer_q, layer_k, layer_v, layer_att_map;
+PI_L1 fp16 l1_q[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_k[Tkv_dim * Tseq_len];
+PI_L1 fp16 l1_v[Tkv_dim * Tseq_len];
+PI_L1 fp16 l1_att_map[Tatt_dim * Tseq_len];
+PI_L1 float lse[Tn_heads * Tseq_len];
+#ifdef GQA_BACKWARD
+PI_L1 fp16 l1_temp[GQA_TEMP_FW > GQA_TEMP_BW ? GQA_TEMP_FW : GQA_TEMP_BW];
+PI_L1 fp16 l1_in_diff[Tseq_len * Ttoken_size];
+PI_L1 fp16 l1_out_diff[Tseq_len * Ttoken_size];
+PI_L1 fp16 l1_wq_diff[Tatt_dim * Ttoken_size];
+PI_L1 fp16 l1_wk_diff[Tkv_dim * Ttoken_size];
+PI_L1 fp16 l1_wv_diff[Tkv_dim * Ttoken_size];
+PI_L1 fp16 l1_wout_diff[Ttoken_size * Tatt_dim];
+PI_L1 fp16 l1_q_diff[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_k_diff[Tkv_dim * Tseq_len];
+PI_L1 fp16 l1_v_diff[Tkv_dim * Tseq_len];
+PI_L1 fp16 l1_att_map_diff[Tatt_dim * Tseq_len];
+#else
+PI_L1 fp16 l1_temp[GQA_TEMP_FW];
+#endif
+#endif
+
+#ifdef KV_CACHE
+PI_L1 struct Mhsa_kv_cache_args_fp16 kv_args;
+PI_L1 fp16 l1_k_cache[Tseq_len * Tatt_dim];
+PI_L1 fp16 l1_v_cache[Tseq_len * Tatt_dim];
+PI_L2 fp16 l2_k_cache[Tseq_len * Tatt_dim];
+PI_L2 fp16 l2_v_cache[Tseq_len * Tatt_dim];
+PI_L1 fp16 l1_q[Tprefill * Tatt_dim];
+PI_L1 fp16 l1_kv_new[2 * Tprefill * Tatt_dim];
+PI_L1 fp16 l1_att_map[Tprefill * Tatt_dim];
+PI_L1 fp16 l1_temp[(Thead_dim + 6) * NUM_CORES + 4];
+PI_L1 fp16 l1_cache_buff[4 * Thead_dim * Ttile_kv];
+PI_L1 pi_cl_dma_cmd_t cmd_store;
+#endif
+
+#if defined(DB_FORWARD) || defined(DB_BACKWARD)
+// Buffers of the double-buffered layer, sized for both passes
+#define DB_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define TILE_QKV (3 * Tatt_dim / Tn_tiles)
+#define DB_BUFF1 DB_MAX(TILE_QKV * (Ttoken_size + Tseq_len), 3 * Thead_dim * Tseq_len + Tseq_len * Tseq_len)
+#define DB_BUFF2 DB_MAX(DB_MAX(TILE_QKV * Tseq_len, TILE_QKV * Ttoken_size), DB_MAX(Thead_dim * Tseq_len + Tseq_len * Tseq_len, 3 * Thead_dim * Tseq_len))
+#define DB_TEMP DB_MAX(Tseq_len * Tseq_len, DB_MAX(Ttoken_size * Tatt_dim, Ttoken_size * TILE_QKV))
+#define DB_HEAD DB_MAX(Tseq_len * Tseq_len, Ttoken_size * Tseq_len)
+
+PI_L1 struct Mhsa_args_fp16_db db_args;
+PI_L1 struct blob_fp16 layer_in, layer_out, layer_wqkv, layer_wout, layer_qkv, layer_att_map, layer_att_map_l2;
+PI_L1 struct blob_fp16 layer_buff1_a, layer_buff1_b, layer_buff2_a, layer_buff2_b, layer_head, layer_softmax;
+PI_L1 fp16 l1_in[Ttoken_size * Tseq_len];
+PI_L1 fp16 l1_wout[Ttoken_size * Tatt_dim];
+PI_L1 fp16 l1_out[Ttoken_size * Tseq_len];
+PI_L1 fp16 l1_att_map[Tatt_dim * Tseq_len];
+PI_L1 fp16 l1_buff1_a[DB_BUFF1], l1_buff1_b[DB_BUFF1];
+PI_L1 fp16 l1_buff2_a[DB_BUFF2], l1_buff2_b[DB_BUFF2];
+PI_L1 fp16 l1_temp[DB_TEMP];
+PI_L1 fp16 l1_head[DB_HEAD];
+PI_L1 fp16 l1_maxes[Tseq_len], l1_sums[Tseq_len];
+PI_L2 fp16 l2_qkv[3 * Tatt_dim * Tseq_len];
+PI_L2 fp16 l2_att_map[Tatt_dim * Tseq_len];
+PI_L2 fp16 l2_softmax[Tn_heads * Tseq_len * Tseq_len];
+#ifdef DB_BACKWARD
+PI_L1 fp16 l1_in_diff[Ttoken_size * Tseq_len];
+PI_L1 fp16 l1_out_diff[Ttoken_size * Tseq_len];
+PI_L1 fp16 l1_wout_diff[Ttoken_size * Tatt_dim];
+PI_L1 fp16 l1_att_map_diff[Tatt_dim * Tseq_len];
+PI_L2 fp16 l2_wqkv_diff[3 * Tatt_dim * Ttoken_size];
+PI_L2 fp16 l2_qkv_diff[3 * Tatt_dim * Tseq_len];
+#endif
+#endif
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+// Mean error checker - relative to the mean magnitude of the reference, elements close to 0 do not blow it up
+static inline void check(char *name, fp16 *tensor_out, fp16 *tensor_ref, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - (float) tensor_ref[i];
+        err += diff > 0 ? diff : -diff;
+        norm += tensor_ref[i] > 0 ? (float) tensor_ref[i] : -(float) tensor_ref[i];
+    }
+    err = err / norm;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+static inline void copy_tensor(fp16 *dst, fp16 *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+
+#if defined(FLASH_FORWARD) || defined(FLASH_BACKWARD)
+// First key tile after t seen by the queries [r0, r1), N_TILES_KV if none
+static int next_kv_tile(int r0, int r1, int t) {
+    for (t = t + 1; t < N_TILES_KV; t++) {
+        int c0 = t * Ttile_kv;
+        int c1 = c0 + Ttile_kv < Tseq_len ? c0 + Ttile_kv : Tseq_len;
+        if (mhsa_mask_tile(Tmask_type, Tmask_window, Tmask_block, MASK_LAYOUT, Tseq_len, r0, r1, c0, c1) != MHSA_TILE_SKIP)
+            break;
+    }
+    return t;
+}
+
+// Tiled attention forward of all the heads: Br x Bc tiles of Q and K/V (the last ones may be shorter) are loaded in L1,
+// the fully masked tiles are skipped
+static void flash_attn_forward(fp16 *q, fp16 *k, fp16 *v, fp16 *out) {
+    fp16 *q_l1 = l1_buff;
+    fp16 *o_l1 = q_l1 + Thead_dim * Ttile_q;
+    fp16 *s_l1 = o_l1 + Thead_dim * Ttile_q;
+    fp16 *k_l1 = s_l1 + NUM_CORES * Ttile_kv;
+    fp16 *v_l1 = k_l1 + Thead_dim * Ttile_kv;
+
+    struct flash_attn_args_fp16 fa_args;
+    fa_args.q = q_l1;
+    fa_args.k = k_l1;
+    fa_args.v = v_l1;
+    fa_args.out = o_l1;
+    fa_args.scores = s_l1;
+    fa_args.m = l1_m;
+    fa_args.l = l1_l;
+    fa_args.H = Thead_dim;
+    fa_args.scaling = (fp16) q_rsqrt_fp16((float) Thead_dim);
+    fa_args.mask_type = Tmask_type;
+    fa_args.mask_window = Tmask_window;
+    fa_args.mask_block = Tmask_block;
+    fa_args.mask_layout = MASK_LAYOUT;
+    fa_args.L = Tseq_len;
+
+    for (int i = 0; i < Tn_heads; i++) {
+        fp16 *q_head = q + i * Thead_dim * Tseq_len;
+        fp16 *k_head = k + i * Thead_dim * Tseq_len;
+        fp16 *v_head = v + i * Thead_dim * Tseq_len;
+
+        for (int r0 = 0; r0 < Tseq_len; r0 += Ttile_q) {
+            int br = r0 + Ttile_q < Tseq_len ? Ttile_q : Tseq_len - r0;
+            int t_kv = next_kv_tile(r0, r0 + br, -1);
+
+            pi_cl_dma_cmd_2d((uint32_t) (q_head + r0), (uint32_t) q_l1, 2 * Thead_dim * br, 2 * Tseq_len, 2 * br, PI_CL_DMA_DIR_EXT2LOC, &cmd_load);
+            pi_cl_dma_cmd_wait(&cmd_load);
+            //  No key is seen by the query tile
+            if (t_kv == N_TILES_KV)
+                for (int j = 0; j < Thead_dim * br; j++)
+                    o_l1[j] = 0;
+
+            fa_args.Br = br;
+            fa_args.row0 = r0;
+            fa_args.lse = lse + i * Tseq_len + r0;
+            fa_args.first = 1;
+            while (t_kv < N_TILES_KV) {
+                int t_next = next_kv_tile(r0, r0 + br, t_kv);
+                int c0 = t_kv * Ttile_kv;
+                int bc = c0 + Ttile_kv < Tseq_len ? Ttile_kv : Tseq_len - c0;
+
+                pi_cl_dma_cmd_2d((uint32_t) (k_head + c0), (uint32_t) k_l1, 2 * Thead_dim * bc, 2 * Tseq_len, 2 * bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_load);
+                pi_cl_dma_cmd_wait(&cmd_load);
+                pi_cl_dma_cmd_2d((uint32_t) (v_head + c0), (uint32_t) v_l1, 2 * Thead_dim * bc, 2 * Tseq_len, 2 * bc, PI_CL_DMA_DIR_EXT2LOC, &cmd_load);
+                pi_cl_dma_cmd_wait(&cmd_load);
+
+                fa_args.Bc = bc;
+                fa_args.col0 = c0;
+                fa_args.mask_tile = mhsa_mask_tile(Tmask_type, Tmask_window, Tmask_block, MASK_LAYOUT, Tseq_len, r0, r0 + br, c0, c0 + bc);
+                fa_args.last = (t_next == N_TILES_KV);
+                pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_tile_fp16, &fa_args);
+
+                fa_args.first = 0;
+                t_kv = t_next;
+            }
+
+            pi_cl_dma_cmd_2d((uint32_t) (out + i * Thead_dim * Tseq_len + r0), (uint32_t) o_l1, 2 * Thead_dim * br, 2 * Tseq_len, 2 * br, PI_CL_DMA_DIR_LOC2EXT, &cmd_store);
+            pi_cl_dma_cmd_wait(&cmd_store);
+        }
+    }
+}
+#endif
+
+
+#ifdef FLASH_BACKWARD
+// Recomputing backward of all the heads from the lse saved by flash_attn_forward
+static void flash_attn_backward() {
+    struct flash_attn_bw_args_fp16 bw_args;
+    bw_args.delta = l1_delta;
+    bw_args.H = Thead_dim;
+    bw_args.L = Tseq_len;
+    bw_args.scaling = q_rsqrt_fp16((float) Thead_dim);
+    bw_args.accumulate = 0;
+    bw_args.mask_type = Tmask_type;
+    bw_args.mask_window = Tmask_window;
+    bw_args.mask_block = Tmask_block;
+    bw_args.mask_layout = MASK_LAYOUT;
+
+    for (int i = 0; i < Tn_heads; i++) {
+        int offset = i * Thead_dim * Tseq_len;
+        bw_args.q = l1_q + offset;
+        bw_args.k = l1_k + offset;
+        bw_args.v = l1_v + offset;
+        bw_args.out = l1_out + offset;
+        bw_args.out_diff = l1_out_diff + offset;
+        bw_args.q_diff = l1_q_diff + offset;
+        bw_args.k_diff = l1_k_diff + offset;
+        bw_args.v_diff = l1_v_diff + offset;
+        bw_args.lse = lse + i * Tseq_len;
+
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_delta_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_kv_fp16, &bw_args);
+        pi_cl_team_fork(NUM_CORES, mhsa_flash_attn_bw_q_fp16, &bw_args);
+    }
+}
+#endif
+
+
+#if defined(GQA_FORWARD) || defined(GQA_BACKWARD) || defined(KV_CACHE) || defined(DB_FORWARD) || defined(DB_BACKWARD)
+static void init_blob(struct blob_fp16 *b, fp16 *data, fp16 *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+#endif
+
+
+#if defined(GQA_FORWARD) || defined(GQA_BACKWARD) || defined(KV_CACHE)
+// Input, projections and output of the attention layer
+static void prepare_layer() {
+    copy_tensor(l1_in, INPUT, Tseq_len * Ttoken_size);
+    copy_tensor(l1_wq, WEIGHTS_Q, Tatt_dim * Ttoken_size);
+    copy_tensor(l1_wk, WEIGHTS_K, Tkv_dim * Ttoken_size);
+    copy_tensor(l1_wv, WEIGHTS_V, Tkv_dim * Ttoken_size);
+    copy_tensor(l1_wout, WEIGHTS_OUT, Ttoken_size * Tatt_dim);
+    copy_tensor(l1_bq, BIASES_Q, Tatt_dim);
+    copy_tensor(l1_bk, BIASES_K, Tkv_dim);
+    copy_tensor(l1_bv, BIASES_V, Tkv_dim);
+    copy_tensor(l1_bout, BIASES_OUT, Ttoken_size);
+
+#ifdef GQA_BACKWARD
+    copy_tensor(l1_out_diff, OUTPUT_GRAD, Tseq_len * Ttoken_size);
+    init_blob(&layer_in, l1_in, l1_in_diff, Tseq_len, Ttoken_size);
+    init_blob(&layer_out, l1_out, l1_out_diff, Tseq_len, Ttoken_size);
+    init_blob(&layer_wq, l1_wq, l1_wq_diff, Tatt_dim, Ttoken_size);
+    init_blob(&layer_wk, l1_wk, l1_wk_diff, Tkv_dim, Ttoken_size);
+    init_blob(&layer_wv, l1_wv, l1_wv_diff, Tkv_dim, Ttoken_size);
+    init_blob(&layer_wout, l1_wout, l1_wout_diff, Ttoken_size, Tatt_dim);
+#else
+    init_blob(&layer_in, l1_in, NULL, Tseq_len, Ttoken_size);
+    init_blob(&layer_out, l1_out, NULL, Tseq_len, Ttoken_size);
+    init_blob(&layer_wq, l1_wq, NULL, Tatt_dim, Ttoken_size);
+    init_blob(&layer_wk, l1_wk, NULL, Tkv_dim, Ttoken_size);
+    init_blob(&layer_wv, l1_wv, NULL, Tkv_dim, Ttoken_size);
+    init_blob(&layer_wout, l1_wout, NULL, Ttoken_size, Tatt_dim);
+#endif
+    init_blob(&layer_bq, l1_bq, NULL, 1, Tatt_dim);
+    init_blob(&layer_bk, l1_bk, NULL, 1, Tkv_dim);
+    init_blob(&layer_bv, l1_bv, NULL, 1, Tkv_dim);
+    init_blob(&layer_bout, l1_bout, NULL, 1, Ttoken_size);
+}
+#endif
+
+
+#if defined(GQA_FORWARD) || defined(GQA_BACKWARD)
+static void prepare_gqa() {
+    prepare_layer();
+
+#ifdef GQA_BACKWARD
+    init_blob(&layer_q, l1_q, l1_q_diff, Tatt_dim, Tseq_len);
+    init_blob(&layer_k, l1_k, l1_k_diff, Tkv_dim, Tseq_len);
+    init_blob(&layer_v, l1_v, l1_v_diff, Tkv_dim, Tseq_len);
+    init_blob(&layer_att_map, l1_att_map, l1_att_map_diff, Tseq_len, Tatt_dim);
+#else
+    init_blob(&layer_q, l1_q, NULL, Tatt_dim, Tseq_len);
+    init_blob(&layer_k, l1_k, NULL, Tkv_dim, Tseq_len);
+    init_blob(&layer_v, l1_v, NULL, Tkv_dim, Tseq_len);
+    init_blob(&layer_att_map, l1_att_map, NULL, Tseq_len, Tatt_dim);
+#endif
+
+    mhsa_args.input = &layer_in;
+    mhsa_args.input_bn = &layer_in;
+    mhsa_args.output = &layer_out;
+    mhsa_args.n_heads = Tn_heads;
+    mhsa_args.n_kv_heads = Tn_kv_heads;
+    mhsa_args.coeff_in_q = &layer_wq;
+    mhsa_args.coeff_in_k = &layer_wk;
+    mhsa_args.coeff_in_v = &layer_wv;
+    mhsa_args.bias_in_q = &layer_bq;
+    mhsa_args.bias_in_k = &layer_bk;
+    mhsa_args.bias_in_v = &layer_bv;
+    mhsa_args.coeff_out = &layer_wout;
+    mhsa_args.bias_out = &layer_bout;
+    mhsa_args.q = &layer_q;
+    mhsa_args.k = &layer_k;
+    mhsa_args.v = &layer_v;
+    mhsa_args.attention_map = &layer_att_map;
+    mhsa_args.temp_buffer = l1_temp;
+    mhsa_args.lse = lse;
+    mhsa_args.rope_cos = NULL;
+    mhsa_args.rope_sin = NULL;
+    mhsa_args.coeff_in_qkv = NULL;
+    mhsa_args.lora_rank = 0;
+    mhsa_args.mask_type = Tmask_type;
+    mhsa_args.mask_window = Tmask_window;
+    mhsa_args.mask_block = Tmask_block;
+    mhsa_args.mask_layout = MASK_LAYOUT;
+}
+#endif
+
+
+#ifdef KV_CACHE
+// Decodes the whole sequence: Tprefill tokens in the first call, then one token per call
+static void kv_cache_decode(fp16 *k_cache, fp16 *v_cache, fp16 *BUFF) {
+    kv_args.k_cache = k_cache;
+    kv_args.v_cache = v_cache;
+    kv_args.BUFF = BUFF;
+    kv_args.cache_len = 0;
+
+    int T = Tprefill;
+    for (int t = 0; t < Tseq_len; t += T) {
+        if (t > 0) T = 1;
+        layer_in.data = l1_in + t * Ttoken_size;
+        layer_in.H = T;
+        layer_out.data = l1_out + t * Ttoken_size;
+        layer_out.H = T;
+        pulp_mhsa_kv_cache_fp16_fw_cl(&kv_args);
+    }
+}
+
+static void prepare_kv_cache() {
+    prepare_layer();
+
+    kv_args.input = &layer_in;
+    kv_args.output = &layer_out;
+    kv_args.n_heads = Tn_heads;
+    kv_args.coeff_in_q = &layer_wq;
+    kv_args.coeff_in_k = &layer_wk;
+    kv_args.coeff_in_v = &layer_wv;
+    kv_args.bias_in_q = &layer_bq;
+    kv_args.bias_in_k = &layer_bk;
+    kv_args.bias_in_v = &layer_bv;
+    kv_args.coeff_out = &layer_wout;
+    kv_args.bias_out = &layer_bout;
+    kv_args.max_len = Tseq_len;
+    kv_args.q = l1_q;
+    kv_args.kv_new = l1_kv_new;
+    kv_args.attention_map = l1_att_map;
+    kv_args.temp_buffer = l1_temp;
+    kv_args.tile_len = Ttile_kv;
+    kv_args.cmd_store = &cmd_store;
+}
+#endif
+
+
+#if defined(DB_FORWARD) || defined(DB_BACKWARD)
+// Sequences are E x L, the fused QKV weights, Q | K | V and the softmax of all heads stay in L2
+static void prepare_db() {
+    copy_tensor(l1_in, INPUT, Ttoken_size * Tseq_len);
+    copy_tensor(l1_wout, WEIGHTS_OUT, Ttoken_size * Tatt_dim);
+
+#ifdef DB_BACKWARD
+    copy_tensor(l1_out_diff, OUTPUT_GRAD, Ttoken_size * Tseq_len);
+    init_blob(&layer_in, l1_in, l1_in_diff, Tseq_len, Ttoken_size);
+    init_blob(&layer_out, l1_out, l1_out_diff, Tseq_len, Ttoken_size);
+    init_blob(&layer_wqkv, WEIGHTS_QKV, l2_wqkv_diff, 3 * Tatt_dim, Ttoken_size);
+    init_blob(&layer_wout, l1_wout, l1_wout_diff, Ttoken_size, Tatt_dim);
+    init_blob(&layer_qkv, l2_qkv, l2_qkv_diff, 3 * Tatt_dim, Tseq_len);
+    init_blob(&layer_att_map, l1_att_map, l1_att_map_diff, Tseq_len, Tatt_dim);
+#else
+    init_blob(&layer_in, l1_in, NULL, Tseq_len, Ttoken_size);
+    init_blob(&layer_out, l1_out, NULL, Tseq_len, Ttoken_size);
+    init_blob(&layer_wqkv, WEIGHTS_QKV, NULL, 3 * Tatt_dim, Ttoken_size);
+    init_blob(&layer_wout, l1_wout, NULL, Ttoken_size, Tatt_dim);
+    init_blob(&layer_qkv, l2_qkv, NULL, 3 * Tatt_dim, Tseq_len);
+    init_blob(&layer_att_map, l1_att_map, NULL, Tseq_len, Tatt_dim);
+#endif
+    init_blob(&layer_att_map_l2, l2_att_map, NULL, Tseq_len, Tatt_dim);
+    init_blob(&layer_buff1_a, l1_buff1_a, NULL, 1, DB_BUFF1);
+    init_blob(&layer_buff1_b, l1_buff1_b, NULL, 1, DB_BUFF1);
+    init_blob(&layer_buff2_a, l1_buff2_a, NULL, 1, DB_BUFF2);
+    init_blob(&layer_buff2_b, l1_buff2_b, NULL, 1, DB_BUFF2);
+    init_blob(&layer_head, l1_head, NULL, 1, DB_HEAD);
+    init_blob(&layer_softmax, l2_softmax, NULL, Tn_heads * Tseq_len, Tseq_len);
+
+    db_args.input = &layer_in;
+    db_args.n_heads = Tn_heads;
+    db_args.n_tiles = Tn_tiles;
+    db_args.opt_matmul_type_fw = MATMUL_TYPE;
+    db_args.opt_matmul_type_wg = MATMUL_TYPE;
+    db_args.opt_matmul_type_ig = MATMUL_TYPE;
+    db_args.output = &layer_out;
+    db_args.coeff_in = &layer_wqkv;
+    db_args.coeff_out = &layer_wout;
+    db_args.buff1_a = &layer_buff1_a;
+    db_args.buff1_b = &layer_buff1_b;
+    db_args.buff2_a = &layer_buff2_a;
+    db_args.buff2_b = &layer_buff2_b;
+    db_args.qkv = &layer_qkv;
+    db_args.attention_map = &layer_att_map;
+    db_args.attention_map_l2 = &layer_att_map_l2;
+    db_args.temp_buffer = l1_temp;
+    db_args.head_buffer = &layer_head;
+    db_args.softmax_buffer = &layer_softmax;
+    db_args.maxes = l1_maxes;
+    db_args.sums = l1_sums;
+}
+#endif
+
+
+// ~~~~~~~~~~ MAIN FUNCTION ~~~~~~~~~~
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nL = %d, H = %d, n_heads = %d, mask type = %d\n", Tseq_len, Thead_dim, Tn_heads, Tmask_type);
+
+#ifdef FLASH_FORWARD
+    printf("\n----- FLASH ATTENTION FORWARD (Br = %d, Bc = %d) -----\n", Ttile_q, Ttile_kv);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    flash_attn_forward(Q, K, V, attn_out);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("ATTENTION OUTPUT", attn_out, OUTPUT, Tatt_dim * Tseq_len);
+#endif
+
+#ifdef FLASH_BACKWARD
+    printf("\n----- FLASH ATTENTION BACKWARD (Br = %d, Bc = %d) -----\n", Ttile_q, Ttile_kv);
+    //  The forward saves the output and the lse read by the backward
+    flash_attn_forward(Q, K, V, attn_out);
+    check("ATTENTION OUTPUT", attn_out, OUTPUT, Tatt_dim * Tseq_len);
+
+    copy_tensor(l1_q, Q, Tatt_dim * Tseq_len);
+    copy_tensor(l1_k, K, Tatt_dim * Tseq_len);
+    copy_tensor(l1_v, V, Tatt_dim * Tseq_len);
+    copy_tensor(l1_out, attn_out, Tatt_dim * Tseq_len);
+    copy_tensor(l1_out_diff, OUTPUT_GRAD, Tatt_dim * Tseq_len);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    flash_attn_backward();
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("Q GRADIENT", l1_q_diff, Q_GRAD, Tatt_dim * Tseq_len);
+    check("K GRADIENT", l1_k_diff, K_GRAD, Tatt_dim * Tseq_len);
+    check("V GRADIENT", l1_v_diff, V_GRAD, Tatt_dim * Tseq_len);
+#endif
+
+#ifdef GQA_FORWARD
+    printf("\n----- GROUPED-QUERY ATTENTION FORWARD (n_kv_heads = %d) -----\n", Tn_kv_heads);
+    prepare_gqa();
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_mhsa_gqa_fp16_fw_cl(&mhsa_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("LAYER OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+#endif
+
+#ifdef GQA_BACKWARD
+    printf("\n----- GROUPED-QUERY ATTENTION BACKWARD (n_kv_heads = %d) -----\n", Tn_kv_heads);
+    prepare_gqa();
+    pulp_mhsa_gqa_fp16_fw_cl(&mhsa_args);
+    check("LAYER OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_mhsa_gqa_fp16_bw_cl(&mhsa_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("INPUT GRADIENT", l1_in_diff, INPUT_GRAD, Tseq_len * Ttoken_size);
+    check("WQ GRADIENT", l1_wq_diff, WEIGHTS_Q_GRAD, Tatt_dim * Ttoken_size);
+    check("WK GRADIENT", l1_wk_diff, WEIGHTS_K_GRAD, Tkv_dim * Ttoken_size);
+    check("WV GRADIENT", l1_wv_diff, WEIGHTS_V_GRAD, Tkv_dim * Ttoken_size);
+    check("WOUT GRADIENT", l1_wout_diff, WEIGHTS_OUT_GRAD, Ttoken_size * Tatt_dim);
+#endif
+
+#ifdef KV_CACHE
+    printf("\n----- KV-CACHE DECODING (prefill = %d) -----\n", Tprefill);
+    prepare_kv_cache();
+
+    printf("\nCache in L1, read in place:\n");
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    kv_cache_decode(l1_k_cache, l1_v_cache, NULL);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("DECODED OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+
+    printf("\nCache in L2, %d tokens per tile:\n", Ttile_kv);
+    for (int i = 0; i < Tseq_len * Ttoken_size; i++)
+        l1_out[i] = 0;
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    kv_cache_decode(l2_k_cache, l2_v_cache, l1_cache_buff);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("DECODED OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+#endif
+
+#ifdef DB_FORWARD
+    printf("\n----- DOUBLE-BUFFERED MHSA FORWARD (n_tiles = %d) -----\n", Tn_tiles);
+    prepare_db();
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_mhsa_fp16_fw_cl_dblbuffer(&db_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("LAYER OUTPUT", l1_out, OUTPUT, Ttoken_size * Tseq_len);
+#endif
+
+#ifdef DB_BACKWARD
+    printf("\n----- DOUBLE-BUFFERED MHSA BACKWARD (n_tiles = %d) -----\n", Tn_tiles);
+    prepare_db();
+    pulp_mhsa_fp16_fw_cl_dblbuffer(&db_args);
+    check("LAYER OUTPUT", l1_out, OUTPUT, Ttoken_size * Tseq_len);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_mhsa_fp16_bw_cl_dblbuffer(&db_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("INPUT GRADIENT", l1_in_diff, INPUT_GRAD, Ttoken_size * Tseq_len);
+    check("WQKV GRADIENT", l2_wqkv_diff, WEIGHTS_QKV_GRAD, 3 * Tatt_dim * Ttoken_size);
+    check("WOUT GRADIENT", l1_wout_diff, WEIGHTS_OUT_GRAD, Ttoken_size * Tatt_dim);
+#endif
+
+    return;
+}
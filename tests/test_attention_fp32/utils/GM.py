@@ -0,0 +1,221 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import numpy as np
+import torch
+import torch.nn.functional as F
+
+
+MASK_TYPES = {
+    "NONE": "MHSA_MASK_NONE",
+    "CAUSAL": "MHSA_MASK_CAUSAL",
+    "SLIDING_WINDOW": "MHSA_MASK_SLIDING_WINDOW",
+    "BLOCK_SPARSE": "MHSA_MASK_BLOCK_SPARSE",
+}
+
+
+def q_rsqrt(x):
+    # Fast inverse square root of the kernels, so that the golden model uses the same 1 / sqrt(H)
+    y = np.asarray((x,), dtype=np.float32)
+    x2 = y * 0.5
+    i = y.view(np.int32)
+    i = 0x5F3759DF - np.right_shift(i, 1)
+    y = i.view(np.float32)
+    y = y * (1.5 - (x2 * y * y))
+    return float(y[0])
+
+
+def make_layout(seq_len, block):
+    # Random block layout, with the second query block fully masked (its rows see no key at all)
+    n_blocks = (seq_len + block - 1) // block
+    layout = torch.rand(n_blocks, n_blocks) > 0.5
+    layout[0, 0] = True
+    if n_blocks > 1:
+        layout[1, :] = False
+    return layout
+
+
+def make_mask(mask, seq_len, window, block, layout):
+    # Boolean L x L mask, True if query r attends key c (same convention as mhsa_mask_visible)
+    r = torch.arange(seq_len)[:, None]
+    c = torch.arange(seq_len)[None, :]
+    if mask == "CAUSAL":
+        return c <= r
+    if mask == "SLIDING_WINDOW":
+        return (c <= r) & (c > r - window)
+    if mask == "BLOCK_SPARSE":
+        return layout[r // block, c // block]
+    return torch.ones(seq_len, seq_len, dtype=torch.bool)
+
+
+def attention(q, k, v, mask, attn_mask):
+    # q, k, v: n_heads x L x H
+    scale = q_rsqrt(q.shape[-1])
+    if mask == "NONE":
+        return F.scaled_dot_product_attention(q, k, v, scale=scale)
+    if mask == "CAUSAL":
+        return F.scaled_dot_product_attention(q, k, v, is_causal=True, scale=scale)
+    # The kernels leave a query that sees no key to zero: let it attend every key, then zero it
+    visible = attn_mask.any(dim=-1, keepdim=True)
+    out = F.scaled_dot_product_attention(q, k, v, attn_mask=attn_mask | ~visible, scale=scale)
+    return out * visible
+
+
+def attention_layer(x, wq, bq, wk, bk, wv, bv, wo, bo, n_heads, n_kv_heads, mask, attn_mask):
+    # x: L x E, weights stored out_features x in_features as in the MHSA layers
+    seq_len = x.shape[0]
+    q = (x @ wq.t() + bq).view(seq_len, n_heads, -1).transpose(0, 1)
+    k = (x @ wk.t() + bk).view(seq_len, n_kv_heads, -1).transpose(0, 1)
+    v = (x @ wv.t() + bv).view(seq_len, n_kv_heads, -1).transpose(0, 1)
+    # Query head i reads key/value head i / (n_heads / n_kv_heads)
+    k = k.repeat_interleave(n_heads // n_kv_heads, dim=0)
+    v = v.repeat_interleave(n_heads // n_kv_heads, dim=0)
+    out = attention(q, k, v, mask, attn_mask).transpose(0, 1).reshape(seq_len, -1)
+    return out @ wo.t() + bo
+
+
+def heads_to_string(t):
+    # n_heads x L x H -> F x L, the layout of the MHSA head buffers
+    return "f, ".join(map(str, t.transpose(1, 2).flatten().tolist())) + "f"
+
+
+def write_array(f, name, memory, t, size):
+    f.write(memory + " float " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("Attention Kernels Test")
+    parser.add_argument("--step", type=str, default="FLASH_FORWARD")
+    parser.add_argument("--seq_len", type=int, default=45)
+    parser.add_argument("--head_dim", type=int, default=8)
+    parser.add_argument("--n_heads", type=int, default=4)
+    parser.add_argument("--n_kv_heads", type=int, default=2)
+    parser.add_argument("--token_size", type=int, default=16)
+    parser.add_argument("--tile_q", type=int, default=9)
+    parser.add_argument("--tile_kv", type=int, default=5)
+    parser.add_argument("--prefill", type=int, default=6)
+    parser.add_argument("--mask", type=str, default="SLIDING_WINDOW")
+    parser.add_argument("--mask_window", type=int, default=7)
+    parser.add_argument("--mask_block", type=int, default=4)
+    args = parser.parse_args()
+
+    step = args.step
+    seq_len = args.seq_len
+    head_dim = args.head_dim
+    n_heads = args.n_heads
+    n_kv_heads = args.n_kv_heads if step.startswith("GQA") else n_heads
+    token_size = args.token_size
+    mask = "CAUSAL" if step == "KV_CACHE" else args.mask
+    att_dim = n_heads * head_dim
+    kv_dim = n_kv_heads * head_dim
+    n_blocks = (seq_len + args.mask_block - 1) // args.mask_block
+
+    if mask not in MASK_TYPES:
+        raise ValueError("Unknown mask " + mask)
+    if n_heads % n_kv_heads != 0:
+        raise ValueError("n_kv_heads has to divide n_heads")
+
+    f = open("step-check.h", "w")
+    f.write("#define " + step + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Thead_dim " + str(head_dim) + "\n")
+    f.write("#define Tn_heads " + str(n_heads) + "\n")
+    f.write("#define Tn_kv_heads " + str(n_kv_heads) + "\n")
+    f.write("#define Ttoken_size " + str(token_size) + "\n")
+    f.write("#define Tatt_dim " + str(att_dim) + "\n")
+    f.write("#define Tkv_dim " + str(kv_dim) + "\n")
+    f.write("#define Ttile_q " + str(args.tile_q) + "\n")
+    f.write("#define Ttile_kv " + str(args.tile_kv) + "\n")
+    f.write("#define Tprefill " + str(min(args.prefill, seq_len)) + "\n")
+    f.write("#define Tmask_type " + MASK_TYPES[mask] + "\n")
+    f.write("#define Tmask_window " + str(args.mask_window) + "\n")
+    f.write("#define Tmask_block " + str(args.mask_block) + "\n")
+    f.write("#define Tmask_blocks " + str(n_blocks) + "\n")
+    f.close()
+
+    layout = make_layout(seq_len, args.mask_block)
+    attn_mask = make_mask(mask, seq_len, args.mask_window, args.mask_block, layout)
+    print("Attention mask:")
+    print(attn_mask.int())
+
+    f = open("attention-data.h", "w")
+    f.write("PI_L1 unsigned char MASK_LAYOUT[Tmask_blocks * Tmask_blocks] = {"
+            + ", ".join(str(int(b)) for b in layout.flatten().tolist()) + "};\n")
+
+    if step in ("FLASH_FORWARD", "FLASH_BACKWARD"):
+        # Attention alone, on per-head Q, K and V
+        q = torch.randn(n_heads, seq_len, head_dim, requires_grad=True)
+        k = torch.randn(n_heads, seq_len, head_dim, requires_grad=True)
+        v = torch.randn(n_heads, seq_len, head_dim, requires_grad=True)
+        out = attention(q, k, v, mask, attn_mask)
+        out_grad = torch.randn(n_heads, seq_len, head_dim)
+        out.backward(out_grad)
+
+        print("Attention output:")
+        print(out)
+
+        for name, t in (("Q", q), ("K", k), ("V", v)):
+            f.write("PI_L2 float " + name + "[Tatt_dim * Tseq_len] = {" + heads_to_string(t.detach()) + "};\n")
+        f.write("PI_L2 float OUTPUT[Tatt_dim * Tseq_len] = {" + heads_to_string(out.detach()) + "};\n")
+        if step == "FLASH_BACKWARD":
+            f.write("PI_L2 float OUTPUT_GRAD[Tatt_dim * Tseq_len] = {" + heads_to_string(out_grad) + "};\n")
+            for name, t in (("Q_GRAD", q), ("K_GRAD", k), ("V_GRAD", v)):
+                f.write("PI_L2 float " + name + "[Tatt_dim * Tseq_len] = {" + heads_to_string(t.grad) + "};\n")
+
+    else:
+        # Attention layer with input/output projections
+        x = torch.randn(seq_len, token_size, requires_grad=True)
+        wq = (0.3 * torch.randn(att_dim, token_size)).requires_grad_()
+        wk = (0.3 * torch.randn(kv_dim, token_size)).requires_grad_()
+        wv = (0.3 * torch.randn(kv_dim, token_size)).requires_grad_()
+        wo = (0.3 * torch.randn(token_size, att_dim)).requires_grad_()
+        bq = 0.1 * torch.randn(att_dim)
+        bk = 0.1 * torch.randn(kv_dim)
+        bv = 0.1 * torch.randn(kv_dim)
+        bo = 0.1 * torch.randn(token_size)
+
+        out = attention_layer(x, wq, bq, wk, bk, wv, bv, wo, bo, n_heads, n_kv_heads, mask, attn_mask)
+        out_grad = torch.randn(seq_len, token_size)
+        out.backward(out_grad)
+
+        print("Layer output:")
+        print(out)
+
+        write_array(f, "INPUT", "PI_L2", x.detach(), "Tseq_len * Ttoken_size")
+        write_array(f, "WEIGHTS_Q", "PI_L2", wq.detach(), "Tatt_dim * Ttoken_size")
+        write_array(f, "WEIGHTS_K", "PI_L2", wk.detach(), "Tkv_dim * Ttoken_size")
+        write_array(f, "WEIGHTS_V", "PI_L2", wv.detach(), "Tkv_dim * Ttoken_size")
+        write_array(f, "WEIGHTS_OUT", "PI_L2", wo.detach(), "Ttoken_size * Tatt_dim")
+        write_array(f, "BIASES_Q", "PI_L2", bq, "Tatt_dim")
+        write_array(f, "BIASES_K", "PI_L2", bk, "Tkv_dim")
+        write_array(f, "BIASES_V", "PI_L2", bv, "Tkv_dim")
+        write_array(f, "BIASES_OUT", "PI_L2", bo, "Ttoken_size")
+        write_array(f, "OUTPUT", "PI_L2", out.detach(), "Tseq_len * Ttoken_size")
+        if step == "GQA_BACKWARD":
+            write_array(f, "OUTPUT_GRAD", "PI_L2", out_grad, "Tseq_len * Ttoken_size")
+            write_array(f, "INPUT_GRAD", "PI_L2", x.grad, "Tseq_len * Ttoken_size")
+            write_array(f, "WEIGHTS_Q_GRAD", "PI_L2", wq.grad, "Tatt_dim * Ttoken_size")
+            write_array(f, "WEIGHTS_K_GRAD", "PI_L2", wk.grad, "Tkv_dim * Ttoken_size")
+            write_array(f, "WEIGHTS_V_GRAD", "PI_L2", wv.grad, "Tkv_dim * Ttoken_size")
+            write_array(f, "WEIGHTS_OUT_GRAD", "PI_L2", wo.grad, "Ttoken_size * Tatt_dim")
+
+    f.close()
@@ -8,6 +8,24 @@
 #include <string.h>
 
 
+#if BITMASK
+PI_L1 uint32_t bitmask[ACT_MASK_WORDS(IN_SIZE)];
+PI_L1 DATA_TYPE in_ref[IN_SIZE];
+
+// Checks that each element is either dropped or scaled, following the bit of the 1-bit mask
+static int check_bitmask(DATA_TYPE *out, DATA_TYPE *ref, float scale) {
+    int errors = 0;
+    for (int i = 0; i < IN_SIZE; i++) {
+        float expected = (bitmask[i >> 5] >> (i & 31)) & 0x1 ? (float) ref[i] * scale : 0.0f;
+        float diff = (float) out[i] - expected;
+        float tol = 1e-2f * (1.0f + (expected > 0.0f ? expected : -expected));
+        if (diff > tol || diff < -tol) errors++;
+    }
+    return errors;
+}
+#endif
+
+
 // Main function
 void net_step () 
 {
@@ -24,13 +42,21 @@ void net_step ()
     args.mask = mask;
     args.use_mask = USE_MASK;
     args.size = IN_SIZE;
+    #if BITMASK
+    args.bitmask = bitmask;
+    for (int i = 0; i < IN_SIZE; i++) in_ref[i] = input[i];
+    #endif
 
     printf("Dropout function:\n");
     #ifdef PROF_NET
     START_STATS();
     #endif
 
+    #if BITMASK
+    pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp16_cl, &args);
+    #else
     pi_cl_team_fork(NUM_CORES, pulp_dropout_fp16_cl, &args);
+    #endif
 
     #ifdef PROF_NET
     STOP_STATS();
@@ -45,13 +71,21 @@ void net_step ()
     args.mask = mask;
     args.use_mask = USE_MASK;
     args.size = IN_SIZE;
+    #if BITMASK
+    args.bitmask = bitmask;
+    for (int i = 0; i < IN_SIZE; i++) in_ref[i] = input[i];
+    #endif
 
     printf("Dropout function:\n");
     #ifdef PROF_NET
     START_STATS();
     #endif
 
+    #if BITMASK
+    pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp32_cl, &args);
+    #else
     pi_cl_team_fork(NUM_CORES, pulp_dropout_fp32_cl, &args);
+    #endif
 
     #ifdef PROF_NET
     STOP_STATS();
@@ -69,5 +103,35 @@ void net_step ()
     printf("%d\n", count);
     printf("Percentage of dropped out values: %f\%\n", (count*100.0f/SIZE));
 
+    #if BITMASK
+    // The kept elements are scaled in the forward, the backward applies the same mask and scaling to the output gradient
+    float scale = 1.0f / (1.0f - (float) args.probability);
+    int fw_errors = check_bitmask(input, in_ref, scale);
+    printf("Bitmask forward errors: %d\n", fw_errors);
+
+    args.input = grad;
+
+    printf("Dropout backward function:\n");
+    #ifdef PROF_NET
+    START_STATS();
+    #endif
+
+    #ifdef FLOAT16
+    pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp16_bw_cl, &args);
+    #endif
+    #ifdef FLOAT32
+    pi_cl_team_fork(NUM_CORES, pulp_dropout_mask_fp32_bw_cl, &args);
+    #endif
+
+    #ifdef PROF_NET
+    STOP_STATS();
+    #endif
+
+    int bw_errors = check_bitmask(grad, grad_ref, scale);
+    printf("Bitmask backward errors: %d\n", bw_errors);
+    if (fw_errors == 0 && bw_errors == 0) printf("Bitmask dropout test passed!\n");
+    else printf("Bitmask dropout test failed!\n");
+    #endif
+
     return;
 }
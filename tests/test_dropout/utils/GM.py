@@ -32,6 +32,7 @@ parser = argparse.ArgumentParser("Dropout Test")
 # Dropout arguments
 parser.add_argument( '--in_size', type=int, default=10000)
 parser.add_argument( '--prob', type=float, default=0.1)
+parser.add_argument( '--bitmask', type=int, default=0)    # 1 to also generate the output gradient of the bitmask test
 # General arguments
 parser.add_argument( '--file_name', type=str, default='dropout_data.h')
 parser.add_argument( '--type', type=str, default='float')       # float, fp16 to select the desired format
@@ -81,6 +82,11 @@ print("\nInput Data: ")
 print("\nA is: ", A, A.shape, A.dtype)
 f.write('PI_L1 ' + data_type + ' input[IN_SIZE] = {'+dump.tensor_to_string(A)+'};\n')
 f.write('PI_L1 ' + data_type + ' mask[IN_SIZE] = {'+dump.tensor_to_string(C)+'};\n')
+if args.bitmask:
+    # Output gradient of the backward, the reference copy is kept to check the masked result
+    G = torch.randn(in_size).type(A.dtype)
+    f.write('PI_L1 ' + data_type + ' grad[IN_SIZE] = {'+dump.tensor_to_string(G)+'};\n')
+    f.write('PI_L2 ' + data_type + ' grad_ref[IN_SIZE] = {'+dump.tensor_to_string(G)+'};\n')
 
 print("\n\n")
 
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "embedding-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+PI_L1 struct Embedding_args_fp16 fw_args;
+PI_L1 struct Embedding_bw_args_fp16 bw_args;
+PI_L1 struct Embedding_update_args_fp16 update_args;
+
+// The table, its Adam moments and the output stay in L2, only the rows in use are brought to L1
+PI_L2 fp16 table[TABLE_SIZE];
+PI_L2 fp16 table_m[TABLE_SIZE];
+PI_L2 fp16 table_v[TABLE_SIZE];
+PI_L2 fp16 out[OUT_SIZE];
+
+PI_L1 fp16 buff[BUFF_SIZE];
+PI_L1 int ids[Tseq_len];
+PI_L1 fp16 out_diff[OUT_SIZE];
+
+// Sparse gradient
+PI_L1 int row_ids[Tseq_len];
+PI_L1 int row_ptr[Tseq_len + 1];
+PI_L1 int token_idx[Tseq_len];
+PI_L1 fp16 row_diff[OUT_SIZE];
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+// Mean error checker - relative to the mean magnitude of the reference
+static inline void check(char *name, fp16 *tensor_out, fp16 *tensor_ref, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - (float) tensor_ref[i];
+        float ref = (float) tensor_ref[i];
+        err += diff > 0 ? diff : -diff;
+        norm += ref > 0 ? ref : -ref;
+    }
+    err = norm > 0 ? err / norm : err;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+// Mean error checker - relative to the mean magnitude of the update of the reference, which is much smaller than the table
+static inline void check_update(char *name, fp16 *tensor_out, fp16 *tensor_ref, fp16 *tensor_init, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - (float) tensor_ref[i];
+        float update = (float) tensor_ref[i] - (float) tensor_init[i];
+        err += diff > 0 ? diff : -diff;
+        norm += update > 0 ? update : -update;
+    }
+    err = err / norm;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < UPDATE_ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+static inline void check_rows(int *rows_out, int *rows_ref, int n_rows, int n_rows_ref) {
+    int mismatches = 0;
+    if (n_rows == n_rows_ref) {
+        for (int r = 0; r < n_rows; r++)
+            if (rows_out[r] != rows_ref[r]) mismatches++;
+    }
+    printf("\nROW IDS CHECK: \n");
+    if (n_rows == n_rows_ref && mismatches == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n(%d rows vs %d expected, %d ids differ)\n", n_rows, n_rows_ref, mismatches);
+}
+
+static inline void copy_tensor(fp16 *dst, fp16 *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void zero_tensor(fp16 *dst, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = 0.0f;
+}
+
+static void prepare_data() {
+    copy_tensor(table, TABLE, TABLE_SIZE);
+    zero_tensor(table_m, TABLE_SIZE);
+    zero_tensor(table_v, TABLE_SIZE);
+
+    fw_args.BUFF = buff;
+    fw_args.dim = Tseq_len;
+    fw_args.embed_dim = Tembed_dim;
+    fw_args.ids = ids;
+    fw_args.embeds = table;
+    fw_args.out = out;
+    fw_args.rows_per_dma = Trows_per_dma;
+
+    bw_args.dim = Tseq_len;
+    bw_args.embed_dim = Tembed_dim;
+    bw_args.ids = ids;
+    bw_args.out_diff = out_diff;
+    bw_args.row_ids = row_ids;
+    bw_args.row_ptr = row_ptr;
+    bw_args.token_idx = token_idx;
+    bw_args.row_diff = row_diff;
+
+    update_args.BUFF = buff;
+    update_args.grad = &bw_args;
+    update_args.embeds = table;
+    update_args.m = table_m;
+    update_args.v = table_v;
+    update_args.optimizer = Toptimizer;
+    update_args.learning_rate = Tlearning_rate;
+    update_args.beta1 = Tbeta1;
+    update_args.beta2 = Tbeta2;
+    update_args.epsilon = Teps;
+    update_args.step = 0;
+}
+
+
+
+// Main function
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nTable: %d x %d, tokens = %d, rows per DMA = %d, steps = %d\n", Tvocab_size, Tembed_dim, Tseq_len, Trows_per_dma, Tn_steps);
+
+    prepare_data();
+
+    // Cycles are those of the double-buffered forward, the sparse backward and the sparse update, cumulative over the steps
+    for (int s = 0; s < Tn_steps; s++) {
+        for (int i = 0; i < Tseq_len; i++) ids[i] = IDS[s * Tseq_len + i];
+        copy_tensor(out_diff, OUT_DIFF + s * OUT_SIZE, OUT_SIZE);
+
+        printf("\n----- TRAINING STEP %d -----\n", s);
+
+        // One row per core and per DMA
+        zero_tensor(out, OUT_SIZE);
+        pi_cl_team_fork(NUM_CORES, embedding_fw_tiled_fp16, &fw_args);
+        check("FORWARD", out, OUT_REF + s * OUT_SIZE, OUT_SIZE);
+
+        // Double buffered
+        zero_tensor(out, OUT_SIZE);
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        pi_cl_team_fork(NUM_CORES, embedding_fw_tiled_fp16_dblbuffer, &fw_args);
+        pulp_embedding_fp16_bw_cl(&bw_args);
+        update_args.step = s + 1;
+        pulp_embedding_fp16_sparse_update_cl(&update_args);
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+
+        check("DOUBLE BUFFERED FORWARD", out, OUT_REF + s * OUT_SIZE, OUT_SIZE);
+        check_rows(row_ids, ROW_IDS_REF + s * Tseq_len, bw_args.n_rows, N_ROWS_REF[s]);
+        check("ROW GRADIENTS", row_diff, ROW_DIFF_REF + s * OUT_SIZE, N_ROWS_REF[s] * Tembed_dim);
+        // The whole table is checked: the rows without tokens must be left untouched
+        check_update("TABLE", table, TABLE_REF + s * TABLE_SIZE, s == 0 ? TABLE : TABLE_REF + (s - 1) * TABLE_SIZE, TABLE_SIZE);
+    }
+
+    return;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "step-check.h"
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition (mean error relative to the mean magnitude of the reference, or of its update for the table)
+#define ERROR_TOLERANCE 0.01
+#define UPDATE_ERROR_TOLERANCE 0.05
+
+// Sizes of the tensors
+#define TABLE_SIZE (Tvocab_size * Tembed_dim)
+#define OUT_SIZE (Tseq_len * Tembed_dim)
+
+// L1 scratch buffer, large enough for the double-buffered forward and for the sparse update
+#define FW_BUFF_SIZE (NUM_CORES * 2 * Trows_per_dma * Tembed_dim)
+#define UPDATE_BUFF_SIZE (NUM_CORES * 3 * Tembed_dim)
+#define BUFF_SIZE (FW_BUFF_SIZE > UPDATE_BUFF_SIZE ? FW_BUFF_SIZE : UPDATE_BUFF_SIZE)
+
+// Main function
+void net_step ();
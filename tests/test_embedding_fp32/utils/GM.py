@@ -0,0 +1,144 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+import torch.nn as nn
+
+
+BETA1 = 0.9
+BETA2 = 0.999
+EPS = 1e-8
+
+
+def make_ids(seq_len, vocab_size):
+    # Tokens of the lower half of the vocabulary only, so that the upper half is never updated,
+    # with a run of consecutive ids (merged into one DMA by the double-buffered forward) and a repeated id
+    ids = torch.randint(0, vocab_size // 2, (seq_len,))
+    run = min(4, seq_len - 1)
+    first = int(torch.randint(0, vocab_size // 2 - run, (1,)).item())
+    for r in range(run):
+        ids[1 + r] = first + r
+    ids[seq_len - 1] = ids[0]
+    return ids
+
+
+def distinct_rows(ids):
+    # Rows of the table touched by ids, in order of first appearance
+    rows = []
+    for i in ids.tolist():
+        if i not in rows:
+            rows.append(i)
+    return rows
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 float " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+def write_ints(f, name, values, size):
+    f.write("PI_L2 int " + name + "[" + size + "] = {" + ", ".join(map(str, values)) + "};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("Embedding Test")
+    parser.add_argument("--optimizer", type=str, default="ADAM")
+    parser.add_argument("--n_steps", type=int, default=3)
+    parser.add_argument("--vocab_size", type=int, default=64)
+    parser.add_argument("--embed_dim", type=int, default=16)
+    parser.add_argument("--seq_len", type=int, default=12)
+    parser.add_argument("--rows_per_dma", type=int, default=2)
+    parser.add_argument("--learning_rate", type=float, default=0.01)
+    args = parser.parse_args()
+
+    optimizer = args.optimizer
+    n_steps = args.n_steps
+    vocab_size = args.vocab_size
+    embed_dim = args.embed_dim
+    seq_len = args.seq_len
+    lr = args.learning_rate
+
+    if optimizer not in ("SGD", "ADAM"):
+        raise ValueError("Unknown optimizer " + optimizer)
+    if seq_len < 2 or vocab_size < 2 * seq_len:
+        raise ValueError("The test needs seq_len >= 2 and vocab_size >= 2 * seq_len")
+
+    f = open("step-check.h", "w")
+    f.write("#define " + optimizer + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tvocab_size " + str(vocab_size) + "\n")
+    f.write("#define Tembed_dim " + str(embed_dim) + "\n")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Trows_per_dma " + str(args.rows_per_dma) + "\n")
+    f.write("#define Tn_steps " + str(n_steps) + "\n")
+    f.write("#define Toptimizer EMBEDDING_" + optimizer + "\n")
+    f.write("#define Tlearning_rate " + str(lr) + "f\n")
+    f.write("#define Tbeta1 " + str(BETA1) + "f\n")
+    f.write("#define Tbeta2 " + str(BETA2) + "f\n")
+    f.write("#define Teps " + str(EPS) + "f\n")
+    f.close()
+
+    # Sparse gradients, updated by SGD or by the lazy Adam of torch.optim.SparseAdam
+    embedding = nn.Embedding(vocab_size, embed_dim, sparse=True)
+    table = embedding.weight.detach().clone()
+    if optimizer == "SGD":
+        opt = torch.optim.SGD(list(embedding.parameters()), lr=lr)
+    else:
+        opt = torch.optim.SparseAdam(list(embedding.parameters()), lr=lr, betas=(BETA1, BETA2), eps=EPS)
+
+    ids_list, out_diffs, outs, row_ids, n_rows, row_diffs, tables = [], [], [], [], [], [], []
+    for s in range(n_steps):
+        ids = make_ids(seq_len, vocab_size)
+        out_diff = torch.randn(seq_len, embed_dim)
+
+        opt.zero_grad()
+        out = embedding(ids)
+        out.backward(out_diff)
+
+        # Gradient of the distinct rows, zero padded to seq_len rows
+        rows = distinct_rows(ids)
+        grad = embedding.weight.grad.to_dense()
+        row_diff = torch.zeros(seq_len, embed_dim)
+        for r, row in enumerate(rows):
+            row_diff[r] = grad[row]
+
+        opt.step()
+
+        ids_list += ids.tolist()
+        out_diffs.append(out_diff)
+        outs.append(out.detach().clone())
+        row_ids += rows + [-1] * (seq_len - len(rows))
+        n_rows.append(len(rows))
+        row_diffs.append(row_diff)
+        tables.append(embedding.weight.detach().clone())
+
+    print("Table after the last step:")
+    print(tables[-1])
+
+    f = open("embedding-data.h", "w")
+    write_array(f, "TABLE", table, "Tvocab_size * Tembed_dim")
+    write_ints(f, "IDS", ids_list, "Tn_steps * Tseq_len")
+    write_array(f, "OUT_DIFF", torch.cat(out_diffs, 0), "Tn_steps * Tseq_len * Tembed_dim")
+    write_array(f, "OUT_REF", torch.cat(outs, 0), "Tn_steps * Tseq_len * Tembed_dim")
+    write_ints(f, "ROW_IDS_REF", row_ids, "Tn_steps * Tseq_len")
+    write_ints(f, "N_ROWS_REF", n_rows, "Tn_steps")
+    write_array(f, "ROW_DIFF_REF", torch.cat(row_diffs, 0), "Tn_steps * Tseq_len * Tembed_dim")
+    write_array(f, "TABLE_REF", torch.cat(tables, 0), "Tn_steps * Tvocab_size * Tembed_dim")
+    f.close()
@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "step-check.h"
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition
+#define ERROR_TOLERANCE 0.001
+
+// Sizes of one window
+#define WIN_IN (Tseq_len * Tin_size)
+#define WIN_OUT (Tseq_len * Thidden_size)
+#define WGT_SIZE (3 * Thidden_size * (Tin_size + Thidden_size))
+
+// Main function
+void net_step ();
@@ -0,0 +1,98 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+import torch.nn as nn
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 float " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("GRU Layer Test")
+    parser.add_argument("--step", type=str, default="FORWARD")
+    parser.add_argument("--seq_len", type=int, default=8)
+    parser.add_argument("--n_windows", type=int, default=3)
+    parser.add_argument("--in_size", type=int, default=8)
+    parser.add_argument("--hidden_size", type=int, default=16)
+    args = parser.parse_args()
+
+    step = args.step
+    seq_len = args.seq_len
+    n_windows = args.n_windows
+    in_size = args.in_size
+    hidden_size = args.hidden_size
+
+    f = open("step-check.h", "w")
+    f.write("#define " + step + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Tn_windows " + str(n_windows) + "\n")
+    f.write("#define Tin_size " + str(in_size) + "\n")
+    f.write("#define Thidden_size " + str(hidden_size) + "\n")
+    f.close()
+
+    gru = nn.GRU(in_size, hidden_size)
+    x = torch.randn(n_windows * seq_len, in_size)
+    h0 = 0.5 * torch.randn(1, hidden_size)
+    out_grad = torch.randn(n_windows * seq_len, hidden_size)
+
+    # Truncated BPTT: the state is carried between the windows, the gradient is not
+    h = h0
+    outputs, in_grads, w_grads, b_grads, h_grads = [], [], [], [], []
+    for w in range(n_windows):
+        xw = x[w * seq_len:(w + 1) * seq_len].detach().requires_grad_()
+        hw = h.detach().requires_grad_()
+        gru.zero_grad()
+        out, h = gru(xw, hw)
+        out.backward(out_grad[w * seq_len:(w + 1) * seq_len])
+
+        outputs.append(out.detach())
+        in_grads.append(xw.grad)
+        # Stacked layout of the kernels: [W_ih | W_hh], biases r | z | n | b_hn
+        w_grads.append(torch.cat((gru.weight_ih_l0.grad, gru.weight_hh_l0.grad), 1))
+        b_grads.append(torch.cat((gru.bias_ih_l0.grad, gru.bias_hh_l0.grad[2 * hidden_size:]), 0))
+        h_grads.append(hw.grad)
+
+    print("GRU output:")
+    print(torch.cat(outputs, 0))
+
+    # The r and z biases only appear summed, the candidate gate keeps the recurrent one apart (scaled by r)
+    weights = torch.cat((gru.weight_ih_l0, gru.weight_hh_l0), 1).detach()
+    b_ih = gru.bias_ih_l0.detach()
+    b_hh = gru.bias_hh_l0.detach()
+    biases = torch.cat((b_ih[0:2 * hidden_size] + b_hh[0:2 * hidden_size], b_ih[2 * hidden_size:], b_hh[2 * hidden_size:]), 0)
+
+    f = open("gru-data.h", "w")
+    write_array(f, "INPUT", x, "Tn_windows * Tseq_len * Tin_size")
+    write_array(f, "INIT_STATE", h0, "Thidden_size")
+    write_array(f, "WEIGHTS", weights, "3 * Thidden_size * (Tin_size + Thidden_size)")
+    write_array(f, "BIASES", biases, "4 * Thidden_size")
+    write_array(f, "OUTPUT", torch.cat(outputs, 0), "Tn_windows * Tseq_len * Thidden_size")
+    write_array(f, "FINAL_STATE", h.detach(), "Thidden_size")
+    if step == "BACKWARD":
+        write_array(f, "OUTPUT_GRAD", out_grad, "Tn_windows * Tseq_len * Thidden_size")
+        write_array(f, "INPUT_GRAD", torch.cat(in_grads, 0), "Tn_windows * Tseq_len * Tin_size")
+        write_array(f, "WEIGHTS_GRAD", torch.cat(w_grads, 0), "Tn_windows * 3 * Thidden_size * (Tin_size + Thidden_size)")
+        write_array(f, "BIASES_GRAD", torch.cat(b_grads, 0), "Tn_windows * 4 * Thidden_size")
+        write_array(f, "STATE_GRAD", torch.cat(h_grads, 0), "Tn_windows * Thidden_size")
+    f.close()
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition (mean error relative to the mean magnitude of the reference)
+#define ERROR_TOLERANCE 0.05
+
+// Sizes of the tensors of the Fully-Connected layer
+#define LINEAR_WGT_SIZE (Tout_size * Tin_size)
+#define LINEAR_A_SIZE (Tlora_rank * Tin_size)
+#define LINEAR_B_SIZE (Tout_size * Tlora_rank)
+
+// Sizes of the tensors of the fused QKV projection (E = Tin_size, L = Tseq_len, F = Tatt_dim)
+#define QKV_IN_SIZE (Tin_size * Tseq_len)
+#define QKV_WGT_SIZE (3 * Tatt_dim * Tin_size)
+#define QKV_OUT_SIZE (3 * Tatt_dim * Tseq_len)
+#define QKV_A_SIZE (Tlora_rank * Tin_size)
+#define QKV_B_SIZE (3 * Tatt_dim * Tlora_rank)
+#define QKV_HIDDEN_SIZE (Tlora_rank * Tseq_len)
+
+// Scratch buffer of the fused projection: 3F * L in the forward, 3F * E + E * L in the backward
+#define QKV_TEMP_FW (QKV_OUT_SIZE)
+#define QKV_TEMP_BW (QKV_WGT_SIZE + QKV_IN_SIZE)
+#define QKV_TEMP_SIZE (QKV_TEMP_FW > QKV_TEMP_BW ? QKV_TEMP_FW : QKV_TEMP_BW)
+
+// Main function
+void net_step ();
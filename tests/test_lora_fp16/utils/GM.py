@@ -0,0 +1,123 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+import torch.nn as nn
+
+
+def to_format(t, bf16_format):
+    # Inputs are rounded to the FP16 format of the kernels, the golden model then runs in FP32
+    return t.bfloat16().float() if bf16_format == 1 else t.half().float()
+
+
+class LoRALinear(nn.Module):
+    # Frozen projection with a trainable low-rank adapter: W x + scale * B (A x)
+    def __init__(self, in_features, out_features, rank, alpha, bf16_format):
+        super(LoRALinear, self).__init__()
+        self.base = nn.Linear(in_features=in_features, out_features=out_features, bias=False)
+        self.base.weight = nn.Parameter(to_format(self.base.weight.detach(), bf16_format), requires_grad=False)
+        # B is not zero-initialized as in training from scratch, so that the gradient of A is not zero
+        self.lora_A = nn.Parameter(to_format(0.1 * torch.randn(rank, in_features), bf16_format))
+        self.lora_B = nn.Parameter(to_format(0.1 * torch.randn(out_features, rank), bf16_format))
+        self.scale = alpha / rank
+
+    def forward(self, x):
+        return self.base(x) + self.scale * ((x @ self.lora_A.t()) @ self.lora_B.t())
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 fp16 " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("LoRA Test")
+    parser.add_argument("--in_size", type=int, default=16)
+    parser.add_argument("--out_size", type=int, default=12)
+    parser.add_argument("--lora_rank", type=int, default=4)
+    parser.add_argument("--lora_alpha", type=float, default=8.0)
+    parser.add_argument("--seq_len", type=int, default=6)
+    parser.add_argument("--att_dim", type=int, default=8)
+    parser.add_argument("--bf16_format", type=int, default=1)  # if == 1, data format if bfloat16, if 0 is float16
+    args = parser.parse_args()
+
+    in_size = args.in_size
+    out_size = args.out_size
+    rank = args.lora_rank
+    seq_len = args.seq_len
+    att_dim = args.att_dim
+    bf16_format = args.bf16_format
+
+    if rank < 1:
+        raise ValueError("The test needs lora_rank >= 1")
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tin_size " + str(in_size) + "\n")
+    f.write("#define Tout_size " + str(out_size) + "\n")
+    f.write("#define Tlora_rank " + str(rank) + "\n")
+    f.write("#define Tlora_scale " + str(args.lora_alpha / rank) + "f\n")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Tatt_dim " + str(att_dim) + "\n")
+    f.close()
+
+    f = open("lora-data.h", "w")
+
+    # Fully-Connected layer with LoRA
+    linear = LoRALinear(in_size, out_size, rank, args.lora_alpha, bf16_format)
+    x = to_format(torch.randn(in_size), bf16_format)
+    x.requires_grad = True
+    out_diff = to_format(torch.randn(out_size), bf16_format)
+
+    out = linear(x)
+    out.backward(out_diff)
+    print("Linear output:")
+    print(out)
+
+    write_array(f, "LINEAR_IN", x, "Tin_size")
+    write_array(f, "LINEAR_WEIGHTS", linear.base.weight, "Tout_size * Tin_size")
+    write_array(f, "LINEAR_LORA_A", linear.lora_A, "Tlora_rank * Tin_size")
+    write_array(f, "LINEAR_LORA_B", linear.lora_B, "Tout_size * Tlora_rank")
+    write_array(f, "LINEAR_OUT_DIFF", out_diff, "Tout_size")
+    write_array(f, "LINEAR_OUT_REF", out, "Tout_size")
+    write_array(f, "LINEAR_LORA_A_GRAD_REF", linear.lora_A.grad, "Tlora_rank * Tin_size")
+    write_array(f, "LINEAR_LORA_B_GRAD_REF", linear.lora_B.grad, "Tout_size * Tlora_rank")
+    write_array(f, "LINEAR_IN_GRAD_REF", x.grad, "Tin_size")
+
+    # Fused QKV projection of MHSA with LoRA, on a sequence of seq_len tokens of in_size elements.
+    # The kernels work on the transposed tensors: the input is E x L, the output 3F x L
+    qkv_proj = LoRALinear(in_size, 3 * att_dim, rank, args.lora_alpha, bf16_format)
+    x_seq = to_format(torch.randn(seq_len, in_size), bf16_format)
+    x_seq.requires_grad = True
+    qkv_diff = to_format(torch.randn(seq_len, 3 * att_dim), bf16_format)
+
+    qkv = qkv_proj(x_seq)
+    qkv.backward(qkv_diff)
+    print("QKV output:")
+    print(qkv)
+
+    write_array(f, "QKV_IN", x_seq.t(), "Tin_size * Tseq_len")
+    write_array(f, "QKV_WEIGHTS", qkv_proj.base.weight, "3 * Tatt_dim * Tin_size")
+    write_array(f, "QKV_LORA_A", qkv_proj.lora_A, "Tlora_rank * Tin_size")
+    write_array(f, "QKV_LORA_B", qkv_proj.lora_B, "3 * Tatt_dim * Tlora_rank")
+    write_array(f, "QKV_OUT_DIFF", qkv_diff.t(), "3 * Tatt_dim * Tseq_len")
+    write_array(f, "QKV_OUT_REF", qkv.t(), "3 * Tatt_dim * Tseq_len")
+    write_array(f, "QKV_LORA_A_GRAD_REF", qkv_proj.lora_A.grad, "Tlora_rank * Tin_size")
+    write_array(f, "QKV_LORA_B_GRAD_REF", qkv_proj.lora_B.grad, "3 * Tatt_dim * Tlora_rank")
+    write_array(f, "QKV_IN_GRAD_REF", x_seq.grad.t(), "Tin_size * Tseq_len")
+
+    f.close()
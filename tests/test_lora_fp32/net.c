@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "lora-data.h"
+#include "net.h"
+#include "stats.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+// Fully-Connected layer with LoRA (no biases)
+PI_L1 struct Linear_args fc_args;
+PI_L1 struct blob fc_in, fc_wgt, fc_bias, fc_out, fc_lora_A, fc_lora_B, fc_lora_hidden;
+
+PI_L1 float fc_in_data[Tin_size], fc_in_diff[Tin_size];
+PI_L1 float fc_wgt_data[LINEAR_WGT_SIZE], fc_wgt_diff[LINEAR_WGT_SIZE];
+PI_L1 float fc_bias_data[Tout_size];
+PI_L1 float fc_out_data[Tout_size], fc_out_diff[Tout_size];
+PI_L1 float fc_A_data[LINEAR_A_SIZE], fc_A_diff[LINEAR_A_SIZE];
+PI_L1 float fc_B_data[LINEAR_B_SIZE], fc_B_diff[LINEAR_B_SIZE];
+PI_L1 float fc_hidden_data[Tlora_rank], fc_hidden_diff[Tlora_rank];
+
+// Fused QKV projection of MHSA with LoRA (no biases)
+PI_L1 struct Mhsa_args mhsa_args;
+PI_L1 struct blob qkv_in, qkv_wgt, qkv_out, qkv_att_map, qkv_lora_A, qkv_lora_B, qkv_lora_hidden;
+
+PI_L1 float qkv_in_data[QKV_IN_SIZE], qkv_in_diff[QKV_IN_SIZE];
+PI_L1 float qkv_wgt_data[QKV_WGT_SIZE], qkv_wgt_diff[QKV_WGT_SIZE];
+PI_L1 float qkv_out_data[QKV_OUT_SIZE], qkv_out_diff[QKV_OUT_SIZE];
+PI_L1 float qkv_A_data[QKV_A_SIZE], qkv_A_diff[QKV_A_SIZE];
+PI_L1 float qkv_B_data[QKV_B_SIZE], qkv_B_diff[QKV_B_SIZE];
+PI_L1 float qkv_hidden_data[QKV_HIDDEN_SIZE], qkv_hidden_diff[QKV_HIDDEN_SIZE];
+PI_L1 float qkv_temp[QKV_TEMP_SIZE];
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+static inline void check(char *name, float *tensor_out, float *tensor_ref, int size) {
+    printf("\n%s CHECK: \n", name);
+    if (verify_tensor(tensor_out, tensor_ref, size, ERROR_TOLERANCE) == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n");
+}
+
+// The frozen weights must not get a gradient: their diff is zeroed before the backward and must stay so
+static inline void check_frozen(char *name, float *diff, int size) {
+    int written = 0;
+    for (int i = 0; i < size; i++)
+        if (diff[i] != 0.0f) written++;
+    printf("\n%s CHECK: \n", name);
+    if (written == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n(%d elements of the gradient written)\n", written);
+}
+
+static inline void copy_tensor(float *dst, float *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void zero_tensor(float *dst, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = 0.0f;
+}
+
+static inline void init_blob(struct blob *b, float *data, float *diff, int dim) {
+    b->data = data;
+    b->diff = diff;
+    b->dim = dim;
+}
+
+static void prepare_linear() {
+    copy_tensor(fc_in_data, LINEAR_IN, Tin_size);
+    copy_tensor(fc_wgt_data, LINEAR_WEIGHTS, LINEAR_WGT_SIZE);
+    copy_tensor(fc_A_data, LINEAR_LORA_A, LINEAR_A_SIZE);
+    copy_tensor(fc_B_data, LINEAR_LORA_B, LINEAR_B_SIZE);
+    copy_tensor(fc_out_diff, LINEAR_OUT_DIFF, Tout_size);
+    zero_tensor(fc_in_diff, Tin_size);
+    zero_tensor(fc_wgt_diff, LINEAR_WGT_SIZE);
+    zero_tensor(fc_bias_data, Tout_size);
+    zero_tensor(fc_out_data, Tout_size);
+
+    init_blob(&fc_in, fc_in_data, fc_in_diff, Tin_size);
+    init_blob(&fc_wgt, fc_wgt_data, fc_wgt_diff, LINEAR_WGT_SIZE);
+    init_blob(&fc_bias, fc_bias_data, NULL, Tout_size);
+    init_blob(&fc_out, fc_out_data, fc_out_diff, Tout_size);
+    init_blob(&fc_lora_A, fc_A_data, fc_A_diff, LINEAR_A_SIZE);
+    init_blob(&fc_lora_B, fc_B_data, fc_B_diff, LINEAR_B_SIZE);
+    init_blob(&fc_lora_hidden, fc_hidden_data, fc_hidden_diff, Tlora_rank);
+
+    fc_args.input = &fc_in;
+    fc_args.coeff = &fc_wgt;
+    fc_args.bias = &fc_bias;
+    fc_args.output = &fc_out;
+    fc_args.skip_wg_grad = 0;
+    fc_args.skip_in_grad = 0;
+    fc_args.opt_matmul_type_fw = MATMUL_TYPE;
+    fc_args.opt_matmul_type_wg = MATMUL_TYPE;
+    fc_args.opt_matmul_type_ig = MATMUL_TYPE;
+    fc_args.use_biases = 0;
+    fc_args.lora_A = &fc_lora_A;
+    fc_args.lora_B = &fc_lora_B;
+    fc_args.lora_hidden = &fc_lora_hidden;
+    fc_args.lora_rank = Tlora_rank;
+    fc_args.lora_scale = Tlora_scale;
+}
+
+static void prepare_qkv() {
+    copy_tensor(qkv_in_data, QKV_IN, QKV_IN_SIZE);
+    copy_tensor(qkv_wgt_data, QKV_WEIGHTS, QKV_WGT_SIZE);
+    copy_tensor(qkv_A_data, QKV_LORA_A, QKV_A_SIZE);
+    copy_tensor(qkv_B_data, QKV_LORA_B, QKV_B_SIZE);
+    copy_tensor(qkv_out_diff, QKV_OUT_DIFF, QKV_OUT_SIZE);
+    zero_tensor(qkv_in_diff, QKV_IN_SIZE);
+    zero_tensor(qkv_wgt_diff, QKV_WGT_SIZE);
+    zero_tensor(qkv_out_data, QKV_OUT_SIZE);
+
+    init_blob(&qkv_in, qkv_in_data, qkv_in_diff, QKV_IN_SIZE);
+    qkv_in.H = Tseq_len;
+    qkv_in.W = Tin_size;
+    init_blob(&qkv_wgt, qkv_wgt_data, qkv_wgt_diff, QKV_WGT_SIZE);
+    init_blob(&qkv_out, qkv_out_data, qkv_out_diff, QKV_OUT_SIZE);
+    // Only the hidden dimension F is read from the attention map by the fused projection
+    qkv_att_map.W = Tatt_dim;
+    init_blob(&qkv_lora_A, qkv_A_data, qkv_A_diff, QKV_A_SIZE);
+    init_blob(&qkv_lora_B, qkv_B_data, qkv_B_diff, QKV_B_SIZE);
+    init_blob(&qkv_lora_hidden, qkv_hidden_data, qkv_hidden_diff, QKV_HIDDEN_SIZE);
+
+    mhsa_args.input = &qkv_in;
+    mhsa_args.q = &qkv_out;
+    mhsa_args.attention_map = &qkv_att_map;
+    mhsa_args.coeff_in_qkv = &qkv_wgt;
+    mhsa_args.bias_in_qkv = NULL;
+    mhsa_args.temp_buffer = qkv_temp;
+    mhsa_args.opt_matmul_type_fw = MATMUL_TYPE;
+    mhsa_args.opt_matmul_type_wg = MATMUL_TYPE;
+    mhsa_args.opt_matmul_type_ig = MATMUL_TYPE;
+    mhsa_args.lora_A_qkv = &qkv_lora_A;
+    mhsa_args.lora_B_qkv = &qkv_lora_B;
+    mhsa_args.lora_hidden_qkv = &qkv_lora_hidden;
+    mhsa_args.lora_rank = Tlora_rank;
+    mhsa_args.lora_scale = Tlora_scale;
+}
+
+
+
+// Main function
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nLinear: %d -> %d, QKV: %d x %d -> %d x %d, LoRA rank = %d\n", Tin_size, Tout_size, Tin_size, Tseq_len, 3 * Tatt_dim, Tseq_len, Tlora_rank);
+
+    prepare_linear();
+    prepare_qkv();
+
+    printf("\n----- FULLY-CONNECTED LAYER -----\n");
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_linear_fp32_fw_cl(&fc_args);
+    pulp_linear_fp32_bw_cl(&fc_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    check("LINEAR OUTPUT", fc_out_data, LINEAR_OUT_REF, Tout_size);
+    check("LINEAR LORA_A GRADIENT", fc_A_diff, LINEAR_LORA_A_GRAD_REF, LINEAR_A_SIZE);
+    check("LINEAR LORA_B GRADIENT", fc_B_diff, LINEAR_LORA_B_GRAD_REF, LINEAR_B_SIZE);
+    check("LINEAR INPUT GRADIENT", fc_in_diff, LINEAR_IN_GRAD_REF, Tin_size);
+    check_frozen("LINEAR FROZEN WEIGHTS", fc_wgt_diff, LINEAR_WGT_SIZE);
+
+    printf("\n----- FUSED QKV PROJECTION -----\n");
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_mhsa_fp32_qkv_fw_cl(&mhsa_args);
+    pulp_mhsa_fp32_qkv_bw_cl(&mhsa_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+
+    check("QKV OUTPUT", qkv_out_data, QKV_OUT_REF, QKV_OUT_SIZE);
+    check("QKV LORA_A GRADIENT", qkv_A_diff, QKV_LORA_A_GRAD_REF, QKV_A_SIZE);
+    check("QKV LORA_B GRADIENT", qkv_B_diff, QKV_LORA_B_GRAD_REF, QKV_B_SIZE);
+    check("QKV INPUT GRADIENT", qkv_in_diff, QKV_IN_GRAD_REF, QKV_IN_SIZE);
+    check_frozen("QKV FROZEN WEIGHTS", qkv_wgt_diff, QKV_WGT_SIZE);
+
+    return;
+}
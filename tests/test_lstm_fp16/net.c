@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "lstm-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+PI_L1 struct Gated_rnn_args_fp16 lstm_args;
+PI_L1 struct blob_fp16 layer_in, layer_out, layer_state, layer_cell_state, layer_wgt, layer_bias;
+
+PI_L1 fp16 l1_in[WIN_IN];
+PI_L1 fp16 l1_out[WIN_OUT];
+PI_L1 fp16 l1_state[Thidden_size];
+PI_L1 fp16 l1_cell_state[Thidden_size];
+PI_L1 fp16 l1_wgt[WGT_SIZE];
+PI_L1 fp16 l1_bias[4 * Thidden_size];
+PI_L1 fp16 l1_gates[4 * WIN_OUT];
+PI_L1 fp16 l1_cells[WIN_OUT];
+PI_L1 fp16 l1_prev_state[2 * Thidden_size];
+
+#ifdef BACKWARD
+PI_L1 fp16 l1_in_diff[WIN_IN];
+PI_L1 fp16 l1_out_diff[WIN_OUT];
+PI_L1 fp16 l1_state_diff[Thidden_size];
+PI_L1 fp16 l1_cell_state_diff[Thidden_size];
+PI_L1 fp16 l1_wgt_diff[WGT_SIZE];
+PI_L1 fp16 l1_bias_diff[4 * Thidden_size];
+PI_L1 fp16 l1_grad_buffer[2 * Thidden_size];
+#endif
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+// Mean error checker - relative to the mean magnitude of the reference, elements close to 0 do not blow it up
+static inline void check(char *name, fp16 *tensor_out, fp16 *tensor_ref, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - (float) tensor_ref[i];
+        err += diff > 0 ? diff : -diff;
+        norm += tensor_ref[i] > 0 ? (float) tensor_ref[i] : -(float) tensor_ref[i];
+    }
+    err = err / norm;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+static inline void copy_tensor(fp16 *dst, fp16 *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static void init_blob(struct blob_fp16 *b, fp16 *data, fp16 *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+
+static void prepare_layer() {
+    fp16 *in_diff = NULL, *out_diff = NULL, *state_diff = NULL, *cell_state_diff = NULL, *wgt_diff = NULL, *bias_diff = NULL;
+#ifdef BACKWARD
+    in_diff = l1_in_diff;
+    out_diff = l1_out_diff;
+    state_diff = l1_state_diff;
+    cell_state_diff = l1_cell_state_diff;
+    wgt_diff = l1_wgt_diff;
+    bias_diff = l1_bias_diff;
+    lstm_args.grad_buffer = l1_grad_buffer;
+#endif
+
+    init_blob(&layer_in, l1_in, in_diff, Tseq_len, Tin_size);
+    init_blob(&layer_out, l1_out, out_diff, Tseq_len, Thidden_size);
+    init_blob(&layer_state, l1_state, state_diff, 1, Thidden_size);
+    init_blob(&layer_cell_state, l1_cell_state, cell_state_diff, 1, Thidden_size);
+    init_blob(&layer_wgt, l1_wgt, wgt_diff, 4 * Thidden_size, Tin_size + Thidden_size);
+    init_blob(&layer_bias, l1_bias, bias_diff, 1, 4 * Thidden_size);
+
+    copy_tensor(l1_state, INIT_STATE, Thidden_size);
+    copy_tensor(l1_cell_state, INIT_CELL_STATE, Thidden_size);
+    copy_tensor(l1_wgt, WEIGHTS, WGT_SIZE);
+    copy_tensor(l1_bias, BIASES, 4 * Thidden_size);
+
+    lstm_args.input = &layer_in;
+    lstm_args.output = &layer_out;
+    lstm_args.state = &layer_state;
+    lstm_args.cell_state = &layer_cell_state;
+    lstm_args.coeff = &layer_wgt;
+    lstm_args.bias = &layer_bias;
+    lstm_args.gates = l1_gates;
+    lstm_args.cells = l1_cells;
+    lstm_args.carry_state = 1;
+    lstm_args.prev_state = l1_prev_state;
+}
+
+
+
+// Main function
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nN = %d, K = %d, H = %d, windows = %d\n", Tseq_len, Tin_size, Thidden_size, Tn_windows);
+
+    prepare_layer();
+
+    // One call per window, the state of the last timestep being carried to the next one (cycles are cumulative)
+    for (int w = 0; w < Tn_windows; w++) {
+        copy_tensor(l1_in, INPUT + w * WIN_IN, WIN_IN);
+#ifdef BACKWARD
+        copy_tensor(l1_out_diff, OUTPUT_GRAD + w * WIN_OUT, WIN_OUT);
+#endif
+
+#ifdef FORWARD
+        printf("\n----- LSTM FORWARD, WINDOW %d -----\n", w);
+#else
+        printf("\n----- LSTM FORWARD AND BACKWARD, WINDOW %d -----\n", w);
+#endif
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        pulp_lstm_fp16_fw_cl(&lstm_args);
+#ifdef BACKWARD
+        pulp_lstm_fp16_bw_cl(&lstm_args);
+#endif
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+
+        check("LSTM OUTPUT", l1_out, OUTPUT + w * WIN_OUT, WIN_OUT);
+#ifdef BACKWARD
+        check("INPUT GRADIENT", l1_in_diff, INPUT_GRAD + w * WIN_IN, WIN_IN);
+        check("WEIGHT GRADIENT", l1_wgt_diff, WEIGHTS_GRAD + w * WGT_SIZE, WGT_SIZE);
+        check("BIAS GRADIENT", l1_bias_diff, BIASES_GRAD + w * 4 * Thidden_size, 4 * Thidden_size);
+        check("STATE GRADIENT", l1_state_diff, STATE_GRAD + w * Thidden_size, Thidden_size);
+        check("CELL STATE GRADIENT", l1_cell_state_diff, CELL_STATE_GRAD + w * Thidden_size, Thidden_size);
+#endif
+    }
+
+    check("FINAL STATE", l1_state, FINAL_STATE, Thidden_size);
+    check("FINAL CELL STATE", l1_cell_state, FINAL_CELL_STATE, Thidden_size);
+
+    return;
+}
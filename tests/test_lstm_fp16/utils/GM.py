@@ -0,0 +1,111 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+import torch.nn as nn
+
+
+def to_format(t, bf16_format):
+    # Inputs are rounded to the FP16 format of the kernels, the golden model then runs in FP32
+    return t.bfloat16().float() if bf16_format == 1 else t.half().float()
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 fp16 " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("LSTM Layer Test")
+    parser.add_argument("--step", type=str, default="FORWARD")
+    parser.add_argument("--seq_len", type=int, default=8)
+    parser.add_argument("--n_windows", type=int, default=3)
+    parser.add_argument("--in_size", type=int, default=8)
+    parser.add_argument("--hidden_size", type=int, default=16)
+    parser.add_argument("--bf16_format", type=int, default=1)  # if == 1, data format if bfloat16, if 0 is float16
+    args = parser.parse_args()
+
+    step = args.step
+    seq_len = args.seq_len
+    n_windows = args.n_windows
+    in_size = args.in_size
+    hidden_size = args.hidden_size
+    bf16_format = args.bf16_format
+
+    f = open("step-check.h", "w")
+    f.write("#define " + step + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Tn_windows " + str(n_windows) + "\n")
+    f.write("#define Tin_size " + str(in_size) + "\n")
+    f.write("#define Thidden_size " + str(hidden_size) + "\n")
+    f.close()
+
+    lstm = nn.LSTM(in_size, hidden_size)
+    with torch.no_grad():
+        for p in lstm.parameters():
+            p.copy_(to_format(p, bf16_format))
+    x = to_format(torch.randn(n_windows * seq_len, in_size), bf16_format)
+    h0 = to_format(0.5 * torch.randn(1, hidden_size), bf16_format)
+    c0 = to_format(0.5 * torch.randn(1, hidden_size), bf16_format)
+    out_grad = to_format(torch.randn(n_windows * seq_len, hidden_size), bf16_format)
+
+    # Truncated BPTT: the state is carried between the windows, the gradient is not
+    h, c = h0, c0
+    outputs, in_grads, w_grads, b_grads, h_grads, c_grads = [], [], [], [], [], []
+    for w in range(n_windows):
+        xw = x[w * seq_len:(w + 1) * seq_len].detach().requires_grad_()
+        hw = h.detach().requires_grad_()
+        cw = c.detach().requires_grad_()
+        lstm.zero_grad()
+        out, (h, c) = lstm(xw, (hw, cw))
+        out.backward(out_grad[w * seq_len:(w + 1) * seq_len])
+
+        outputs.append(out.detach())
+        in_grads.append(xw.grad)
+        # Stacked layout of the kernels: [W_ih | W_hh], the two biases only appear summed
+        w_grads.append(torch.cat((lstm.weight_ih_l0.grad, lstm.weight_hh_l0.grad), 1))
+        b_grads.append(lstm.bias_ih_l0.grad)
+        h_grads.append(hw.grad)
+        c_grads.append(cw.grad)
+
+    print("LSTM output:")
+    print(torch.cat(outputs, 0))
+
+    weights = torch.cat((lstm.weight_ih_l0, lstm.weight_hh_l0), 1).detach()
+    biases = to_format((lstm.bias_ih_l0 + lstm.bias_hh_l0).detach(), bf16_format)
+
+    f = open("lstm-data.h", "w")
+    write_array(f, "INPUT", x, "Tn_windows * Tseq_len * Tin_size")
+    write_array(f, "INIT_STATE", h0, "Thidden_size")
+    write_array(f, "INIT_CELL_STATE", c0, "Thidden_size")
+    write_array(f, "WEIGHTS", weights, "4 * Thidden_size * (Tin_size + Thidden_size)")
+    write_array(f, "BIASES", biases, "4 * Thidden_size")
+    write_array(f, "OUTPUT", torch.cat(outputs, 0), "Tn_windows * Tseq_len * Thidden_size")
+    write_array(f, "FINAL_STATE", h.detach(), "Thidden_size")
+    write_array(f, "FINAL_CELL_STATE", c.detach(), "Thidden_size")
+    if step == "BACKWARD":
+        write_array(f, "OUTPUT_GRAD", out_grad, "Tn_windows * Tseq_len * Thidden_size")
+        write_array(f, "INPUT_GRAD", torch.cat(in_grads, 0), "Tn_windows * Tseq_len * Tin_size")
+        write_array(f, "WEIGHTS_GRAD", torch.cat(w_grads, 0), "Tn_windows * 4 * Thidden_size * (Tin_size + Thidden_size)")
+        write_array(f, "BIASES_GRAD", torch.cat(b_grads, 0), "Tn_windows * 4 * Thidden_size")
+        write_array(f, "STATE_GRAD", torch.cat(h_grads, 0), "Tn_windows * Thidden_size")
+        write_array(f, "CELL_STATE_GRAD", torch.cat(c_grads, 0), "Tn_windows * Thidden_size")
+    f.close()
@@ -66,10 +66,12 @@ static inline void multiply ()
 {
     #ifdef FLOAT32
     struct matMul_args mm_args;
+    struct mm_epilogue_args ep_args;
     #endif
 
     #ifdef FLOAT16
     struct matMul_args_fp16 mm_args;
+    struct mm_epilogue_args_fp16 ep_args;
     #endif
 
     // General setup for matmuls
@@ -82,6 +84,10 @@ static inline void multiply ()
     mm_args.trans_B = TRANSPOSE_B;
     // End of general setup
 
+    // Epilogue matmuls compute C = (A*B) .* SCALE
+    ep_args.mm_args = &mm_args;
+    ep_args.scale = SCALE;
+
     if (mm_args.trans_B == 1) printf("Running matmuls with transposed B matrix.\n");
     else printf("Running matmuls with no transpositions.\n");
 
@@ -157,6 +163,14 @@ static inline void multiply ()
     compare_tensors(result, C, IN_CH*OUT_CH);
     null_tensor(result, IN_CH*OUT_CH);
 
+    printf("\n-----> Profiling mm_mul_epilogue:\n");
+    START_STATS();
+    pi_cl_team_fork(NUM_CORES, mm_mul_epilogue, &ep_args);
+    STOP_STATS();
+    check_tensor(result, C_EPILOGUE, IN_CH*OUT_CH);
+    compare_tensors(result, C_EPILOGUE, IN_CH*OUT_CH);
+    null_tensor(result, IN_CH*OUT_CH);
+
     /*
 
     printf("\n-----> Profiling mm_unroll_8x1:\n");
@@ -365,6 +379,14 @@ static inline void multiply ()
     check_tensor(result, C, IN_CH*OUT_CH);
     compare_tensors(result, C, IN_CH*OUT_CH);
     null_tensor(result, IN_CH*OUT_CH); 
+
+    printf("\n-----> Profiling mm_mul_epilogue_fp16:\n");
+    START_STATS();
+    pi_cl_team_fork(NUM_CORES, mm_mul_epilogue_fp16, &ep_args);
+    STOP_STATS();
+    check_tensor(result, C_EPILOGUE, IN_CH*OUT_CH);
+    compare_tensors(result, C_EPILOGUE, IN_CH*OUT_CH);
+    null_tensor(result, IN_CH*OUT_CH);
     #endif
 
 
@@ -132,6 +132,21 @@ if matmul_alg == 'STANDARD':
         print('Invalid data type selection!!')
         exit()
 
+    # Elementwise scale of the epilogue matmuls (C_EPILOGUE = C .* SCALE), at most 1 not to amplify the FP16 accumulation error
+    SCALE = torch.zeros(in_size, out_size)
+    for i in range(SCALE.shape[0]):
+        for j in range(SCALE.shape[1]):
+            SCALE[i][j] = 0.25 + ((i + 2*j) % 4) * 0.25
+
+    # The epilogue is applied before rounding the result, so the reference is rounded to FP16 only once
+    if transp == '1':
+        C_EPILOGUE = torch.mm(input=A.float(), mat2=B.float().transpose(0, 1)) * SCALE
+    else:
+        C_EPILOGUE = torch.mm(input=A.float(), mat2=B.float()) * SCALE
+    if data_type == 'fp16':
+        SCALE = SCALE.half()
+        C_EPILOGUE = C_EPILOGUE.half()
+
 
 
     # Print data and create data header file
@@ -175,6 +190,12 @@ if matmul_alg == 'STANDARD':
     print("\nC is: ", C, C.shape, C.dtype)
     f.write('PI_L2 ' + data_type + ' C[IN_CH*OUT_CH] = {'+dump.tensor_to_string(C)+'};\n')
 
+    print("\nSCALE is: ", SCALE, SCALE.shape, SCALE.dtype)
+    f.write('PI_L1 ' + data_type + ' SCALE[IN_CH*OUT_CH] = {'+dump.tensor_to_string(SCALE)+'};\n')
+
+    print("\nC_EPILOGUE is: ", C_EPILOGUE, C_EPILOGUE.shape, C_EPILOGUE.dtype)
+    f.write('PI_L2 ' + data_type + ' C_EPILOGUE[IN_CH*OUT_CH] = {'+dump.tensor_to_string(C_EPILOGUE)+'};\n')
+
     print("\n\n")
 
     f.close()
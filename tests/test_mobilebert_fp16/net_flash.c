@@ -1558,6 +1558,21 @@ void reset_arguments(){
     tiled_matmul_mhsa_args.man_args = &man_args;
     tiled_matmul_mhsa_args.cmd_load = cmd_load;
     tiled_matmul_mhsa_args.cmd_store = cmd_store;
+    tiled_matmul_mhsa_args.tile_h_p = TILE_H_P;
+    tiled_matmul_mhsa_args.tile_w_p = TILE_W_P;
+    tiled_matmul_mhsa_args.tile_dim_p = TILE_DIM_P;
+    tiled_matmul_mhsa_args.tile_h_sm = TILE_H_SM;
+    tiled_matmul_mhsa_args.tile_w_sm = TILE_W_SM;
+    tiled_matmul_mhsa_args.tile_dim_sm = TILE_DIM_SM;
+    tiled_matmul_mhsa_args.tile_h_tr = TILE_H_TR;
+    tiled_matmul_mhsa_args.tile_w_tr = TILE_W_TR;
+    tiled_matmul_mhsa_args.tile_dim_tr = TILE_DIM_TR;
+    tiled_matmul_mhsa_args.tile_h_attv = TILE_H_ATTV;
+    tiled_matmul_mhsa_args.tile_w_attv = TILE_W_ATTV;
+    tiled_matmul_mhsa_args.tile_dim_attv = TILE_DIM_ATTV;
+    tiled_matmul_mhsa_args.tile_h_out_tr = TILE_H_OUT_TR;
+    tiled_matmul_mhsa_args.tile_w_out_tr = TILE_W_OUT_TR;
+    tiled_matmul_mhsa_args.tile_dim_out_tr = TILE_DIM_OUT_TR;
 }
 
 /*
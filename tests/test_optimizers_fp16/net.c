@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "optim-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+#include <math.h>
+
+
+// The same two layers are updated by the single layer optimizers (with pulp_clip_grad_norm_fp16 before them)
+// and by the multi-tensor step (with its max_grad_norm option), each on its own copy. The mixed precision step uses the second copy.
+#define SINGLE 0
+#define MULTI 1
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+PI_L1 struct blob_fp16 layer0_wgt[2], layer0_bias[2], layer1_wgt[2];
+PI_L1 float partial_sums[NUM_CORES];
+
+PI_L1 fp16 l1_w0[2][W0_SIZE], l1_w0_diff[2][W0_SIZE];
+PI_L1 fp16 l1_b0[2][B0_SIZE], l1_b0_diff[2][B0_SIZE];
+PI_L1 fp16 l1_w1[2][W1_SIZE], l1_w1_diff[2][W1_SIZE];
+
+#ifndef MIXED_PRECISION
+PI_L1 struct optim_args_fp16 sgd_layers[2][2];
+PI_L1 struct adam_args_fp16 adam_layers[2][2];
+PI_L1 struct optim_multi_args_fp16 multi_args;
+PI_L1 struct clip_grad_norm_args_fp16 clip_args;
+PI_L1 struct blob_fp16 * clip_blobs[3];
+
+// Velocity (momentum SGD) or first moment (Adam), and second moment (Adam)
+PI_L1 fp16 l1_w0_m[2][W0_SIZE], l1_w0_v[2][W0_SIZE];
+PI_L1 fp16 l1_b0_m[2][B0_SIZE], l1_b0_v[2][B0_SIZE];
+PI_L1 fp16 l1_w1_m[2][W1_SIZE], l1_w1_v[2][W1_SIZE];
+#else
+PI_L1 struct blob master_w0, master_b0, master_w1;
+PI_L1 struct optim_args master_sgd_layers[2];
+PI_L1 struct adam_args master_adam_layers[2];
+PI_L1 struct optim_multi_args master_multi_args;
+PI_L1 struct mixed_precision_args_fp16 mp_args;
+PI_L1 struct blob_fp16 * mp_params[3];
+PI_L1 struct blob * mp_master[3];
+
+PI_L1 float l1_mw0[W0_SIZE], l1_mw0_diff[W0_SIZE], l1_mw0_m[W0_SIZE], l1_mw0_v[W0_SIZE];
+PI_L1 float l1_mb0[B0_SIZE], l1_mb0_diff[B0_SIZE], l1_mb0_m[B0_SIZE], l1_mb0_v[B0_SIZE];
+PI_L1 float l1_mw1[W1_SIZE], l1_mw1_diff[W1_SIZE], l1_mw1_m[W1_SIZE], l1_mw1_v[W1_SIZE];
+
+// Parameters before the step, which an overflow must leave untouched
+PI_L1 fp16 prev_w0[W0_SIZE], prev_b0[B0_SIZE], prev_w1[W1_SIZE];
+PI_L1 float prev_mw0[W0_SIZE], prev_mb0[B0_SIZE], prev_mw1[W1_SIZE];
+#endif
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+// Mean error checker - relative to the mean magnitude of the update of the reference, which is much smaller than the parameters
+static inline void check(char *name, fp16 *tensor_out, float *tensor_ref, fp16 *tensor_init, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - tensor_ref[i];
+        float update = tensor_ref[i] - (float) tensor_init[i];
+        err += diff > 0 ? diff : -diff;
+        norm += update > 0 ? update : -update;
+    }
+    err = err / norm;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+static inline void check_fp32(char *name, float *tensor_out, float *tensor_ref, int size) {
+    printf("\n%s CHECK: \n", name);
+    if (verify_tensor(tensor_out, tensor_ref, size, ERROR_TOLERANCE_FP32) == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n");
+}
+
+static inline void check_norm(char *name, float norm, float norm_ref) {
+    float err = (norm - norm_ref) / norm_ref;
+    printf("\n%s CHECK: \n", name);
+    if (ABS(err) < ERROR_TOLERANCE_FP32) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n(Ideal = %f  vs  Actual = %f)\n", norm_ref, norm);
+}
+
+// Number of elements whose bits differ
+static inline int count_mismatches(fp16 *a, fp16 *b, int size) {
+    int mismatches = 0;
+    for (int i = 0; i < size; i++)
+        if (*(unsigned short *) &a[i] != *(unsigned short *) &b[i]) mismatches++;
+    return mismatches;
+}
+
+static inline void copy_tensor(fp16 *dst, fp16 *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static void init_blob(struct blob_fp16 *b, fp16 *data, fp16 *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+
+static void prepare_path(int p) {
+    init_blob(&layer0_wgt[p], l1_w0[p], l1_w0_diff[p], Thidden_size, Tin_size);
+    init_blob(&layer0_bias[p], l1_b0[p], l1_b0_diff[p], 1, Thidden_size);
+    init_blob(&layer1_wgt[p], l1_w1[p], l1_w1_diff[p], Tout_size, Thidden_size);
+
+    copy_tensor(l1_w0[p], WEIGHTS0, W0_SIZE);
+    copy_tensor(l1_b0[p], BIASES0, B0_SIZE);
+    copy_tensor(l1_w1[p], WEIGHTS1, W1_SIZE);
+}
+
+static void load_gradients(int p, int step) {
+    copy_tensor(l1_w0_diff[p], WEIGHTS0_GRAD + step * W0_SIZE, W0_SIZE);
+    copy_tensor(l1_b0_diff[p], BIASES0_GRAD + step * B0_SIZE, B0_SIZE);
+    copy_tensor(l1_w1_diff[p], WEIGHTS1_GRAD + step * W1_SIZE, W1_SIZE);
+}
+
+static void check_params(int p, int step) {
+    check("WEIGHTS 0", l1_w0[p], WEIGHTS0_REF + step * W0_SIZE, WEIGHTS0, W0_SIZE);
+    check("BIASES 0", l1_b0[p], BIASES0_REF + step * B0_SIZE, BIASES0, B0_SIZE);
+    check("WEIGHTS 1", l1_w1[p], WEIGHTS1_REF + step * W1_SIZE, WEIGHTS1, W1_SIZE);
+}
+
+
+
+#ifndef MIXED_PRECISION
+
+static inline void zero_tensor(fp16 *dst, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = 0;
+}
+
+static void prepare_optimizer(int p) {
+    zero_tensor(l1_w0_m[p], W0_SIZE);  zero_tensor(l1_w0_v[p], W0_SIZE);
+    zero_tensor(l1_b0_m[p], B0_SIZE);  zero_tensor(l1_b0_v[p], B0_SIZE);
+    zero_tensor(l1_w1_m[p], W1_SIZE);  zero_tensor(l1_w1_v[p], W1_SIZE);
+
+    for (int l = 0; l < 2; l++) {
+        struct optim_args_fp16 *sgd = &sgd_layers[p][l];
+        sgd->weights = l == 0 ? &layer0_wgt[p] : &layer1_wgt[p];
+        sgd->biases = l == 0 ? &layer0_bias[p] : NULL;
+        sgd->use_biases = l == 0;
+        sgd->learning_rate = Tlearning_rate;
+        sgd->momentum = Tmomentum;
+        sgd->nesterov = Tnesterov;
+        sgd->weight_decay = Tweight_decay;
+        sgd->decoupled_weight_decay = Tdecoupled_weight_decay;
+        sgd->velocity_weights = l == 0 ? l1_w0_m[p] : l1_w1_m[p];
+        sgd->velocity_biases = l == 0 ? l1_b0_m[p] : NULL;
+        sgd->rounding = Trounding;
+        sgd->seed = 0;
+
+        struct adam_args_fp16 *adam = &adam_layers[p][l];
+        adam->weights = sgd->weights;
+        adam->biases = sgd->biases;
+        adam->use_biases = sgd->use_biases;
+        adam->m_weights = l == 0 ? l1_w0_m[p] : l1_w1_m[p];
+        adam->v_weights = l == 0 ? l1_w0_v[p] : l1_w1_v[p];
+        adam->m_biases = l == 0 ? l1_b0_m[p] : NULL;
+        adam->v_biases = l == 0 ? l1_b0_v[p] : NULL;
+        adam->learning_rate = Tlearning_rate;
+        adam->beta1 = Tbeta1;
+        adam->beta2 = Tbeta2;
+        adam->eps = Teps;
+        adam->weight_decay = Tweight_decay;
+        adam->step = 0;
+        adam->rounding = Trounding;
+        adam->seed = 0;
+    }
+}
+
+// Next step of the layers of a path: Adam counts the steps, SGD takes a new seed
+static void next_step(int p, int step) {
+    for (int l = 0; l < 2; l++) {
+        adam_layers[p][l].step++;
+        sgd_layers[p][l].seed = step;
+    }
+}
+
+// One step of the single layer path: clipping of the gradients in place, then one fork per layer
+static void single_layer_step() {
+    if (Tmax_grad_norm > 0) {
+        pi_cl_team_fork(NUM_CORES, pulp_clip_grad_norm_fp16, &clip_args);
+    }
+    for (int l = 0; l < 2; l++) {
+        if (Toptimizer == OPTIM_ADAM)               pi_cl_team_fork(NUM_CORES, pulp_adam_fp16, &adam_layers[SINGLE][l]);
+        else if (Toptimizer == OPTIM_SGD_MOMENTUM)  pi_cl_team_fork(NUM_CORES, pulp_sgd_momentum_fp16, &sgd_layers[SINGLE][l]);
+        else                                        pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp16, &sgd_layers[SINGLE][l]);
+    }
+}
+
+// Mean update of all the parameters of a path, against the one of the reference
+static void check_mean_update(char *name, int p, int step) {
+    float update = 0.0f, update_ref = 0.0f;
+    for (int i = 0; i < W0_SIZE; i++) {
+        update += (float) l1_w0[p][i] - (float) WEIGHTS0[i];
+        update_ref += WEIGHTS0_REF[step * W0_SIZE + i] - (float) WEIGHTS0[i];
+    }
+    for (int i = 0; i < B0_SIZE; i++) {
+        update += (float) l1_b0[p][i] - (float) BIASES0[i];
+        update_ref += BIASES0_REF[step * B0_SIZE + i] - (float) BIASES0[i];
+    }
+    for (int i = 0; i < W1_SIZE; i++) {
+        update += (float) l1_w1[p][i] - (float) WEIGHTS1[i];
+        update_ref += WEIGHTS1_REF[step * W1_SIZE + i] - (float) WEIGHTS1[i];
+    }
+    float err = (update - update_ref) / update_ref;
+
+    printf("\n%s CHECK: \n", name);
+    if (ABS(err) < SR_TOLERANCE) printf(">>>TENSOR MATCHING!\nRELATIVE ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nRELATIVE ERROR:%f\n", err);
+}
+
+#else
+
+static void init_master_blob(struct blob *b, float *data, float *diff, int size) {
+    b->data = data;
+    b->diff = diff;
+    b->H = 1;
+    b->W = size;
+    b->C = 1;
+    b->dim = size;
+}
+
+static inline void copy_tensor_fp32(float *dst, float *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void zero_tensor_fp32(float *dst, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = 0.0f;
+}
+
+// Number of FP16 parameters that are not the cast of their master weight
+static inline int count_cast_mismatches(fp16 *w, float *master_w, int size) {
+    int mismatches = 0;
+    for (int i = 0; i < size; i++) {
+        fp16 cast = (fp16) master_w[i];
+        if (*(unsigned short *) &w[i] != *(unsigned short *) &cast) mismatches++;
+    }
+    return mismatches;
+}
+
+static void prepare_mixed_precision() {
+    init_master_blob(&master_w0, l1_mw0, l1_mw0_diff, W0_SIZE);
+    init_master_blob(&master_b0, l1_mb0, l1_mb0_diff, B0_SIZE);
+    init_master_blob(&master_w1, l1_mw1, l1_mw1_diff, W1_SIZE);
+
+    // Master weights initialized once from the FP16 parameters
+    struct cast_16t32_args cast_args;
+    cast_args.source = l1_w0[MULTI];  cast_args.destination = l1_mw0;  cast_args.size = W0_SIZE;
+    pi_cl_team_fork(NUM_CORES, cast_fp16_tensor_to_fp32, &cast_args);
+    cast_args.source = l1_b0[MULTI];  cast_args.destination = l1_mb0;  cast_args.size = B0_SIZE;
+    pi_cl_team_fork(NUM_CORES, cast_fp16_tensor_to_fp32, &cast_args);
+    cast_args.source = l1_w1[MULTI];  cast_args.destination = l1_mw1;  cast_args.size = W1_SIZE;
+    pi_cl_team_fork(NUM_CORES, cast_fp16_tensor_to_fp32, &cast_args);
+
+    zero_tensor_fp32(l1_mw0_m, W0_SIZE);  zero_tensor_fp32(l1_mw0_v, W0_SIZE);
+    zero_tensor_fp32(l1_mb0_m, B0_SIZE);  zero_tensor_fp32(l1_mb0_v, B0_SIZE);
+    zero_tensor_fp32(l1_mw1_m, W1_SIZE);  zero_tensor_fp32(l1_mw1_v, W1_SIZE);
+
+    for (int l = 0; l < 2; l++) {
+        struct optim_args *sgd = &master_sgd_layers[l];
+        sgd->weights = l == 0 ? &master_w0 : &master_w1;
+        sgd->biases = l == 0 ? &master_b0 : NULL;
+        sgd->use_biases = l == 0;
+        sgd->learning_rate = Tlearning_rate;
+        sgd->momentum = Tmomentum;
+        sgd->nesterov = Tnesterov;
+        sgd->weight_decay = Tweight_decay;
+        sgd->decoupled_weight_decay = Tdecoupled_weight_decay;
+        sgd->velocity_weights = l == 0 ? l1_mw0_m : l1_mw1_m;
+        sgd->velocity_biases = l == 0 ? l1_mb0_m : NULL;
+
+        struct adam_args *adam = &master_adam_layers[l];
+        adam->weights = sgd->weights;
+        adam->biases = sgd->biases;
+        adam->use_biases = sgd->use_biases;
+        adam->m_weights = l == 0 ? l1_mw0_m : l1_mw1_m;
+        adam->v_weights = l == 0 ? l1_mw0_v : l1_mw1_v;
+        adam->m_biases = l == 0 ? l1_mb0_m : NULL;
+        adam->v_biases = l == 0 ? l1_mb0_v : NULL;
+        adam->learning_rate = Tlearning_rate;
+        adam->beta1 = Tbeta1;
+        adam->beta2 = Tbeta2;
+        adam->eps = Teps;
+        adam->weight_decay = Tweight_decay;
+        adam->step = 0;
+    }
+
+    master_multi_args.optimizer = Toptimizer;
+    master_multi_args.n_layers = 2;
+    master_multi_args.layers = master_sgd_layers;
+    master_multi_args.adam_layers = master_adam_layers;
+    master_multi_args.max_grad_norm = Tmax_grad_norm;
+    master_multi_args.partial_sums = partial_sums;
+
+    mp_params[0] = &layer0_wgt[MULTI];  mp_master[0] = &master_w0;
+    mp_params[1] = &layer0_bias[MULTI]; mp_master[1] = &master_b0;
+    mp_params[2] = &layer1_wgt[MULTI];  mp_master[2] = &master_w1;
+    mp_args.params = mp_params;
+    mp_args.master = mp_master;
+    mp_args.n_tensors = 3;
+    mp_args.optimizer = &master_multi_args;
+    mp_args.partial_sums = partial_sums;
+    mp_args.loss_scale = Tloss_scale;
+    mp_args.growth_factor = Tgrowth_factor;
+    mp_args.backoff_factor = Tbackoff_factor;
+    mp_args.growth_interval = Tgrowth_interval;
+    mp_args.good_steps = 0;
+    mp_args.skipped_steps = 0;
+    mp_args.found_inf = 0;
+}
+
+static void save_params() {
+    copy_tensor(prev_w0, l1_w0[MULTI], W0_SIZE);
+    copy_tensor(prev_b0, l1_b0[MULTI], B0_SIZE);
+    copy_tensor(prev_w1, l1_w1[MULTI], W1_SIZE);
+    copy_tensor_fp32(prev_mw0, l1_mw0, W0_SIZE);
+    copy_tensor_fp32(prev_mb0, l1_mb0, B0_SIZE);
+    copy_tensor_fp32(prev_mw1, l1_mw1, W1_SIZE);
+}
+
+#endif
+
+
+
+// Main function
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nLayers: %d x %d (with biases), %d x %d, steps = %d, max_grad_norm = %f\n", Thidden_size, Tin_size, Tout_size, Thidden_size, Tn_steps, Tmax_grad_norm);
+
+    prepare_path(SINGLE);
+    prepare_path(MULTI);
+
+#ifndef MIXED_PRECISION
+    prepare_optimizer(SINGLE);
+    prepare_optimizer(MULTI);
+
+    clip_blobs[0] = &layer0_wgt[SINGLE];
+    clip_blobs[1] = &layer0_bias[SINGLE];
+    clip_blobs[2] = &layer1_wgt[SINGLE];
+    clip_args.blobs = clip_blobs;
+    clip_args.n_blobs = 3;
+    clip_args.max_norm = Tmax_grad_norm;
+    clip_args.partial_sums = partial_sums;
+
+    multi_args.optimizer = Toptimizer;
+    multi_args.n_layers = 2;
+    multi_args.layers = sgd_layers[MULTI];
+    multi_args.adam_layers = adam_layers[MULTI];
+    multi_args.max_grad_norm = Tmax_grad_norm;
+    multi_args.partial_sums = partial_sums;
+
+    // Cycles are those of the multi-tensor step, cumulative over the steps
+    for (int s = 0; s < Tn_steps; s++) {
+        load_gradients(SINGLE, s);
+        load_gradients(MULTI, s);
+        next_step(SINGLE, s);
+        next_step(MULTI, s);
+
+        printf("\n----- OPTIMIZER STEP %d -----\n", s);
+        single_layer_step();
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp16, &multi_args);
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+
+#ifdef OPTIMIZER
+        if (Tmax_grad_norm > 0) {
+            check_norm("GRADIENT NORM (SINGLE LAYER)", clip_args.norm, GRAD_NORM[s]);
+            check_norm("GRADIENT NORM (MULTI-TENSOR)", multi_args.grad_norm, GRAD_NORM[s]);
+        }
+        check_params(SINGLE, s);
+        check_params(MULTI, s);
+
+        // Clipping rounds the gradients to FP16 in the single layer path only, stochastic rounding draws from the address of the tensors
+        if (Tmax_grad_norm == 0 && Trounding == FP16_ROUND_NEAREST) {
+            int mismatches = count_mismatches(l1_w0[SINGLE], l1_w0[MULTI], W0_SIZE)
+                           + count_mismatches(l1_b0[SINGLE], l1_b0[MULTI], B0_SIZE)
+                           + count_mismatches(l1_w1[SINGLE], l1_w1[MULTI], W1_SIZE);
+            printf("\nSINGLE LAYER VS MULTI-TENSOR CHECK: \n");
+            if (mismatches == 0) printf(">>>BIT-IDENTICAL!\n");
+            else printf(">>>NOT BIT-IDENTICAL! (%d elements differ)\n", mismatches);
+        }
+#endif
+    }
+
+#ifdef STOCHASTIC_ROUNDING
+    // Each update is a quarter of an ulp: it is only applied on average, over all the parameters
+    check_mean_update("MEAN UPDATE (SINGLE LAYER)", SINGLE, Tn_steps - 1);
+    check_mean_update("MEAN UPDATE (MULTI-TENSOR)", MULTI, Tn_steps - 1);
+#endif
+
+#else
+    prepare_mixed_precision();
+
+    for (int s = 0; s < Tn_steps; s++) {
+        load_gradients(MULTI, s);
+        if (s == Tinf_step) l1_w0_diff[MULTI][W0_SIZE / 2] = (fp16) INFINITY;
+        master_adam_layers[0].step = s + 1 - mp_args.skipped_steps;
+        master_adam_layers[1].step = s + 1 - mp_args.skipped_steps;
+        save_params();
+
+        printf("\n----- MIXED PRECISION STEP %d (LOSS SCALE %f) -----\n", s, mp_args.loss_scale);
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        pulp_mixed_precision_step_fp16(&mp_args);
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+
+        printf("\nLOSS SCALING CHECK: \n");
+        if (mp_args.found_inf == (s == Tinf_step) && mp_args.loss_scale == LOSS_SCALE_REF[s] && mp_args.skipped_steps == (int) SKIPPED_STEPS_REF[s])
+            printf(">>>TENSOR MATCHING!\n");
+        else
+            printf(">>>TENSOR NOT MATCHING!\n(Ideal: found_inf = %d, loss_scale = %f, skipped_steps = %d  vs  Actual: %d, %f, %d)\n",
+                   s == Tinf_step, LOSS_SCALE_REF[s], (int) SKIPPED_STEPS_REF[s], mp_args.found_inf, mp_args.loss_scale, mp_args.skipped_steps);
+
+        if (s == Tinf_step) {
+            // The update is skipped: FP16 parameters and master weights are left as they were
+            int mismatches = count_mismatches(l1_w0[MULTI], prev_w0, W0_SIZE)
+                           + count_mismatches(l1_b0[MULTI], prev_b0, B0_SIZE)
+                           + count_mismatches(l1_w1[MULTI], prev_w1, W1_SIZE);
+            printf("\nSKIPPED STEP CHECK: \n");
+            if (mismatches == 0 && verify_tensor(l1_mw0, prev_mw0, W0_SIZE, 0) == 0 && verify_tensor(l1_mb0, prev_mb0, B0_SIZE, 0) == 0
+                && verify_tensor(l1_mw1, prev_mw1, W1_SIZE, 0) == 0)
+                printf(">>>TENSOR MATCHING!\n");
+            else
+                printf(">>>TENSOR NOT MATCHING!\n");
+            continue;
+        }
+
+        if (Tmax_grad_norm > 0) check_norm("GRADIENT NORM", master_multi_args.grad_norm, GRAD_NORM[s]);
+        check_fp32("MASTER WEIGHTS 0", l1_mw0, WEIGHTS0_REF + s * W0_SIZE, W0_SIZE);
+        check_fp32("MASTER BIASES 0", l1_mb0, BIASES0_REF + s * B0_SIZE, B0_SIZE);
+        check_fp32("MASTER WEIGHTS 1", l1_mw1, WEIGHTS1_REF + s * W1_SIZE, W1_SIZE);
+
+        int mismatches = count_cast_mismatches(l1_w0[MULTI], l1_mw0, W0_SIZE)
+                       + count_cast_mismatches(l1_b0[MULTI], l1_mb0, B0_SIZE)
+                       + count_cast_mismatches(l1_w1[MULTI], l1_mw1, W1_SIZE);
+        printf("\nFP16 PARAMETERS CHECK: \n");
+        if (mismatches == 0) printf(">>>TENSOR MATCHING!\n");
+        else printf(">>>TENSOR NOT MATCHING! (%d elements differ from the cast of the master weights)\n", mismatches);
+    }
+#endif
+
+    return;
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "step-check.h"
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition (mean error relative to the mean magnitude of the update)
+#define ERROR_TOLERANCE 0.05
+// Tolerance of the FP32 master weights and of the gradient norm
+#define ERROR_TOLERANCE_FP32 0.0001
+// Tolerance of the mean update with stochastic rounding (relative)
+#define SR_TOLERANCE 0.2
+
+// Sizes of the tensors of the two layers
+#define W0_SIZE (Thidden_size * Tin_size)
+#define B0_SIZE (Thidden_size)
+#define W1_SIZE (Tout_size * Thidden_size)
+
+// Main function
+void net_step ();
@@ -0,0 +1,216 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+
+
+# Kernel of each optimizer of the test, with its Nesterov and decoupled weight decay flags
+OPTIMIZERS = {
+    "SGD": ("OPTIM_SGD", 0, 0),
+    "SGD_MOMENTUM": ("OPTIM_SGD_MOMENTUM", 0, 0),
+    "NESTEROV": ("OPTIM_SGD_MOMENTUM", 1, 1),
+    "ADAM": ("OPTIM_ADAM", 0, 0),
+    "ADAMW": ("OPTIM_ADAM", 0, 1),
+}
+
+MOMENTUM = 0.9
+BETA1 = 0.9
+BETA2 = 0.999
+EPS = 1e-8
+
+# Dynamic loss scaling of the MIXED_PRECISION step
+LOSS_SCALE = 1024.0
+GROWTH_FACTOR = 2.0
+BACKOFF_FACTOR = 0.5
+GROWTH_INTERVAL = 2
+
+
+def to_format(t, bf16_format):
+    # Inputs are rounded to the FP16 format of the kernels, the golden model then runs in FP32
+    return t.bfloat16().float() if bf16_format == 1 else t.half().float()
+
+
+def make_optimizer(optimizer, params, lr, momentum, weight_decay):
+    if optimizer == "SGD":
+        return torch.optim.SGD(params, lr=lr)
+    if optimizer == "SGD_MOMENTUM":
+        return torch.optim.SGD(params, lr=lr, momentum=momentum, weight_decay=weight_decay)
+    if optimizer == "NESTEROV":
+        # The decoupled weight decay is applied by hand before the step (torch.optim.SGD only has the L2 one)
+        return torch.optim.SGD(params, lr=lr, momentum=momentum, nesterov=True)
+    if optimizer == "ADAM":
+        return torch.optim.Adam(params, lr=lr, betas=(BETA1, BETA2), eps=EPS)
+    return torch.optim.AdamW(params, lr=lr, betas=(BETA1, BETA2), eps=EPS, weight_decay=weight_decay)
+
+
+def optimizer_step(optimizer, opt, params, grads, lr, weight_decay, max_grad_norm):
+    # Sets the gradients, clips them and updates the parameters, returns the norm of the gradients before clipping
+    for p, g in zip(params, grads):
+        p.grad = g.clone()
+    norm = torch.zeros(1)
+    if max_grad_norm > 0:
+        norm = torch.nn.utils.clip_grad_norm_(params, max_grad_norm).reshape(1)
+    if optimizer == "NESTEROV":
+        with torch.no_grad():
+            for p in params:
+                p.mul_(1 - lr * weight_decay)
+    opt.step()
+    return norm
+
+
+def write_array(f, name, t, size, dtype="fp16"):
+    f.write("PI_L2 " + dtype + " " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+def write_steps(f, name, ts, size, dtype="fp16"):
+    write_array(f, name, torch.cat([t.flatten() for t in ts], 0), "Tn_steps * " + size, dtype)
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("Optimizers Test")
+    parser.add_argument("--step", type=str, default="OPTIMIZER")
+    parser.add_argument("--optimizer", type=str, default="ADAM")
+    parser.add_argument("--rounding", type=str, default="NEAREST")
+    parser.add_argument("--n_steps", type=int, default=4)
+    parser.add_argument("--in_size", type=int, default=12)
+    parser.add_argument("--hidden_size", type=int, default=20)
+    parser.add_argument("--out_size", type=int, default=6)
+    parser.add_argument("--learning_rate", type=float, default=0.1)
+    parser.add_argument("--weight_decay", type=float, default=0.1)
+    parser.add_argument("--max_grad_norm", type=float, default=10.0)
+    parser.add_argument("--inf_step", type=int, default=2)
+    parser.add_argument("--bf16_format", type=int, default=1)  # if == 1, data format if bfloat16, if 0 is float16
+    args = parser.parse_args()
+
+    step = args.step
+    optimizer = args.optimizer
+    n_steps = args.n_steps
+    bf16_format = args.bf16_format
+    weight_decay = args.weight_decay if optimizer not in ("SGD", "ADAM") else 0.0
+    max_grad_norm = args.max_grad_norm
+    sizes = [(args.hidden_size, args.in_size), (args.hidden_size,), (args.out_size, args.hidden_size)]
+
+    if optimizer not in OPTIMIZERS:
+        raise ValueError("Unknown optimizer " + optimizer)
+    kernel, nesterov, decoupled = OPTIMIZERS[optimizer]
+
+    if step == "STOCHASTIC_ROUNDING":
+        # All the parameters start from 1 and the first update is a quarter of the ulp above 1, which rounding to nearest loses
+        ulp = 2.0 ** -7 if bf16_format == 1 else 2.0 ** -10
+        lr = ulp / 4
+        weight_decay = 0.0
+        max_grad_norm = 0.0
+    else:
+        lr = args.learning_rate
+    rounding = "FP16_ROUND_STOCHASTIC" if args.rounding == "STOCHASTIC" or step == "STOCHASTIC_ROUNDING" else "FP16_ROUND_NEAREST"
+
+    # The hyperparameters of the SGD kernels are FP16, those of Adam and of the FP32 master weights are not
+    fp16_hyper = kernel != "OPTIM_ADAM" and step != "MIXED_PRECISION"
+    if fp16_hyper:
+        lr = to_format(torch.tensor([lr]), bf16_format).item()
+        weight_decay = to_format(torch.tensor([weight_decay]), bf16_format).item()
+    momentum = to_format(torch.tensor([MOMENTUM]), bf16_format).item() if fp16_hyper else MOMENTUM
+
+    f = open("step-check.h", "w")
+    f.write("#define " + step + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tin_size " + str(args.in_size) + "\n")
+    f.write("#define Thidden_size " + str(args.hidden_size) + "\n")
+    f.write("#define Tout_size " + str(args.out_size) + "\n")
+    f.write("#define Tn_steps " + str(n_steps) + "\n")
+    f.write("#define Toptimizer " + kernel + "\n")
+    f.write("#define Trounding " + rounding + "\n")
+    f.write("#define Tlearning_rate " + str(lr) + "f\n")
+    f.write("#define Tmomentum " + str(momentum) + "f\n")
+    f.write("#define Tnesterov " + str(nesterov) + "\n")
+    f.write("#define Tweight_decay " + str(weight_decay) + "f\n")
+    f.write("#define Tdecoupled_weight_decay " + str(decoupled) + "\n")
+    f.write("#define Tbeta1 " + str(BETA1) + "f\n")
+    f.write("#define Tbeta2 " + str(BETA2) + "f\n")
+    f.write("#define Teps " + str(EPS) + "f\n")
+    f.write("#define Tmax_grad_norm " + str(max_grad_norm) + "f\n")
+    f.write("#define Tinf_step " + str(args.inf_step) + "\n")
+    f.write("#define Tloss_scale " + str(LOSS_SCALE) + "f\n")
+    f.write("#define Tgrowth_factor " + str(GROWTH_FACTOR) + "f\n")
+    f.write("#define Tbackoff_factor " + str(BACKOFF_FACTOR) + "f\n")
+    f.write("#define Tgrowth_interval " + str(GROWTH_INTERVAL) + "\n")
+    f.close()
+
+    # Two layers: the first with biases, the second without, so that the multi-tensor list skips a tensor
+    if step == "STOCHASTIC_ROUNDING":
+        init = [torch.ones(*s) for s in sizes]
+    else:
+        init = [to_format(0.1 * torch.randn(*s), bf16_format) for s in sizes]
+    params = [t.clone() for t in init]
+    opt = make_optimizer(optimizer, params, lr, momentum, weight_decay)
+
+    grads, refs, norms, loss_scales, skipped = [[], [], []], [[], [], []], [], [], []
+    loss_scale, good_steps, n_skipped = LOSS_SCALE, 0, 0
+    for s in range(n_steps):
+        if step == "STOCHASTIC_ROUNDING":
+            g = [-torch.ones(*sz) for sz in sizes]
+        else:
+            # Every other step has small gradients, which are not clipped
+            scale = 1.0 if s % 2 == 0 else 0.02
+            g = [to_format(scale * torch.randn(*sz), bf16_format) for sz in sizes]
+
+        if step == "MIXED_PRECISION":
+            # FP16 gradients of the scaled loss, the master weights see them unscaled
+            g = [to_format(t * loss_scale, bf16_format) for t in g]
+            if s == args.inf_step:
+                # An element of the gradients is set to inf by the test: the step is skipped and the scale backs off
+                loss_scale *= BACKOFF_FACTOR
+                good_steps = 0
+                n_skipped += 1
+                norms.append(torch.zeros(1))
+            else:
+                norms.append(optimizer_step(optimizer, opt, params, [t / loss_scale for t in g], lr, weight_decay, max_grad_norm))
+                good_steps += 1
+                if good_steps >= GROWTH_INTERVAL:
+                    loss_scale *= GROWTH_FACTOR
+                    good_steps = 0
+            loss_scales.append(torch.tensor([loss_scale]))
+            skipped.append(torch.tensor([float(n_skipped)]))
+        else:
+            norms.append(optimizer_step(optimizer, opt, params, g, lr, weight_decay, max_grad_norm))
+
+        for i, p in enumerate(params):
+            grads[i].append(g[i])
+            refs[i].append(p.detach().clone())
+
+    print("Weights after the last step:")
+    print(params[0])
+
+    f = open("optim-data.h", "w")
+    write_array(f, "WEIGHTS0", init[0], "Thidden_size * Tin_size")
+    write_array(f, "BIASES0", init[1], "Thidden_size")
+    write_array(f, "WEIGHTS1", init[2], "Tout_size * Thidden_size")
+    write_steps(f, "WEIGHTS0_GRAD", grads[0], "Thidden_size * Tin_size")
+    write_steps(f, "BIASES0_GRAD", grads[1], "Thidden_size")
+    write_steps(f, "WEIGHTS1_GRAD", grads[2], "Tout_size * Thidden_size")
+    write_steps(f, "WEIGHTS0_REF", refs[0], "Thidden_size * Tin_size", "float")
+    write_steps(f, "BIASES0_REF", refs[1], "Thidden_size", "float")
+    write_steps(f, "WEIGHTS1_REF", refs[2], "Tout_size * Thidden_size", "float")
+    write_steps(f, "GRAD_NORM", norms, "1", "float")
+    if step == "MIXED_PRECISION":
+        write_steps(f, "LOSS_SCALE_REF", loss_scales, "1", "float")
+        write_steps(f, "SKIPPED_STEPS_REF", skipped, "1", "float")
+    f.close()
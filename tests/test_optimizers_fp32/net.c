@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "optim-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// The same two layers are updated by the single layer optimizers (with pulp_clip_grad_norm_fp32 before them)
+// and by the multi-tensor step (with its max_grad_norm option), each on its own copy
+#define SINGLE 0
+#define MULTI 1
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+PI_L1 struct blob layer0_wgt[2], layer0_bias[2], layer1_wgt[2];
+PI_L1 struct optim_args sgd_layers[2][2];
+PI_L1 struct adam_args adam_layers[2][2];
+PI_L1 struct optim_multi_args multi_args;
+PI_L1 struct clip_grad_norm_args clip_args;
+PI_L1 struct blob * clip_blobs[3];
+PI_L1 float partial_sums[NUM_CORES];
+
+PI_L1 float l1_w0[2][W0_SIZE], l1_w0_diff[2][W0_SIZE];
+PI_L1 float l1_b0[2][B0_SIZE], l1_b0_diff[2][B0_SIZE];
+PI_L1 float l1_w1[2][W1_SIZE], l1_w1_diff[2][W1_SIZE];
+
+// Velocity (momentum SGD) or first moment (Adam), and second moment (Adam)
+PI_L1 float l1_w0_m[2][W0_SIZE], l1_w0_v[2][W0_SIZE];
+PI_L1 float l1_b0_m[2][B0_SIZE], l1_b0_v[2][B0_SIZE];
+PI_L1 float l1_w1_m[2][W1_SIZE], l1_w1_v[2][W1_SIZE];
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+static inline void check(char *name, float *tensor_out, float *tensor_ref, int size) {
+    printf("\n%s CHECK: \n", name);
+    if (verify_tensor(tensor_out, tensor_ref, size, ERROR_TOLERANCE) == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n");
+}
+
+// Number of elements whose bits differ
+static inline int count_mismatches(float *a, float *b, int size) {
+    int mismatches = 0;
+    for (int i = 0; i < size; i++)
+        if (*(unsigned int *) &a[i] != *(unsigned int *) &b[i]) mismatches++;
+    return mismatches;
+}
+
+static inline void copy_tensor(float *dst, float *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void zero_tensor(float *dst, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = 0.0f;
+}
+
+static void init_blob(struct blob *b, float *data, float *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+
+static void prepare_path(int p) {
+    init_blob(&layer0_wgt[p], l1_w0[p], l1_w0_diff[p], Thidden_size, Tin_size);
+    init_blob(&layer0_bias[p], l1_b0[p], l1_b0_diff[p], 1, Thidden_size);
+    init_blob(&layer1_wgt[p], l1_w1[p], l1_w1_diff[p], Tout_size, Thidden_size);
+
+    copy_tensor(l1_w0[p], WEIGHTS0, W0_SIZE);
+    copy_tensor(l1_b0[p], BIASES0, B0_SIZE);
+    copy_tensor(l1_w1[p], WEIGHTS1, W1_SIZE);
+    zero_tensor(l1_w0_m[p], W0_SIZE);  zero_tensor(l1_w0_v[p], W0_SIZE);
+    zero_tensor(l1_b0_m[p], B0_SIZE);  zero_tensor(l1_b0_v[p], B0_SIZE);
+    zero_tensor(l1_w1_m[p], W1_SIZE);  zero_tensor(l1_w1_v[p], W1_SIZE);
+
+    for (int l = 0; l < 2; l++) {
+        struct optim_args *sgd = &sgd_layers[p][l];
+        sgd->weights = l == 0 ? &layer0_wgt[p] : &layer1_wgt[p];
+        sgd->biases = l == 0 ? &layer0_bias[p] : NULL;
+        sgd->use_biases = l == 0;
+        sgd->learning_rate = Tlearning_rate;
+        sgd->momentum = Tmomentum;
+        sgd->nesterov = Tnesterov;
+        sgd->weight_decay = Tweight_decay;
+        sgd->decoupled_weight_decay = Tdecoupled_weight_decay;
+        sgd->velocity_weights = l == 0 ? l1_w0_m[p] : l1_w1_m[p];
+        sgd->velocity_biases = l == 0 ? l1_b0_m[p] : NULL;
+
+        struct adam_args *adam = &adam_layers[p][l];
+        adam->weights = sgd->weights;
+        adam->biases = sgd->biases;
+        adam->use_biases = sgd->use_biases;
+        adam->m_weights = l == 0 ? l1_w0_m[p] : l1_w1_m[p];
+        adam->v_weights = l == 0 ? l1_w0_v[p] : l1_w1_v[p];
+        adam->m_biases = l == 0 ? l1_b0_m[p] : NULL;
+        adam->v_biases = l == 0 ? l1_b0_v[p] : NULL;
+        adam->learning_rate = Tlearning_rate;
+        adam->beta1 = Tbeta1;
+        adam->beta2 = Tbeta2;
+        adam->eps = Teps;
+        adam->weight_decay = Tweight_decay;
+        adam->step = 0;
+    }
+}
+
+static void load_gradients(int p, int step) {
+    copy_tensor(l1_w0_diff[p], WEIGHTS0_GRAD + step * W0_SIZE, W0_SIZE);
+    copy_tensor(l1_b0_diff[p], BIASES0_GRAD + step * B0_SIZE, B0_SIZE);
+    copy_tensor(l1_w1_diff[p], WEIGHTS1_GRAD + step * W1_SIZE, W1_SIZE);
+}
+
+// One step of the single layer path: clipping of the gradients in place, then one fork per layer
+static void single_layer_step() {
+    if (Tmax_grad_norm > 0) {
+        pi_cl_team_fork(NUM_CORES, pulp_clip_grad_norm_fp32, &clip_args);
+    }
+    for (int l = 0; l < 2; l++) {
+        adam_layers[SINGLE][l].step++;
+        if (Toptimizer == OPTIM_ADAM)               pi_cl_team_fork(NUM_CORES, pulp_adam_fp32, &adam_layers[SINGLE][l]);
+        else if (Toptimizer == OPTIM_SGD_MOMENTUM)  pi_cl_team_fork(NUM_CORES, pulp_sgd_momentum_fp32, &sgd_layers[SINGLE][l]);
+        else                                        pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp32, &sgd_layers[SINGLE][l]);
+    }
+}
+
+
+
+// Main function
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nLayers: %d x %d (with biases), %d x %d, steps = %d, max_grad_norm = %f\n", Thidden_size, Tin_size, Tout_size, Thidden_size, Tn_steps, Tmax_grad_norm);
+
+    prepare_path(SINGLE);
+    prepare_path(MULTI);
+
+    clip_blobs[0] = &layer0_wgt[SINGLE];
+    clip_blobs[1] = &layer0_bias[SINGLE];
+    clip_blobs[2] = &layer1_wgt[SINGLE];
+    clip_args.blobs = clip_blobs;
+    clip_args.n_blobs = 3;
+    clip_args.max_norm = Tmax_grad_norm;
+    clip_args.partial_sums = partial_sums;
+
+    multi_args.optimizer = Toptimizer;
+    multi_args.n_layers = 2;
+    multi_args.layers = sgd_layers[MULTI];
+    multi_args.adam_layers = adam_layers[MULTI];
+    multi_args.max_grad_norm = Tmax_grad_norm;
+    multi_args.partial_sums = partial_sums;
+
+    // Cycles are those of the multi-tensor step, cumulative over the steps
+    for (int s = 0; s < Tn_steps; s++) {
+        load_gradients(SINGLE, s);
+        load_gradients(MULTI, s);
+
+        printf("\n----- OPTIMIZER STEP %d -----\n", s);
+        single_layer_step();
+
+        adam_layers[MULTI][0].step++;
+        adam_layers[MULTI][1].step++;
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp32, &multi_args);
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+
+        if (Tmax_grad_norm > 0) {
+            float norm_ref = GRAD_NORM[s];
+            float err_single = (clip_args.norm - norm_ref) / norm_ref;
+            float err_multi = (multi_args.grad_norm - norm_ref) / norm_ref;
+            printf("\nGRADIENT NORM CHECK: \n");
+            if (ABS(err_single) < ERROR_TOLERANCE && ABS(err_multi) < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\n");
+            else printf(">>>TENSOR NOT MATCHING!\n(Ideal = %f  vs  Single = %f, Multi = %f)\n", norm_ref, clip_args.norm, multi_args.grad_norm);
+        }
+
+        check("WEIGHTS 0", l1_w0[MULTI], WEIGHTS0_REF + s * W0_SIZE, W0_SIZE);
+        check("BIASES 0", l1_b0[MULTI], BIASES0_REF + s * B0_SIZE, B0_SIZE);
+        check("WEIGHTS 1", l1_w1[MULTI], WEIGHTS1_REF + s * W1_SIZE, W1_SIZE);
+
+        int mismatches = count_mismatches(l1_w0[SINGLE], l1_w0[MULTI], W0_SIZE)
+                       + count_mismatches(l1_b0[SINGLE], l1_b0[MULTI], B0_SIZE)
+                       + count_mismatches(l1_w1[SINGLE], l1_w1[MULTI], W1_SIZE);
+        printf("\nSINGLE LAYER VS MULTI-TENSOR CHECK: \n");
+        if (mismatches == 0) printf(">>>BIT-IDENTICAL!\n");
+        else printf(">>>NOT BIT-IDENTICAL! (%d elements differ)\n", mismatches);
+    }
+
+    return;
+}
@@ -0,0 +1,141 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import torch
+
+
+# Kernel of each optimizer of the test, with its Nesterov and decoupled weight decay flags
+OPTIMIZERS = {
+    "SGD": ("OPTIM_SGD", 0, 0),
+    "SGD_MOMENTUM": ("OPTIM_SGD_MOMENTUM", 0, 0),
+    "NESTEROV": ("OPTIM_SGD_MOMENTUM", 1, 1),
+    "ADAM": ("OPTIM_ADAM", 0, 0),
+    "ADAMW": ("OPTIM_ADAM", 0, 1),
+}
+
+MOMENTUM = 0.9
+BETA1 = 0.9
+BETA2 = 0.999
+EPS = 1e-8
+
+
+def make_optimizer(optimizer, params, lr, weight_decay):
+    if optimizer == "SGD":
+        return torch.optim.SGD(params, lr=lr)
+    if optimizer == "SGD_MOMENTUM":
+        return torch.optim.SGD(params, lr=lr, momentum=MOMENTUM, weight_decay=weight_decay)
+    if optimizer == "NESTEROV":
+        # The decoupled weight decay is applied by hand before the step (torch.optim.SGD only has the L2 one)
+        return torch.optim.SGD(params, lr=lr, momentum=MOMENTUM, nesterov=True)
+    if optimizer == "ADAM":
+        return torch.optim.Adam(params, lr=lr, betas=(BETA1, BETA2), eps=EPS)
+    return torch.optim.AdamW(params, lr=lr, betas=(BETA1, BETA2), eps=EPS, weight_decay=weight_decay)
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 float " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("Optimizers Test")
+    parser.add_argument("--optimizer", type=str, default="ADAM")
+    parser.add_argument("--n_steps", type=int, default=4)
+    parser.add_argument("--in_size", type=int, default=12)
+    parser.add_argument("--hidden_size", type=int, default=20)
+    parser.add_argument("--out_size", type=int, default=6)
+    parser.add_argument("--learning_rate", type=float, default=0.01)
+    parser.add_argument("--weight_decay", type=float, default=0.1)
+    parser.add_argument("--max_grad_norm", type=float, default=1.0)
+    args = parser.parse_args()
+
+    optimizer = args.optimizer
+    n_steps = args.n_steps
+    lr = args.learning_rate
+    weight_decay = args.weight_decay if optimizer not in ("SGD", "ADAM") else 0.0
+    max_grad_norm = args.max_grad_norm
+
+    if optimizer not in OPTIMIZERS:
+        raise ValueError("Unknown optimizer " + optimizer)
+    kernel, nesterov, decoupled = OPTIMIZERS[optimizer]
+
+    f = open("step-check.h", "w")
+    f.write("#define " + optimizer + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tin_size " + str(args.in_size) + "\n")
+    f.write("#define Thidden_size " + str(args.hidden_size) + "\n")
+    f.write("#define Tout_size " + str(args.out_size) + "\n")
+    f.write("#define Tn_steps " + str(n_steps) + "\n")
+    f.write("#define Toptimizer " + kernel + "\n")
+    f.write("#define Tlearning_rate " + str(lr) + "f\n")
+    f.write("#define Tmomentum " + str(MOMENTUM) + "f\n")
+    f.write("#define Tnesterov " + str(nesterov) + "\n")
+    f.write("#define Tweight_decay " + str(weight_decay) + "f\n")
+    f.write("#define Tdecoupled_weight_decay " + str(decoupled) + "\n")
+    f.write("#define Tbeta1 " + str(BETA1) + "f\n")
+    f.write("#define Tbeta2 " + str(BETA2) + "f\n")
+    f.write("#define Teps " + str(EPS) + "f\n")
+    f.write("#define Tmax_grad_norm " + str(max_grad_norm) + "f\n")
+    f.close()
+
+    # Two layers: the first with biases, the second without, so that the multi-tensor list skips a tensor
+    w0 = torch.randn(args.hidden_size, args.in_size)
+    b0 = torch.randn(args.hidden_size)
+    w1 = torch.randn(args.out_size, args.hidden_size)
+    params = [w0.clone(), b0.clone(), w1.clone()]
+    opt = make_optimizer(optimizer, params, lr, weight_decay)
+
+    grads, refs, norms = [[], [], []], [[], [], []], []
+    for step in range(n_steps):
+        # Every other step has small gradients, which are not clipped
+        scale = 1.0 if step % 2 == 0 else 0.02
+        g = [scale * torch.randn(p.shape) for p in params]
+        for i, p in enumerate(params):
+            p.grad = g[i].clone()
+            grads[i].append(g[i])
+
+        if max_grad_norm > 0:
+            norms.append(torch.nn.utils.clip_grad_norm_(params, max_grad_norm).reshape(1))
+        else:
+            norms.append(torch.zeros(1))
+        if optimizer == "NESTEROV":
+            with torch.no_grad():
+                for p in params:
+                    p.mul_(1 - lr * weight_decay)
+        opt.step()
+
+        for i, p in enumerate(params):
+            refs[i].append(p.detach().clone())
+
+    print("Weights after the last step:")
+    print(params[0])
+
+    f = open("optim-data.h", "w")
+    write_array(f, "WEIGHTS0", w0, "Thidden_size * Tin_size")
+    write_array(f, "BIASES0", b0, "Thidden_size")
+    write_array(f, "WEIGHTS1", w1, "Tout_size * Thidden_size")
+    write_array(f, "WEIGHTS0_GRAD", torch.cat([t.flatten() for t in grads[0]], 0), "Tn_steps * Thidden_size * Tin_size")
+    write_array(f, "BIASES0_GRAD", torch.cat(grads[1], 0), "Tn_steps * Thidden_size")
+    write_array(f, "WEIGHTS1_GRAD", torch.cat([t.flatten() for t in grads[2]], 0), "Tn_steps * Tout_size * Thidden_size")
+    write_array(f, "WEIGHTS0_REF", torch.cat([t.flatten() for t in refs[0]], 0), "Tn_steps * Thidden_size * Tin_size")
+    write_array(f, "BIASES0_REF", torch.cat(refs[1], 0), "Tn_steps * Thidden_size")
+    write_array(f, "WEIGHTS1_REF", torch.cat([t.flatten() for t in refs[2]], 0), "Tn_steps * Tout_size * Thidden_size")
+    write_array(f, "GRAD_NORM", torch.cat(norms, 0), "Tn_steps")
+    f.close()
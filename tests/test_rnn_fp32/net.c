@@ -43,7 +43,7 @@ PI_L2 int L2_memocc_bytes = 0;
 PI_L1 float l0_in[Tin_H_l1 * Tin_W_l1];
 PI_L1 float l0_ker_in[Tin_W_l1 * Tout_W_l1];
 PI_L1 float l0_ker_h[Tout_W_l1 * Tout_W_l1];
-PI_L1 float l0_state[Tout_W_l1 * Tin_H_l1];
+PI_L1 float l0_state[Tout_W_l1];
 PI_L1 float l0_out[Tout_W_l1 * Tin_H_l1];
 #endif
 
@@ -55,11 +55,11 @@ PI_L1 float l0_ker_in[Tin_W_l1 * Tout_W_l1];
 PI_L1 float l0_ker_h[Tout_W_l1 * Tout_W_l1];
 PI_L1 float l0_ker_in_diff[Tin_W_l1 * Tout_W_l1];
 PI_L1 float l0_ker_h_diff[Tout_W_l1 * Tout_W_l1];
-PI_L1 float l0_state[Tout_W_l1 * Tin_H_l1];
+PI_L1 float l0_state[Tout_W_l1];
 PI_L1 float l0_out[Tout_W_l1 * Tin_H_l1];
 PI_L1 float l0_out_diff[Tout_W_l1 * Tin_H_l1];
-// Inaccuracy, dimension should be sequence length (Tin_H_l1) times the longest between Tout_W_l1 and Tin_W_l1
-PI_L1 float l0_temp[Tin_H_l1 * Tout_W_l1];
+// Gradient of the hidden state flowing back through time (Tout_W_l1)
+PI_L1 float l0_temp[Tout_W_l1];
 #endif
 
 
@@ -68,7 +68,7 @@ static inline void tensor_init() {
     for (int i = 0; i < Tin_H_l1 * Tin_W_l1; i++) l0_in[i] = INPUT[i];
     for (int i = 0; i < Tin_W_l1 * Tout_W_l1; i++) l0_ker_in[i] = INPUT_WEIGHTS[i];
     for (int i = 0; i < Tout_W_l1 * Tout_W_l1; i++) l0_ker_h[i] = STATE_WEIGHTS[i];
-    for (int i = 0; i < Tout_W_l1 * Tin_H_l1; i++) l0_state[i] = STATE[i];
+    for (int i = 0; i < Tout_W_l1; i++) l0_state[i] = STATE[i];
     for (int i = 0; i < Tout_W_l1 * Tin_H_l1; i++) l0_out[i] = zero_init;
 }
 
@@ -92,8 +92,8 @@ static inline void connect_blobs() {
     layer0_wgt_h.C = Tout_C_l1;
 
     layer0_state.data = l0_state;
-    layer0_state.dim = Tout_W_l1 * Tin_H_l1;
-    layer0_state.H = Tin_H_l1;
+    layer0_state.dim = Tout_W_l1;
+    layer0_state.H = 1;
     layer0_state.W = Tout_W_l1;
     layer0_state.C = Tout_C_l1;
 
@@ -119,7 +119,7 @@ static inline void compute_memory_occupation() {
     // Kernel state
     L1_memocc_bytes += Tout_W_l1 * Tout_W_l1 * sizeof(float);
     //hidden states
-    L1_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
+    L1_memocc_bytes += Tout_W_l1 * sizeof(float);
     // Output
     L1_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
 
@@ -130,7 +130,7 @@ static inline void compute_memory_occupation() {
     // Weights state
     L2_memocc_bytes += Tout_W_l1 * Tout_W_l1 * sizeof(float);
     // States
-    L2_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
+    L2_memocc_bytes += Tout_W_l1 * sizeof(float);
     // Output
     L2_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
 }
@@ -150,12 +150,12 @@ static inline void tensor_init() {
     for (int i = 0; i < Tout_W_l1 * Tout_W_l1; i++) l0_ker_h[i] = STATE_WEIGHTS[i];
     for (int i = 0; i < Tout_W_l1 * Tout_W_l1; i++) l0_ker_h_diff[i] = zero_init;
 
-    for (int i = 0; i < Tout_W_l1 * Tin_H_l1; i++) l0_state[i] = STATE[i];
+    for (int i = 0; i < Tout_W_l1; i++) l0_state[i] = STATE[i];
 
     for (int i = 0; i < Tout_W_l1 * Tin_H_l1; i++) l0_out_diff[i] = OUTPUT_GRAD[i];
     for (int i = 0; i < Tout_W_l1 * Tin_H_l1; i++) l0_out[i] = OUTPUT[i];
 
-    for (int i = 0; i < Tin_H_l1 * Tout_W_l1; i++) l0_temp[i] = zero_init;
+    for (int i = 0; i < Tout_W_l1; i++) l0_temp[i] = zero_init;
 }
 
 static inline void connect_blobs() {
@@ -181,8 +181,8 @@ static inline void connect_blobs() {
     layer0_wgt_h.diff = l0_ker_h_diff;
 
     layer0_state.data = l0_state;
-    layer0_state.dim = Tout_W_l1 * Tin_H_l1;
-    layer0_state.H = Tin_H_l1;
+    layer0_state.dim = Tout_W_l1;
+    layer0_state.H = 1;
     layer0_state.W = Tout_W_l1;
     layer0_state.C = Tout_C_l1;
 
@@ -211,7 +211,7 @@ static inline void compute_memory_occupation() {
     // Kernel state grad
     L1_memocc_bytes += Tout_W_l1 * Tout_W_l1 * sizeof(float);
     //hidden states
-    L1_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
+    L1_memocc_bytes += Tout_W_l1 * sizeof(float);
     // Output grad
     L1_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
 
@@ -222,7 +222,7 @@ static inline void compute_memory_occupation() {
     // Weights state
     L2_memocc_bytes += Tout_W_l1 * Tout_W_l1 * sizeof(float);
     // States
-    L2_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
+    L2_memocc_bytes += Tout_W_l1 * sizeof(float);
     // Output
     L2_memocc_bytes += Tout_W_l1 * Tin_H_l1 * sizeof(float);
     // Output gradient
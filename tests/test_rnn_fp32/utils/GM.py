@@ -73,7 +73,8 @@ f.close()
 class myNet(nn.Module):
   def __init__(self, in_h, in_w, out_w):
     super().__init__()
-    self.rnn = nn.RNN(input_size=in_w, hidden_size=out_w, bias=False)
+    # Batch of one sequence of in_h timesteps
+    self.rnn = nn.RNN(input_size=in_w, hidden_size=out_w, bias=False, batch_first=True)
 
   def forward(self, x, state):
     return self.rnn(x, state)
@@ -161,9 +162,10 @@ for cin in range(ch_in):
     for wi in range(in_w):
       inp[cin, hi, wi] += (cin + hi - wi)*(cin + hi + wi) * 1/1e5
 
-state_0 = torch.div(torch.ones(ch_in, in_h, out_w), 1000)
+# Initial hidden state h_0 of the sequence
+state_0 = torch.div(torch.ones(ch_in, 1, out_w), 1000)
 for cin in range(ch_in):
-  for hi in range(in_h):
+  for hi in range(1):
     for wi in range(out_w):
       state_0[cin, hi, wi] += (cin + hi - wi)*(cin + hi + wi) * 1/1e5
 
@@ -254,8 +256,9 @@ net.zero_grad()
 net.rnn.weight_hh_l0.retain_grad()
 loss.backward()
 
-ih_wgt_grad = net.rnn.weight_ih_l0.grad 
-hh_wgt_grad = net.rnn.weight_hh_l0.grad
+# Transposed as the weights of the kernels (in x out)
+ih_wgt_grad = torch.transpose(net.rnn.weight_ih_l0.grad, 0, 1)
+hh_wgt_grad = torch.transpose(net.rnn.weight_hh_l0.grad, 0, 1)
 input_grad = inp.grad
 
 
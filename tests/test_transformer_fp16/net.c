@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "transformer-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+// Activations and scratch of the fused block (the FP32 statistics of the activations need a 4-byte alignment)
+PI_L1 fp16 l1_buff[ACT_SIZE + SCRATCH_SIZE] __attribute__((aligned(4)));
+PI_L1 fp16 l1_in[Tseq_len * Ttoken_size];
+PI_L1 fp16 l1_out[Tseq_len * Ttoken_size];
+
+PI_L1 struct Transformer_block_args_fp16 block_args;
+PI_L1 struct blob_fp16 layer_in, layer_out, ln1_w, ln1_b, w_qkv, b_qkv, w_out, b_out, ln2_w, ln2_b, w_fc1, b_fc1, w_fc2, b_fc2;
+
+#ifdef BACKWARD
+PI_L1 fp16 l1_in_diff[Tseq_len * Ttoken_size];
+PI_L1 fp16 l1_out_diff[Tseq_len * Ttoken_size];
+PI_L2 fp16 ln1_w_diff[Ttoken_size], ln1_b_diff[Ttoken_size], ln2_w_diff[Ttoken_size], ln2_b_diff[Ttoken_size];
+PI_L2 fp16 w_qkv_diff[3 * Tatt_dim * Ttoken_size], b_qkv_diff[3 * Tatt_dim];
+PI_L2 fp16 w_out_diff[Ttoken_size * Tatt_dim], b_out_diff[Ttoken_size];
+PI_L2 fp16 w_fc1_diff[Tmlp_dim * Ttoken_size], b_fc1_diff[Tmlp_dim];
+PI_L2 fp16 w_fc2_diff[Ttoken_size * Tmlp_dim], b_fc2_diff[Ttoken_size];
+#endif
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+// Mean error checker - relative to the mean magnitude of the reference
+static inline void check(char *name, fp16 *tensor_out, fp16 *tensor_ref, int size) {
+    float err = 0.0f;
+    float norm = 0.0f;
+
+    for (int i = 0; i < size; i++) {
+        float diff = (float) tensor_out[i] - (float) tensor_ref[i];
+        float ref = (float) tensor_ref[i];
+        err += diff > 0 ? diff : -diff;
+        norm += ref > 0 ? ref : -ref;
+    }
+    err = norm > 0 ? err / norm : err;
+
+    printf("\n%s CHECK: \n", name);
+    if (err < ERROR_TOLERANCE) printf(">>>TENSOR MATCHING!\nMEAN ERROR:%f\n", err);
+    else printf(">>>TENSOR NOT MATCHING!\nMEAN ERROR:%f\n", err);
+}
+
+static inline void copy_tensor(fp16 *dst, fp16 *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void set_blob(struct blob_fp16 *b, fp16 *data, fp16 *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+
+
+static void prepare_block() {
+    copy_tensor(l1_in, INPUT, Tseq_len * Ttoken_size);
+
+#ifdef BACKWARD
+    set_blob(&layer_in, l1_in, l1_in_diff, Tseq_len, Ttoken_size);
+    set_blob(&layer_out, l1_out, l1_out_diff, Tseq_len, Ttoken_size);
+    set_blob(&ln1_w, LN1_WEIGHT, ln1_w_diff, 1, Ttoken_size);
+    set_blob(&ln1_b, LN1_BIAS, ln1_b_diff, 1, Ttoken_size);
+    set_blob(&w_qkv, WEIGHTS_QKV, w_qkv_diff, 3 * Tatt_dim, Ttoken_size);
+    set_blob(&b_qkv, BIASES_QKV, b_qkv_diff, 1, 3 * Tatt_dim);
+    set_blob(&w_out, WEIGHTS_OUT, w_out_diff, Ttoken_size, Tatt_dim);
+    set_blob(&b_out, BIASES_OUT, b_out_diff, 1, Ttoken_size);
+    set_blob(&ln2_w, LN2_WEIGHT, ln2_w_diff, 1, Ttoken_size);
+    set_blob(&ln2_b, LN2_BIAS, ln2_b_diff, 1, Ttoken_size);
+    set_blob(&w_fc1, WEIGHTS_FC1, w_fc1_diff, Tmlp_dim, Ttoken_size);
+    set_blob(&b_fc1, BIASES_FC1, b_fc1_diff, 1, Tmlp_dim);
+    set_blob(&w_fc2, WEIGHTS_FC2, w_fc2_diff, Ttoken_size, Tmlp_dim);
+    set_blob(&b_fc2, BIASES_FC2, b_fc2_diff, 1, Ttoken_size);
+    copy_tensor(l1_out_diff, OUTPUT_GRAD, Tseq_len * Ttoken_size);
+#else
+    set_blob(&layer_in, l1_in, NULL, Tseq_len, Ttoken_size);
+    set_blob(&layer_out, l1_out, NULL, Tseq_len, Ttoken_size);
+    set_blob(&ln1_w, LN1_WEIGHT, NULL, 1, Ttoken_size);
+    set_blob(&ln1_b, LN1_BIAS, NULL, 1, Ttoken_size);
+    set_blob(&w_qkv, WEIGHTS_QKV, NULL, 3 * Tatt_dim, Ttoken_size);
+    set_blob(&b_qkv, BIASES_QKV, NULL, 1, 3 * Tatt_dim);
+    set_blob(&w_out, WEIGHTS_OUT, NULL, Ttoken_size, Tatt_dim);
+    set_blob(&b_out, BIASES_OUT, NULL, 1, Ttoken_size);
+    set_blob(&ln2_w, LN2_WEIGHT, NULL, 1, Ttoken_size);
+    set_blob(&ln2_b, LN2_BIAS, NULL, 1, Ttoken_size);
+    set_blob(&w_fc1, WEIGHTS_FC1, NULL, Tmlp_dim, Ttoken_size);
+    set_blob(&b_fc1, BIASES_FC1, NULL, 1, Tmlp_dim);
+    set_blob(&w_fc2, WEIGHTS_FC2, NULL, Ttoken_size, Tmlp_dim);
+    set_blob(&b_fc2, BIASES_FC2, NULL, 1, Ttoken_size);
+#endif
+
+    block_args.input = &layer_in;
+    block_args.output = &layer_out;
+    block_args.ln1_weight = &ln1_w;
+    block_args.ln1_bias = &ln1_b;
+    block_args.coeff_qkv = &w_qkv;
+    block_args.bias_qkv = &b_qkv;
+    block_args.coeff_out = &w_out;
+    block_args.bias_out = &b_out;
+    block_args.ln2_weight = &ln2_w;
+    block_args.ln2_bias = &ln2_b;
+    block_args.coeff_fc1 = &w_fc1;
+    block_args.bias_fc1 = &b_fc1;
+    block_args.coeff_fc2 = &w_fc2;
+    block_args.bias_fc2 = &b_fc2;
+    block_args.n_heads = Tn_heads;
+    block_args.eps = Teps;
+    block_args.mask_type = Tmask_type;
+    block_args.mask_window = Tmask_window;
+    block_args.mask_block = Tmask_block;
+    block_args.mask_layout = MASK_LAYOUT;
+
+    pulp_transformer_block_fp16_plan(&block_args);
+    block_args.activations = l1_buff;
+    block_args.scratch = l1_buff + ACT_SIZE;
+
+    printf("\nSaved activations: %d elements, planned scratch: %d elements (sum of the intermediates: %d)\n",
+           block_args.act_size, block_args.scratch_size, SCRATCH_FW + SCRATCH_BW);
+    if (block_args.act_size > ACT_SIZE || block_args.scratch_size > SCRATCH_SIZE)
+        printf("\nERROR: the plan does not fit in l1_buff!\n");
+}
+
+
+// ~~~~~~~~~~ MAIN FUNCTION ~~~~~~~~~~
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nL = %d, E = %d, F = %d, n_heads = %d, Hm = %d, mask type = %d\n", Tseq_len, Ttoken_size, Tatt_dim, Tn_heads, Tmlp_dim, Tmask_type);
+
+    prepare_block();
+
+#ifdef FORWARD
+    printf("\n----- FUSED TRANSFORMER BLOCK FORWARD -----\n");
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_transformer_block_fp16_fw_cl(&block_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("BLOCK OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+#endif
+
+#ifdef BACKWARD
+    printf("\n----- FUSED TRANSFORMER BLOCK BACKWARD -----\n");
+    pulp_transformer_block_fp16_fw_cl(&block_args);
+    check("BLOCK OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_transformer_block_fp16_bw_cl(&block_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("INPUT GRADIENT", l1_in_diff, INPUT_GRAD, Tseq_len * Ttoken_size);
+    check("LN1 WEIGHT GRADIENT", ln1_w_diff, LN1_WEIGHT_GRAD, Ttoken_size);
+    check("LN1 BIAS GRADIENT", ln1_b_diff, LN1_BIAS_GRAD, Ttoken_size);
+    check("WQKV GRADIENT", w_qkv_diff, WEIGHTS_QKV_GRAD, 3 * Tatt_dim * Ttoken_size);
+    check("BQKV GRADIENT", b_qkv_diff, BIASES_QKV_GRAD, 3 * Tatt_dim);
+    check("WOUT GRADIENT", w_out_diff, WEIGHTS_OUT_GRAD, Ttoken_size * Tatt_dim);
+    check("BOUT GRADIENT", b_out_diff, BIASES_OUT_GRAD, Ttoken_size);
+    check("LN2 WEIGHT GRADIENT", ln2_w_diff, LN2_WEIGHT_GRAD, Ttoken_size);
+    check("LN2 BIAS GRADIENT", ln2_b_diff, LN2_BIAS_GRAD, Ttoken_size);
+    check("W1 GRADIENT", w_fc1_diff, WEIGHTS_FC1_GRAD, Tmlp_dim * Ttoken_size);
+    check("B1 GRADIENT", b_fc1_diff, BIASES_FC1_GRAD, Tmlp_dim);
+    check("W2 GRADIENT", w_fc2_diff, WEIGHTS_FC2_GRAD, Ttoken_size * Tmlp_dim);
+    check("B2 GRADIENT", b_fc2_diff, BIASES_FC2_GRAD, Ttoken_size);
+#endif
+
+    return;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "step-check.h"
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition (mean error relative to the mean magnitude of the reference)
+#define ERROR_TOLERANCE 0.05
+
+// Saved activations of the block in FP16 elements (act_size of pulp_transformer_block_fp16_plan), the FP32 statistics taking two each
+#define ACT_SIZE (2 * (4 * Tseq_len + Tn_heads * Tseq_len) + 4 * Tatt_dim * Tseq_len + Tseq_len * Ttoken_size + Tseq_len * Tmlp_dim)
+
+// Bound of scratch_size: the planner never stacks a buffer higher than the sum of the FW (or BW) intermediates
+#define SCRATCH_FW (2 * Tseq_len * Ttoken_size + (4 + NUM_CORES) * Tseq_len + Tseq_len * Tmlp_dim)
+#define SCRATCH_BW (2 * Tseq_len * Tmlp_dim + 4 * Tseq_len * Ttoken_size + 4 * Tatt_dim * Tseq_len + 2 * Tseq_len)
+#define SCRATCH_SIZE (SCRATCH_FW > SCRATCH_BW ? SCRATCH_FW : SCRATCH_BW)
+
+// Main function
+void net_step ();
@@ -0,0 +1,192 @@
+"""
+Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import argparse
+
+import numpy as np
+import torch
+import torch.nn.functional as F
+
+
+MASK_TYPES = {
+    "NONE": "MHSA_MASK_NONE",
+    "CAUSAL": "MHSA_MASK_CAUSAL",
+    "SLIDING_WINDOW": "MHSA_MASK_SLIDING_WINDOW",
+    "BLOCK_SPARSE": "MHSA_MASK_BLOCK_SPARSE",
+}
+
+EPS = 1e-5
+
+
+def to_format(t, bf16_format):
+    # Inputs are rounded to the FP16 format of the kernels, the golden model then runs in FP32
+    return t.bfloat16().float() if bf16_format == 1 else t.half().float()
+
+
+def q_rsqrt(x):
+    # Fast inverse square root of the kernels, so that the golden model uses the same 1 / sqrt(H)
+    y = np.asarray((x,), dtype=np.float32)
+    x2 = y * 0.5
+    i = y.view(np.int32)
+    i = 0x5F3759DF - np.right_shift(i, 1)
+    y = i.view(np.float32)
+    y = y * (1.5 - (x2 * y * y))
+    return float(y[0])
+
+
+def make_layout(seq_len, block):
+    # Random block layout, with the diagonal blocks kept so that every query sees at least one key
+    n_blocks = (seq_len + block - 1) // block
+    layout = torch.rand(n_blocks, n_blocks) > 0.5
+    for i in range(n_blocks):
+        layout[i, i] = True
+    return layout
+
+
+def make_mask(mask, seq_len, window, block, layout):
+    # Boolean L x L mask, True if query r attends key c (same convention as mhsa_mask_visible)
+    r = torch.arange(seq_len)[:, None]
+    c = torch.arange(seq_len)[None, :]
+    if mask == "CAUSAL":
+        return c <= r
+    if mask == "SLIDING_WINDOW":
+        return (c <= r) & (c > r - window)
+    if mask == "BLOCK_SPARSE":
+        return layout[r // block, c // block]
+    return torch.ones(seq_len, seq_len, dtype=torch.bool)
+
+
+def encoder_block(x, p, n_heads, mask, attn_mask):
+    # Pre-norm encoder block (ViT style), weights stored out_features x in_features
+    seq_len = x.shape[0]
+    att_dim = p["wqkv"].shape[0] // 3
+    head_dim = att_dim // n_heads
+
+    h1 = F.layer_norm(x, (x.shape[1],), p["ln1_w"], p["ln1_b"], EPS)
+    qkv = h1 @ p["wqkv"].t() + p["bqkv"]
+    q = qkv[:, 0:att_dim].reshape(seq_len, n_heads, head_dim).transpose(0, 1)
+    k = qkv[:, att_dim:2 * att_dim].reshape(seq_len, n_heads, head_dim).transpose(0, 1)
+    v = qkv[:, 2 * att_dim:3 * att_dim].reshape(seq_len, n_heads, head_dim).transpose(0, 1)
+    scale = q_rsqrt(head_dim)
+    if mask == "NONE":
+        att = F.scaled_dot_product_attention(q, k, v, scale=scale)
+    else:
+        att = F.scaled_dot_product_attention(q, k, v, attn_mask=attn_mask, scale=scale)
+    att = att.transpose(0, 1).reshape(seq_len, att_dim)
+    x1 = x + att @ p["wo"].t() + p["bo"]
+
+    h2 = F.layer_norm(x1, (x1.shape[1],), p["ln2_w"], p["ln2_b"], EPS)
+    g = F.gelu(h2 @ p["w1"].t() + p["b1"], approximate="tanh")
+    return x1 + g @ p["w2"].t() + p["b2"]
+
+
+def write_array(f, name, t, size):
+    f.write("PI_L2 fp16 " + name + "[" + size + "] = {" + "f, ".join(map(str, t.flatten().tolist())) + "f};\n")
+
+
+if __name__ == "__main__":
+    # Set the seed for reproducibility
+    torch.manual_seed(0)
+    torch.set_printoptions(precision=10, sci_mode=False)
+
+    parser = argparse.ArgumentParser("Transformer Block Test")
+    parser.add_argument("--step", type=str, default="FORWARD")
+    parser.add_argument("--seq_len", type=int, default=16)
+    parser.add_argument("--token_size", type=int, default=32)
+    parser.add_argument("--head_dim", type=int, default=8)
+    parser.add_argument("--n_heads", type=int, default=4)
+    parser.add_argument("--mlp_dim", type=int, default=64)
+    parser.add_argument("--mask", type=str, default="NONE")
+    parser.add_argument("--mask_window", type=int, default=5)
+    parser.add_argument("--mask_block", type=int, default=4)
+    parser.add_argument("--bf16_format", type=int, default=1)  # if == 1, data format if bfloat16, if 0 is float16
+    args = parser.parse_args()
+
+    step = args.step
+    seq_len = args.seq_len
+    token_size = args.token_size
+    n_heads = args.n_heads
+    att_dim = n_heads * args.head_dim
+    mlp_dim = args.mlp_dim
+    mask = args.mask
+    bf16_format = args.bf16_format
+    n_blocks = (seq_len + args.mask_block - 1) // args.mask_block
+
+    if mask not in MASK_TYPES:
+        raise ValueError("Unknown mask " + mask)
+
+    f = open("step-check.h", "w")
+    f.write("#define " + step + "\n")
+    f.close()
+
+    f = open("init-defines.h", "w")
+    f.write("#define Tseq_len " + str(seq_len) + "\n")
+    f.write("#define Ttoken_size " + str(token_size) + "\n")
+    f.write("#define Thead_dim " + str(args.head_dim) + "\n")
+    f.write("#define Tn_heads " + str(n_heads) + "\n")
+    f.write("#define Tatt_dim " + str(att_dim) + "\n")
+    f.write("#define Tmlp_dim " + str(mlp_dim) + "\n")
+    f.write("#define Teps " + str(EPS) + "f\n")
+    f.write("#define Tmask_type " + MASK_TYPES[mask] + "\n")
+    f.write("#define Tmask_window " + str(args.mask_window) + "\n")
+    f.write("#define Tmask_block " + str(args.mask_block) + "\n")
+    f.write("#define Tmask_blocks " + str(n_blocks) + "\n")
+    f.close()
+
+    layout = make_layout(seq_len, args.mask_block)
+    attn_mask = make_mask(mask, seq_len, args.mask_window, args.mask_block, layout)
+
+    # Parameters of the block, with the input projections fused as Wq | Wk | Wv
+    x = to_format(torch.randn(seq_len, token_size), bf16_format)
+    x.requires_grad = True
+    p = {
+        "ln1_w": 1.0 + 0.1 * torch.randn(token_size), "ln1_b": 0.1 * torch.randn(token_size),
+        "wqkv": 0.2 * torch.randn(3 * att_dim, token_size), "bqkv": 0.1 * torch.randn(3 * att_dim),
+        "wo": 0.2 * torch.randn(token_size, att_dim), "bo": 0.1 * torch.randn(token_size),
+        "ln2_w": 1.0 + 0.1 * torch.randn(token_size), "ln2_b": 0.1 * torch.randn(token_size),
+        "w1": 0.2 * torch.randn(mlp_dim, token_size), "b1": 0.1 * torch.randn(mlp_dim),
+        "w2": 0.2 * torch.randn(token_size, mlp_dim), "b2": 0.1 * torch.randn(token_size),
+    }
+    for key in p:
+        p[key] = to_format(p[key], bf16_format)
+        p[key].requires_grad_()
+
+    out = encoder_block(x, p, n_heads, mask, attn_mask)
+    out_grad = to_format(torch.randn(seq_len, token_size), bf16_format)
+    out.backward(out_grad)
+
+    print("Block output:")
+    print(out)
+
+    sizes = {
+        "ln1_w": ("LN1_WEIGHT", "Ttoken_size"), "ln1_b": ("LN1_BIAS", "Ttoken_size"),
+        "wqkv": ("WEIGHTS_QKV", "3 * Tatt_dim * Ttoken_size"), "bqkv": ("BIASES_QKV", "3 * Tatt_dim"),
+        "wo": ("WEIGHTS_OUT", "Ttoken_size * Tatt_dim"), "bo": ("BIASES_OUT", "Ttoken_size"),
+        "ln2_w": ("LN2_WEIGHT", "Ttoken_size"), "ln2_b": ("LN2_BIAS", "Ttoken_size"),
+        "w1": ("WEIGHTS_FC1", "Tmlp_dim * Ttoken_size"), "b1": ("BIASES_FC1", "Tmlp_dim"),
+        "w2": ("WEIGHTS_FC2", "Ttoken_size * Tmlp_dim"), "b2": ("BIASES_FC2", "Ttoken_size"),
+    }
+
+    f = open("transformer-data.h", "w")
+    f.write("PI_L1 unsigned char MASK_LAYOUT[Tmask_blocks * Tmask_blocks] = {"
+            + ", ".join(str(int(b)) for b in layout.flatten().tolist()) + "};\n")
+    write_array(f, "INPUT", x.detach(), "Tseq_len * Ttoken_size")
+    for key, (name, size) in sizes.items():
+        write_array(f, name, p[key].detach(), size)
+    write_array(f, "OUTPUT", out.detach(), "Tseq_len * Ttoken_size")
+    if step == "BACKWARD":
+        write_array(f, "OUTPUT_GRAD", out_grad, "Tseq_len * Ttoken_size")
+        write_array(f, "INPUT_GRAD", x.grad, "Tseq_len * Ttoken_size")
+        for key, (name, size) in sizes.items():
+            write_array(f, name + "_GRAD", p[key].grad, size)
+    f.close()
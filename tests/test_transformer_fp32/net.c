@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Required to be first library to be included!
+#include "pulp_train.h"
+
+#include "init-defines.h"
+#include "transformer-data.h"
+#include "net.h"
+#include "stats.h"
+#include "step-check.h"
+
+
+// ~~~~~~~~~~ VARIABLE DEFINITION ~~~~~~~~~~
+// Activations and scratch of the fused block, then the intermediates of the ViT layers (FORWARD)
+#if defined(FORWARD) && (VIT_SIZE > ACT_SIZE + SCRATCH_SIZE)
+PI_L1 float l1_buff[VIT_SIZE];
+#else
+PI_L1 float l1_buff[ACT_SIZE + SCRATCH_SIZE];
+#endif
+PI_L1 float l1_in[Tseq_len * Ttoken_size];
+PI_L1 float l1_out[Tseq_len * Ttoken_size];
+
+PI_L1 struct Transformer_block_args block_args;
+PI_L1 struct blob layer_in, layer_out, ln1_w, ln1_b, w_qkv, b_qkv, w_out, b_out, ln2_w, ln2_b, w_fc1, b_fc1, w_fc2, b_fc2;
+
+#ifdef BACKWARD
+PI_L1 float l1_in_diff[Tseq_len * Ttoken_size];
+PI_L1 float l1_out_diff[Tseq_len * Ttoken_size];
+PI_L2 float ln1_w_diff[Ttoken_size], ln1_b_diff[Ttoken_size], ln2_w_diff[Ttoken_size], ln2_b_diff[Ttoken_size];
+PI_L2 float w_qkv_diff[3 * Tatt_dim * Ttoken_size], b_qkv_diff[3 * Tatt_dim];
+PI_L2 float w_out_diff[Ttoken_size * Tatt_dim], b_out_diff[Ttoken_size];
+PI_L2 float w_fc1_diff[Tmlp_dim * Ttoken_size], b_fc1_diff[Tmlp_dim];
+PI_L2 float w_fc2_diff[Ttoken_size * Tmlp_dim], b_fc2_diff[Ttoken_size];
+#endif
+
+
+// ~~~~~~~~~~ UTILITY FUNCTIONS ~~~~~~~~~~
+static inline void check(char *name, float *tensor_out, float *tensor_ref, int size, float tolerance) {
+    printf("\n%s CHECK: \n", name);
+    if (verify_tensor(tensor_out, tensor_ref, size, tolerance) == 0) printf(">>>TENSOR MATCHING!\n");
+    else printf(">>>TENSOR NOT MATCHING!\n");
+}
+
+static inline void copy_tensor(float *dst, float *src, int size) {
+    for (int i = 0; i < size; i++)
+        dst[i] = src[i];
+}
+
+static inline void set_blob(struct blob *b, float *data, float *diff, int H, int W) {
+    b->data = data;
+    b->diff = diff;
+    b->H = H;
+    b->W = W;
+    b->C = 1;
+    b->dim = H * W;
+}
+
+
+static void prepare_block() {
+    copy_tensor(l1_in, INPUT, Tseq_len * Ttoken_size);
+
+#ifdef BACKWARD
+    set_blob(&layer_in, l1_in, l1_in_diff, Tseq_len, Ttoken_size);
+    set_blob(&layer_out, l1_out, l1_out_diff, Tseq_len, Ttoken_size);
+    set_blob(&ln1_w, LN1_WEIGHT, ln1_w_diff, 1, Ttoken_size);
+    set_blob(&ln1_b, LN1_BIAS, ln1_b_diff, 1, Ttoken_size);
+    set_blob(&w_qkv, WEIGHTS_QKV, w_qkv_diff, 3 * Tatt_dim, Ttoken_size);
+    set_blob(&b_qkv, BIASES_QKV, b_qkv_diff, 1, 3 * Tatt_dim);
+    set_blob(&w_out, WEIGHTS_OUT, w_out_diff, Ttoken_size, Tatt_dim);
+    set_blob(&b_out, BIASES_OUT, b_out_diff, 1, Ttoken_size);
+    set_blob(&ln2_w, LN2_WEIGHT, ln2_w_diff, 1, Ttoken_size);
+    set_blob(&ln2_b, LN2_BIAS, ln2_b_diff, 1, Ttoken_size);
+    set_blob(&w_fc1, WEIGHTS_FC1, w_fc1_diff, Tmlp_dim, Ttoken_size);
+    set_blob(&b_fc1, BIASES_FC1, b_fc1_diff, 1, Tmlp_dim);
+    set_blob(&w_fc2, WEIGHTS_FC2, w_fc2_diff, Ttoken_size, Tmlp_dim);
+    set_blob(&b_fc2, BIASES_FC2, b_fc2_diff, 1, Ttoken_size);
+    copy_tensor(l1_out_diff, OUTPUT_GRAD, Tseq_len * Ttoken_size);
+#else
+    set_blob(&layer_in, l1_in, NULL, Tseq_len, Ttoken_size);
+    set_blob(&layer_out, l1_out, NULL, Tseq_len, Ttoken_size);
+    set_blob(&ln1_w, LN1_WEIGHT, NULL, 1, Ttoken_size);
+    set_blob(&ln1_b, LN1_BIAS, NULL, 1, Ttoken_size);
+    set_blob(&w_qkv, WEIGHTS_QKV, NULL, 3 * Tatt_dim, Ttoken_size);
+    set_blob(&b_qkv, BIASES_QKV, NULL, 1, 3 * Tatt_dim);
+    set_blob(&w_out, WEIGHTS_OUT, NULL, Ttoken_size, Tatt_dim);
+    set_blob(&b_out, BIASES_OUT, NULL, 1, Ttoken_size);
+    set_blob(&ln2_w, LN2_WEIGHT, NULL, 1, Ttoken_size);
+    set_blob(&ln2_b, LN2_BIAS, NULL, 1, Ttoken_size);
+    set_blob(&w_fc1, WEIGHTS_FC1, NULL, Tmlp_dim, Ttoken_size);
+    set_blob(&b_fc1, BIASES_FC1, NULL, 1, Tmlp_dim);
+    set_blob(&w_fc2, WEIGHTS_FC2, NULL, Ttoken_size, Tmlp_dim);
+    set_blob(&b_fc2, BIASES_FC2, NULL, 1, Ttoken_size);
+#endif
+
+    block_args.input = &layer_in;
+    block_args.output = &layer_out;
+    block_args.ln1_weight = &ln1_w;
+    block_args.ln1_bias = &ln1_b;
+    block_args.coeff_qkv = &w_qkv;
+    block_args.bias_qkv = &b_qkv;
+    block_args.coeff_out = &w_out;
+    block_args.bias_out = &b_out;
+    block_args.ln2_weight = &ln2_w;
+    block_args.ln2_bias = &ln2_b;
+    block_args.coeff_fc1 = &w_fc1;
+    block_args.bias_fc1 = &b_fc1;
+    block_args.coeff_fc2 = &w_fc2;
+    block_args.bias_fc2 = &b_fc2;
+    block_args.n_heads = Tn_heads;
+    block_args.eps = Teps;
+    block_args.mask_type = Tmask_type;
+    block_args.mask_window = Tmask_window;
+    block_args.mask_block = Tmask_block;
+    block_args.mask_layout = MASK_LAYOUT;
+
+    pulp_transformer_block_fp32_plan(&block_args);
+    block_args.activations = l1_buff;
+    block_args.scratch = l1_buff + ACT_SIZE;
+
+    printf("\nSaved activations: %d floats, planned scratch: %d floats (sum of the intermediates: %d)\n",
+           block_args.act_size, block_args.scratch_size, SCRATCH_FW + SCRATCH_BW);
+    if (block_args.act_size > ACT_SIZE || block_args.scratch_size > SCRATCH_SIZE)
+        printf("\nERROR: the plan does not fit in l1_buff!\n");
+}
+
+
+#ifdef FORWARD
+// Linear layer of the ViT network (out = in * W^T + bias), mm_manager adds the bias
+static void vit_linear(float *in, float *weight, float *bias, float *out, int N, int K, int M) {
+    struct matMul_args mm_args;
+    mm_args.A = in;
+    mm_args.B = weight;
+    mm_args.C = out;
+    mm_args.N = N;
+    mm_args.K = K;
+    mm_args.M = M;
+    mm_args.trans_B = 1;
+    mm_args.bias = bias;
+    mm_args.USE_BIASES = 1;
+    mm_args.bias_dim = M;
+    mm_args.bias_transposed = 0;
+
+    struct mm_manager_args man_args;
+    man_args.mm_args = &mm_args;
+    man_args.layer_type = LAYER_LINEAR;
+    man_args.step_type = STEP_FW;
+    man_args.matmul_type = MATMUL_TYPE;
+    pi_cl_team_fork(NUM_CORES, pulp_linear_fp32_fw_cl_kernel, &man_args);
+}
+
+static void vit_matmul(float *A, float *B, float *C, int N, int K, int M, int trans_B) {
+    struct matMul_args mm_args;
+    mm_args.A = A;
+    mm_args.B = B;
+    mm_args.C = C;
+    mm_args.N = N;
+    mm_args.K = K;
+    mm_args.M = M;
+    mm_args.trans_B = trans_B;
+    mm_args.USE_BIASES = 0;
+
+    struct mm_manager_args man_args;
+    man_args.mm_args = &mm_args;
+    man_args.layer_type = LAYER_LINEAR;
+    man_args.step_type = STEP_FW;
+    man_args.matmul_type = MATMUL_TYPE;
+    pi_cl_team_fork(NUM_CORES, mm_manager, &man_args);
+}
+
+static void vit_transpose(float *in, float *out, int H, int W) {
+    int dims[2] = {H, W};
+    int tr_axes[2] = {1, 0};
+    struct transp_args tr_args;
+    tr_args.in_matrix = in;
+    tr_args.out_matrix = out;
+    tr_args.dim = dims;
+    tr_args.transposed_axes = tr_axes;
+    tr_args.n_dim = 2;
+    pi_cl_team_fork(NUM_CORES, transpose, &tr_args);
+}
+
+static void vit_layernorm(float *in, float *weight, float *bias, float *out) {
+    float eps[1] = {Teps};
+    struct LayerNorm_args_fp32 ln_args;
+    ln_args.x = in;
+    ln_args.weight = weight;
+    ln_args.bias = bias;
+    ln_args.output = out;
+    ln_args.eps = eps;
+    ln_args.size = Tseq_len * Ttoken_size;
+    ln_args.step_size = Ttoken_size;
+    pi_cl_team_fork(NUM_CORES, pulp_layerNorm_fp32_fw_cl, &ln_args);
+}
+
+static void vit_residual(float *a, float *b, float *out) {
+    int dims[1] = {Tseq_len * Ttoken_size};
+    struct array_broadcast_sum_fp32_args sum_args;
+    sum_args.op_1 = a;
+    sum_args.op_2 = b;
+    sum_args.dest = out;
+    sum_args.op_1_dims = dims;
+    sum_args.op_2_dims = dims;
+    sum_args.op_1_dims_len = 1;
+    sum_args.op_2_dims_len = 1;
+    pi_cl_team_fork(NUM_CORES, array_broadcast_sum_fp32, &sum_args);
+}
+
+// Same block with the layers of the ViT network (test_vit_fp32): one kernel per layer, transposed copies of
+// the heads and unfused attention. The intermediates reuse l1_buff.
+static void vit_block_forward(float *x, float *y) {
+    const int L = Tseq_len;
+    const int E = Ttoken_size;
+    const int F = Tatt_dim;
+    const int H = Thead_dim;
+
+    float *h = l1_buff;
+    float *qkv = h + L * E;
+    float *qkv_t = qkv + 3 * F * L;
+    float *q_head = qkv_t + 3 * F * L;
+    float *scores = q_head + H * L;
+    float *maxes = scores + L * L;
+    float *sums = maxes + L;
+    float *att_t = sums + L;
+    float *att = att_t + F * L;
+    float *proj = att + F * L;
+    float *x1 = proj + L * E;
+    float *u = x1 + L * E;
+    float *g = u + L * Tmlp_dim;
+
+    //  Attention
+    vit_layernorm(x, LN1_WEIGHT, LN1_BIAS, h);
+    vit_linear(h, WEIGHTS_QKV, BIASES_QKV, qkv, L, E, 3 * F);
+    vit_transpose(qkv, qkv_t, L, 3 * F);
+
+    struct scalar_mul_args scale_args;
+    scale_args.input = scores;
+    scale_args.scalar = q_rsqrt((float) H);
+    scale_args.dim = L * L;
+
+    struct softmax_args sm_args;
+    sm_args.input_data = scores;
+    sm_args.output_data = scores;
+    sm_args.H = L;
+    sm_args.W = L;
+    sm_args.maxes = maxes;
+    sm_args.sums = sums;
+
+    for (int i = 0; i < Tn_heads; i++) {
+        vit_transpose(qkv_t + i * H * L, q_head, H, L);
+        vit_matmul(q_head, qkv_t + (F + i * H) * L, scores, L, H, L, 0);
+        pi_cl_team_fork(NUM_CORES, pulp_scalar_mul_fp32_cl, &scale_args);
+        pulp_softmax_fp32_fw_cl(&sm_args);
+        vit_matmul(qkv_t + (2 * F + i * H) * L, scores, att_t + i * H * L, H, L, L, 1);
+    }
+
+    vit_transpose(att_t, att, F, L);
+    vit_linear(att, WEIGHTS_OUT, BIASES_OUT, proj, L, F, E);
+    vit_residual(x, proj, x1);
+
+    //  MLP
+    vit_layernorm(x1, LN2_WEIGHT, LN2_BIAS, h);
+    vit_linear(h, WEIGHTS_FC1, BIASES_FC1, u, L, E, Tmlp_dim);
+
+    struct blob u_blob, g_blob;
+    set_blob(&u_blob, u, NULL, L, Tmlp_dim);
+    set_blob(&g_blob, g, NULL, L, Tmlp_dim);
+    struct act_args gelu_args;
+    gelu_args.input = &u_blob;
+    gelu_args.output = &g_blob;
+    pi_cl_team_fork(NUM_CORES, pulp_gelu_tanh_approx_fp32_fw_cl, &gelu_args);
+
+    vit_linear(g, WEIGHTS_FC2, BIASES_FC2, proj, L, Tmlp_dim, E);
+    vit_residual(x1, proj, y);
+}
+#endif
+
+
+// ~~~~~~~~~~ MAIN FUNCTION ~~~~~~~~~~
+void net_step() {
+#ifdef PROF_NET
+    INIT_STATS();
+    PRE_START_STATS();
+#endif
+
+    printf("\nL = %d, E = %d, F = %d, n_heads = %d, Hm = %d, mask type = %d\n", Tseq_len, Ttoken_size, Tatt_dim, Tn_heads, Tmlp_dim, Tmask_type);
+
+    prepare_block();
+
+#ifdef FORWARD
+    printf("\n----- FUSED TRANSFORMER BLOCK FORWARD -----\n");
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_transformer_block_fp32_fw_cl(&block_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("BLOCK OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size, ERROR_TOLERANCE);
+
+    if (Tmask_type == MHSA_MASK_NONE) {
+        printf("\n----- SAME BLOCK WITH THE VIT LAYERS -----\n");
+        for (int i = 0; i < Tseq_len * Ttoken_size; i++)
+            l1_out[i] = 0;
+#ifdef PROF_NET
+        START_STATS();
+#endif
+        vit_block_forward(l1_in, l1_out);
+#ifdef PROF_NET
+        STOP_STATS();
+#endif
+        check("BLOCK OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size, VIT_ERROR_TOLERANCE);
+    }
+#endif
+
+#ifdef BACKWARD
+    printf("\n----- FUSED TRANSFORMER BLOCK BACKWARD -----\n");
+    pulp_transformer_block_fp32_fw_cl(&block_args);
+    check("BLOCK OUTPUT", l1_out, OUTPUT, Tseq_len * Ttoken_size, ERROR_TOLERANCE);
+#ifdef PROF_NET
+    START_STATS();
+#endif
+    pulp_transformer_block_fp32_bw_cl(&block_args);
+#ifdef PROF_NET
+    STOP_STATS();
+#endif
+    check("INPUT GRADIENT", l1_in_diff, INPUT_GRAD, Tseq_len * Ttoken_size, ERROR_TOLERANCE);
+    check("LN1 WEIGHT GRADIENT", ln1_w_diff, LN1_WEIGHT_GRAD, Ttoken_size, ERROR_TOLERANCE);
+    check("LN1 BIAS GRADIENT", ln1_b_diff, LN1_BIAS_GRAD, Ttoken_size, ERROR_TOLERANCE);
+    check("WQKV GRADIENT", w_qkv_diff, WEIGHTS_QKV_GRAD, 3 * Tatt_dim * Ttoken_size, ERROR_TOLERANCE);
+    check("BQKV GRADIENT", b_qkv_diff, BIASES_QKV_GRAD, 3 * Tatt_dim, ERROR_TOLERANCE);
+    check("WOUT GRADIENT", w_out_diff, WEIGHTS_OUT_GRAD, Ttoken_size * Tatt_dim, ERROR_TOLERANCE);
+    check("BOUT GRADIENT", b_out_diff, BIASES_OUT_GRAD, Ttoken_size, ERROR_TOLERANCE);
+    check("LN2 WEIGHT GRADIENT", ln2_w_diff, LN2_WEIGHT_GRAD, Ttoken_size, ERROR_TOLERANCE);
+    check("LN2 BIAS GRADIENT", ln2_b_diff, LN2_BIAS_GRAD, Ttoken_size, ERROR_TOLERANCE);
+    check("W1 GRADIENT", w_fc1_diff, WEIGHTS_FC1_GRAD, Tmlp_dim * Ttoken_size, ERROR_TOLERANCE);
+    check("B1 GRADIENT", b_fc1_diff, BIASES_FC1_GRAD, Tmlp_dim, ERROR_TOLERANCE);
+    check("W2 GRADIENT", w_fc2_diff, WEIGHTS_FC2_GRAD, Ttoken_size * Tmlp_dim, ERROR_TOLERANCE);
+    check("B2 GRADIENT", b_fc2_diff, BIASES_FC2_GRAD, Ttoken_size, ERROR_TOLERANCE);
+#endif
+
+    return;
+}
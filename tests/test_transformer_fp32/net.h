@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2021-2022 ETH Zurich and University of Bologna
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "step-check.h"
+
+// User profiling flags
+
+//#define DEBUG
+
+// Tensor checksum definition
+// GELU of the kernels uses a Pade tanh with 0.7978 for sqrt(2 / pi), whose error grows with the weight gradients
+#define ERROR_TOLERANCE 0.005
+// The softmax of the ViT layers uses the fastexp_gist approximation of exp
+#define VIT_ERROR_TOLERANCE 0.1
+
+// Saved activations of the block (act_size of pulp_transformer_block_fp32_plan)
+#define ACT_SIZE (4 * Tseq_len + 4 * Tatt_dim * Tseq_len + Tn_heads * Tseq_len + Tseq_len * Ttoken_size + Tseq_len * Tmlp_dim)
+
+// Bound of scratch_size: the planner never stacks a buffer higher than the sum of the FW (or BW) intermediates
+#define SCRATCH_FW (2 * Tseq_len * Ttoken_size + (2 + NUM_CORES) * Tseq_len + Tseq_len * Tmlp_dim)
+#define SCRATCH_BW (2 * Tseq_len * Tmlp_dim + 4 * Tseq_len * Ttoken_size + 4 * Tatt_dim * Tseq_len + Tseq_len)
+#define SCRATCH_SIZE (SCRATCH_FW > SCRATCH_BW ? SCRATCH_FW : SCRATCH_BW)
+
+// Intermediates of the same block run with the ViT layers: h | qkv | qkv^T | q head | scores | maxes | sums | att^T | att | proj | x1 | u | g
+#define VIT_SIZE (2 * Tseq_len * Ttoken_size + 6 * Tatt_dim * Tseq_len + Thead_dim * Tseq_len + Tseq_len * Tseq_len + 2 * Tseq_len \
+                  + 2 * Tatt_dim * Tseq_len + Tseq_len * Ttoken_size + 2 * Tseq_len * Tmlp_dim)
+
+// Main function
+void net_step ();
@@ -29,6 +29,9 @@ Available DNN layer names:
 'ReLU'      -> ReLU activation
 'LeakyReLU' -> LeakyReLU activation
 'Sigmoid'   -> Sigmoid activation
+'HSwish'    -> Hard-Swish activation
+'HSigmoid'  -> Hard-Sigmoid activation
+'SiLU'      -> SiLU (Swish) activation
 'MaxPool'   -> max pooling layer
 'AvgPool'   -> average pooling layer
 'Skipnode'  -> node at which data is taken and passes forward, to add an additional layer after the skip derivation simply substitute 'Skipnode' with any kind of layer
@@ -41,6 +44,8 @@ Available losses:
 
 Available optimizers:
 'SGD'       -> Stochastic Gradient Descent
+'Adam'      -> Adam (betas and eps as ADAM_BETA1, ADAM_BETA2, ADAM_EPS in deployment_utils.py)
+FP16 weights are rounded to nearest or stochastically by the optimizer, as set by FP16_ROUNDING in deployment_utils.py
 """
 
 import deployer_utils.DNN_Reader     as reader
@@ -62,6 +67,7 @@ batch_size      = 1                   # BATCHING NOT IMPLEMENTED!!
 learning_rate   = 0.01
 optimizer       = "SGD"                # Name of PyTorch's optimizer
 loss_fn         = "MSELoss"            # Name of PyTorch's loss function
+lora_alpha      = 8                    # LoRA scaling numerator, the adapter output is scaled by lora_alpha / rank
 
 NET = 0
 
@@ -98,6 +104,8 @@ if NET == 0:
     bias_list           = [ 1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1 ]
     # Sparse Update
     update_layer_list   = [ 0,  0,  0,  0,  0,  0,  1,  0,  0,  0,  0,  1 ]             # Set to 1 for each layer you want to update, 0 if you want to skip weight update
+    # LoRA (linear layers only)
+    lora_rank_list      = [ 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 ]             # Rank of the low-rank adapter trained in place of the (frozen) weights, 0 to train the weights
     # ----- END OF NETWORK GRAPH -----
 elif NET == 1:
     # ------- NETWORK GRAPH --------
@@ -132,6 +140,8 @@ elif NET == 1:
     bias_list           = [ 1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1 ]
     # Sparse Update
     update_layer_list   = [ 1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1 ]             # Set to 1 for each layer you want to update, 0 if you want to skip weight update
+    # LoRA (linear layers only)
+    lora_rank_list      = [ 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 ]             # Rank of the low-rank adapter trained in place of the (frozen) weights, 0 to train the weights
     # ----- END OF NETWORK GRAPH -----
 
 
@@ -182,7 +192,7 @@ else:
     memocc = composer.DNN_Size_Checker(layer_list, in_ch_list, out_ch_list, hk_list, wk_list, hin_list, win_list, 
                                 h_str_list, w_str_list, h_pad_list, w_pad_list,
                                 data_type_list, bias_list, update_layer_list,
-                                L1_SIZE_BYTES, USE_DMA, CONV2D_USE_IM2COL)
+                                L1_SIZE_BYTES, USE_DMA, CONV2D_USE_IM2COL, lora_rank_list, optimizer)
 
     print("DNN memory occupation: {} bytes of {} available L1 bytes ({}%).".format(memocc, L1_SIZE_BYTES, (memocc/L1_SIZE_BYTES)*100))
 
@@ -192,7 +202,8 @@ else:
                             hin_list, win_list, h_str_list, w_str_list, h_pad_list, w_pad_list,
                             epochs, batch_size, learning_rate, optimizer, loss_fn,
                             NUM_CORES, data_type_list, bias_list, update_layer_list, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list,
-                            sumnode_connections, USE_DMA, PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS)
+                            sumnode_connections, USE_DMA, PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS,
+                            lora_rank_list, lora_alpha)
 
     print("PULP project generation successful!")
 
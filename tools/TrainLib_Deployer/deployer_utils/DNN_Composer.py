@@ -33,7 +33,10 @@ memory
 MAX_LAYER_DIM = 0
 
 def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_str_list, w_str_list, h_pad_list,
-                      w_pad_list, data_type_l, bias_l, update_layer_l, avail_mem_bytes, USE_DMA, CONV2D_USE_IM2COL):
+                      w_pad_list, data_type_l, bias_l, update_layer_l, avail_mem_bytes, USE_DMA, CONV2D_USE_IM2COL, lora_rank_l=None, optimizer='SGD'):
+
+    if lora_rank_l is None:
+        lora_rank_l = [0] * len(layers_l)
 
     total_memory_occupation_bytes = 0
     l2_occupation = 0
@@ -61,6 +64,8 @@ def DNN_Size_Checker (layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_s
             is_last_layer = True
         if USE_DMA == 'NO':
             total_memory_occupation_bytes += utils.compute_wgt_act_memocc_bytes(layer, layers_l[layer], in_ch_l[layer], out_ch_l[layer], hk_l[layer], wk_l[layer], hin_l[layer], win_l[layer], h_pad_list[layer], w_pad_list[layer], h_str_list[layer], w_str_list[layer], data_type_l[layer], bias_l[layer], update_layer_l[layer], compute_in_grad, is_last_layer)
+            total_memory_occupation_bytes += utils.compute_lora_memocc_bytes(layers_l[layer], in_ch_l[layer], out_ch_l[layer], data_type_l[layer], bias_l[layer], lora_rank_l[layer])
+            total_memory_occupation_bytes += utils.compute_optimizer_memocc_bytes(layers_l[layer], in_ch_l[layer], out_ch_l[layer], hk_l[layer], wk_l[layer], data_type_l[layer], bias_l[layer], update_layer_l[layer], lora_rank_l[layer], optimizer)
         elif USE_DMA in ['SB', 'DB']:
             l2_occupation +=  utils.compute_wgt_act_memocc_bytes(layer, layers_l[layer], in_ch_l[layer], out_ch_l[layer], hk_l[layer], wk_l[layer], hin_l[layer], win_l[layer], h_pad_list[layer], w_pad_list[layer], h_str_list[layer], w_str_list[layer], data_type_l[layer], bias_l[layer], update_layer_l[layer], compute_in_grad, is_last_layer)
     # Compute im2col memory occupation
@@ -204,6 +209,32 @@ def CheckResConn(layer_list, in_ch_list, out_ch_list, hin_list, win_list, sumnod
                 exit()
 
 
+def CheckLoRA(layer_list, update_layer_l, lora_rank_l, USE_DMA):
+    for layer in range(len(layer_list)):
+        if lora_rank_l[layer] > 0:
+            if layer_list[layer] != 'linear':
+                print("[DNN_Composer.CheckLoRA]: LoRA is available for linear layers only (layer {} is {})!".format(layer, layer_list[layer]))
+                exit()
+            if update_layer_l[layer] != 1:
+                print("[DNN_Composer.CheckLoRA]: Layer {} has a LoRA adapter but is excluded from the update!".format(layer))
+                exit()
+            if USE_DMA != 'NO':
+                print("[NOT_IMPLEMENTED_ERROR] LoRA adapters are available with USE_DMA = 'NO' only!")
+                exit()
+    return
+
+
+def CheckOptimizer(optimizer, USE_DMA):
+    if optimizer not in ['SGD', 'Adam']:
+        print("[DNN_Composer.CheckOptimizer]: Invalid optimizer '{}' for PULP deployment!".format(optimizer))
+        exit()
+    if optimizer != 'SGD' and USE_DMA != 'NO':
+        print("[NOT_IMPLEMENTED_ERROR] The {} optimizer is available with USE_DMA = 'NO' only!".format(optimizer))
+        exit()
+    return
+
+
+
         
 """
 The DNN Composer takes the lists representing the DNN graph and 
@@ -214,7 +245,13 @@ def DNN_Composer (proj_folder_path, project_name,
                   h_str_l, w_str_l, h_pad_l, w_pad_l,
                   epochs, batch_size, learning_rate, optimizer, loss_fn,
                   NUM_CORES, data_type_l, bias_l, update_layer_l, opt_mm_fw_list, opt_mm_wg_list, opt_mm_ig_list,
-                  sumnode_connections, USE_DMA, PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS):
+                  sumnode_connections, USE_DMA, PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS,
+                  lora_rank_l=None, lora_alpha=1):
+
+    if lora_rank_l is None:
+        lora_rank_l = [0] * len(layers_l)
+    CheckLoRA(layers_l, update_layer_l, lora_rank_l, USE_DMA)
+    CheckOptimizer(optimizer, USE_DMA)
 
     # Initialize project (copy the prefab files and create folder)
     utils.InitProject(proj_folder_path)
@@ -227,7 +264,8 @@ def DNN_Composer (proj_folder_path, project_name,
                         layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                         h_str_l, w_str_l, h_pad_l, w_pad_l,
                         epochs, batch_size, learning_rate, optimizer, loss_fn,
-                        data_type_l, bias_l, update_layer_l, sumnode_connections, USE_DMA)
+                        data_type_l, bias_l, update_layer_l, sumnode_connections, USE_DMA,
+                        lora_rank_l, lora_alpha)
 
 
     global MAX_LAYER_DIM
@@ -238,7 +276,8 @@ def DNN_Composer (proj_folder_path, project_name,
                     h_str_l, w_str_l, h_pad_l, w_pad_l,
                     epochs, batch_size, learning_rate, optimizer, loss_fn,
                     data_type_l, bias_l, update_layer_l, sumnode_connections,
-                    PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS)
+                    PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS,
+                    lora_rank_l)
         
     elif USE_DMA == 'SB':
         utilsSB.GenerateNet(proj_folder_path, project_name,
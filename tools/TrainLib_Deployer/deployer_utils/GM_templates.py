@@ -33,6 +33,38 @@ def linear_template(layer_number, chin, chout, bias, data_type):
     return template
 
 
+def lora_template(layer_number, data_type):
+    if data_type == 'FP32':
+        dtype = ""
+    elif data_type == 'FP16':
+        dtype = ", dtype=torch.half"
+    else:
+        print("[GM_templates.lora_template] Invalid data type!!")
+        exit()
+    template = "\t\tself.l"+str(layer_number)+"_lora_A = nn.Parameter(torch.zeros(l"+str(layer_number)+"_lora_rank, l"+str(layer_number)+"_in_ch"+dtype+"))\n"
+    template += "\t\tself.l"+str(layer_number)+"_lora_B = nn.Parameter(torch.zeros(l"+str(layer_number)+"_out_ch, l"+str(layer_number)+"_lora_rank"+dtype+"))\n"
+    return template
+
+
+def lora_forward_template(layer_number):
+    template = "\n\tdef l"+str(layer_number)+"_lora(self, x):\n"
+    template += "\t\treturn self.l"+str(layer_number)+"(x) + l"+str(layer_number)+"_lora_scale * torch.mv(self.l"+str(layer_number)+"_lora_B, torch.mv(self.l"+str(layer_number)+"_lora_A, x))\n"
+    return template
+
+
+def lora_dump_template(layer_number, data_type):
+    if data_type == 'FP32':
+        ctype = "float"
+    elif data_type == 'FP16':
+        ctype = "fp16"
+    else:
+        print("[GM_templates.lora_dump_template] Invalid data type!!")
+        exit()
+    template = "f.write('PI_L2 "+ctype+" init_LORA_A_l"+str(layer_number)+"[LORA_R_l"+str(layer_number)+"*Tin_C_l"+str(layer_number)+"] = {'+dump.tensor_to_string(net.l"+str(layer_number)+"_lora_A.data)+'};\\n')\n"
+    template += "f.write('PI_L2 "+ctype+" init_LORA_B_l"+str(layer_number)+"[Tout_C_l"+str(layer_number)+"*LORA_R_l"+str(layer_number)+"] = {'+dump.tensor_to_string(net.l"+str(layer_number)+"_lora_B.data)+'};\\n')\n"
+    return template
+
+
 def conv2d_template(layer_number, chin, chout, hk, wk, hstr, wstr, hpad, wpad, bias, data_type):
     if data_type == 'FP32':
         template = "\t\tself.l"+str(layer_number)+" = nn.Conv2d(in_channels=l"+str(layer_number)+"_in_ch, out_channels=l"+str(layer_number)+"_out_ch, kernel_size=(l"+str(layer_number)+"_hk, l"+str(layer_number)+"_wk), padding=(l"+str(layer_number)+"_hpad, l"+str(layer_number)+"_wpad), stride=(l"+str(layer_number)+"_hstr, l"+str(layer_number)+"_wstr), bias="+str(bias)+")\n"
@@ -101,6 +133,36 @@ def Sigmoid_template(layer, data_type):
         exit() 
     return template
 
+def HSwish_template(layer, data_type):
+    if data_type == 'FP32':
+        template = "\t\tself.l"+str(layer)+" = nn.Hardswish()\n"
+    elif data_type == 'FP16':
+        template = "\t\tself.l"+str(layer)+" = nn.Hardswish()\n"
+    else:
+        print("[GM_templates.HSwish_template] Invalid data type!!")
+        exit() 
+    return template
+
+def HSigmoid_template(layer, data_type):
+    if data_type == 'FP32':
+        template = "\t\tself.l"+str(layer)+" = nn.Hardsigmoid()\n"
+    elif data_type == 'FP16':
+        template = "\t\tself.l"+str(layer)+" = nn.Hardsigmoid()\n"
+    else:
+        print("[GM_templates.HSigmoid_template] Invalid data type!!")
+        exit() 
+    return template
+
+def SiLU_template(layer, data_type):
+    if data_type == 'FP32':
+        template = "\t\tself.l"+str(layer)+" = nn.SiLU()\n"
+    elif data_type == 'FP16':
+        template = "\t\tself.l"+str(layer)+" = nn.SiLU()\n"
+    else:
+        print("[GM_templates.SiLU_template] Invalid data type!!")
+        exit() 
+    return template
+
 
 
 """"
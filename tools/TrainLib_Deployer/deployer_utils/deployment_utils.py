@@ -28,6 +28,15 @@ import deployer_utils.GM_templates as Gtemp
 import deployer_utils.net_templates as ntemp
 
 
+# Adam hyperparameters (PyTorch defaults), shared by the golden model and the generated code
+ADAM_BETA1 = 0.9
+ADAM_BETA2 = 0.999
+ADAM_EPS = 1e-08
+
+# Rounding of the FP16 weights written by the optimizer (FP16_ROUND_NEAREST or FP16_ROUND_STOCHASTIC, see pulp_train_defines.h)
+FP16_ROUNDING = 'FP16_ROUND_NEAREST'
+
+
 """
 DNN Size Checker backend functions
 """
@@ -49,7 +58,7 @@ def compute_wgt_act_memocc_bytes(layer_number, layer_type, chin, chout, hk, wk,
 
     # If the layer is an activation, no weights or biases!
     wgt_present = 1
-    if layer_type in ['ReLU', 'LeakyReLU', 'Sigmoid', 'Skipnode', 'Sumnode'] or update_layer == 0:
+    if layer_type in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU', 'Skipnode', 'Sumnode'] or update_layer == 0:
         wgt_present = 0
         bias_present = 0
 
@@ -94,6 +103,44 @@ def compute_wgt_act_memocc_bytes(layer_number, layer_type, chin, chout, hk, wk,
     return memocc_bytes
 
 
+# Memory of a LoRA adapter (A, B, their gradients and the hidden vector) minus the weight and bias gradients it replaces
+def compute_lora_memocc_bytes(layer_type, chin, chout, DATA_TYPE, use_bias, lora_rank):
+
+    if layer_type != 'linear' or lora_rank == 0:
+        return 0
+
+    byte_size = 4
+    if DATA_TYPE == 'FP16':
+        byte_size = 2
+
+    memocc_bytes = 2 * lora_rank * (chin + chout) * byte_size   # A, B and their gradients
+    memocc_bytes += 2 * lora_rank * byte_size                   # hidden vector and its gradient
+    memocc_bytes -= chin * chout * byte_size                    # frozen weights, no gradient
+    memocc_bytes -= chout * use_bias                            # frozen biases, no gradient
+
+    return memocc_bytes
+
+
+# Memory of the optimizer state (the two moments of Adam for each updated tensor)
+def compute_optimizer_memocc_bytes(layer_type, chin, chout, hk, wk, DATA_TYPE, use_bias, update_layer, lora_rank, optimizer):
+
+    if optimizer != 'Adam' or update_layer == 0 or layer_type not in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm']:
+        return 0
+
+    byte_size = 4
+    if DATA_TYPE == 'FP16':
+        byte_size = 2
+
+    if lora_rank > 0:
+        n_params = lora_rank * (chin + chout)
+    elif layer_type == 'InstNorm':
+        n_params = 2 * chin
+    else:
+        n_params = chin * chout * hk * wk + chout * use_bias
+
+    return 2 * n_params * byte_size
+
+
 def compute_im2col_memocc_bytes(layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l, h_pad_l, w_pad_l, h_str_l, w_str_l, data_type_l, update_layer_l, CONV2D_USE_IM2COL):
 
     memocc_bytes = 0
@@ -345,6 +392,9 @@ def GenerateMakefile(proj_folder_path, project_name, layers_l, NUM_CORES, data_t
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_losses_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_matmul_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_optimizers_fp16.c\n')
+        # The mixed precision step of pulp_optimizers_fp16.c runs the FP32 optimizer on the master weights
+        if check_FP32 == False:
+            f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_optimizers_fp32.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_pooling_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_residual_fp16.c\n')
         f.write('APP_SRCS += $(TRAIN_LIB_SRCS)/pulp_instnorm_fp16.c\n')
@@ -370,7 +420,11 @@ def GenerateGM(proj_folder_path, project_name,
                 layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                 h_str_l, w_str_l, h_pad_l, w_pad_l,
                 epochs, batch_size, learning_rate, optimizer, loss_fn,
-                data_type_l, bias_l, update_layer_l, sumnode_connections, USE_DMA):
+                data_type_l, bias_l, update_layer_l, sumnode_connections, USE_DMA,
+                lora_rank_l=None, lora_alpha=1):
+
+    if lora_rank_l is None:
+        lora_rank_l = [0] * len(layers_l)
 
     # Check if GPU is available, else keep fake FP16
     cuda_is_on = torch.cuda.is_available()
@@ -419,6 +473,10 @@ def GenerateGM(proj_folder_path, project_name,
         f.write("l"+str(layer)+"_wstr = "+str(w_str_l[layer])+"\n")
         f.write("l"+str(layer)+"_hpad = "+str(h_pad_l[layer])+"\n")
         f.write("l"+str(layer)+"_wpad = "+str(w_pad_l[layer])+"\n")
+        # LoRA adapter
+        if lora_rank_l[layer] > 0:
+            f.write("l"+str(layer)+"_lora_rank = "+str(lora_rank_l[layer])+"\n")
+            f.write("l"+str(layer)+"_lora_scale = "+str(lora_alpha / lora_rank_l[layer])+"\n")
     f.write("\n")
 
     # Write sizes to the header files 
@@ -440,6 +498,9 @@ def GenerateGM(proj_folder_path, project_name,
             f.write("f.write('#define Tstr_W_l"+str(layer)+" '+str(l"+str(layer)+"_wstr)+'\\n')\n")
             f.write("f.write('#define Tpad_H_l"+str(layer)+" '+str(l"+str(layer)+"_hpad)+'\\n')\n")
             f.write("f.write('#define Tpad_W_l"+str(layer)+" '+str(l"+str(layer)+"_wpad)+'\\n')\n")
+        if lora_rank_l[layer] > 0:
+            f.write("f.write('#define LORA_R_l"+str(layer)+" '+str(l"+str(layer)+"_lora_rank)+'\\n')\n")
+            f.write("f.write('#define LORA_SCALE_l"+str(layer)+" '+str(l"+str(layer)+"_lora_scale)+'\\n')\n")
     f.write("f.close()\n\n")
 
     # Write hyperparameters to header
@@ -448,6 +509,10 @@ def GenerateGM(proj_folder_path, project_name,
     f.write("f.write('#define LEARNING_RATE '+str(learning_rate)+'\\n')\n")
     f.write("f.write('#define EPOCHS '+str(epochs)+'\\n')\n")
     f.write("f.write('#define BATCH_SIZE '+str(batch_size)+'\\n')\n")
+    if optimizer == 'Adam':
+        f.write("f.write('#define ADAM_BETA1 "+str(ADAM_BETA1)+"\\n')\n")
+        f.write("f.write('#define ADAM_BETA2 "+str(ADAM_BETA2)+"\\n')\n")
+        f.write("f.write('#define ADAM_EPS "+str(ADAM_EPS)+"\\n')\n")
     f.write("f.close()\n\n")
 
     # Create input data and label
@@ -491,6 +556,8 @@ def GenerateGM(proj_folder_path, project_name,
         # Layers
         if layers_l[layer] == "linear":
             f.write(Gtemp.linear_template(layer, in_ch_l[layer], out_ch_l[layer], bias_l[layer], current_type)) # "False"
+            if lora_rank_l[layer] > 0:
+                f.write(Gtemp.lora_template(layer, current_type))
         elif layers_l[layer] == "conv2d":
             f.write(Gtemp.conv2d_template(layer, in_ch_l[layer], out_ch_l[layer], hk_l[layer], wk_l[layer], h_str_l[layer], w_str_l[layer], h_pad_l[layer], w_pad_l[layer], bias_l[layer], current_type))
         elif layers_l[layer] == "DW":
@@ -504,6 +571,12 @@ def GenerateGM(proj_folder_path, project_name,
             f.write(Gtemp.LeakyReLU_template(layer, current_type))
         elif layers_l[layer] == "Sigmoid":
             f.write(Gtemp.Sigmoid_template(layer, current_type))
+        elif layers_l[layer] == "HSwish":
+            f.write(Gtemp.HSwish_template(layer, current_type))
+        elif layers_l[layer] == "HSigmoid":
+            f.write(Gtemp.HSigmoid_template(layer, current_type))
+        elif layers_l[layer] == "SiLU":
+            f.write(Gtemp.SiLU_template(layer, current_type))
         # Pooling
         elif layers_l[layer] == "MaxPool":
             f.write(Gtemp.MaxPool_template(layer, hk_l[layer], wk_l[layer], h_str_l[layer], w_str_l[layer], current_type))
@@ -521,12 +594,19 @@ def GenerateGM(proj_folder_path, project_name,
         else:
             print("[deployment_utils.GenerateGM]: Layer {} not recognized!!\n".format(layer))
             exit()
+    # LoRA layers: frozen linear plus the scaled low-rank path
+    for layer in range(len(layers_l)):
+        if lora_rank_l[layer] > 0:
+            f.write(Gtemp.lora_forward_template(layer))
     # Create Forward
     f.write("\n")
     f.write("\tdef forward(self, x):")
     for layer in range(len(layers_l)):
 
         variable = 'x'
+        layer_call = "self.l"+str(layer)
+        if lora_rank_l[layer] > 0:
+            layer_call = "self.l"+str(layer)+"_lora"
         if sumnode_connections[layer] != -1:
             variable = f'y{sumnode_connections[layer]}' # Create a temporary variable for skip connections
 
@@ -548,25 +628,25 @@ def GenerateGM(proj_folder_path, project_name,
                 f.write(f"\n\t\tx = x.float()")
         # Forward layers 
         # (ReLU works with FP32 only)
-        if layers_l[layer] in ['ReLU', 'LeakyReLU', 'Sigmoid']: # and data_type_l[layer-1] == 'FP32' and data_type_l[layer] == 'FP16':
+        if layers_l[layer] in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']: # and data_type_l[layer-1] == 'FP32' and data_type_l[layer] == 'FP16':
             if cuda_is_on:
                 f.write(f"\n\t\t{variable} = self.l"+str(layer)+f"({variable})")
             else:
                 f.write(f"\n\t\t{variable} = self.l"+str(layer)+f"({variable}.float())")
         #Skipconn
         elif sumnode_connections[layer] != -1 and layers_l[layer] != 'Sumnode':
-            f.write(f"\n\t\t{variable} = self.l{layer}(x)")
+            f.write(f"\n\t\t{variable} = {layer_call}(x)")
             f.write(f"\n\t\tx = {variable}")
         elif layers_l[layer] == "Sumnode": 
             f.write(f"\n\t\tx = y{layer} + x\t# Sumnode") 
         # Last layer
         elif layer == len(layers_l)-1:
             if cuda_is_on:
-                f.write(f"\n\t\t{variable} = self.l"+str(layer)+"(x)")
+                f.write(f"\n\t\t{variable} = {layer_call}(x)")
             else:
-                f.write(f"\n\t\t{variable} = self.l"+str(layer)+"(x).float()")
+                f.write(f"\n\t\t{variable} = {layer_call}(x).float()")
         else:
-            f.write("\n\t\tx = self.l"+str(layer)+"(x)")
+            f.write(f"\n\t\tx = {layer_call}(x)")
         
     f.write("\n\t\treturn x\n")
     print("[deployment_utils.GenerateNet]: Setting last layer's output to float for PyTorch compatibility with loss function backward (future fix).")
@@ -596,8 +676,13 @@ def GenerateGM(proj_folder_path, project_name,
         if sparse_comment_written == False:
             f.write("# Freeze weights for sparse update\n")
             sparse_comment_written = True
-        if write_sparse_update and update_layer_l[layer] == 0 and layers_l[layer] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'AvgPool', 'MaxPool', 'Sumnode', 'Skipnode']:
+        if write_sparse_update and update_layer_l[layer] == 0 and layers_l[layer] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU', 'AvgPool', 'MaxPool', 'Sumnode', 'Skipnode']:
             f.write("net.l"+str(layer)+".weight.requires_grad = False\n")
+        # LoRA: the adapter is trained in place of the weights and biases
+        if lora_rank_l[layer] > 0:
+            f.write("net.l"+str(layer)+".weight.requires_grad = False\n")
+            if bias_l[layer] == 1:
+                f.write("net.l"+str(layer)+".bias.requires_grad = False\n")
     f.write("\n")
 
     # Write all-ones sample label
@@ -609,7 +694,7 @@ def GenerateGM(proj_folder_path, project_name,
     f.write("f = open('io_data.h', 'w')\n")
     f.write("f.write('// Init weights\\n')\n")
     for layer in range(len(layers_l)):
-        if (layers_l[layer] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'MaxPool',  'AvgPool', 'Skipnode', 'Sumnode']):
+        if (layers_l[layer] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU', 'MaxPool',  'AvgPool', 'Skipnode', 'Sumnode']):
             dump = f"+dump.tensor_to_string(net.l{layer}.weight.data)+"
             bias_dump = f"+dump.tensor_to_string(net.l{layer}.bias.data)+"
             if layers_l[layer] != 'InstNorm':   # Generic layer's weights
@@ -630,6 +715,8 @@ def GenerateGM(proj_folder_path, project_name,
             else:
                 print("[deployment_utils.GenerateGM] Error in data type definition! (weight init)")
                 exit()
+            if lora_rank_l[layer] > 0:
+                f.write(Gtemp.lora_dump_template(layer, data_type_l[layer]))
         else:
             f.write("f.write('#define WGT_SIZE_L"+str(layer)+" '+str(l"+str(layer)+"_in_ch*l"+str(layer)+"_out_ch*l"+str(layer)+"_hk*l"+str(layer)+"_wk)+'\\n')\n")
             if data_type_l[layer] == 'FP32':
@@ -644,6 +731,8 @@ def GenerateGM(proj_folder_path, project_name,
     # Define optimizer
     if optimizer == 'SGD':
         f.write("optimizer = optim."+str(optimizer)+"(net.parameters(), lr=learning_rate, momentum=0)\n")
+    elif optimizer == 'Adam':
+        f.write("optimizer = optim."+str(optimizer)+"(net.parameters(), lr=learning_rate, betas=("+str(ADAM_BETA1)+", "+str(ADAM_BETA2)+"), eps="+str(ADAM_EPS)+")\n")
     else:
         print("[deployment_utils.GenerateGM]: Invalid optimizer!!\n!")
         exit()
@@ -705,12 +794,64 @@ def GenerateGM(proj_folder_path, project_name,
 
 
 # Generate the net.c and net.h files for the execution on PULP
+# Fills the optimizer structure of one layer (an element of the array passed to the multi-tensor step). Adam reads its moments from <tensor>_m and <tensor>_v.
+def write_optimizer_args(f, opt, wgt_blob, wgt_tensor, bias_blob, bias_tensor, optimizer, data_type):
+
+    f.write("  "+opt+".weights = &"+wgt_blob+";\n")
+    if bias_blob is not None:
+        f.write("  "+opt+".biases = &"+bias_blob+";\n")
+        f.write("  "+opt+".use_biases = 1;\n")
+    else:
+        f.write("  "+opt+".use_biases = 0;\n")
+    f.write("  "+opt+".learning_rate = LEARNING_RATE;\n")
+
+    if optimizer == "Adam":
+        f.write("  "+opt+".m_weights = "+wgt_tensor+"_m;\n")
+        f.write("  "+opt+".v_weights = "+wgt_tensor+"_v;\n")
+        if bias_blob is not None:
+            f.write("  "+opt+".m_biases = "+bias_tensor+"_m;\n")
+            f.write("  "+opt+".v_biases = "+bias_tensor+"_v;\n")
+        f.write("  "+opt+".beta1 = ADAM_BETA1;\n")
+        f.write("  "+opt+".beta2 = ADAM_BETA2;\n")
+        f.write("  "+opt+".eps = ADAM_EPS;\n")
+        f.write("  "+opt+".weight_decay = 0;\n")
+        f.write("  "+opt+".step = adam_step;\n")
+
+    if data_type == 'FP16':
+        f.write("  "+opt+".rounding = "+FP16_ROUNDING+";\n")
+        # Adam folds its step into the seed of the stochastic rounding
+        if FP16_ROUNDING == 'FP16_ROUND_STOCHASTIC' and optimizer != "Adam":
+            f.write("  "+opt+".seed = sr_seed;\n")
+        else:
+            f.write("  "+opt+".seed = 0;\n")
+
+
+# Tensors updated by the optimizer at a layer, with the C expression of their size
+def optimizer_state_tensors(layer, layer_type, use_bias, update_layer, lora_rank):
+
+    l = str(layer)
+    if lora_rank > 0:
+        return [("l"+l+"_lora_A", "LORA_R_l"+l+" * Tin_C_l"+l), ("l"+l+"_lora_B", "Tout_C_l"+l+" * LORA_R_l"+l)]
+    if update_layer != 1 or layer_type not in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm']:
+        return []
+    if layer_type == 'InstNorm':
+        return [("l"+l+"_ker", "2*Tin_C_l"+l)]
+    tensors = [("l"+l+"_ker", "Tin_C_l"+l+" * Tout_C_l"+l+" * Tker_H_l"+l+" * Tker_W_l"+l)]
+    if use_bias == 1:
+        tensors.append(("l"+l+"_bias", "Tout_C_l"+l))
+    return tensors
+
+
 def GenerateNet(proj_folder_path, project_name,
                 layers_l, in_ch_l, out_ch_l, hk_l, wk_l, hin_l, win_l,
                 h_str_l, w_str_l, h_pad_l, w_pad_l,
                 epochs, batch_size, learning_rate, optimizer, loss_fn,
                 data_type_l, bias_l, update_layer_l, sumnode_connections,
-                PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS):
+                PROFILE_SINGLE_LAYERS, SEPARATE_BACKWARD_STEPS, CONV2D_USE_IM2COL, PRINT_TRAIN_LOSS,
+                lora_rank_l=None):
+
+    if lora_rank_l is None:
+        lora_rank_l = [0] * len(layers_l)
 
     # Generate net.h
     f = open(proj_folder_path+'net.h', 'w')
@@ -772,6 +913,11 @@ def GenerateNet(proj_folder_path, project_name,
         else:
             print("[deployment_utils.GenerateNet] Invalid data type for blob definition @Layer{}!".format(layer))
             exit()
+        if lora_rank_l[layer] > 0:
+            if data_type_l[layer] == 'FP32':
+                f.write("PI_L1 struct blob layer"+str(layer)+"_lora_A, layer"+str(layer)+"_lora_B, layer"+str(layer)+"_lora_hidden;\n")
+            else:
+                f.write("PI_L1 struct blob_fp16 layer"+str(layer)+"_lora_A, layer"+str(layer)+"_lora_B, layer"+str(layer)+"_lora_hidden;\n")
 
 
     f.write("\n// Define DNN layer structures\n")
@@ -794,6 +940,12 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 struct leakyrelu_args l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'Sigmoid':
                 f.write("PI_L1 struct act_args l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'HSwish':
+                f.write("PI_L1 struct act_args l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'HSigmoid':
+                f.write("PI_L1 struct act_args l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'SiLU':
+                f.write("PI_L1 struct act_args l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'MaxPool':
                 pass
             elif layers_l[layer] == 'AvgPool':
@@ -822,6 +974,12 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("PI_L1 struct leakyrelu_args_fp16 l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'Sigmoid':
                 f.write("PI_L1 struct act_args_fp16 l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'HSwish':
+                f.write("PI_L1 struct act_args_fp16 l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'HSigmoid':
+                f.write("PI_L1 struct act_args_fp16 l"+str(layer)+"_args;\n")
+            elif layers_l[layer] == 'SiLU':
+                f.write("PI_L1 struct act_args_fp16 l"+str(layer)+"_args;\n")
             elif layers_l[layer] == 'MaxPool':
                 pass
             elif layers_l[layer] == 'AvgPool':
@@ -860,7 +1018,7 @@ def GenerateNet(proj_folder_path, project_name,
     for layer in range(len(layers_l)):
         # Define FP32 tensors
         if data_type_l[layer] == 'FP32':
-            if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("PI_L1 float l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
@@ -872,7 +1030,7 @@ def GenerateNet(proj_folder_path, project_name,
                     f.write("PI_L1 float l"+str(layer)+"_bias[Tout_C_l"+str(layer)+"];\n")
         # Define FP16 tensors
         elif data_type_l[layer] == 'FP16':
-            if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("PI_L1 fp16 l"+str(layer)+"_ker[1];\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode': 
                 pass
@@ -890,10 +1048,10 @@ def GenerateNet(proj_folder_path, project_name,
     f.write("\n// Define kernel grad tensors\n")
     for layer in range(len(layers_l)):
         # Define tensor only if layer is updated
-        if update_layer_l[layer] == 1:
+        if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
             # Define FP32 tensors
             if data_type_l[layer] == 'FP32':
-                if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+                if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                     f.write("PI_L1 float l"+str(layer)+"_ker_diff[1];\n")
                 elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                     pass
@@ -905,7 +1063,7 @@ def GenerateNet(proj_folder_path, project_name,
                         f.write("PI_L1 float l"+str(layer)+"_bias_diff[Tout_C_l"+str(layer)+"];\n")
             # Define FP16 tensors
             elif data_type_l[layer] == 'FP16':
-                if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+                if layers_l[layer] in ['MaxPool', 'AvgPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                     f.write("PI_L1 fp16 l"+str(layer)+"_ker_diff[1];\n")
                 elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                     pass
@@ -919,12 +1077,36 @@ def GenerateNet(proj_folder_path, project_name,
             else:
                 print("[deployment_utils.GenerateNet] Invalid data type for kernel grad definition @Layer{}!".format(layer))
                 exit()
+        # LoRA: frozen weights, the adapter and its gradient are defined instead
+        elif lora_rank_l[layer] > 0:
+            if data_type_l[layer] == 'FP32':
+                C_type = 'float'
+            elif data_type_l[layer] == 'FP16':
+                C_type = 'fp16'
+            else:
+                print("[deployment_utils.GenerateNet] Invalid data type for LoRA definition @Layer{}!".format(layer))
+                exit()
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_A[LORA_R_l"+str(layer)+" * Tin_C_l"+str(layer)+"];\n")
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_A_diff[LORA_R_l"+str(layer)+" * Tin_C_l"+str(layer)+"];\n")
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_B[Tout_C_l"+str(layer)+" * LORA_R_l"+str(layer)+"];\n")
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_B_diff[Tout_C_l"+str(layer)+" * LORA_R_l"+str(layer)+"];\n")
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_hidden[LORA_R_l"+str(layer)+"];\n")
+            f.write("PI_L1 "+C_type+" l"+str(layer)+"_lora_hidden_diff[LORA_R_l"+str(layer)+"];\n")
         elif update_layer_l[layer] == 0:
             pass
         else:
             print("[deployment_utils.GenerateNet] Invalid sparse update variable for layer {}!!".format(layer))
 
 
+    if optimizer == "Adam":
+        f.write("\n// Define optimizer state (Adam moments)\n")
+        for layer in range(len(layers_l)):
+            C_type = 'float' if data_type_l[layer] == 'FP32' else 'fp16'
+            for tensor, size in optimizer_state_tensors(layer, layers_l[layer], bias_l[layer], update_layer_l[layer], lora_rank_l[layer]):
+                f.write("PI_L1 "+C_type+" "+tensor+"_m["+size+"];\n")
+                f.write("PI_L1 "+C_type+" "+tensor+"_v["+size+"];\n")
+
+
     # Identify last updated layer
     last_updated_idx = len(layers_l) - 1
     for layer in range(len(layers_l)):
@@ -946,7 +1128,7 @@ def GenerateNet(proj_folder_path, project_name,
             data_size = 2
         # Find if the layer needs to store in grad for weight grad computation (next layer needs it)
         save_activation = True
-        if layer > 0 and layer < (len(layers_l)-1) and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+        if layer > 0 and layer < (len(layers_l)-1) and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
             in_size = in_ch_l[layer] * hin_l[layer] * win_l[layer] 
             save_activation = False
             use_activation_buffer = True
@@ -1213,7 +1395,7 @@ def GenerateNet(proj_folder_path, project_name,
         if layer == 0:
             f.write("  // Layer "+str(layer)+"\n")
             f.write("  for(int i=0; i<Tin_C_l0*Tin_H_l0*Tin_W_l0; i++)\t\t\tl0_in[i] = INPUT[i];\n")
-            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layers_l[layer] not in ['Skipnode', 'Sumnode', 'InstNorm', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  for(int i=0; i<Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0; i++)\t\tl0_ker[i] = init_WGT_l0[i];\n")
                 if bias_l[layer] == 1:
                     f.write("  for(int i=0; i<Tout_C_l0; i++)\t\tl0_bias[i] = init_BIAS_l0[i];\n")
@@ -1227,7 +1409,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  //   Pooling kernel (no parameters)\n")
             elif layers_l[layer] == 'Skipnode' or layers_l[layer] == 'Sumnode':
                 f.write("  //   Resconn layer (no parameters)\n")
-            elif layers_l[layer] in ['ReLU', 'LeakyReLU', 'Sigmoid']:
+            elif layers_l[layer] in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  //   Activation layer (no parameters)\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write("  for(int i=0; i<2*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
@@ -1240,7 +1422,7 @@ def GenerateNet(proj_folder_path, project_name,
                 if bias_l[layer] == 1:
                     f.write("  for(int i=0; i<Tout_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_bias[i] = init_BIAS_l"+str(layer)+"[i];\n")
         elif layer == len(layers_l)-1:
-            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layers_l[layer] not in  ['Skipnode', 'Sumnode', 'InstNorm', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  // Layer "+str(layer)+"\n")
                 f.write("  for(int i=0; i<Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_ker[i] = init_WGT_l"+str(layer)+"[i];\n")
                 if bias_l[layer] == 1:
@@ -1250,6 +1432,16 @@ def GenerateNet(proj_folder_path, project_name,
         else:
             print("[deployment_utils.GenerateNet]: Error in PULP layer initialization!")
             exit()
+    for layer in range(len(layers_l)):
+        if lora_rank_l[layer] > 0:
+            f.write("  // Layer "+str(layer)+" LoRA adapter\n")
+            f.write("  for(int i=0; i<LORA_R_l"+str(layer)+"*Tin_C_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_lora_A[i] = init_LORA_A_l"+str(layer)+"[i];\n")
+            f.write("  for(int i=0; i<Tout_C_l"+str(layer)+"*LORA_R_l"+str(layer)+"; i++)\t\tl"+str(layer)+"_lora_B[i] = init_LORA_B_l"+str(layer)+"[i];\n")
+    if optimizer == "Adam":
+        f.write("  // Adam moments\n")
+        for layer in range(len(layers_l)):
+            for tensor, size in optimizer_state_tensors(layer, layers_l[layer], bias_l[layer], update_layer_l[layer], lora_rank_l[layer]):
+                f.write("  for(int i=0; i<"+size+"; i++)\t\t{ "+tensor+"_m[i] = 0; "+tensor+"_v[i] = 0; }\n")
 
 
 
@@ -1279,7 +1471,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_in.W = Tin_W_l0;\n")
         elif layer == 0:                                # First layer
             f.write("  // Layer "+str(layer)+"\n")
-            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  layer"+str(layer)+"_in.data = ("+C_data_type+"*) act_shared_buffer;\n")
             else:
                 f.write("  layer"+str(layer)+"_in.data = l"+str(layer)+"_in;\n")
@@ -1289,7 +1481,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_in.W = Tin_W_l"+str(layer)+";\n")
         elif layer > 0 and layer < len(layers_l)-1:     # Hidden layers
             f.write("  // Layer "+str(layer)+"\n")
-            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  layer"+str(layer)+"_in.data = ("+C_data_type+"*) act_shared_buffer;\n")
             else:
                 f.write("  layer"+str(layer)+"_in.data = l"+str(layer - previous_was_skip_data)+"_in;\n")
@@ -1301,7 +1493,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_in.W = Tin_W_l"+str(layer)+";\n")
         elif layer == len(layers_l)-1:                  # Last layer
             f.write("  // Layer "+str(layer)+"\n")
-            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            if layer > 0 and update_layer_l[layer] == 0 and layers_l[layer] not in ['Skipnode', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  layer"+str(layer)+"_in.data = ("+C_data_type+"*) act_shared_buffer;\n")
             else:
                 f.write("  layer"+str(layer)+"_in.data = l"+str(layer - previous_was_skip_data)+"_in;\n")
@@ -1318,13 +1510,13 @@ def GenerateNet(proj_folder_path, project_name,
         # WEIGHT BLOB
         if len(layers_l) == 1:                          # DNN is 1 layer long
             f.write("  layer"+str(layer)+"_wgt.data = l0_ker;\n")
-            if update_layer_l[layer] == 1:    # Sparse Update
+            if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:    # Sparse Update
                 f.write("  layer"+str(layer)+"_wgt.diff = l0_ker_diff;\n")
             if layers_l[layer] == 'DW':
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tker_H_l0*Tker_W_l0;\n")
             elif layers_l[layer] == 'InstNorm':
                 f.write("  layer"+str(layer)+"_wgt.dim = 2*Tin_C_l0;\n")
-            elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+            elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                 f.write("  layer"+str(layer)+"_wgt.dim = 1;\n")
             else:
                 f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l0*Tout_C_l0*Tker_H_l0*Tker_W_l0;\n")
@@ -1333,7 +1525,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("  layer"+str(layer)+"_wgt.W = Tker_W_l0;\n")
             if bias_l[layer] == 1:
                 f.write("  layer"+str(layer)+"_bias.data = l"+str(layer)+"_bias;\n")
-                if update_layer_l[layer] == 1:
+                if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
                     f.write("  layer"+str(layer)+"_bias.diff = l"+str(layer)+"_bias_diff;\n")
                 f.write("  layer"+str(layer)+"_bias.dim = Tout_C_l"+str(layer)+";\n")
                 f.write("  layer"+str(layer)+"_bias.C = Tout_C_l"+str(layer)+";\n")
@@ -1343,13 +1535,13 @@ def GenerateNet(proj_folder_path, project_name,
         elif layer == 0:
             if layers_l[0] != 'Skipnode': # Avoid weight assignment for Skip Connections
                 f.write("  layer"+str(layer)+"_wgt.data = l"+str(layer)+"_ker;\n")
-                if update_layer_l[layer] == 1:    # Sparse Update
+                if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:    # Sparse Update
                     f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
                 elif layers_l[layer] == 'InstNorm':
                     f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
-                elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+                elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                     f.write("  layer"+str(layer)+"_wgt.dim = 1;\n")
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1359,7 +1551,7 @@ def GenerateNet(proj_folder_path, project_name,
 
                 if bias_l[layer] == 1:
                     f.write("  layer"+str(layer)+"_bias.data = l"+str(layer)+"_bias;\n")
-                    if update_layer_l[layer] == 1:
+                    if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
                         f.write("  layer"+str(layer)+"_bias.diff = l"+str(layer)+"_bias_diff;\n")
                     f.write("  layer"+str(layer)+"_bias.dim = Tout_C_l"+str(layer)+";\n")
                     f.write("  layer"+str(layer)+"_bias.C = Tout_C_l"+str(layer)+";\n")
@@ -1369,13 +1561,13 @@ def GenerateNet(proj_folder_path, project_name,
             if layers_l[layer] != 'Skipnode':   # Avoid weight assignment for Skipnodes and out data assignement
                 if layers_l[layer]  != 'Sumnode':    # Avoid ONLY weight assignment for Sumnodes
                     f.write("  layer"+str(layer)+"_wgt.data = l"+str(layer)+"_ker;\n")
-                    if update_layer_l[layer] == 1:    # Sparse Update
+                    if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:    # Sparse Update
                         f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                     if layers_l[layer] == 'DW':
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
                     elif layers_l[layer] == 'InstNorm':
                         f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
-                    elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+                    elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                         f.write("  layer"+str(layer)+"_wgt.dim = 1;\n")
                     else:
                         f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1384,7 +1576,7 @@ def GenerateNet(proj_folder_path, project_name,
                     f.write("  layer"+str(layer)+"_wgt.W = Tker_W_l"+str(layer)+";\n")
                     if bias_l[layer] == 1:
                         f.write("  layer"+str(layer)+"_bias.data = l"+str(layer)+"_bias;\n")
-                        if update_layer_l[layer] == 1:
+                        if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
                             f.write("  layer"+str(layer)+"_bias.diff = l"+str(layer)+"_bias_diff;\n")
                         f.write("  layer"+str(layer)+"_bias.dim = Tout_C_l"+str(layer)+";\n")
                         f.write("  layer"+str(layer)+"_bias.C = Tout_C_l"+str(layer)+";\n")
@@ -1393,13 +1585,13 @@ def GenerateNet(proj_folder_path, project_name,
         elif layer == len(layers_l)-1:                  # Last layer
             if layers_l[layer] !=  'Sumnode':
                 f.write("  layer"+str(layer)+"_wgt.data = l"+str(layer)+"_ker;\n")
-                if update_layer_l[layer] == 1:
+                if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
                     f.write("  layer"+str(layer)+"_wgt.diff = l"+str(layer)+"_ker_diff;\n")
                 if layers_l[layer] == 'DW':
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
                 elif layers_l[layer] == 'InstNorm':
                         f.write("  layer"+str(layer)+f"_wgt.dim = 2*Tin_C_l{layer};\n")
-                elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid']:
+                elif layers_l[layer] in  ['Skipnode', 'Sumnode', 'AvgPool', 'MaxPool', 'ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                     f.write("  layer"+str(layer)+"_wgt.dim = 1;\n")            
                 else:
                     f.write("  layer"+str(layer)+"_wgt.dim = Tin_C_l"+str(layer)+"*Tout_C_l"+str(layer)+"*Tker_H_l"+str(layer)+"*Tker_W_l"+str(layer)+";\n")
@@ -1408,7 +1600,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  layer"+str(layer)+"_wgt.W = Tker_W_l"+str(layer)+";\n")
                 if bias_l[layer] == 1:
                     f.write("  layer"+str(layer)+"_bias.data = l"+str(layer)+"_bias;\n")
-                    if update_layer_l[layer] == 1:
+                    if update_layer_l[layer] == 1 and lora_rank_l[layer] == 0:
                         f.write("  layer"+str(layer)+"_bias.diff = l"+str(layer)+"_bias_diff;\n")
                     f.write("  layer"+str(layer)+"_bias.dim = Tout_C_l"+str(layer)+";\n")
                     f.write("  layer"+str(layer)+"_bias.C = Tout_C_l"+str(layer)+";\n")
@@ -1435,7 +1627,7 @@ def GenerateNet(proj_folder_path, project_name,
                     if layer >= last_updated_idx:
                         f.write("  layer"+str(layer)+"_out.diff = ("+C_data_type+"*) cast_buffer;\n")
                 else:
-                    if layer < (len(layers_l)-1) and update_layer_l[layer+1] == 0 and layers_l[layer+1] not in ['ReLU', 'LeakyReLU', 'Sigmoid']:
+                    if layer < (len(layers_l)-1) and update_layer_l[layer+1] == 0 and layers_l[layer+1] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                         f.write("  layer"+str(layer)+"_out.data = ("+C_data_type+"*) act_shared_buffer;\n")
                     else:
                         f.write("  layer"+str(layer)+"_out.data = l"+str(layer+1)+"_in;\n")
@@ -1454,7 +1646,7 @@ def GenerateNet(proj_folder_path, project_name,
                     if layer >= last_updated_idx:
                         f.write("  layer"+str(layer)+"_out.diff = ("+C_data_type+"*) cast_buffer;\n")
                 else:
-                    if layer < (len(layers_l)-1) and update_layer_l[layer+1] == 0 and layers_l[layer+1] not in ['ReLU', 'LeakyReLU', 'Sigmoid']:
+                    if layer < (len(layers_l)-1) and update_layer_l[layer+1] == 0 and layers_l[layer+1] not in ['ReLU', 'LeakyReLU', 'Sigmoid', 'HSwish', 'HSigmoid', 'SiLU']:
                         f.write("  layer"+str(layer)+"_out.data = ("+C_data_type+"*) act_shared_buffer;\n")
                     else:
                         f.write("  layer"+str(layer)+"_out.data = l"+str(layer+1)+"_in;\n")
@@ -1494,6 +1686,20 @@ def GenerateNet(proj_folder_path, project_name,
             previous_was_skip_data = 0
             previous_was_skip_diff = 0
 
+    # LoRA ADAPTER BLOBS
+    for layer in range(len(layers_l)):
+        if lora_rank_l[layer] > 0:
+            f.write("  // Layer "+str(layer)+" LoRA adapter\n")
+            f.write("  layer"+str(layer)+"_lora_A.data = l"+str(layer)+"_lora_A;\n")
+            f.write("  layer"+str(layer)+"_lora_A.diff = l"+str(layer)+"_lora_A_diff;\n")
+            f.write("  layer"+str(layer)+"_lora_A.dim = LORA_R_l"+str(layer)+"*Tin_C_l"+str(layer)+";\n")
+            f.write("  layer"+str(layer)+"_lora_B.data = l"+str(layer)+"_lora_B;\n")
+            f.write("  layer"+str(layer)+"_lora_B.diff = l"+str(layer)+"_lora_B_diff;\n")
+            f.write("  layer"+str(layer)+"_lora_B.dim = Tout_C_l"+str(layer)+"*LORA_R_l"+str(layer)+";\n")
+            f.write("  layer"+str(layer)+"_lora_hidden.data = l"+str(layer)+"_lora_hidden;\n")
+            f.write("  layer"+str(layer)+"_lora_hidden.diff = l"+str(layer)+"_lora_hidden_diff;\n")
+            f.write("  layer"+str(layer)+"_lora_hidden.dim = LORA_R_l"+str(layer)+";\n")
+
 
 
     f.write("\n  // Configure layer structures\n")
@@ -1515,7 +1721,7 @@ def GenerateNet(proj_folder_path, project_name,
         #        skip_inputgrad = 1
         # Write configuration templates
         if layers_l[layer] == 'linear':
-            f.write(ntemp.linear_config_template(layer, skip_inputgrad, data_type_l[layer], bias_l[layer], update_layer_l[layer]))
+            f.write(ntemp.linear_config_template(layer, skip_inputgrad, data_type_l[layer], bias_l[layer], update_layer_l[layer], lora_rank_l[layer]))
         elif layers_l[layer] == 'conv2d':
             IM2COL_USEIT = 1
             if CONV2D_USE_IM2COL == False:
@@ -1531,6 +1737,12 @@ def GenerateNet(proj_folder_path, project_name,
             f.write(ntemp.LeakyReLU_config_template(layer, data_type_l[layer]))
         elif layers_l[layer] == 'Sigmoid':
             f.write(ntemp.Sigmoid_config_template(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'HSwish':
+            f.write(ntemp.ReLU_config_template(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'HSigmoid':
+            f.write(ntemp.ReLU_config_template(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'SiLU':
+            f.write(ntemp.ReLU_config_template(layer, data_type_l[layer]))
         elif layers_l[layer] == 'MaxPool':
             f.write("  //   Pooling layer (see next section)\n")
         elif layers_l[layer] == 'AvgPool':
@@ -1599,6 +1811,12 @@ def GenerateNet(proj_folder_path, project_name,
             f.write(ntemp.LeakyReLU_template_FW(layer, data_type_l[layer]))
         elif layers_l[layer] == 'Sigmoid':
             f.write(ntemp.Sigmoid_template_FW(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'HSwish':
+            f.write(ntemp.HSwish_template_FW(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'HSigmoid':
+            f.write(ntemp.HSigmoid_template_FW(layer, data_type_l[layer]))
+        elif layers_l[layer] == 'SiLU':
+            f.write(ntemp.SiLU_template_FW(layer, data_type_l[layer]))
         elif layers_l[layer] == 'AvgPool':
             f.write(ntemp.AvgPool_template_FW(layer, data_type_l[layer]))
         elif layers_l[layer] == 'MaxPool':
@@ -1694,6 +1912,12 @@ def GenerateNet(proj_folder_path, project_name,
             f.write(ntemp.LeakyReLU_template_BW(lay, data_type_l[lay], FIRST_LAYER))
         elif layers_l[lay] == 'Sigmoid':
             f.write(ntemp.Sigmoid_template_BW(lay, data_type_l[lay], FIRST_LAYER))
+        elif layers_l[lay] == 'HSwish':
+            f.write(ntemp.HSwish_template_BW(lay, data_type_l[lay], FIRST_LAYER))
+        elif layers_l[lay] == 'HSigmoid':
+            f.write(ntemp.HSigmoid_template_BW(lay, data_type_l[lay], FIRST_LAYER))
+        elif layers_l[lay] == 'SiLU':
+            f.write(ntemp.SiLU_template_BW(lay, data_type_l[lay], FIRST_LAYER))
         elif layers_l[lay] == 'AvgPool':
             f.write(ntemp.AvgPool_template_BW(lay, data_type_l[lay], FIRST_LAYER))
         elif layers_l[lay] == 'MaxPool':
@@ -1761,32 +1985,52 @@ def GenerateNet(proj_folder_path, project_name,
 
     f.write("\n// Function to update the network\n")
     f.write("void update_weights()\n{\n")
-
+    if optimizer == "Adam":
+        f.write("  static int adam_step = 0;\n")
+        f.write("  adam_step++;\n")
+    elif FP16_ROUNDING == 'FP16_ROUND_STOCHASTIC' and 'FP16' in data_type_l:
+        f.write("  static unsigned int sr_seed = 0;\n")
+        f.write("  sr_seed++;\n")
+
+    # Tensors to update: (data type, weight blob, weight tensor, bias blob, bias tensor)
+    updated_tensors = []
     for layer in range(len(layers_l)):
-        if layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm'] and update_layer_l[layer] == 1:
-            if data_type_l[layer] == 'FP32':
-                f.write("  struct optim_args opt_l"+str(layer)+";\n")
-            elif data_type_l[layer] == 'FP16':
-                f.write("  struct optim_args_fp16 opt_l"+str(layer)+";\n")
-            else:
-                print("[deployment_utils.GenerateNet]: Invalid data type for optimizer structure generation @layer{}!".format(layer))  
-            f.write("  opt_l"+str(layer)+".weights = &layer"+str(layer)+"_wgt;\n")
+        # LoRA: only the adapter is updated
+        if lora_rank_l[layer] > 0:
+            for mat in ['A', 'B']:
+                updated_tensors.append((data_type_l[layer], "layer"+str(layer)+"_lora_"+mat, "l"+str(layer)+"_lora_"+mat, None, None))
+        elif layers_l[layer] in ['linear', 'conv2d', 'DW', 'PW', 'InstNorm'] and update_layer_l[layer] == 1:
             if bias_l[layer] == 1:
-                f.write("  opt_l"+str(layer)+".biases = &layer"+str(layer)+"_bias;\n")
-                f.write("  opt_l"+str(layer)+".use_biases = 1;\n")
+                updated_tensors.append((data_type_l[layer], "layer"+str(layer)+"_wgt", "l"+str(layer)+"_ker", "layer"+str(layer)+"_bias", "l"+str(layer)+"_bias"))
             else:
-                f.write("  opt_l"+str(layer)+".use_biases = 0;\n")
-            f.write("  opt_l"+str(layer)+".learning_rate = LEARNING_RATE;\n")
-            if optimizer == "SGD":
-                if data_type_l[layer] == 'FP32':
-                    f.write("  pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp32, &opt_l"+str(layer)+");\n")
-                elif data_type_l[layer] == 'FP16':
-                    f.write("  pi_cl_team_fork(NUM_CORES, pulp_gradient_descent_fp16, &opt_l"+str(layer)+");\n")
-                else:
-                    print("[deployment_utils.GenerateNet]: Invalid data type for gradient descent @Layer{}!".format(layer))
-            else:
-                print("[deployment_utils.GenerateNet]: Invalid optimizer for PULP deployment!!")
-                exit()
+                updated_tensors.append((data_type_l[layer], "layer"+str(layer)+"_wgt", "l"+str(layer)+"_ker", None, None))
+
+    # All the layers of the same data type are updated by a single multi-tensor fork
+    for data_type in ['FP32', 'FP16']:
+        layer_tensors = [t for t in updated_tensors if t[0] == data_type]
+        if len(layer_tensors) == 0:
+            continue
+        suffix = '' if data_type == 'FP32' else '_fp16'
+        array_name = "opt_"+data_type.lower()
+        if optimizer == "SGD":
+            f.write("  struct optim_args"+suffix+" "+array_name+"["+str(len(layer_tensors))+"];\n")
+        elif optimizer == "Adam":
+            f.write("  struct adam_args"+suffix+" "+array_name+"["+str(len(layer_tensors))+"];\n")
+        else:
+            print("[deployment_utils.GenerateNet]: Invalid optimizer for PULP deployment!!")
+            exit()
+        for idx, (_, wgt_blob, wgt_tensor, bias_blob, bias_tensor) in enumerate(layer_tensors):
+            write_optimizer_args(f, array_name+"["+str(idx)+"]", wgt_blob, wgt_tensor, bias_blob, bias_tensor, optimizer, data_type)
+        f.write("  struct optim_multi_args"+suffix+" "+array_name+"_multi;\n")
+        f.write("  "+array_name+"_multi.n_layers = "+str(len(layer_tensors))+";\n")
+        f.write("  "+array_name+"_multi.max_grad_norm = 0;\n")
+        if optimizer == "SGD":
+            f.write("  "+array_name+"_multi.optimizer = OPTIM_SGD;\n")
+            f.write("  "+array_name+"_multi.layers = "+array_name+";\n")
+        else:
+            f.write("  "+array_name+"_multi.optimizer = OPTIM_ADAM;\n")
+            f.write("  "+array_name+"_multi.adam_layers = "+array_name+";\n")
+        f.write("  pi_cl_team_fork(NUM_CORES, pulp_optimizer_multi_fp"+data_type[2:]+", &"+array_name+"_multi);\n")
     f.write("}\n")
 
 
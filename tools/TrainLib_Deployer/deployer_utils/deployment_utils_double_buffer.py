@@ -1354,6 +1354,7 @@ def GenerateNet(proj_folder_path, project_name,
                 f.write("  struct optim_args opt_l"+str(layer)+";\n")
             elif data_type_l[layer] == 'FP16':
                 f.write("  struct optim_args_fp16 opt_l"+str(layer)+";\n")
+                f.write("  opt_l"+str(layer)+".rounding = FP16_ROUND_NEAREST;\n")
 
             f.write(f"\tget_dim(&layer{layer}_wgt, &d0_blob);\n")
             f.write("\topt_l"+str(layer)+f".weights = &d0_blob;\n")
@@ -1389,6 +1390,7 @@ def GenerateNet(proj_folder_path, project_name,
             f.write("\tstruct optim_args opt_l"+str(layer)+";\n")
         elif data_type_l[layer] == 'FP16':
             f.write("\tstruct optim_args_fp16 opt_l"+str(layer)+";\n")
+            f.write("\topt_l"+str(layer)+".rounding = FP16_ROUND_NEAREST;\n")
 
 
     for layer in layers_with_weights:
@@ -317,14 +317,16 @@ def ReLU_template_FW(layer_number, DATA_TYPE):
     return template
 
 
-def ReLU_template_BW(layer_number, DATA_TYPE):
-    if DATA_TYPE == "FP32":
-        template = "  pulp_relu_fp32_bw_cl(&l" + str(layer_number) + "_args);\n"
-    elif DATA_TYPE == "FP16":
-        template = "  pulp_relu_fp16_bw_cl(&l" + str(layer_number) + "_args);\n"
-    else:
-        print("[net_templates.ReLU_template_BW]: Invalid data type!")
-        exit()
+def ReLU_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == "FP32":
+            template = "  pulp_relu_fp32_bw_cl(&l" + str(layer_number) + "_args);\n"
+        elif DATA_TYPE == "FP16":
+            template = "  pulp_relu_fp16_bw_cl(&l" + str(layer_number) + "_args);\n"
+        else:
+            print("[net_templates.ReLU_template_BW]: Invalid data type!")
+            exit()
     return template
 
 def LeakyReLU_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
@@ -362,6 +364,72 @@ def Sigmoid_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
             exit()  
     return template
 
+def HSwish_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "  pulp_hswish_fp32_fw_cl(&l"+str(layer_number)+"_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "  pulp_hswish_fp16_fw_cl(&l"+str(layer_number)+"_args);\n"
+    else:
+        print("[net_templates.HSwish_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def HSwish_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "  pulp_hswish_fp32_bw_cl(&l"+str(layer_number)+"_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "  pulp_hswish_fp16_bw_cl(&l"+str(layer_number)+"_args);\n"
+        else:
+            print("[net_templates.HSwish_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
+def HSigmoid_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "  pulp_hsigmoid_fp32_fw_cl(&l"+str(layer_number)+"_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "  pulp_hsigmoid_fp16_fw_cl(&l"+str(layer_number)+"_args);\n"
+    else:
+        print("[net_templates.HSigmoid_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def HSigmoid_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "  pulp_hsigmoid_fp32_bw_cl(&l"+str(layer_number)+"_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "  pulp_hsigmoid_fp16_bw_cl(&l"+str(layer_number)+"_args);\n"
+        else:
+            print("[net_templates.HSigmoid_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
+def SiLU_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "  pulp_silu_fp32_fw_cl(&l"+str(layer_number)+"_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "  pulp_silu_fp16_fw_cl(&l"+str(layer_number)+"_args);\n"
+    else:
+        print("[net_templates.SiLU_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def SiLU_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "  pulp_silu_fp32_bw_cl(&l"+str(layer_number)+"_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "  pulp_silu_fp16_bw_cl(&l"+str(layer_number)+"_args);\n"
+        else:
+            print("[net_templates.SiLU_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
 
 """
 POOLING TEMPLATES
@@ -656,7 +724,7 @@ CONFIGURATION STRUCTURE TEMPLATES
 
 
 def linear_config_template(
-    layer_number, skip_in_grad, DATA_TYPE, use_bias, update_layer
+    layer_number, skip_in_grad, DATA_TYPE, use_bias, update_layer, lora_rank=0
 ):
     skip_wg_grad = 0
     if update_layer == 0:
@@ -721,6 +789,14 @@ def linear_config_template(
         template += "  l" + str(layer_number) + "_args.use_biases = 1;\n"
     else:
         template += "  l" + str(layer_number) + "_args.use_biases = 0;\n"
+    if lora_rank > 0:
+        template += "  l" + str(layer_number) + "_args.lora_A = &layer" + str(layer_number) + "_lora_A;\n"
+        template += "  l" + str(layer_number) + "_args.lora_B = &layer" + str(layer_number) + "_lora_B;\n"
+        template += "  l" + str(layer_number) + "_args.lora_hidden = &layer" + str(layer_number) + "_lora_hidden;\n"
+        template += "  l" + str(layer_number) + "_args.lora_rank = LORA_R_l" + str(layer_number) + ";\n"
+        template += "  l" + str(layer_number) + "_args.lora_scale = LORA_SCALE_l" + str(layer_number) + ";\n"
+    else:
+        template += "  l" + str(layer_number) + "_args.lora_rank = 0;\n"
     return template
 
 
@@ -287,14 +287,16 @@ def ReLU_template_FW(layer_number, DATA_TYPE):
     return template
 
 
-def ReLU_template_BW(layer_number, DATA_TYPE):
-    if DATA_TYPE == "FP32":
-        template = "\tpulp_relu_fp32_bw_cl(&act_args);\n"
-    elif DATA_TYPE == "FP16":
-        template = "\tpulp_relu_fp16_bw_cl(&act_args);\n"
-    else:
-        print("[net_templates.ReLU_template_BW]: Invalid data type!")
-        exit()
+def ReLU_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == "FP32":
+            template = "\tpulp_relu_fp32_bw_cl(&act_args);\n"
+        elif DATA_TYPE == "FP16":
+            template = "\tpulp_relu_fp16_bw_cl(&act_args);\n"
+        else:
+            print("[net_templates.ReLU_template_BW]: Invalid data type!")
+            exit()
     return template
 
 def Sigmoid_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
@@ -309,6 +311,72 @@ def Sigmoid_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
             exit()  
     return template
 
+def HSwish_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "\tpulp_hswish_fp32_fw_cl(&act_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "\tpulp_hswish_fp16_fw_cl(&act_args);\n"
+    else:
+        print("[net_templates.HSwish_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def HSwish_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "\tpulp_hswish_fp32_bw_cl(&act_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "\tpulp_hswish_fp16_bw_cl(&act_args);\n"
+        else:
+            print("[net_templates.HSwish_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
+def HSigmoid_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "\tpulp_hsigmoid_fp32_fw_cl(&act_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "\tpulp_hsigmoid_fp16_fw_cl(&act_args);\n"
+    else:
+        print("[net_templates.HSigmoid_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def HSigmoid_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "\tpulp_hsigmoid_fp32_bw_cl(&act_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "\tpulp_hsigmoid_fp16_bw_cl(&act_args);\n"
+        else:
+            print("[net_templates.HSigmoid_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
+def SiLU_template_FW(layer_number, DATA_TYPE):
+    if DATA_TYPE == 'FP32':
+        template = "\tpulp_silu_fp32_fw_cl(&act_args);\n"
+    elif DATA_TYPE == 'FP16':
+        template = "\tpulp_silu_fp16_fw_cl(&act_args);\n"
+    else:
+        print("[net_templates.SiLU_template_FW]: Invalid data type!")
+        exit()  
+    return template
+
+def SiLU_template_BW(layer_number, DATA_TYPE, FIRST_LAYER):
+    template = ''
+    if FIRST_LAYER == False:
+        if DATA_TYPE == 'FP32':
+            template = "\tpulp_silu_fp32_bw_cl(&act_args);\n"
+        elif DATA_TYPE == 'FP16':
+            template = "\tpulp_silu_fp16_bw_cl(&act_args);\n"
+        else:
+            print("[net_templates.SiLU_template_BW]: Invalid data type!")
+            exit()  
+    return template
+
 
 """
 POOLING TEMPLATES